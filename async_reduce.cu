@@ -46,7 +46,8 @@ int main()
   thrust::device_vector<bool> flag(1);
 
   // note we launch the reduction before the greenlight
-  async(par(s1,1), reduce_kernel(), thrust::raw_pointer_cast(flag.data()), vec.begin(), vec.end(), result.begin());
+  // the result is copied back to the host asynchronously in the reduction's stream
+  bulk::future<int> async_result = async(par(s1,1), reduce_kernel(), thrust::raw_pointer_cast(flag.data()), vec.begin(), vec.end(), result.begin()).then_get(result.data());
 
   async(par(s2,1), greenlight(), thrust::raw_pointer_cast(flag.data()));
 
@@ -54,9 +55,9 @@ int main()
   cudaStreamDestroy(s2);
 
   std::cout << "result: " << thrust::reduce(vec.begin(), vec.end()) << std::endl;
-  std::cout << "asynchronous result: " << result[0] << std::endl;
+  std::cout << "asynchronous result: " << async_result.get() << std::endl;
 
-  assert(thrust::reduce(vec.begin(), vec.end()) == result[0]);
+  assert(thrust::reduce(vec.begin(), vec.end()) == async_result.get());
 
   return 0;
 }
@@ -0,0 +1,113 @@
+#include <iostream>
+#include <cassert>
+#include <algorithm>
+#include <vector>
+#include <utility>
+#include <thrust/device_vector.h>
+#include <thrust/host_vector.h>
+#include <thrust/functional.h>
+#include <thrust/random.h>
+#include <bulk/bulk.hpp>
+#include "time_invocation_cuda.hpp"
+
+
+// makes num_problems problem offsets whose sizes span every size class, including a few beyond the largest
+thrust::host_vector<int> problem_offsets(int num_problems, thrust::default_random_engine &rng)
+{
+  thrust::host_vector<int> offsets(num_problems + 1);
+
+  offsets[0] = 0;
+  for(int p = 0; p < num_problems; ++p)
+  {
+    int size = (rng() % 100 == 0) ? rng() % 30000 : 100 + rng() % 4900;
+
+    offsets[p + 1] = offsets[p] + size;
+  }
+
+  return offsets;
+}
+
+
+void validate(int num_problems)
+{
+  thrust::default_random_engine rng(num_problems);
+
+  thrust::host_vector<int> h_offsets = problem_offsets(num_problems, rng);
+  int n = h_offsets.back();
+
+  // few distinct keys, so stability shows in the values
+  thrust::host_vector<int> h_keys(n), h_values(n);
+  for(int i = 0; i < n; ++i)
+  {
+    h_keys[i] = rng() % 100;
+    h_values[i] = i;
+  }
+
+  thrust::device_vector<int> offsets = h_offsets, keys = h_keys, values = h_values;
+
+  bulk::batched_stable_sort_by_key(keys.begin(), keys.end(), values.begin(), offsets.begin(), offsets.end(), thrust::less<int>());
+
+  thrust::host_vector<int> result_keys = keys, result_values = values;
+
+  for(int p = 0; p < num_problems; ++p)
+  {
+    // values are their original positions, so sorting by (key, value) is the stable order
+    std::vector<std::pair<int,int> > expected;
+    for(int i = h_offsets[p]; i < h_offsets[p+1]; ++i)
+    {
+      expected.push_back(std::make_pair(h_keys[i], h_values[i]));
+    }
+
+    std::sort(expected.begin(), expected.end());
+
+    for(int i = h_offsets[p]; i < h_offsets[p+1]; ++i)
+    {
+      assert(result_keys[i]   == expected[i - h_offsets[p]].first);
+      assert(result_values[i] == expected[i - h_offsets[p]].second);
+    }
+  }
+
+  // the batched reduction is the segmented reduction
+  thrust::device_vector<int> sums(num_problems);
+  bulk::batched_reduce(keys.begin(), keys.end(), offsets.begin(), offsets.end(), sums.begin(), 0, thrust::plus<int>());
+
+  thrust::host_vector<int> h_sums = sums;
+  for(int p = 0; p < num_problems; ++p)
+  {
+    int sum = 0;
+    for(int i = h_offsets[p]; i < h_offsets[p+1]; ++i) sum += result_keys[i];
+
+    assert(h_sums[p] == sum);
+  }
+}
+
+
+void batched_sort(thrust::device_vector<int> *keys, thrust::device_vector<int> *values, const thrust::device_vector<int> *offsets)
+{
+  bulk::batched_stable_sort_by_key(keys->begin(), keys->end(), values->begin(), offsets->begin(), offsets->end(), thrust::less<int>());
+}
+
+
+int main()
+{
+  for(int num_problems = 1; num_problems <= 4096; num_problems *= 4)
+  {
+    std::cout << "Testing " << num_problems << " problems" << std::endl;
+    validate(num_problems);
+  }
+
+  thrust::default_random_engine rng;
+
+  int num_problems = 10000;
+  thrust::device_vector<int> offsets = problem_offsets(num_problems, rng);
+  int n = offsets.back();
+
+  thrust::device_vector<int> keys(n), values(n);
+
+  double msecs = time_invocation_cuda(20, batched_sort, &keys, &values, &offsets);
+
+  std::cout << "Batched sort of " << num_problems << " problems, " << n << " pairs: " << msecs << " ms, "
+            << n / (msecs / 1000) << " pairs/s" << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,367 @@
+#include <bulk/bulk.hpp>
+#include <thrust/device_vector.h>
+#include <thrust/tabulate.h>
+#include <thrust/reduce.h>
+#include <thrust/scan.h>
+#include <thrust/copy.h>
+#include <thrust/functional.h>
+#include <iostream>
+#include <fstream>
+#include <cstdlib>
+#include <cstdio>
+#include <string>
+#include "decomposition.hpp"
+#include "benchmark.hpp"
+
+
+// sweeps the sizes, types and group shapes of bulk's algorithms against Thrust's
+// usage: benchmark [output.json] [log2 of the largest n] [number of trials]
+
+
+template<typename T> struct type_name;
+template<> struct type_name<int>    { static const char *get() { return "int32";   } };
+template<> struct type_name<double> { static const char *get() { return "float64"; } };
+
+
+template<typename T>
+struct hash
+{
+  template<typename Integer>
+  __host__ __device__
+  T operator()(Integer x)
+  {
+    x = (x+0x7ed55d16) + (x<<12);
+    x = (x^0xc761c23c) ^ (x>>19);
+    x = (x+0x165667b1) + (x<<5);
+    x = (x+0xd3a2646c) ^ (x<<9);
+    x = (x+0xfd7046c5) + (x<<3);
+    x = (x^0xb55a4f09) ^ (x>>16);
+
+    return x % 10;
+  }
+};
+
+
+struct is_odd
+{
+  template<typename T>
+  __host__ __device__
+  bool operator()(T x) const
+  {
+    return int(x) & 1;
+  }
+};
+
+
+struct reduce_tiles
+{
+  template<typename ConcurrentGroup, typename Iterator1, typename Decomposition, typename Iterator2, typename T>
+  __device__
+  void operator()(ConcurrentGroup &g, Iterator1 first, Decomposition decomp, Iterator2 result, T init)
+  {
+    typename Decomposition::range range = decomp[g.index()];
+
+    T sum = bulk::reduce(g, first + range.first, first + range.second, g.index() == 0 ? init : T(0), thrust::plus<T>());
+
+    if(g.this_exec.index() == 0)
+    {
+      result[g.index()] = sum;
+    }
+  }
+};
+
+
+template<std::size_t groupsize, std::size_t grainsize, typename T>
+struct bulk_reduce_trial
+{
+  const thrust::device_vector<T> *input;
+  T *partial_sums;
+  int num_partial_sums;
+
+  void operator()()
+  {
+    int n = input->size();
+
+    aligned_decomposition<int> decomp(n, num_partial_sums, groupsize * grainsize);
+
+    bulk::concurrent_group<bulk::agent<grainsize>,groupsize> g;
+
+    bulk::async(bulk::par(g, decomp.size()), reduce_tiles(), bulk::root.this_exec, input->begin(), decomp, partial_sums, T(0));
+
+    bulk::async(bulk::par(g, 1), reduce_tiles(), bulk::root.this_exec, partial_sums, make_trivial_decomposition<int>(decomp.size()), partial_sums, T(0));
+
+    T result;
+    cudaMemcpy(&result, partial_sums, sizeof(T), cudaMemcpyDeviceToHost);
+  }
+};
+
+
+typedef bulk::shapes<
+  bulk::shape<128,7>,
+  bulk::shape<128,11>,
+  bulk::shape<256,5>,
+  bulk::shape<512,3>
+> reduce_shapes;
+
+
+template<typename T>
+struct tuned_reduce
+{
+  const thrust::device_vector<T> *input;
+  T *partial_sums;
+  int max_num_partial_sums;
+
+  template<std::size_t groupsize, std::size_t grainsize>
+  void operator()(bulk::shape<groupsize,grainsize>)
+  {
+    int n = input->size();
+    int num_partial_sums = thrust::max<int>(1, thrust::min<int>(max_num_partial_sums, (n + groupsize * grainsize - 1) / (groupsize * grainsize)));
+
+    bulk_reduce_trial<groupsize,grainsize,T> trial = {input, partial_sums, num_partial_sums};
+    trial();
+  }
+};
+
+
+// dispatches to whichever of reduce_shapes bulk::autotune found fastest for this size & device
+template<typename T>
+struct bulk_tuned_reduce_trial
+{
+  tuned_reduce<T> f;
+
+  void operator()()
+  {
+    std::string name = std::string("benchmark_reduce_") + type_name<T>::get();
+
+    bulk::autotune<reduce_shapes>(name.c_str(), f.input->size(), f);
+  }
+};
+
+
+template<typename T>
+struct thrust_reduce_trial
+{
+  const thrust::device_vector<T> *input;
+
+  void operator()()
+  {
+    thrust::reduce(input->begin(), input->end(), T(0));
+  }
+};
+
+
+template<typename T>
+struct bulk_scan_trial
+{
+  const thrust::device_vector<T> *input;
+  thrust::device_vector<T> *result;
+
+  void operator()()
+  {
+    bulk::inclusive_scan(input->begin(), input->end(), result->begin(), thrust::plus<T>());
+  }
+};
+
+
+template<typename T>
+struct thrust_scan_trial
+{
+  const thrust::device_vector<T> *input;
+  thrust::device_vector<T> *result;
+
+  void operator()()
+  {
+    thrust::inclusive_scan(input->begin(), input->end(), result->begin());
+  }
+};
+
+
+template<typename T>
+struct bulk_copy_if_trial
+{
+  const thrust::device_vector<T> *input;
+  thrust::device_vector<T> *result;
+
+  void operator()()
+  {
+    bulk::copy_if(input->begin(), input->end(), result->begin(), is_odd());
+  }
+};
+
+
+template<typename T>
+struct thrust_copy_if_trial
+{
+  const thrust::device_vector<T> *input;
+  thrust::device_vector<T> *result;
+
+  void operator()()
+  {
+    thrust::copy_if(input->begin(), input->end(), result->begin(), is_odd());
+  }
+};
+
+
+template<typename T>
+struct bulk_reduce_by_key_trial
+{
+  const thrust::device_vector<T> *keys;
+  const thrust::device_vector<T> *values;
+  thrust::device_vector<T> *keys_result;
+  thrust::device_vector<T> *values_result;
+
+  void operator()()
+  {
+    bulk::reduce_by_key(keys->begin(), keys->end(), values->begin(), keys_result->begin(), values_result->begin(), thrust::equal_to<T>(), thrust::plus<T>());
+  }
+};
+
+
+template<typename T>
+struct thrust_reduce_by_key_trial
+{
+  const thrust::device_vector<T> *keys;
+  const thrust::device_vector<T> *values;
+  thrust::device_vector<T> *keys_result;
+  thrust::device_vector<T> *values_result;
+
+  void operator()()
+  {
+    thrust::reduce_by_key(keys->begin(), keys->end(), values->begin(), keys_result->begin(), values_result->begin());
+  }
+};
+
+
+struct benchmark_options
+{
+  std::size_t num_warmups;
+  std::size_t num_trials;
+};
+
+
+void report(const benchmark_result &r)
+{
+  std::printf("%-16s %-8s n = %10lu  %4lux%-3lu %10.4f ms +/- %8.4f  %8.2f GB/s  %12.4g elements/s\n",
+              r.algorithm.c_str(), r.type.c_str(),
+              (unsigned long)r.n, (unsigned long)r.groupsize, (unsigned long)r.grainsize,
+              r.mean_msecs, r.ci95_msecs,
+              r.gigabytes_per_second(), r.elements_per_second());
+}
+
+
+template<std::size_t groupsize, std::size_t grainsize, typename T>
+void sweep_bulk_reduce(const thrust::device_vector<T> &input, const benchmark_options &opts, std::vector<benchmark_result> &results)
+{
+  std::size_t n = input.size();
+
+  // 10 groups per multiprocessor, as in reduce.cu
+  int num_partial_sums = thrust::max<int>(1, thrust::min<int>(10 * bulk::concurrent_group<>::hardware_concurrency(), (n + groupsize * grainsize - 1) / (groupsize * grainsize)));
+
+  bulk::temporary_buffer<T> partial_sums(num_partial_sums);
+
+  bulk_reduce_trial<groupsize,grainsize,T> trial = {&input, partial_sums.data(), num_partial_sums};
+
+  results.push_back(benchmark("bulk::reduce", type_name<T>::get(), n, groupsize, grainsize, double(n) * sizeof(T), opts.num_warmups, opts.num_trials, trial));
+  report(results.back());
+}
+
+
+template<typename T>
+void sweep(std::size_t n, const benchmark_options &opts, std::vector<benchmark_result> &results)
+{
+  thrust::device_vector<T> input(n), result(n);
+  thrust::tabulate(input.begin(), input.end(), hash<T>());
+
+  // reduction, across group shapes
+  sweep_bulk_reduce<128,7>(input, opts, results);
+  sweep_bulk_reduce<128,11>(input, opts, results);
+  sweep_bulk_reduce<256,5>(input, opts, results);
+  sweep_bulk_reduce<512,3>(input, opts, results);
+
+  {
+    // 10 groups per multiprocessor, as in reduce.cu
+    int max_num_partial_sums = 10 * bulk::concurrent_group<>::hardware_concurrency();
+    bulk::temporary_buffer<T> partial_sums(max_num_partial_sums);
+
+    bulk_tuned_reduce_trial<T> trial = {{&input, partial_sums.data(), max_num_partial_sums}};
+    results.push_back(benchmark("bulk::reduce (tuned)", type_name<T>::get(), n, 0, 0, double(n) * sizeof(T), opts.num_warmups, opts.num_trials, trial));
+    report(results.back());
+  }
+
+  {
+    thrust_reduce_trial<T> trial = {&input};
+    results.push_back(benchmark("thrust::reduce", type_name<T>::get(), n, 0, 0, double(n) * sizeof(T), opts.num_warmups, opts.num_trials, trial));
+    report(results.back());
+  }
+
+  // scan
+  {
+    bulk_scan_trial<T> trial = {&input, &result};
+    results.push_back(benchmark("bulk::inclusive_scan", type_name<T>::get(), n, 0, 0, 2. * n * sizeof(T), opts.num_warmups, opts.num_trials, trial));
+    report(results.back());
+  }
+
+  {
+    thrust_scan_trial<T> trial = {&input, &result};
+    results.push_back(benchmark("thrust::inclusive_scan", type_name<T>::get(), n, 0, 0, 2. * n * sizeof(T), opts.num_warmups, opts.num_trials, trial));
+    report(results.back());
+  }
+
+  // stream compaction moves its input and the part it keeps
+  std::size_t num_kept = thrust::copy_if(input.begin(), input.end(), result.begin(), is_odd()) - result.begin();
+
+  {
+    bulk_copy_if_trial<T> trial = {&input, &result};
+    results.push_back(benchmark("bulk::copy_if", type_name<T>::get(), n, 0, 0, double(n + num_kept) * sizeof(T), opts.num_warmups, opts.num_trials, trial));
+    report(results.back());
+  }
+
+  {
+    thrust_copy_if_trial<T> trial = {&input, &result};
+    results.push_back(benchmark("thrust::copy_if", type_name<T>::get(), n, 0, 0, double(n + num_kept) * sizeof(T), opts.num_warmups, opts.num_trials, trial));
+    report(results.back());
+  }
+
+  // reduction by key moves its keys & values and a key & value per segment
+  thrust::device_vector<T> keys_result(n), values_result(n);
+
+  std::size_t num_segments = thrust::reduce_by_key(input.begin(), input.end(), input.begin(), keys_result.begin(), values_result.begin()).first - keys_result.begin();
+
+  {
+    bulk_reduce_by_key_trial<T> trial = {&input, &input, &keys_result, &values_result};
+    results.push_back(benchmark("bulk::reduce_by_key", type_name<T>::get(), n, 0, 0, 2. * (n + num_segments) * sizeof(T), opts.num_warmups, opts.num_trials, trial));
+    report(results.back());
+  }
+
+  {
+    thrust_reduce_by_key_trial<T> trial = {&input, &input, &keys_result, &values_result};
+    results.push_back(benchmark("thrust::reduce_by_key", type_name<T>::get(), n, 0, 0, 2. * (n + num_segments) * sizeof(T), opts.num_warmups, opts.num_trials, trial));
+    report(results.back());
+  }
+}
+
+
+int main(int argc, char **argv)
+{
+  const char *output_filename = (argc > 1) ? argv[1] : "benchmark.json";
+  int max_log_n               = (argc > 2) ? std::atoi(argv[2]) : 24;
+
+  benchmark_options opts;
+  opts.num_warmups = 3;
+  opts.num_trials  = (argc > 3) ? std::atoi(argv[3]) : 30;
+
+  std::vector<benchmark_result> results;
+
+  for(int log_n = 10; log_n <= max_log_n; log_n += 2)
+  {
+    sweep<int>(std::size_t(1) << log_n, opts, results);
+    sweep<double>(std::size_t(1) << log_n, opts, results);
+  }
+
+  std::ofstream os(output_filename);
+  write_json(os, results);
+
+  std::cout << "Wrote " << results.size() << " results to " << output_filename << std::endl;
+
+  return 0;
+}
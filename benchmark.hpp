@@ -0,0 +1,229 @@
+#pragma once
+
+#include <cstddef>
+#include <cmath>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <ostream>
+#include <cuda_runtime_api.h>
+
+
+// the measurements of a single benchmark configuration
+struct benchmark_result
+{
+  std::string algorithm;
+  std::string type;
+  std::size_t n;
+  std::size_t groupsize;
+  std::size_t grainsize;
+
+  // the number of bytes each trial moves to & from memory
+  double      num_bytes;
+
+  std::size_t num_trials;
+
+  // per-trial statistics, in milliseconds
+  // ci95_msecs is the half-width of the 95% confidence interval of the mean
+  double      mean_msecs;
+  double      stddev_msecs;
+  double      ci95_msecs;
+  double      min_msecs;
+  double      median_msecs;
+
+  double elements_per_second() const
+  {
+    return mean_msecs > 0 ? double(n) / (mean_msecs / 1000) : 0;
+  }
+
+  double gigabytes_per_second() const
+  {
+    return mean_msecs > 0 ? (num_bytes / (1 << 30)) / (mean_msecs / 1000) : 0;
+  }
+
+  // the throughputs at either end of the mean's confidence interval
+  double gigabytes_per_second_low() const
+  {
+    double msecs = mean_msecs + ci95_msecs;
+    return msecs > 0 ? (num_bytes / (1 << 30)) / (msecs / 1000) : 0;
+  }
+
+  double gigabytes_per_second_high() const
+  {
+    double msecs = mean_msecs - ci95_msecs;
+    return msecs > 0 ? (num_bytes / (1 << 30)) / (msecs / 1000) : 0;
+  }
+};
+
+
+// the two-sided 97.5% quantile of Student's t distribution with df degrees of freedom
+inline double student_t_975(std::size_t df)
+{
+  // indexed by df
+  static const double table[] =
+  {
+    0,      12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262,
+    2.228,  2.201,  2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093,
+    2.086,  2.080,  2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045,
+    2.042
+  };
+
+  return (df < sizeof(table) / sizeof(double)) ? table[df] : 1.960;
+}
+
+
+// times each invocation of f separately with a pair of events on the default stream,
+// after num_warmups untimed invocations which absorb one-time costs such as
+// module loading, pool growth and launch configuration
+template<typename Function>
+std::vector<double> time_trials_cuda(std::size_t num_warmups, std::size_t num_trials, Function f)
+{
+  for(std::size_t i = 0; i < num_warmups; ++i)
+  {
+    f();
+  }
+
+  cudaDeviceSynchronize();
+
+  cudaEvent_t start, stop;
+  cudaEventCreate(&start);
+  cudaEventCreate(&stop);
+
+  std::vector<double> result(num_trials);
+
+  for(std::size_t i = 0; i < num_trials; ++i)
+  {
+    cudaEventRecord(start);
+    f();
+    cudaEventRecord(stop);
+    cudaEventSynchronize(stop);
+
+    float msecs = 0;
+    cudaEventElapsedTime(&msecs, start, stop);
+
+    result[i] = msecs;
+  }
+
+  cudaEventDestroy(start);
+  cudaEventDestroy(stop);
+
+  return result;
+}
+
+
+template<typename Function>
+benchmark_result benchmark(const std::string &algorithm,
+                           const std::string &type,
+                           std::size_t n,
+                           std::size_t groupsize,
+                           std::size_t grainsize,
+                           double num_bytes,
+                           std::size_t num_warmups,
+                           std::size_t num_trials,
+                           Function f)
+{
+  std::vector<double> samples = time_trials_cuda(num_warmups, num_trials, f);
+
+  benchmark_result result;
+  result.algorithm  = algorithm;
+  result.type       = type;
+  result.n          = n;
+  result.groupsize  = groupsize;
+  result.grainsize  = grainsize;
+  result.num_bytes  = num_bytes;
+  result.num_trials = samples.size();
+
+  result.mean_msecs = result.stddev_msecs = result.ci95_msecs = result.min_msecs = result.median_msecs = 0;
+
+  if(samples.empty()) return result;
+
+  double sum = 0;
+  for(std::size_t i = 0; i < samples.size(); ++i)
+  {
+    sum += samples[i];
+  }
+
+  result.mean_msecs = sum / samples.size();
+
+  double sum_of_squares = 0;
+  for(std::size_t i = 0; i < samples.size(); ++i)
+  {
+    sum_of_squares += (samples[i] - result.mean_msecs) * (samples[i] - result.mean_msecs);
+  }
+
+  if(samples.size() > 1)
+  {
+    result.stddev_msecs = std::sqrt(sum_of_squares / (samples.size() - 1));
+    result.ci95_msecs   = student_t_975(samples.size() - 1) * result.stddev_msecs / std::sqrt(double(samples.size()));
+  }
+
+  std::sort(samples.begin(), samples.end());
+
+  result.min_msecs    = samples.front();
+  result.median_msecs = (samples.size() % 2) ? samples[samples.size() / 2] : (samples[samples.size() / 2 - 1] + samples[samples.size() / 2]) / 2;
+
+  return result;
+}
+
+
+inline void write_json_string(std::ostream &os, const std::string &str)
+{
+  os << '"';
+
+  for(std::size_t i = 0; i < str.size(); ++i)
+  {
+    if(str[i] == '"' || str[i] == '\\') os << '\\';
+    os << str[i];
+  }
+
+  os << '"';
+}
+
+
+// writes the results as a single JSON document which also identifies the device they were measured on
+inline void write_json(std::ostream &os, const std::vector<benchmark_result> &results)
+{
+  int device = 0;
+  cudaGetDevice(&device);
+
+  cudaDeviceProp props;
+  cudaGetDeviceProperties(&props, device);
+
+  int runtime_version = 0;
+  cudaRuntimeGetVersion(&runtime_version);
+
+  os << "{\n";
+  os << "  \"device\": {\"name\": ";
+  write_json_string(os, props.name);
+  os << ", \"compute_capability\": \"" << props.major << "." << props.minor << "\""
+     << ", \"multiprocessors\": " << props.multiProcessorCount
+     << ", \"cuda_runtime_version\": " << runtime_version << "},\n";
+
+  os << "  \"results\": [\n";
+
+  for(std::size_t i = 0; i < results.size(); ++i)
+  {
+    const benchmark_result &r = results[i];
+
+    os << "    {\"algorithm\": ";
+    write_json_string(os, r.algorithm);
+    os << ", \"type\": ";
+    write_json_string(os, r.type);
+    os << ", \"n\": " << r.n
+       << ", \"groupsize\": " << r.groupsize
+       << ", \"grainsize\": " << r.grainsize
+       << ", \"num_trials\": " << r.num_trials
+       << ", \"mean_msecs\": " << r.mean_msecs
+       << ", \"stddev_msecs\": " << r.stddev_msecs
+       << ", \"ci95_msecs\": " << r.ci95_msecs
+       << ", \"min_msecs\": " << r.min_msecs
+       << ", \"median_msecs\": " << r.median_msecs
+       << ", \"elements_per_second\": " << r.elements_per_second()
+       << ", \"gigabytes_per_second\": " << r.gigabytes_per_second()
+       << ", \"gigabytes_per_second_ci95\": [" << r.gigabytes_per_second_low() << ", " << r.gigabytes_per_second_high() << "]"
+       << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+  }
+
+  os << "  ]\n";
+  os << "}\n";
+}
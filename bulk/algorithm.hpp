@@ -18,13 +18,19 @@
 
 #include <bulk/detail/config.hpp>
 #include <bulk/algorithm/copy.hpp> 
+#include <bulk/algorithm/async_copy.hpp>
 #include <bulk/algorithm/reduce.hpp>
 #include <bulk/algorithm/scan.hpp>
 #include <bulk/algorithm/accumulate.hpp>
+#include <bulk/algorithm/mixed_precision.hpp>
 #include <bulk/algorithm/merge.hpp>
+#include <bulk/algorithm/set_operations.hpp>
+#include <bulk/algorithm/partition.hpp>
+#include <bulk/algorithm/histogram.hpp>
 #include <bulk/algorithm/scatter.hpp>
 #include <bulk/algorithm/adjacent_difference.hpp>
 #include <bulk/algorithm/reduce_by_key.hpp>
 #include <bulk/algorithm/sort.hpp>
 #include <bulk/algorithm/gather.hpp>
+#include <bulk/algorithm/load_balanced_for_each.hpp>
 
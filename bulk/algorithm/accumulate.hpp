@@ -18,8 +18,10 @@
 
 #include <bulk/detail/config.hpp>
 #include <bulk/algorithm/reduce.hpp>
+#include <bulk/algorithm/async_copy.hpp>
 #include <bulk/execution_policy.hpp>
 #include <bulk/uninitialized.hpp>
+#include <bulk/static_scratch.hpp>
 #include <thrust/detail/type_traits/function_traits.h>
 
 BULK_NAMESPACE_PREFIX
@@ -132,8 +134,6 @@ T accumulate(bulk::concurrent_group<bulk::agent<grainsize>,groupsize> &g,
 
   T sum = init;
 
-  typename thrust::iterator_difference<RandomAccessIterator>::type n = last - first;
-
   typedef detail::accumulate_detail::buffer<
     groupsize,
     grainsize,
@@ -142,7 +142,14 @@ T accumulate(bulk::concurrent_group<bulk::agent<grainsize>,groupsize> &g,
   > buffer_type;
 
 #if __CUDA_ARCH__ >= 200
-  buffer_type *buffer = reinterpret_cast<buffer_type*>(bulk::malloc(g, sizeof(buffer_type)));
+  // prefer the static scratch, which needs neither allocation nor a barrier
+  buffer_type *buffer = bulk::static_scratch_ptr<buffer_type>(g);
+  const bool dynamic_buffer = (buffer == 0);
+
+  if(dynamic_buffer)
+  {
+    buffer = reinterpret_cast<buffer_type*>(bulk::malloc(g, sizeof(buffer_type)));
+  } // end if
 #else
   __shared__ uninitialized<buffer_type> buffer_impl;
   buffer_type *buffer = &buffer_impl.get();
@@ -182,19 +189,144 @@ T accumulate(bulk::concurrent_group<bulk::agent<grainsize>,groupsize> &g,
     g.wait();
     
     // sum over the group
-    sum = accumulate_detail::destructive_accumulate_n(g, buffer->sums.data(), thrust::min<size_type>(groupsize,n), sum, binary_op);
+    // only the agents which received inputs contributed a sum
+    size_type num_sums = (partition_size + grainsize - 1) / grainsize;
+    sum = accumulate_detail::destructive_accumulate_n(g, buffer->sums.data(), num_sums, sum, binary_op);
   } // end for
 
 #if __CUDA_ARCH__ >= 200
-  bulk::free(g, buffer);
+  if(dynamic_buffer)
+  {
+    bulk::free(g, buffer);
+  } // end if
 #endif
 
   return sum;
 } // end accumulate
+
+
+template<std::size_t groupsize, std::size_t grainsize, typename RandomAccessIterator, typename T>
+struct pipelined_buffer
+{
+  // the tile being summed and the tile in flight
+  // each stage's sums overlap its own tile, which is dead once summed, so this costs twice buffer above
+  buffer<groupsize, grainsize, RandomAccessIterator, T> stages[2];
+}; // end pipelined_buffer
+
+
+// like accumulate above, but the next tile is prefetched with async_copy_n while the current tile is summed
+template<std::size_t groupsize, std::size_t grainsize, typename RandomAccessIterator, typename T, typename BinaryFunction>
+__device__
+T pipelined_accumulate(bulk::concurrent_group<bulk::agent<grainsize>,groupsize> &g,
+                       RandomAccessIterator first,
+                       RandomAccessIterator last,
+                       T init,
+                       BinaryFunction binary_op)
+{
+  typedef typename bulk::concurrent_group<bulk::agent<grainsize>,groupsize>::size_type size_type;
+
+  const size_type elements_per_group = groupsize * grainsize;
+
+  size_type tid = g.this_exec.index();
+
+  T sum = init;
+
+  typedef detail::accumulate_detail::pipelined_buffer<
+    groupsize,
+    grainsize,
+    RandomAccessIterator,
+    T
+  > buffer_type;
+
+  // prefer the static scratch, which needs neither allocation nor a barrier
+  buffer_type *buffer = bulk::static_scratch_ptr<buffer_type>(g);
+  const bool dynamic_buffer = (buffer == 0);
+
+  if(dynamic_buffer)
+  {
+    buffer = reinterpret_cast<buffer_type*>(bulk::malloc(g, sizeof(buffer_type)));
+  } // end if
+
+  bulk::pipeline pipe;
+
+  if(first < last)
+  {
+    bulk::async_copy_n(g, first, thrust::min<size_type>(elements_per_group, last - first), buffer->stages[0].inputs.data(), pipe);
+  } // end if
+
+  pipe.commit();
+
+  for(int stage = 0; first < last; first += elements_per_group, stage ^= 1)
+  {
+    size_type partition_size = thrust::min<size_type>(elements_per_group, last - first);
+
+    // prefetch the next tile into the other stage
+    RandomAccessIterator next = first + partition_size;
+    if(next < last)
+    {
+      bulk::async_copy_n(g, next, thrust::min<size_type>(elements_per_group, last - next), buffer->stages[stage ^ 1].inputs.data(), pipe);
+    } // end if
+
+    pipe.commit();
+
+    // let this tile land, but leave the next one in flight
+    pipe.wait_prior<1>(g);
+
+    T this_sum;
+    size_type local_offset = grainsize * g.this_exec.index();
+
+    size_type local_size = thrust::max<size_type>(0,thrust::min<size_type>(grainsize, partition_size - grainsize * tid));
+
+    if(local_size)
+    {
+      this_sum = buffer->stages[stage].inputs[local_offset];
+      this_sum = bulk::accumulate(bound<grainsize-1>(g.this_exec),
+                                  buffer->stages[stage].inputs.data() + local_offset + 1,
+                                  buffer->stages[stage].inputs.data() + local_offset + local_size,
+                                  this_sum,
+                                  binary_op);
+    } // end if
+
+    // sums aliases this stage's inputs, so wait until every agent has finished reading them
+    g.wait();
+
+    if(local_size)
+    {
+      buffer->stages[stage].sums[tid] = this_sum;
+    } // end if
+
+    g.wait();
+
+    // sum over the group
+    // the waits within also keep the next iteration's prefetch from overwriting this stage early
+    size_type num_sums = (partition_size + grainsize - 1) / grainsize;
+    sum = accumulate_detail::destructive_accumulate_n(g, buffer->stages[stage].sums.data(), num_sums, sum, binary_op);
+  } // end for
+
+  if(dynamic_buffer)
+  {
+    bulk::free(g, buffer);
+  } // end if
+
+  return sum;
+} // end pipelined_accumulate()
 } // end accumulate_detail
 } // end detail
 
 
+// the number of bytes of static scratch with which accumulate over a concurrent_group avoids bulk::malloc
+template<std::size_t groupsize, std::size_t grainsize, typename RandomAccessIterator, typename T>
+struct accumulate_scratch_size
+{
+  private:
+    static const std::size_t buffer_size           = sizeof(detail::accumulate_detail::buffer<groupsize,grainsize,RandomAccessIterator,T>);
+    static const std::size_t pipelined_buffer_size = sizeof(detail::accumulate_detail::pipelined_buffer<groupsize,grainsize,RandomAccessIterator,T>);
+
+  public:
+    static const std::size_t value = (buffer_size < pipelined_buffer_size) ? pipelined_buffer_size : buffer_size;
+}; // end accumulate_scratch_size
+
+
 template<std::size_t groupsize, std::size_t grainsize, typename RandomAccessIterator, typename T, typename BinaryFunction>
 __device__
 T accumulate(bulk::concurrent_group<bulk::agent<grainsize>, groupsize> &g,
@@ -210,7 +342,11 @@ T accumulate(bulk::concurrent_group<bulk::agent<grainsize>, groupsize> &g,
   } // end if
   else
   {
+#if __BULK_HAS_CP_ASYNC__
+    init = detail::accumulate_detail::pipelined_accumulate(g, first, last, init, binary_op);
+#else
     init = detail::accumulate_detail::accumulate(g, first, last, init, binary_op);
+#endif
   } // end else
 
   return init;
@@ -0,0 +1,240 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/execution_policy.hpp>
+#include <bulk/detail/is_contiguous_iterator.hpp>
+#include <bulk/detail/pointer_traits.hpp>
+#include <bulk/detail/alignment.hpp>
+#include <thrust/detail/type_traits.h>
+#include <thrust/detail/raw_pointer_cast.h>
+#include <thrust/iterator/iterator_traits.h>
+
+
+// cp.async arrived with sm_80 and CUDA 11
+#if defined(__CUDA_ARCH__) && (__CUDA_ARCH__ >= 800) && defined(CUDART_VERSION) && (CUDART_VERSION >= 11000)
+#  define __BULK_HAS_CP_ASYNC__ 1
+#else
+#  define __BULK_HAS_CP_ASYNC__ 0
+#endif
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+namespace detail
+{
+namespace async_copy_detail
+{
+
+
+template<std::size_t size> struct cp_async;
+
+
+#if __BULK_HAS_CP_ASYNC__
+template<>
+struct cp_async<4>
+{
+  __device__
+  static void copy(void *shared_dst, const void *global_src)
+  {
+    unsigned int dst = static_cast<unsigned int>(__cvta_generic_to_shared(shared_dst));
+    asm volatile("cp.async.ca.shared.global [%0], [%1], 4;\n" :: "r"(dst), "l"(global_src));
+  }
+};
+
+
+template<>
+struct cp_async<8>
+{
+  __device__
+  static void copy(void *shared_dst, const void *global_src)
+  {
+    unsigned int dst = static_cast<unsigned int>(__cvta_generic_to_shared(shared_dst));
+    asm volatile("cp.async.ca.shared.global [%0], [%1], 8;\n" :: "r"(dst), "l"(global_src));
+  }
+};
+
+
+template<>
+struct cp_async<16>
+{
+  __device__
+  static void copy(void *shared_dst, const void *global_src)
+  {
+    unsigned int dst = static_cast<unsigned int>(__cvta_generic_to_shared(shared_dst));
+
+    // 16B copies may bypass L1
+    asm volatile("cp.async.cg.shared.global [%0], [%1], 16;\n" :: "r"(dst), "l"(global_src));
+  }
+};
+#endif // __BULK_HAS_CP_ASYNC__
+
+
+template<typename RandomAccessIterator1, typename RandomAccessIterator2>
+struct is_async_copyable_impl
+{
+  typedef typename thrust::detail::remove_const<
+    typename thrust::iterator_value<RandomAccessIterator1>::type
+  >::type value_type1;
+
+  typedef typename thrust::iterator_value<RandomAccessIterator2>::type value_type2;
+
+  typedef thrust::detail::integral_constant<
+    bool,
+    thrust::detail::is_same<value_type1,value_type2>::value &&
+    thrust::detail::has_trivial_assign<value_type2>::value &&
+    (sizeof(value_type2) == 4 || sizeof(value_type2) == 8 || sizeof(value_type2) == 16)
+  > type;
+};
+
+
+// a copy may go through cp.async when both ranges are contiguous and hold
+// the same trivially assignable type of a size cp.async can move
+template<typename RandomAccessIterator1, typename RandomAccessIterator2>
+struct is_async_copyable
+  : thrust::detail::eval_if<
+      is_contiguous_iterator<RandomAccessIterator1>::value && is_contiguous_iterator<RandomAccessIterator2>::value,
+      is_async_copyable_impl<RandomAccessIterator1,RandomAccessIterator2>,
+      thrust::detail::identity_<thrust::detail::false_type>
+    >::type
+{};
+
+
+template<typename ConcurrentGroup, typename RandomAccessIterator1, typename Size, typename RandomAccessIterator2>
+__forceinline__ __device__
+void synchronous_copy_n(ConcurrentGroup &g, RandomAccessIterator1 first, Size n, RandomAccessIterator2 result)
+{
+  for(Size i = g.this_exec.index(); i < n; i += g.size())
+  {
+    result[i] = first[i];
+  } // end for i
+} // end synchronous_copy_n()
+
+
+template<typename ConcurrentGroup, typename RandomAccessIterator1, typename Size, typename RandomAccessIterator2>
+__forceinline__ __device__
+typename thrust::detail::enable_if<
+  !is_async_copyable<RandomAccessIterator1,RandomAccessIterator2>::value
+>::type
+  async_copy_n(ConcurrentGroup &g, RandomAccessIterator1 first, Size n, RandomAccessIterator2 result)
+{
+  synchronous_copy_n(g, first, n, result);
+} // end async_copy_n()
+
+
+template<typename ConcurrentGroup, typename RandomAccessIterator1, typename Size, typename RandomAccessIterator2>
+__forceinline__ __device__
+typename thrust::detail::enable_if<
+  is_async_copyable<RandomAccessIterator1,RandomAccessIterator2>::value
+>::type
+  async_copy_n(ConcurrentGroup &g, RandomAccessIterator1 first, Size n, RandomAccessIterator2 result)
+{
+#if __BULK_HAS_CP_ASYNC__
+  typedef typename thrust::iterator_value<RandomAccessIterator2>::type value_type;
+
+  if(n > 0)
+  {
+    const value_type *raw_first = thrust::raw_pointer_cast(&*first);
+    value_type *raw_result = thrust::raw_pointer_cast(&*result);
+
+    // cp.async only moves naturally aligned words from global to shared memory
+    if(bulk::detail::is_global(raw_first) && bulk::detail::is_shared(raw_result) &&
+       bulk::detail::is_aligned(raw_first, sizeof(value_type)) && bulk::detail::is_aligned(raw_result, sizeof(value_type)))
+    {
+      for(Size i = g.this_exec.index(); i < n; i += g.size())
+      {
+        cp_async<sizeof(value_type)>::copy(raw_result + i, raw_first + i);
+      } // end for i
+
+      return;
+    } // end if
+  } // end if
+#endif
+
+  synchronous_copy_n(g, first, n, result);
+} // end async_copy_n()
+
+
+} // end async_copy_detail
+} // end detail
+
+
+// pipeline tracks the batches of async_copy_n which each agent of a group has in flight
+// a batch comprises the copies issued since the previous commit(), and its results may not be read
+// until a call to wait_prior() lets it land
+//
+// on sm_80 and newer the copies go through cp.async, so a group may compute on one tile while the next
+// is on its way into shared memory; elsewhere they complete immediately and the pipeline only waits for the group
+class pipeline
+{
+  public:
+    // closes the batch of copies issued since the previous commit
+    // every agent of the group must commit, even if it issued no copies, so that agents count batches alike
+    __device__
+    void commit() const
+    {
+#if __BULK_HAS_CP_ASYNC__
+      asm volatile("cp.async.commit_group;\n" ::);
+#endif
+    } // end commit()
+
+    // waits until at most num_pending of the committed batches remain in flight,
+    // then waits for the group, so that each agent may read what the others copied
+    template<int num_pending, typename ConcurrentGroup>
+    __device__
+    void wait_prior(ConcurrentGroup &g) const
+    {
+#if __BULK_HAS_CP_ASYNC__
+      asm volatile("cp.async.wait_group %0;\n" :: "n"(num_pending));
+#endif
+
+      g.wait();
+    } // end wait_prior()
+
+    // waits for every committed batch
+    template<typename ConcurrentGroup>
+    __device__
+    void wait(ConcurrentGroup &g) const
+    {
+      wait_prior<0>(g);
+    } // end wait()
+}; // end pipeline
+
+
+// async_copy_n begins to copy [first, first + n) to [result, result + n) as part of p's current batch
+// unlike copy_n, it does not wait for the group; result may not be read until p lets the batch land
+template<std::size_t groupsize,
+         typename Executor,
+         typename RandomAccessIterator1,
+         typename Size,
+         typename RandomAccessIterator2>
+__forceinline__ __device__
+RandomAccessIterator2
+  async_copy_n(bulk::concurrent_group<Executor,groupsize> &g, RandomAccessIterator1 first, Size n, RandomAccessIterator2 result, const pipeline &)
+{
+  detail::async_copy_detail::async_copy_n(g, first, n, result);
+
+  return result + n;
+} // end async_copy_n()
+
+
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
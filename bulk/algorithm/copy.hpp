@@ -20,7 +20,14 @@
 #include <bulk/execution_policy.hpp>
 #include <bulk/detail/is_contiguous_iterator.hpp>
 #include <bulk/detail/pointer_traits.hpp>
+#include <bulk/detail/alignment.hpp>
+#include <bulk/algorithm/detail/strided_staging.hpp>
 #include <thrust/detail/type_traits.h>
+#include <thrust/detail/raw_pointer_cast.h>
+#include <thrust/detail/minmax.h>
+#include <thrust/iterator/iterator_traits.h>
+#include <thrust/iterator/zip_iterator.h>
+#include <thrust/tuple.h>
 
 
 BULK_NAMESPACE_PREFIX
@@ -89,6 +96,115 @@ RandomAccessIterator2 simple_copy_n(ConcurrentGroup &g, RandomAccessIterator1 fi
 } // end simple_copy_n()
 
 
+template<typename RandomAccessIterator1, typename RandomAccessIterator2>
+struct is_vectorizable_copy_impl
+{
+  typedef typename thrust::detail::remove_const<
+    typename thrust::iterator_value<RandomAccessIterator1>::type
+  >::type value_type1;
+
+  typedef typename thrust::iterator_value<RandomAccessIterator2>::type value_type2;
+
+  typedef thrust::detail::integral_constant<
+    bool,
+    thrust::detail::is_same<value_type1,value_type2>::value &&
+    thrust::detail::has_trivial_assign<value_type2>::value &&
+    (sizeof(value_type2) < max_vector_alignment) &&
+    (max_vector_alignment % sizeof(value_type2) == 0)
+  > type;
+};
+
+
+// a copy may move int4s rather than individual values when both ranges are contiguous
+// and hold the same trivially assignable type narrower than an int4
+template<typename RandomAccessIterator1, typename RandomAccessIterator2>
+struct is_vectorizable_copy
+  : thrust::detail::eval_if<
+      is_contiguous_iterator<RandomAccessIterator1>::value && is_contiguous_iterator<RandomAccessIterator2>::value,
+      is_vectorizable_copy_impl<RandomAccessIterator1,RandomAccessIterator2>,
+      thrust::detail::identity_<thrust::detail::false_type>
+    >::type
+{};
+
+
+// first and result must be equally misaligned
+// the misaligned prologue and the partial epilogue are copied one value at a time
+template<typename ConcurrentGroup, typename T, typename Size>
+__forceinline__ __device__
+void vectorized_copy_n(ConcurrentGroup &g, const T *first, Size n, T *result)
+{
+  typedef int4 vector_type;
+
+  const Size values_per_vector = sizeof(vector_type) / sizeof(T);
+
+  Size tid = g.this_exec.index();
+
+  Size prologue_size = ((max_vector_alignment - misalignment(first, max_vector_alignment)) % max_vector_alignment) / sizeof(T);
+  prologue_size = thrust::min<Size>(prologue_size, n);
+
+  for(Size i = tid; i < prologue_size; i += g.size())
+  {
+    result[i] = first[i];
+  } // end for i
+
+  Size num_vectors = (n - prologue_size) / values_per_vector;
+
+  const vector_type *vector_first = reinterpret_cast<const vector_type*>(first + prologue_size);
+  vector_type *vector_result = reinterpret_cast<vector_type*>(result + prologue_size);
+
+  for(Size i = tid; i < num_vectors; i += g.size())
+  {
+    vector_result[i] = vector_first[i];
+  } // end for i
+
+  for(Size i = prologue_size + num_vectors * values_per_vector + tid; i < n; i += g.size())
+  {
+    result[i] = first[i];
+  } // end for i
+} // end vectorized_copy_n()
+
+
+// returns false without copying anything when the copy cannot be vectorized
+// the decision is the same for every agent of g
+template<typename ConcurrentGroup, typename RandomAccessIterator1, typename Size, typename RandomAccessIterator2>
+__forceinline__ __device__
+typename thrust::detail::enable_if<
+  !is_vectorizable_copy<RandomAccessIterator1,RandomAccessIterator2>::value,
+  bool
+>::type
+  try_vectorized_copy_n(ConcurrentGroup &, RandomAccessIterator1, Size, RandomAccessIterator2)
+{
+  return false;
+} // end try_vectorized_copy_n()
+
+
+template<typename ConcurrentGroup, typename RandomAccessIterator1, typename Size, typename RandomAccessIterator2>
+__forceinline__ __device__
+typename thrust::detail::enable_if<
+  is_vectorizable_copy<RandomAccessIterator1,RandomAccessIterator2>::value,
+  bool
+>::type
+  try_vectorized_copy_n(ConcurrentGroup &g, RandomAccessIterator1 first, Size n, RandomAccessIterator2 result)
+{
+  typedef typename thrust::iterator_value<RandomAccessIterator2>::type value_type;
+
+  // too short to repay the prologue and epilogue
+  if(n < Size(g.size() * (max_vector_alignment / sizeof(value_type)))) return false;
+
+  const value_type *raw_first = thrust::raw_pointer_cast(&*first);
+  value_type *raw_result = thrust::raw_pointer_cast(&*result);
+
+  // vectors must be aligned for both loads and stores
+  if(misalignment(raw_first, max_vector_alignment) != misalignment(raw_result, max_vector_alignment)) return false;
+
+  vectorized_copy_n(g, raw_first, n, raw_result);
+
+  g.wait();
+
+  return true;
+} // end try_vectorized_copy_n()
+
+
 template<std::size_t size,
          std::size_t grainsize,
          typename RandomAccessIterator1,
@@ -166,6 +282,50 @@ typename thrust::detail::enable_if<
 } // end simple_copy_n()
 
 
+template<typename RandomAccessIterator>
+struct copy_visitor
+{
+  RandomAccessIterator result;
+
+  __device__
+  copy_visitor(RandomAccessIterator result)
+    : result(result)
+  {}
+
+  template<typename Size, typename T>
+  __device__
+  void operator()(Size i, const T &x)
+  {
+    result[i] = x;
+  }
+}; // end copy_visitor
+
+
+// returns false without copying anything when first is not a stageable strided_iterator
+template<typename ConcurrentGroup, typename RandomAccessIterator1, typename Size, typename RandomAccessIterator2>
+__forceinline__ __device__
+typename thrust::detail::enable_if<
+  !is_stageable_strided_iterator<RandomAccessIterator1>::value,
+  bool
+>::type
+  try_staged_strided_copy_n(ConcurrentGroup &, RandomAccessIterator1, Size, RandomAccessIterator2)
+{
+  return false;
+} // end try_staged_strided_copy_n()
+
+
+template<typename ConcurrentGroup, typename RandomAccessIterator1, typename Size, typename RandomAccessIterator2>
+__forceinline__ __device__
+typename thrust::detail::enable_if<
+  is_stageable_strided_iterator<RandomAccessIterator1>::value,
+  bool
+>::type
+  try_staged_strided_copy_n(ConcurrentGroup &g, RandomAccessIterator1 first, Size n, RandomAccessIterator2 result)
+{
+  return detail::try_staged_strided_visit_n(g, first, n, copy_visitor<RandomAccessIterator2>(result));
+} // end try_staged_strided_copy_n()
+
+
 template<std::size_t size,
          std::size_t grainsize,
          typename RandomAccessIterator1,
@@ -180,10 +340,89 @@ RandomAccessIterator2 copy_n(concurrent_group<
                              Size n,
                              RandomAccessIterator2 result)
 {
+  if(detail::try_staged_strided_copy_n(g, first, n, result))
+  {
+    return result + n;
+  } // end if
+
+  if(detail::try_vectorized_copy_n(g, first, n, result))
+  {
+    return result + n;
+  } // end if
+
   return detail::simple_copy_n(g, first, n, result);
 } // end copy_n()
 
 
+template<std::size_t size,
+         std::size_t grainsize,
+         typename IteratorTuple1,
+         typename Size,
+         typename IteratorTuple2>
+__forceinline__ __device__
+typename thrust::detail::enable_if<
+  (thrust::tuple_size<IteratorTuple1>::value == thrust::tuple_size<IteratorTuple2>::value),
+  thrust::zip_iterator<IteratorTuple2>
+>::type
+copy_n(concurrent_group<
+         agent<grainsize>,
+         size
+       > &g,
+       thrust::zip_iterator<IteratorTuple1> first,
+       Size n,
+       thrust::zip_iterator<IteratorTuple2> result);
+
+
+template<unsigned int i, unsigned int num_components>
+struct copy_components
+{
+  template<typename ConcurrentGroup, typename IteratorTuple1, typename Size, typename IteratorTuple2>
+  __forceinline__ __device__
+  static void do_it(ConcurrentGroup &g, const IteratorTuple1 &first, Size n, const IteratorTuple2 &result)
+  {
+    detail::copy_n(g, thrust::get<i>(first), n, thrust::get<i>(result));
+
+    copy_components<i+1,num_components>::do_it(g, first, n, result);
+  }
+}; // end copy_components
+
+
+template<unsigned int num_components>
+struct copy_components<num_components,num_components>
+{
+  template<typename ConcurrentGroup, typename IteratorTuple1, typename Size, typename IteratorTuple2>
+  __forceinline__ __device__
+  static void do_it(ConcurrentGroup &, const IteratorTuple1 &, Size, const IteratorTuple2 &)
+  {}
+}; // end copy_components
+
+
+// a copy between zip_iterators proceeds one component at a time, so that each component's
+// accesses are coalesced on their own and may be vectorized, e.g. into a structure-of-arrays stage
+template<std::size_t size,
+         std::size_t grainsize,
+         typename IteratorTuple1,
+         typename Size,
+         typename IteratorTuple2>
+__forceinline__ __device__
+typename thrust::detail::enable_if<
+  (thrust::tuple_size<IteratorTuple1>::value == thrust::tuple_size<IteratorTuple2>::value),
+  thrust::zip_iterator<IteratorTuple2>
+>::type
+copy_n(concurrent_group<
+         agent<grainsize>,
+         size
+       > &g,
+       thrust::zip_iterator<IteratorTuple1> first,
+       Size n,
+       thrust::zip_iterator<IteratorTuple2> result)
+{
+  copy_components<0, thrust::tuple_size<IteratorTuple1>::value>::do_it(g, first.get_iterator_tuple(), n, result.get_iterator_tuple());
+
+  return result + n;
+} // end copy_n()
+
+
 } // end detail
 
 
@@ -231,6 +470,12 @@ copy_n(bulk::bounded<
 
   typedef typename thrust::iterator_value<RandomAccessIterator1>::type value_type;
 
+  // whole tiles between contiguous ranges needn't stage through registers
+  if(groupsize * grainsize <= n && detail::try_vectorized_copy_n(g, first, size_type(groupsize * grainsize), result))
+  {
+    return result + groupsize * grainsize;
+  } // end if
+
   // XXX make this an uninitialized array
   value_type stage[grainsize];
 
@@ -251,7 +496,10 @@ copy_n(bulk::bounded<
   } // end if
   else
   {
-    for(size_type i = 0; i < grainsize; ++i)
+    // n is at most bound, so the rows past it needn't be visited
+    const size_type num_rows = (bound + groupsize - 1) / groupsize;
+
+    for(size_type i = 0; i < num_rows; ++i)
     {
       size_type src_idx = g.size() * i + tid;
       if(src_idx < n)
@@ -260,7 +508,7 @@ copy_n(bulk::bounded<
       } // end if
     } // end for
 
-    for(size_type i = 0; i < grainsize; ++i)
+    for(size_type i = 0; i < num_rows; ++i)
     {
       size_type dst_idx = g.size() * i + tid;
       if(dst_idx < n)
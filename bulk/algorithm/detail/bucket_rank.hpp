@@ -0,0 +1,128 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/execution_policy.hpp>
+#include <bulk/algorithm/scan.hpp>
+#include <thrust/functional.h>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+namespace detail
+{
+
+
+// the number of unsigned ints of counters required by bucket_rank
+template<std::size_t num_buckets, std::size_t groupsize>
+struct bucket_rank_counters
+{
+  static const std::size_t size = (num_buckets + 1) * groupsize;
+};
+
+
+// bucket_rank finds where each of a group's elements goes when the elements are stably partitioned into buckets
+//
+// each agent owns the consecutive elements [grainsize * index, grainsize * index + local_size) of the group's
+// array, and buckets[j] < num_buckets names the bucket of its jth element
+// on return, ranks[j] is the position of the agent's jth element in the partitioned array,
+// and bucket_begin(counters, b) is the position of bucket b's first element
+//
+// counters must point to bucket_rank_counters<num_buckets,groupsize>::size unsigned ints visible to the whole group
+// the group must wait before counters is reused
+template<std::size_t num_buckets, std::size_t groupsize, std::size_t grainsize, typename Size>
+__device__
+void bucket_rank(bulk::concurrent_group<bulk::agent<grainsize>,groupsize> &g,
+                 const unsigned int buckets[grainsize],
+                 Size local_size,
+                 Size ranks[grainsize],
+                 unsigned int *counters)
+{
+  typedef typename bulk::concurrent_group<bulk::agent<grainsize>,groupsize>::size_type size_type;
+
+  size_type tid = g.this_exec.index();
+
+  // counters are laid out bucket-major so that a scan of the whole array yields, for each bucket and agent,
+  // the number of elements which precede that agent's elements of that bucket
+  for(size_type b = 0; b < num_buckets; ++b)
+  {
+    counters[b * groupsize + tid] = 0;
+  } // end for b
+
+  // each agent counts its own elements, so there is no contention
+  for(size_type j = 0; j < grainsize; ++j)
+  {
+    if(j < local_size)
+    {
+      ranks[j] = counters[buckets[j] * groupsize + tid]++;
+    } // end if
+  } // end for j
+
+  g.wait();
+
+  // each agent rakes num_buckets consecutive counters
+  unsigned int *rake = counters + tid * num_buckets;
+  unsigned int *rake_sums = counters + num_buckets * groupsize;
+
+  unsigned int sum = 0;
+  for(size_type b = 0; b < num_buckets; ++b)
+  {
+    sum += rake[b];
+  } // end for b
+
+  rake_sums[tid] = sum;
+
+  g.wait();
+
+  bulk::detail::scan_detail::inplace_exclusive_scan(g, rake_sums, 0u, thrust::plus<unsigned int>());
+
+  unsigned int prefix = rake_sums[tid];
+  for(size_type b = 0; b < num_buckets; ++b)
+  {
+    unsigned int count = rake[b];
+    rake[b] = prefix;
+    prefix += count;
+  } // end for b
+
+  g.wait();
+
+  for(size_type j = 0; j < grainsize; ++j)
+  {
+    if(j < local_size)
+    {
+      ranks[j] += counters[buckets[j] * groupsize + tid];
+    } // end if
+  } // end for j
+} // end bucket_rank()
+
+
+// the position of bucket b's first element after bucket_rank
+template<std::size_t groupsize>
+__device__
+unsigned int bucket_begin(const unsigned int *counters, unsigned int b)
+{
+  return counters[b * groupsize];
+} // end bucket_begin()
+
+
+} // end detail
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
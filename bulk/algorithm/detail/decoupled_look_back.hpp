@@ -0,0 +1,340 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/detail/alignment.hpp>
+#include <bulk/detail/guarded_cuda_runtime_api.hpp>
+#include <bulk/detail/throw_on_error.hpp>
+#include <thrust/functional.h>
+#include <thrust/detail/type_traits.h>
+#include <cstddef>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+namespace detail
+{
+namespace decoupled_look_back_detail
+{
+
+
+// the states of a tile's status flag
+// the flags start zeroed, so invalid must be zero
+enum tile_state
+{
+  invalid             = 0,
+  aggregate_available = 1,
+  prefix_available    = 2
+};
+
+
+template<typename T>
+struct volatile_word
+{
+  typedef typename thrust::detail::eval_if<
+    (sizeof(T) % sizeof(unsigned int) == 0) && (bulk::detail::alignment_of<T>::value % sizeof(unsigned int) == 0),
+    thrust::detail::identity_<unsigned int>,
+    thrust::detail::identity_<char>
+  >::type type;
+};
+
+
+// stores and loads which bypass the incoherent L1 so that other groups observe them
+// XXX these move T word by word, so T must be trivially copyable
+template<typename T>
+__device__
+void store_volatile(T *dst, const T &src)
+{
+  typedef typename volatile_word<T>::type word_type;
+
+  const word_type *src_words = reinterpret_cast<const word_type*>(&src);
+  volatile word_type *dst_words = reinterpret_cast<volatile word_type*>(dst);
+
+  for(unsigned int i = 0; i < sizeof(T) / sizeof(word_type); ++i)
+  {
+    dst_words[i] = src_words[i];
+  } // end for i
+} // end store_volatile()
+
+
+template<typename T>
+__device__
+T load_volatile(const T *src)
+{
+  typedef typename volatile_word<T>::type word_type;
+
+  T result;
+
+  const volatile word_type *src_words = reinterpret_cast<const volatile word_type*>(src);
+  word_type *dst_words = reinterpret_cast<word_type*>(&result);
+
+  for(unsigned int i = 0; i < sizeof(T) / sizeof(word_type); ++i)
+  {
+    dst_words[i] = src_words[i];
+  } // end for i
+
+  return result;
+} // end load_volatile()
+
+
+__host__ __device__
+inline std::size_t align_up(std::size_t offset, std::size_t alignment)
+{
+  return alignment * ((offset + alignment - 1) / alignment);
+} // end align_up()
+
+
+} // end decoupled_look_back_detail
+
+
+// tile_status tracks the progress of a single-pass, tile-by-tile algorithm in the style of
+// Merrill & Garland's decoupled look-back scan:
+// each tile publishes its aggregate as soon as it has reduced its own elements,
+// and its inclusive prefix as soon as it has learned the prefix of its predecessors
+// by looking back across the aggregates and prefixes already published
+//
+// tile indices are handed out in order by claim_tile(), so the predecessors of a claimed tile
+// have always been claimed by groups which are already running, and looking back never deadlocks,
+// no matter how many groups are resident
+//
+// the storage is a single allocation of storage_size(num_tiles) bytes whose first
+// initialized_size(num_tiles) bytes must be zeroed with reset() before each use
+template<typename T, typename Size>
+class tile_status
+{
+  public:
+    typedef T    value_type;
+    typedef Size size_type;
+
+    __host__ __device__
+    static std::size_t storage_size(size_type num_tiles)
+    {
+      return prefixes_offset(num_tiles) + num_tiles * sizeof(value_type);
+    } // end storage_size()
+
+    __host__ __device__
+    static std::size_t initialized_size(size_type num_tiles)
+    {
+      return flags_offset() + num_tiles * sizeof(int);
+    } // end initialized_size()
+
+    __host__ __device__
+    tile_status(void *storage, size_type num_tiles)
+      : m_counter(reinterpret_cast<unsigned int*>(storage)),
+        m_flags(reinterpret_cast<int*>(reinterpret_cast<char*>(storage) + flags_offset())),
+        m_aggregates(reinterpret_cast<value_type*>(reinterpret_cast<char*>(storage) + aggregates_offset(num_tiles))),
+        m_prefixes(reinterpret_cast<value_type*>(reinterpret_cast<char*>(storage) + prefixes_offset(num_tiles))),
+        m_num_tiles(num_tiles)
+    {}
+
+    // zeroes the tile counter and every tile's flag
+    // because this does not allocate, it may be recorded with bulk::capture
+    __host__
+    void reset(cudaStream_t s) const
+    {
+      bulk::detail::throw_on_error(cudaMemsetAsync(m_counter, 0, initialized_size(m_num_tiles), s),
+                                   "tile_status::reset(): after cudaMemsetAsync");
+    } // end reset()
+
+    __host__ __device__
+    size_type num_tiles() const
+    {
+      return m_num_tiles;
+    } // end num_tiles()
+
+    // returns the index of the next unclaimed tile, which may be >= num_tiles()
+    // only one agent of a group should claim a tile
+    __device__
+    size_type claim_tile() const
+    {
+      return atomicAdd(m_counter, 1u);
+    } // end claim_tile()
+
+    __device__
+    void publish_aggregate(size_type tile, const value_type &aggregate) const
+    {
+      decoupled_look_back_detail::store_volatile(m_aggregates + tile, aggregate);
+
+      // the aggregate must be visible before the flag which announces it
+      __threadfence();
+
+      store_flag(tile, decoupled_look_back_detail::aggregate_available);
+    } // end publish_aggregate()
+
+    __device__
+    void publish_prefix(size_type tile, const value_type &inclusive_prefix) const
+    {
+      decoupled_look_back_detail::store_volatile(m_prefixes + tile, inclusive_prefix);
+
+      __threadfence();
+
+      store_flag(tile, decoupled_look_back_detail::prefix_available);
+    } // end publish_prefix()
+
+    // returns the reduction of every tile preceding tile, which must be positive
+    // only one agent of a group should look back
+    // XXX this walks back one tile at a time; a warp could inspect 32 predecessors at once
+    template<typename BinaryFunction>
+    __device__
+    value_type exclusive_prefix(size_type tile, BinaryFunction binary_op) const
+    {
+      size_type predecessor = tile - 1;
+
+      int flag = wait_for_flag(predecessor);
+      value_type result = load_value(predecessor, flag);
+
+      while(flag != decoupled_look_back_detail::prefix_available)
+      {
+        --predecessor;
+
+        flag = wait_for_flag(predecessor);
+
+        // predecessors are visited in reverse order, so they go on the left
+        result = binary_op(load_value(predecessor, flag), result);
+      } // end while
+
+      return result;
+    } // end exclusive_prefix()
+
+  private:
+    __host__ __device__
+    static std::size_t flags_offset()
+    {
+      return decoupled_look_back_detail::align_up(sizeof(unsigned int), sizeof(int));
+    } // end flags_offset()
+
+    __host__ __device__
+    static std::size_t aggregates_offset(size_type num_tiles)
+    {
+      return decoupled_look_back_detail::align_up(initialized_size(num_tiles), bulk::detail::alignment_of<value_type>::value);
+    } // end aggregates_offset()
+
+    __host__ __device__
+    static std::size_t prefixes_offset(size_type num_tiles)
+    {
+      return decoupled_look_back_detail::align_up(aggregates_offset(num_tiles) + num_tiles * sizeof(value_type), bulk::detail::alignment_of<value_type>::value);
+    } // end prefixes_offset()
+
+    __device__
+    void store_flag(size_type tile, int flag) const
+    {
+      reinterpret_cast<volatile int*>(m_flags)[tile] = flag;
+    } // end store_flag()
+
+    __device__
+    int wait_for_flag(size_type tile) const
+    {
+      int flag = decoupled_look_back_detail::invalid;
+
+      while((flag = reinterpret_cast<volatile int*>(m_flags)[tile]) == decoupled_look_back_detail::invalid)
+      {
+#if __CUDA_ARCH__ >= 700
+        __nanosleep(32);
+#endif
+      } // end while
+
+      // don't read the value before the flag
+      __threadfence();
+
+      return flag;
+    } // end wait_for_flag()
+
+    __device__
+    value_type load_value(size_type tile, int flag) const
+    {
+      return flag == decoupled_look_back_detail::prefix_available ?
+        decoupled_look_back_detail::load_volatile(m_prefixes + tile) :
+        decoupled_look_back_detail::load_volatile(m_aggregates + tile);
+    } // end load_value()
+
+    unsigned int *m_counter;
+    int          *m_flags;
+    value_type   *m_aggregates;
+    value_type   *m_prefixes;
+    size_type     m_num_tiles;
+}; // end tile_status
+
+
+// no prefix precedes the results of a lone tile
+struct no_prefix
+{
+  template<typename ConcurrentGroup, typename Size>
+  __device__
+  Size operator()(ConcurrentGroup &, Size) const
+  {
+    return 0;
+  }
+};
+
+
+// counts the results of tiles which emit a data-dependent number of results, such as compactions:
+// a tile's results follow those of every tile before it, and the last tile records the total in count
+template<typename TileStatus>
+struct look_back_prefix
+{
+  typedef typename TileStatus::size_type size_type;
+
+  TileStatus status;
+  size_type  tile;
+  size_type  *count;
+
+  __device__
+  look_back_prefix(TileStatus status, size_type tile, size_type *count)
+    : status(status), tile(tile), count(count)
+  {}
+
+  template<typename ConcurrentGroup, typename Size>
+  __device__
+  Size operator()(ConcurrentGroup &g, Size aggregate) const
+  {
+    __shared__ size_type s_prefix;
+
+    if(g.this_exec.index() == 0)
+    {
+      size_type prefix = 0;
+
+      if(tile > 0)
+      {
+        status.publish_aggregate(tile, aggregate);
+
+        prefix = status.exclusive_prefix(tile, thrust::plus<size_type>());
+      } // end if
+
+      status.publish_prefix(tile, prefix + aggregate);
+
+      if(tile + 1 == status.num_tiles())
+      {
+        *count = prefix + aggregate;
+      } // end if
+
+      s_prefix = prefix;
+    } // end if
+
+    g.wait();
+
+    return s_prefix;
+  } // end operator()
+}; // end look_back_prefix
+
+
+} // end detail
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
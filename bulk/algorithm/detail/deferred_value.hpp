@@ -0,0 +1,97 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+namespace detail
+{
+
+
+// the value at ptr in device memory at the time the launch which reads it runs,
+// rather than at the time the launch is enqueued
+// this lets an algorithm's init come from the result of earlier work in the same stream
+// without a round trip through the host
+template<typename T>
+struct deferred_value
+{
+  typedef T value_type;
+
+  const T *ptr;
+}; // end deferred_value
+
+
+template<typename T>
+__host__ __device__
+deferred_value<T> make_deferred_value(const T *ptr)
+{
+  deferred_value<T> result = {ptr};
+  return result;
+} // end make_deferred_value()
+
+
+template<typename T>
+__host__ __device__
+const T &load_value(const T &x)
+{
+  return x;
+} // end load_value()
+
+
+template<typename T>
+__device__
+T load_value(const deferred_value<T> &x)
+{
+  return *x.ptr;
+} // end load_value()
+
+
+// converts an algorithm's init to its intermediate type, leaving deferred values to be converted once they're loaded
+template<typename Intermediate, typename T>
+struct converted_value
+{
+  typedef Intermediate type;
+
+  __host__ __device__
+  static type convert(const T &x)
+  {
+    return type(x);
+  }
+}; // end converted_value
+
+
+template<typename Intermediate, typename T>
+struct converted_value<Intermediate, deferred_value<T> >
+{
+  typedef deferred_value<T> type;
+
+  __host__ __device__
+  static type convert(const deferred_value<T> &x)
+  {
+    return x;
+  }
+}; // end converted_value
+
+
+} // end detail
+} // end bulk
+BULK_NAMESPACE_SUFFIX
@@ -0,0 +1,119 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/algorithm/merge.hpp>
+#include <thrust/iterator/counting_iterator.h>
+#include <thrust/functional.h>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+namespace detail
+{
+
+
+// load balancing over segments treats the ends of num_segments segments and the indices of
+// the num_items items they partition as two sorted lists, and merges them:
+// the end of segment s comes before item i exactly when segment s ends at or before i,
+// so the merge visits every item and every segment end in order
+//
+// cutting the merge into equal runs of diag gives every group the same amount of work,
+// however skewed the segments
+//
+// load_balance_split returns the number of segment ends which precede diag in the merge,
+// so the run beginning at diag begins with segment load_balance_split(...) and item diag - load_balance_split(...)
+template<typename RandomAccessIterator, typename Size>
+__device__
+Size load_balance_split(RandomAccessIterator segment_ends, Size num_segments, Size num_items, Size diag)
+{
+  return bulk::merge_path(segment_ends, num_segments,
+                          thrust::make_counting_iterator<Size>(0), num_items,
+                          diag,
+                          thrust::less<Size>());
+} // end load_balance_split()
+
+
+// like load_balance_split, but the items are numbered from first_item,
+// e.g. when the segment ends and items are a run of a larger merge
+template<typename RandomAccessIterator, typename Size>
+__device__
+Size load_balance_split(RandomAccessIterator segment_ends, Size num_segments, Size first_item, Size num_items, Size diag)
+{
+  return bulk::merge_path(segment_ends, num_segments,
+                          thrust::make_counting_iterator<Size>(first_item), num_items,
+                          diag,
+                          thrust::less<Size>());
+} // end load_balance_split()
+
+
+// returns true when the next step of a run of the merge visits a segment end rather than an item
+// segment_idx and item_idx count the segment ends and items the run has visited so far;
+// the run's items are numbered from first_item
+template<typename RandomAccessIterator, typename Size>
+__device__
+bool load_balance_visits_end(RandomAccessIterator segment_ends, Size segment_idx, Size num_segments, Size first_item, Size item_idx, Size num_items)
+{
+  return segment_idx < num_segments && (item_idx >= num_items || !(first_item + item_idx < Size(segment_ends[segment_idx])));
+} // end load_balance_visits_end()
+
+
+// walks num_steps steps of the merge beginning at diag, and calls f(segment, rank) for each item visited,
+// where rank is the item's position within its segment
+// the items are numbered from first_item, segment 0 begins at item segment_begin,
+// and segments are numbered from first_segment
+template<typename RandomAccessIterator, typename Size, typename Function>
+__device__
+void load_balance_walk(RandomAccessIterator segment_ends, Size num_segments,
+                       Size segment_begin,
+                       Size first_item, Size num_items,
+                       Size first_segment,
+                       Size diag, Size num_steps,
+                       Function &f)
+{
+  Size segment_idx = load_balance_split(segment_ends, num_segments, first_item, num_items, diag);
+  Size item_idx    = diag - segment_idx;
+
+  if(segment_idx > 0)
+  {
+    segment_begin = Size(segment_ends[segment_idx - 1]);
+  } // end if
+
+  for(Size k = 0; k < num_steps; ++k)
+  {
+    if(load_balance_visits_end(segment_ends, segment_idx, num_segments, first_item, item_idx, num_items))
+    {
+      // the next segment begins where this one ends
+      segment_begin = Size(segment_ends[segment_idx]);
+      ++segment_idx;
+    } // end if
+    else
+    {
+      f(first_segment + segment_idx, first_item + item_idx - segment_begin);
+      ++item_idx;
+    } // end else
+  } // end for k
+} // end load_balance_walk()
+
+
+} // end detail
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
@@ -0,0 +1,267 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/execution_policy.hpp>
+#include <bulk/malloc.hpp>
+#include <bulk/algorithm/copy.hpp>
+#include <bulk/algorithm/detail/bucket_rank.hpp>
+#include <thrust/detail/type_traits.h>
+#include <thrust/detail/minmax.h>
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+namespace detail
+{
+namespace radix_sort_detail
+{
+
+
+// each pass sorts by one digit of radix_bits bits
+static const unsigned int radix_bits = 4;
+static const unsigned int radix = 1 << radix_bits;
+
+
+// radix_key_traits maps a key to unsigned bits whose order as unsigned integers is the key's order
+template<typename Key> struct radix_key_traits;
+
+
+template<typename Unsigned>
+struct unsigned_radix_key_traits
+{
+  typedef Unsigned bits_type;
+
+  __device__
+  static bits_type to_bits(Unsigned key)
+  {
+    return key;
+  }
+};
+
+
+// flipping the sign bit sorts negative integers before positive ones
+template<typename Signed, typename Unsigned>
+struct signed_radix_key_traits
+{
+  typedef Unsigned bits_type;
+
+  __device__
+  static bits_type to_bits(Signed key)
+  {
+    return static_cast<bits_type>(key) ^ (bits_type(1) << (8 * sizeof(bits_type) - 1));
+  }
+};
+
+
+template<> struct radix_key_traits<unsigned char>      : unsigned_radix_key_traits<unsigned char> {};
+template<> struct radix_key_traits<unsigned short>     : unsigned_radix_key_traits<unsigned short> {};
+template<> struct radix_key_traits<unsigned int>       : unsigned_radix_key_traits<unsigned int> {};
+template<> struct radix_key_traits<unsigned long>      : unsigned_radix_key_traits<unsigned long> {};
+template<> struct radix_key_traits<unsigned long long> : unsigned_radix_key_traits<unsigned long long> {};
+
+// XXX plain char is omitted because its signedness varies
+template<> struct radix_key_traits<signed char> : signed_radix_key_traits<signed char, unsigned char> {};
+template<> struct radix_key_traits<short>       : signed_radix_key_traits<short, unsigned short> {};
+template<> struct radix_key_traits<int>         : signed_radix_key_traits<int, unsigned int> {};
+template<> struct radix_key_traits<long>        : signed_radix_key_traits<long, unsigned long> {};
+template<> struct radix_key_traits<long long>   : signed_radix_key_traits<long long, unsigned long long> {};
+
+
+// negative floating point numbers have all of their bits flipped so that they sort in reverse
+// positive numbers have only their sign bit flipped so that they sort after negative ones
+template<>
+struct radix_key_traits<float>
+{
+  typedef unsigned int bits_type;
+
+  __device__
+  static bits_type to_bits(float key)
+  {
+    bits_type bits = __float_as_uint(key);
+    bits_type mask = (bits & 0x80000000u) ? 0xffffffffu : 0x80000000u;
+    return bits ^ mask;
+  }
+};
+
+
+template<>
+struct radix_key_traits<double>
+{
+  typedef unsigned long long bits_type;
+
+  __device__
+  static bits_type to_bits(double key)
+  {
+    bits_type bits = static_cast<bits_type>(__double_as_longlong(key));
+    bits_type mask = (bits & 0x8000000000000000ull) ? 0xffffffffffffffffull : 0x8000000000000000ull;
+    return bits ^ mask;
+  }
+};
+
+
+// the digit of key comprising the num_bits bits beginning at shift
+template<typename Key>
+__device__
+unsigned int digit(const Key &key, unsigned int shift, unsigned int num_bits)
+{
+  return static_cast<unsigned int>(radix_key_traits<Key>::to_bits(key) >> shift) & ((1u << num_bits) - 1);
+} // end digit()
+
+
+template<std::size_t tile_size, std::size_t groupsize, typename KeyType, typename ValType>
+struct stage
+{
+  union
+  {
+    KeyType keys[tile_size];
+    ValType values[tile_size];
+  };
+
+  unsigned int counters[bucket_rank_counters<radix,groupsize>::size];
+}; // end stage
+
+
+// sorts the bits [begin_bit, end_bit) of each key
+// when has_values is false, values_first is ignored
+template<bool has_values,
+         std::size_t bound, std::size_t groupsize, std::size_t grainsize,
+         typename RandomAccessIterator1,
+         typename RandomAccessIterator2>
+__device__
+typename thrust::detail::enable_if<
+  bound <= groupsize * grainsize
+>::type
+radix_sort_by_key(bulk::bounded<bound,bulk::concurrent_group<bulk::agent<grainsize>,groupsize> > &g,
+                  RandomAccessIterator1 keys_first, RandomAccessIterator1 keys_last,
+                  RandomAccessIterator2 values_first,
+                  int begin_bit, int end_bit)
+{
+  typedef typename thrust::iterator_value<RandomAccessIterator1>::type key_type;
+  typedef typename thrust::iterator_value<RandomAccessIterator2>::type value_type;
+
+  typedef typename bulk::agent<grainsize>::size_type size_type;
+
+  size_type n = keys_last - keys_first;
+  const size_type tile_size = groupsize * grainsize;
+
+  size_type local_offset = grainsize * g.this_exec.index();
+  size_type local_size = thrust::max<size_type>(0, thrust::min<size_type>(grainsize, n - local_offset));
+
+  typedef radix_sort_detail::stage<tile_size,groupsize,key_type,value_type> stage_type;
+
+#if __CUDA_ARCH__ >= 200
+  stage_type *stage = static_cast<stage_type*>(bulk::malloc(g, sizeof(stage_type)));
+#else
+  __shared__ stage_type s_stage;
+  stage_type *stage = &s_stage;
+#endif
+
+  // load each agent's keys into registers
+  bulk::copy_n(bulk::bound<tile_size>(g), keys_first, n, stage->keys);
+
+  key_type local_keys[grainsize];
+  bulk::copy_n(bulk::bound<grainsize>(g.this_exec), stage->keys + local_offset, local_size, local_keys);
+
+  value_type local_values[grainsize];
+
+  if(has_values)
+  {
+    g.wait();
+
+    bulk::copy_n(bulk::bound<tile_size>(g), values_first, n, stage->values);
+
+    bulk::copy_n(bulk::bound<grainsize>(g.this_exec), stage->values + local_offset, local_size, local_values);
+  } // end if
+
+  for(int shift = begin_bit; shift < end_bit; shift += radix_bits)
+  {
+    unsigned int num_bits = thrust::min<int>(int(radix_bits), end_bit - shift);
+
+    unsigned int buckets[grainsize];
+    for(size_type j = 0; j < grainsize; ++j)
+    {
+      if(j < local_size)
+      {
+        buckets[j] = radix_sort_detail::digit(local_keys[j], shift, num_bits);
+      } // end if
+    } // end for j
+
+    size_type ranks[grainsize];
+    bulk::detail::bucket_rank<radix>(g, buckets, local_size, ranks, stage->counters);
+
+    // scatter the keys to their ranks and reload them in order
+    for(size_type j = 0; j < grainsize; ++j)
+    {
+      if(j < local_size)
+      {
+        stage->keys[ranks[j]] = local_keys[j];
+      } // end if
+    } // end for j
+
+    g.wait();
+
+    bulk::copy_n(bulk::bound<grainsize>(g.this_exec), stage->keys + local_offset, local_size, local_keys);
+
+    g.wait();
+
+    if(has_values)
+    {
+      for(size_type j = 0; j < grainsize; ++j)
+      {
+        if(j < local_size)
+        {
+          stage->values[ranks[j]] = local_values[j];
+        } // end if
+      } // end for j
+
+      g.wait();
+
+      bulk::copy_n(bulk::bound<grainsize>(g.this_exec), stage->values + local_offset, local_size, local_values);
+
+      g.wait();
+    } // end if
+  } // end for shift
+
+  // store the sorted keys back to the input
+  bulk::copy_n(bulk::bound<grainsize>(g.this_exec), local_keys, local_size, stage->keys + local_offset);
+  g.wait();
+
+  bulk::copy_n(bulk::bound<tile_size>(g), stage->keys, n, keys_first);
+
+  if(has_values)
+  {
+    // store the sorted values back to the input
+    bulk::copy_n(bulk::bound<grainsize>(g.this_exec), local_values, local_size, stage->values + local_offset);
+    g.wait();
+
+    bulk::copy_n(bulk::bound<tile_size>(g), stage->values, n, values_first);
+  } // end if
+
+#if __CUDA_ARCH__ >= 200
+  bulk::free(g, stage);
+#endif
+} // end radix_sort_by_key()
+
+
+} // end radix_sort_detail
+} // end detail
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
@@ -153,23 +153,25 @@ stable_merge_sort_by_key(bulk::bounded<bound,bulk::concurrent_group<bulk::agent<
     value_type *values;
   } stage;
 
-  stage.keys = static_cast<key_type*>(bulk::malloc(g, tile_size * thrust::max(sizeof(key_type), sizeof(value_type))));
+  // the stage holds at most bound elements
+  stage.keys = static_cast<key_type*>(bulk::malloc(g, bound * thrust::max(sizeof(key_type), sizeof(value_type))));
 #else
   __shared__ union
   {
-    key_type   keys[tile_size];
-    value_type values[tile_size];
+    key_type   keys[bound];
+    value_type values[bound];
   } stage;
 #endif
   
+  // the staged copies are bounded by g's bound rather than the whole tile, so a smaller bound visits fewer rows
   // load each agent's keys into registers
-  bulk::copy_n(bulk::bound<tile_size>(g), keys_first, n, stage.keys);
+  bulk::copy_n(g, keys_first, n, stage.keys);
 
   key_type local_keys[grainsize];
   bulk::copy_n(bulk::bound<grainsize>(g.this_exec), stage.keys + local_offset, local_size, local_keys);
 
   // load each agent's values into registers
-  bulk::copy_n(bulk::bound<tile_size>(g), values_first, n, stage.values);
+  bulk::copy_n(g, values_first, n, stage.values);
 
   value_type local_values[grainsize];
   bulk::copy_n(bulk::bound<grainsize>(g.this_exec), stage.values + local_offset, local_size, local_values);
@@ -192,13 +194,13 @@ stable_merge_sort_by_key(bulk::bounded<bound,bulk::concurrent_group<bulk::agent<
   bulk::copy_n(bulk::bound<grainsize>(g.this_exec), local_keys, local_size, stage.keys + local_offset);
   g.wait();
 
-  bulk::copy_n(bulk::bound<tile_size>(g), stage.keys, n, keys_first);
+  bulk::copy_n(g, stage.keys, n, keys_first);
   
   // store the sorted values back to the input
   bulk::copy_n(bulk::bound<grainsize>(g.this_exec), local_values, local_size, stage.values + local_offset);
   g.wait();
 
-  bulk::copy_n(bulk::bound<tile_size>(g), stage.values, n, values_first);
+  bulk::copy_n(g, stage.values, n, values_first);
 
 #if __CUDA_ARCH__ >= 200
   bulk::free(g, stage.keys);
@@ -0,0 +1,182 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/detail/tuple_meta_transform.hpp>
+#include <bulk/detail/alignment.hpp>
+#include <thrust/tuple.h>
+#include <thrust/iterator/zip_iterator.h>
+#include <thrust/detail/type_traits.h>
+#include <cstddef>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+namespace detail
+{
+namespace staging_detail
+{
+
+
+template<typename T>
+struct pointer_to
+{
+  typedef T* type;
+}; // end pointer_to
+
+
+// each component's array begins on a vector boundary
+inline __host__ __device__
+std::size_t align_up(std::size_t num_bytes)
+{
+  return (num_bytes + max_vector_alignment - 1) / max_vector_alignment * max_vector_alignment;
+} // end align_up()
+
+
+// lays out one array per component of Tuple, in order
+template<typename Tuple, unsigned int i = 0, unsigned int size = thrust::tuple_size<Tuple>::value>
+struct soa_layout
+{
+  typedef typename thrust::tuple_element<i,Tuple>::type element_type;
+  typedef soa_layout<Tuple,i+1,size>                    rest;
+
+  template<std::size_t n>
+  struct static_storage_size
+  {
+    static const std::size_t value = (n * sizeof(element_type) + max_vector_alignment - 1) / max_vector_alignment * max_vector_alignment
+                                   + rest::template static_storage_size<n>::value;
+  };
+
+  __host__ __device__
+  static std::size_t storage_size(std::size_t n)
+  {
+    return align_up(n * sizeof(element_type)) + rest::storage_size(n);
+  }
+
+  template<typename PointerTuple>
+  __host__ __device__
+  static void carve(char *storage, std::size_t n, PointerTuple &result)
+  {
+    thrust::get<i>(result) = reinterpret_cast<element_type*>(storage);
+    rest::carve(storage + align_up(n * sizeof(element_type)), n, result);
+  }
+}; // end soa_layout
+
+
+template<typename Tuple, unsigned int size>
+struct soa_layout<Tuple,size,size>
+{
+  template<std::size_t n>
+  struct static_storage_size
+  {
+    static const std::size_t value = 0;
+  };
+
+  __host__ __device__
+  static std::size_t storage_size(std::size_t)
+  {
+    return 0;
+  }
+
+  template<typename PointerTuple>
+  __host__ __device__
+  static void carve(char *, std::size_t, PointerTuple &)
+  {}
+}; // end soa_layout
+
+
+template<typename T>
+struct is_tuple
+  : thrust::detail::false_type
+{};
+
+
+template<typename T0, typename T1, typename T2, typename T3, typename T4,
+         typename T5, typename T6, typename T7, typename T8, typename T9>
+struct is_tuple<thrust::tuple<T0,T1,T2,T3,T4,T5,T6,T7,T8,T9> >
+  : thrust::detail::true_type
+{};
+
+
+} // end staging_detail
+
+
+// stage<T> stages n values of type T in on-chip memory
+// by default, the values are stored contiguously
+template<typename T, bool = staging_detail::is_tuple<T>::value>
+struct stage
+{
+  typedef T* iterator;
+
+  template<std::size_t n>
+  struct static_storage_size
+  {
+    static const std::size_t value = n * sizeof(T);
+  };
+
+  __host__ __device__
+  static std::size_t storage_size(std::size_t n)
+  {
+    return n * sizeof(T);
+  }
+
+  __host__ __device__
+  static iterator make(void *storage, std::size_t)
+  {
+    return reinterpret_cast<T*>(storage);
+  }
+}; // end stage
+
+
+// tuples, e.g. the values of zip_iterators, are staged as a structure of arrays:
+// each component lives in its own array, so that accesses to the stage don't conflict over
+// banks or straddle words when the components' widths differ, and so that each component
+// may be copied to & from the stage on its own
+template<typename T>
+struct stage<T,true>
+{
+  typedef typename tuple_meta_transform<T,staging_detail::pointer_to>::type pointer_tuple;
+  typedef thrust::zip_iterator<pointer_tuple>                                iterator;
+
+  template<std::size_t n>
+  struct static_storage_size
+    : staging_detail::soa_layout<T>::template static_storage_size<n>
+  {};
+
+  __host__ __device__
+  static std::size_t storage_size(std::size_t n)
+  {
+    return staging_detail::soa_layout<T>::storage_size(n);
+  }
+
+  __host__ __device__
+  static iterator make(void *storage, std::size_t n)
+  {
+    pointer_tuple pointers;
+    staging_detail::soa_layout<T>::carve(reinterpret_cast<char*>(storage), n, pointers);
+    return iterator(pointers);
+  }
+}; // end stage
+
+
+} // end detail
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
@@ -0,0 +1,144 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/execution_policy.hpp>
+#include <bulk/malloc.hpp>
+#include <bulk/iterator/strided_iterator.hpp>
+#include <bulk/detail/is_contiguous_iterator.hpp>
+#include <bulk/detail/alignment.hpp>
+#include <thrust/detail/type_traits.h>
+#include <thrust/detail/raw_pointer_cast.h>
+#include <thrust/detail/minmax.h>
+#include <thrust/iterator/iterator_traits.h>
+#include <cstddef>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+namespace detail
+{
+namespace strided_staging_detail
+{
+
+
+// strides up to this many bytes are staged: past a 32-byte sector
+// every strided access touches a sector of its own anyway
+const std::size_t max_staged_stride_bytes = 2 * max_vector_alignment;
+
+
+template<typename Iterator>
+struct is_stageable
+  : thrust::detail::false_type
+{};
+
+
+template<typename Iterator, typename Size>
+struct is_stageable<strided_iterator<Iterator,Size> >
+  : is_contiguous_iterator<Iterator>
+{};
+
+
+} // end strided_staging_detail
+
+
+// a strided_iterator over contiguous storage may be read through a stage in on-chip memory
+template<typename Iterator>
+struct is_stageable_strided_iterator
+  : strided_staging_detail::is_stageable<Iterator>
+{};
+
+
+// visits the n values [first, first + n) as visitor(i, first[i]), by staging the contiguous
+// span they cover through on-chip memory one tile at a time: the agents of g load the tile's
+// span coalesced, then read their strided values back out of the stage (i.e., a tile transpose)
+// returns false without visiting anything when the stride is too wide or the stage doesn't fit in the group's on-chip heap
+// the decision is the same for every agent of g
+template<std::size_t groupsize,
+         std::size_t grainsize,
+         typename Iterator,
+         typename StrideSize,
+         typename Size,
+         typename Visitor>
+__device__
+bool try_staged_strided_visit_n(bulk::concurrent_group<bulk::agent<grainsize>,groupsize> &g,
+                                strided_iterator<Iterator,StrideSize> first,
+                                Size n,
+                                Visitor visitor)
+{
+#if __CUDA_ARCH__ >= 200
+  typedef typename thrust::detail::remove_const<
+    typename thrust::iterator_value<Iterator>::type
+  >::type value_type;
+
+  const Size stride = first.stride();
+
+  if(stride <= 1 || stride * sizeof(value_type) > strided_staging_detail::max_staged_stride_bytes) return false;
+
+  const Size tile_size = g.size() * grainsize;
+
+  // too short to repay the stage
+  if(n * stride < tile_size) return false;
+
+  // a stage in global memory would defeat its purpose, so this falls back when the tile doesn't fit on chip
+  value_type *stage = reinterpret_cast<value_type*>(bulk::detail::group_on_chip_malloc(g, tile_size * sizeof(value_type)));
+
+  if(stage == 0) return false;
+
+  const value_type *span = thrust::raw_pointer_cast(&*first.base());
+  const Size span_size = (n - 1) * stride + 1;
+
+  const Size tid = g.this_exec.index();
+
+  for(Size tile_offset = 0; tile_offset < span_size; tile_offset += tile_size)
+  {
+    const Size m = thrust::min<Size>(tile_size, span_size - tile_offset);
+
+    for(Size i = tid; i < m; i += g.size())
+    {
+      stage[i] = span[tile_offset + i];
+    } // end for i
+
+    g.wait();
+
+    // the strided values which fall inside this tile
+    const Size first_value = (tile_offset + stride - 1) / stride;
+    const Size last_value  = (tile_offset + m + stride - 1) / stride;
+
+    for(Size i = first_value + tid; i < last_value; i += g.size())
+    {
+      visitor(i, stage[i * stride - tile_offset]);
+    } // end for i
+
+    g.wait();
+  } // end for tile_offset
+
+  bulk::free(g, stage);
+
+  return true;
+#else
+  return false;
+#endif
+} // end try_staged_strided_visit_n()
+
+
+} // end detail
+} // end bulk
+BULK_NAMESPACE_SUFFIX
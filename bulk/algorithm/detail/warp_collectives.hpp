@@ -0,0 +1,417 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/uninitialized.hpp>
+#include <thrust/detail/minmax.h>
+#include <cstring>
+
+
+// shuffles arrived with sm_30
+#if defined(__CUDA_ARCH__) && (__CUDA_ARCH__ >= 300)
+#  define __BULK_HAS_SHUFFLE__ 1
+#else
+#  define __BULK_HAS_SHUFFLE__ 0
+#endif
+
+
+// votes arrived with sm_20
+#if defined(__CUDA_ARCH__) && (__CUDA_ARCH__ >= 200)
+#  define __BULK_HAS_BALLOT__ 1
+#else
+#  define __BULK_HAS_BALLOT__ 0
+#endif
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+namespace detail
+{
+namespace warp_detail
+{
+
+
+static const unsigned int warp_size = 32;
+
+// the largest group, 1024 agents, comprises 32 warps
+static const unsigned int max_num_warps = 32;
+
+
+// the words of an object as they travel through a shuffle
+template<typename T>
+struct shuffle_words
+{
+  static const unsigned int size = (sizeof(T) + sizeof(int) - 1) / sizeof(int);
+
+  int words[size];
+};
+
+
+#if __BULK_HAS_SHUFFLE__
+#  if defined(CUDART_VERSION) && (CUDART_VERSION >= 9000)
+#    define __BULK_SHFL_UP__(x,delta)   __shfl_up_sync(0xffffffff, x, delta)
+#    define __BULK_SHFL_DOWN__(x,delta) __shfl_down_sync(0xffffffff, x, delta)
+#    define __BULK_SHFL__(x,lane)       __shfl_sync(0xffffffff, x, lane)
+#  else
+#    define __BULK_SHFL_UP__(x,delta)   __shfl_up(x, delta)
+#    define __BULK_SHFL_DOWN__(x,delta) __shfl_down(x, delta)
+#    define __BULK_SHFL__(x,lane)       __shfl(x, lane)
+#  endif
+#endif
+
+
+#if __BULK_HAS_BALLOT__
+#  if defined(CUDART_VERSION) && (CUDART_VERSION >= 9000)
+#    define __BULK_BALLOT__(p) __ballot_sync(0xffffffff, p)
+#  else
+#    define __BULK_BALLOT__(p) __ballot(p)
+#  endif
+#endif
+
+
+// these shuffles require every lane of the warp to participate
+template<typename T>
+__device__ __forceinline__
+T shuffle_up(const T &x, unsigned int delta)
+{
+#if __BULK_HAS_SHUFFLE__
+  shuffle_words<T> in, out;
+  std::memcpy(in.words, &x, sizeof(T));
+
+  for(unsigned int i = 0; i < shuffle_words<T>::size; ++i)
+  {
+    out.words[i] = __BULK_SHFL_UP__(in.words[i], delta);
+  } // end for i
+
+  T result;
+  std::memcpy(&result, out.words, sizeof(T));
+  return result;
+#else
+  return x;
+#endif
+} // end shuffle_up()
+
+
+template<typename T>
+__device__ __forceinline__
+T shuffle_down(const T &x, unsigned int delta)
+{
+#if __BULK_HAS_SHUFFLE__
+  shuffle_words<T> in, out;
+  std::memcpy(in.words, &x, sizeof(T));
+
+  for(unsigned int i = 0; i < shuffle_words<T>::size; ++i)
+  {
+    out.words[i] = __BULK_SHFL_DOWN__(in.words[i], delta);
+  } // end for i
+
+  T result;
+  std::memcpy(&result, out.words, sizeof(T));
+  return result;
+#else
+  return x;
+#endif
+} // end shuffle_down()
+
+
+template<typename T>
+__device__ __forceinline__
+T shuffle(const T &x, unsigned int src_lane)
+{
+#if __BULK_HAS_SHUFFLE__
+  shuffle_words<T> in, out;
+  std::memcpy(in.words, &x, sizeof(T));
+
+  for(unsigned int i = 0; i < shuffle_words<T>::size; ++i)
+  {
+    out.words[i] = __BULK_SHFL__(in.words[i], src_lane);
+  } // end for i
+
+  T result;
+  std::memcpy(&result, out.words, sizeof(T));
+  return result;
+#else
+  return x;
+#endif
+} // end shuffle()
+
+
+// reduces the values of lanes [0, n) into lane 0
+template<typename T, typename BinaryFunction>
+__device__ __forceinline__
+T warp_reduce(T x, unsigned int lane, unsigned int n, BinaryFunction binary_op)
+{
+  for(unsigned int offset = warp_size / 2; offset > 0; offset /= 2)
+  {
+    T y = shuffle_down(x, offset);
+
+    if(lane + offset < n)
+    {
+      x = binary_op(x, y);
+    } // end if
+  } // end for offset
+
+  return x;
+} // end warp_reduce()
+
+
+// returns the inclusive scan of the warp's values in each lane
+template<typename T, typename BinaryFunction>
+__device__ __forceinline__
+T warp_inclusive_scan(T x, unsigned int lane, BinaryFunction binary_op)
+{
+  for(unsigned int offset = 1; offset < warp_size; offset += offset)
+  {
+    T y = shuffle_up(x, offset);
+
+    if(lane >= offset)
+    {
+      x = binary_op(y, x);
+    } // end if
+  } // end for offset
+
+  return x;
+} // end warp_inclusive_scan()
+
+
+} // end warp_detail
+
+
+// groups whose agents fill whole warps may use collectives built on shuffles
+template<typename ConcurrentGroup>
+__device__ __forceinline__
+bool has_warp_collectives(const ConcurrentGroup &g)
+{
+#if __BULK_HAS_SHUFFLE__
+  return g.size() > 0 && g.size() % warp_detail::warp_size == 0;
+#else
+  return false;
+#endif
+} // end has_warp_collectives()
+
+
+// groups whose agents fill whole warps may count flags with ballots
+template<typename ConcurrentGroup>
+__device__ __forceinline__
+bool has_warp_ballot(const ConcurrentGroup &g)
+{
+#if __BULK_HAS_BALLOT__
+  return g.size() > 0 && g.size() % warp_detail::warp_size == 0;
+#else
+  return false;
+#endif
+} // end has_warp_ballot()
+
+
+// returns to every agent the reduction of init with x from agents [0, n)
+// each warp reduces with shuffles, so that only the warps' sums go through shared memory
+// requires has_warp_collectives(g)
+template<typename ConcurrentGroup, typename T, typename Size, typename BinaryFunction>
+__device__
+T warp_collective_reduce(ConcurrentGroup &g, T x, Size n, T init, BinaryFunction binary_op)
+{
+  using namespace warp_detail;
+
+  __shared__ uninitialized_array<T, max_num_warps> s_warp_sums;
+
+  typedef typename ConcurrentGroup::size_type size_type;
+
+  size_type tid  = g.this_exec.index();
+  size_type lane = tid % warp_size;
+  size_type warp = tid / warp_size;
+
+  size_type warp_begin = warp * warp_size;
+
+  // the condition is uniform across each warp
+  if(warp_begin < n)
+  {
+    x = warp_reduce(x, lane, thrust::min<size_type>(warp_size, n - warp_begin), binary_op);
+
+    if(lane == 0)
+    {
+      s_warp_sums[warp] = x;
+    } // end if
+  } // end if
+
+  g.wait();
+
+  size_type num_warps = (thrust::min<size_type>(n, g.size()) + warp_size - 1) / warp_size;
+
+  if(warp == 0)
+  {
+    T y = lane < num_warps ? T(s_warp_sums[lane]) : init;
+
+    y = warp_reduce(y, lane, num_warps, binary_op);
+
+    if(lane == 0)
+    {
+      s_warp_sums[0] = (num_warps > 0) ? binary_op(init, y) : init;
+    } // end if
+  } // end if
+
+  g.wait();
+
+  T result = s_warp_sums[0];
+
+  g.wait();
+
+  return result;
+} // end warp_collective_reduce()
+
+
+// exclusive scans first[0, n) in place and returns the reduction of init with the inputs
+// each warp scans with shuffles, so that only the warps' sums go through shared memory
+// requires has_warp_collectives(g) and n <= g.size()
+template<typename ConcurrentGroup, typename RandomAccessIterator, typename Size, typename T, typename BinaryFunction>
+__device__
+T warp_collective_inplace_exclusive_scan(ConcurrentGroup &g, RandomAccessIterator first, Size n, T init, BinaryFunction binary_op)
+{
+  using namespace warp_detail;
+
+  __shared__ uninitialized_array<T, max_num_warps> s_warp_sums;
+
+  typedef typename ConcurrentGroup::size_type size_type;
+
+  size_type tid  = g.this_exec.index();
+  size_type lane = tid % warp_size;
+  size_type warp = tid / warp_size;
+
+  size_type warp_begin = warp * warp_size;
+
+  T x = tid < n ? T(first[tid]) : init;
+
+  if(tid == 0 && n > 0)
+  {
+    x = binary_op(init, x);
+  } // end if
+
+  x = warp_inclusive_scan(x, lane, binary_op);
+
+  // the last valid lane of each warp publishes the warp's sum
+  if(warp_begin < n && lane == thrust::min<size_type>(warp_size, n - warp_begin) - 1)
+  {
+    s_warp_sums[warp] = x;
+  } // end if
+
+  g.wait();
+
+  size_type num_warps = (n + warp_size - 1) / warp_size;
+
+  if(warp == 0)
+  {
+    T y = lane < num_warps ? T(s_warp_sums[lane]) : init;
+
+    y = warp_inclusive_scan(y, lane, binary_op);
+
+    if(lane < num_warps)
+    {
+      s_warp_sums[lane] = y;
+    } // end if
+  } // end if
+
+  g.wait();
+
+  T carry = warp > 0 ? T(s_warp_sums[warp - 1]) : init;
+
+  T inclusive = warp > 0 ? binary_op(carry, x) : x;
+
+  // shift the inclusive scan to the right by a lane
+  T exclusive = shuffle_up(inclusive, 1);
+
+  if(lane == 0)
+  {
+    exclusive = carry;
+  } // end if
+
+  T result = num_warps > 0 ? T(s_warp_sums[num_warps - 1]) : init;
+
+  // every agent has loaded its input, so there's no need to wait before storing
+  if(tid < n)
+  {
+    first[tid] = exclusive;
+  } // end if
+
+  g.wait();
+
+  return result;
+} // end warp_collective_inplace_exclusive_scan()
+
+
+// returns atomicAdd(counters + key, 1u), but issues a single atomic for each distinct key among the warp's active lanes
+// the lanes which share a key receive consecutive values in lane order
+// unlike the collectives above, it needn't be called by every lane of the warp
+__device__ __forceinline__
+unsigned int warp_aggregated_increment(unsigned int *counters, unsigned int key)
+{
+#if __BULK_HAS_SHUFFLE__
+#  if defined(CUDART_VERSION) && (CUDART_VERSION >= 9000)
+  const unsigned int active = __activemask();
+#    define __BULK_ACTIVE_SHFL__(x,lane)   __shfl_sync(active, x, lane)
+#    define __BULK_ACTIVE_BALLOT__(p)      __ballot_sync(active, p)
+#  else
+  const unsigned int active = __ballot(1);
+#    define __BULK_ACTIVE_SHFL__(x,lane)   __shfl(x, lane)
+#    define __BULK_ACTIVE_BALLOT__(p)      __ballot(p)
+#  endif
+
+  const unsigned int lane = threadIdx.x % warp_detail::warp_size;
+  const unsigned int lanes_before = (1u << lane) - 1;
+
+  unsigned int result = 0;
+
+  // each round serves the lanes which share the key of the lowest lane yet to be served
+  for(unsigned int remaining = active; remaining; )
+  {
+    unsigned int leader = __ffs(remaining) - 1;
+
+    unsigned int leader_key = __BULK_ACTIVE_SHFL__(key, leader);
+
+    unsigned int peers = __BULK_ACTIVE_BALLOT__(key == leader_key) & remaining;
+
+    unsigned int base = 0;
+    if(lane == leader)
+    {
+      base = atomicAdd(counters + key, __popc(peers));
+    } // end if
+
+    base = __BULK_ACTIVE_SHFL__(base, leader);
+
+    if(peers & (1u << lane))
+    {
+      result = base + __popc(peers & lanes_before);
+    } // end if
+
+    remaining &= ~peers;
+  } // end for
+
+#  undef __BULK_ACTIVE_SHFL__
+#  undef __BULK_ACTIVE_BALLOT__
+
+  return result;
+#else
+  return atomicAdd(counters + key, 1u);
+#endif
+} // end warp_aggregated_increment()
+
+
+} // end detail
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
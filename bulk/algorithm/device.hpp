@@ -0,0 +1,30 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/algorithm/device/reduce.hpp>
+#include <bulk/algorithm/device/scan.hpp>
+#include <bulk/algorithm/device/segmented.hpp>
+#include <bulk/algorithm/device/copy_if.hpp>
+#include <bulk/algorithm/device/set_operations.hpp>
+#include <bulk/algorithm/device/histogram.hpp>
+#include <bulk/algorithm/device/reduce_by_key.hpp>
+#include <bulk/algorithm/device/streaming.hpp>
+#include <bulk/algorithm/device/batched.hpp>
+#include <bulk/algorithm/device/load_balanced_for_each.hpp>
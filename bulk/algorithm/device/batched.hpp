@@ -0,0 +1,381 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/execution_policy.hpp>
+#include <bulk/async.hpp>
+#include <bulk/memory_pool.hpp>
+#include <bulk/algorithm/sort.hpp>
+#include <bulk/algorithm/merge.hpp>
+#include <bulk/algorithm/copy.hpp>
+#include <bulk/algorithm/device/segmented.hpp>
+#include <bulk/algorithm/detail/warp_collectives.hpp>
+#include <bulk/detail/guarded_cuda_runtime_api.hpp>
+#include <bulk/detail/throw_on_error.hpp>
+#include <thrust/iterator/iterator_traits.h>
+#include <thrust/detail/minmax.h>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+namespace detail
+{
+namespace batched_detail
+{
+
+
+template<std::size_t groupsize_, std::size_t grainsize_>
+struct size_class
+{
+  static const std::size_t groupsize = groupsize_;
+  static const std::size_t grainsize = grainsize_;
+  static const std::size_t bound     = groupsize * grainsize;
+
+  // enough groups to fill each multiprocessor with threads
+  template<typename Size>
+  static Size num_groups(Size num_problems)
+  {
+    Size groups_per_multiprocessor = thrust::max<Size>(1, 2048 / groupsize);
+
+    return thrust::max<Size>(1, thrust::min<Size>(num_problems, groups_per_multiprocessor * bulk::concurrent_group<>::hardware_concurrency()));
+  }
+
+  template<typename Key, typename Value>
+  static int heap_size()
+  {
+    // the merges' indices may outweigh small keys & values
+    return bound * thrust::max(thrust::max(sizeof(Key), sizeof(Value)), sizeof(int)) + 16;
+  }
+}; // end size_class
+
+
+// each problem is sorted by a single group of the smallest class whose bound holds it
+// the smallest are a warp each
+typedef size_class< 32, 4> class0;
+typedef size_class<128, 5> class1;
+typedef size_class<256, 7> class2;
+typedef size_class<256,11> class3;
+typedef size_class<512,11> class4;
+
+// problems beyond every bound are sorted a tile at a time, then merged through a scratch buffer
+typedef size_class<256,11> large_class;
+
+static const int num_classes = 6;
+
+
+template<typename Size>
+__host__ __device__
+int classify(Size n)
+{
+  return n <= Size(class0::bound) ? 0 :
+         n <= Size(class1::bound) ? 1 :
+         n <= Size(class2::bound) ? 2 :
+         n <= Size(class3::bound) ? 3 :
+         n <= Size(class4::bound) ? 4 :
+                                    5;
+} // end classify()
+
+
+// appends each problem to the bin of its class
+// problems of fewer than two elements are already sorted
+struct bin_problems
+{
+  template<typename RandomAccessIterator>
+  __device__
+  void operator()(bulk::agent<> &self, RandomAccessIterator offsets_first, unsigned int num_problems, unsigned int *counts, unsigned int *bins)
+  {
+    unsigned int i = self.index();
+
+    typename thrust::iterator_value<RandomAccessIterator>::type n = offsets_first[i+1] - offsets_first[i];
+
+    if(n < 2) return;
+
+    int c = classify(n);
+
+    // problems of the same class are usually neighbors, so a warp mostly shares its atomics
+    unsigned int j = bulk::detail::warp_aggregated_increment(counts, c);
+
+    bins[c * num_problems + j] = i;
+  } // end operator()
+}; // end bin_problems
+
+
+// the groups stride through the bin of their class
+struct sort_bin
+{
+  template<std::size_t groupsize, std::size_t grainsize, typename RandomAccessIterator1, typename RandomAccessIterator2, typename RandomAccessIterator3, typename Compare>
+  __device__
+  void operator()(bulk::concurrent_group<bulk::agent<grainsize>,groupsize> &g,
+                  unsigned int num_groups,
+                  const unsigned int *count,
+                  const unsigned int *bin,
+                  RandomAccessIterator1 offsets_first,
+                  RandomAccessIterator2 keys_first,
+                  RandomAccessIterator3 values_first,
+                  Compare comp)
+  {
+    unsigned int num_problems = *count;
+
+    for(unsigned int j = g.index(); j < num_problems; j += num_groups)
+    {
+      unsigned int p = bin[j];
+
+      typename thrust::iterator_value<RandomAccessIterator1>::type begin = offsets_first[p], end = offsets_first[p+1];
+
+      bulk::stable_sort_by_key(bulk::bound<groupsize * grainsize>(g), keys_first + begin, keys_first + end, values_first + begin, comp);
+
+      g.wait();
+    } // end for j
+  } // end operator()
+}; // end sort_bin
+
+
+// merges each pair of consecutive sorted runs of width elements of [keys_first, keys_first + n) into the result,
+// a tile of merged elements at a time
+template<std::size_t groupsize, std::size_t grainsize,
+         typename Size,
+         typename RandomAccessIterator1, typename RandomAccessIterator2,
+         typename RandomAccessIterator3, typename RandomAccessIterator4,
+         typename Compare>
+__device__
+void merge_runs(bulk::concurrent_group<bulk::agent<grainsize>,groupsize> &g,
+                RandomAccessIterator1 keys_first, RandomAccessIterator2 values_first,
+                Size n, Size width,
+                RandomAccessIterator3 keys_result, RandomAccessIterator4 values_result,
+                Compare comp)
+{
+  const Size tile_size = groupsize * grainsize;
+
+  for(Size lo = 0; lo < n; lo += 2 * width)
+  {
+    Size n1 = thrust::min<Size>(width, n - lo);
+    Size n2 = thrust::min<Size>(width, n - lo - n1);
+
+    RandomAccessIterator1 keys1 = keys_first + lo, keys2 = keys_first + lo + n1;
+    RandomAccessIterator2 values1 = values_first + lo, values2 = values_first + lo + n1;
+
+    for(Size diag0 = 0; diag0 < n1 + n2; diag0 += tile_size)
+    {
+      Size diag1 = thrust::min<Size>(n1 + n2, diag0 + tile_size);
+
+      // every agent finds the same split points, which saves broadcasting them
+      Size a0 = bulk::merge_path(keys1, n1, keys2, n2, diag0, comp);
+      Size a1 = bulk::merge_path(keys1, n1, keys2, n2, diag1, comp);
+
+      bulk::merge_by_key(bulk::bound<groupsize * grainsize>(g),
+                         keys1 + a0, keys1 + a1,
+                         keys2 + (diag0 - a0), keys2 + (diag1 - a1),
+                         values1 + a0,
+                         values2 + (diag0 - a0),
+                         keys_result + lo + diag0,
+                         values_result + lo + diag0,
+                         comp);
+
+      g.wait();
+    } // end for diag0
+  } // end for lo
+} // end merge_runs()
+
+
+// sorts problems larger than any class's bound with a merge sort of tiles within a single group,
+// ping-ponging between the input and the scratch buffer at the same offsets
+struct sort_large_bin
+{
+  template<std::size_t groupsize, std::size_t grainsize, typename RandomAccessIterator1, typename RandomAccessIterator2, typename RandomAccessIterator3, typename Key, typename Value, typename Compare>
+  __device__
+  void operator()(bulk::concurrent_group<bulk::agent<grainsize>,groupsize> &g,
+                  unsigned int num_groups,
+                  const unsigned int *count,
+                  const unsigned int *bin,
+                  RandomAccessIterator1 offsets_first,
+                  RandomAccessIterator2 keys_first,
+                  RandomAccessIterator3 values_first,
+                  Key *keys_scratch,
+                  Value *values_scratch,
+                  Compare comp)
+  {
+    typedef typename thrust::iterator_value<RandomAccessIterator1>::type size_type;
+
+    const size_type tile_size = groupsize * grainsize;
+
+    unsigned int num_problems = *count;
+
+    for(unsigned int j = g.index(); j < num_problems; j += num_groups)
+    {
+      unsigned int p = bin[j];
+
+      size_type begin = offsets_first[p];
+      size_type n = offsets_first[p+1] - begin;
+
+      for(size_type t = 0; t < n; t += tile_size)
+      {
+        size_type m = thrust::min<size_type>(tile_size, n - t);
+
+        bulk::stable_sort_by_key(bulk::bound<groupsize * grainsize>(g), keys_first + begin + t, keys_first + begin + t + m, values_first + begin + t, comp);
+
+        g.wait();
+      } // end for t
+
+      bool in_scratch = false;
+
+      for(size_type width = tile_size; width < n; width *= 2, in_scratch = !in_scratch)
+      {
+        if(in_scratch)
+        {
+          merge_runs(g, keys_scratch + begin, values_scratch + begin, n, width, keys_first + begin, values_first + begin, comp);
+        } // end if
+        else
+        {
+          merge_runs(g, keys_first + begin, values_first + begin, n, width, keys_scratch + begin, values_scratch + begin, comp);
+        } // end else
+      } // end for width
+
+      if(in_scratch)
+      {
+        bulk::copy_n(g, keys_scratch + begin, n, keys_first + begin);
+        bulk::copy_n(g, values_scratch + begin, n, values_first + begin);
+
+        g.wait();
+      } // end if
+    } // end for j
+  } // end operator()
+}; // end sort_large_bin
+
+
+template<typename SizeClass, typename RandomAccessIterator1, typename RandomAccessIterator2, typename RandomAccessIterator3, typename Compare>
+void launch_sort_bin(cudaStream_t s,
+                     unsigned int num_problems,
+                     const unsigned int *count,
+                     const unsigned int *bin,
+                     RandomAccessIterator1 offsets_first,
+                     RandomAccessIterator2 keys_first,
+                     RandomAccessIterator3 values_first,
+                     Compare comp)
+{
+  typedef typename thrust::iterator_value<RandomAccessIterator2>::type key_type;
+  typedef typename thrust::iterator_value<RandomAccessIterator3>::type value_type;
+
+  unsigned int num_groups = SizeClass::num_groups(num_problems);
+
+  bulk::async(bulk::grid<SizeClass::groupsize,SizeClass::grainsize>(num_groups, SizeClass::template heap_size<key_type,value_type>(), s),
+              sort_bin(),
+              bulk::root.this_exec,
+              num_groups, count, bin, offsets_first, keys_first, values_first, comp);
+} // end launch_sort_bin()
+
+
+} // end batched_detail
+} // end detail
+
+
+// sorts each of a batch of independent problems stably by key
+// problem p comprises [keys_first + offsets_first[p], keys_first + offsets_first[p+1]) and the corresponding values,
+// so [offsets_first, offsets_last) holds one more offset than there are problems, as for segmented_reduce
+// the problems are binned on the device by size, and each bin is sorted by groups sized to its problems:
+// a warp each for the smallest, up to a block of 512 for problems of several thousand elements,
+// so the whole batch takes a fixed number of launches however many problems it holds, without waiting on the host
+// problems larger than the largest group's bound are merge sorted within a group through a scratch buffer
+template<typename RandomAccessIterator1, typename RandomAccessIterator2, typename RandomAccessIterator3, typename Compare>
+void batched_stable_sort_by_key(cudaStream_t s,
+                                RandomAccessIterator1 keys_first, RandomAccessIterator1 keys_last,
+                                RandomAccessIterator2 values_first,
+                                RandomAccessIterator3 offsets_first, RandomAccessIterator3 offsets_last,
+                                Compare comp)
+{
+  namespace ns = detail::batched_detail;
+
+  typedef typename thrust::iterator_value<RandomAccessIterator1>::type key_type;
+  typedef typename thrust::iterator_value<RandomAccessIterator2>::type value_type;
+  typedef ns::large_class large_class;
+
+  if(offsets_last - offsets_first < 2) return;
+
+  unsigned int num_problems = (offsets_last - offsets_first) - 1;
+
+  // a count per class, followed by a bin per class with room for every problem
+  bulk::temporary_buffer<unsigned int> storage(ns::num_classes * (1 + num_problems), s);
+
+  unsigned int *counts = storage.data();
+  unsigned int *bins   = storage.data() + ns::num_classes;
+
+  bulk::detail::throw_on_error(cudaMemsetAsync(counts, 0, ns::num_classes * sizeof(unsigned int), s), "bulk::batched_stable_sort_by_key(): after cudaMemsetAsync");
+
+  bulk::async(bulk::par(s, num_problems), ns::bin_problems(), bulk::root.this_exec, offsets_first, num_problems, counts, bins);
+
+  // a class's groups find its bin empty and exit
+  ns::launch_sort_bin<ns::class0>(s, num_problems, counts + 0, bins + 0 * num_problems, offsets_first, keys_first, values_first, comp);
+  ns::launch_sort_bin<ns::class1>(s, num_problems, counts + 1, bins + 1 * num_problems, offsets_first, keys_first, values_first, comp);
+  ns::launch_sort_bin<ns::class2>(s, num_problems, counts + 2, bins + 2 * num_problems, offsets_first, keys_first, values_first, comp);
+  ns::launch_sort_bin<ns::class3>(s, num_problems, counts + 3, bins + 3 * num_problems, offsets_first, keys_first, values_first, comp);
+  ns::launch_sort_bin<ns::class4>(s, num_problems, counts + 4, bins + 4 * num_problems, offsets_first, keys_first, values_first, comp);
+
+  // XXX the scratch covers the whole batch, as how much of it is large isn't known without waiting for the bins
+  std::size_t num_elements = keys_last - keys_first;
+
+  bulk::temporary_buffer<key_type>   keys_scratch(num_elements, s);
+  bulk::temporary_buffer<value_type> values_scratch(num_elements, s);
+
+  unsigned int num_groups = large_class::num_groups(num_problems);
+
+  bulk::async(bulk::grid<large_class::groupsize,large_class::grainsize>(num_groups, large_class::heap_size<key_type,value_type>(), s),
+              ns::sort_large_bin(),
+              bulk::root.this_exec,
+              num_groups, counts + 5, bins + 5 * num_problems, offsets_first, keys_first, values_first, keys_scratch.data(), values_scratch.data(), comp);
+} // end batched_stable_sort_by_key()
+
+
+template<typename RandomAccessIterator1, typename RandomAccessIterator2, typename RandomAccessIterator3, typename Compare>
+void batched_stable_sort_by_key(RandomAccessIterator1 keys_first, RandomAccessIterator1 keys_last,
+                                RandomAccessIterator2 values_first,
+                                RandomAccessIterator3 offsets_first, RandomAccessIterator3 offsets_last,
+                                Compare comp)
+{
+  bulk::batched_stable_sort_by_key(cudaStream_t(0), keys_first, keys_last, values_first, offsets_first, offsets_last, comp);
+} // end batched_stable_sort_by_key()
+
+
+// reduces each of a batch of independent problems, delimited by offsets as for batched_stable_sort_by_key
+// this is segmented_reduce, whose single pass balances work over elements & problems alike,
+// so batches of small or skewed problems need no binning by size
+template<typename RandomAccessIterator1, typename RandomAccessIterator2, typename RandomAccessIterator3, typename T, typename BinaryFunction>
+RandomAccessIterator3 batched_reduce(cudaStream_t s,
+                                     RandomAccessIterator1 first, RandomAccessIterator1 last,
+                                     RandomAccessIterator2 offsets_first, RandomAccessIterator2 offsets_last,
+                                     RandomAccessIterator3 result,
+                                     T init,
+                                     BinaryFunction binary_op)
+{
+  return bulk::segmented_reduce(s, first, last, offsets_first, offsets_last, result, init, binary_op);
+} // end batched_reduce()
+
+
+template<typename RandomAccessIterator1, typename RandomAccessIterator2, typename RandomAccessIterator3, typename T, typename BinaryFunction>
+RandomAccessIterator3 batched_reduce(RandomAccessIterator1 first, RandomAccessIterator1 last,
+                                     RandomAccessIterator2 offsets_first, RandomAccessIterator2 offsets_last,
+                                     RandomAccessIterator3 result,
+                                     T init,
+                                     BinaryFunction binary_op)
+{
+  return bulk::batched_reduce(cudaStream_t(0), first, last, offsets_first, offsets_last, result, init, binary_op);
+} // end batched_reduce()
+
+
+} // end bulk
+BULK_NAMESPACE_SUFFIX
@@ -0,0 +1,210 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/execution_policy.hpp>
+#include <bulk/async.hpp>
+#include <bulk/malloc.hpp>
+#include <bulk/memory_pool.hpp>
+#include <bulk/algorithm/partition.hpp>
+#include <bulk/algorithm/detail/decoupled_look_back.hpp>
+#include <bulk/detail/guarded_cuda_runtime_api.hpp>
+#include <bulk/detail/throw_on_error.hpp>
+#include <bulk/detail/terminate.hpp>
+#include <thrust/iterator/iterator_traits.h>
+#include <thrust/detail/minmax.h>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+namespace detail
+{
+namespace device_copy_if_detail
+{
+
+
+template<typename T, typename Size>
+struct copy_if_config
+{
+  typedef Size size_type;
+
+  static const int groupsize = 128;
+  static const int grainsize = sizeof(T) <= sizeof(int) ? 7 : 5;
+
+  static const size_type tile_size = groupsize * grainsize;
+
+  typedef bulk::detail::tile_status<size_type, size_type> tile_status_type;
+
+  static size_type num_tiles(size_type n)
+  {
+    return (n + tile_size - 1) / tile_size;
+  }
+
+  static size_type num_groups(size_type n)
+  {
+    // 20 determined from empirical testing on k20c & GTX 480
+    size_type subscription = 20;
+    return thrust::min<size_type>(subscription * bulk::concurrent_group<>::hardware_concurrency(), num_tiles(n));
+  }
+
+  // room for the on-chip allocator's block header
+  static size_type heap_size()
+  {
+    return tile_size * sizeof(unsigned int) + 16;
+  }
+
+  // the number of results follows the tile status in the same allocation
+  static std::size_t count_offset(size_type num_tiles)
+  {
+    return bulk::detail::decoupled_look_back_detail::align_up(tile_status_type::storage_size(num_tiles), sizeof(size_type));
+  }
+}; // end copy_if_config
+
+
+// each group claims tiles of the input in order
+// for each tile, the group flags and ranks its elements in registers, looks back for the number
+// of elements kept before the tile, and stores its kept elements after them
+struct copy_if_tiles
+{
+  template<std::size_t groupsize,
+           std::size_t grainsize,
+           typename RandomAccessIterator1,
+           typename Size,
+           typename RandomAccessIterator2,
+           typename Predicate,
+           typename TileStatus>
+  __device__
+  void operator()(bulk::concurrent_group<bulk::agent<grainsize>,groupsize> &g,
+                  RandomAccessIterator1 first, Size n,
+                  RandomAccessIterator2 result,
+                  Predicate pred,
+                  TileStatus status,
+                  Size *count)
+  {
+    namespace ns = bulk::detail::partition_detail;
+
+    const Size tile_size = groupsize * grainsize;
+
+    __shared__ Size s_tile;
+
+    unsigned int *scratch = static_cast<unsigned int*>(bulk::malloc(g, tile_size * sizeof(unsigned int)));
+
+    while(true)
+    {
+      if(g.this_exec.index() == 0)
+      {
+        s_tile = status.claim_tile();
+      } // end if
+
+      g.wait();
+
+      Size tile = s_tile;
+
+      if(tile >= status.num_tiles()) break;
+
+      Size offset = tile * tile_size;
+
+      ns::partition_copy_tile<ns::copy_true>(g,
+                                             first + offset, thrust::min<Size>(tile_size, n - offset),
+                                             result, result,
+                                             pred,
+                                             scratch,
+                                             bulk::detail::look_back_prefix<TileStatus>(status, tile, count));
+    } // end while
+
+    bulk::free(g, scratch);
+  } // end operator()
+}; // end copy_if_tiles
+
+
+template<typename RandomAccessIterator1,
+         typename RandomAccessIterator2,
+         typename Predicate>
+RandomAccessIterator2 copy_if(cudaStream_t s,
+                              RandomAccessIterator1 first, RandomAccessIterator1 last,
+                              RandomAccessIterator2 result,
+                              Predicate pred)
+{
+  typedef typename thrust::iterator_value<RandomAccessIterator1>::type value_type;
+  typedef typename thrust::iterator_difference<RandomAccessIterator1>::type size_type;
+  typedef copy_if_config<value_type,size_type> config;
+  typedef typename config::tile_status_type tile_status_type;
+
+  size_type n = last - first;
+
+  if(n <= 0) return result;
+
+  size_type num_tiles = config::num_tiles(n);
+
+  // XXX the count's readback keeps this from being recorded with bulk::capture
+  bulk::temporary_buffer<char> storage(config::count_offset(num_tiles) + sizeof(size_type), s);
+
+  tile_status_type status(storage.data(), num_tiles);
+  status.reset(storage.stream());
+
+  size_type *d_count = reinterpret_cast<size_type*>(storage.data() + config::count_offset(num_tiles));
+
+  bulk::async(bulk::grid<config::groupsize,config::grainsize>(config::num_groups(n), config::heap_size(), storage.stream()),
+              copy_if_tiles(),
+              bulk::root.this_exec,
+              first, n, result, pred, status, d_count);
+
+  // the size of the result is needed to return its end, so this waits for the kernel to complete
+  size_type count = 0;
+  bulk::detail::throw_on_error(cudaMemcpyAsync(&count, d_count, sizeof(size_type), cudaMemcpyDeviceToHost, storage.stream()),
+                               "bulk::detail::device_copy_if_detail::copy_if(): after cudaMemcpyAsync");
+
+  bulk::detail::throw_on_error(cudaStreamSynchronize(storage.stream()),
+                               "bulk::detail::device_copy_if_detail::copy_if(): after cudaStreamSynchronize");
+
+  return result + count;
+} // end copy_if()
+
+
+} // end device_copy_if_detail
+} // end detail
+
+
+// device-wide stream compaction: copies the elements of [first, last) for which pred holds to result,
+// preserving their order, in a single pass over the input
+// like the device-wide set operations, this waits for its result to learn where it ends
+template<typename RandomAccessIterator1, typename RandomAccessIterator2, typename Predicate>
+RandomAccessIterator2 copy_if(cudaStream_t s,
+                              RandomAccessIterator1 first, RandomAccessIterator1 last,
+                              RandomAccessIterator2 result,
+                              Predicate pred)
+{
+  return detail::device_copy_if_detail::copy_if(s, first, last, result, pred);
+} // end copy_if()
+
+
+template<typename RandomAccessIterator1, typename RandomAccessIterator2, typename Predicate>
+RandomAccessIterator2 copy_if(RandomAccessIterator1 first, RandomAccessIterator1 last,
+                              RandomAccessIterator2 result,
+                              Predicate pred)
+{
+  return bulk::copy_if(cudaStream_t(0), first, last, result, pred);
+} // end copy_if()
+
+
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
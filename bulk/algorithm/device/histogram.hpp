@@ -0,0 +1,155 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/execution_policy.hpp>
+#include <bulk/async.hpp>
+#include <bulk/algorithm/histogram.hpp>
+#include <bulk/detail/guarded_cuda_runtime_api.hpp>
+#include <bulk/detail/throw_on_error.hpp>
+#include <thrust/iterator/iterator_traits.h>
+#include <thrust/detail/minmax.h>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+namespace detail
+{
+namespace device_histogram_detail
+{
+
+
+struct histogram_config
+{
+  static const int groupsize = 256;
+  static const int grainsize = 8;
+
+  template<typename Size>
+  static Size num_groups(Size n)
+  {
+    const Size tile_size = groupsize * grainsize;
+
+    // 20 determined from empirical testing on k20c & GTX 480
+    Size subscription = 20;
+    return thrust::min<Size>(subscription * bulk::concurrent_group<>::hardware_concurrency(), (n + tile_size - 1) / tile_size);
+  }
+
+  // when the request exceeds what the launch can grant, the groups fall back to global atomics
+  template<typename Size>
+  static Size heap_size(Size num_bins)
+  {
+    return bulk::detail::histogram_detail::privatized_bins_size<Size>(groupsize, num_bins) + 16;
+  }
+}; // end histogram_config
+
+
+// each group counts a contiguous span of the input, so that each group merges its bins once
+struct histogram_spans
+{
+  template<std::size_t groupsize,
+           std::size_t grainsize,
+           typename RandomAccessIterator,
+           typename Size,
+           typename Integer,
+           typename BinFunction>
+  __device__
+  void operator()(bulk::concurrent_group<bulk::agent<grainsize>,groupsize> &g,
+                  RandomAccessIterator first, Size n,
+                  Integer *bins, Size num_bins,
+                  BinFunction bin_index,
+                  Size span_size)
+  {
+    Size begin = thrust::min<Size>(n, span_size * g.index());
+    Size end   = thrust::min<Size>(n, begin + span_size);
+
+    bulk::histogram(g, first + begin, first + end, bins, num_bins, bin_index);
+  } // end operator()
+}; // end histogram_spans
+
+
+} // end device_histogram_detail
+} // end detail
+
+
+// device-wide histogram: bins[b] becomes the number of elements x of [first, last) for which bin_index(x) == b,
+// for each b < num_bins
+// see the group histogram for the requirements of bins
+template<typename RandomAccessIterator, typename Integer, typename Size, typename BinFunction>
+void histogram(cudaStream_t s,
+               RandomAccessIterator first, RandomAccessIterator last,
+               Integer *bins,
+               Size num_bins,
+               BinFunction bin_index)
+{
+  typedef detail::device_histogram_detail::histogram_config config;
+
+  Size n = last - first;
+
+  if(num_bins <= 0) return;
+
+  bulk::detail::throw_on_error(cudaMemsetAsync(bins, 0, num_bins * sizeof(Integer), s),
+                               "bulk::histogram(): after cudaMemsetAsync");
+
+  if(n <= 0) return;
+
+  Size num_groups = config::num_groups(n);
+  Size span_size = (n + num_groups - 1) / num_groups;
+
+  bulk::async(bulk::grid<config::groupsize,config::grainsize>(num_groups, config::heap_size(num_bins), s),
+              detail::device_histogram_detail::histogram_spans(),
+              bulk::root.this_exec,
+              first, n, bins, num_bins, bin_index, span_size);
+} // end histogram()
+
+
+template<typename RandomAccessIterator, typename Integer, typename Size, typename BinFunction>
+void histogram(RandomAccessIterator first, RandomAccessIterator last,
+               Integer *bins,
+               Size num_bins,
+               BinFunction bin_index)
+{
+  bulk::histogram(cudaStream_t(0), first, last, bins, num_bins, bin_index);
+} // end histogram()
+
+
+// the bin of each element is its value
+template<typename RandomAccessIterator, typename Integer, typename Size>
+void histogram(cudaStream_t s,
+               RandomAccessIterator first, RandomAccessIterator last,
+               Integer *bins,
+               Size num_bins)
+{
+  bulk::histogram(s, first, last, bins, num_bins, detail::histogram_detail::identity_bin());
+} // end histogram()
+
+
+template<typename RandomAccessIterator, typename Integer, typename Size>
+void histogram(RandomAccessIterator first, RandomAccessIterator last,
+               Integer *bins,
+               Size num_bins)
+{
+  bulk::histogram(cudaStream_t(0), first, last, bins, num_bins, detail::histogram_detail::identity_bin());
+} // end histogram()
+
+
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
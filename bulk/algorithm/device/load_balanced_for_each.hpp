@@ -0,0 +1,176 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/execution_policy.hpp>
+#include <bulk/async.hpp>
+#include <bulk/malloc.hpp>
+#include <bulk/algorithm/copy.hpp>
+#include <bulk/algorithm/detail/load_balance.hpp>
+#include <bulk/detail/guarded_cuda_runtime_api.hpp>
+#include <thrust/iterator/iterator_traits.h>
+#include <thrust/detail/minmax.h>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+namespace detail
+{
+namespace load_balanced_for_each_detail
+{
+
+
+template<typename Size>
+struct load_balanced_for_each_config
+{
+  typedef Size size_type;
+
+  static const int groupsize = 128;
+  static const int grainsize = 7;
+
+  static const size_type tile_size = groupsize * grainsize;
+
+  // the number of items isn't known without waiting on the device, so the groups stride over however many tiles there are
+  static size_type num_groups()
+  {
+    // 20 as in segmented_config
+    // groups beyond the last tile exit immediately
+    size_type subscription = 20;
+    return subscription * bulk::concurrent_group<>::hardware_concurrency();
+  }
+
+  // room for a tile's row ends and the on-chip allocator's block header
+  static size_type heap_size()
+  {
+    return tile_size * sizeof(size_type) + 16;
+  }
+}; // end load_balanced_for_each_config
+
+
+// each tile covers tile_size steps of the merge of row ends and items, so every tile does the same work
+// however the items are distributed among rows
+//
+// for each of its tiles, a group
+// 1. locates the tile's rows and items with the merge path search,
+// 2. stages the ends of the tile's rows,
+// 3. walks the tile, each agent a run of grainsize steps
+template<typename Size>
+struct load_balanced_for_each_tiles
+{
+  template<typename ConcurrentGroup,
+           typename RandomAccessIterator,
+           typename Function>
+  __device__
+  void operator()(ConcurrentGroup &g,
+                  Size num_groups,
+                  RandomAccessIterator offsets_first,
+                  Size num_rows,
+                  Function f)
+  {
+    const Size tile_size = g.size() * g.this_exec.grainsize();
+    const Size grainsize = g.this_exec.grainsize();
+
+    // the rows end where their successors begin
+    RandomAccessIterator row_ends = offsets_first + 1;
+
+    Size first_item = offsets_first[0];
+    Size num_items  = Size(offsets_first[num_rows]) - first_item;
+    Size num_steps  = num_rows + num_items;
+    Size num_tiles  = (num_steps + tile_size - 1) / tile_size;
+
+    Size *stage = reinterpret_cast<Size*>(bulk::malloc(g, tile_size * sizeof(Size)));
+
+    for(Size tile = g.index(); tile < num_tiles; tile += num_groups)
+    {
+      // find this tile's rows and items
+      Size diag0 = tile * tile_size;
+      Size diag1 = thrust::min<Size>(diag0 + tile_size, num_steps);
+
+      Size row0 = bulk::detail::load_balance_split(row_ends, num_rows, first_item, num_items, diag0);
+      Size row1 = bulk::detail::load_balance_split(row_ends, num_rows, first_item, num_items, diag1);
+
+      Size item0 = diag0 - row0;
+
+      Size tile_num_rows  = row1 - row0;
+      Size tile_num_items = (diag1 - row1) - item0;
+
+      bulk::copy_n(g, row_ends + row0, tile_num_rows, stage);
+
+      // find this agent's run of the tile
+      Size local_diag      = thrust::min<Size>(grainsize * g.this_exec.index(), tile_num_rows + tile_num_items);
+      Size local_num_steps = thrust::min<Size>(grainsize, tile_num_rows + tile_num_items - local_diag);
+
+      Size row_begin = offsets_first[row0];
+
+      if(bulk::is_on_chip(stage))
+      {
+        bulk::detail::load_balance_walk(bulk::on_chip_cast(stage), tile_num_rows, row_begin, first_item + item0, tile_num_items, row0, local_diag, local_num_steps, f);
+      } // end if
+      else
+      {
+        bulk::detail::load_balance_walk(stage, tile_num_rows, row_begin, first_item + item0, tile_num_items, row0, local_diag, local_num_steps, f);
+      } // end else
+
+      // the next tile reuses the stage
+      g.wait();
+    } // end for tile
+
+    bulk::free(g, stage);
+  } // end operator()
+}; // end load_balanced_for_each_tiles
+
+
+} // end load_balanced_for_each_detail
+} // end detail
+
+
+// the device-wide analogue of load_balanced_for_each(g, offsets_first, offsets_last, f):
+// for each row r and each rank k of its items, calls f(r, k) once
+// the merge of the rows' ends and their items is cut into tiles of equal size with the merge path search,
+// as for segmented_reduce, so skewed rows, e.g. the adjacency lists of a power-law graph, are cheap
+// the offsets are only read on the device, so this doesn't wait on the launch
+template<typename RandomAccessIterator, typename Function>
+void load_balanced_for_each(cudaStream_t s, RandomAccessIterator offsets_first, RandomAccessIterator offsets_last, Function f)
+{
+  typedef typename thrust::iterator_value<RandomAccessIterator>::type size_type;
+  typedef detail::load_balanced_for_each_detail::load_balanced_for_each_config<size_type> config;
+
+  size_type num_rows = thrust::max<size_type>(0, (offsets_last - offsets_first) - 1);
+
+  if(num_rows <= 0) return;
+
+  size_type num_groups = config::num_groups();
+
+  bulk::async(bulk::grid<config::groupsize,config::grainsize>(num_groups, config::heap_size(), s),
+              detail::load_balanced_for_each_detail::load_balanced_for_each_tiles<size_type>(),
+              bulk::root.this_exec,
+              num_groups, offsets_first, num_rows, f);
+} // end load_balanced_for_each()
+
+
+template<typename RandomAccessIterator, typename Function>
+void load_balanced_for_each(RandomAccessIterator offsets_first, RandomAccessIterator offsets_last, Function f)
+{
+  bulk::load_balanced_for_each(cudaStream_t(0), offsets_first, offsets_last, f);
+} // end load_balanced_for_each()
+
+
+} // end bulk
+BULK_NAMESPACE_SUFFIX
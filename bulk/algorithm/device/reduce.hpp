@@ -0,0 +1,394 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/execution_policy.hpp>
+#include <bulk/async.hpp>
+#include <bulk/malloc.hpp>
+#include <bulk/memory_pool.hpp>
+#include <bulk/algorithm/reduce.hpp>
+#include <bulk/algorithm/mixed_precision.hpp>
+#include <bulk/algorithm/detail/deferred_value.hpp>
+#include <bulk/algorithm/detail/decoupled_look_back.hpp>
+#include <bulk/detail/guarded_cuda_runtime_api.hpp>
+#include <bulk/detail/throw_on_error.hpp>
+#include <thrust/detail/minmax.h>
+#include <thrust/detail/type_traits.h>
+#include <thrust/functional.h>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+namespace detail
+{
+namespace device_reduce_detail
+{
+
+
+struct reduce_config
+{
+  static const int groupsize = 128;
+  static const int grainsize = 7;
+
+  template<typename Size>
+  static Size num_groups(Size n)
+  {
+    const Size tile_size = groupsize * grainsize;
+
+    Size subscription = 10;
+    return thrust::max<Size>(1, thrust::min<Size>(subscription * bulk::concurrent_group<>::hardware_concurrency(), (n + tile_size - 1) / tile_size));
+  }
+
+  // room for the group reduction's buffer, when its type can't use warp collectives
+  template<typename T>
+  static int heap_size()
+  {
+    return groupsize * sizeof(T) + 16;
+  }
+}; // end reduce_config
+
+
+// each group reduces a contiguous span of tiles; if fold_init is true, the first folds in init
+// init may be a deferred_value, which only the first group loads
+struct reduce_spans
+{
+  template<std::size_t groupsize, std::size_t grainsize, typename Iterator, typename Size, typename Init, typename BinaryFunction, typename T>
+  __device__
+  void operator()(bulk::concurrent_group<bulk::agent<grainsize>,groupsize> &g, Iterator first, Size n, Size span_size, Init init, bool fold_init, BinaryFunction binary_op, T *partials)
+  {
+    Size begin = thrust::min<Size>(n, span_size * g.index());
+    Size end   = thrust::min<Size>(n, begin + span_size);
+
+    T sum;
+
+    if(g.index() == 0 && fold_init)
+    {
+      sum = bulk::detail::load_value(init);
+    } // end if
+    else
+    {
+      // every span is nonempty, so its last element may stand in for init
+      sum = first[end - 1];
+      --end;
+    } // end else
+
+    // the group reduction waits for every agent, so each has loaded init before the result may overwrite it
+    sum = bulk::reduce(g, first + begin, first + end, sum, binary_op);
+
+    if(g.this_exec.index() == 0)
+    {
+      partials[g.index()] = sum;
+    } // end if
+  } // end operator()
+}; // end reduce_spans
+
+
+// after each group stores its partial sum, it takes a ticket
+// the group holding the last ticket knows every partial is complete and folds them into *result,
+// so the whole reduction completes within a single launch
+struct reduce_and_fold_spans
+{
+  template<std::size_t groupsize, std::size_t grainsize, typename Iterator, typename Size, typename Init, typename BinaryFunction, typename T>
+  __device__
+  void operator()(bulk::concurrent_group<bulk::agent<grainsize>,groupsize> &g, Iterator first, Size n, Size span_size, Size num_groups, Init init, BinaryFunction binary_op, T *partials, unsigned int *ticket, T *result)
+  {
+    if(num_groups == 1)
+    {
+      reduce_spans()(g, first, n, span_size, init, true, binary_op, result);
+      return;
+    } // end if
+
+    reduce_spans()(g, first, n, span_size, init, true, binary_op, partials);
+
+    __shared__ bool s_is_last;
+
+    if(g.this_exec.index() == 0)
+    {
+      // the partial must be visible to the last group before this group's ticket is
+      __threadfence();
+
+      s_is_last = (atomicAdd(ticket, 1u) == num_groups - 1);
+    } // end if
+
+    g.wait();
+
+    if(s_is_last)
+    {
+      // the first partial already holds init
+      reduce_spans()(g, partials, num_groups, num_groups, T(), false, binary_op, result);
+    } // end if
+  } // end operator()
+}; // end reduce_and_fold_spans
+
+
+template<typename T> struct is_atomic_integer                     : thrust::detail::false_type {};
+template<>           struct is_atomic_integer<int>                : thrust::detail::true_type {};
+template<>           struct is_atomic_integer<unsigned int>       : thrust::detail::true_type {};
+template<>           struct is_atomic_integer<long long>          : thrust::detail::true_type {};
+template<>           struct is_atomic_integer<unsigned long long> : thrust::detail::true_type {};
+
+
+// the type the atomics operate on in T's place
+template<typename T> struct atomic_word            { typedef T type; };
+template<>           struct atomic_word<long long> { typedef unsigned long long type; };
+
+
+// reductions which groups may combine into the result with a single atomic each, rather than through partials
+// each is commutative on integers, so the order the groups arrive in doesn't change the result
+// floating point addition isn't associative, so floating point sums keep the ticket, whose result is deterministic
+template<typename T, typename BinaryFunction>
+struct atomic_reduction
+  : thrust::detail::false_type
+{};
+
+
+template<typename T>
+struct atomic_reduction<T, thrust::plus<T> >
+  : is_atomic_integer<T>
+{
+  // the byte whose repetition is the identity
+  static const int identity_byte = 0;
+
+  __device__
+  static void apply(T *result, T x)
+  {
+    typedef typename atomic_word<T>::type word;
+    atomicAdd(reinterpret_cast<word*>(result), word(x));
+  }
+}; // end atomic_reduction
+
+
+template<typename T>
+struct atomic_reduction<T, thrust::bit_or<T> >
+  : is_atomic_integer<T>
+{
+  static const int identity_byte = 0;
+
+  __device__
+  static void apply(T *result, T x)
+  {
+    typedef typename atomic_word<T>::type word;
+    atomicOr(reinterpret_cast<word*>(result), word(x));
+  }
+}; // end atomic_reduction
+
+
+template<typename T>
+struct atomic_reduction<T, thrust::bit_xor<T> >
+  : is_atomic_integer<T>
+{
+  static const int identity_byte = 0;
+
+  __device__
+  static void apply(T *result, T x)
+  {
+    typedef typename atomic_word<T>::type word;
+    atomicXor(reinterpret_cast<word*>(result), word(x));
+  }
+}; // end atomic_reduction
+
+
+template<typename T>
+struct atomic_reduction<T, thrust::bit_and<T> >
+  : is_atomic_integer<T>
+{
+  static const int identity_byte = 0xff;
+
+  __device__
+  static void apply(T *result, T x)
+  {
+    typedef typename atomic_word<T>::type word;
+    atomicAnd(reinterpret_cast<word*>(result), word(x));
+  }
+}; // end atomic_reduction
+
+
+// each group combines its partial sum directly into *result, which begins as the identity or as init
+struct reduce_spans_atomically
+{
+  template<std::size_t groupsize, std::size_t grainsize, typename Iterator, typename Size, typename Init, typename BinaryFunction, typename T>
+  __device__
+  void operator()(bulk::concurrent_group<bulk::agent<grainsize>,groupsize> &g, Iterator first, Size n, Size span_size, Init init, bool fold_init, BinaryFunction binary_op, T *result)
+  {
+    Size begin = thrust::min<Size>(n, span_size * g.index());
+    Size end   = thrust::min<Size>(n, begin + span_size);
+
+    T sum;
+
+    if(g.index() == 0 && fold_init)
+    {
+      sum = bulk::detail::load_value(init);
+    } // end if
+    else
+    {
+      sum = first[end - 1];
+      --end;
+    } // end else
+
+    sum = bulk::reduce(g, first + begin, first + end, sum, binary_op);
+
+    if(g.this_exec.index() == 0)
+    {
+      atomic_reduction<T,BinaryFunction>::apply(result, sum);
+    } // end if
+  } // end operator()
+}; // end reduce_spans_atomically
+
+
+// stores init to *result, for an empty input
+template<typename T>
+void copy_init(cudaStream_t s, const T &init, T *result)
+{
+  bulk::detail::throw_on_error(cudaMemcpyAsync(result, &init, sizeof(T), cudaMemcpyHostToDevice, s), "bulk::detail::device_reduce_detail::copy_init(): after cudaMemcpyAsync");
+
+  // init lives on the caller's stack
+  bulk::detail::throw_on_error(cudaStreamSynchronize(s), "bulk::detail::device_reduce_detail::copy_init(): after cudaStreamSynchronize");
+} // end copy_init()
+
+
+template<typename T>
+void copy_init(cudaStream_t s, deferred_value<T> init, T *result)
+{
+  if(init.ptr != result)
+  {
+    bulk::detail::throw_on_error(cudaMemcpyAsync(result, init.ptr, sizeof(T), cudaMemcpyDeviceToDevice, s), "bulk::detail::device_reduce_detail::copy_init(): after cudaMemcpyAsync");
+  } // end if
+} // end copy_init()
+
+
+// prepares *result for the groups' atomics
+// an immediate init is folded in by the first group, as it can't be stored without waiting;
+// a deferred init already lives on the device, so it becomes the result's initial value
+template<typename T, typename BinaryFunction>
+bool prepare_atomic_result(cudaStream_t s, const T &, BinaryFunction, T *result)
+{
+  bulk::detail::throw_on_error(cudaMemsetAsync(result, atomic_reduction<T,BinaryFunction>::identity_byte, sizeof(T), s), "bulk::detail::device_reduce_detail::prepare_atomic_result(): after cudaMemsetAsync");
+
+  return true;
+} // end prepare_atomic_result()
+
+
+template<typename T, typename BinaryFunction>
+bool prepare_atomic_result(cudaStream_t s, deferred_value<T> init, BinaryFunction, T *result)
+{
+  copy_init(s, init, result);
+
+  return false;
+} // end prepare_atomic_result()
+
+
+template<typename Iterator, typename Size, typename Init, typename BinaryFunction, typename T>
+void reduce(cudaStream_t s, Iterator first, Size n, Init init, BinaryFunction binary_op, T *result, thrust::detail::true_type atomic)
+{
+  typedef reduce_config config;
+
+  Size num_groups = config::num_groups(n);
+  Size span_size = (n + num_groups - 1) / num_groups;
+
+  num_groups = (n + span_size - 1) / span_size;
+
+  bool fold_init = prepare_atomic_result(s, init, binary_op, result);
+
+  bulk::async(bulk::grid<config::groupsize,config::grainsize>(num_groups, config::heap_size<T>(), s),
+              reduce_spans_atomically(),
+              bulk::root.this_exec,
+              first, n, span_size, init, fold_init, binary_op, result);
+} // end reduce()
+
+
+template<typename Iterator, typename Size, typename Init, typename BinaryFunction, typename T>
+void reduce(cudaStream_t s, Iterator first, Size n, Init init, BinaryFunction binary_op, T *result, thrust::detail::false_type atomic)
+{
+  typedef reduce_config config;
+
+  Size num_groups = config::num_groups(n);
+  Size span_size = (n + num_groups - 1) / num_groups;
+
+  // spans round up, so there may be fewer nonempty ones
+  num_groups = (n + span_size - 1) / span_size;
+
+  // the partials, followed by the ticket
+  std::size_t ticket_offset = bulk::detail::decoupled_look_back_detail::align_up(num_groups * sizeof(T), sizeof(unsigned int));
+
+  bulk::temporary_buffer<char> storage(ticket_offset + sizeof(unsigned int), s);
+
+  T *partials = reinterpret_cast<T*>(storage.data());
+  unsigned int *ticket = reinterpret_cast<unsigned int*>(storage.data() + ticket_offset);
+
+  bulk::detail::throw_on_error(cudaMemsetAsync(ticket, 0, sizeof(unsigned int), s), "bulk::detail::device_reduce_detail::reduce(): after cudaMemsetAsync");
+
+  bulk::async(bulk::grid<config::groupsize,config::grainsize>(num_groups, config::heap_size<T>(), s),
+              reduce_and_fold_spans(),
+              bulk::root.this_exec,
+              first, n, span_size, num_groups, init, binary_op, partials, ticket, result);
+} // end reduce()
+
+
+// reduces [first, first + n) with init into *result in device memory with a single launch, without waiting for the reduction
+// init may be a deferred_value, including one which points to result
+template<typename Iterator, typename Size, typename Init, typename BinaryFunction, typename T>
+void reduce(cudaStream_t s, Iterator first, Size n, Init init, BinaryFunction binary_op, T *result)
+{
+  if(n <= 0)
+  {
+    copy_init(s, init, result);
+    return;
+  } // end if
+
+  typedef thrust::detail::integral_constant<bool, atomic_reduction<T,BinaryFunction>::value> atomic;
+
+  reduce(s, first, n, init, binary_op, result, atomic());
+} // end reduce()
+
+
+} // end device_reduce_detail
+} // end detail
+
+
+// device-wide reduction, returning the sum of init and each element of [first, last) under binary_op
+// the groups' partial sums are folded by whichever group finishes last, so this takes a single launch;
+// integer sums and bitwise reductions skip the partials and combine each group's sum into the result with an atomic;
+// pointers to __half or __nv_bfloat16 reduced into a float init are loaded in pairs and summed in float
+// like the other device-wide algorithms which return a value, this waits for its result
+template<typename RandomAccessIterator, typename T, typename BinaryFunction>
+T reduce(cudaStream_t s, RandomAccessIterator first, RandomAccessIterator last, T init, BinaryFunction binary_op)
+{
+  if(first == last) return init;
+
+  bulk::temporary_buffer<T> d_result(1, s);
+
+  detail::device_reduce_detail::reduce(s, first, last - first, init, binary_op, d_result.data());
+
+  T result;
+  bulk::detail::throw_on_error(cudaMemcpyAsync(&result, d_result.data(), sizeof(T), cudaMemcpyDeviceToHost, s), "bulk::reduce(): after cudaMemcpyAsync");
+  bulk::detail::throw_on_error(cudaStreamSynchronize(s), "bulk::reduce(): after cudaStreamSynchronize");
+
+  return result;
+} // end reduce()
+
+
+template<typename RandomAccessIterator, typename T, typename BinaryFunction>
+T reduce(RandomAccessIterator first, RandomAccessIterator last, T init, BinaryFunction binary_op)
+{
+  return bulk::reduce(cudaStream_t(0), first, last, init, binary_op);
+} // end reduce()
+
+} // end bulk
+BULK_NAMESPACE_SUFFIX
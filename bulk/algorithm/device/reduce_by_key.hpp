@@ -0,0 +1,427 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/execution_policy.hpp>
+#include <bulk/async.hpp>
+#include <bulk/malloc.hpp>
+#include <bulk/memory_pool.hpp>
+#include <bulk/uninitialized.hpp>
+#include <bulk/algorithm/copy.hpp>
+#include <bulk/algorithm/scan.hpp>
+#include <bulk/algorithm/detail/decoupled_look_back.hpp>
+#include <bulk/detail/guarded_cuda_runtime_api.hpp>
+#include <bulk/detail/throw_on_error.hpp>
+#include <bulk/detail/terminate.hpp>
+#include <thrust/pair.h>
+#include <thrust/iterator/iterator_traits.h>
+#include <thrust/detail/minmax.h>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+namespace detail
+{
+namespace device_reduce_by_key_detail
+{
+
+
+// the sum of a span of the input: the number of segments which begin inside the span,
+// and the sum of the span's values since the last of them began
+template<typename T, typename Size>
+struct keyed_value
+{
+  typedef T value_type;
+
+  Size count;
+  int  nonempty;
+  T    value;
+};
+
+
+// combines the sums of two consecutive spans: the right span's value restarts if a segment begins inside it
+// the empty value is the identity
+template<typename T, typename Size, typename BinaryFunction>
+struct keyed_combine
+{
+  BinaryFunction binary_op;
+
+  __host__ __device__
+  keyed_combine(BinaryFunction binary_op)
+    : binary_op(binary_op)
+  {}
+
+  __device__
+  keyed_value<T,Size> operator()(const keyed_value<T,Size> &x, const keyed_value<T,Size> &y) const
+  {
+    if(!x.nonempty) return y;
+    if(!y.nonempty) return x;
+
+    keyed_value<T,Size> result;
+    result.count    = x.count + y.count;
+    result.nonempty = 1;
+    result.value    = (y.count > 0) ? y.value : binary_op(x.value, y.value);
+
+    return result;
+  }
+};
+
+
+template<typename Key, typename T, typename Size>
+struct reduce_by_key_config
+{
+  typedef Size size_type;
+
+  static const int groupsize = 128;
+  static const int grainsize = (sizeof(Key) <= sizeof(int) && sizeof(T) <= sizeof(int)) ? 7 : 5;
+
+  static const size_type tile_size = groupsize * grainsize;
+
+  typedef bulk::detail::tile_status<keyed_value<T,Size>, size_type> tile_status_type;
+
+  struct stage_type
+  {
+    keyed_value<T,Size> sums[groupsize];
+
+    // the keys on either side of the tile's keys decide its first head flag and its last tail flag
+    Key                 keys[tile_size + 2];
+    T                   values[tile_size];
+  };
+
+  static size_type num_tiles(size_type n)
+  {
+    return (n + tile_size - 1) / tile_size;
+  }
+
+  static size_type num_groups(size_type n)
+  {
+    // 20 determined from empirical testing on k20c & GTX 480
+    size_type subscription = 20;
+    return thrust::min<size_type>(subscription * bulk::concurrent_group<>::hardware_concurrency(), num_tiles(n));
+  }
+
+  // room for the on-chip allocator's block header
+  static size_type heap_size()
+  {
+    return sizeof(stage_type) + 16;
+  }
+
+  // the number of results follows the tile status in the same allocation
+  static std::size_t count_offset(size_type num_tiles)
+  {
+    return bulk::detail::decoupled_look_back_detail::align_up(tile_status_type::storage_size(num_tiles), sizeof(size_type));
+  }
+}; // end reduce_by_key_config
+
+
+// each group claims tiles of the input in order
+// the segments' boundaries are found, counted and reduced in a single pass over the keys:
+// each tile's head and tail flags are recomputed from its staged keys in registers when needed,
+// rather than materialized in memory by a separate pass
+//
+// for each tile, each agent
+// 1. walks its run of the tile to count the segments which begin in it and sum its values since the last of them,
+// 2. scans the sums of the group's runs, from which the group publishes and looks back for the tile's prefix,
+// 3. walks its run again beginning from its own prefix, and emits the key of each segment which begins in it
+//    and the sum of each segment which ends in it
+//
+// a segment's result lands at the number of segments which begin before or at its end, less one,
+// so the prefix counts double as output offsets, and the last tile records the total in count
+struct reduce_by_key_tiles
+{
+  template<std::size_t groupsize,
+           std::size_t grainsize,
+           typename RandomAccessIterator1,
+           typename Size,
+           typename RandomAccessIterator2,
+           typename RandomAccessIterator3,
+           typename RandomAccessIterator4,
+           typename BinaryPredicate,
+           typename BinaryFunction,
+           typename TileStatus>
+  __device__
+  void operator()(bulk::concurrent_group<bulk::agent<grainsize>,groupsize> &g,
+                  RandomAccessIterator1 keys_first,
+                  Size n,
+                  RandomAccessIterator2 values_first,
+                  RandomAccessIterator3 keys_result,
+                  RandomAccessIterator4 values_result,
+                  BinaryPredicate pred,
+                  BinaryFunction binary_op,
+                  TileStatus status,
+                  Size *count)
+  {
+    typedef typename bulk::concurrent_group<bulk::agent<grainsize>,groupsize>::size_type size_type;
+    typedef typename thrust::iterator_value<RandomAccessIterator1>::type key_type;
+    typedef typename TileStatus::value_type                             sum_type;
+    typedef typename sum_type::value_type                                value_type;
+    typedef typename reduce_by_key_config<key_type,value_type,Size>::stage_type stage_type;
+
+    const Size tile_size = groupsize * grainsize;
+
+    keyed_combine<value_type,Size,BinaryFunction> combine(binary_op);
+
+    sum_type empty;
+    empty.count    = 0;
+    empty.nonempty = 0;
+
+    __shared__ Size s_tile;
+    __shared__ uninitialized<sum_type> s_carry;
+
+    stage_type *stage = reinterpret_cast<stage_type*>(bulk::malloc(g, sizeof(stage_type)));
+
+    size_type tid = g.this_exec.index();
+
+    while(true)
+    {
+      if(tid == 0)
+      {
+        s_tile = status.claim_tile();
+      } // end if
+
+      g.wait();
+
+      Size tile = s_tile;
+
+      if(tile >= status.num_tiles()) break;
+
+      Size offset = tile * tile_size;
+      Size tile_n = thrust::min<Size>(tile_size, n - offset);
+
+      // stage the tile's keys after the key which precedes it, and its values
+      bulk::copy_n(g, keys_first + offset, tile_n, stage->keys + 1);
+      bulk::copy_n(g, values_first + offset, tile_n, stage->values);
+
+      if(tid == 0)
+      {
+        if(offset > 0)          stage->keys[0]          = keys_first[offset - 1];
+        if(offset + tile_n < n) stage->keys[tile_n + 1] = keys_first[offset + tile_n];
+      } // end if
+
+      g.wait();
+
+      // the tile's item i is stage->keys[i+1]
+      // item i begins a segment if it's the first item or its key differs from its predecessor's,
+      // and ends a segment if it's the last item or its key differs from its successor's
+      Size local_first = thrust::min<Size>(grainsize * tid, tile_n);
+      Size local_n     = thrust::min<Size>(grainsize, tile_n - local_first);
+
+      // find the sum of this agent's run
+      sum_type sum = empty;
+
+      for(size_type k = 0; k < grainsize; ++k)
+      {
+        if(k < local_n)
+        {
+          Size i = local_first + k;
+
+          bool head = (offset + i == 0) || !pred(stage->keys[i], stage->keys[i + 1]);
+
+          if(head)
+          {
+            ++sum.count;
+            sum.value = stage->values[i];
+          } // end if
+          else
+          {
+            sum.value = sum.nonempty ? binary_op(sum.value, stage->values[i]) : stage->values[i];
+          } // end else
+
+          sum.nonempty = 1;
+        } // end if
+      } // end for k
+
+      stage->sums[tid] = sum;
+
+      g.wait();
+
+      sum_type aggregate = bulk::detail::scan_detail::inplace_exclusive_scan(g, stage->sums, empty, combine);
+
+      if(tid == 0)
+      {
+        sum_type carry = empty;
+
+        if(tile > 0)
+        {
+          status.publish_aggregate(tile, aggregate);
+
+          carry = status.exclusive_prefix(tile, combine);
+        } // end if
+
+        sum_type inclusive = combine(carry, aggregate);
+
+        status.publish_prefix(tile, inclusive);
+
+        if(tile + 1 == status.num_tiles())
+        {
+          *count = inclusive.count;
+        } // end if
+
+        s_carry = carry;
+      } // end if
+
+      g.wait();
+
+      // walk the run again, now knowing the sum which precedes it
+      sum_type running = combine(s_carry.get(), stage->sums[tid]);
+
+      for(size_type k = 0; k < grainsize; ++k)
+      {
+        if(k < local_n)
+        {
+          Size i = local_first + k;
+
+          bool head = (offset + i == 0) || !pred(stage->keys[i], stage->keys[i + 1]);
+          bool tail = (offset + i + 1 == n) || !pred(stage->keys[i + 1], stage->keys[i + 2]);
+
+          // XXX these stores are as scattered as the segments are short
+          if(head)
+          {
+            ++running.count;
+            running.value = stage->values[i];
+
+            // a segment's key is its first, which differs from its last when pred isn't equality
+            keys_result[running.count - 1] = stage->keys[i + 1];
+          } // end if
+          else
+          {
+            // an item which doesn't begin a segment always follows one which does
+            running.value = binary_op(running.value, stage->values[i]);
+          } // end else
+
+          running.nonempty = 1;
+
+          if(tail)
+          {
+            values_result[running.count - 1] = running.value;
+          } // end if
+        } // end if
+      } // end for k
+
+      g.wait();
+    } // end while
+
+    bulk::free(g, stage);
+  } // end operator()
+}; // end reduce_by_key_tiles
+
+
+template<typename RandomAccessIterator1,
+         typename RandomAccessIterator2,
+         typename RandomAccessIterator3,
+         typename RandomAccessIterator4,
+         typename BinaryPredicate,
+         typename BinaryFunction>
+thrust::pair<RandomAccessIterator3,RandomAccessIterator4>
+  reduce_by_key(cudaStream_t s,
+                RandomAccessIterator1 keys_first, RandomAccessIterator1 keys_last,
+                RandomAccessIterator2 values_first,
+                RandomAccessIterator3 keys_result,
+                RandomAccessIterator4 values_result,
+                BinaryPredicate pred,
+                BinaryFunction binary_op)
+{
+  typedef typename thrust::iterator_value<RandomAccessIterator1>::type      key_type;
+  typedef typename thrust::iterator_difference<RandomAccessIterator1>::type size_type;
+
+  // XXX this should be the type returned by BinaryFunction
+  typedef typename thrust::iterator_value<RandomAccessIterator2>::type      value_type;
+
+  typedef reduce_by_key_config<key_type,value_type,size_type> config;
+  typedef typename config::tile_status_type tile_status_type;
+
+  size_type n = keys_last - keys_first;
+
+  if(n <= 0) return thrust::make_pair(keys_result, values_result);
+
+  size_type num_tiles = config::num_tiles(n);
+
+  // XXX the count's readback keeps this from being recorded with bulk::capture
+  bulk::temporary_buffer<char> storage(config::count_offset(num_tiles) + sizeof(size_type), s);
+
+  tile_status_type status(storage.data(), num_tiles);
+  status.reset(storage.stream());
+
+  size_type *d_count = reinterpret_cast<size_type*>(storage.data() + config::count_offset(num_tiles));
+
+  bulk::async(bulk::grid<config::groupsize,config::grainsize>(config::num_groups(n), config::heap_size(), storage.stream()),
+              reduce_by_key_tiles(),
+              bulk::root.this_exec,
+              keys_first, n, values_first, keys_result, values_result, pred, binary_op, status, d_count);
+
+  // the number of segments is needed to return the results' ends, so this waits for the kernel to complete
+  size_type count = 0;
+  bulk::detail::throw_on_error(cudaMemcpyAsync(&count, d_count, sizeof(size_type), cudaMemcpyDeviceToHost, storage.stream()),
+                               "bulk::detail::device_reduce_by_key_detail::reduce_by_key(): after cudaMemcpyAsync");
+
+  bulk::detail::throw_on_error(cudaStreamSynchronize(storage.stream()),
+                               "bulk::detail::device_reduce_by_key_detail::reduce_by_key(): after cudaStreamSynchronize");
+
+  return thrust::make_pair(keys_result + count, values_result + count);
+} // end reduce_by_key()
+
+
+} // end device_reduce_by_key_detail
+} // end detail
+
+
+// device-wide reduction by key: for each run of consecutive keys equal under pred,
+// stores the run's first key to keys_result and the sum of its values under binary_op to values_result
+// the runs are found, counted and reduced in a single pass over the keys, without materializing their flags
+// like the device-wide copy_if, this waits for its result to learn where it ends
+template<typename RandomAccessIterator1,
+         typename RandomAccessIterator2,
+         typename RandomAccessIterator3,
+         typename RandomAccessIterator4,
+         typename BinaryPredicate,
+         typename BinaryFunction>
+thrust::pair<RandomAccessIterator3,RandomAccessIterator4>
+  reduce_by_key(cudaStream_t s,
+                RandomAccessIterator1 keys_first, RandomAccessIterator1 keys_last,
+                RandomAccessIterator2 values_first,
+                RandomAccessIterator3 keys_result,
+                RandomAccessIterator4 values_result,
+                BinaryPredicate pred,
+                BinaryFunction binary_op)
+{
+  return detail::device_reduce_by_key_detail::reduce_by_key(s, keys_first, keys_last, values_first, keys_result, values_result, pred, binary_op);
+} // end reduce_by_key()
+
+
+template<typename RandomAccessIterator1,
+         typename RandomAccessIterator2,
+         typename RandomAccessIterator3,
+         typename RandomAccessIterator4,
+         typename BinaryPredicate,
+         typename BinaryFunction>
+thrust::pair<RandomAccessIterator3,RandomAccessIterator4>
+  reduce_by_key(RandomAccessIterator1 keys_first, RandomAccessIterator1 keys_last,
+                RandomAccessIterator2 values_first,
+                RandomAccessIterator3 keys_result,
+                RandomAccessIterator4 values_result,
+                BinaryPredicate pred,
+                BinaryFunction binary_op)
+{
+  return bulk::reduce_by_key(cudaStream_t(0), keys_first, keys_last, values_first, keys_result, values_result, pred, binary_op);
+} // end reduce_by_key()
+
+
+} // end bulk
+BULK_NAMESPACE_SUFFIX
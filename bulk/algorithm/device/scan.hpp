@@ -0,0 +1,312 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/execution_policy.hpp>
+#include <bulk/async.hpp>
+#include <bulk/malloc.hpp>
+#include <bulk/memory_pool.hpp>
+#include <bulk/uninitialized.hpp>
+#include <bulk/algorithm/copy.hpp>
+#include <bulk/algorithm/scan.hpp>
+#include <bulk/algorithm/detail/decoupled_look_back.hpp>
+#include <bulk/algorithm/detail/deferred_value.hpp>
+#include <bulk/detail/guarded_cuda_runtime_api.hpp>
+#include <bulk/detail/throw_on_error.hpp>
+#include <bulk/detail/terminate.hpp>
+#include <thrust/iterator/iterator_traits.h>
+#include <thrust/detail/minmax.h>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+namespace detail
+{
+namespace device_scan_detail
+{
+
+
+template<typename RandomAccessIterator1, typename RandomAccessIterator2, typename BinaryFunction>
+struct scan_config
+{
+  typedef typename bulk::detail::scan_detail::scan_intermediate<
+    RandomAccessIterator1,
+    RandomAccessIterator2,
+    BinaryFunction
+  >::type intermediate_type;
+
+  typedef typename thrust::iterator_difference<RandomAccessIterator1>::type size_type;
+
+  // determined from empirical testing on k20c
+  static const int groupsize = sizeof(intermediate_type) <= sizeof(int) ? 128 : 256;
+  static const int grainsize = sizeof(intermediate_type) <= sizeof(int) ?   9 :   5;
+
+  static const size_type tile_size = groupsize * grainsize;
+
+  typedef bulk::detail::tile_status<intermediate_type, size_type> tile_status_type;
+
+  typedef bulk::detail::scan_detail::scan_buffer<
+    groupsize,
+    grainsize,
+    intermediate_type*,
+    intermediate_type*,
+    BinaryFunction
+  > scan_buffer_type;
+
+  static size_type num_tiles(size_type n)
+  {
+    return (n + tile_size - 1) / tile_size;
+  }
+
+  // groups claim tiles until none remain, so there is no need for more groups than can stay busy
+  static size_type num_groups(size_type n)
+  {
+    // 20 determined from empirical testing on k20c & GTX 480
+    size_type subscription = 20;
+    return thrust::min<size_type>(subscription * bulk::concurrent_group<>::hardware_concurrency(), num_tiles(n));
+  }
+
+  // the staged tile and the scan's buffer, plus room for the on-chip allocator's block headers
+  static size_type heap_size()
+  {
+    return tile_size * sizeof(intermediate_type) + sizeof(scan_buffer_type) + 2 * 16;
+  }
+}; // end scan_config
+
+
+// each time a group claims a tile, it
+// 1. stages the tile on chip and scans it in place,
+// 2. publishes the tile's aggregate,
+// 3. looks back for the prefix of the tiles which precede it and publishes its own, and
+// 4. writes the tile's result combined with that prefix
+// so each input is read once and each result is written once
+// init may be a deferred_value, which the first tile loads
+template<bool inclusive, bool has_init>
+struct single_pass_scan
+{
+  template<typename ConcurrentGroup, typename RandomAccessIterator1, typename Size, typename RandomAccessIterator2, typename T, typename BinaryFunction, typename TileStatus>
+  __device__
+  void operator()(ConcurrentGroup &g,
+                  RandomAccessIterator1 first,
+                  Size n,
+                  RandomAccessIterator2 result,
+                  T init,
+                  BinaryFunction binary_op,
+                  TileStatus status)
+  {
+    typedef typename TileStatus::value_type value_type;
+    typedef typename ConcurrentGroup::size_type size_type;
+
+    const Size tile_size = g.size() * g.this_exec.grainsize();
+
+    __shared__ Size s_tile;
+    __shared__ uninitialized<value_type> s_carry;
+
+    value_type *stage = reinterpret_cast<value_type*>(bulk::malloc(g, tile_size * sizeof(value_type)));
+
+    while(true)
+    {
+      if(g.this_exec.index() == 0)
+      {
+        s_tile = status.claim_tile();
+      } // end if
+
+      g.wait();
+
+      Size tile = s_tile;
+
+      if(tile >= status.num_tiles()) break;
+
+      Size offset = tile * tile_size;
+      Size m = thrust::min<Size>(tile_size, n - offset);
+
+      bulk::copy_n(g, first + offset, m, stage);
+
+      g.wait();
+
+      bulk::inclusive_scan(g, stage, stage + m, stage, binary_op);
+
+      g.wait();
+
+      bool has_carry = has_init || tile > 0;
+
+      if(g.this_exec.index() == 0)
+      {
+        value_type aggregate = stage[m - 1];
+
+        if(tile == 0)
+        {
+          if(has_init)
+          {
+            s_carry = bulk::detail::load_value(init);
+            status.publish_prefix(tile, binary_op(s_carry.get(), aggregate));
+          } // end if
+          else
+          {
+            status.publish_prefix(tile, aggregate);
+          } // end else
+        } // end if
+        else
+        {
+          // publish our aggregate first so that our successors needn't wait on our look back
+          status.publish_aggregate(tile, aggregate);
+
+          s_carry = status.exclusive_prefix(tile, binary_op);
+
+          status.publish_prefix(tile, binary_op(s_carry.get(), aggregate));
+        } // end else
+      } // end if
+
+      g.wait();
+
+      for(size_type i = g.this_exec.index(); i < m; i += g.size())
+      {
+        if(inclusive)
+        {
+          result[offset + i] = has_carry ? binary_op(s_carry.get(), stage[i]) : stage[i];
+        } // end if
+        else
+        {
+          result[offset + i] = (i == 0) ? s_carry.get() : binary_op(s_carry.get(), stage[i-1]);
+        } // end else
+      } // end for i
+
+      // don't restage until everyone is finished with this tile
+      g.wait();
+    } // end while
+
+    bulk::free(g, stage);
+  } // end operator()
+}; // end single_pass_scan
+
+
+template<bool inclusive, bool has_init, typename RandomAccessIterator1, typename RandomAccessIterator2, typename T, typename BinaryFunction>
+RandomAccessIterator2 scan(cudaStream_t s,
+                           RandomAccessIterator1 first, RandomAccessIterator1 last,
+                           RandomAccessIterator2 result,
+                           T init,
+                           BinaryFunction binary_op)
+{
+  typedef scan_config<RandomAccessIterator1,RandomAccessIterator2,BinaryFunction> config;
+  typedef typename config::size_type size_type;
+  typedef typename config::intermediate_type intermediate_type;
+  typedef typename config::tile_status_type tile_status_type;
+
+  size_type n = last - first;
+
+  if(n <= 0) return result;
+
+  size_type num_tiles = config::num_tiles(n);
+
+  // the storage returns to the pool in stream order, so the scan need not complete before returning
+  bulk::temporary_buffer<char> storage(tile_status_type::storage_size(num_tiles), s);
+
+  // storage.stream() is the capturing stream when the scan is recorded with bulk::capture,
+  // so the reset and the launch below are recorded along with it
+  tile_status_type status(storage.data(), num_tiles);
+  status.reset(storage.stream());
+
+  bulk::async(bulk::grid<config::groupsize,config::grainsize>(config::num_groups(n), config::heap_size(), storage.stream()),
+              single_pass_scan<inclusive,has_init>(),
+              bulk::root.this_exec,
+              first, n, result, converted_value<intermediate_type,T>::convert(init), binary_op, status);
+
+  return result + n;
+} // end scan()
+
+
+} // end device_scan_detail
+} // end detail
+
+
+// device-wide scans
+// these complete in a single pass over the input by chaining the tiles together with
+// decoupled look-back: the input is read once and the result is written once
+// result may equal first
+
+
+template<typename RandomAccessIterator1, typename RandomAccessIterator2, typename BinaryFunction>
+RandomAccessIterator2 inclusive_scan(cudaStream_t s,
+                                     RandomAccessIterator1 first, RandomAccessIterator1 last,
+                                     RandomAccessIterator2 result,
+                                     BinaryFunction binary_op)
+{
+  typedef typename detail::device_scan_detail::scan_config<RandomAccessIterator1,RandomAccessIterator2,BinaryFunction>::intermediate_type intermediate_type;
+
+  // the unused init is never read
+  return detail::device_scan_detail::scan<true,false>(s, first, last, result, intermediate_type(), binary_op);
+} // end inclusive_scan()
+
+
+template<typename RandomAccessIterator1, typename RandomAccessIterator2, typename BinaryFunction>
+RandomAccessIterator2 inclusive_scan(RandomAccessIterator1 first, RandomAccessIterator1 last,
+                                     RandomAccessIterator2 result,
+                                     BinaryFunction binary_op)
+{
+  return bulk::inclusive_scan(cudaStream_t(0), first, last, result, binary_op);
+} // end inclusive_scan()
+
+
+// scans with init as if init preceded the input
+template<typename RandomAccessIterator1, typename RandomAccessIterator2, typename T, typename BinaryFunction>
+RandomAccessIterator2 inclusive_scan(cudaStream_t s,
+                                     RandomAccessIterator1 first, RandomAccessIterator1 last,
+                                     RandomAccessIterator2 result,
+                                     T init,
+                                     BinaryFunction binary_op)
+{
+  return detail::device_scan_detail::scan<true,true>(s, first, last, result, init, binary_op);
+} // end inclusive_scan()
+
+
+template<typename RandomAccessIterator1, typename RandomAccessIterator2, typename T, typename BinaryFunction>
+RandomAccessIterator2 inclusive_scan(RandomAccessIterator1 first, RandomAccessIterator1 last,
+                                     RandomAccessIterator2 result,
+                                     T init,
+                                     BinaryFunction binary_op)
+{
+  return bulk::inclusive_scan(cudaStream_t(0), first, last, result, init, binary_op);
+} // end inclusive_scan()
+
+
+template<typename RandomAccessIterator1, typename RandomAccessIterator2, typename T, typename BinaryFunction>
+RandomAccessIterator2 exclusive_scan(cudaStream_t s,
+                                     RandomAccessIterator1 first, RandomAccessIterator1 last,
+                                     RandomAccessIterator2 result,
+                                     T init,
+                                     BinaryFunction binary_op)
+{
+  return detail::device_scan_detail::scan<false,true>(s, first, last, result, init, binary_op);
+} // end exclusive_scan()
+
+
+template<typename RandomAccessIterator1, typename RandomAccessIterator2, typename T, typename BinaryFunction>
+RandomAccessIterator2 exclusive_scan(RandomAccessIterator1 first, RandomAccessIterator1 last,
+                                     RandomAccessIterator2 result,
+                                     T init,
+                                     BinaryFunction binary_op)
+{
+  return bulk::exclusive_scan(cudaStream_t(0), first, last, result, init, binary_op);
+} // end exclusive_scan()
+
+
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
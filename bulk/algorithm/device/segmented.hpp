@@ -0,0 +1,460 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/execution_policy.hpp>
+#include <bulk/async.hpp>
+#include <bulk/malloc.hpp>
+#include <bulk/memory_pool.hpp>
+#include <bulk/uninitialized.hpp>
+#include <bulk/algorithm/copy.hpp>
+#include <bulk/algorithm/scan.hpp>
+#include <bulk/algorithm/detail/load_balance.hpp>
+#include <bulk/algorithm/detail/decoupled_look_back.hpp>
+#include <bulk/detail/guarded_cuda_runtime_api.hpp>
+#include <bulk/detail/throw_on_error.hpp>
+#include <bulk/detail/terminate.hpp>
+#include <thrust/iterator/iterator_traits.h>
+#include <thrust/detail/minmax.h>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+namespace detail
+{
+namespace segmented_detail
+{
+
+
+enum segmented_mode
+{
+  reduce_mode,
+  inclusive_scan_mode,
+  exclusive_scan_mode
+};
+
+
+// the flags of a segmented_value
+enum
+{
+  // the value covers at least one step of the merge
+  nonempty = 1,
+
+  // the value covers a segment end, so it is the sum since the last one
+  has_end  = 2
+};
+
+
+template<typename T>
+struct segmented_value
+{
+  int flags;
+  T   value;
+};
+
+
+// combines the spans of two consecutive runs of the merge: the right run's value restarts at its last segment end
+// the empty value is the identity
+template<typename T, typename BinaryFunction>
+struct segmented_combine
+{
+  BinaryFunction binary_op;
+
+  __host__ __device__
+  segmented_combine(BinaryFunction binary_op)
+    : binary_op(binary_op)
+  {}
+
+  __device__
+  segmented_value<T> operator()(const segmented_value<T> &x, const segmented_value<T> &y) const
+  {
+    if(!(x.flags & nonempty)) return y;
+    if(!(y.flags & nonempty)) return x;
+
+    segmented_value<T> result;
+    result.flags = x.flags | y.flags;
+    result.value = (y.flags & has_end) ? y.value : binary_op(x.value, y.value);
+
+    return result;
+  }
+};
+
+
+template<typename T, typename Size>
+struct segmented_config
+{
+  typedef Size size_type;
+
+  static const int groupsize = 128;
+  static const int grainsize = sizeof(T) <= sizeof(int) ? 7 : 5;
+
+  static const size_type tile_size = groupsize * grainsize;
+
+  typedef bulk::detail::tile_status<segmented_value<T>, size_type> tile_status_type;
+
+  struct stage_type
+  {
+    segmented_value<T> sums[groupsize];
+    T                  values[tile_size];
+    size_type          ends[tile_size];
+  };
+
+  // each tile covers tile_size steps of the merge of segment ends and items
+  static size_type num_tiles(size_type num_items, size_type num_segments)
+  {
+    return (num_items + num_segments + tile_size - 1) / tile_size;
+  }
+
+  static size_type num_groups(size_type num_items, size_type num_segments)
+  {
+    // 20 determined from empirical testing on k20c & GTX 480
+    size_type subscription = 20;
+    return thrust::min<size_type>(subscription * bulk::concurrent_group<>::hardware_concurrency(), num_tiles(num_items, num_segments));
+  }
+
+  // room for the on-chip allocator's block header
+  static size_type heap_size()
+  {
+    return sizeof(stage_type) + 16;
+  }
+}; // end segmented_config
+
+
+// each group claims tiles of the merge of segment ends and items in order, so that
+// every tile does the same work however the items are distributed among segments
+//
+// for each tile, each agent
+// 1. walks its run of the merge to find the span of its run,
+// 2. scans the spans of the group's runs, from which the group publishes and looks back for the tile's prefix,
+// 3. walks its run again beginning from its own prefix, and emits each segment it ends (or each item's scan)
+template<int mode>
+struct segmented_tile
+{
+  template<typename ConcurrentGroup,
+           typename RandomAccessIterator1,
+           typename Size,
+           typename RandomAccessIterator2,
+           typename RandomAccessIterator3,
+           typename T,
+           typename BinaryFunction,
+           typename TileStatus>
+  __device__
+  void operator()(ConcurrentGroup &g,
+                  RandomAccessIterator1 first,
+                  Size num_items,
+                  RandomAccessIterator2 segment_ends,
+                  Size num_segments,
+                  RandomAccessIterator3 result,
+                  T init,
+                  BinaryFunction binary_op,
+                  TileStatus status)
+  {
+    typedef typename ConcurrentGroup::size_type size_type;
+    typedef segmented_value<T> value_type;
+    typedef typename segmented_config<T,Size>::stage_type stage_type;
+
+    const Size tile_size = g.size() * g.this_exec.grainsize();
+    const size_type grainsize = g.this_exec.grainsize();
+
+    segmented_combine<T,BinaryFunction> combine(binary_op);
+
+    value_type empty;
+    empty.flags = 0;
+
+    // a virtual segment end before the first item begins the first segment with init
+    value_type start;
+    start.flags = nonempty | has_end;
+    start.value = init;
+
+    __shared__ Size s_tile;
+    __shared__ uninitialized<value_type> s_carry;
+
+    stage_type *stage = reinterpret_cast<stage_type*>(bulk::malloc(g, sizeof(stage_type)));
+
+    size_type tid = g.this_exec.index();
+
+    while(true)
+    {
+      if(tid == 0)
+      {
+        s_tile = status.claim_tile();
+      } // end if
+
+      g.wait();
+
+      Size tile = s_tile;
+
+      if(tile >= status.num_tiles()) break;
+
+      // find this tile's segment ends and items
+      Size diag0 = tile * tile_size;
+      Size diag1 = thrust::min<Size>(diag0 + tile_size, num_items + num_segments);
+
+      Size segment0 = bulk::detail::load_balance_split(segment_ends, num_segments, num_items, diag0);
+      Size segment1 = bulk::detail::load_balance_split(segment_ends, num_segments, num_items, diag1);
+
+      Size item0 = diag0 - segment0;
+
+      Size tile_num_segments = segment1 - segment0;
+      Size tile_num_items    = (diag1 - segment1) - item0;
+
+      bulk::copy_n(g, segment_ends + segment0, tile_num_segments, stage->ends);
+      bulk::copy_n(g, first + item0, tile_num_items, stage->values);
+
+      // find this agent's run of the tile
+      Size local_diag     = thrust::min<Size>(grainsize * tid, tile_num_segments + tile_num_items);
+      Size local_num_steps = thrust::min<Size>(grainsize, tile_num_segments + tile_num_items - local_diag);
+
+      Size local_segment0 = bulk::detail::load_balance_split(stage->ends, tile_num_segments, item0, tile_num_items, local_diag);
+      Size local_item0    = local_diag - local_segment0;
+
+      // find the span of this agent's run
+      value_type span = empty;
+
+      Size segment_idx = local_segment0;
+      Size item_idx    = local_item0;
+
+      for(size_type k = 0; k < grainsize; ++k)
+      {
+        if(k < local_num_steps)
+        {
+          if(bulk::detail::load_balance_visits_end(stage->ends, segment_idx, tile_num_segments, item0, item_idx, tile_num_items))
+          {
+            span.flags = nonempty | has_end;
+            span.value = init;
+            ++segment_idx;
+          } // end if
+          else
+          {
+            span.value = (span.flags & nonempty) ? binary_op(span.value, stage->values[item_idx]) : stage->values[item_idx];
+            span.flags |= nonempty;
+            ++item_idx;
+          } // end else
+        } // end if
+      } // end for k
+
+      stage->sums[tid] = span;
+
+      g.wait();
+
+      value_type aggregate = bulk::detail::scan_detail::inplace_exclusive_scan(g, stage->sums, empty, combine);
+
+      if(tid == 0)
+      {
+        if(tile == 0)
+        {
+          s_carry = start;
+        } // end if
+        else
+        {
+          status.publish_aggregate(tile, aggregate);
+
+          s_carry = status.exclusive_prefix(tile, combine);
+        } // end else
+
+        status.publish_prefix(tile, combine(s_carry.get(), aggregate));
+      } // end if
+
+      g.wait();
+
+      // walk the run again, now knowing the sum which precedes it
+      // the carry always has a segment end, so the running sum is never empty
+      T running = combine(s_carry.get(), stage->sums[tid]).value;
+
+      segment_idx = local_segment0;
+      item_idx    = local_item0;
+
+      for(size_type k = 0; k < grainsize; ++k)
+      {
+        if(k < local_num_steps)
+        {
+          if(bulk::detail::load_balance_visits_end(stage->ends, segment_idx, tile_num_segments, item0, item_idx, tile_num_items))
+          {
+            if(mode == reduce_mode)
+            {
+              result[segment0 + segment_idx] = running;
+            } // end if
+
+            running = init;
+            ++segment_idx;
+          } // end if
+          else
+          {
+            T x = stage->values[item_idx];
+
+            if(mode == exclusive_scan_mode)
+            {
+              stage->values[item_idx] = running;
+            } // end if
+
+            running = binary_op(running, x);
+
+            if(mode == inclusive_scan_mode)
+            {
+              stage->values[item_idx] = running;
+            } // end if
+
+            ++item_idx;
+          } // end else
+        } // end if
+      } // end for k
+
+      g.wait();
+
+      if(mode != reduce_mode)
+      {
+        bulk::copy_n(g, stage->values, tile_num_items, result + item0);
+      } // end if
+    } // end while
+
+    bulk::free(g, stage);
+  } // end operator()
+}; // end segmented_tile
+
+
+template<int mode,
+         typename RandomAccessIterator1,
+         typename RandomAccessIterator2,
+         typename RandomAccessIterator3,
+         typename T,
+         typename BinaryFunction>
+RandomAccessIterator3 segmented(cudaStream_t s,
+                                RandomAccessIterator1 first, RandomAccessIterator1 last,
+                                RandomAccessIterator2 offsets_first, RandomAccessIterator2 offsets_last,
+                                RandomAccessIterator3 result,
+                                T init,
+                                BinaryFunction binary_op)
+{
+  typedef typename thrust::iterator_difference<RandomAccessIterator1>::type size_type;
+  typedef segmented_config<T,size_type> config;
+  typedef typename config::tile_status_type tile_status_type;
+
+  size_type num_items = last - first;
+  size_type num_segments = thrust::max<size_type>(0, (offsets_last - offsets_first) - 1);
+
+  size_type num_results = (mode == reduce_mode) ? num_segments : num_items;
+
+  if(num_results <= 0) return result;
+
+  size_type num_tiles = config::num_tiles(num_items, num_segments);
+
+  // the storage returns to the pool in stream order, so the kernel need not complete before returning
+  bulk::temporary_buffer<char> storage(tile_status_type::storage_size(num_tiles), s);
+
+  tile_status_type status(storage.data(), num_tiles);
+  status.reset(storage.stream());
+
+  // the segments end where their successors begin
+  bulk::async(bulk::grid<config::groupsize,config::grainsize>(config::num_groups(num_items, num_segments), config::heap_size(), storage.stream()),
+              segmented_tile<mode>(),
+              bulk::root.this_exec,
+              first, num_items, offsets_first + 1, num_segments, result, init, binary_op, status);
+
+  return result + num_results;
+} // end segmented()
+
+
+} // end segmented_detail
+} // end detail
+
+
+// device-wide segmented reductions and scans
+// segment s comprises the items [first + offsets_first[s], first + offsets_first[s+1]),
+// so [offsets_first, offsets_last) holds one more offset than there are segments,
+// beginning with 0 and ending with last - first
+// segments may be empty, and work is balanced over items and segments alike, so skewed segments are cheap
+// sums are of type T, and each segment's sum begins with init
+
+
+// result[s] is the sum of segment s, or init when segment s is empty
+template<typename RandomAccessIterator1, typename RandomAccessIterator2, typename RandomAccessIterator3, typename T, typename BinaryFunction>
+RandomAccessIterator3 segmented_reduce(cudaStream_t s,
+                                       RandomAccessIterator1 first, RandomAccessIterator1 last,
+                                       RandomAccessIterator2 offsets_first, RandomAccessIterator2 offsets_last,
+                                       RandomAccessIterator3 result,
+                                       T init,
+                                       BinaryFunction binary_op)
+{
+  return detail::segmented_detail::segmented<detail::segmented_detail::reduce_mode>(s, first, last, offsets_first, offsets_last, result, init, binary_op);
+} // end segmented_reduce()
+
+
+template<typename RandomAccessIterator1, typename RandomAccessIterator2, typename RandomAccessIterator3, typename T, typename BinaryFunction>
+RandomAccessIterator3 segmented_reduce(RandomAccessIterator1 first, RandomAccessIterator1 last,
+                                       RandomAccessIterator2 offsets_first, RandomAccessIterator2 offsets_last,
+                                       RandomAccessIterator3 result,
+                                       T init,
+                                       BinaryFunction binary_op)
+{
+  return bulk::segmented_reduce(cudaStream_t(0), first, last, offsets_first, offsets_last, result, init, binary_op);
+} // end segmented_reduce()
+
+
+// result[i] is the sum of the items of i's segment up to and including i
+template<typename RandomAccessIterator1, typename RandomAccessIterator2, typename RandomAccessIterator3, typename T, typename BinaryFunction>
+RandomAccessIterator3 inclusive_segmented_scan(cudaStream_t s,
+                                               RandomAccessIterator1 first, RandomAccessIterator1 last,
+                                               RandomAccessIterator2 offsets_first, RandomAccessIterator2 offsets_last,
+                                               RandomAccessIterator3 result,
+                                               T init,
+                                               BinaryFunction binary_op)
+{
+  return detail::segmented_detail::segmented<detail::segmented_detail::inclusive_scan_mode>(s, first, last, offsets_first, offsets_last, result, init, binary_op);
+} // end inclusive_segmented_scan()
+
+
+template<typename RandomAccessIterator1, typename RandomAccessIterator2, typename RandomAccessIterator3, typename T, typename BinaryFunction>
+RandomAccessIterator3 inclusive_segmented_scan(RandomAccessIterator1 first, RandomAccessIterator1 last,
+                                               RandomAccessIterator2 offsets_first, RandomAccessIterator2 offsets_last,
+                                               RandomAccessIterator3 result,
+                                               T init,
+                                               BinaryFunction binary_op)
+{
+  return bulk::inclusive_segmented_scan(cudaStream_t(0), first, last, offsets_first, offsets_last, result, init, binary_op);
+} // end inclusive_segmented_scan()
+
+
+// result[i] is the sum of the items of i's segment which precede i
+template<typename RandomAccessIterator1, typename RandomAccessIterator2, typename RandomAccessIterator3, typename T, typename BinaryFunction>
+RandomAccessIterator3 exclusive_segmented_scan(cudaStream_t s,
+                                               RandomAccessIterator1 first, RandomAccessIterator1 last,
+                                               RandomAccessIterator2 offsets_first, RandomAccessIterator2 offsets_last,
+                                               RandomAccessIterator3 result,
+                                               T init,
+                                               BinaryFunction binary_op)
+{
+  return detail::segmented_detail::segmented<detail::segmented_detail::exclusive_scan_mode>(s, first, last, offsets_first, offsets_last, result, init, binary_op);
+} // end exclusive_segmented_scan()
+
+
+template<typename RandomAccessIterator1, typename RandomAccessIterator2, typename RandomAccessIterator3, typename T, typename BinaryFunction>
+RandomAccessIterator3 exclusive_segmented_scan(RandomAccessIterator1 first, RandomAccessIterator1 last,
+                                               RandomAccessIterator2 offsets_first, RandomAccessIterator2 offsets_last,
+                                               RandomAccessIterator3 result,
+                                               T init,
+                                               BinaryFunction binary_op)
+{
+  return bulk::exclusive_segmented_scan(cudaStream_t(0), first, last, offsets_first, offsets_last, result, init, binary_op);
+} // end exclusive_segmented_scan()
+
+
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
@@ -0,0 +1,452 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/execution_policy.hpp>
+#include <bulk/async.hpp>
+#include <bulk/malloc.hpp>
+#include <bulk/memory_pool.hpp>
+#include <bulk/algorithm/copy.hpp>
+#include <bulk/algorithm/merge.hpp>
+#include <bulk/algorithm/set_operations.hpp>
+#include <bulk/algorithm/detail/decoupled_look_back.hpp>
+#include <bulk/detail/guarded_cuda_runtime_api.hpp>
+#include <bulk/detail/throw_on_error.hpp>
+#include <bulk/detail/terminate.hpp>
+#include <thrust/functional.h>
+#include <thrust/pair.h>
+#include <thrust/iterator/iterator_traits.h>
+#include <thrust/detail/minmax.h>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+namespace detail
+{
+namespace device_set_operations_detail
+{
+
+
+template<typename T, typename Size>
+struct set_operations_config
+{
+  typedef Size size_type;
+
+  static const int groupsize = 128;
+  static const int grainsize = sizeof(T) <= sizeof(int) ? 7 : 5;
+
+  static const size_type tile_size = groupsize * grainsize;
+
+  typedef bulk::detail::tile_status<size_type, size_type> tile_status_type;
+
+  struct stage_type
+  {
+    T            keys[tile_size];
+    unsigned int ranks[tile_size + 1];
+  };
+
+  // each tile covers tile_size steps of the merge of the inputs
+  static size_type num_tiles(size_type n)
+  {
+    return (n + tile_size - 1) / tile_size;
+  }
+
+  static size_type num_groups(size_type n)
+  {
+    // 20 determined from empirical testing on k20c & GTX 480
+    size_type subscription = 20;
+    return thrust::min<size_type>(subscription * bulk::concurrent_group<>::hardware_concurrency(), num_tiles(n));
+  }
+
+  // room for the on-chip allocator's block header
+  static size_type heap_size()
+  {
+    return sizeof(stage_type) + 16;
+  }
+
+  // the number of results follows the tile status in the same allocation
+  static std::size_t count_offset(size_type num_tiles)
+  {
+    return bulk::detail::decoupled_look_back_detail::align_up(tile_status_type::storage_size(num_tiles), sizeof(size_type));
+  }
+}; // end set_operations_config
+
+
+// each group claims tiles of the merge of the inputs in order
+// for each tile, the group stages its keys on chip, decides which to keep,
+// looks back for the number kept before the tile, and scatters its kept keys after them
+template<int op, bool has_values>
+struct set_operation_tiles
+{
+  template<std::size_t groupsize,
+           std::size_t grainsize,
+           typename RandomAccessIterator1,
+           typename Size,
+           typename RandomAccessIterator2,
+           typename RandomAccessIterator3,
+           typename RandomAccessIterator4,
+           typename RandomAccessIterator5,
+           typename RandomAccessIterator6,
+           typename Compare,
+           typename TileStatus>
+  __device__
+  void operator()(bulk::concurrent_group<bulk::agent<grainsize>,groupsize> &g,
+                  RandomAccessIterator1 keys_first1, Size n1,
+                  RandomAccessIterator2 keys_first2, Size n2,
+                  RandomAccessIterator3 values_first1,
+                  RandomAccessIterator4 values_first2,
+                  RandomAccessIterator5 keys_result,
+                  RandomAccessIterator6 values_result,
+                  Compare comp,
+                  TileStatus status,
+                  Size *count)
+  {
+    typedef typename thrust::iterator_value<RandomAccessIterator1>::type key_type;
+    typedef typename set_operations_config<key_type,Size>::stage_type stage_type;
+
+    typedef bulk::detail::set_operations_detail::tile<key_type*,RandomAccessIterator1,Size> tile_type1;
+    typedef bulk::detail::set_operations_detail::tile<key_type*,RandomAccessIterator2,Size> tile_type2;
+
+    const Size tile_size = groupsize * grainsize;
+
+    __shared__ Size s_tile;
+
+    stage_type *stage = reinterpret_cast<stage_type*>(bulk::malloc(g, sizeof(stage_type)));
+
+    while(true)
+    {
+      if(g.this_exec.index() == 0)
+      {
+        s_tile = status.claim_tile();
+      } // end if
+
+      g.wait();
+
+      Size tile = s_tile;
+
+      if(tile >= status.num_tiles()) break;
+
+      // find this tile's keys of each input
+      Size diag0 = tile * tile_size;
+      Size diag1 = thrust::min<Size>(diag0 + tile_size, n1 + n2);
+
+      Size begin1 = bulk::merge_path(keys_first1, n1, keys_first2, n2, diag0, comp);
+      Size end1   = bulk::merge_path(keys_first1, n1, keys_first2, n2, diag1, comp);
+
+      Size begin2 = diag0 - begin1;
+      Size end2   = diag1 - end1;
+
+      bulk::copy_n(g, keys_first1 + begin1, end1 - begin1, stage->keys);
+      bulk::copy_n(g, keys_first2 + begin2, end2 - begin2, stage->keys + (end1 - begin1));
+
+      tile_type1 tile1(stage->keys,                   end1 - begin1, keys_first1, begin1, n1);
+      tile_type2 tile2(stage->keys + (end1 - begin1), end2 - begin2, keys_first2, begin2, n2);
+
+      bulk::detail::set_operations_detail::set_operation<op,has_values>(bulk::bound<groupsize * grainsize>(g),
+                                                                        tile1, tile2,
+                                                                        values_first1, values_first2,
+                                                                        keys_result, values_result,
+                                                                        stage->ranks,
+                                                                        comp,
+                                                                        bulk::detail::look_back_prefix<TileStatus>(status, tile, count));
+    } // end while
+
+    bulk::free(g, stage);
+  } // end operator()
+}; // end set_operation_tiles
+
+
+template<int op,
+         bool has_values,
+         typename RandomAccessIterator1,
+         typename RandomAccessIterator2,
+         typename RandomAccessIterator3,
+         typename RandomAccessIterator4,
+         typename RandomAccessIterator5,
+         typename RandomAccessIterator6,
+         typename Compare>
+thrust::pair<RandomAccessIterator5,RandomAccessIterator6>
+  set_operation(cudaStream_t s,
+                RandomAccessIterator1 keys_first1, RandomAccessIterator1 keys_last1,
+                RandomAccessIterator2 keys_first2, RandomAccessIterator2 keys_last2,
+                RandomAccessIterator3 values_first1,
+                RandomAccessIterator4 values_first2,
+                RandomAccessIterator5 keys_result,
+                RandomAccessIterator6 values_result,
+                Compare comp)
+{
+  typedef typename thrust::iterator_value<RandomAccessIterator1>::type key_type;
+  typedef typename thrust::iterator_difference<RandomAccessIterator1>::type size_type;
+  typedef set_operations_config<key_type,size_type> config;
+  typedef typename config::tile_status_type tile_status_type;
+
+  size_type n1 = keys_last1 - keys_first1;
+  size_type n2 = keys_last2 - keys_first2;
+
+  if(n1 + n2 <= 0) return thrust::make_pair(keys_result, values_result);
+
+  size_type num_tiles = config::num_tiles(n1 + n2);
+
+  // XXX the count's readback keeps this from being recorded with bulk::capture
+  bulk::temporary_buffer<char> storage(config::count_offset(num_tiles) + sizeof(size_type), s);
+
+  tile_status_type status(storage.data(), num_tiles);
+  status.reset(storage.stream());
+
+  size_type *d_count = reinterpret_cast<size_type*>(storage.data() + config::count_offset(num_tiles));
+
+  bulk::async(bulk::grid<config::groupsize,config::grainsize>(config::num_groups(n1 + n2), config::heap_size(), storage.stream()),
+              set_operation_tiles<op,has_values>(),
+              bulk::root.this_exec,
+              keys_first1, n1, keys_first2, n2, values_first1, values_first2, keys_result, values_result, comp, status, d_count);
+
+  // the size of the result is needed to return its end, so this waits for the kernel to complete
+  size_type count = 0;
+  bulk::detail::throw_on_error(cudaMemcpyAsync(&count, d_count, sizeof(size_type), cudaMemcpyDeviceToHost, storage.stream()),
+                               "bulk::detail::device_set_operations_detail::set_operation(): after cudaMemcpyAsync");
+
+  bulk::detail::throw_on_error(cudaStreamSynchronize(storage.stream()),
+                               "bulk::detail::device_set_operations_detail::set_operation(): after cudaStreamSynchronize");
+
+  return thrust::make_pair(keys_result + count, values_result + count);
+} // end set_operation()
+
+
+} // end device_set_operations_detail
+} // end detail
+
+
+// device-wide set operations of sorted ranges, with the semantics of their namesakes in the standard library
+// the keys of both inputs are staged as the key type of the first
+// unlike the other device-wide algorithms, these wait for their results to learn where they end
+
+
+template<typename RandomAccessIterator1, typename RandomAccessIterator2, typename RandomAccessIterator3, typename Compare>
+RandomAccessIterator3 set_intersection(cudaStream_t s,
+                                       RandomAccessIterator1 first1, RandomAccessIterator1 last1,
+                                       RandomAccessIterator2 first2, RandomAccessIterator2 last2,
+                                       RandomAccessIterator3 result,
+                                       Compare comp)
+{
+  namespace ns = detail::device_set_operations_detail;
+  return ns::set_operation<detail::set_operations_detail::intersection_op,false>(s, first1, last1, first2, last2, first1, first2, result, result, comp).first;
+} // end set_intersection()
+
+
+template<typename RandomAccessIterator1, typename RandomAccessIterator2, typename RandomAccessIterator3, typename Compare>
+RandomAccessIterator3 set_intersection(RandomAccessIterator1 first1, RandomAccessIterator1 last1,
+                                       RandomAccessIterator2 first2, RandomAccessIterator2 last2,
+                                       RandomAccessIterator3 result,
+                                       Compare comp)
+{
+  return bulk::set_intersection(cudaStream_t(0), first1, last1, first2, last2, result, comp);
+} // end set_intersection()
+
+
+template<typename RandomAccessIterator1, typename RandomAccessIterator2, typename RandomAccessIterator3, typename Compare>
+RandomAccessIterator3 set_union(cudaStream_t s,
+                                RandomAccessIterator1 first1, RandomAccessIterator1 last1,
+                                RandomAccessIterator2 first2, RandomAccessIterator2 last2,
+                                RandomAccessIterator3 result,
+                                Compare comp)
+{
+  namespace ns = detail::device_set_operations_detail;
+  return ns::set_operation<detail::set_operations_detail::union_op,false>(s, first1, last1, first2, last2, first1, first2, result, result, comp).first;
+} // end set_union()
+
+
+template<typename RandomAccessIterator1, typename RandomAccessIterator2, typename RandomAccessIterator3, typename Compare>
+RandomAccessIterator3 set_union(RandomAccessIterator1 first1, RandomAccessIterator1 last1,
+                                RandomAccessIterator2 first2, RandomAccessIterator2 last2,
+                                RandomAccessIterator3 result,
+                                Compare comp)
+{
+  return bulk::set_union(cudaStream_t(0), first1, last1, first2, last2, result, comp);
+} // end set_union()
+
+
+template<typename RandomAccessIterator1, typename RandomAccessIterator2, typename RandomAccessIterator3, typename Compare>
+RandomAccessIterator3 set_difference(cudaStream_t s,
+                                     RandomAccessIterator1 first1, RandomAccessIterator1 last1,
+                                     RandomAccessIterator2 first2, RandomAccessIterator2 last2,
+                                     RandomAccessIterator3 result,
+                                     Compare comp)
+{
+  namespace ns = detail::device_set_operations_detail;
+  return ns::set_operation<detail::set_operations_detail::difference_op,false>(s, first1, last1, first2, last2, first1, first2, result, result, comp).first;
+} // end set_difference()
+
+
+template<typename RandomAccessIterator1, typename RandomAccessIterator2, typename RandomAccessIterator3, typename Compare>
+RandomAccessIterator3 set_difference(RandomAccessIterator1 first1, RandomAccessIterator1 last1,
+                                     RandomAccessIterator2 first2, RandomAccessIterator2 last2,
+                                     RandomAccessIterator3 result,
+                                     Compare comp)
+{
+  return bulk::set_difference(cudaStream_t(0), first1, last1, first2, last2, result, comp);
+} // end set_difference()
+
+
+template<typename RandomAccessIterator1, typename RandomAccessIterator2, typename RandomAccessIterator3, typename Compare>
+RandomAccessIterator3 set_symmetric_difference(cudaStream_t s,
+                                               RandomAccessIterator1 first1, RandomAccessIterator1 last1,
+                                               RandomAccessIterator2 first2, RandomAccessIterator2 last2,
+                                               RandomAccessIterator3 result,
+                                               Compare comp)
+{
+  namespace ns = detail::device_set_operations_detail;
+  return ns::set_operation<detail::set_operations_detail::symmetric_difference_op,false>(s, first1, last1, first2, last2, first1, first2, result, result, comp).first;
+} // end set_symmetric_difference()
+
+
+template<typename RandomAccessIterator1, typename RandomAccessIterator2, typename RandomAccessIterator3, typename Compare>
+RandomAccessIterator3 set_symmetric_difference(RandomAccessIterator1 first1, RandomAccessIterator1 last1,
+                                               RandomAccessIterator2 first2, RandomAccessIterator2 last2,
+                                               RandomAccessIterator3 result,
+                                               Compare comp)
+{
+  return bulk::set_symmetric_difference(cudaStream_t(0), first1, last1, first2, last2, result, comp);
+} // end set_symmetric_difference()
+
+
+// the values of kept keys are taken from values_first1
+template<typename RandomAccessIterator1, typename RandomAccessIterator2, typename RandomAccessIterator3, typename RandomAccessIterator4, typename RandomAccessIterator5, typename Compare>
+thrust::pair<RandomAccessIterator4,RandomAccessIterator5>
+  set_intersection_by_key(cudaStream_t s,
+                          RandomAccessIterator1 keys_first1, RandomAccessIterator1 keys_last1,
+                          RandomAccessIterator2 keys_first2, RandomAccessIterator2 keys_last2,
+                          RandomAccessIterator3 values_first1,
+                          RandomAccessIterator4 keys_result,
+                          RandomAccessIterator5 values_result,
+                          Compare comp)
+{
+  namespace ns = detail::device_set_operations_detail;
+  return ns::set_operation<detail::set_operations_detail::intersection_op,true>(s, keys_first1, keys_last1, keys_first2, keys_last2, values_first1, values_first1, keys_result, values_result, comp);
+} // end set_intersection_by_key()
+
+
+template<typename RandomAccessIterator1, typename RandomAccessIterator2, typename RandomAccessIterator3, typename RandomAccessIterator4, typename RandomAccessIterator5, typename Compare>
+thrust::pair<RandomAccessIterator4,RandomAccessIterator5>
+  set_intersection_by_key(RandomAccessIterator1 keys_first1, RandomAccessIterator1 keys_last1,
+                          RandomAccessIterator2 keys_first2, RandomAccessIterator2 keys_last2,
+                          RandomAccessIterator3 values_first1,
+                          RandomAccessIterator4 keys_result,
+                          RandomAccessIterator5 values_result,
+                          Compare comp)
+{
+  return bulk::set_intersection_by_key(cudaStream_t(0), keys_first1, keys_last1, keys_first2, keys_last2, values_first1, keys_result, values_result, comp);
+} // end set_intersection_by_key()
+
+
+template<typename RandomAccessIterator1, typename RandomAccessIterator2, typename RandomAccessIterator3, typename RandomAccessIterator4, typename RandomAccessIterator5, typename RandomAccessIterator6, typename Compare>
+thrust::pair<RandomAccessIterator5,RandomAccessIterator6>
+  set_union_by_key(cudaStream_t s,
+                   RandomAccessIterator1 keys_first1, RandomAccessIterator1 keys_last1,
+                   RandomAccessIterator2 keys_first2, RandomAccessIterator2 keys_last2,
+                   RandomAccessIterator3 values_first1,
+                   RandomAccessIterator4 values_first2,
+                   RandomAccessIterator5 keys_result,
+                   RandomAccessIterator6 values_result,
+                   Compare comp)
+{
+  namespace ns = detail::device_set_operations_detail;
+  return ns::set_operation<detail::set_operations_detail::union_op,true>(s, keys_first1, keys_last1, keys_first2, keys_last2, values_first1, values_first2, keys_result, values_result, comp);
+} // end set_union_by_key()
+
+
+template<typename RandomAccessIterator1, typename RandomAccessIterator2, typename RandomAccessIterator3, typename RandomAccessIterator4, typename RandomAccessIterator5, typename RandomAccessIterator6, typename Compare>
+thrust::pair<RandomAccessIterator5,RandomAccessIterator6>
+  set_union_by_key(RandomAccessIterator1 keys_first1, RandomAccessIterator1 keys_last1,
+                   RandomAccessIterator2 keys_first2, RandomAccessIterator2 keys_last2,
+                   RandomAccessIterator3 values_first1,
+                   RandomAccessIterator4 values_first2,
+                   RandomAccessIterator5 keys_result,
+                   RandomAccessIterator6 values_result,
+                   Compare comp)
+{
+  return bulk::set_union_by_key(cudaStream_t(0), keys_first1, keys_last1, keys_first2, keys_last2, values_first1, values_first2, keys_result, values_result, comp);
+} // end set_union_by_key()
+
+
+// values_first2 is unused, as in thrust::set_difference_by_key
+template<typename RandomAccessIterator1, typename RandomAccessIterator2, typename RandomAccessIterator3, typename RandomAccessIterator4, typename RandomAccessIterator5, typename RandomAccessIterator6, typename Compare>
+thrust::pair<RandomAccessIterator5,RandomAccessIterator6>
+  set_difference_by_key(cudaStream_t s,
+                        RandomAccessIterator1 keys_first1, RandomAccessIterator1 keys_last1,
+                        RandomAccessIterator2 keys_first2, RandomAccessIterator2 keys_last2,
+                        RandomAccessIterator3 values_first1,
+                        RandomAccessIterator4 values_first2,
+                        RandomAccessIterator5 keys_result,
+                        RandomAccessIterator6 values_result,
+                        Compare comp)
+{
+  namespace ns = detail::device_set_operations_detail;
+  return ns::set_operation<detail::set_operations_detail::difference_op,true>(s, keys_first1, keys_last1, keys_first2, keys_last2, values_first1, values_first2, keys_result, values_result, comp);
+} // end set_difference_by_key()
+
+
+template<typename RandomAccessIterator1, typename RandomAccessIterator2, typename RandomAccessIterator3, typename RandomAccessIterator4, typename RandomAccessIterator5, typename RandomAccessIterator6, typename Compare>
+thrust::pair<RandomAccessIterator5,RandomAccessIterator6>
+  set_difference_by_key(RandomAccessIterator1 keys_first1, RandomAccessIterator1 keys_last1,
+                        RandomAccessIterator2 keys_first2, RandomAccessIterator2 keys_last2,
+                        RandomAccessIterator3 values_first1,
+                        RandomAccessIterator4 values_first2,
+                        RandomAccessIterator5 keys_result,
+                        RandomAccessIterator6 values_result,
+                        Compare comp)
+{
+  return bulk::set_difference_by_key(cudaStream_t(0), keys_first1, keys_last1, keys_first2, keys_last2, values_first1, values_first2, keys_result, values_result, comp);
+} // end set_difference_by_key()
+
+
+template<typename RandomAccessIterator1, typename RandomAccessIterator2, typename RandomAccessIterator3, typename RandomAccessIterator4, typename RandomAccessIterator5, typename RandomAccessIterator6, typename Compare>
+thrust::pair<RandomAccessIterator5,RandomAccessIterator6>
+  set_symmetric_difference_by_key(cudaStream_t s,
+                                  RandomAccessIterator1 keys_first1, RandomAccessIterator1 keys_last1,
+                                  RandomAccessIterator2 keys_first2, RandomAccessIterator2 keys_last2,
+                                  RandomAccessIterator3 values_first1,
+                                  RandomAccessIterator4 values_first2,
+                                  RandomAccessIterator5 keys_result,
+                                  RandomAccessIterator6 values_result,
+                                  Compare comp)
+{
+  namespace ns = detail::device_set_operations_detail;
+  return ns::set_operation<detail::set_operations_detail::symmetric_difference_op,true>(s, keys_first1, keys_last1, keys_first2, keys_last2, values_first1, values_first2, keys_result, values_result, comp);
+} // end set_symmetric_difference_by_key()
+
+
+template<typename RandomAccessIterator1, typename RandomAccessIterator2, typename RandomAccessIterator3, typename RandomAccessIterator4, typename RandomAccessIterator5, typename RandomAccessIterator6, typename Compare>
+thrust::pair<RandomAccessIterator5,RandomAccessIterator6>
+  set_symmetric_difference_by_key(RandomAccessIterator1 keys_first1, RandomAccessIterator1 keys_last1,
+                                  RandomAccessIterator2 keys_first2, RandomAccessIterator2 keys_last2,
+                                  RandomAccessIterator3 values_first1,
+                                  RandomAccessIterator4 values_first2,
+                                  RandomAccessIterator5 keys_result,
+                                  RandomAccessIterator6 values_result,
+                                  Compare comp)
+{
+  return bulk::set_symmetric_difference_by_key(cudaStream_t(0), keys_first1, keys_last1, keys_first2, keys_last2, values_first1, values_first2, keys_result, values_result, comp);
+} // end set_symmetric_difference_by_key()
+
+
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
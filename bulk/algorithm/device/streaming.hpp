@@ -0,0 +1,497 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/execution_policy.hpp>
+#include <bulk/async.hpp>
+#include <bulk/memory_pool.hpp>
+#include <bulk/algorithm/detail/deferred_value.hpp>
+#include <bulk/algorithm/device/reduce.hpp>
+#include <bulk/algorithm/device/scan.hpp>
+#include <bulk/algorithm/device/reduce_by_key.hpp>
+#include <bulk/detail/guarded_cuda_runtime_api.hpp>
+#include <bulk/detail/throw_on_error.hpp>
+#include <thrust/pair.h>
+#include <thrust/detail/minmax.h>
+#include <cstddef>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+namespace detail
+{
+namespace streaming_detail
+{
+
+
+// the number of elements each chunk copies to the device, by default
+static const std::size_t default_chunk_size = std::size_t(1) << 22;
+
+
+// divides an input in host memory into chunks which move through a ring of device buffers, each with its own stream:
+// while one chunk computes, the next is copied in and the previous is copied out
+// each chunk's computation follows the previous chunk's, so that it may begin from their running total,
+// which stays on the device
+class chunk_pipeline
+{
+  public:
+    static const std::size_t num_buffers = 3;
+
+    chunk_pipeline(cudaStream_t s, std::size_t n, std::size_t chunk_size)
+      : m_stream(s), m_n(n), m_chunk_size(chunk_size > 0 ? chunk_size : 1)
+    {
+      // the chunks follow the work already in s, such as the allocation of their buffers
+      cudaEvent_t ready;
+      bulk::detail::throw_on_error(cudaEventCreateWithFlags(&ready, cudaEventDisableTiming), "bulk::detail::streaming_detail::chunk_pipeline(): after cudaEventCreateWithFlags");
+      bulk::detail::throw_on_error(cudaEventRecord(ready, m_stream), "bulk::detail::streaming_detail::chunk_pipeline(): after cudaEventRecord");
+
+      for(std::size_t i = 0; i < num_buffers; ++i)
+      {
+        bulk::detail::throw_on_error(cudaStreamCreateWithFlags(&m_streams[i], cudaStreamNonBlocking), "bulk::detail::streaming_detail::chunk_pipeline(): after cudaStreamCreateWithFlags");
+        bulk::detail::throw_on_error(cudaEventCreateWithFlags(&m_computed[i], cudaEventDisableTiming), "bulk::detail::streaming_detail::chunk_pipeline(): after cudaEventCreateWithFlags");
+        bulk::detail::throw_on_error(cudaStreamWaitEvent(m_streams[i], ready, 0), "bulk::detail::streaming_detail::chunk_pipeline(): after cudaStreamWaitEvent");
+      } // end for i
+
+      cudaEventDestroy(ready);
+    } // end chunk_pipeline()
+
+    // s, and so the temporary buffers which return to the pool in its order, waits for every chunk
+    ~chunk_pipeline()
+    {
+      for(std::size_t i = 0; i < num_buffers; ++i)
+      {
+        cudaEventRecord(m_computed[i], m_streams[i]);
+        cudaStreamWaitEvent(m_stream, m_computed[i], 0);
+
+        cudaEventDestroy(m_computed[i]);
+        cudaStreamDestroy(m_streams[i]);
+      } // end for i
+    } // end ~chunk_pipeline()
+
+    std::size_t num_chunks() const
+    {
+      return (m_n + m_chunk_size - 1) / m_chunk_size;
+    } // end num_chunks()
+
+    // the capacity of each buffer
+    std::size_t chunk_size() const
+    {
+      return m_chunk_size;
+    } // end chunk_size()
+
+    std::size_t offset(std::size_t chunk) const
+    {
+      return chunk * m_chunk_size;
+    } // end offset()
+
+    std::size_t size(std::size_t chunk) const
+    {
+      return thrust::min<std::size_t>(m_chunk_size, m_n - offset(chunk));
+    } // end size()
+
+    std::size_t buffer(std::size_t chunk) const
+    {
+      return chunk % num_buffers;
+    } // end buffer()
+
+    cudaStream_t stream(std::size_t chunk) const
+    {
+      return m_streams[buffer(chunk)];
+    } // end stream()
+
+    // orders the work subsequently enqueued into the chunk's stream after the computation of the chunk before it
+    void wait_for_previous(std::size_t chunk)
+    {
+      if(chunk > 0)
+      {
+        bulk::detail::throw_on_error(cudaStreamWaitEvent(stream(chunk), m_computed[buffer(chunk - 1)], 0), "bulk::detail::streaming_detail::chunk_pipeline::wait_for_previous(): after cudaStreamWaitEvent");
+      } // end if
+    } // end wait_for_previous()
+
+    // marks the end of the chunk's computation, for the chunk after it
+    void computed(std::size_t chunk)
+    {
+      bulk::detail::throw_on_error(cudaEventRecord(m_computed[buffer(chunk)], stream(chunk)), "bulk::detail::streaming_detail::chunk_pipeline::computed(): after cudaEventRecord");
+    } // end computed()
+
+  private:
+    // noncopyable
+    chunk_pipeline(const chunk_pipeline &);
+    chunk_pipeline &operator=(const chunk_pipeline &);
+
+    cudaStream_t m_stream;
+    std::size_t  m_n, m_chunk_size;
+    cudaStream_t m_streams[num_buffers];
+    cudaEvent_t  m_computed[num_buffers];
+}; // end chunk_pipeline
+
+
+template<typename T>
+void copy_to_device(cudaStream_t s, const T *first, std::size_t n, T *result)
+{
+  bulk::detail::throw_on_error(cudaMemcpyAsync(result, first, n * sizeof(T), cudaMemcpyHostToDevice, s), "bulk::detail::streaming_detail::copy_to_device(): after cudaMemcpyAsync");
+} // end copy_to_device()
+
+
+template<typename T>
+void copy_to_host(cudaStream_t s, const T *first, std::size_t n, T *result)
+{
+  bulk::detail::throw_on_error(cudaMemcpyAsync(result, first, n * sizeof(T), cudaMemcpyDeviceToHost, s), "bulk::detail::streaming_detail::copy_to_host(): after cudaMemcpyAsync");
+} // end copy_to_host()
+
+
+template<typename T>
+void copy_on_device(cudaStream_t s, const T *first, std::size_t n, T *result)
+{
+  bulk::detail::throw_on_error(cudaMemcpyAsync(result, first, n * sizeof(T), cudaMemcpyDeviceToDevice, s), "bulk::detail::streaming_detail::copy_on_device(): after cudaMemcpyAsync");
+} // end copy_on_device()
+
+
+// the carry into an exclusive scan's next chunk is its last result combined with its last input
+struct update_exclusive_carry
+{
+  template<typename T, typename BinaryFunction>
+  __device__
+  void operator()(bulk::agent<> &, const T *last_result, const T *last_input, BinaryFunction binary_op, T *carry)
+  {
+    *carry = binary_op(*last_result, *last_input);
+  }
+}; // end update_exclusive_carry
+
+
+template<bool inclusive, typename T, typename BinaryFunction>
+T *scan(cudaStream_t s,
+        const T *first, const T *last,
+        T *result,
+        T init,
+        BinaryFunction binary_op,
+        std::size_t chunk_size)
+{
+  std::size_t n = last - first;
+
+  if(n == 0) return result;
+
+  chunk_size = thrust::min<std::size_t>(thrust::max<std::size_t>(chunk_size, 1), n);
+
+  // each chunk is scanned in place, then copied out
+  bulk::temporary_buffer<T> buffers(chunk_pipeline::num_buffers * chunk_size, s);
+
+  // the running total, and the last input of the chunk in flight
+  bulk::temporary_buffer<T> carry(2, s);
+  T *d_carry = carry.data();
+  T *d_last_input = carry.data() + 1;
+
+  chunk_pipeline pipeline(s, n, chunk_size);
+
+  for(std::size_t k = 0; k < pipeline.num_chunks(); ++k)
+  {
+    cudaStream_t stream = pipeline.stream(k);
+    std::size_t m = pipeline.size(k);
+    T *buffer = buffers.data() + pipeline.buffer(k) * chunk_size;
+
+    copy_to_device(stream, first + pipeline.offset(k), m, buffer);
+
+    pipeline.wait_for_previous(k);
+
+    if(!inclusive)
+    {
+      copy_on_device(stream, buffer + m - 1, 1, d_last_input);
+    } // end if
+
+    if(k == 0)
+    {
+      if(inclusive)
+      {
+        bulk::detail::device_scan_detail::scan<true,false>(stream, buffer, buffer + m, buffer, init, binary_op);
+      } // end if
+      else
+      {
+        bulk::detail::device_scan_detail::scan<false,true>(stream, buffer, buffer + m, buffer, init, binary_op);
+      } // end else
+    } // end if
+    else
+    {
+      bulk::detail::device_scan_detail::scan<inclusive,true>(stream, buffer, buffer + m, buffer, bulk::detail::make_deferred_value<T>(d_carry), binary_op);
+    } // end else
+
+    if(inclusive)
+    {
+      copy_on_device(stream, buffer + m - 1, 1, d_carry);
+    } // end if
+    else
+    {
+      bulk::async(bulk::par(stream, 1), update_exclusive_carry(), bulk::root.this_exec, buffer + m - 1, d_last_input, binary_op, d_carry);
+    } // end else
+
+    pipeline.computed(k);
+
+    copy_to_host(stream, buffer, m, result + pipeline.offset(k));
+  } // end for k
+
+  return result + n;
+} // end scan()
+
+
+} // end streaming_detail
+} // end detail
+
+
+// out-of-core algorithms, whose input & output live in host memory and may exceed the device's
+// the input is divided into chunks of chunk_size elements, which are copied to the device,
+// computed and copied back in a ring of three buffers & streams, so that transfers
+// overlap computation; each chunk begins from a running total which stays on the device
+// the copies only overlap when the host memory is pinned, e.g. with cudaHostAlloc or cudaHostRegister
+// they wait on the host until their result is complete, as their result lives in host memory
+// s orders them with the work around them
+
+
+// reduces [first, last) in host memory, returning the sum of init and each element under binary_op
+template<typename T, typename BinaryFunction>
+T streaming_reduce(cudaStream_t s,
+                   const T *first, const T *last,
+                   T init,
+                   BinaryFunction binary_op,
+                   std::size_t chunk_size = detail::streaming_detail::default_chunk_size)
+{
+  using namespace detail::streaming_detail;
+
+  std::size_t n = last - first;
+
+  if(n == 0) return init;
+
+  chunk_size = thrust::min<std::size_t>(thrust::max<std::size_t>(chunk_size, 1), n);
+
+  bulk::temporary_buffer<T> buffers(chunk_pipeline::num_buffers * chunk_size, s);
+  bulk::temporary_buffer<T> sum(1, s);
+
+  {
+    chunk_pipeline pipeline(s, n, chunk_size);
+
+    for(std::size_t k = 0; k < pipeline.num_chunks(); ++k)
+    {
+      cudaStream_t stream = pipeline.stream(k);
+      std::size_t m = pipeline.size(k);
+      T *buffer = buffers.data() + pipeline.buffer(k) * chunk_size;
+
+      copy_to_device(stream, first + pipeline.offset(k), m, buffer);
+
+      pipeline.wait_for_previous(k);
+
+      if(k == 0)
+      {
+        detail::device_reduce_detail::reduce(stream, buffer, m, init, binary_op, sum.data());
+      } // end if
+      else
+      {
+        detail::device_reduce_detail::reduce(stream, buffer, m, detail::make_deferred_value<T>(sum.data()), binary_op, sum.data());
+      } // end else
+
+      pipeline.computed(k);
+    } // end for k
+  } // end pipeline
+
+  T result;
+  copy_to_host(s, sum.data(), 1, &result);
+  bulk::detail::throw_on_error(cudaStreamSynchronize(s), "bulk::streaming_reduce(): after cudaStreamSynchronize");
+
+  return result;
+} // end streaming_reduce()
+
+
+template<typename T, typename BinaryFunction>
+T streaming_reduce(const T *first, const T *last,
+                   T init,
+                   BinaryFunction binary_op,
+                   std::size_t chunk_size = detail::streaming_detail::default_chunk_size)
+{
+  return bulk::streaming_reduce(cudaStream_t(0), first, last, init, binary_op, chunk_size);
+} // end streaming_reduce()
+
+
+// scans [first, last) in host memory to result in host memory
+// result may equal first
+template<typename T, typename BinaryFunction>
+T *streaming_inclusive_scan(cudaStream_t s,
+                            const T *first, const T *last,
+                            T *result,
+                            BinaryFunction binary_op,
+                            std::size_t chunk_size = detail::streaming_detail::default_chunk_size)
+{
+  T *end = detail::streaming_detail::scan<true>(s, first, last, result, T(), binary_op, chunk_size);
+
+  bulk::detail::throw_on_error(cudaStreamSynchronize(s), "bulk::streaming_inclusive_scan(): after cudaStreamSynchronize");
+
+  return end;
+} // end streaming_inclusive_scan()
+
+
+template<typename T, typename BinaryFunction>
+T *streaming_inclusive_scan(const T *first, const T *last,
+                            T *result,
+                            BinaryFunction binary_op,
+                            std::size_t chunk_size = detail::streaming_detail::default_chunk_size)
+{
+  return bulk::streaming_inclusive_scan(cudaStream_t(0), first, last, result, binary_op, chunk_size);
+} // end streaming_inclusive_scan()
+
+
+template<typename T, typename BinaryFunction>
+T *streaming_exclusive_scan(cudaStream_t s,
+                            const T *first, const T *last,
+                            T *result,
+                            T init,
+                            BinaryFunction binary_op,
+                            std::size_t chunk_size = detail::streaming_detail::default_chunk_size)
+{
+  T *end = detail::streaming_detail::scan<false>(s, first, last, result, init, binary_op, chunk_size);
+
+  bulk::detail::throw_on_error(cudaStreamSynchronize(s), "bulk::streaming_exclusive_scan(): after cudaStreamSynchronize");
+
+  return end;
+} // end streaming_exclusive_scan()
+
+
+template<typename T, typename BinaryFunction>
+T *streaming_exclusive_scan(const T *first, const T *last,
+                            T *result,
+                            T init,
+                            BinaryFunction binary_op,
+                            std::size_t chunk_size = detail::streaming_detail::default_chunk_size)
+{
+  return bulk::streaming_exclusive_scan(cudaStream_t(0), first, last, result, init, binary_op, chunk_size);
+} // end streaming_exclusive_scan()
+
+
+// reduces each run of consecutive keys equal under pred in host memory, as bulk::reduce_by_key does
+// each chunk holds back its last run, which may continue into the next chunk, and prepends it to the next chunk's input
+// the device-wide reduce_by_key waits for each chunk to learn how many runs it found,
+// so the copies of the following chunks are enqueued ahead of it
+template<typename Key, typename T, typename BinaryPredicate, typename BinaryFunction>
+thrust::pair<Key*,T*>
+  streaming_reduce_by_key(cudaStream_t s,
+                          const Key *keys_first, const Key *keys_last,
+                          const T *values_first,
+                          Key *keys_result,
+                          T *values_result,
+                          BinaryPredicate pred,
+                          BinaryFunction binary_op,
+                          std::size_t chunk_size = detail::streaming_detail::default_chunk_size)
+{
+  using namespace detail::streaming_detail;
+
+  std::size_t n = keys_last - keys_first;
+
+  if(n == 0) return thrust::make_pair(keys_result, values_result);
+
+  chunk_size = thrust::min<std::size_t>(thrust::max<std::size_t>(chunk_size, 1), n);
+
+  // each input buffer has room in front for the run carried from the chunk before
+  const std::size_t buffer_size = chunk_size + 1;
+
+  bulk::temporary_buffer<Key> keys(chunk_pipeline::num_buffers * buffer_size, s);
+  bulk::temporary_buffer<T>   values(chunk_pipeline::num_buffers * buffer_size, s);
+  bulk::temporary_buffer<Key> keys_out(chunk_pipeline::num_buffers * buffer_size, s);
+  bulk::temporary_buffer<T>   values_out(chunk_pipeline::num_buffers * buffer_size, s);
+
+  std::size_t num_results = 0;
+
+  // the run held back by the chunk before, at this index of its output buffer
+  std::size_t held_back = 0;
+
+  {
+    chunk_pipeline pipeline(s, n, chunk_size);
+
+    std::size_t num_chunks = pipeline.num_chunks();
+
+    // the chunk after next is copied into the buffer the chunk before last has finished with
+    for(std::size_t k = 0; k < num_chunks + chunk_pipeline::num_buffers - 1; ++k)
+    {
+      if(k < num_chunks)
+      {
+        std::size_t b = pipeline.buffer(k) * buffer_size;
+
+        copy_to_device(pipeline.stream(k), keys_first   + pipeline.offset(k), pipeline.size(k), keys.data()   + b + 1);
+        copy_to_device(pipeline.stream(k), values_first + pipeline.offset(k), pipeline.size(k), values.data() + b + 1);
+      } // end if
+
+      if(k < chunk_pipeline::num_buffers - 1) continue;
+
+      std::size_t j = k - (chunk_pipeline::num_buffers - 1);
+
+      cudaStream_t stream = pipeline.stream(j);
+      std::size_t b = pipeline.buffer(j) * buffer_size;
+
+      pipeline.wait_for_previous(j);
+
+      std::size_t begin = 1;
+
+      if(j > 0)
+      {
+        // prepend the run held back from the chunk before
+        std::size_t prev = pipeline.buffer(j - 1) * buffer_size;
+
+        copy_on_device(stream, keys_out.data()   + prev + held_back, 1, keys.data()   + b);
+        copy_on_device(stream, values_out.data() + prev + held_back, 1, values.data() + b);
+
+        begin = 0;
+      } // end if
+
+      std::size_t count = bulk::reduce_by_key(stream,
+                                              keys.data() + b + begin, keys.data() + b + 1 + pipeline.size(j),
+                                              values.data() + b + begin,
+                                              keys_out.data() + b,
+                                              values_out.data() + b,
+                                              pred, binary_op).first - (keys_out.data() + b);
+
+      pipeline.computed(j);
+
+      // the last chunk holds back nothing
+      std::size_t num_complete = (j + 1 < num_chunks) ? count - 1 : count;
+
+      copy_to_host(stream, keys_out.data()   + b, num_complete, keys_result   + num_results);
+      copy_to_host(stream, values_out.data() + b, num_complete, values_result + num_results);
+
+      num_results += num_complete;
+      held_back = num_complete;
+    } // end for k
+  } // end pipeline
+
+  bulk::detail::throw_on_error(cudaStreamSynchronize(s), "bulk::streaming_reduce_by_key(): after cudaStreamSynchronize");
+
+  return thrust::make_pair(keys_result + num_results, values_result + num_results);
+} // end streaming_reduce_by_key()
+
+
+template<typename Key, typename T, typename BinaryPredicate, typename BinaryFunction>
+thrust::pair<Key*,T*>
+  streaming_reduce_by_key(const Key *keys_first, const Key *keys_last,
+                          const T *values_first,
+                          Key *keys_result,
+                          T *values_result,
+                          BinaryPredicate pred,
+                          BinaryFunction binary_op,
+                          std::size_t chunk_size = detail::streaming_detail::default_chunk_size)
+{
+  return bulk::streaming_reduce_by_key(cudaStream_t(0), keys_first, keys_last, values_first, keys_result, values_result, pred, binary_op, chunk_size);
+} // end streaming_reduce_by_key()
+
+
+} // end bulk
+BULK_NAMESPACE_SUFFIX
@@ -18,6 +18,9 @@
 
 #include <bulk/detail/config.hpp>
 #include <bulk/execution_policy.hpp>
+#include <bulk/algorithm/detail/strided_staging.hpp>
+#include <thrust/detail/type_traits.h>
+#include <thrust/iterator/iterator_traits.h>
 
 
 BULK_NAMESPACE_PREFIX
@@ -32,7 +35,7 @@ template<typename ExecutionGroup,
 __device__
 RandomAccessIterator for_each_n(ExecutionGroup &g, RandomAccessIterator first, Size n, Function f)
 {
-  for(Size i = g.this_thread.index();
+  for(Size i = g.this_exec.index();
       i < n;
       i += g.size())
   {
@@ -45,6 +48,78 @@ RandomAccessIterator for_each_n(ExecutionGroup &g, RandomAccessIterator first, S
 } // end for_each()
 
 
+namespace detail
+{
+
+
+template<typename Function>
+struct for_each_visitor
+{
+  Function &f;
+
+  __device__
+  for_each_visitor(Function &f)
+    : f(f)
+  {}
+
+  template<typename Size, typename T>
+  __device__
+  void operator()(Size, T &x)
+  {
+    f(x);
+  }
+}; // end for_each_visitor
+
+
+// f visits copies of the values from the stage, so only read-only strided ranges are staged
+template<typename Iterator>
+struct is_stageable_for_each_iterator
+  : thrust::detail::and_<
+      is_stageable_strided_iterator<Iterator>,
+      thrust::detail::is_const<
+        typename thrust::detail::remove_reference<
+          typename thrust::iterator_reference<Iterator>::type
+        >::type
+      >
+    >
+{};
+
+
+} // end detail
+
+
+// a read-only strided range, e.g. a column of an array of structures, is read through a tile transpose
+template<std::size_t groupsize,
+         std::size_t grainsize,
+         typename Iterator,
+         typename StrideSize,
+         typename Size,
+         typename Function>
+__device__
+typename thrust::detail::enable_if<
+  detail::is_stageable_for_each_iterator<strided_iterator<Iterator,StrideSize> >::value,
+  strided_iterator<Iterator,StrideSize>
+>::type
+for_each_n(bulk::concurrent_group<bulk::agent<grainsize>,groupsize> &g, strided_iterator<Iterator,StrideSize> first, Size n, Function f)
+{
+  if(detail::try_staged_strided_visit_n(g, first, n, detail::for_each_visitor<Function>(f)))
+  {
+    return first + n;
+  } // end if
+
+  for(Size i = g.this_exec.index();
+      i < n;
+      i += g.size())
+  {
+    f(first[i]);
+  } // end for i
+
+  g.wait();
+
+  return first + n;
+} // end for_each_n()
+
+
 template<std::size_t bound,
          std::size_t grainsize,
          typename RandomAccessIterator,
@@ -18,6 +18,7 @@
 
 #include <bulk/detail/config.hpp>
 #include <bulk/algorithm/copy.hpp>
+#include <bulk/algorithm/detail/strided_staging.hpp>
 #include <bulk/execution_policy.hpp>
 #include <thrust/iterator/permutation_iterator.h>
 
@@ -81,6 +82,65 @@ RandomAccessIterator3 gather(ExecutionGroup &g,
 } // end gather()
 
 
+namespace detail
+{
+
+
+template<typename RandomAccessIterator1, typename RandomAccessIterator2>
+struct gather_visitor
+{
+  RandomAccessIterator1 input_first;
+  RandomAccessIterator2 result;
+
+  __device__
+  gather_visitor(RandomAccessIterator1 input_first, RandomAccessIterator2 result)
+    : input_first(input_first), result(result)
+  {}
+
+  template<typename Size, typename T>
+  __device__
+  void operator()(Size i, const T &x)
+  {
+    result[i] = input_first[x];
+  }
+}; // end gather_visitor
+
+
+} // end detail
+
+
+// a strided map, e.g. a column of an array of structures, is read through a tile transpose
+template<std::size_t groupsize,
+         std::size_t grainsize,
+         typename Iterator,
+         typename StrideSize,
+         typename RandomAccessIterator2,
+         typename RandomAccessIterator3>
+__forceinline__ __device__
+typename thrust::detail::enable_if<
+  detail::is_stageable_strided_iterator<strided_iterator<Iterator,StrideSize> >::value,
+  RandomAccessIterator3
+>::type
+gather(bulk::concurrent_group<bulk::agent<grainsize>,groupsize> &g,
+       strided_iterator<Iterator,StrideSize> map_first,
+       strided_iterator<Iterator,StrideSize> map_last,
+       RandomAccessIterator2 input_first,
+       RandomAccessIterator3 result)
+{
+  typename thrust::iterator_difference<RandomAccessIterator3>::type n = map_last - map_first;
+
+  if(detail::try_staged_strided_visit_n(g, map_first, n, detail::gather_visitor<RandomAccessIterator2,RandomAccessIterator3>(input_first, result)))
+  {
+    return result + n;
+  } // end if
+
+  return bulk::copy_n(g,
+                      thrust::make_permutation_iterator(input_first, map_first),
+                      n,
+                      result);
+} // end gather()
+
+
 } // end bulk
 BULK_NAMESPACE_SUFFIX
 
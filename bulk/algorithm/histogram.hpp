@@ -0,0 +1,209 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/execution_policy.hpp>
+#include <bulk/malloc.hpp>
+#include <bulk/algorithm/detail/warp_collectives.hpp>
+#include <thrust/iterator/iterator_traits.h>
+#include <thrust/detail/minmax.h>
+#include <thrust/detail/type_traits.h>
+#include <limits>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+namespace detail
+{
+namespace histogram_detail
+{
+
+
+// the bin of a value is the value itself
+struct identity_bin
+{
+  template<typename T>
+  __host__ __device__
+  T operator()(const T &x) const
+  {
+    return x;
+  }
+};
+
+
+// the number of bytes of privatized bins needed by a group of group_size agents
+template<typename Size>
+__host__ __device__
+inline std::size_t privatized_bins_size(Size group_size, Size num_bins)
+{
+  Size num_warps = (group_size + warp_detail::warp_size - 1) / warp_detail::warp_size;
+
+  return num_warps * num_bins * sizeof(unsigned int);
+} // end privatized_bins_size()
+
+
+// whether b names one of the bins [0, num_bins)
+// only a signed Size can fall below the first bin, and comparing an unsigned one with zero draws a warning
+template<typename Size>
+__host__ __device__
+inline bool is_valid_bin(Size b, Size num_bins, thrust::detail::true_type)
+{
+  return Size(0) <= b && b < num_bins;
+} // end is_valid_bin()
+
+
+template<typename Size>
+__host__ __device__
+inline bool is_valid_bin(Size b, Size num_bins, thrust::detail::false_type)
+{
+  return b < num_bins;
+} // end is_valid_bin()
+
+
+template<typename Size>
+__host__ __device__
+inline bool is_valid_bin(Size b, Size num_bins)
+{
+  return is_valid_bin(b, num_bins, thrust::detail::integral_constant<bool, std::numeric_limits<Size>::is_signed>());
+} // end is_valid_bin()
+
+
+} // end histogram_detail
+} // end detail
+
+
+// bins[b] is incremented by the number of elements x of [first, last) for which bin_index(x) == b, for each b < num_bins
+// elements whose bins lie outside [0, num_bins) are ignored
+//
+// each warp counts into its own private bins in the group's on-chip heap, and the group merges its
+// private bins into bins with an atomic per bin
+// when the private bins don't fit in the heap, the group counts directly into bins with global atomics
+//
+// bins must point to int, unsigned int, or unsigned long long, as atomicAdd requires
+template<std::size_t groupsize,
+         std::size_t grainsize,
+         typename RandomAccessIterator,
+         typename Integer,
+         typename Size,
+         typename BinFunction>
+__device__
+void histogram(bulk::concurrent_group<bulk::agent<grainsize>,groupsize> &g,
+               RandomAccessIterator first, RandomAccessIterator last,
+               Integer *bins,
+               Size num_bins,
+               BinFunction bin_index)
+{
+  typedef typename bulk::concurrent_group<bulk::agent<grainsize>,groupsize>::size_type size_type;
+
+  size_type tid = g.this_exec.index();
+  size_type n = last - first;
+
+  // the private bins only pay off on chip, so they don't overflow into global memory
+  unsigned int *private_bins = static_cast<unsigned int*>(bulk::detail::group_on_chip_malloc(g, detail::histogram_detail::privatized_bins_size<size_type>(g.size(), num_bins)));
+
+  if(private_bins)
+  {
+    size_type num_private_bins = detail::histogram_detail::privatized_bins_size<size_type>(g.size(), num_bins) / sizeof(unsigned int);
+
+    for(size_type b = tid; b < num_private_bins; b += g.size())
+    {
+      private_bins[b] = 0;
+    } // end for b
+
+    g.wait();
+
+    unsigned int *warp_bins = private_bins + (tid / detail::warp_detail::warp_size) * num_bins;
+
+    // consecutive agents visit consecutive elements, so each load of the group coalesces
+    for(size_type i = tid; i < n; i += g.size())
+    {
+      Size b = bin_index(first[i]);
+
+      if(detail::histogram_detail::is_valid_bin(b, num_bins))
+      {
+        atomicAdd(warp_bins + b, 1u);
+      } // end if
+    } // end for i
+
+    g.wait();
+
+    size_type num_warps = num_private_bins / thrust::max<size_type>(1, num_bins);
+
+    for(size_type b = tid; b < num_bins; b += g.size())
+    {
+      unsigned int count = 0;
+
+      for(size_type w = 0; w < num_warps; ++w)
+      {
+        count += private_bins[w * num_bins + b];
+      } // end for w
+
+      // empty bins don't need an atomic
+      if(count)
+      {
+        atomicAdd(bins + b, Integer(count));
+      } // end if
+    } // end for b
+
+    g.wait();
+
+    if(tid == 0)
+    {
+      bulk::detail::unsafe_on_chip_free(private_bins);
+    } // end if
+
+    g.wait();
+  } // end if
+  else
+  {
+    for(size_type i = tid; i < n; i += g.size())
+    {
+      Size b = bin_index(first[i]);
+
+      if(detail::histogram_detail::is_valid_bin(b, num_bins))
+      {
+        atomicAdd(bins + b, Integer(1));
+      } // end if
+    } // end for i
+
+    g.wait();
+  } // end else
+} // end histogram()
+
+
+// the bin of each element is its value
+template<std::size_t groupsize,
+         std::size_t grainsize,
+         typename RandomAccessIterator,
+         typename Integer,
+         typename Size>
+__device__
+void histogram(bulk::concurrent_group<bulk::agent<grainsize>,groupsize> &g,
+               RandomAccessIterator first, RandomAccessIterator last,
+               Integer *bins,
+               Size num_bins)
+{
+  bulk::histogram(g, first, last, bins, num_bins, detail::histogram_detail::identity_bin());
+} // end histogram()
+
+
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
@@ -0,0 +1,75 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/execution_policy.hpp>
+#include <bulk/algorithm/detail/load_balance.hpp>
+#include <thrust/iterator/iterator_traits.h>
+#include <thrust/detail/minmax.h>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+
+
+// for each row r of a CSR-style work list, and each rank k of its offsets_first[r+1] - offsets_first[r] items,
+// calls f(r, k) once
+// [offsets_first, offsets_last) holds one more offset than there are rows, and rows may be empty
+//
+// the group walks the merge of the rows' ends and their items in runs of g.this_exec.grainsize() steps,
+// so every agent does the same work however skewed the rows, and each agent visits its items in order
+template<typename ExecutionGroup,
+         typename RandomAccessIterator,
+         typename Function>
+__device__
+void load_balanced_for_each(ExecutionGroup &g, RandomAccessIterator offsets_first, RandomAccessIterator offsets_last, Function f)
+{
+  typedef typename thrust::iterator_value<RandomAccessIterator>::type size_type;
+
+  size_type num_rows = thrust::max<size_type>(0, (offsets_last - offsets_first) - 1);
+
+  if(num_rows > 0)
+  {
+    size_type first_item = offsets_first[0];
+    size_type num_items  = size_type(offsets_first[num_rows]) - first_item;
+    size_type num_steps  = num_rows + num_items;
+
+    size_type grainsize  = g.this_exec.grainsize();
+
+    // the rows end where their successors begin
+    for(size_type diag = grainsize * g.this_exec.index();
+        diag < num_steps;
+        diag += grainsize * g.size())
+    {
+      bulk::detail::load_balance_walk(offsets_first + 1, num_rows,
+                                      first_item,
+                                      first_item, num_items,
+                                      size_type(0),
+                                      diag, thrust::min<size_type>(grainsize, num_steps - diag),
+                                      f);
+    } // end for diag
+  } // end if
+
+  g.wait();
+} // end load_balanced_for_each()
+
+
+} // end bulk
+BULK_NAMESPACE_SUFFIX
@@ -21,6 +21,7 @@
 #include <bulk/malloc.hpp>
 #include <bulk/algorithm/copy.hpp>
 #include <bulk/algorithm/gather.hpp>
+#include <bulk/algorithm/detail/staging.hpp>
 #include <bulk/uninitialized.hpp>
 #include <thrust/iterator/counting_iterator.h>
 #include <thrust/iterator/detail/join_iterator.h>
@@ -463,10 +464,14 @@ RandomAccessIterator3 merge(bulk::concurrent_group<bulk::agent<grainsize>,groups
 
   typedef typename thrust::iterator_value<RandomAccessIterator3>::type value_type;
 
-  value_type *buffer = reinterpret_cast<value_type*>(bulk::malloc(exec, exec.size() * exec.grainsize() * sizeof(value_type)));
+  // tuples are staged as a structure of arrays
+  typedef bulk::detail::stage<value_type> stage_type;
 
   size_type chunk_size = exec.size() * exec.this_exec.grainsize();
 
+  void *storage = bulk::malloc(exec, stage_type::storage_size(chunk_size));
+  typename stage_type::iterator buffer = stage_type::make(storage, chunk_size);
+
   size_type n1 = last1 - first1;
   size_type n2 = last2 - first2;
 
@@ -498,7 +503,7 @@ RandomAccessIterator3 merge(bulk::concurrent_group<bulk::agent<grainsize>,groups
     } // end while
   } // end else
 
-  bulk::free(exec, buffer);
+  bulk::free(exec, storage);
 
   return result;
 } // end merge()
@@ -530,21 +535,31 @@ merge_by_key(bulk::bounded<
 
   typedef typename thrust::iterator_value<RandomAccessIterator5>::type key_type;
 
-#if __CUDA_ARCH__ >= 200
-  union
-  {
-    key_type  *keys;
-    size_type *indices;
-  } stage;
+  // tuples of keys are staged as a structure of arrays
+  typedef bulk::detail::stage<key_type> key_stage_type;
+
+  const std::size_t tile_size = groupsize * grainsize;
+
+  // the indices reuse the keys' storage
+  const std::size_t keys_size    = key_stage_type::template static_storage_size<tile_size>::value;
+  const std::size_t indices_size = tile_size * sizeof(size_type);
+  const std::size_t storage_size = keys_size > indices_size ? keys_size : indices_size;
 
-  stage.keys = static_cast<key_type*>(bulk::malloc(g, groupsize * grainsize * thrust::max(sizeof(key_type), sizeof(size_type))));
+#if __CUDA_ARCH__ >= 200
+  void *storage = bulk::malloc(g, storage_size);
 #else
-  __shared__ union
+  __shared__ uninitialized_array<int4, (storage_size + sizeof(int4) - 1) / sizeof(int4)> storage_impl;
+  void *storage = storage_impl.data();
+#endif
+
+  struct
   {
-    key_type  keys[groupsize * grainsize];
-    size_type indices[groupsize * grainsize];
+    typename key_stage_type::iterator keys;
+    size_type                         *indices;
   } stage;
-#endif
+
+  stage.keys    = key_stage_type::make(storage, tile_size);
+  stage.indices = reinterpret_cast<size_type*>(storage);
 
   size_type n1 = keys_last1 - keys_first1;
   size_type n2 = keys_last2 - keys_first2;
@@ -600,7 +615,7 @@ merge_by_key(bulk::bounded<
                                values_result);
 
 #if __CUDA_ARCH__ >= 200
-  bulk::free(g, stage.keys);
+  bulk::free(g, storage);
 #endif
 
   return thrust::make_pair(keys_result, values_result);
@@ -0,0 +1,263 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/execution_policy.hpp>
+#include <bulk/malloc.hpp>
+#include <bulk/static_scratch.hpp>
+#include <bulk/uninitialized.hpp>
+#include <bulk/algorithm/reduce.hpp>
+#include <bulk/algorithm/accumulate.hpp>
+#include <bulk/algorithm/detail/warp_collectives.hpp>
+#include <thrust/detail/type_traits.h>
+#include <thrust/detail/minmax.h>
+#include <thrust/functional.h>
+#include <cuda_fp16.h>
+
+// bfloat16 arrived with CUDA 11
+#if defined(CUDART_VERSION) && (CUDART_VERSION >= 11000)
+#  include <cuda_bf16.h>
+#  define __BULK_HAS_BFLOAT16__ 1
+#else
+#  define __BULK_HAS_BFLOAT16__ 0
+#endif
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+namespace detail
+{
+namespace mixed_precision_detail
+{
+
+
+// the half precision types which may be loaded in pairs and widened to float
+template<typename T> struct packed_traits { static const bool value = false; };
+
+
+template<>
+struct packed_traits<__half>
+{
+  static const bool value = true;
+
+  typedef __half2 pair_type;
+
+  __device__ static float  widen(__half x)     { return __half2float(x); }
+  __device__ static float2 widen(__half2 x)    { return __half22float2(x); }
+};
+
+
+#if __BULK_HAS_BFLOAT16__
+template<>
+struct packed_traits<__nv_bfloat16>
+{
+  static const bool value = true;
+
+  typedef __nv_bfloat162 pair_type;
+
+  __device__ static float  widen(__nv_bfloat16 x)  { return __bfloat162float(x); }
+  __device__ static float2 widen(__nv_bfloat162 x) { return __bfloat1622float2(x); }
+};
+#endif
+
+
+template<typename T>
+struct is_packed
+  : thrust::detail::integral_constant<
+      bool,
+      packed_traits<typename thrust::detail::remove_const<T>::type>::value
+    >
+{};
+
+
+// groups of dynamic size take the generic path: packed_reduce_n strides by the static groupsize
+template<std::size_t groupsize, typename T>
+struct is_packed_for_group
+  : thrust::detail::integral_constant<
+      bool,
+      is_packed<T>::value && groupsize != bulk::dynamic_group_size
+    >
+{};
+
+
+// reduces [first, first + n) with init, loading the halves in pairs and summing them in float
+// the element before the first aligned pair and the element after the last pair are summed by agent 0
+template<std::size_t groupsize, std::size_t grainsize, typename Half, typename Size, typename BinaryFunction>
+__device__
+float packed_reduce_n(bulk::concurrent_group<bulk::agent<grainsize>,groupsize> &g,
+                      Half *first,
+                      Size n,
+                      float init,
+                      BinaryFunction binary_op)
+{
+  typedef packed_traits<typename thrust::detail::remove_const<Half>::type> traits;
+  typedef typename traits::pair_type pair_type;
+
+  const Size pairs_per_group = groupsize * grainsize;
+
+  Size tid = g.this_exec.index();
+
+  float this_sum = 0;
+  bool this_sum_defined = false;
+
+  bool has_head = n > 0 && reinterpret_cast<std::size_t>(first) % sizeof(pair_type);
+
+  if(has_head)
+  {
+    if(tid == 0)
+    {
+      this_sum = traits::widen(first[0]);
+      this_sum_defined = true;
+    } // end if
+
+    ++first;
+    --n;
+  } // end if
+
+  const pair_type *pairs = reinterpret_cast<const pair_type*>(first);
+  Size num_pairs = n / 2;
+
+  for(Size offset = 0; offset < num_pairs; offset += pairs_per_group)
+  {
+    // each agent loads grainsize pairs before summing any, so that the loads are in flight together
+    pair_type local_pairs[grainsize];
+
+    for(Size j = 0; j < grainsize; ++j)
+    {
+      Size idx = offset + groupsize * j + tid;
+
+      if(idx < num_pairs)
+      {
+        local_pairs[j] = pairs[idx];
+      } // end if
+    } // end for j
+
+    for(Size j = 0; j < grainsize; ++j)
+    {
+      Size idx = offset + groupsize * j + tid;
+
+      if(idx < num_pairs)
+      {
+        float2 x = traits::widen(local_pairs[j]);
+
+        this_sum = this_sum_defined ? binary_op(this_sum, x.x) : x.x;
+        this_sum = binary_op(this_sum, x.y);
+        this_sum_defined = true;
+      } // end if
+    } // end for j
+  } // end for offset
+
+  if((n % 2) && tid == 0)
+  {
+    float x = traits::widen(first[n - 1]);
+
+    this_sum = this_sum_defined ? binary_op(this_sum, x) : x;
+    this_sum_defined = true;
+  } // end if
+
+  // the agents which summed anything are a prefix of the group
+  Size num_sums = thrust::min<Size>(groupsize, num_pairs);
+  if(num_sums == 0 && (has_head || n % 2))
+  {
+    num_sums = 1;
+  } // end if
+
+  // whole warps reduce with shuffles rather than through a buffer
+  if(bulk::detail::has_warp_collectives(g))
+  {
+    return bulk::detail::warp_collective_reduce(g, this_sum, num_sums, init, binary_op);
+  } // end if
+
+#if __CUDA_ARCH__ >= 200
+  // prefer the static scratch, which needs neither allocation nor a barrier
+  float *buffer = reinterpret_cast<float*>(bulk::static_scratch_ptr<bulk::uninitialized_array<float,groupsize> >(g));
+  const bool dynamic_buffer = (buffer == 0);
+
+  if(dynamic_buffer)
+  {
+    buffer = reinterpret_cast<float*>(bulk::malloc(g, groupsize * sizeof(float)));
+  } // end if
+#else
+  __shared__ bulk::uninitialized_array<float,groupsize> buffer_impl;
+  float *buffer = buffer_impl.data();
+#endif
+
+  if(this_sum_defined)
+  {
+    buffer[tid] = this_sum;
+  } // end if
+
+  g.wait();
+
+  float result = bulk::detail::reduce_detail::destructive_reduce_n(g, buffer, num_sums, init, binary_op);
+
+#if __CUDA_ARCH__ >= 200
+  if(dynamic_buffer)
+  {
+    bulk::free(g, buffer);
+  } // end if
+#endif
+
+  return result;
+} // end packed_reduce_n()
+
+
+} // end mixed_precision_detail
+} // end detail
+
+
+// group reductions of half precision inputs into a float init load the inputs in pairs and sum them in float,
+// which halves the number of loads and avoids the rounding of summing in half precision
+template<std::size_t groupsize, std::size_t grainsize, typename Half, typename BinaryFunction>
+__device__
+typename thrust::detail::enable_if<
+  detail::mixed_precision_detail::is_packed_for_group<groupsize,Half>::value,
+  float
+>::type
+reduce(bulk::concurrent_group<bulk::agent<grainsize>,groupsize> &g,
+       Half *first,
+       Half *last,
+       float init,
+       BinaryFunction binary_op)
+{
+  return detail::mixed_precision_detail::packed_reduce_n(g, first, int(last - first), init, binary_op);
+} // end reduce()
+
+
+// accumulate promises to apply its operation in order, so only sums, which reordering changes only by rounding, take the packed path
+template<std::size_t groupsize, std::size_t grainsize, typename Half>
+__device__
+typename thrust::detail::enable_if<
+  detail::mixed_precision_detail::is_packed_for_group<groupsize,Half>::value,
+  float
+>::type
+accumulate(bulk::concurrent_group<bulk::agent<grainsize>,groupsize> &g,
+           Half *first,
+           Half *last,
+           float init,
+           thrust::plus<float> binary_op)
+{
+  return detail::mixed_precision_detail::packed_reduce_n(g, first, int(last - first), init, binary_op);
+} // end accumulate()
+
+
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
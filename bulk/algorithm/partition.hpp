@@ -0,0 +1,443 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/execution_policy.hpp>
+#include <bulk/malloc.hpp>
+#include <bulk/algorithm/copy.hpp>
+#include <bulk/algorithm/scan.hpp>
+#include <bulk/algorithm/detail/bucket_rank.hpp>
+#include <bulk/algorithm/detail/decoupled_look_back.hpp>
+#include <bulk/algorithm/detail/warp_collectives.hpp>
+#include <thrust/functional.h>
+#include <thrust/pair.h>
+#include <thrust/iterator/iterator_traits.h>
+#include <thrust/detail/minmax.h>
+#include <thrust/detail/type_traits.h>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+namespace detail
+{
+namespace partition_detail
+{
+
+
+// flag_rank counts the set flags of a tile of the group's elements in a single pass
+//
+// the agent's jth element is the (g.size() * j + index)th of the tile, so that loads and stores of the tile coalesce
+// flags[j] is the agent's jth flag, which must be false for elements at or beyond n
+// on return, ranks[j] is the number of set flags which precede the agent's jth element, and the number of set flags is returned
+//
+// whole warps count each round of flags with a ballot, so that only the warps' counts are scanned
+// otherwise, the flags themselves are scanned
+//
+// scratch must point to g.size() * grainsize unsigned ints visible to the whole group
+template<std::size_t groupsize, std::size_t grainsize, typename Size>
+__device__
+unsigned int flag_rank(bulk::concurrent_group<bulk::agent<grainsize>,groupsize> &g,
+                       const bool flags[grainsize],
+                       Size n,
+                       Size ranks[grainsize],
+                       unsigned int *scratch)
+{
+  typedef typename bulk::concurrent_group<bulk::agent<grainsize>,groupsize>::size_type size_type;
+
+  size_type tid = g.this_exec.index();
+
+  unsigned int result = 0;
+
+#if __BULK_HAS_BALLOT__
+  // the counts of each round's warps must fit in a single group scan
+  if(grainsize <= warp_detail::warp_size && bulk::detail::has_warp_ballot(g))
+  {
+    size_type lane = tid % warp_detail::warp_size;
+    size_type warp = tid / warp_detail::warp_size;
+    size_type num_warps = g.size() / warp_detail::warp_size;
+
+    unsigned int lanes_before = (1u << lane) - 1;
+
+    for(size_type j = 0; j < grainsize; ++j)
+    {
+      unsigned int votes = __BULK_BALLOT__(flags[j]);
+
+      ranks[j] = __popc(votes & lanes_before);
+
+      if(lane == 0)
+      {
+        scratch[j * num_warps + warp] = __popc(votes);
+      } // end if
+    } // end for j
+
+    g.wait();
+
+    // rounds are scanned in order, and the warps of each round in order
+    result = bulk::detail::scan_detail::small_inplace_exclusive_scan(g, scratch, grainsize * num_warps, 0u, thrust::plus<unsigned int>());
+
+    for(size_type j = 0; j < grainsize; ++j)
+    {
+      ranks[j] += scratch[j * num_warps + warp];
+    } // end for j
+
+    g.wait();
+
+    return result;
+  } // end if
+#endif
+
+  for(size_type j = 0; j < grainsize; ++j)
+  {
+    size_type idx = g.size() * j + tid;
+
+    if(idx < n)
+    {
+      scratch[idx] = flags[j];
+    } // end if
+  } // end for j
+
+  g.wait();
+
+  result = bulk::detail::scan_detail::scan<false>(bulk::bound<groupsize * grainsize>(g), scratch, scratch + n, scratch, 0u, thrust::plus<unsigned int>());
+
+  for(size_type j = 0; j < grainsize; ++j)
+  {
+    size_type idx = g.size() * j + tid;
+
+    if(idx < n)
+    {
+      ranks[j] = scratch[idx];
+    } // end if
+  } // end for j
+
+  g.wait();
+
+  return result;
+} // end flag_rank()
+
+
+enum partition_mode
+{
+  // copy the elements for which pred holds to out_true
+  copy_true,
+
+  // also copy the others to out_false
+  copy_both,
+
+  // also copy the others to out_true after those for which pred holds
+  copy_partitioned
+};
+
+
+// copies the elements of a tile of n <= g.size() * grainsize elements, preserving their order, as mode dictates
+// prefix(g, num_true) is called by the whole group with the number of elements for which pred holds and returns
+// how far to offset out_true, so that tiles may be chained
+// returns the number of elements for which pred holds
+template<int mode,
+         std::size_t groupsize,
+         std::size_t grainsize,
+         typename RandomAccessIterator1,
+         typename Size,
+         typename RandomAccessIterator2,
+         typename RandomAccessIterator3,
+         typename Predicate,
+         typename Prefix>
+__device__
+Size partition_copy_tile(bulk::concurrent_group<bulk::agent<grainsize>,groupsize> &g,
+                         RandomAccessIterator1 first,
+                         Size n,
+                         RandomAccessIterator2 out_true,
+                         RandomAccessIterator3 out_false,
+                         Predicate pred,
+                         unsigned int *scratch,
+                         Prefix prefix)
+{
+  typedef typename thrust::iterator_value<RandomAccessIterator1>::type value_type;
+
+  Size tid = g.this_exec.index();
+
+  value_type local_values[grainsize];
+  bool       local_flags[grainsize];
+  Size       local_ranks[grainsize];
+
+  for(Size j = 0; j < grainsize; ++j)
+  {
+    Size idx = g.size() * j + tid;
+
+    local_flags[j] = false;
+
+    if(idx < n)
+    {
+      local_values[j] = first[idx];
+      local_flags[j] = pred(local_values[j]);
+    } // end if
+  } // end for j
+
+  Size num_true = flag_rank(g, local_flags, n, local_ranks, scratch);
+
+  out_true += prefix(g, num_true);
+
+  for(Size j = 0; j < grainsize; ++j)
+  {
+    Size idx = g.size() * j + tid;
+
+    if(local_flags[j])
+    {
+      out_true[local_ranks[j]] = local_values[j];
+    } // end if
+    else if(mode == copy_both && idx < n)
+    {
+      out_false[idx - local_ranks[j]] = local_values[j];
+    } // end else if
+    else if(mode == copy_partitioned && idx < n)
+    {
+      out_true[num_true + idx - local_ranks[j]] = local_values[j];
+    } // end else if
+  } // end for j
+
+  return num_true;
+} // end partition_copy_tile()
+
+
+template<int mode,
+         std::size_t groupsize,
+         std::size_t grainsize,
+         typename RandomAccessIterator1,
+         typename RandomAccessIterator2,
+         typename RandomAccessIterator3,
+         typename Predicate>
+__device__
+thrust::pair<RandomAccessIterator2,RandomAccessIterator3>
+  partition_copy(bulk::concurrent_group<bulk::agent<grainsize>,groupsize> &g,
+                 RandomAccessIterator1 first, RandomAccessIterator1 last,
+                 RandomAccessIterator2 out_true,
+                 RandomAccessIterator3 out_false,
+                 Predicate pred)
+{
+  typedef typename bulk::concurrent_group<bulk::agent<grainsize>,groupsize>::size_type size_type;
+
+  const size_type tile_size = groupsize * grainsize;
+
+#if __CUDA_ARCH__ >= 200
+  unsigned int *scratch = static_cast<unsigned int*>(bulk::malloc(g, tile_size * sizeof(unsigned int)));
+#else
+  __shared__ unsigned int scratch[tile_size];
+#endif
+
+  size_type n = last - first;
+
+  for(size_type offset = 0; offset < n; offset += tile_size)
+  {
+    size_type tile_n = thrust::min<size_type>(tile_size, n - offset);
+
+    size_type num_true = partition_copy_tile<mode>(g, first + offset, tile_n, out_true, out_false, pred, scratch, bulk::detail::no_prefix());
+
+    out_true  += num_true;
+    out_false += (mode == copy_both) ? tile_n - num_true : 0;
+  } // end for
+
+#if __CUDA_ARCH__ >= 200
+  bulk::free(g, scratch);
+#endif
+
+  return thrust::make_pair(out_true, out_false);
+} // end partition_copy()
+
+
+} // end partition_detail
+} // end detail
+
+
+// copies the elements of [first, last) for which pred holds to result, preserving their order
+// each tile of the group's elements is compacted in a single pass
+template<std::size_t groupsize,
+         std::size_t grainsize,
+         typename RandomAccessIterator1,
+         typename RandomAccessIterator2,
+         typename Predicate>
+__device__
+RandomAccessIterator2 copy_if(bulk::concurrent_group<bulk::agent<grainsize>,groupsize> &g,
+                              RandomAccessIterator1 first, RandomAccessIterator1 last,
+                              RandomAccessIterator2 result,
+                              Predicate pred)
+{
+  return detail::partition_detail::partition_copy<detail::partition_detail::copy_true>(g, first, last, result, result, pred).first;
+} // end copy_if()
+
+
+// copies the elements of [first, last) for which pred holds to out_true, and the others to out_false,
+// preserving their order
+template<std::size_t groupsize,
+         std::size_t grainsize,
+         typename RandomAccessIterator1,
+         typename RandomAccessIterator2,
+         typename RandomAccessIterator3,
+         typename Predicate>
+__device__
+thrust::pair<RandomAccessIterator2,RandomAccessIterator3>
+  partition_copy(bulk::concurrent_group<bulk::agent<grainsize>,groupsize> &g,
+                 RandomAccessIterator1 first, RandomAccessIterator1 last,
+                 RandomAccessIterator2 out_true,
+                 RandomAccessIterator3 out_false,
+                 Predicate pred)
+{
+  return detail::partition_detail::partition_copy<detail::partition_detail::copy_both>(g, first, last, out_true, out_false, pred);
+} // end partition_copy()
+
+
+// reorders [first, last) in place so that the elements for which pred holds precede the others,
+// preserving their relative order, and returns the end of the elements for which pred holds
+template<std::size_t bound,
+         std::size_t groupsize,
+         std::size_t grainsize,
+         typename RandomAccessIterator,
+         typename Predicate>
+__device__
+typename thrust::detail::enable_if<
+  (bound <= groupsize * grainsize),
+  RandomAccessIterator
+>::type
+stable_partition(bulk::bounded<bound,bulk::concurrent_group<bulk::agent<grainsize>,groupsize> > &g,
+                 RandomAccessIterator first, RandomAccessIterator last,
+                 Predicate pred)
+{
+  typedef typename bulk::concurrent_group<bulk::agent<grainsize>,groupsize>::size_type size_type;
+
+  const size_type tile_size = groupsize * grainsize;
+
+#if __CUDA_ARCH__ >= 200
+  unsigned int *scratch = static_cast<unsigned int*>(bulk::malloc(g, tile_size * sizeof(unsigned int)));
+#else
+  __shared__ unsigned int scratch[tile_size];
+#endif
+
+  size_type n = last - first;
+
+  // flag_rank waits after every agent has loaded its elements, so the tile may be partitioned in place
+  size_type num_true = detail::partition_detail::partition_copy_tile<detail::partition_detail::copy_partitioned>(g, first, n, first, first, pred, scratch, bulk::detail::no_prefix());
+
+  g.wait();
+
+#if __CUDA_ARCH__ >= 200
+  bulk::free(g, scratch);
+#endif
+
+  return first + num_true;
+} // end stable_partition()
+
+
+// partition is stable
+template<std::size_t bound,
+         std::size_t groupsize,
+         std::size_t grainsize,
+         typename RandomAccessIterator,
+         typename Predicate>
+__device__
+typename thrust::detail::enable_if<
+  (bound <= groupsize * grainsize),
+  RandomAccessIterator
+>::type
+partition(bulk::bounded<bound,bulk::concurrent_group<bulk::agent<grainsize>,groupsize> > &g,
+          RandomAccessIterator first, RandomAccessIterator last,
+          Predicate pred)
+{
+  return bulk::stable_partition(g, first, last, pred);
+} // end partition()
+
+
+// stably partitions [first, last) into num_buckets buckets, where bucket_index(x) < num_buckets names the bucket of x,
+// and stores the result to result, which may be first
+// on return, bucket_begins[b] is the position in result of bucket b's first element
+template<std::size_t num_buckets,
+         std::size_t bound,
+         std::size_t groupsize,
+         std::size_t grainsize,
+         typename RandomAccessIterator1,
+         typename RandomAccessIterator2,
+         typename BucketFunction,
+         typename RandomAccessIterator3>
+__device__
+typename thrust::detail::enable_if<
+  (bound <= groupsize * grainsize)
+>::type
+multisplit(bulk::bounded<bound,bulk::concurrent_group<bulk::agent<grainsize>,groupsize> > &g,
+           RandomAccessIterator1 first, RandomAccessIterator1 last,
+           RandomAccessIterator2 result,
+           BucketFunction bucket_index,
+           RandomAccessIterator3 bucket_begins)
+{
+  typedef typename thrust::iterator_value<RandomAccessIterator1>::type value_type;
+  typedef typename bulk::concurrent_group<bulk::agent<grainsize>,groupsize>::size_type size_type;
+
+  typedef detail::bucket_rank_counters<num_buckets,groupsize> counters_type;
+
+#if __CUDA_ARCH__ >= 200
+  unsigned int *counters = static_cast<unsigned int*>(bulk::malloc(g, counters_type::size * sizeof(unsigned int)));
+#else
+  __shared__ unsigned int counters[counters_type::size];
+#endif
+
+  size_type tid = g.this_exec.index();
+  size_type n = last - first;
+
+  size_type local_offset = grainsize * tid;
+  size_type local_size = thrust::max<size_type>(0, thrust::min<size_type>(grainsize, n - local_offset));
+
+  value_type   local_values[grainsize];
+  unsigned int local_buckets[grainsize];
+  size_type    local_ranks[grainsize];
+
+  bulk::copy_n(bulk::bound<grainsize>(g.this_exec), first + local_offset, local_size, local_values);
+
+  for(size_type j = 0; j < grainsize; ++j)
+  {
+    if(j < local_size)
+    {
+      local_buckets[j] = bucket_index(local_values[j]);
+    } // end if
+  } // end for j
+
+  // bucket_rank waits after every agent has loaded its elements, so result may be first
+  detail::bucket_rank<num_buckets>(g, local_buckets, local_size, local_ranks, counters);
+
+  for(size_type j = 0; j < grainsize; ++j)
+  {
+    if(j < local_size)
+    {
+      result[local_ranks[j]] = local_values[j];
+    } // end if
+  } // end for j
+
+  for(size_type b = tid; b < num_buckets; b += g.size())
+  {
+    bucket_begins[b] = detail::bucket_begin<groupsize>(counters, b);
+  } // end for b
+
+  g.wait();
+
+#if __CUDA_ARCH__ >= 200
+  bulk::free(g, counters);
+#endif
+} // end multisplit()
+
+
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
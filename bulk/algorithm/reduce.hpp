@@ -19,8 +19,10 @@
 #include <bulk/detail/config.hpp>
 #include <bulk/algorithm/copy.hpp>
 #include <bulk/malloc.hpp>
+#include <bulk/static_scratch.hpp>
 #include <bulk/uninitialized.hpp>
 #include <bulk/iterator/strided_iterator.hpp>
+#include <bulk/algorithm/detail/warp_collectives.hpp>
 #include <thrust/iterator/iterator_traits.h>
 #include <thrust/detail/minmax.h>
 
@@ -194,8 +196,21 @@ T reduce(bulk::concurrent_group<bulk::agent<grainsize>,groupsize> &g,
     this_sum_defined = true;
   } // end for
 
+  // whole warps reduce with shuffles rather than through a buffer
+  if(bulk::detail::has_warp_collectives(g))
+  {
+    return bulk::detail::warp_collective_reduce(g, this_sum, thrust::min<size_type>(groupsize,n), init, binary_op);
+  } // end if
+
 #if __CUDA_ARCH__ >= 200
-  T *buffer = reinterpret_cast<T*>(bulk::malloc(g, groupsize * sizeof(T)));
+  // prefer the static scratch, which needs neither allocation nor a barrier
+  T *buffer = reinterpret_cast<T*>(bulk::static_scratch_ptr<bulk::uninitialized_array<T,groupsize> >(g));
+  const bool dynamic_buffer = (buffer == 0);
+
+  if(dynamic_buffer)
+  {
+    buffer = reinterpret_cast<T*>(bulk::malloc(g, groupsize * sizeof(T)));
+  } // end if
 #else
   __shared__ bulk::uninitialized_array<T,groupsize> buffer_impl;
   T *buffer = buffer_impl.data();
@@ -212,7 +227,10 @@ T reduce(bulk::concurrent_group<bulk::agent<grainsize>,groupsize> &g,
   T result = bulk::detail::reduce_detail::destructive_reduce_n(g, buffer, thrust::min<size_type>(groupsize,n), init, binary_op);
 
 #if __CUDA_ARCH__ >= 200
-  bulk::free(g,buffer);
+  if(dynamic_buffer)
+  {
+    bulk::free(g,buffer);
+  } // end if
 #endif
 
   return result;
@@ -237,17 +255,25 @@ T reduce(bulk::concurrent_group<> &g,
 
   typename thrust::iterator_difference<RandomAccessIterator>::type n = last - first;
 
-  T *buffer = reinterpret_cast<T*>(bulk::malloc(g, g.size() * sizeof(T)));
-
   for(size_type i = tid; i < n; i += g.size())
   {
     typedef typename thrust::iterator_value<RandomAccessIterator>::type input_type;
     input_type x = first[i];
-    this_sum = this_sum_defined ? binary_op(this_sum, x) : x;
+
+    // convert x explicitly, lest the conditional be ambiguous between types which convert both ways, e.g. __half & float
+    this_sum = this_sum_defined ? binary_op(this_sum, x) : T(x);
 
     this_sum_defined = true;
   }
 
+  // whole warps reduce with shuffles rather than through a buffer
+  if(bulk::detail::has_warp_collectives(g))
+  {
+    return bulk::detail::warp_collective_reduce(g, this_sum, thrust::min<size_type>(g.size(),n), init, binary_op);
+  } // end if
+
+  T *buffer = reinterpret_cast<T*>(bulk::malloc(g, g.size() * sizeof(T)));
+
   if(this_sum_defined)
   {
     buffer[tid] = this_sum;
@@ -22,6 +22,8 @@
 #include <bulk/algorithm/scan.hpp>
 #include <bulk/algorithm/scatter.hpp>
 #include <bulk/malloc.hpp>
+#include <bulk/dispatch_bound.hpp>
+#include <bulk/algorithm/detail/staging.hpp>
 #include <bulk/detail/head_flags.hpp>
 #include <bulk/detail/tail_flags.hpp>
 #include <thrust/detail/type_traits/function_traits.h>
@@ -108,6 +110,40 @@ void scatter_tails_n(ConcurrentGroup &group,
 } // end scatter_tails_n()
 
 
+template<typename ConcurrentGroup, typename RandomAccessIterator1, typename Size, typename RandomAccessIterator2>
+struct bounded_copy_n
+{
+  ConcurrentGroup &g;
+  RandomAccessIterator1 first;
+  Size n;
+  RandomAccessIterator2 result;
+
+  __device__
+  bounded_copy_n(ConcurrentGroup &g, RandomAccessIterator1 first, Size n, RandomAccessIterator2 result)
+    : g(g), first(first), n(n), result(result)
+  {}
+
+  template<std::size_t bound>
+  __device__
+  void operator()(bulk::bound_constant<bound>)
+  {
+    bulk::copy_n(bulk::bound<bound>(g), first, n, result);
+  }
+};
+
+
+// copies a tile of at most interval_size elements with the smallest bound which covers it,
+// so that the last, partial tile of an input visits only the rows it occupies
+template<std::size_t interval_size, typename ConcurrentGroup, typename RandomAccessIterator1, typename Size, typename RandomAccessIterator2>
+__device__
+void copy_tile_n(ConcurrentGroup &g, RandomAccessIterator1 first, Size n, RandomAccessIterator2 result)
+{
+  bounded_copy_n<ConcurrentGroup,RandomAccessIterator1,Size,RandomAccessIterator2> f(g, first, n, result);
+
+  bulk::dispatch_bound<interval_size / 4, interval_size / 2, interval_size>(n, f);
+} // end copy_tile_n()
+
+
 } // end reduce_by_key_detail
 } // end detail
 
@@ -146,8 +182,12 @@ reduce_by_key(bulk::concurrent_group<bulk::agent<grainsize>,groupsize> &g,
   const size_type interval_size = groupsize * grainsize;
 
 #if __CUDA_ARCH__ >= 200
+  // tuples of values are staged as a structure of arrays
+  typedef bulk::detail::stage<value_type> value_stage_type;
+
   size_type *s_flags = reinterpret_cast<size_type*>(bulk::malloc(g, interval_size * sizeof(int)));
-  value_type *s_values = reinterpret_cast<value_type*>(bulk::malloc(g, interval_size * sizeof(value_type)));
+  void *s_values_storage = bulk::malloc(g, value_stage_type::storage_size(interval_size));
+  typename value_stage_type::iterator s_values = value_stage_type::make(s_values_storage, interval_size);
 #else
   __shared__ uninitialized_array<size_type,interval_size> s_flags_impl;
   size_type *s_flags = s_flags_impl.data();
@@ -170,10 +210,10 @@ reduce_by_key(bulk::concurrent_group<bulk::agent<grainsize>,groupsize> &g,
     detail::reduce_by_key_detail::scan_head_flags_functor<size_type, value_type, BinaryFunction> f(binary_op);
 
     // load input into smem
-    bulk::copy_n(bulk::bound<interval_size>(g),
-                 thrust::make_zip_iterator(thrust::make_tuple(flags.begin(), values_first)),
-                 n,
-                 thrust::make_zip_iterator(thrust::make_tuple(s_flags, s_values)));
+    detail::reduce_by_key_detail::copy_tile_n<interval_size>(g,
+                                                             thrust::make_zip_iterator(thrust::make_tuple(flags.begin(), values_first)),
+                                                             n,
+                                                             thrust::make_zip_iterator(thrust::make_tuple(s_flags, s_values)));
 
     // scan in smem
     bulk::inclusive_scan(bulk::bound<interval_size>(g),
@@ -209,7 +249,7 @@ reduce_by_key(bulk::concurrent_group<bulk::agent<grainsize>,groupsize> &g,
 
 #if __CUDA_ARCH__ >= 200
   bulk::free(g, s_flags);
-  bulk::free(g, s_values);
+  bulk::free(g, s_values_storage);
 #endif
 
   return thrust::make_tuple(keys_result, values_result, init_key, init_value);
@@ -21,6 +21,7 @@
 #include <bulk/malloc.hpp>
 #include <bulk/algorithm/copy.hpp>
 #include <bulk/algorithm/accumulate.hpp>
+#include <bulk/algorithm/detail/warp_collectives.hpp>
 #include <bulk/uninitialized.hpp>
 #include <thrust/detail/type_traits.h>
 #include <thrust/detail/type_traits/function_traits.h>
@@ -103,6 +104,12 @@ __device__ T inplace_exclusive_scan(ConcurrentGroup &g, RandomAccessIterator fir
 {
   typedef typename ConcurrentGroup::size_type size_type;
 
+  // whole warps scan with shuffles rather than a wait per step
+  if(bulk::detail::has_warp_collectives(g))
+  {
+    return bulk::detail::warp_collective_inplace_exclusive_scan(g, first, g.size(), init, binary_op);
+  } // end if
+
   size_type tid = g.this_exec.index();
 
   if(tid == 0)
@@ -154,6 +161,12 @@ __device__ T small_inplace_exclusive_scan(ConcurrentGroup &g, RandomAccessIterat
 {
   typedef typename ConcurrentGroup::size_type size_type;
 
+  // whole warps scan with shuffles rather than a wait per step
+  if(bulk::detail::has_warp_collectives(g))
+  {
+    return bulk::detail::warp_collective_inplace_exclusive_scan(g, first, n, init, binary_op);
+  } // end if
+
   size_type tid = g.this_exec.index();
 
   if(tid == 0)
@@ -18,6 +18,13 @@
 
 #include <bulk/detail/config.hpp>
 #include <bulk/execution_policy.hpp>
+#include <bulk/malloc.hpp>
+#include <bulk/uninitialized.hpp>
+#include <bulk/algorithm/copy.hpp>
+#include <bulk/algorithm/partition.hpp>
+#include <thrust/iterator/constant_iterator.h>
+#include <thrust/iterator/iterator_traits.h>
+#include <thrust/detail/minmax.h>
 
 BULK_NAMESPACE_PREFIX
 namespace bulk
@@ -197,6 +204,190 @@ void scatter_if(bulk::concurrent_group<bulk::agent<grainsize>,groupsize> &g,
 } // end scatter_if
 
 
+namespace detail
+{
+namespace scatter_detail
+{
+
+
+// scatters the selected elements of a tile of n <= g.size() * grainsize elements
+// the selected elements are ranked within the tile and staged, together with their destinations, in rank order,
+// so that consecutive agents store consecutive selected elements rather than leaving holes for the unselected ones
+// when the staged destinations form a single run, as they do when map is increasing and dense after a partition,
+// the run is stored with a (vectorized when possible) copy
+// scratch must point to g.size() * grainsize unsigned ints visible to the whole group
+template<std::size_t groupsize,
+         std::size_t grainsize,
+         typename RandomAccessIterator1,
+         typename Size,
+         typename RandomAccessIterator2,
+         typename RandomAccessIterator3,
+         typename RandomAccessIterator4>
+__device__
+void coalesced_scatter_if_tile(bulk::concurrent_group<bulk::agent<grainsize>,groupsize> &g,
+                               RandomAccessIterator1 first,
+                               Size n,
+                               RandomAccessIterator2 map,
+                               RandomAccessIterator3 stencil,
+                               RandomAccessIterator4 result,
+                               typename thrust::iterator_value<RandomAccessIterator1>::type *s_values,
+                               typename thrust::iterator_value<RandomAccessIterator2>::type *s_map,
+                               unsigned int *scratch)
+{
+  typedef typename thrust::iterator_value<RandomAccessIterator1>::type value_type;
+  typedef typename thrust::iterator_value<RandomAccessIterator2>::type map_type;
+
+  Size tid = g.this_exec.index();
+
+  value_type local_values[grainsize];
+  map_type   local_map[grainsize];
+  bool       local_flags[grainsize];
+  Size       local_ranks[grainsize];
+
+  for(Size j = 0; j < grainsize; ++j)
+  {
+    Size idx = g.size() * j + tid;
+
+    local_flags[j] = false;
+
+    if(idx < n && stencil[idx])
+    {
+      local_flags[j]  = true;
+      local_values[j] = first[idx];
+      local_map[j]    = map[idx];
+    } // end if
+  } // end for j
+
+  Size num_selected = bulk::detail::partition_detail::flag_rank(g, local_flags, n, local_ranks, scratch);
+
+  for(Size j = 0; j < grainsize; ++j)
+  {
+    if(local_flags[j])
+    {
+      s_values[local_ranks[j]] = local_values[j];
+      s_map[local_ranks[j]]    = local_map[j];
+    } // end if
+  } // end for j
+
+  // flag_rank is done with scratch, so its first word tracks whether the destinations form a single run
+  if(tid == 0)
+  {
+    scratch[0] = 1;
+  } // end if
+
+  g.wait();
+
+  for(Size k = tid + 1; k < num_selected; k += g.size())
+  {
+    if(s_map[k] != s_map[k-1] + 1)
+    {
+      scratch[0] = 0;
+    } // end if
+  } // end for k
+
+  g.wait();
+
+  bool is_run = scratch[0];
+
+  // every agent must read scratch[0] before the next tile's flag_rank reuses it
+  g.wait();
+
+  if(is_run)
+  {
+    if(num_selected > 0)
+    {
+      bulk::copy_n(g, s_values, num_selected, result + s_map[0]);
+    } // end if
+  } // end if
+  else
+  {
+    for(Size k = tid; k < num_selected; k += g.size())
+    {
+      result[s_map[k]] = s_values[k];
+    } // end for k
+  } // end else
+
+  // the next tile restages s_values & s_map
+  g.wait();
+} // end coalesced_scatter_if_tile()
+
+
+} // end scatter_detail
+} // end detail
+
+
+// a scatter_if whose stores coalesce even when few elements are selected or map skips around:
+// each tile of the group's elements stages its selected elements in order through the group's heap before storing them
+// it requires g.size() * grainsize * (sizeof(value_type) + sizeof(map_type) + sizeof(unsigned int)) bytes of heap
+template<std::size_t groupsize,
+         std::size_t grainsize,
+         typename RandomAccessIterator1, 
+         typename RandomAccessIterator2,
+         typename RandomAccessIterator3,
+         typename RandomAccessIterator4>
+__device__
+void coalesced_scatter_if(bulk::concurrent_group<bulk::agent<grainsize>,groupsize> &g,
+                          RandomAccessIterator1 first,
+                          RandomAccessIterator1 last,
+                          RandomAccessIterator2 map,
+                          RandomAccessIterator3 stencil,
+                          RandomAccessIterator4 result)
+{
+  typedef typename bulk::concurrent_group<bulk::agent<grainsize>,groupsize>::size_type size_type;
+  typedef typename thrust::iterator_value<RandomAccessIterator1>::type value_type;
+  typedef typename thrust::iterator_value<RandomAccessIterator2>::type map_type;
+
+  const size_type tile_size = groupsize * grainsize;
+
+#if __CUDA_ARCH__ >= 200
+  value_type   *s_values = static_cast<value_type*>(bulk::malloc(g, tile_size * sizeof(value_type)));
+  map_type     *s_map    = static_cast<map_type*>(bulk::malloc(g, tile_size * sizeof(map_type)));
+  unsigned int *scratch  = static_cast<unsigned int*>(bulk::malloc(g, tile_size * sizeof(unsigned int)));
+#else
+  __shared__ uninitialized_array<value_type,tile_size> s_values_impl;
+  value_type *s_values = s_values_impl.data();
+
+  __shared__ uninitialized_array<map_type,tile_size> s_map_impl;
+  map_type *s_map = s_map_impl.data();
+
+  __shared__ unsigned int scratch[tile_size];
+#endif
+
+  size_type n = last - first;
+
+  for(size_type offset = 0; offset < n; offset += tile_size)
+  {
+    size_type tile_n = thrust::min<size_type>(tile_size, n - offset);
+
+    detail::scatter_detail::coalesced_scatter_if_tile(g, first + offset, tile_n, map + offset, stencil + offset, result, s_values, s_map, scratch);
+  } // end for
+
+#if __CUDA_ARCH__ >= 200
+  bulk::free(g, s_values);
+  bulk::free(g, s_map);
+  bulk::free(g, scratch);
+#endif
+} // end coalesced_scatter_if()
+
+
+// stores first[i] to result[map[i]] for each i in [0, last - first), staging each tile as coalesced_scatter_if does
+// when map is increasing and dense, as after a partition, each tile is stored with a single copy
+template<std::size_t groupsize,
+         std::size_t grainsize,
+         typename RandomAccessIterator1, 
+         typename RandomAccessIterator2,
+         typename RandomAccessIterator3>
+__device__
+void coalesced_scatter(bulk::concurrent_group<bulk::agent<grainsize>,groupsize> &g,
+                       RandomAccessIterator1 first,
+                       RandomAccessIterator1 last,
+                       RandomAccessIterator2 map,
+                       RandomAccessIterator3 result)
+{
+  bulk::coalesced_scatter_if(g, first, last, map, thrust::make_constant_iterator(true), result);
+} // end coalesced_scatter()
+
+
 } // end bulk
 BULK_NAMESPACE_SUFFIX
 
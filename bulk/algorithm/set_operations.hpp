@@ -0,0 +1,590 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/execution_policy.hpp>
+#include <bulk/malloc.hpp>
+#include <bulk/algorithm/scan.hpp>
+#include <bulk/algorithm/detail/decoupled_look_back.hpp>
+#include <thrust/functional.h>
+#include <thrust/pair.h>
+#include <thrust/iterator/iterator_traits.h>
+#include <thrust/detail/type_traits.h>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+namespace detail
+{
+namespace set_operations_detail
+{
+
+
+enum set_operation_kind
+{
+  intersection_op,
+  union_op,
+  difference_op,
+  symmetric_difference_op
+};
+
+
+// the kth copy of a key in one input is matched by the kth copy of an equivalent key in the other input, if any
+// each operation keeps some of the matched and unmatched keys of each input:
+//
+//                          first input   second input
+// intersection             matched       none
+// union                    all           unmatched
+// difference               unmatched     none
+// symmetric_difference     unmatched     unmatched
+//
+// the kept keys are emitted in merged order, which is the order of std::set_intersection & friends
+
+
+template<int op>
+__device__
+inline bool keeps_first(bool matched)
+{
+  return (op == intersection_op) ? matched : (op == union_op) ? true : !matched;
+} // end keeps_first()
+
+
+template<int op>
+struct keeps_second
+{
+  static const bool any = (op == union_op) || (op == symmetric_difference_op);
+};
+
+
+template<typename RandomAccessIterator, typename Size, typename T, typename Compare>
+__device__
+Size lower_bound_n(RandomAccessIterator first, Size n, const T &value, Compare comp)
+{
+  Size begin = 0;
+  Size end = n;
+
+  while(begin < end)
+  {
+    Size mid = (begin + end) >> 1;
+
+    if(comp(first[mid], value))
+    {
+      begin = mid + 1;
+    } // end if
+    else
+    {
+      end = mid;
+    } // end else
+  } // end while
+
+  return begin;
+} // end lower_bound_n()
+
+
+template<typename RandomAccessIterator, typename Size, typename T, typename Compare>
+__device__
+Size upper_bound_n(RandomAccessIterator first, Size n, const T &value, Compare comp)
+{
+  Size begin = 0;
+  Size end = n;
+
+  while(begin < end)
+  {
+    Size mid = (begin + end) >> 1;
+
+    if(comp(value, first[mid]))
+    {
+      end = mid;
+    } // end if
+    else
+    {
+      begin = mid + 1;
+    } // end else
+  } // end while
+
+  return begin;
+} // end upper_bound_n()
+
+
+// a tile is a (possibly staged) copy of the keys [begin, begin + n) of a whole input of whole_n keys
+// matching looks outside the tile only when a run of equivalent keys crosses its bounds,
+// so the common case never leaves the stage
+template<typename RandomAccessIterator1, typename RandomAccessIterator2, typename Size>
+struct tile
+{
+  typedef RandomAccessIterator1 iterator;
+  typedef Size                  size_type;
+
+  RandomAccessIterator1 first;
+  Size                  n;
+  RandomAccessIterator2 whole_first;
+  Size                  begin;
+  Size                  whole_n;
+
+  __device__
+  tile(RandomAccessIterator1 first, Size n, RandomAccessIterator2 whole_first, Size begin, Size whole_n)
+    : first(first), n(n), whole_first(whole_first), begin(begin), whole_n(whole_n)
+  {}
+
+  __device__
+  typename thrust::iterator_value<RandomAccessIterator1>::type
+    operator[](Size i) const
+  {
+    return (begin <= i && i < begin + n) ? first[i - begin] : whole_first[i];
+  }
+
+  // the index into the whole input of the first key not before value,
+  // given that it is no later than begin + local_n
+  template<typename T, typename Compare>
+  __device__
+  Size lower_bound(Size local_n, const T &value, Compare comp) const
+  {
+    Size i = lower_bound_n(first, local_n, value, comp);
+
+    if(i == 0 && begin > 0 && !comp(whole_first[begin - 1], value))
+    {
+      // the run of value begins before the tile
+      return lower_bound_n(whole_first, begin, value, comp);
+    } // end if
+
+    return begin + i;
+  }
+}; // end tile
+
+
+// returns whether the key at index i of the whole input of x is matched in the whole input of y,
+// given the index lb into the whole input of y of the first key not before it
+template<typename Tile1, typename Size, typename Tile2, typename Compare>
+__device__
+bool is_matched(const Tile1 &x, Size i, const Tile2 &y, Size lb, Compare comp)
+{
+  typename thrust::iterator_value<typename Tile1::iterator>::type key = x.first[i - x.begin];
+
+  // the rank of this key among its equivalents in x
+  Size rank = i - x.lower_bound(i - x.begin, key, comp);
+
+  Size j = lb + rank;
+
+  return j < y.whole_n && !comp(key, y[j]);
+} // end is_matched()
+
+
+// each agent decides which of its grainsize keys of the concatenation of the tiles to keep,
+// the group scans the decisions, and each agent scatters the keys it keeps to their place in merged order
+//
+// the tiles must be consecutive in merged order: every key of the second input before the second tile must
+// precede every key of the first tile, and every one after must follow it
+// this is what a merge path split yields, and holds trivially when the tiles are whole
+//
+// prefix(g, n) is called by the whole group with the number of keys this tile emits and returns
+// the number emitted before it, so that tiles may be chained
+//
+// ranks is scratch of at least bound + 1 elements, and the number of emitted keys is returned
+template<int op,
+         bool has_values,
+         std::size_t bound, std::size_t groupsize, std::size_t grainsize,
+         typename Tile1,
+         typename Tile2,
+         typename RandomAccessIterator1,
+         typename RandomAccessIterator2,
+         typename RandomAccessIterator3,
+         typename RandomAccessIterator4,
+         typename Compare,
+         typename Prefix>
+__device__
+typename Tile1::size_type
+  set_operation(bulk::bounded<bound,bulk::concurrent_group<bulk::agent<grainsize>,groupsize> > &g,
+                const Tile1 &tile1,
+                const Tile2 &tile2,
+                RandomAccessIterator1 values_first1,
+                RandomAccessIterator2 values_first2,
+                RandomAccessIterator3 keys_result,
+                RandomAccessIterator4 values_result,
+                unsigned int *ranks,
+                Compare comp,
+                Prefix prefix)
+{
+  typedef typename Tile1::size_type size_type;
+
+  size_type n1 = tile1.n;
+  size_type n2 = tile2.n;
+  size_type n = n1 + n2;
+
+  size_type local_offset = grainsize * g.this_exec.index();
+
+  // for each key, the local index of where it falls in the other tile
+  size_type local_others[grainsize];
+  bool      local_kept[grainsize];
+
+  for(size_type k = 0; k < grainsize; ++k)
+  {
+    size_type idx = local_offset + k;
+
+    local_kept[k] = false;
+
+    if(idx < n1)
+    {
+      size_type lb = lower_bound_n(tile2.first, n2, tile1.first[idx], comp);
+
+      local_others[k] = lb;
+
+      // keys of the second input outside its tile never tie with this one, so lb is exact
+      local_kept[k] = (op == union_op) || keeps_first<op>(is_matched(tile1, tile1.begin + idx, tile2, tile2.begin + lb, comp));
+    } // end if
+    else if(keeps_second<op>::any && idx < n)
+    {
+      size_type j = idx - n1;
+
+      typename thrust::iterator_value<typename Tile2::iterator>::type key = tile2.first[j];
+
+      // keys of the first input which tie with this one precede it in merged order
+      size_type ub = upper_bound_n(tile1.first, n1, key, comp);
+
+      local_others[k] = ub;
+
+      local_kept[k] = !is_matched(tile2, tile2.begin + j, tile1, tile1.lower_bound(ub, key, comp), comp);
+    } // end else if
+
+    if(idx < n)
+    {
+      ranks[idx] = local_kept[k];
+    } // end if
+  } // end for k
+
+  g.wait();
+
+  size_type num_kept = bulk::detail::scan_detail::scan<false>(g, ranks, ranks + n, ranks, 0u, thrust::plus<unsigned int>());
+
+  if(g.this_exec.index() == 0)
+  {
+    ranks[n] = num_kept;
+  } // end if
+
+  g.wait();
+
+  size_type offset = prefix(g, num_kept);
+
+  // the kept keys of each tile are counted from the start of its ranks
+  size_type num_kept1 = ranks[n1];
+
+  for(size_type k = 0; k < grainsize; ++k)
+  {
+    size_type idx = local_offset + k;
+
+    if(local_kept[k])
+    {
+      if(idx < n1)
+      {
+        size_type dst = offset + ranks[idx] + (ranks[n1 + local_others[k]] - num_kept1);
+
+        keys_result[dst] = tile1.first[idx];
+
+        if(has_values)
+        {
+          values_result[dst] = values_first1[tile1.begin + idx];
+        } // end if
+      } // end if
+      else
+      {
+        size_type j = idx - n1;
+        size_type dst = offset + (ranks[idx] - num_kept1) + ranks[local_others[k]];
+
+        keys_result[dst] = tile2.first[j];
+
+        if(has_values)
+        {
+          values_result[dst] = values_first2[tile2.begin + j];
+        } // end if
+      } // end else
+    } // end if
+  } // end for k
+
+  g.wait();
+
+  return num_kept;
+} // end set_operation()
+
+
+template<int op,
+         bool has_values,
+         std::size_t bound, std::size_t groupsize, std::size_t grainsize,
+         typename RandomAccessIterator1,
+         typename RandomAccessIterator2,
+         typename RandomAccessIterator3,
+         typename RandomAccessIterator4,
+         typename RandomAccessIterator5,
+         typename RandomAccessIterator6,
+         typename Compare>
+__device__
+typename bulk::bounded<bound,bulk::concurrent_group<bulk::agent<grainsize>,groupsize> >::size_type
+  set_operation(bulk::bounded<bound,bulk::concurrent_group<bulk::agent<grainsize>,groupsize> > &g,
+                RandomAccessIterator1 keys_first1, RandomAccessIterator1 keys_last1,
+                RandomAccessIterator2 keys_first2, RandomAccessIterator2 keys_last2,
+                RandomAccessIterator3 values_first1,
+                RandomAccessIterator4 values_first2,
+                RandomAccessIterator5 keys_result,
+                RandomAccessIterator6 values_result,
+                Compare comp)
+{
+  typedef typename bulk::bounded<bound,bulk::concurrent_group<bulk::agent<grainsize>,groupsize> >::size_type size_type;
+
+  size_type n1 = keys_last1 - keys_first1;
+  size_type n2 = keys_last2 - keys_first2;
+
+  tile<RandomAccessIterator1,RandomAccessIterator1,size_type> tile1(keys_first1, n1, keys_first1, 0, n1);
+  tile<RandomAccessIterator2,RandomAccessIterator2,size_type> tile2(keys_first2, n2, keys_first2, 0, n2);
+
+#if __CUDA_ARCH__ >= 200
+  unsigned int *ranks = static_cast<unsigned int*>(bulk::malloc(g, (bound + 1) * sizeof(unsigned int)));
+#else
+  __shared__ unsigned int ranks[bound + 1];
+#endif
+
+  size_type result = set_operation<op,has_values>(g, tile1, tile2, values_first1, values_first2, keys_result, values_result, ranks, comp, bulk::detail::no_prefix());
+
+#if __CUDA_ARCH__ >= 200
+  bulk::free(g, ranks);
+#endif
+
+  return result;
+} // end set_operation()
+
+
+} // end set_operations_detail
+} // end detail
+
+
+// the set operations of sorted ranges, with the semantics of their namesakes in the standard library:
+// equivalent keys are multisets, and kept keys appear in merged order, ties taking the first range first
+// the result must not overlap either input
+
+
+template<std::size_t bound, std::size_t groupsize, std::size_t grainsize,
+         typename RandomAccessIterator1,
+         typename RandomAccessIterator2,
+         typename RandomAccessIterator3,
+         typename Compare>
+__device__
+typename thrust::detail::enable_if<
+  (bound <= groupsize * grainsize),
+  RandomAccessIterator3
+>::type
+set_intersection(bulk::bounded<bound,bulk::concurrent_group<bulk::agent<grainsize>,groupsize> > &g,
+                 RandomAccessIterator1 first1, RandomAccessIterator1 last1,
+                 RandomAccessIterator2 first2, RandomAccessIterator2 last2,
+                 RandomAccessIterator3 result,
+                 Compare comp)
+{
+  namespace ns = detail::set_operations_detail;
+  return result + ns::set_operation<ns::intersection_op,false>(g, first1, last1, first2, last2, first1, first2, result, result, comp);
+} // end set_intersection()
+
+
+template<std::size_t bound, std::size_t groupsize, std::size_t grainsize,
+         typename RandomAccessIterator1,
+         typename RandomAccessIterator2,
+         typename RandomAccessIterator3,
+         typename Compare>
+__device__
+typename thrust::detail::enable_if<
+  (bound <= groupsize * grainsize),
+  RandomAccessIterator3
+>::type
+set_union(bulk::bounded<bound,bulk::concurrent_group<bulk::agent<grainsize>,groupsize> > &g,
+          RandomAccessIterator1 first1, RandomAccessIterator1 last1,
+          RandomAccessIterator2 first2, RandomAccessIterator2 last2,
+          RandomAccessIterator3 result,
+          Compare comp)
+{
+  namespace ns = detail::set_operations_detail;
+  return result + ns::set_operation<ns::union_op,false>(g, first1, last1, first2, last2, first1, first2, result, result, comp);
+} // end set_union()
+
+
+template<std::size_t bound, std::size_t groupsize, std::size_t grainsize,
+         typename RandomAccessIterator1,
+         typename RandomAccessIterator2,
+         typename RandomAccessIterator3,
+         typename Compare>
+__device__
+typename thrust::detail::enable_if<
+  (bound <= groupsize * grainsize),
+  RandomAccessIterator3
+>::type
+set_difference(bulk::bounded<bound,bulk::concurrent_group<bulk::agent<grainsize>,groupsize> > &g,
+               RandomAccessIterator1 first1, RandomAccessIterator1 last1,
+               RandomAccessIterator2 first2, RandomAccessIterator2 last2,
+               RandomAccessIterator3 result,
+               Compare comp)
+{
+  namespace ns = detail::set_operations_detail;
+  return result + ns::set_operation<ns::difference_op,false>(g, first1, last1, first2, last2, first1, first2, result, result, comp);
+} // end set_difference()
+
+
+template<std::size_t bound, std::size_t groupsize, std::size_t grainsize,
+         typename RandomAccessIterator1,
+         typename RandomAccessIterator2,
+         typename RandomAccessIterator3,
+         typename Compare>
+__device__
+typename thrust::detail::enable_if<
+  (bound <= groupsize * grainsize),
+  RandomAccessIterator3
+>::type
+set_symmetric_difference(bulk::bounded<bound,bulk::concurrent_group<bulk::agent<grainsize>,groupsize> > &g,
+                         RandomAccessIterator1 first1, RandomAccessIterator1 last1,
+                         RandomAccessIterator2 first2, RandomAccessIterator2 last2,
+                         RandomAccessIterator3 result,
+                         Compare comp)
+{
+  namespace ns = detail::set_operations_detail;
+  return result + ns::set_operation<ns::symmetric_difference_op,false>(g, first1, last1, first2, last2, first1, first2, result, result, comp);
+} // end set_symmetric_difference()
+
+
+// the values of kept keys of the first range are taken from values_first1
+template<std::size_t bound, std::size_t groupsize, std::size_t grainsize,
+         typename RandomAccessIterator1,
+         typename RandomAccessIterator2,
+         typename RandomAccessIterator3,
+         typename RandomAccessIterator4,
+         typename RandomAccessIterator5,
+         typename Compare>
+__device__
+typename thrust::detail::enable_if<
+  (bound <= groupsize * grainsize),
+  thrust::pair<RandomAccessIterator4,RandomAccessIterator5>
+>::type
+set_intersection_by_key(bulk::bounded<bound,bulk::concurrent_group<bulk::agent<grainsize>,groupsize> > &g,
+                        RandomAccessIterator1 keys_first1, RandomAccessIterator1 keys_last1,
+                        RandomAccessIterator2 keys_first2, RandomAccessIterator2 keys_last2,
+                        RandomAccessIterator3 values_first1,
+                        RandomAccessIterator4 keys_result,
+                        RandomAccessIterator5 values_result,
+                        Compare comp)
+{
+  namespace ns = detail::set_operations_detail;
+
+  typename bulk::bounded<bound,bulk::concurrent_group<bulk::agent<grainsize>,groupsize> >::size_type n =
+    ns::set_operation<ns::intersection_op,true>(g, keys_first1, keys_last1, keys_first2, keys_last2, values_first1, values_first1, keys_result, values_result, comp);
+
+  return thrust::make_pair(keys_result + n, values_result + n);
+} // end set_intersection_by_key()
+
+
+// the values of kept keys of the second range are taken from values_first2
+template<std::size_t bound, std::size_t groupsize, std::size_t grainsize,
+         typename RandomAccessIterator1,
+         typename RandomAccessIterator2,
+         typename RandomAccessIterator3,
+         typename RandomAccessIterator4,
+         typename RandomAccessIterator5,
+         typename RandomAccessIterator6,
+         typename Compare>
+__device__
+typename thrust::detail::enable_if<
+  (bound <= groupsize * grainsize),
+  thrust::pair<RandomAccessIterator5,RandomAccessIterator6>
+>::type
+set_union_by_key(bulk::bounded<bound,bulk::concurrent_group<bulk::agent<grainsize>,groupsize> > &g,
+                 RandomAccessIterator1 keys_first1, RandomAccessIterator1 keys_last1,
+                 RandomAccessIterator2 keys_first2, RandomAccessIterator2 keys_last2,
+                 RandomAccessIterator3 values_first1,
+                 RandomAccessIterator4 values_first2,
+                 RandomAccessIterator5 keys_result,
+                 RandomAccessIterator6 values_result,
+                 Compare comp)
+{
+  namespace ns = detail::set_operations_detail;
+
+  typename bulk::bounded<bound,bulk::concurrent_group<bulk::agent<grainsize>,groupsize> >::size_type n =
+    ns::set_operation<ns::union_op,true>(g, keys_first1, keys_last1, keys_first2, keys_last2, values_first1, values_first2, keys_result, values_result, comp);
+
+  return thrust::make_pair(keys_result + n, values_result + n);
+} // end set_union_by_key()
+
+
+// values_first2 is unused, as in thrust::set_difference_by_key
+template<std::size_t bound, std::size_t groupsize, std::size_t grainsize,
+         typename RandomAccessIterator1,
+         typename RandomAccessIterator2,
+         typename RandomAccessIterator3,
+         typename RandomAccessIterator4,
+         typename RandomAccessIterator5,
+         typename RandomAccessIterator6,
+         typename Compare>
+__device__
+typename thrust::detail::enable_if<
+  (bound <= groupsize * grainsize),
+  thrust::pair<RandomAccessIterator5,RandomAccessIterator6>
+>::type
+set_difference_by_key(bulk::bounded<bound,bulk::concurrent_group<bulk::agent<grainsize>,groupsize> > &g,
+                      RandomAccessIterator1 keys_first1, RandomAccessIterator1 keys_last1,
+                      RandomAccessIterator2 keys_first2, RandomAccessIterator2 keys_last2,
+                      RandomAccessIterator3 values_first1,
+                      RandomAccessIterator4 values_first2,
+                      RandomAccessIterator5 keys_result,
+                      RandomAccessIterator6 values_result,
+                      Compare comp)
+{
+  namespace ns = detail::set_operations_detail;
+
+  typename bulk::bounded<bound,bulk::concurrent_group<bulk::agent<grainsize>,groupsize> >::size_type n =
+    ns::set_operation<ns::difference_op,true>(g, keys_first1, keys_last1, keys_first2, keys_last2, values_first1, values_first2, keys_result, values_result, comp);
+
+  return thrust::make_pair(keys_result + n, values_result + n);
+} // end set_difference_by_key()
+
+
+template<std::size_t bound, std::size_t groupsize, std::size_t grainsize,
+         typename RandomAccessIterator1,
+         typename RandomAccessIterator2,
+         typename RandomAccessIterator3,
+         typename RandomAccessIterator4,
+         typename RandomAccessIterator5,
+         typename RandomAccessIterator6,
+         typename Compare>
+__device__
+typename thrust::detail::enable_if<
+  (bound <= groupsize * grainsize),
+  thrust::pair<RandomAccessIterator5,RandomAccessIterator6>
+>::type
+set_symmetric_difference_by_key(bulk::bounded<bound,bulk::concurrent_group<bulk::agent<grainsize>,groupsize> > &g,
+                                RandomAccessIterator1 keys_first1, RandomAccessIterator1 keys_last1,
+                                RandomAccessIterator2 keys_first2, RandomAccessIterator2 keys_last2,
+                                RandomAccessIterator3 values_first1,
+                                RandomAccessIterator4 values_first2,
+                                RandomAccessIterator5 keys_result,
+                                RandomAccessIterator6 values_result,
+                                Compare comp)
+{
+  namespace ns = detail::set_operations_detail;
+
+  typename bulk::bounded<bound,bulk::concurrent_group<bulk::agent<grainsize>,groupsize> >::size_type n =
+    ns::set_operation<ns::symmetric_difference_op,true>(g, keys_first1, keys_last1, keys_first2, keys_last2, values_first1, values_first2, keys_result, values_result, comp);
+
+  return thrust::make_pair(keys_result + n, values_result + n);
+} // end set_symmetric_difference_by_key()
+
+
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
@@ -19,6 +19,7 @@
 #include <bulk/detail/config.hpp>
 #include <bulk/execution_policy.hpp>
 #include <bulk/algorithm/detail/stable_merge_sort.hpp>
+#include <bulk/algorithm/detail/radix_sort.hpp>
 #include <thrust/detail/swap.h>
 
 BULK_NAMESPACE_PREFIX
@@ -117,6 +118,267 @@ void stable_odd_even_transpose_sort(const bounded<bound,agent<grainsize> > &,
 } // end stable_odd_even_transpose_sort()
 
 
+// sorting networks
+//
+// Batcher's merge exchange (Knuth's Algorithm 5.2.2M) sorts bound elements in O(bound lg^2 bound)
+// compare-exchanges of positions known at compile time, so an agent's array stays in registers
+// the networks aren't stable on their own, so ties are broken by the elements' original ranks
+// the positions [n, bound) are treated as larger than any element, so they're never exchanged
+
+
+// the largest power of two smaller than n
+template<int n, int p = 1, bool done = (2 * p >= n)>
+struct merge_exchange_first_step
+{
+  static const int value = merge_exchange_first_step<n, 2 * p>::value;
+};
+
+
+template<int n, int p>
+struct merge_exchange_first_step<n,p,true>
+{
+  static const int value = p;
+};
+
+
+// exchanges the elements at i and i + d if (i & p) == r, then recurses on i + 1
+template<int i, int bound, int p, int d, int r, bool done = (i >= bound - d)>
+struct merge_exchange_stage
+{
+  template<typename RandomAccessIterator, typename Compare>
+  static __device__
+  void sort(RandomAccessIterator keys, int *ranks, int n, Compare comp)
+  {
+    if((i & p) == r && i + d < n)
+    {
+      if(comp(keys[i + d], keys[i]) || (!comp(keys[i], keys[i + d]) && ranks[i + d] < ranks[i]))
+      {
+        using thrust::swap;
+
+        swap(keys[i], keys[i + d]);
+        swap(ranks[i], ranks[i + d]);
+      }
+    }
+
+    merge_exchange_stage<i + 1, bound, p, d, r>::sort(keys, ranks, n, comp);
+  }
+
+  template<typename RandomAccessIterator1, typename RandomAccessIterator2, typename Compare>
+  static __device__
+  void sort_by_key(RandomAccessIterator1 keys, RandomAccessIterator2 values, int *ranks, int n, Compare comp)
+  {
+    if((i & p) == r && i + d < n)
+    {
+      if(comp(keys[i + d], keys[i]) || (!comp(keys[i], keys[i + d]) && ranks[i + d] < ranks[i]))
+      {
+        using thrust::swap;
+
+        swap(keys[i], keys[i + d]);
+        swap(values[i], values[i + d]);
+        swap(ranks[i], ranks[i + d]);
+      }
+    }
+
+    merge_exchange_stage<i + 1, bound, p, d, r>::sort_by_key(keys, values, ranks, n, comp);
+  }
+};
+
+
+template<int i, int bound, int p, int d, int r>
+struct merge_exchange_stage<i,bound,p,d,r,true>
+{
+  template<typename RandomAccessIterator, typename Compare>
+  static __device__ void sort(RandomAccessIterator, int *, int, Compare) { }
+
+  template<typename RandomAccessIterator1, typename RandomAccessIterator2, typename Compare>
+  static __device__ void sort_by_key(RandomAccessIterator1, RandomAccessIterator2, int *, int, Compare) { }
+};
+
+
+// the stages of a round after its first: d = q - p and r = p for q = first_step, first_step / 2, ..., 2 * p
+template<int bound, int p, int q, bool done = (q <= p)>
+struct merge_exchange_merge
+{
+  template<typename RandomAccessIterator, typename Compare>
+  static __device__
+  void sort(RandomAccessIterator keys, int *ranks, int n, Compare comp)
+  {
+    merge_exchange_stage<0, bound, p, q - p, p>::sort(keys, ranks, n, comp);
+    merge_exchange_merge<bound, p, q / 2>::sort(keys, ranks, n, comp);
+  }
+
+  template<typename RandomAccessIterator1, typename RandomAccessIterator2, typename Compare>
+  static __device__
+  void sort_by_key(RandomAccessIterator1 keys, RandomAccessIterator2 values, int *ranks, int n, Compare comp)
+  {
+    merge_exchange_stage<0, bound, p, q - p, p>::sort_by_key(keys, values, ranks, n, comp);
+    merge_exchange_merge<bound, p, q / 2>::sort_by_key(keys, values, ranks, n, comp);
+  }
+};
+
+
+template<int bound, int p, int q>
+struct merge_exchange_merge<bound,p,q,true>
+{
+  template<typename RandomAccessIterator, typename Compare>
+  static __device__ void sort(RandomAccessIterator, int *, int, Compare) { }
+
+  template<typename RandomAccessIterator1, typename RandomAccessIterator2, typename Compare>
+  static __device__ void sort_by_key(RandomAccessIterator1, RandomAccessIterator2, int *, int, Compare) { }
+};
+
+
+// the rounds p = first_step, first_step / 2, ..., 1
+template<int bound, int p = merge_exchange_first_step<bound>::value, bool done = (p == 0)>
+struct merge_exchange_sort_impl
+{
+  template<typename RandomAccessIterator, typename Compare>
+  static __device__
+  void sort(RandomAccessIterator keys, int *ranks, int n, Compare comp)
+  {
+    const int first_step = merge_exchange_first_step<bound>::value;
+
+    merge_exchange_stage<0, bound, p, p, 0>::sort(keys, ranks, n, comp);
+    merge_exchange_merge<bound, p, first_step>::sort(keys, ranks, n, comp);
+
+    merge_exchange_sort_impl<bound, p / 2>::sort(keys, ranks, n, comp);
+  }
+
+  template<typename RandomAccessIterator1, typename RandomAccessIterator2, typename Compare>
+  static __device__
+  void sort_by_key(RandomAccessIterator1 keys, RandomAccessIterator2 values, int *ranks, int n, Compare comp)
+  {
+    const int first_step = merge_exchange_first_step<bound>::value;
+
+    merge_exchange_stage<0, bound, p, p, 0>::sort_by_key(keys, values, ranks, n, comp);
+    merge_exchange_merge<bound, p, first_step>::sort_by_key(keys, values, ranks, n, comp);
+
+    merge_exchange_sort_impl<bound, p / 2>::sort_by_key(keys, values, ranks, n, comp);
+  }
+};
+
+
+template<int bound, int p>
+struct merge_exchange_sort_impl<bound,p,true>
+{
+  template<typename RandomAccessIterator, typename Compare>
+  static __device__ void sort(RandomAccessIterator, int *, int, Compare) { }
+
+  template<typename RandomAccessIterator1, typename RandomAccessIterator2, typename Compare>
+  static __device__ void sort_by_key(RandomAccessIterator1, RandomAccessIterator2, int *, int, Compare) { }
+};
+
+
+// the largest bound sorted with a network rather than by odd-even transposition
+static const std::size_t max_sorting_network_bound = 32;
+
+
+template<std::size_t bound>
+struct use_sorting_network
+  : thrust::detail::integral_constant<bool, (bound > 1 && bound <= max_sorting_network_bound)>
+{};
+
+
+template<std::size_t bound,
+         std::size_t grainsize,
+         typename RandomAccessIterator1,
+         typename RandomAccessIterator2,
+         typename Compare>
+__forceinline__ __device__
+void stable_sorting_network_by_key(const bounded<bound,agent<grainsize> > &,
+                                   RandomAccessIterator1 keys_first, RandomAccessIterator1 keys_last,
+                                   RandomAccessIterator2 values_first,
+                                   Compare comp)
+{
+  int ranks[bound];
+  for(int i = 0; i < int(bound); ++i)
+  {
+    ranks[i] = i;
+  }
+
+  merge_exchange_sort_impl<bound>::sort_by_key(keys_first, values_first, ranks, keys_last - keys_first, comp);
+} // end stable_sorting_network_by_key()
+
+
+template<std::size_t bound,
+         std::size_t grainsize,
+         typename RandomAccessIterator,
+         typename Compare>
+__forceinline__ __device__
+void stable_sorting_network(const bounded<bound,agent<grainsize> > &,
+                            RandomAccessIterator first, RandomAccessIterator last,
+                            Compare comp)
+{
+  int ranks[bound];
+  for(int i = 0; i < int(bound); ++i)
+  {
+    ranks[i] = i;
+  }
+
+  merge_exchange_sort_impl<bound>::sort(first, ranks, last - first, comp);
+} // end stable_sorting_network()
+
+
+template<std::size_t bound,
+         std::size_t grainsize,
+         typename RandomAccessIterator1,
+         typename RandomAccessIterator2,
+         typename Compare>
+__forceinline__ __device__
+void stable_sort_by_key(const bounded<bound,agent<grainsize> > &exec,
+                        RandomAccessIterator1 keys_first, RandomAccessIterator1 keys_last,
+                        RandomAccessIterator2 values_first,
+                        Compare comp,
+                        thrust::detail::true_type)
+{
+  stable_sorting_network_by_key(exec, keys_first, keys_last, values_first, comp);
+} // end stable_sort_by_key()
+
+
+template<std::size_t bound,
+         std::size_t grainsize,
+         typename RandomAccessIterator1,
+         typename RandomAccessIterator2,
+         typename Compare>
+__forceinline__ __device__
+void stable_sort_by_key(const bounded<bound,agent<grainsize> > &exec,
+                        RandomAccessIterator1 keys_first, RandomAccessIterator1 keys_last,
+                        RandomAccessIterator2 values_first,
+                        Compare comp,
+                        thrust::detail::false_type)
+{
+  stable_odd_even_transpose_sort_by_key(exec, keys_first, keys_last, values_first, comp);
+} // end stable_sort_by_key()
+
+
+template<std::size_t bound,
+         std::size_t grainsize,
+         typename RandomAccessIterator,
+         typename Compare>
+__forceinline__ __device__
+void stable_sort(const bounded<bound,agent<grainsize> > &exec,
+                 RandomAccessIterator first, RandomAccessIterator last,
+                 Compare comp,
+                 thrust::detail::true_type)
+{
+  stable_sorting_network(exec, first, last, comp);
+} // end stable_sort()
+
+
+template<std::size_t bound,
+         std::size_t grainsize,
+         typename RandomAccessIterator,
+         typename Compare>
+__forceinline__ __device__
+void stable_sort(const bounded<bound,agent<grainsize> > &exec,
+                 RandomAccessIterator first, RandomAccessIterator last,
+                 Compare comp,
+                 thrust::detail::false_type)
+{
+  stable_odd_even_transpose_sort(exec, first, last, comp);
+} // end stable_sort()
+
+
 } // end sort_detail
 } // end detail
 
@@ -132,7 +394,7 @@ void stable_sort_by_key(const bounded<bound,agent<grainsize> > &exec,
                         RandomAccessIterator2 values_first,
                         Compare comp)
 {
-  bulk::detail::sort_detail::stable_odd_even_transpose_sort_by_key(exec, keys_first, keys_last, values_first, comp);
+  bulk::detail::sort_detail::stable_sort_by_key(exec, keys_first, keys_last, values_first, comp, bulk::detail::sort_detail::use_sorting_network<bound>());
 } // end stable_sort_by_key()
 
 
@@ -145,7 +407,7 @@ void stable_sort(const bounded<bound,agent<grainsize> > &exec,
                  RandomAccessIterator first, RandomAccessIterator last,
                  Compare comp)
 {
-  bulk::detail::sort_detail::stable_odd_even_transpose_sort(exec, first, last, comp);
+  bulk::detail::sort_detail::stable_sort(exec, first, last, comp, bulk::detail::sort_detail::use_sorting_network<bound>());
 } // end stable_sort()
 
 
@@ -166,6 +428,69 @@ stable_sort_by_key(bulk::bounded<bound,bulk::concurrent_group<bulk::agent<grains
 } // end stable_sort_by_key()
 
 
+// radix_sort_by_key sorts keys of arithmetic type stably by their bits [begin_bit, end_bit)
+// four bits per pass
+template<std::size_t bound, std::size_t groupsize, std::size_t grainsize,
+         typename RandomAccessIterator1,
+         typename RandomAccessIterator2>
+__device__
+typename thrust::detail::enable_if<
+  bound <= groupsize * grainsize
+>::type
+radix_sort_by_key(bulk::bounded<bound,bulk::concurrent_group<bulk::agent<grainsize>,groupsize> > &g,
+                  RandomAccessIterator1 keys_first, RandomAccessIterator1 keys_last,
+                  RandomAccessIterator2 values_first,
+                  int begin_bit, int end_bit)
+{
+  bulk::detail::radix_sort_detail::radix_sort_by_key<true>(g, keys_first, keys_last, values_first, begin_bit, end_bit);
+} // end radix_sort_by_key()
+
+
+template<std::size_t bound, std::size_t groupsize, std::size_t grainsize,
+         typename RandomAccessIterator1,
+         typename RandomAccessIterator2>
+__device__
+typename thrust::detail::enable_if<
+  bound <= groupsize * grainsize
+>::type
+radix_sort_by_key(bulk::bounded<bound,bulk::concurrent_group<bulk::agent<grainsize>,groupsize> > &g,
+                  RandomAccessIterator1 keys_first, RandomAccessIterator1 keys_last,
+                  RandomAccessIterator2 values_first)
+{
+  typedef typename thrust::iterator_value<RandomAccessIterator1>::type key_type;
+
+  bulk::detail::radix_sort_detail::radix_sort_by_key<true>(g, keys_first, keys_last, values_first, 0, 8 * sizeof(key_type));
+} // end radix_sort_by_key()
+
+
+template<std::size_t bound, std::size_t groupsize, std::size_t grainsize,
+         typename RandomAccessIterator>
+__device__
+typename thrust::detail::enable_if<
+  bound <= groupsize * grainsize
+>::type
+radix_sort(bulk::bounded<bound,bulk::concurrent_group<bulk::agent<grainsize>,groupsize> > &g,
+           RandomAccessIterator first, RandomAccessIterator last,
+           int begin_bit, int end_bit)
+{
+  bulk::detail::radix_sort_detail::radix_sort_by_key<false>(g, first, last, first, begin_bit, end_bit);
+} // end radix_sort()
+
+
+template<std::size_t bound, std::size_t groupsize, std::size_t grainsize,
+         typename RandomAccessIterator>
+__device__
+typename thrust::detail::enable_if<
+  bound <= groupsize * grainsize
+>::type
+radix_sort(bulk::bounded<bound,bulk::concurrent_group<bulk::agent<grainsize>,groupsize> > &g,
+           RandomAccessIterator first, RandomAccessIterator last)
+{
+  typedef typename thrust::iterator_value<RandomAccessIterator>::type key_type;
+
+  bulk::detail::radix_sort_detail::radix_sort_by_key<false>(g, first, last, first, 0, 8 * sizeof(key_type));
+} // end radix_sort()
+
+
 } // end bulk
 BULK_NAMESPACE_SUFFIX
-
@@ -87,4 +87,5 @@ future<void> async(ExecutionGroup g, Function f, Arg1 arg1, Arg2 arg2, Arg3 arg3
 BULK_NAMESPACE_SUFFIX
 
 #include <bulk/detail/async.inl>
+#include <bulk/detail/future.inl>
 
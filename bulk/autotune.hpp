@@ -0,0 +1,373 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/detail/guarded_cuda_runtime_api.hpp>
+#include <bulk/detail/throw_on_error.hpp>
+#include <bulk/detail/host_mutex.hpp>
+#include <bulk/detail/stream_capture.hpp>
+#include <bulk/detail/cuda_launcher/runtime_introspection.hpp>
+#include <map>
+#include <string>
+#include <sstream>
+#include <fstream>
+#include <cstdlib>
+#include <cstddef>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+
+
+// a candidate shape for the groups of a launch, e.g. bulk::con<groupsize,grainsize>
+template<std::size_t groupsize_, std::size_t grainsize_>
+struct shape
+{
+  static const std::size_t groupsize = groupsize_;
+  static const std::size_t grainsize = grainsize_;
+};
+
+
+struct null_shape {};
+
+
+// a list of up to eight candidate shapes
+template<typename Shape0,
+         typename Shape1 = null_shape,
+         typename Shape2 = null_shape,
+         typename Shape3 = null_shape,
+         typename Shape4 = null_shape,
+         typename Shape5 = null_shape,
+         typename Shape6 = null_shape,
+         typename Shape7 = null_shape>
+struct shapes
+{
+  typedef Shape0                                                       head;
+  typedef shapes<Shape1,Shape2,Shape3,Shape4,Shape5,Shape6,Shape7>     tail;
+};
+
+
+namespace detail
+{
+namespace autotune_detail
+{
+
+
+template<typename Shapes>
+struct shape_list
+{
+  typedef typename Shapes::head     head;
+  typedef shape_list<typename Shapes::tail> tail;
+
+  static const int size = 1 + tail::size;
+
+  // invokes f with the index-th shape
+  template<typename Function>
+  static void dispatch(int index, Function &f)
+  {
+    if(index <= 0)
+    {
+      f(head());
+    } // end if
+    else
+    {
+      tail::dispatch(index - 1, f);
+    } // end else
+  } // end dispatch()
+
+  // returns the index of the shape (groupsize, grainsize), or -1
+  static int find(std::size_t groupsize, std::size_t grainsize)
+  {
+    if(head::groupsize == groupsize && head::grainsize == grainsize) return 0;
+
+    int result = tail::find(groupsize, grainsize);
+
+    return result < 0 ? result : result + 1;
+  } // end find()
+
+  static std::size_t groupsize(int index)
+  {
+    return index <= 0 ? head::groupsize : tail::groupsize(index - 1);
+  } // end groupsize()
+
+  static std::size_t grainsize(int index)
+  {
+    return index <= 0 ? head::grainsize : tail::grainsize(index - 1);
+  } // end grainsize()
+}; // end shape_list
+
+
+template<>
+struct shape_list<shapes<null_shape> >
+{
+  static const int size = 0;
+
+  template<typename Function>
+  static void dispatch(int, Function &) {}
+
+  static int find(std::size_t, std::size_t) { return -1; }
+
+  static std::size_t groupsize(int) { return 0; }
+  static std::size_t grainsize(int) { return 0; }
+}; // end shape_list
+
+
+struct autotune_state
+{
+  autotune_state()
+    : loaded(false)
+  {
+    const char *env = std::getenv("BULK_TUNING_CACHE");
+    path = env ? env : ".bulk_tuning_cache";
+  }
+
+  host_mutex                                                 mutex;
+  bool                                                       loaded;
+  std::string                                                path;
+  std::map<std::string, std::pair<std::size_t,std::size_t> > winners;
+  std::map<int, std::string>                                 device_names;
+}; // end autotune_state
+
+
+// XXX see the note on host singletons in bulk/detail/config.hpp
+inline autotune_state &autotune_global_state()
+{
+  static autotune_state state;
+  return state;
+} // end autotune_global_state()
+
+
+// each line of the cache is a key followed by the winning groupsize & grainsize
+// a missing or unreadable cache is no error: the shapes are tuned again
+inline void load_tuning_cache(autotune_state &state)
+{
+  if(state.loaded) return;
+
+  state.loaded = true;
+
+  std::ifstream is(state.path.c_str());
+
+  std::string key;
+  std::size_t groupsize = 0, grainsize = 0;
+
+  while(is >> key >> groupsize >> grainsize)
+  {
+    state.winners[key] = std::make_pair(groupsize, grainsize);
+  } // end while
+} // end load_tuning_cache()
+
+
+inline void append_to_tuning_cache(const autotune_state &state, const std::string &key, std::size_t groupsize, std::size_t grainsize)
+{
+  if(state.path.empty()) return;
+
+  std::ofstream os(state.path.c_str(), std::ios::app);
+
+  os << key << " " << groupsize << " " << grainsize << "\n";
+} // end append_to_tuning_cache()
+
+
+// the winner depends on the kind of device rather than its ordinal,
+// so that the cache remains valid when it moves to another machine like this one
+inline const std::string &device_name(autotune_state &state, int device)
+{
+  std::map<int,std::string>::iterator i = state.device_names.find(device);
+
+  if(i == state.device_names.end())
+  {
+    cudaDeviceProp props;
+    bulk::detail::throw_on_error(cudaGetDeviceProperties(&props, device), "bulk::autotune(): after cudaGetDeviceProperties");
+
+    std::ostringstream name;
+    name << props.name << "_sm" << props.major << props.minor;
+
+    std::string result = name.str();
+
+    // keys may not contain whitespace
+    for(std::size_t j = 0; j < result.size(); ++j)
+    {
+      if(result[j] == ' ' || result[j] == '\t') result[j] = '_';
+    } // end for j
+
+    i = state.device_names.insert(std::make_pair(device, result)).first;
+  } // end if
+
+  return i->second;
+} // end device_name()
+
+
+// problem sizes are bucketed by powers of two
+inline int size_bucket(std::size_t n)
+{
+  int result = 0;
+
+  for(; n > 1; n >>= 1)
+  {
+    ++result;
+  } // end for
+
+  return result;
+} // end size_bucket()
+
+
+template<typename ShapeList, typename Function>
+int tune(Function &f, std::size_t num_trials)
+{
+  cudaEvent_t start, stop;
+  bulk::detail::throw_on_error(cudaEventCreate(&start), "bulk::autotune(): after cudaEventCreate");
+  bulk::detail::throw_on_error(cudaEventCreate(&stop), "bulk::autotune(): after cudaEventCreate");
+
+  int   winner      = 0;
+  float winner_time = 0;
+
+  for(int i = 0; i < ShapeList::size; ++i)
+  {
+    // the first invocation absorbs module loading & launch configuration
+    ShapeList::dispatch(i, f);
+
+    float best = 0;
+
+    for(std::size_t j = 0; j < num_trials; ++j)
+    {
+      bulk::detail::throw_on_error(cudaEventRecord(start, 0), "bulk::autotune(): after cudaEventRecord");
+      ShapeList::dispatch(i, f);
+      bulk::detail::throw_on_error(cudaEventRecord(stop, 0), "bulk::autotune(): after cudaEventRecord");
+      bulk::detail::throw_on_error(cudaEventSynchronize(stop), "bulk::autotune(): after cudaEventSynchronize");
+
+      float msecs = 0;
+      bulk::detail::throw_on_error(cudaEventElapsedTime(&msecs, start, stop), "bulk::autotune(): after cudaEventElapsedTime");
+
+      if(j == 0 || msecs < best) best = msecs;
+    } // end for j
+
+    if(i == 0 || best < winner_time)
+    {
+      winner      = i;
+      winner_time = best;
+    } // end if
+  } // end for i
+
+  cudaEventDestroy(start);
+  cudaEventDestroy(stop);
+
+  return winner;
+} // end tune()
+
+
+} // end autotune_detail
+} // end detail
+
+
+// autotune invokes f with the candidate shape which performs best for problems of about n elements on the current device
+// f is a function object which launches its work with any of the candidate shapes, e.g.
+//
+//   struct my_launch
+//   {
+//     template<std::size_t groupsize, std::size_t grainsize>
+//     void operator()(bulk::shape<groupsize,grainsize>)
+//     {
+//       bulk::async(bulk::grid<groupsize,grainsize>(num_groups), my_kernel(), ...);
+//     }
+//   };
+//
+// The first call for each name, kind of device and power-of-two bucket of n benchmarks every
+// candidate with f, so f must launch into the default stream, or streams which synchronize with it,
+// and must produce the same result however many times it is invoked.
+// The winner is appended to the tuning cache file named by the environment variable BULK_TUNING_CACHE
+// (by default, .bulk_tuning_cache in the working directory), and later calls, including those of later runs,
+// invoke f just once with the winner.
+// While bulk::capture() is recording, an untuned call invokes f with the first candidate.
+// This function is only available in __host__ code.
+template<typename Shapes, typename Function>
+void autotune(const char *name, std::size_t n, Function f)
+{
+  typedef detail::autotune_detail::shape_list<Shapes> shape_list;
+
+  detail::autotune_detail::autotune_state &state = detail::autotune_detail::autotune_global_state();
+
+  std::string key;
+  int index = -1;
+
+  {
+    detail::host_lock_guard guard(state.mutex);
+
+    detail::autotune_detail::load_tuning_cache(state);
+
+    std::ostringstream key_stream;
+    key_stream << name << "/" << detail::autotune_detail::device_name(state, bulk::detail::current_device()) << "/" << detail::autotune_detail::size_bucket(n);
+    key = key_stream.str();
+
+    std::map<std::string, std::pair<std::size_t,std::size_t> >::iterator i = state.winners.find(key);
+
+    if(i != state.winners.end())
+    {
+      // a cached winner which is no longer a candidate is tuned again
+      index = shape_list::find(i->second.first, i->second.second);
+    } // end if
+  } // end guard
+
+  if(index < 0)
+  {
+    if(bulk::detail::is_capturing())
+    {
+      shape_list::dispatch(0, f);
+      return;
+    } // end if
+
+    // tune outside of the lock, since f may take a while
+    index = detail::autotune_detail::tune<shape_list>(f, 3);
+
+    detail::host_lock_guard guard(state.mutex);
+
+    state.winners[key] = std::make_pair(shape_list::groupsize(index), shape_list::grainsize(index));
+
+    detail::autotune_detail::append_to_tuning_cache(state, key, shape_list::groupsize(index), shape_list::grainsize(index));
+  } // end if
+
+  shape_list::dispatch(index, f);
+} // end autotune()
+
+
+// names the tuning cache file; the winners already known are kept
+inline void set_tuning_cache_path(const std::string &path)
+{
+  detail::autotune_detail::autotune_state &state = detail::autotune_detail::autotune_global_state();
+  detail::host_lock_guard guard(state.mutex);
+
+  state.path   = path;
+  state.loaded = false;
+} // end set_tuning_cache_path()
+
+
+// forgets every winner, so that each is tuned again, without erasing the cache file
+inline void clear_tuning_cache()
+{
+  detail::autotune_detail::autotune_state &state = detail::autotune_detail::autotune_global_state();
+  detail::host_lock_guard guard(state.mutex);
+
+  state.winners.clear();
+
+  // don't reload the forgotten winners
+  state.loaded = true;
+} // end clear_tuning_cache()
+
+
+} // end bulk
+BULK_NAMESPACE_SUFFIX
@@ -20,9 +20,25 @@
 #include <bulk/execution_policy.hpp>
 #include <bulk/choose_sizes.hpp>
 #include <bulk/future.hpp>
+#include <bulk/stream_pool.hpp>
+#include <bulk/launch_config_cache.hpp>
+#include <bulk/heap_profiling.hpp>
+#include <bulk/telemetry.hpp>
+#include <bulk/autotune.hpp>
+#include <bulk/dispatch_bound.hpp>
 #include <bulk/async.hpp>
+#include <bulk/multi_device.hpp>
+#include <bulk/graph.hpp>
+#include <bulk/persistent.hpp>
+#include <bulk/device_queue.hpp>
+#include <bulk/warp_specialization.hpp>
+#include <bulk/cluster.hpp>
 #include <bulk/malloc.hpp>
+#include <bulk/memory_pool.hpp>
+#include <bulk/static_scratch.hpp>
 #include <bulk/algorithm.hpp>
+#include <bulk/algorithm/device.hpp>
+#include <bulk/fused.hpp>
 #include <bulk/iterator.hpp>
 #include <bulk/uninitialized.hpp>
 
@@ -0,0 +1,155 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/execution_policy.hpp>
+#include <bulk/malloc.hpp>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+
+
+// returns the address in the heap of the cluster's group with the given rank which corresponds to
+// the address ptr in the calling group's heap
+// ptr must point on chip, i.e. bulk::is_on_chip(ptr)
+template<typename ConcurrentGroup, typename T>
+__device__
+T *map_to_rank(cluster<ConcurrentGroup> &c, T *ptr, typename cluster<ConcurrentGroup>::size_type rank)
+{
+#if defined(__CUDA_ARCH__) && (__CUDA_ARCH__ >= 900)
+  unsigned long long result;
+
+  asm volatile("mapa.u64 %0, %1, %2;\n" : "=l"(result) : "l"(reinterpret_cast<unsigned long long>(ptr)), "r"(static_cast<unsigned int>(rank)));
+
+  return reinterpret_cast<T*>(result);
+#else
+  // without cluster support, the only rank is the caller's own
+  return ptr;
+#endif
+} // end map_to_rank()
+
+
+// allocates num_bytes from the heap of each of the cluster's groups, and returns the calling group's share
+// together, the shares form an allocation of c.size() * num_bytes bytes addressable by the whole cluster
+// through map_to_rank() or a distributed_array
+// every agent of the cluster must call malloc, and its groups must make the same sequence of allocations,
+// so that their shares lie at corresponding addresses
+// XXX a share which doesn't fit on chip isn't addressable by the other groups, so the result is null
+//     in every group unless every share fits
+template<typename ConcurrentGroup>
+__device__
+inline void *malloc(cluster<ConcurrentGroup> &c, size_t num_bytes)
+{
+  __shared__ int s_fits;
+
+  void *result = bulk::malloc(c.this_exec, num_bytes);
+
+  bool fits = bulk::is_on_chip(result);
+
+  if(c.this_exec.this_exec.index() == 0)
+  {
+    s_fits = 1;
+  } // end if
+
+  // each group checks the others' shares after they've published them
+  c.wait();
+
+  if(c.this_exec.this_exec.index() == 0 && !fits)
+  {
+    for(typename cluster<ConcurrentGroup>::size_type rank = 0; rank < c.size(); ++rank)
+    {
+      atomicExch(map_to_rank(c, &s_fits, rank), 0);
+    } // end for
+  } // end if
+
+  c.wait();
+
+  if(!s_fits)
+  {
+    bulk::free(c.this_exec, result);
+    result = 0;
+  } // end if
+
+  return result;
+} // end malloc()
+
+
+// every agent of the cluster must call free, after which no group may access the others' shares
+template<typename ConcurrentGroup>
+__device__
+inline void free(cluster<ConcurrentGroup> &c, void *ptr)
+{
+  // the other groups may still be accessing this group's share
+  c.wait();
+
+  if(ptr != 0)
+  {
+    bulk::free(c.this_exec, ptr);
+  } // end if
+} // end free()
+
+
+// a view of an array of T spread across the heaps of a cluster's groups,
+// whose elements [i * n, (i+1) * n) are the share of the group with rank i
+template<typename T, typename ConcurrentGroup>
+class distributed_array
+{
+  public:
+    typedef T                                                value_type;
+    typedef typename cluster<ConcurrentGroup>::size_type     size_type;
+
+    // share points to the calling group's share of n elements, e.g. as returned by bulk::malloc(c, n * sizeof(T))
+    __device__
+    distributed_array(cluster<ConcurrentGroup> &c, T *share, size_type n)
+      : m_cluster(c), m_share(share), m_share_size(n)
+    {}
+
+    __device__
+    size_type size() const
+    {
+      return m_cluster.size() * m_share_size;
+    } // end size()
+
+    // the calling group's elements, which are cheaper to access than the others'
+    __device__
+    T *local() const
+    {
+      return m_share;
+    } // end local()
+
+    __device__
+    T &operator[](size_type i) const
+    {
+      size_type rank = i / m_share_size;
+
+      return map_to_rank(m_cluster, m_share, rank)[i - rank * m_share_size];
+    } // end operator[]()
+
+  private:
+    cluster<ConcurrentGroup> &m_cluster;
+    T *m_share;
+    size_type m_share_size;
+}; // end distributed_array
+
+
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
@@ -212,6 +212,26 @@ template<std::size_t Len, std::size_t Align>
 };
 
 
+// the widest aligned access a single thread may make, e.g. with int4
+static const std::size_t max_vector_alignment = 16;
+
+
+// the distance in bytes from the previous multiple of alignment to ptr
+// alignment must be a power of two
+__host__ __device__
+inline std::size_t misalignment(const void *ptr, std::size_t alignment)
+{
+  return reinterpret_cast<std::size_t>(ptr) & (alignment - 1);
+} // end misalignment()
+
+
+__host__ __device__
+inline bool is_aligned(const void *ptr, std::size_t alignment)
+{
+  return misalignment(ptr, alignment) == 0;
+} // end is_aligned()
+
+
 } // end detail
 } // end bulk
 BULK_NAMESPACE_SUFFIX
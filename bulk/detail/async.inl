@@ -17,9 +17,14 @@
 #include <bulk/detail/config.hpp>
 #include <bulk/async.hpp>
 #include <bulk/detail/cuda_launcher/cuda_launcher.hpp>
+#include <bulk/detail/host_launcher/host_launcher.hpp>
 #include <bulk/detail/closure.hpp>
 #include <bulk/detail/throw_on_error.hpp>
 #include <bulk/detail/terminate.hpp>
+#include <bulk/detail/stream_pool.hpp>
+#include <bulk/detail/stream_capture.hpp>
+#include <bulk/detail/nvtx.hpp>
+#include <bulk/multi_device.hpp>
 
 
 BULK_NAMESPACE_PREFIX
@@ -31,8 +36,13 @@ namespace detail
 
 template<typename ExecutionGroup, typename Closure>
 __host__ __device__
-future<void> async_in_stream(ExecutionGroup g, Closure c, cudaStream_t s, cudaEvent_t before_event)
+future<void> async_in_stream(ExecutionGroup g, Closure c, cudaStream_t s, cudaEvent_t before_event, bool record_event = true, const launch_attributes &attr = launch_attributes())
 {
+  bulk::detail::nvtx_range range(c, g);
+
+  // while bulk::capture() is recording, launches into the default stream are captured
+  s = bulk::detail::capture_aware_stream(s);
+
 #if __BULK_HAS_CUDART__
   if(before_event != 0)
   {
@@ -43,25 +53,51 @@ future<void> async_in_stream(ExecutionGroup g, Closure c, cudaStream_t s, cudaEv
 #endif
 
   bulk::detail::cuda_launcher<ExecutionGroup, Closure> launcher;
+  launcher.set_attributes(attr);
   launcher.launch(g, c, s);
 
-  return future_core_access::create(s, false);
+  return future_core_access::create(s, false, record_event);
 } // end async_in_stream()
 
 
 template<typename ExecutionGroup, typename Closure>
 __host__ __device__
-future<void> async(ExecutionGroup g, Closure c, cudaEvent_t before_event)
+future<void> async(ExecutionGroup g, Closure c, cudaEvent_t before_event, bool record_event = true, launch_attributes attr = launch_attributes())
 {
+  // while bulk::capture() is recording, there's no need for a stream of our own
+  if(bulk::detail::is_capturing())
+  {
+    return bulk::detail::async_in_stream(g, c, 0, before_event, record_event, attr);
+  } // end if
+
+  bulk::detail::nvtx_range range(c, g);
+
   cudaStream_t s;
 
-  // XXX cudaStreamCreate is __host__-only
-  //     figure out a way to support this that does not require creating a new stream
+  // XXX the stream pool is __host__-only
 #if (__BULK_HAS_CUDART__ && !defined(__CUDA_ARCH__))
-  bulk::detail::throw_on_error(cudaStreamCreate(&s), "cudaStreamCreate in bulk::detail::async");
+  // recycle a stream from the pool rather than create a new one
+  // the stream returns to the pool when the resulting future is destroyed
+  if(attr.has_priority)
+  {
+    s = bulk::detail::default_stream_pool().acquire(bulk::detail::current_device(), attr.priority);
+
+    // the stream carries the priority, so the launch needn't
+    attr.has_priority = false;
+  } // end if
+  else
+  {
+    s = bulk::detail::default_stream_pool().acquire(bulk::detail::current_device());
+  } // end else
+#elif __BULK_HAS_CUDART__
+  // under dynamic parallelism, each such launch gets a stream of its own, so that the
+  // child grids of a block needn't serialize in the block's NULL stream
+  // only non-blocking streams may be created in __device__ code
+  // the stream is destroyed along with the resulting future
+  bulk::detail::throw_on_error(cudaStreamCreateWithFlags(&s, cudaStreamNonBlocking), "cudaStreamCreateWithFlags in bulk::detail::async");
 #else
   s = 0;
-  bulk::detail::terminate_with_message("bulk::async(): cudaStreamCreate() is unsupported in __device__ code.");
+  bulk::detail::terminate_with_message("bulk::async(): cudaStreamCreate() in __device__ code requires dynamic parallelism.");
 #endif
 
 #if __BULK_HAS_CUDART__
@@ -74,10 +110,11 @@ future<void> async(ExecutionGroup g, Closure c, cudaEvent_t before_event)
 #endif
 
   bulk::detail::cuda_launcher<ExecutionGroup, Closure> launcher;
+  launcher.set_attributes(attr);
   launcher.launch(g, c, s);
 
   // note we pass true here, unlike false above
-  return future_core_access::create(s, true);
+  return future_core_access::create(s, true, record_event);
 } // end async()
 
 
@@ -85,7 +122,8 @@ template<typename ExecutionGroup, typename Closure>
 __host__ __device__
 future<void> async(ExecutionGroup g, Closure c)
 {
-  return bulk::detail::async_in_stream(g, c, 0, 0);
+  // launch into this thread's default stream, so that host threads needn't serialize
+  return bulk::detail::async_in_stream(g, c, bulk::detail::default_stream(), 0);
 } // end async()
 
 
@@ -94,8 +132,105 @@ __host__ __device__
 future<void> async(async_launch<ExecutionGroup> launch, Closure c)
 {
   return launch.is_stream_valid() ?
-    bulk::detail::async_in_stream(launch.exec(), c, launch.stream(), launch.before_event()) :
-    bulk::detail::async(launch.exec(), c, launch.before_event());
+    bulk::detail::async_in_stream(launch.exec(), c, launch.stream(), launch.before_event(), launch.records_event(), launch.attributes()) :
+    bulk::detail::async(launch.exec(), c, launch.before_event(), launch.records_event(), launch.attributes());
+} // end async()
+
+
+// launches each device's share of the grid in a pooled stream on that device
+// the result is on the current device and becomes ready when every device's share is complete
+// XXX the grid is configured for the first device, so the devices ought to be alike
+template<typename ExecutionGroup, typename Closure>
+__host__ __device__
+future<void> async(multi_device_launch<ExecutionGroup> launch, Closure c)
+{
+#if (__BULK_HAS_CUDART__ && !defined(__CUDA_ARCH__))
+  if(bulk::detail::is_capturing())
+  {
+    bulk::detail::terminate_with_message("bulk::async(): multi_device launches may not be captured");
+  } // end if
+
+  bulk::detail::nvtx_range range(c, launch.exec());
+
+  int original_device = bulk::detail::current_device();
+
+  future<void> futures[multi_device_launch<ExecutionGroup>::max_num_devices];
+
+  ExecutionGroup g = launch.exec();
+
+  for(int i = 0; i < launch.size(); ++i)
+  {
+    int device = launch.device(i);
+
+    bulk::detail::throw_on_error(cudaSetDevice(device), "cudaSetDevice in bulk::async");
+
+    // the launcher introspects the current device
+    bulk::detail::cuda_launcher<ExecutionGroup, Closure> launcher;
+
+    if(i == 0)
+    {
+      if(g.size() == use_default)
+      {
+        // given no other info, occupy each device
+        g = launcher.configure(g);
+        g = make_grid<ExecutionGroup>(launch.size() * launcher.choose_num_groups(use_default, g.this_exec.size()), g.this_exec);
+      } // end if
+      else
+      {
+        g = launcher.configure(g);
+      } // end else
+    } // end if
+
+    thrust::pair<typename ExecutionGroup::size_type, typename ExecutionGroup::size_type> range = launch.partition(i, g.size());
+
+    cudaStream_t s = bulk::detail::default_stream_pool().acquire(device);
+
+    launcher.launch_blocks(g, c, s, range.first, range.second - range.first, launcher.choose_profiled_overflow_size(make_launch_config(launch.exec().size(), launch.exec().this_exec.size(), launch.exec().this_exec.heap_size()), g.this_exec.heap_size()));
+
+    futures[i] = future_core_access::create(s, true);
+  } // end for i
+
+  bulk::detail::throw_on_error(cudaSetDevice(original_device), "cudaSetDevice in bulk::async");
+
+  return bulk::when_all(futures, futures + launch.size());
+#else
+  bulk::detail::terminate_with_message("bulk::async(): multi_device launches are unsupported in __device__ code.");
+  return future<void>();
+#endif
+} // end async()
+
+
+// host launches are complete by the time this returns, so their futures have nothing to wait on
+template<typename ExecutionGroup, typename Closure>
+__host__ __device__
+future<void> async(host_launch<ExecutionGroup> launch, Closure c)
+{
+  if(!launch.on_host())
+  {
+    return bulk::detail::async(launch.exec(), c);
+  } // end if
+
+#ifndef __CUDA_ARCH__
+  bulk::detail::nvtx_range range(c, launch.exec());
+
+  bulk::detail::host_launcher<ExecutionGroup, Closure> launcher(launch.exec(), c);
+  launcher.launch();
+#else
+  bulk::detail::terminate_with_message("bulk::async(): host launches are unsupported in __device__ code.");
+#endif
+
+  return future<void>();
+} // end async()
+
+
+// the labeled range encloses the range of the launch itself
+template<typename Launch, typename Closure>
+__host__ __device__
+future<void> async(labeled_launch<Launch> launch, Closure c)
+{
+  bulk::detail::nvtx_range range(launch.label());
+
+  return bulk::detail::async(launch.launch(), c);
 } // end async()
 
 
@@ -61,3 +61,20 @@
 #  define __BULK_HAS_PRINTF__ 1
 #endif
 
+
+// __BULK_THREAD_LOCAL__ declares host variables with thread storage duration
+#if __cplusplus >= 201103L
+#  define __BULK_THREAD_LOCAL__ thread_local
+#elif defined(_MSC_VER)
+#  define __BULK_THREAD_LOCAL__ __declspec(thread)
+#else
+#  define __BULK_THREAD_LOCAL__ __thread
+#endif
+
+
+// host singletons
+// bulk's host-side pools, caches & global state are function-local statics of inline functions,
+// e.g. default_stream_pool(), so that a header-only program has a single instance of each
+// XXX the initialization of these statics is only thread-safe with C++11 or -fthreadsafe-statics,
+//     so a C++03 program built without the latter should make its first launch before it spawns threads
+
@@ -22,9 +22,16 @@
 #include <bulk/detail/cuda_launcher/runtime_introspection.hpp>
 #include <bulk/detail/cuda_launcher/triple_chevron_launcher.hpp>
 #include <bulk/detail/cuda_launcher/cuda_launch_config.hpp>
+#include <bulk/detail/cuda_launcher/launch_config_cache.hpp>
+#include <bulk/detail/cuda_launcher/heap_profile.hpp>
+#include <bulk/detail/launch_telemetry.hpp>
 #include <bulk/detail/synchronize.hpp>
+#include <bulk/detail/throw_on_error.hpp>
+#include <bulk/malloc.hpp>
+#include <bulk/memory_pool.hpp>
 #include <thrust/detail/minmax.h>
 #include <thrust/pair.h>
+#include <typeinfo>
 
 
 // It's not possible to launch a CUDA kernel unless __BULK_HAS_CUDART__
@@ -60,22 +67,203 @@ struct cuda_launcher_base
 
   __host__ __device__
   cuda_launcher_base()
-    : m_device_properties(bulk::detail::device_properties())
+    : m_device(bulk::detail::current_device()),
+      m_device_properties(bulk::detail::device_properties(m_device))
   {}
 
 
+  // the attributes apply to each subsequent launch
   __host__ __device__
-  void launch(size_type num_blocks, size_type block_size, size_type num_dynamic_smem_bytes, cudaStream_t stream, task_type task)
+  void set_attributes(const launch_attributes &attr)
+  {
+    m_attributes = attr;
+  } // end set_attributes()
+
+
+  // cooperative launches & launch attributes are only available in __host__ code
+  __host__ __device__
+  void launch(size_type num_blocks, size_type block_size, size_type num_dynamic_smem_bytes, cudaStream_t stream, task_type task, bool cooperative = false)
   {
     if(num_blocks > 0)
     {
+#ifndef __CUDA_ARCH__
+      apply_smem_carveout();
+
+      // attributes which aren't properties of the kernel go through launch_ex
+      if(m_attributes.has_priority || m_attributes.num_persisting_bytes > 0)
+      {
+#if __BULK_HAS_LAUNCH_EX__
+        launch_ex(num_blocks, block_size, num_dynamic_smem_bytes, stream, task, 0, 0, cooperative);
+#else
+        bulk::detail::throw_on_error(cudaErrorNotSupported, "cuda_launcher::launch(): launch attributes require CUDART 11.8 or better");
+#endif
+        return;
+      } // end if
+
+      cudaEvent_t telemetry_start = bulk::detail::begin_launch_telemetry(m_device, stream);
+
+      try
+      {
+        if(cooperative)
+        {
+          super_t::launch_cooperative(num_blocks, block_size, num_dynamic_smem_bytes, stream, task);
+        } // end if
+        else
+        {
+          super_t::launch(num_blocks, block_size, num_dynamic_smem_bytes, stream, task);
+        } // end else
+      } // end try
+      catch(...)
+      {
+        bulk::detail::abandon_launch_telemetry(m_device, telemetry_start);
+        throw;
+      } // end catch
+#else
+      if(cooperative)
+      {
+        bulk::detail::terminate_with_message("cuda_launcher::launch(): cooperative launch is unsupported in __device__ code.");
+      } // end if
+
+      if(!m_attributes.empty())
+      {
+        bulk::detail::terminate_with_message("cuda_launcher::launch(): launch attributes are unsupported in __device__ code.");
+      } // end if
+
       super_t::launch(num_blocks, block_size, num_dynamic_smem_bytes, stream, task);
+#endif
+
+#ifndef __CUDA_ARCH__
+      if(telemetry_start)
+      {
+        record_launch_telemetry(telemetry_start, num_blocks, block_size, num_dynamic_smem_bytes, stream);
+      } // end if
+#endif
 
       bulk::detail::synchronize_if_enabled("bulk_kernel_by_value");
     } // end if
   } // end launch()
 
 
+#if __BULK_HAS_LAUNCH_EX__
+  // launches with the given attributes, e.g. cluster dimensions, followed by those set with set_attributes()
+  // launches with attributes are only available in __host__ code
+  __host__
+  void launch_ex(size_type num_blocks, size_type block_size, size_type num_dynamic_smem_bytes, cudaStream_t stream, task_type task, const cudaLaunchAttribute *attributes, unsigned int num_attributes, bool cooperative = false)
+  {
+    if(num_blocks > 0)
+    {
+      apply_smem_carveout();
+
+      // room for the caller's attributes and ours
+      cudaLaunchAttribute merged[max_num_launch_attributes];
+      unsigned int num_merged = 0;
+
+      for(unsigned int i = 0; i < num_attributes && num_merged < max_num_launch_attributes; ++i)
+      {
+        merged[num_merged++] = attributes[i];
+      } // end for
+
+      if(m_attributes.num_persisting_bytes > 0)
+      {
+        int max_window_size = 0;
+        bulk::detail::throw_on_error(cudaDeviceGetAttribute(&max_window_size, cudaDevAttrMaxAccessPolicyWindowSize, m_device), "cuda_launcher::launch_ex(): after cudaDeviceGetAttribute");
+
+        cudaLaunchAttribute &window = merged[num_merged++];
+        std::memset(&window, 0, sizeof(window));
+        window.id = cudaLaunchAttributeAccessPolicyWindow;
+        window.val.accessPolicyWindow.base_ptr  = const_cast<void*>(m_attributes.persisting_base);
+        window.val.accessPolicyWindow.num_bytes = thrust::min<std::size_t>(m_attributes.num_persisting_bytes, max_window_size);
+        window.val.accessPolicyWindow.hitRatio  = m_attributes.hit_ratio;
+        window.val.accessPolicyWindow.hitProp   = cudaAccessPropertyPersisting;
+        window.val.accessPolicyWindow.missProp  = cudaAccessPropertyStreaming;
+      } // end if
+
+      if(m_attributes.has_priority || cooperative)
+      {
+#if CUDART_VERSION >= 12000
+        if(m_attributes.has_priority)
+        {
+          cudaLaunchAttribute &priority = merged[num_merged++];
+          std::memset(&priority, 0, sizeof(priority));
+          priority.id = cudaLaunchAttributePriority;
+          priority.val.priority = m_attributes.priority;
+        } // end if
+
+        if(cooperative)
+        {
+          cudaLaunchAttribute &cooperate = merged[num_merged++];
+          std::memset(&cooperate, 0, sizeof(cooperate));
+          cooperate.id = cudaLaunchAttributeCooperative;
+          cooperate.val.cooperative = 1;
+        } // end if
+#else
+        bulk::detail::throw_on_error(cudaErrorNotSupported, "cuda_launcher::launch_ex(): per-launch priorities and cooperative launches with attributes require CUDART 12.0 or better");
+#endif
+      } // end if
+
+      cudaEvent_t telemetry_start = bulk::detail::begin_launch_telemetry(m_device, stream);
+
+      try
+      {
+        super_t::launch_ex(num_blocks, block_size, num_dynamic_smem_bytes, stream, task, merged, num_merged);
+      } // end try
+      catch(...)
+      {
+        bulk::detail::abandon_launch_telemetry(m_device, telemetry_start);
+        throw;
+      } // end catch
+
+      if(telemetry_start)
+      {
+        record_launch_telemetry(telemetry_start, num_blocks, block_size, num_dynamic_smem_bytes, stream);
+      } // end if
+
+      bulk::detail::synchronize_if_enabled("bulk_kernel_by_value");
+    } // end if
+  } // end launch_ex()
+#endif
+
+
+  // the carveout is a property of the kernel, so it's set before the launch rather than passed along with it
+  __host__
+  void apply_smem_carveout() const
+  {
+    if(m_attributes.smem_carveout >= 0)
+    {
+      bulk::detail::throw_on_error(cudaFuncSetAttribute(reinterpret_cast<const void*>(super_t::global_function_pointer()), cudaFuncAttributePreferredSharedMemoryCarveout, m_attributes.smem_carveout),
+                                   "cuda_launcher::apply_smem_carveout(): after cudaFuncSetAttribute");
+    } // end if
+  } // end apply_smem_carveout()
+
+
+  // telemetry is only available in __host__ code
+  __host__
+  void record_launch_telemetry(cudaEvent_t start, size_type num_blocks, size_type block_size, size_type num_dynamic_smem_bytes, cudaStream_t stream) const
+  {
+    size_type max_active_blocks = max_active_blocks_per_multiprocessor(m_device_properties, cached_function_attributes(), block_size, num_dynamic_smem_bytes);
+
+    launch_record record;
+    record.kernel_name = typeid(typename Closure::function_type).name();
+    record.device      = m_device;
+    record.stream      = stream;
+    record.num_groups  = num_blocks;
+    record.group_size  = block_size;
+    record.heap_size   = num_dynamic_smem_bytes;
+
+    record.max_active_groups_per_multiprocessor = max_active_blocks;
+
+    // warps are the unit of allocation
+    size_type warp_size = m_device_properties.warpSize;
+    size_type warps_per_block = (block_size + warp_size - 1) / warp_size;
+    size_type max_warps = m_device_properties.maxThreadsPerMultiProcessor / warp_size;
+    record.occupancy = max_warps > 0 ? float(max_active_blocks * warps_per_block) / float(max_warps) : 0.f;
+
+    record.elapsed_milliseconds = -1;
+
+    bulk::detail::end_launch_telemetry(start, record, stream);
+  } // end record_launch_telemetry()
+
+
   __host__ __device__
   static size_type max_active_blocks_per_multiprocessor(const device_properties_t &props,
                                                         const function_attributes_t &attr,
@@ -86,6 +274,113 @@ struct cuda_launcher_base
   } // end max_active_blocks_per_multiprocessor()
 
 
+  // the kernel's attributes are memoized per device in __host__ code
+  __host__ __device__
+  function_attributes_t cached_function_attributes() const
+  {
+#ifndef __CUDA_ARCH__
+    function_attributes_t result;
+
+    if(!launch_config_cache<super_t>::find_attributes(m_device, result))
+    {
+      result = bulk::detail::function_attributes(super_t::global_function_pointer());
+
+      launch_config_cache<super_t>::insert_attributes(m_device, result);
+    } // end if
+
+    return result;
+#else
+    return bulk::detail::function_attributes(super_t::global_function_pointer());
+#endif
+  } // end cached_function_attributes()
+
+
+  // looks up a configuration previously chosen for request on this device
+  // the cache is only available in __host__ code
+  __host__ __device__
+  bool find_config(const launch_config &request, launch_config &result) const
+  {
+#ifndef __CUDA_ARCH__
+    return launch_config_cache<super_t>::find(m_device, request, result);
+#else
+    return false;
+#endif
+  } // end find_config()
+
+
+  __host__ __device__
+  void insert_config(const launch_config &request, const launch_config &result) const
+  {
+#ifndef __CUDA_ARCH__
+    launch_config_cache<super_t>::insert(m_device, request, result);
+#endif
+  } // end insert_config()
+
+
+  // if request ought to be profiled, returns the word its launch should record its heap footprint into
+  // the profile is only available in __host__ code
+  __host__ __device__
+  unsigned int *begin_heap_profile(const launch_config &request, cudaStream_t stream) const
+  {
+#ifndef __CUDA_ARCH__
+    return heap_profile<super_t>::begin(m_device, request, stream);
+#else
+    return 0;
+#endif
+  } // end begin_heap_profile()
+
+
+  __host__ __device__
+  void end_heap_profile(const launch_config &request, cudaStream_t stream) const
+  {
+#ifndef __CUDA_ARCH__
+    heap_profile<super_t>::end(m_device, request, stream);
+#endif
+  } // end end_heap_profile()
+
+
+  // returns true if the heap profile of request became available since the last call,
+  // in which case any configuration previously chosen for request is stale
+  __host__ __device__
+  bool poll_heap_profile(const launch_config &request) const
+  {
+#ifndef __CUDA_ARCH__
+    return heap_profile<super_t>::poll(m_device, request);
+#else
+    return false;
+#endif
+  } // end poll_heap_profile()
+
+
+  // returns the smallest heap which accomodates request's profiled footprint,
+  // or the result of choose_heap_size() if the request hasn't been profiled or the footprint doesn't fit
+  __host__ __device__
+  size_type choose_profiled_heap_size(const launch_config &request, const device_properties_t &props, size_type group_size)
+  {
+    size_type result = choose_heap_size(props, group_size, request.heap_size);
+
+#ifndef __CUDA_ARCH__
+    unsigned int footprint = 0;
+
+    if(result > 0 && heap_profile<super_t>::find(m_device, request, footprint))
+    {
+      function_attributes_t attr = cached_function_attributes();
+
+      // keep the heap aligned
+      size_type candidate = (footprint + 7) & ~7u;
+
+      if(attr.sharedSizeBytes + candidate <= props.sharedMemPerBlock &&
+         max_active_blocks_per_multiprocessor(props, attr, group_size, candidate) > 0)
+      {
+        result = candidate;
+      } // end if
+    } // end if
+#endif
+
+    return result;
+  } // end choose_profiled_heap_size()
+
+
   // returns
   // 1. maximum number of additional dynamic smem bytes that would not lower the kernel's occupancy
   // 2. kernel occupancy
@@ -105,7 +400,7 @@ struct cuda_launcher_base
   __host__ __device__
   size_type choose_heap_size(const device_properties_t &props, size_type group_size, size_type requested_size)
   {
-    function_attributes_t attr = bulk::detail::function_attributes(super_t::global_function_pointer());
+    function_attributes_t attr = cached_function_attributes();
 
     // if the kernel's ptx version is < 200, we return 0 because there is no heap
     // if the user requested no heap, give him no heap
@@ -143,6 +438,52 @@ struct cuda_launcher_base
   } // end choose_smem_size()
 
 
+  // like choose_overflow_size, but no arena is reserved when request's profiled footprint fits the heap chosen
+  __host__ __device__
+  size_type choose_profiled_overflow_size(const launch_config &request, size_type heap_size) const
+  {
+#ifndef __CUDA_ARCH__
+    unsigned int footprint = 0;
+
+    if(heap_profile<super_t>::find(m_device, request, footprint) && footprint <= heap_size)
+    {
+      return 0;
+    } // end if
+#endif
+
+    return choose_overflow_size(request.heap_size, heap_size);
+  } // end choose_profiled_overflow_size()
+
+
+  // returns the size of each block's slot in the global arena which backs the heap once it
+  // overflows on-chip memory, or 0 if the heap chosen accomodates the request
+  // an allocation which overflows may be as large as the whole request
+  __host__ __device__
+  static size_type choose_overflow_size(size_type requested_heap_size, size_type heap_size)
+  {
+    if(requested_heap_size == use_default || requested_heap_size <= heap_size)
+    {
+      return 0;
+    } // end if
+
+    // keep the slots aligned
+    return (requested_heap_size + 255) & ~size_type(255);
+  } // end choose_overflow_size()
+
+
+  // the number of blocks of a launch which may be resident simultaneously
+  // i.e., the number of slots its global arena requires
+  __host__ __device__
+  size_type num_resident_blocks(size_type num_blocks, size_type block_size, size_type heap_size)
+  {
+    function_attributes_t attr = cached_function_attributes();
+
+    size_type occupancy = max_active_blocks_per_multiprocessor(device_properties(), attr, block_size, heap_size);
+
+    return thrust::min<size_type>(num_blocks, thrust::max<size_type>(1, occupancy) * device_properties().multiProcessorCount);
+  } // end num_resident_blocks()
+
+
   __host__ __device__
   size_type choose_group_size(size_type requested_size)
   {
@@ -150,7 +491,7 @@ struct cuda_launcher_base
 
     if(result == use_default)
     {
-      bulk::detail::function_attributes_t attr = bulk::detail::function_attributes(super_t::global_function_pointer());
+      bulk::detail::function_attributes_t attr = cached_function_attributes();
 
       return bulk::detail::block_size_with_maximum_potential_occupancy(attr, device_properties());
     } // end if
@@ -192,7 +533,7 @@ struct cuda_launcher_base
     int actual_limit = device_properties().maxGridSize[0];
 
     // get the limit of the PTX version of the kernel
-    int ptx_version = bulk::detail::function_attributes(super_t::global_function_pointer()).ptxVersion;
+    int ptx_version = cached_function_attributes().ptxVersion;
 
     int ptx_limit = 0;
 
@@ -217,7 +558,12 @@ struct cuda_launcher_base
   }
 
 
+  // a cluster dimension, an access policy window, a priority & cooperation
+  static const unsigned int max_num_launch_attributes = 4;
+
+  int m_device;
   device_properties_t m_device_properties;
+  launch_attributes m_attributes;
 }; // end cuda_launcher_base
 
 
@@ -252,47 +598,103 @@ struct cuda_launcher<
   {
     grid_type g = configure(request);
 
-    size_type num_blocks = g.size();
+    launch_config profile_request = make_launch_config(request.size(), request.this_exec.size(), request.this_exec.heap_size());
+    unsigned int *heap_mark = super_t::begin_heap_profile(profile_request, stream);
+
+    launch_blocks(g, c, stream, 0, g.size(), super_t::choose_profiled_overflow_size(profile_request, g.this_exec.heap_size()), heap_mark);
+
+    if(heap_mark)
+    {
+      super_t::end_heap_profile(profile_request, stream);
+    } // end if
+  } // end go()
+
+  // launches the blocks [first_block, first_block + num_blocks) of a configured grid
+  // e.g., the share of a grid which a single device executes
+  // each block's heap overflows into overflow_size bytes of global memory before the device's heap
+  // if heap_mark is nonzero, the blocks record their largest heap footprint there
+  __host__ __device__
+  void launch_blocks(grid_type g, Closure c, cudaStream_t stream, size_type first_block, size_type num_blocks, size_type overflow_size = 0, unsigned int *heap_mark = 0)
+  {
     size_type block_size = g.this_exec.size();
 
     if(num_blocks > 0 && block_size > 0)
     {
       size_type heap_size  = g.this_exec.heap_size();
 
-      size_type max_physical_grid_size = super_t::max_physical_grid_size();
+#ifndef __CUDA_ARCH__
+      // the arena is only reserved for launches from the host
+      // it returns to the pool in stream order once the launches below complete
+      size_type num_slots = (overflow_size > 0) ? super_t::num_resident_blocks(num_blocks, block_size, heap_size) : 0;
+
+      bulk::temporary_buffer<char> arena_storage(bulk::detail::global_arena_storage_size(num_slots, overflow_size), stream);
+
+      global_arena arena = make_global_arena(arena_storage.data(), num_slots, overflow_size);
 
-      // launch multiple grids in order to accomodate potentially too large grid size requests
-      // XXX these will all go in sequential order in the same stream, even though they are logically
-      //     parallel
-      if(block_size > 0)
+      if(num_slots > 0)
       {
-        size_type num_remaining_physical_blocks = num_blocks;
-        for(size_type block_offset = 0;
-            block_offset < num_blocks;
-            block_offset += max_physical_grid_size)
-        {
-          task_type task(g, c, block_offset);
+        bulk::detail::throw_on_error(cudaMemsetAsync(arena.in_use, 0, num_slots * sizeof(unsigned int), arena_storage.stream()),
+                                     "cuda_launcher::launch_blocks(): after cudaMemsetAsync");
+      } // end if
+#else
+      global_arena arena = make_global_arena();
+#endif
 
-          size_type num_physical_blocks = thrust::min<size_type>(num_remaining_physical_blocks, max_physical_grid_size);
+      // when the request exceeds the largest grid the device can launch, the task strides through the rest
+      size_type num_physical_blocks = thrust::min<size_type>(num_blocks, super_t::max_physical_grid_size());
 
-          super_t::launch(num_physical_blocks, block_size, heap_size, stream, task);
+      task_type task(g, c, first_block, num_blocks, arena, heap_mark);
 
-          num_remaining_physical_blocks -= num_physical_blocks;
-        } // end for block_offset
-      } // end if
+      super_t::launch(num_physical_blocks, block_size, heap_size, stream, task);
     } // end if
-  } // end go()
+  } // end launch_blocks()
 
   __host__ __device__
   grid_type configure(grid_type g)
   {
-    size_type block_size = super_t::choose_group_size(g.this_exec.size());
-    size_type heap_size  = super_t::choose_heap_size(device_properties(), block_size, g.this_exec.heap_size());
-    size_type num_blocks = g.size();
+    // the groups' configuration doesn't depend on how many there are, so the cache is keyed by the groups alone
+    // and launches whose number of groups varies share an entry
+    launch_config request = make_launch_config(1, g.this_exec.size(), g.this_exec.heap_size());
+    launch_config result;
 
-    return make_grid<grid_type>(num_blocks, make_block<block_type>(block_size, heap_size));
+    // a newly available heap profile invalidates the configuration chosen without it
+    if(super_t::poll_heap_profile(request) || !super_t::find_config(request, result))
+    {
+      size_type block_size = super_t::choose_group_size(g.this_exec.size());
+      size_type heap_size  = super_t::choose_profiled_heap_size(request, device_properties(), block_size);
+
+      result = make_launch_config(1, block_size, heap_size);
+
+      super_t::insert_config(request, result);
+    } // end if
+
+    return make_grid<grid_type>(g.size(), make_block<block_type>(result.group_size, result.heap_size));
   } // end configure()
 
+  // configures a grid whose groups may all be resident on the device simultaneously
+  // the number of groups requested is clamped to this limit
+  __host__ __device__
+  grid_type configure_resident(grid_type request)
+  {
+    grid_type g = configure(request);
+
+    size_type block_size = g.this_exec.size();
+    size_type heap_size  = g.this_exec.heap_size();
+
+    bulk::detail::function_attributes_t attr = super_t::cached_function_attributes();
+
+    size_type occupancy = super_t::max_active_blocks_per_multiprocessor(device_properties(), attr, block_size, heap_size);
+
+    size_type num_blocks = thrust::min<size_type>(occupancy * device_properties().multiProcessorCount, super_t::max_physical_grid_size());
+
+    if(request.size() != use_default)
+    {
+      num_blocks = thrust::min<size_type>(num_blocks, request.size());
+    } // end if
+
+    return make_grid<grid_type>(num_blocks, g.this_exec);
+  } // end configure_resident()
+
   // chooses a number of groups and a group size
   __host__ __device__
   thrust::pair<size_type, size_type> choose_sizes(size_type requested_num_groups, size_type requested_group_size)
@@ -318,6 +720,241 @@ struct cuda_launcher<
 }; // end cuda_launcher
 
 
+template<std::size_t blocksize, std::size_t grainsize, typename Closure>
+struct cuda_launcher<
+  concurrent_grid<
+    concurrent_group<
+      agent<grainsize>,
+      blocksize
+    >
+  >,
+  Closure
+>
+  : public cuda_launcher_base<blocksize, concurrent_grid<typename cuda_block<blocksize,grainsize>::type>, Closure>
+{
+  typedef cuda_launcher_base<blocksize, concurrent_grid<typename cuda_block<blocksize,grainsize>::type>, Closure> super_t;
+  typedef typename super_t::size_type size_type;
+
+  typedef concurrent_grid<typename cuda_block<blocksize,grainsize>::type> grid_type;
+  typedef typename grid_type::agent_type                                  block_type;
+
+  typedef typename super_t::task_type task_type;
+
+  // launch(...) requires a device which supports cooperative launch
+  // it is only available in __host__ code
+  __host__ __device__
+  void launch(grid_type request, Closure c, cudaStream_t stream)
+  {
+#ifndef __CUDA_ARCH__
+    int supported = 0;
+    bulk::detail::throw_on_error(cudaDeviceGetAttribute(&supported, cudaDevAttrCooperativeLaunch, super_t::m_device), "cuda_launcher::launch(): after cudaDeviceGetAttribute");
+
+    if(!supported)
+    {
+      bulk::detail::throw_on_error(cudaErrorNotSupported, "cuda_launcher::launch(): the device does not support cooperative launch");
+    } // end if
+
+    grid_type g = configure(request);
+
+    size_type num_blocks = g.size();
+    size_type block_size = g.this_exec.size();
+    size_type heap_size  = g.this_exec.heap_size();
+
+    if(num_blocks > 0 && block_size > 0)
+    {
+      // every block is resident, so each gets a slot of the arena
+      size_type overflow_size = super_t::choose_overflow_size(request.this_exec.heap_size(), heap_size);
+      size_type num_slots = (overflow_size > 0) ? num_blocks : 0;
+
+      // the barrier's state follows the arena's
+      size_type arena_size = bulk::detail::global_arena_storage_size(num_slots, overflow_size);
+      size_type barrier_offset = (arena_size + sizeof(unsigned int) - 1) & ~(sizeof(unsigned int) - 1);
+
+      bulk::temporary_buffer<char> storage(barrier_offset + grid_barrier::num_state_words * sizeof(unsigned int), stream);
+
+      global_arena arena = make_global_arena(storage.data(), num_slots, overflow_size);
+
+      if(num_slots > 0)
+      {
+        bulk::detail::throw_on_error(cudaMemsetAsync(arena.in_use, 0, num_slots * sizeof(unsigned int), storage.stream()),
+                                     "cuda_launcher::launch(): after cudaMemsetAsync");
+      } // end if
+
+      grid_barrier barrier(reinterpret_cast<unsigned int*>(storage.data() + barrier_offset));
+
+      bulk::detail::throw_on_error(cudaMemsetAsync(barrier.state, 0, grid_barrier::num_state_words * sizeof(unsigned int), storage.stream()),
+                                   "cuda_launcher::launch(): after cudaMemsetAsync");
+
+      task_type task(grid_type(num_blocks, g.this_exec, 0, barrier), c, arena);
+
+      super_t::launch(num_blocks, block_size, heap_size, stream, task, true);
+    } // end if
+#else
+    bulk::detail::terminate_with_message("cuda_launcher::launch(): concurrent_grid launches are unsupported in __device__ code.");
+#endif
+  } // end launch()
+
+  // chooses the groups' size & heap as for a parallel_group of concurrent_groups, then
+  // clamps the number of groups to the number which may be resident simultaneously
+  __host__ __device__
+  grid_type configure(grid_type g)
+  {
+    // the cache is keyed by the groups alone, and holds the largest number of groups which may be resident
+    launch_config request = make_launch_config(1, g.this_exec.size(), g.this_exec.heap_size());
+    launch_config result;
+
+    if(!super_t::find_config(request, result))
+    {
+      size_type block_size = super_t::choose_group_size(g.this_exec.size());
+      size_type heap_size  = super_t::choose_heap_size(device_properties(), block_size, g.this_exec.heap_size());
+
+      bulk::detail::function_attributes_t attr = super_t::cached_function_attributes();
+
+      size_type occupancy = super_t::max_active_blocks_per_multiprocessor(device_properties(), attr, block_size, heap_size);
+
+      size_type max_num_blocks = thrust::min<size_type>(occupancy * device_properties().multiProcessorCount, super_t::max_physical_grid_size());
+
+      result = make_launch_config(max_num_blocks, block_size, heap_size);
+
+      super_t::insert_config(request, result);
+    } // end if
+
+    size_type num_blocks = result.num_groups;
+
+    if(g.size() != use_default)
+    {
+      num_blocks = thrust::min<size_type>(num_blocks, g.size());
+    } // end if
+
+    return grid_type(num_blocks, make_block<block_type>(result.group_size, result.heap_size));
+  } // end configure()
+}; // end cuda_launcher
+
+
+template<std::size_t blocksize, std::size_t grainsize, typename Closure>
+struct cuda_launcher<
+  parallel_group<
+    cluster<
+      concurrent_group<
+        agent<grainsize>,
+        blocksize
+      >
+    >
+  >,
+  Closure
+>
+  : public cuda_launcher_base<blocksize, parallel_group<cluster<typename cuda_block<blocksize,grainsize>::type> >, Closure>
+{
+  typedef cuda_launcher_base<blocksize, parallel_group<cluster<typename cuda_block<blocksize,grainsize>::type> >, Closure> super_t;
+  typedef typename super_t::size_type size_type;
+
+  typedef parallel_group<cluster<typename cuda_block<blocksize,grainsize>::type> > grid_type;
+  typedef typename grid_type::agent_type                                          cluster_type;
+  typedef typename cluster_type::agent_type                                       block_type;
+
+  typedef typename super_t::task_type task_type;
+
+  // the largest cluster every device which supports clusters can launch
+  static const size_type max_portable_cluster_size = 8;
+
+  // launch(...) is only available in __host__ code
+  // clusters of more than one group require CUDA 11.8 and a device which supports clusters
+  __host__ __device__
+  void launch(grid_type request, Closure c, cudaStream_t stream)
+  {
+#ifndef __CUDA_ARCH__
+    grid_type g = configure(request);
+
+    size_type cluster_size = g.this_exec.size();
+    size_type block_size   = g.this_exec.this_exec.size();
+    size_type heap_size    = g.this_exec.this_exec.heap_size();
+
+    if(g.size() > 0 && block_size > 0)
+    {
+      // when the request exceeds the largest grid the device can launch, the task strides through the rest
+      size_type num_physical_clusters = thrust::min<size_type>(g.size(), super_t::max_physical_grid_size() / cluster_size);
+
+      task_type task(g, c);
+
+      if(cluster_size == 1)
+      {
+        super_t::launch(num_physical_clusters, block_size, heap_size, stream, task);
+      } // end if
+      else
+      {
+#if __BULK_HAS_LAUNCH_EX__
+        cudaLaunchAttribute attribute;
+        attribute.id = cudaLaunchAttributeClusterDimension;
+        attribute.val.clusterDim.x = cluster_size;
+        attribute.val.clusterDim.y = 1;
+        attribute.val.clusterDim.z = 1;
+
+        super_t::launch_ex(num_physical_clusters * cluster_size, block_size, heap_size, stream, task, &attribute, 1);
+#endif
+      } // end else
+    } // end if
+#else
+    bulk::detail::terminate_with_message("cuda_launcher::launch(): cluster launches are unsupported in __device__ code.");
+#endif
+  } // end launch()
+
+  // the cluster launch reserves no overflow arena, so heaps which overflow on-chip memory fall back to the device heap
+  // the cluster's heaps stay on chip, so they don't overflow into global memory
+  __host__
+  grid_type configure(grid_type g)
+  {
+    size_type cluster_size = g.this_exec.size();
+
+    if(cluster_size == use_default)
+    {
+      cluster_size = 1;
+    } // end if
+
+    if(cluster_size < 1 || cluster_size > max_portable_cluster_size)
+    {
+      bulk::detail::throw_on_error(cudaErrorInvalidConfiguration, "cuda_launcher::configure(): cluster size must be between 1 and 8");
+    } // end if
+
+    if(cluster_size > 1)
+    {
+      int supported = 0;
+
+#if __BULK_HAS_LAUNCH_EX__
+      bulk::detail::throw_on_error(cudaDeviceGetAttribute(&supported, cudaDevAttrClusterLaunch, super_t::m_device), "cuda_launcher::configure(): after cudaDeviceGetAttribute");
+#endif
+
+      if(!supported)
+      {
+        bulk::detail::throw_on_error(cudaErrorNotSupported, "cuda_launcher::configure(): the device does not support clusters");
+      } // end if
+    } // end if
+
+    // the cached configuration is that of the groups, which doesn't depend on how they're clustered
+    launch_config request = make_launch_config(1, g.this_exec.this_exec.size(), g.this_exec.this_exec.heap_size());
+    launch_config result;
+
+    if(!super_t::find_config(request, result))
+    {
+      size_type block_size = super_t::choose_group_size(g.this_exec.this_exec.size());
+      size_type heap_size  = super_t::choose_heap_size(device_properties(), block_size, g.this_exec.this_exec.heap_size());
+
+      result = make_launch_config(1, block_size, heap_size);
+
+      super_t::insert_config(request, result);
+    } // end if
+
+    // given no other info, occupy the machine
+    size_type num_clusters = g.size();
+    if(num_clusters == use_default)
+    {
+      num_clusters = thrust::max<size_type>(1, super_t::choose_num_groups(use_default, result.group_size) / cluster_size);
+    } // end if
+
+    return grid_type(num_clusters, cluster_type(cluster_size, make_block<block_type>(result.group_size, result.heap_size)));
+  } // end configure()
+}; // end cuda_launcher
+
+
 template<std::size_t blocksize, std::size_t grainsize, typename Closure>
 struct cuda_launcher<
   concurrent_group<
@@ -344,36 +981,75 @@ struct cuda_launcher<
 
     if(block_size > 0)
     {
-      task_type task(b, c);
+      launch_config profile_request = make_launch_config(1, request.size(), request.heap_size());
+
+#ifndef __CUDA_ARCH__
+      // the arena is only reserved for launches from the host
+      size_type overflow_size = super_t::choose_profiled_overflow_size(profile_request, heap_size);
+      size_type num_slots = (overflow_size > 0) ? 1 : 0;
+
+      bulk::temporary_buffer<char> arena_storage(bulk::detail::global_arena_storage_size(num_slots, overflow_size), stream);
+
+      global_arena arena = make_global_arena(arena_storage.data(), num_slots, overflow_size);
+
+      if(num_slots > 0)
+      {
+        bulk::detail::throw_on_error(cudaMemsetAsync(arena.in_use, 0, sizeof(unsigned int), arena_storage.stream()),
+                                     "cuda_launcher::launch(): after cudaMemsetAsync");
+      } // end if
+#else
+      global_arena arena = make_global_arena();
+#endif
+
+      unsigned int *heap_mark = super_t::begin_heap_profile(profile_request, stream);
+
+      task_type task(b, c, arena, heap_mark);
       super_t::launch(1, block_size, heap_size, stream, task);
+
+      if(heap_mark)
+      {
+        super_t::end_heap_profile(profile_request, stream);
+      } // end if
     } // end if
   } // end go()
 
   __host__ __device__
   block_type configure(block_type b)
   {
-    size_type block_size = super_t::choose_group_size(b.size());
-    size_type heap_size  = super_t::choose_heap_size(device_properties(), block_size, b.heap_size());
-    return make_block<block_type>(block_size, heap_size);
+    launch_config request = make_launch_config(1, b.size(), b.heap_size());
+    launch_config result;
+
+    // a newly available heap profile invalidates the configuration chosen without it
+    if(super_t::poll_heap_profile(request) || !super_t::find_config(request, result))
+    {
+      size_type block_size = super_t::choose_group_size(b.size());
+      size_type heap_size  = super_t::choose_profiled_heap_size(request, device_properties(), block_size);
+
+      result = make_launch_config(1, block_size, heap_size);
+
+      super_t::insert_config(request, result);
+    } // end if
+
+    return make_block<block_type>(result.group_size, result.heap_size);
   } // end configure()
 }; // end cuda_launcher
 
 
-template<std::size_t groupsize, std::size_t grainsize, typename Closure>
+template<std::size_t groupsize, std::size_t grainsize, typename Index, typename Closure>
 struct cuda_launcher<
   parallel_group<
-    agent<grainsize>,
+    agent<grainsize,Index>,
     groupsize
   >,
   Closure
 >
-  : public cuda_launcher_base<dynamic_group_size, parallel_group<agent<grainsize>,groupsize>,Closure>
+  : public cuda_launcher_base<dynamic_group_size, parallel_group<agent<grainsize,Index>,groupsize>,Closure>
 {
-  typedef cuda_launcher_base<dynamic_group_size, parallel_group<agent<grainsize>,groupsize>,Closure> super_t;
+  typedef cuda_launcher_base<dynamic_group_size, parallel_group<agent<grainsize,Index>,groupsize>,Closure> super_t;
   typedef typename super_t::size_type size_type; 
   typedef typename super_t::task_type task_type;
 
-  typedef parallel_group<agent<grainsize>,groupsize> group_type;
+  typedef parallel_group<agent<grainsize,Index>,groupsize> group_type;
 
   __host__ __device__
   void launch(group_type g, Closure c, cudaStream_t stream)
@@ -392,16 +1068,30 @@ struct cuda_launcher<
   __host__ __device__
   thrust::tuple<size_type,size_type> configure(group_type g)
   {
-    size_type block_size = thrust::min<size_type>(g.size(), super_t::choose_group_size(use_default));
+    // the cache holds the default block size and the most blocks a launch of that size ought to use,
+    // neither of which depends on the size of the group, so every launch shares an entry
+    launch_config request = make_launch_config(0, 0, 0);
+    launch_config result;
+
+    if(!super_t::find_config(request, result))
+    {
+      size_type default_block_size = super_t::choose_group_size(use_default);
+
+      // don't ask for more than a reasonable number of blocks
+      size_type max_blocks = super_t::choose_num_groups(bulk::use_default, default_block_size);
+
+      result = make_launch_config(max_blocks, default_block_size, 0);
+
+      super_t::insert_config(request, result);
+    } // end if
 
-    // don't ask for more than a reasonable number of blocks
-    size_type max_blocks = super_t::choose_num_groups(bulk::use_default, block_size);
+    size_type block_size = thrust::min<size_type>(g.size(), result.group_size);
 
     // given no limits at all, how many blocks would we launch?
     size_type num_blocks = (block_size > 0) ? (g.size() + block_size - 1) / block_size : 0;
 
     // don't ask for more blocks than the limit we prescribed for ourself
-    num_blocks = thrust::min<size_type>(num_blocks, max_blocks);
+    num_blocks = thrust::min<size_type>(num_blocks, size_type(result.num_groups));
 
     return thrust::make_tuple(num_blocks, block_size);
   } // end configure()
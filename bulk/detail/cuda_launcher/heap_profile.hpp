@@ -0,0 +1,241 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/detail/guarded_cuda_runtime_api.hpp>
+#include <bulk/detail/throw_on_error.hpp>
+#include <bulk/detail/host_mutex.hpp>
+#include <bulk/detail/event_pool.hpp>
+#include <bulk/detail/pinned_pool.hpp>
+#include <bulk/detail/stream_capture.hpp>
+#include <bulk/detail/cuda_launcher/launch_config_cache.hpp>
+#include <bulk/memory_pool.hpp>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+namespace detail
+{
+
+
+struct heap_profile_state
+{
+  heap_profile_state()
+    : enabled(false), generation(1)
+  {}
+
+  host_mutex   mutex;
+  bool         enabled;
+
+  // bumped to forget every profile
+  unsigned int generation;
+}; // end heap_profile_state
+
+
+// XXX see the note on host singletons in bulk/detail/config.hpp
+inline heap_profile_state &heap_profile_global_state()
+{
+  static heap_profile_state state;
+  return state;
+} // end heap_profile_global_state()
+
+
+// heap_profile records, per device, the largest on-chip heap footprint which the groups of a
+// __global__ function have required for a requested (group size, heap size) pair.
+// The first launch of each request after profiling is enabled measures it, and the
+// launcher sizes the heaps of later launches of that request by the measurement.
+// Kernel is a type unique to the __global__ function.
+// It is only meant to be used from __host__ code.
+template<typename Kernel>
+class heap_profile
+{
+  public:
+    static const int max_num_devices  = 16;
+    static const int max_num_profiles = 8;
+
+    // if request ought to be profiled on device, returns the word its groups' footprints should be
+    // recorded into, and the caller must call end() after its launch, otherwise returns 0
+    static unsigned int *begin(int device, const launch_config &request, cudaStream_t s)
+    {
+      heap_profile_state &state = heap_profile_global_state();
+      host_lock_guard guard(state.mutex);
+
+      if(!state.enabled || bulk::detail::is_capturing() || device < 0 || device >= max_num_devices)
+      {
+        return 0;
+      } // end if
+
+      if(find_entry(device, request, state.generation)) return 0;
+
+      // replace entries round-robin
+      // XXX an entry replaced while its measurement is in flight leaks its readback resources
+      storage_type &st = storage();
+      entry &e = st.profiles[device][st.next_profile[device]];
+      st.next_profile[device] = (st.next_profile[device] + 1) % max_num_profiles;
+
+      e.request    = request;
+      e.generation = state.generation;
+      e.finished   = false;
+      e.footprint  = 0;
+      e.host_mark  = static_cast<unsigned int*>(bulk::detail::allocate_pinned(sizeof(unsigned int)));
+      e.mark       = static_cast<unsigned int*>(bulk::default_memory_pool().allocate(sizeof(unsigned int), s));
+      e.done       = 0;
+
+      bulk::detail::throw_on_error(cudaMemsetAsync(e.mark, 0, sizeof(unsigned int), s), "heap_profile::begin(): after cudaMemsetAsync");
+
+      return e.mark;
+    } // end begin()
+
+    // enqueues the readback of the footprint recorded by request's launch into s
+    static void end(int device, const launch_config &request, cudaStream_t s)
+    {
+      heap_profile_state &state = heap_profile_global_state();
+      host_lock_guard guard(state.mutex);
+
+      entry *e = find_entry(device, request, state.generation);
+
+      if(e && !e->finished && e->done == 0)
+      {
+        bulk::detail::throw_on_error(cudaMemcpyAsync(e->host_mark, e->mark, sizeof(unsigned int), cudaMemcpyDeviceToHost, s), "heap_profile::end(): after cudaMemcpyAsync");
+
+        bulk::default_memory_pool().deallocate(e->mark, s);
+        e->mark = 0;
+
+        e->done = bulk::detail::default_event_pool().acquire(device);
+        bulk::detail::throw_on_error(cudaEventRecord(e->done, s), "heap_profile::end(): after cudaEventRecord");
+      } // end if
+    } // end end()
+
+    // returns true if the profile of request has just become available, i.e.
+    // the configuration chosen for request before the profile was measured is stale
+    // the cached configurations of every request of the same groups are forgotten,
+    // whatever their number of groups
+    static bool poll(int device, const launch_config &request)
+    {
+      bool result = false;
+
+      {
+        heap_profile_state &state = heap_profile_global_state();
+        host_lock_guard guard(state.mutex);
+
+        entry *e = find_entry(device, request, state.generation);
+
+        // don't block waiting for the profiled launch
+        if(e && !e->finished && e->done != 0 && cudaEventQuery(e->done) == cudaSuccess)
+        {
+          e->footprint = *e->host_mark;
+          e->finished  = true;
+
+          bulk::detail::deallocate_pinned(e->host_mark, sizeof(unsigned int));
+          e->host_mark = 0;
+
+          bulk::detail::default_event_pool().release(device, e->done);
+          e->done = 0;
+
+          result = true;
+        } // end if
+      } // end guard
+
+      // outside of the lock, so that the two caches' locks are never nested
+      if(result)
+      {
+        launch_config_cache<Kernel>::erase_group(device, request.group_size, request.heap_size);
+      } // end if
+
+      return result;
+    } // end poll()
+
+    // returns true and the footprint measured for request if its profile is available
+    static bool find(int device, const launch_config &request, unsigned int &footprint)
+    {
+      heap_profile_state &state = heap_profile_global_state();
+      host_lock_guard guard(state.mutex);
+
+      entry *e = find_entry(device, request, state.generation);
+
+      if(e && e->finished)
+      {
+        footprint = e->footprint;
+        return true;
+      } // end if
+
+      return false;
+    } // end find()
+
+  private:
+    struct entry
+    {
+      launch_config request;
+      unsigned int  generation;
+      bool          finished;
+      unsigned int  footprint;
+
+      // while the profile is measured, the launch records the footprint here
+      unsigned int  *mark;
+
+      // and it is read back here
+      unsigned int  *host_mark;
+      cudaEvent_t   done;
+    }; // end entry
+
+    // storage is POD so that it is zero-initialized, i.e., every entry begins stale
+    struct storage_type
+    {
+      entry profiles[max_num_devices][max_num_profiles];
+      int   next_profile[max_num_devices];
+    }; // end storage_type
+
+    static storage_type &storage()
+    {
+      static storage_type s;
+      return s;
+    } // end storage()
+
+    // the footprint doesn't depend on the number of groups
+    static bool same_group(const launch_config &lhs, const launch_config &rhs)
+    {
+      return lhs.group_size == rhs.group_size && lhs.heap_size == rhs.heap_size;
+    } // end same_group()
+
+    static entry *find_entry(int device, const launch_config &request, unsigned int generation)
+    {
+      if(device < 0 || device >= max_num_devices) return 0;
+
+      storage_type &st = storage();
+
+      for(int i = 0; i < max_num_profiles; ++i)
+      {
+        entry &e = st.profiles[device][i];
+
+        if(e.generation == generation && same_group(e.request, request))
+        {
+          return &e;
+        } // end if
+      } // end for i
+
+      return 0;
+    } // end find_entry()
+}; // end heap_profile
+
+
+} // end detail
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
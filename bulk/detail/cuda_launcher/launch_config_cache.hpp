@@ -0,0 +1,224 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/detail/host_mutex.hpp>
+#include <bulk/detail/cuda_launcher/cuda_launch_config.hpp>
+#include <cstddef>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+namespace detail
+{
+
+
+// a (num groups, group size, heap size) triple, either requested or chosen
+struct launch_config
+{
+  int num_groups;
+  int group_size;
+  int heap_size;
+}; // end launch_config
+
+
+inline __host__ __device__
+launch_config make_launch_config(int num_groups, int group_size, int heap_size)
+{
+  launch_config result = {num_groups, group_size, heap_size};
+  return result;
+} // end make_launch_config()
+
+
+inline __host__ __device__
+bool operator==(const launch_config &lhs, const launch_config &rhs)
+{
+  return lhs.num_groups == rhs.num_groups && lhs.group_size == rhs.group_size && lhs.heap_size == rhs.heap_size;
+} // end operator==()
+
+
+// the state shared by the caches of every kernel
+struct launch_config_cache_state
+{
+  launch_config_cache_state()
+    : hits(0), misses(0), generation(1)
+  {}
+
+  host_mutex mutex;
+  std::size_t hits;
+  std::size_t misses;
+
+  // entries filled in an earlier generation are stale
+  unsigned int generation;
+}; // end launch_config_cache_state
+
+
+// XXX see the note on host singletons in bulk/detail/config.hpp
+inline launch_config_cache_state &launch_config_cache_global_state()
+{
+  static launch_config_cache_state state;
+  return state;
+} // end launch_config_cache_global_state()
+
+
+// launch_config_cache memoizes the function attributes of a __global__ function and the
+// configurations chosen for it, per device. Kernel is a type unique to the __global__ function.
+// It is only meant to be used from __host__ code.
+template<typename Kernel>
+class launch_config_cache
+{
+  public:
+    static const int max_num_devices = 16;
+    static const int max_num_configs = 8;
+
+    static bool find_attributes(int device, function_attributes_t &result)
+    {
+      launch_config_cache_state &state = launch_config_cache_global_state();
+      host_lock_guard guard(state.mutex);
+
+      if(0 <= device && device < max_num_devices)
+      {
+        storage_type &s = storage();
+
+        if(s.attributes_generation[device] == state.generation)
+        {
+          ++state.hits;
+          result = s.attributes[device];
+          return true;
+        } // end if
+      } // end if
+
+      ++state.misses;
+      return false;
+    } // end find_attributes()
+
+    static void insert_attributes(int device, const function_attributes_t &attr)
+    {
+      launch_config_cache_state &state = launch_config_cache_global_state();
+      host_lock_guard guard(state.mutex);
+
+      // devices outside the range are not cached
+      if(0 <= device && device < max_num_devices)
+      {
+        storage_type &s = storage();
+
+        s.attributes[device] = attr;
+        s.attributes_generation[device] = state.generation;
+      } // end if
+    } // end insert_attributes()
+
+    static bool find(int device, const launch_config &request, launch_config &result)
+    {
+      launch_config_cache_state &state = launch_config_cache_global_state();
+      host_lock_guard guard(state.mutex);
+
+      if(0 <= device && device < max_num_devices)
+      {
+        storage_type &s = storage();
+
+        for(int i = 0; i < max_num_configs; ++i)
+        {
+          entry &e = s.configs[device][i];
+
+          if(e.generation == state.generation && e.request == request)
+          {
+            ++state.hits;
+            result = e.result;
+            return true;
+          } // end if
+        } // end for i
+      } // end if
+
+      ++state.misses;
+      return false;
+    } // end find()
+
+    static void insert(int device, const launch_config &request, const launch_config &result)
+    {
+      launch_config_cache_state &state = launch_config_cache_global_state();
+      host_lock_guard guard(state.mutex);
+
+      if(0 <= device && device < max_num_devices)
+      {
+        storage_type &s = storage();
+
+        // replace entries round-robin
+        entry &e = s.configs[device][s.next_config[device]];
+        s.next_config[device] = (s.next_config[device] + 1) % max_num_configs;
+
+        e.request = request;
+        e.result = result;
+        e.generation = state.generation;
+      } // end if
+    } // end insert()
+
+    // forgets every configuration chosen for requests of groups of group_size agents and heap_size bytes,
+    // however many groups they requested
+    static void erase_group(int device, int group_size, int heap_size)
+    {
+      launch_config_cache_state &state = launch_config_cache_global_state();
+      host_lock_guard guard(state.mutex);
+
+      if(0 <= device && device < max_num_devices)
+      {
+        storage_type &s = storage();
+
+        for(int i = 0; i < max_num_configs; ++i)
+        {
+          entry &e = s.configs[device][i];
+
+          if(e.request.group_size == group_size && e.request.heap_size == heap_size)
+          {
+            // generation 0 is never current
+            e.generation = 0;
+          } // end if
+        } // end for i
+      } // end if
+    } // end erase_group()
+
+  private:
+    struct entry
+    {
+      launch_config request;
+      launch_config result;
+      unsigned int generation;
+    }; // end entry
+
+    // storage is POD so that it is zero-initialized, i.e., every entry begins stale
+    struct storage_type
+    {
+      unsigned int          attributes_generation[max_num_devices];
+      function_attributes_t attributes[max_num_devices];
+      entry                 configs[max_num_devices][max_num_configs];
+      int                   next_config[max_num_devices];
+    }; // end storage_type
+
+    static storage_type &storage()
+    {
+      static storage_type s;
+      return s;
+    } // end storage()
+}; // end launch_config_cache
+
+
+} // end detail
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
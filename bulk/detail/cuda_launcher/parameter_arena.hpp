@@ -0,0 +1,350 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/detail/guarded_cuda_runtime_api.hpp>
+#include <bulk/detail/throw_on_error.hpp>
+#include <bulk/detail/terminate.hpp>
+#include <bulk/detail/host_mutex.hpp>
+#include <bulk/detail/event_pool.hpp>
+#include <bulk/detail/stream_capture.hpp>
+#include <bulk/detail/alignment.hpp>
+#include <deque>
+#include <cstddef>
+#include <cstring>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+namespace detail
+{
+
+
+// parameter_arena is a ring buffer of device memory which holds the parameters of
+// launches too large to pass by value. Each parameter is staged in a page-locked twin
+// of the ring and copied to the device with cudaMemcpyAsync in the launch's stream.
+// A parameter's space is reused once an event recorded after its launch completes,
+// so unlike cudaMalloc/cudaFree, nothing synchronizes the device.
+// parameter_arena is only meant to be used from __host__ code.
+class parameter_arena
+{
+  public:
+    typedef std::size_t size_type;
+
+    static const size_type default_capacity = 1 << 20;
+
+    // identifies a parameter's space in the ring
+    struct allocation
+    {
+      size_type begin;
+      size_type end;
+    }; // end allocation
+
+    parameter_arena(size_type capacity = default_capacity)
+      : m_device(-1),
+        m_capacity(capacity),
+        m_buffer(0),
+        m_staging(0),
+        m_head(0)
+    {}
+
+    ~parameter_arena()
+    {
+      // swallow errors
+      for(std::deque<record>::iterator r = m_records.begin(); r != m_records.end(); ++r)
+      {
+        if(r->event)
+        {
+          cudaEventSynchronize(r->event);
+          cudaEventDestroy(r->event);
+        } // end if
+      } // end for r
+
+      if(m_buffer)  cudaFree(m_buffer);
+      if(m_staging) cudaFreeHost(m_staging);
+    } // end ~parameter_arena()
+
+    // copies the size bytes at src to the device in stream s and returns their device address
+    // the space remains reserved until retire(a, s) is called and the work before it in s completes
+    // returns 0 if the parameter does not fit in the arena
+    void *push(int device, const void *src, size_type size, size_type alignment, cudaStream_t s, allocation &a)
+    {
+      host_lock_guard guard(m_mutex);
+
+      if(size > m_capacity) return 0;
+
+      if(m_buffer == 0)
+      {
+        m_device = device;
+        bulk::detail::throw_on_error(cudaMalloc(&m_buffer, m_capacity), "cudaMalloc in parameter_arena::push");
+        bulk::detail::throw_on_error(cudaHostAlloc(&m_staging, m_capacity, cudaHostAllocPortable), "cudaHostAlloc in parameter_arena::push");
+      } // end if
+
+      size_type begin = 0;
+      while(!find_space(size, alignment, begin))
+      {
+        // wait for the oldest parameter's launch to complete
+        if(m_records.empty() || m_records.front().event == 0)
+        {
+          // the oldest parameter has yet to be retired, so we can't wait on it
+          return 0;
+        } // end if
+
+        bulk::detail::throw_on_error(cudaEventSynchronize(m_records.front().event), "cudaEventSynchronize in parameter_arena::push");
+
+        pop_front();
+      } // end while
+
+      a.begin = begin;
+      a.end   = begin + size;
+
+      record r = {a.begin, a.end, 0};
+      m_records.push_back(r);
+      m_head = a.end;
+
+      char *staging = reinterpret_cast<char*>(m_staging) + a.begin;
+      char *result  = reinterpret_cast<char*>(m_buffer)  + a.begin;
+
+      std::memcpy(staging, src, size);
+
+      bulk::detail::throw_on_error(cudaMemcpyAsync(result, staging, size, cudaMemcpyHostToDevice, s), "cudaMemcpyAsync in parameter_arena::push");
+
+      return result;
+    } // end push()
+
+    // marks a's space for reuse after the work currently enqueued in s completes
+    void retire(const allocation &a, cudaStream_t s)
+    {
+      host_lock_guard guard(m_mutex);
+
+      for(std::deque<record>::reverse_iterator r = m_records.rbegin(); r != m_records.rend(); ++r)
+      {
+        if(r->begin == a.begin && r->event == 0)
+        {
+          r->event = bulk::detail::default_event_pool().acquire(m_device);
+
+          bulk::detail::throw_on_error(cudaEventRecord(r->event, s), "cudaEventRecord in parameter_arena::retire");
+
+          break;
+        } // end if
+      } // end for r
+    } // end retire()
+
+  private:
+    struct record
+    {
+      size_type begin;
+      size_type end;
+      cudaEvent_t event;
+    }; // end record
+
+    static size_type align_up(size_type x, size_type alignment)
+    {
+      return alignment > 1 ? (x + alignment - 1) / alignment * alignment : x;
+    } // end align_up()
+
+    void pop_front()
+    {
+      bulk::detail::default_event_pool().release(m_device, m_records.front().event);
+      m_records.pop_front();
+    } // end pop_front()
+
+    // reclaims the space of the parameters whose launches have completed
+    void reclaim()
+    {
+      while(!m_records.empty() && m_records.front().event != 0 && cudaEventQuery(m_records.front().event) == cudaSuccess)
+      {
+        pop_front();
+      } // end while
+
+      if(m_records.empty()) m_head = 0;
+    } // end reclaim()
+
+    bool find_space(size_type size, size_type alignment, size_type &result)
+    {
+      reclaim();
+
+      size_type begin = align_up(m_head, alignment);
+
+      if(m_records.empty())
+      {
+        result = 0;
+        return true;
+      } // end if
+
+      size_type oldest = m_records.front().begin;
+
+      if(oldest < m_head)
+      {
+        // the live space is [oldest, m_head), so try the end of the ring, then its beginning
+        if(begin + size <= m_capacity)
+        {
+          result = begin;
+          return true;
+        } // end if
+
+        if(size <= oldest)
+        {
+          result = 0;
+          return true;
+        } // end if
+      } // end if
+      else
+      {
+        // the live space has wrapped around, so only [m_head, oldest) is free
+        if(begin + size <= oldest)
+        {
+          result = begin;
+          return true;
+        } // end if
+      } // end else
+
+      return false;
+    } // end find_space()
+
+    host_mutex m_mutex;
+    int m_device;
+    size_type m_capacity;
+    void *m_buffer;
+    void *m_staging;
+    size_type m_head;
+    std::deque<record> m_records;
+}; // end parameter_arena
+
+
+// each device's parameter_arena, or 0 if the device's parameters are not pooled
+// XXX see the note on host singletons in bulk/detail/config.hpp
+inline parameter_arena *default_parameter_arena(int device)
+{
+  static const int max_num_devices = 16;
+  static parameter_arena arenas[max_num_devices];
+
+  return (0 <= device && device < max_num_devices) ? &arenas[device] : 0;
+} // end default_parameter_arena()
+
+
+// copies a parameter to device memory which belongs to the graph being captured on this thread
+inline void *capture_parameter(const void *src, std::size_t size)
+{
+#if CUDART_VERSION >= 10010
+  // cudaMalloc and synchronization are prohibited in the capturing thread unless we relax the capture mode
+  cudaStreamCaptureMode mode = cudaStreamCaptureModeRelaxed;
+  bulk::detail::throw_on_error(cudaThreadExchangeStreamCaptureMode(&mode), "cudaThreadExchangeStreamCaptureMode in capture_parameter");
+
+  void *result = 0;
+  cudaStream_t s = 0;
+
+  // copy in a stream of our own, which is neither captured nor synchronizes with the capture
+  cudaError_t error = cudaMalloc(&result, size);
+  if(!error) error = cudaStreamCreateWithFlags(&s, cudaStreamNonBlocking);
+  if(!error) error = cudaMemcpyAsync(result, src, size, cudaMemcpyHostToDevice, s);
+  if(!error) error = cudaStreamSynchronize(s);
+
+  if(s) cudaStreamDestroy(s);
+
+  cudaThreadExchangeStreamCaptureMode(&mode);
+
+  if(error && result) cudaFree(result);
+
+  bulk::detail::throw_on_error(error, "cudaMemcpyAsync in capture_parameter");
+
+  bulk::detail::this_thread_capture_allocations()->push_back(result);
+
+  return result;
+#else
+  bulk::detail::terminate_with_message("capture_parameter(): capturing large parameters requires CUDA 10.1");
+  return 0;
+#endif
+} // end capture_parameter()
+
+
+// launch_parameter copies a launch's parameter to device memory before the launch
+// and releases it after the launch is enqueued. Parameters are placed in
+//   1. the graph's memory while bulk::capture() is recording,
+//   2. the device's parameter_arena, or, failing that,
+//   3. memory from cudaMalloc, which is freed synchronously.
+// launch_parameter is only meant to be used from __host__ code.
+template<typename T>
+class launch_parameter
+{
+  public:
+    launch_parameter(const T &x, cudaStream_t s)
+      : m_ptr(0), m_arena(0), m_owns_ptr(false)
+    {
+      if(bulk::detail::is_capturing())
+      {
+        m_ptr = reinterpret_cast<T*>(capture_parameter(&x, sizeof(T)));
+        return;
+      } // end if
+
+      int device = 0;
+      bulk::detail::throw_on_error(cudaGetDevice(&device), "cudaGetDevice in launch_parameter ctor");
+
+      m_arena = default_parameter_arena(device);
+
+      if(m_arena)
+      {
+        m_ptr = reinterpret_cast<T*>(m_arena->push(device, &x, sizeof(T), alignment_of<T>::value, s, m_allocation));
+      } // end if
+
+      if(m_ptr == 0)
+      {
+        m_arena = 0;
+        m_owns_ptr = true;
+
+        bulk::detail::throw_on_error(cudaMalloc(&m_ptr, sizeof(T)), "cudaMalloc in launch_parameter ctor");
+        bulk::detail::throw_on_error(cudaMemcpy(m_ptr, &x, sizeof(T), cudaMemcpyHostToDevice), "cudaMemcpy in launch_parameter ctor");
+      } // end if
+    } // end launch_parameter()
+
+    T *get() const
+    {
+      return m_ptr;
+    } // end get()
+
+    // call after the launch which uses the parameter is enqueued in s
+    void release(cudaStream_t s)
+    {
+      if(m_arena)
+      {
+        m_arena->retire(m_allocation, s);
+      } // end if
+      else if(m_owns_ptr)
+      {
+        bulk::detail::terminate_on_error(cudaFree(m_ptr), "in launch_parameter::release");
+      } // end else if
+
+      m_ptr = 0;
+      m_arena = 0;
+      m_owns_ptr = false;
+    } // end release()
+
+  private:
+    T *m_ptr;
+    parameter_arena *m_arena;
+    parameter_arena::allocation m_allocation;
+    bool m_owns_ptr;
+}; // end launch_parameter
+
+
+} // end detail
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
@@ -17,8 +17,8 @@
 #include <bulk/detail/config.hpp>
 #include <bulk/detail/cuda_launcher/runtime_introspection.hpp>
 #include <bulk/detail/throw_on_error.hpp>
+#include <bulk/detail/host_mutex.hpp>
 #include <thrust/system/cuda/detail/guarded_cuda_runtime_api.h>
-#include <thrust/detail/util/blocking.h>
 #include <thrust/detail/minmax.h>
 #include <thrust/system_error.h>
 #include <thrust/system/cuda/error.h>
@@ -62,28 +62,61 @@ inline device_properties_t device_properties_uncached(int device_id)
 }
 
 
+// the properties of the first few devices, shared by every host thread
+struct device_properties_cache
+{
+  static const int max_num_devices = 16;
+
+  device_properties_cache()
+  {
+    for(int i = 0; i < max_num_devices; ++i)
+    {
+      properties_exist[i] = false;
+    }
+  }
+
+  host_mutex mutex;
+  bool properties_exist[max_num_devices];
+  device_properties_t device_properties[max_num_devices];
+}; // end device_properties_cache
+
+
+// XXX see the note on host singletons in bulk/detail/config.hpp
+inline device_properties_cache &shared_device_properties_cache()
+{
+  static device_properties_cache cache;
+  return cache;
+} // end shared_device_properties_cache()
+
+
 inline device_properties_t device_properties_cached(int device_id)
 {
   // cache the result of get_device_properties, because it is slow
   // only cache the first few devices
-  static const int max_num_devices                              = 16;
-
-  static bool properties_exist[max_num_devices]                 = {0};
-  static device_properties_t device_properties[max_num_devices] = {};
+  static const int max_num_devices = device_properties_cache::max_num_devices;
 
-  if(device_id >= max_num_devices)
+  if(device_id < 0 || device_id >= max_num_devices)
   {
     return device_properties_uncached(device_id);
   }
 
+  // each thread keeps a copy of its own so that launches from many threads needn't contend for the lock
+  static __BULK_THREAD_LOCAL__ bool properties_exist[max_num_devices] = {0};
+  static __BULK_THREAD_LOCAL__ device_properties_t device_properties[max_num_devices];
+
   if(!properties_exist[device_id])
   {
-    device_properties[device_id] = device_properties_uncached(device_id);
+    device_properties_cache &shared = shared_device_properties_cache();
+
+    host_lock_guard guard(shared.mutex);
+
+    if(!shared.properties_exist[device_id])
+    {
+      shared.device_properties[device_id] = device_properties_uncached(device_id);
+      shared.properties_exist[device_id] = true;
+    }
 
-    // disallow the compiler to move the write to properties_exist[device_id]
-    // before the initialization of device_properties[device_id]
-    __thrust_compiler_fence();
-    
+    device_properties[device_id] = shared.device_properties[device_id];
     properties_exist[device_id] = true;
   }
 
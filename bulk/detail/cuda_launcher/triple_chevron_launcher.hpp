@@ -20,6 +20,7 @@
 #include <bulk/detail/alignment.hpp>
 #include <bulk/detail/throw_on_error.hpp>
 #include <bulk/detail/cuda_launcher/parameter_ptr.hpp>
+#include <bulk/detail/cuda_launcher/parameter_arena.hpp>
 
 // It's not possible to launch a CUDA kernel unless __BULK_HAS_CUDART__
 // is 1, so we'd like to just hide all this code when that macro is 0.
@@ -31,6 +32,14 @@
 // will terminate the program at runtime if CUDART is not available.
 
 
+// cudaLaunchKernelEx and its launch attributes, e.g. cluster dimensions, arrived with CUDA 11.8
+#if defined(CUDART_VERSION) && (CUDART_VERSION >= 11080)
+#  define __BULK_HAS_LAUNCH_EX__ 1
+#else
+#  define __BULK_HAS_LAUNCH_EX__ 0
+#endif
+
+
 BULK_NAMESPACE_PREFIX
 namespace bulk
 {
@@ -149,6 +158,43 @@ class triple_chevron_launcher : protected triple_chevron_launcher_base<block_siz
       workaround::unsupported_path(num_blocks, block_size, num_dynamic_smem_bytes, stream, task);
 #endif
     } // end launch()
+
+    // launches the blocks such that they are all resident at once, or reports an error if they can't be
+    // cooperative launch is only available in __host__ code
+    inline __host__
+    void launch_cooperative(unsigned int num_blocks, unsigned int block_size, size_t num_dynamic_smem_bytes, cudaStream_t stream, task_type task)
+    {
+#if __BULK_HAS_CUDART__ && (CUDART_VERSION >= 9000)
+      void *args[] = {&task};
+
+      bulk::detail::throw_on_error(cudaLaunchCooperativeKernel(reinterpret_cast<void*>(super_t::global_function_pointer()), dim3(num_blocks), dim3(block_size), args, num_dynamic_smem_bytes, stream),
+                                   "after cudaLaunchCooperativeKernel in triple_chevron_launcher::launch_cooperative()");
+#else
+      bulk::detail::terminate_with_message("triple_chevron_launcher::launch_cooperative(): cooperative launch requires CUDART 9.0 or better.");
+#endif
+    } // end launch_cooperative()
+
+#if __BULK_HAS_LAUNCH_EX__
+    // launches the blocks with the given launch attributes, e.g. the dimensions of their clusters
+    // launches with attributes are only available in __host__ code
+    inline __host__
+    void launch_ex(unsigned int num_blocks, unsigned int block_size, size_t num_dynamic_smem_bytes, cudaStream_t stream, task_type task, cudaLaunchAttribute *attributes, unsigned int num_attributes)
+    {
+      cudaLaunchConfig_t config;
+      std::memset(&config, 0, sizeof(config));
+      config.gridDim          = dim3(num_blocks);
+      config.blockDim         = dim3(block_size);
+      config.dynamicSmemBytes = num_dynamic_smem_bytes;
+      config.stream           = stream;
+      config.attrs            = attributes;
+      config.numAttrs         = num_attributes;
+
+      void *args[] = {&task};
+
+      bulk::detail::throw_on_error(cudaLaunchKernelExC(&config, reinterpret_cast<const void*>(super_t::global_function_pointer()), args),
+                                   "after cudaLaunchKernelExC in triple_chevron_launcher::launch_ex()");
+    } // end launch_ex()
+#endif
 };
 
 
@@ -173,14 +219,23 @@ class triple_chevron_launcher<block_size_,Function,false> : protected triple_che
         __host__ __device__
         static void supported_path(unsigned int num_blocks, unsigned int block_size, size_t num_dynamic_smem_bytes, cudaStream_t stream, task_type task)
         {
-          bulk::detail::parameter_ptr<task_type> parm = bulk::detail::make_parameter<task_type>(task);
-
 #if __BULK_HAS_CUDART__
 #  ifndef __CUDA_ARCH__
+          // stage the task in the parameter arena rather than cudaMalloc it,
+          // because the subsequent cudaFree would synchronize the device
+          bulk::detail::launch_parameter<task_type> parm(task, stream);
+
           cudaConfigureCall(dim3(num_blocks), dim3(block_size), num_dynamic_smem_bytes, stream);
           cudaSetupArgument(static_cast<const task_type*>(parm.get()), 0);
-          bulk::detail::throw_on_error(cudaLaunch(super_t::global_function_pointer()), "after cudaLaunch in triple_chevron_launcher::launch()");
+          cudaError_t error = cudaLaunch(super_t::global_function_pointer());
+
+          // release the parameter even if the launch failed
+          parm.release(stream);
+
+          bulk::detail::throw_on_error(error, "after cudaLaunch in triple_chevron_launcher::launch()");
 #  else
+          bulk::detail::parameter_ptr<task_type> parm = bulk::detail::make_parameter<task_type>(task);
+
           void *param_buffer = cudaGetParameterBuffer(alignment_of<task_type>::value, sizeof(task_type));
           task_type *task_ptr = parm.get();
           std::memcpy(param_buffer, &task_ptr, sizeof(task_type*));
@@ -203,6 +258,57 @@ class triple_chevron_launcher<block_size_,Function,false> : protected triple_che
       workaround::unsupported_path(num_blocks, block_size, num_dynamic_smem_bytes, stream, task);
 #endif
     } // end launch()
+
+    // launches the blocks such that they are all resident at once, or reports an error if they can't be
+    // cooperative launch is only available in __host__ code
+    inline __host__
+    void launch_cooperative(unsigned int num_blocks, unsigned int block_size, size_t num_dynamic_smem_bytes, cudaStream_t stream, task_type task)
+    {
+#if __BULK_HAS_CUDART__ && (CUDART_VERSION >= 9000)
+      bulk::detail::launch_parameter<task_type> parm(task, stream);
+
+      const task_type *task_ptr = parm.get();
+      void *args[] = {&task_ptr};
+
+      cudaError_t error = cudaLaunchCooperativeKernel(reinterpret_cast<void*>(super_t::global_function_pointer()), dim3(num_blocks), dim3(block_size), args, num_dynamic_smem_bytes, stream);
+
+      // release the parameter even if the launch failed
+      parm.release(stream);
+
+      bulk::detail::throw_on_error(error, "after cudaLaunchCooperativeKernel in triple_chevron_launcher::launch_cooperative()");
+#else
+      bulk::detail::terminate_with_message("triple_chevron_launcher::launch_cooperative(): cooperative launch requires CUDART 9.0 or better.");
+#endif
+    } // end launch_cooperative()
+
+#if __BULK_HAS_LAUNCH_EX__
+    // launches the blocks with the given launch attributes, e.g. the dimensions of their clusters
+    // launches with attributes are only available in __host__ code
+    inline __host__
+    void launch_ex(unsigned int num_blocks, unsigned int block_size, size_t num_dynamic_smem_bytes, cudaStream_t stream, task_type task, cudaLaunchAttribute *attributes, unsigned int num_attributes)
+    {
+      bulk::detail::launch_parameter<task_type> parm(task, stream);
+
+      cudaLaunchConfig_t config;
+      std::memset(&config, 0, sizeof(config));
+      config.gridDim          = dim3(num_blocks);
+      config.blockDim         = dim3(block_size);
+      config.dynamicSmemBytes = num_dynamic_smem_bytes;
+      config.stream           = stream;
+      config.attrs            = attributes;
+      config.numAttrs         = num_attributes;
+
+      const task_type *task_ptr = parm.get();
+      void *args[] = {&task_ptr};
+
+      cudaError_t error = cudaLaunchKernelExC(&config, reinterpret_cast<const void*>(super_t::global_function_pointer()), args);
+
+      // release the parameter even if the launch failed
+      parm.release(stream);
+
+      bulk::detail::throw_on_error(error, "after cudaLaunchKernelExC in triple_chevron_launcher::launch_ex()");
+    } // end launch_ex()
+#endif
 };
 
 
@@ -18,6 +18,7 @@
 
 #include <bulk/detail/config.hpp>
 #include <bulk/malloc.hpp>
+#include <bulk/static_scratch.hpp>
 #include <bulk/execution_policy.hpp>
 #include <bulk/detail/tuple_transform.hpp>
 #include <bulk/detail/closure.hpp>
@@ -80,13 +81,13 @@ class task_base
     {
       group_type &g;
 
-      __device__
+      __host__ __device__
       substitutor(group_type &g)
         : g(g)
       {}
 
       template<unsigned int depth>
-      __device__
+      __host__ __device__
       typename bulk::detail::cursor_result<cursor<depth>,group_type>::type
       operator()(cursor<depth> c) const
       {
@@ -94,7 +95,7 @@ class task_base
       }
 
       template<typename T>
-      __device__
+      __host__ __device__
       T &operator()(T &x) const
       {
         return x;
@@ -221,14 +222,131 @@ class cuda_task<
     typedef typename grid_type::size_type   size_type;
 
   private:
+    // the on-chip scratch the closure's function reserves statically
+    static const std::size_t scratch_size = static_scratch_size<typename closure_type::function_type>::value;
+
+    // the logical blocks [block_offset, block_offset + num_blocks) of the grid
     size_type block_offset;
+    size_type num_blocks;
+
+    // backs the blocks' heaps once they overflow on-chip memory
+    global_arena arena;
+
+    // if nonzero, the blocks record the largest heap footprint among them here
+    unsigned int *heap_mark;
+
+  public:
+
+    __host__ __device__
+    cuda_task(grid_type g, closure_type c, size_type offset, size_type num, global_arena a = make_global_arena(), unsigned int *mark = 0)
+      : super_t(g,c),
+        block_offset(offset),
+        num_blocks(num),
+        arena(a),
+        heap_mark(mark)
+    {}
+
+    // each physical block strides through the logical blocks, so a launch may request more groups than
+    // the device's largest grid holds, and the logical blocks of any size of request are a single launch
+    __device__
+    void operator()()
+    {
+      // guard use of CUDA built-ins from foreign compilers
+#ifdef __CUDA_ARCH__
+      for(size_type logical_block = blockIdx.x;
+          logical_block < num_blocks;
+          logical_block += gridDim.x)
+      {
+        // instantiate a view of this grid
+        grid_type this_grid =
+          make_grid<grid_type>(
+            super_t::g.size(),
+            make_block<block_type>(
+              blockDim.x,
+              super_t::g.this_exec.heap_size(),
+              thread_type(threadIdx.x),
+              block_offset + logical_block
+            ),
+            0
+        );
+
+#if __CUDA_ARCH__ >= 200
+        // the previous logical block may still be using its shared storage
+        if(logical_block != blockIdx.x)
+        {
+          this_grid.this_exec.wait();
+        }
+
+        // initialize shared storage
+        if(this_grid.this_exec.this_exec.index() == 0)
+        {
+          bulk::detail::init_on_chip_malloc(this_grid.this_exec.heap_size());
+          bulk::detail::init_global_arena_malloc(arena, blockIdx.x);
+          bulk::detail::init_static_scratch(static_scratch_storage<scratch_size>::get(), scratch_size);
+        }
+        this_grid.this_exec.wait();
+#endif
+
+        substitute_placeholders_and_execute(this_grid, super_t::c);
+
+#if __CUDA_ARCH__ >= 200
+        if(arena.num_slots > 0 || heap_mark != 0)
+        {
+          this_grid.this_exec.wait();
+
+          if(this_grid.this_exec.this_exec.index() == 0)
+          {
+            // return this block's slot of the arena
+            bulk::detail::finalize_global_arena_malloc();
+
+            if(heap_mark != 0)
+            {
+              atomicMax(heap_mark, static_cast<unsigned int>(bulk::detail::on_chip_heap_high_water_mark()));
+            }
+          }
+        }
+#endif
+      } // end for logical_block
+#endif
+    } // end operator()
+}; // end cuda_task
+
+
+// specialize cuda_task for a cooperatively launched CUDA grid
+template<std::size_t blocksize, std::size_t grainsize, typename Closure>
+class cuda_task<
+  concurrent_grid<
+    concurrent_group<
+      agent<grainsize>,
+      blocksize
+    >
+  >,
+  Closure
+> : public task_base<concurrent_grid<typename cuda_block<blocksize,grainsize>::type>,Closure>
+{
+  private:
+    typedef task_base<concurrent_grid<typename cuda_block<blocksize,grainsize>::type>,Closure> super_t;
+
+  public:
+    typedef typename super_t::group_type    grid_type;
+    typedef typename grid_type::agent_type  block_type;
+    typedef typename block_type::agent_type thread_type;
+    typedef typename super_t::closure_type  closure_type;
+    typedef typename grid_type::size_type   size_type;
+
+  private:
+    // the on-chip scratch the closure's function reserves statically
+    static const std::size_t scratch_size = static_scratch_size<typename closure_type::function_type>::value;
+
+    // backs the blocks' heaps once they overflow on-chip memory
+    global_arena arena;
 
   public:
 
     __host__ __device__
-    cuda_task(grid_type g, closure_type c, size_type offset)
+    cuda_task(grid_type g, closure_type c, global_arena a = make_global_arena())
       : super_t(g,c),
-        block_offset(offset)
+        arena(a)
     {}
 
     __device__
@@ -237,16 +355,17 @@ class cuda_task<
       // guard use of CUDA built-ins from foreign compilers
 #ifdef __CUDA_ARCH__
       // instantiate a view of this grid
-      grid_type this_grid =
-        make_grid<grid_type>(
-          super_t::g.size(),
-          make_block<block_type>(
-            blockDim.x,
-            super_t::g.this_exec.heap_size(),
-            thread_type(threadIdx.x),
-            block_offset + blockIdx.x
-          ),
-          0
+      // the grid is launched in a single piece, so blockIdx.x is the block's index
+      grid_type this_grid(
+        super_t::g.size(),
+        make_block<block_type>(
+          blockDim.x,
+          super_t::g.this_exec.heap_size(),
+          thread_type(threadIdx.x),
+          blockIdx.x
+        ),
+        0,
+        super_t::g.barrier()
       );
 
 #if __CUDA_ARCH__ >= 200
@@ -254,11 +373,124 @@ class cuda_task<
       if(this_grid.this_exec.this_exec.index() == 0)
       {
         bulk::detail::init_on_chip_malloc(this_grid.this_exec.heap_size());
+        bulk::detail::init_global_arena_malloc(arena, blockIdx.x);
+        bulk::detail::init_static_scratch(static_scratch_storage<scratch_size>::get(), scratch_size);
       }
       this_grid.this_exec.wait();
 #endif
 
       substitute_placeholders_and_execute(this_grid, super_t::c);
+
+#if __CUDA_ARCH__ >= 200
+      if(arena.num_slots > 0)
+      {
+        this_grid.this_exec.wait();
+
+        if(this_grid.this_exec.this_exec.index() == 0)
+        {
+          // return this block's slot of the arena
+          bulk::detail::finalize_global_arena_malloc();
+        }
+      }
+#endif
+#endif
+    } // end operator()
+}; // end cuda_task
+
+
+// specialize cuda_task for a grid of CUDA thread block clusters
+template<std::size_t blocksize, std::size_t grainsize, typename Closure>
+class cuda_task<
+  parallel_group<
+    cluster<
+      concurrent_group<
+        agent<grainsize>,
+        blocksize
+      >
+    >
+  >,
+  Closure
+> : public task_base<parallel_group<cluster<typename cuda_block<blocksize,grainsize>::type> >,Closure>
+{
+  private:
+    typedef task_base<parallel_group<cluster<typename cuda_block<blocksize,grainsize>::type> >,Closure> super_t;
+
+  public:
+    typedef typename super_t::group_type     grid_type;
+    typedef typename grid_type::agent_type   cluster_type;
+    typedef typename cluster_type::agent_type block_type;
+    typedef typename block_type::agent_type  thread_type;
+    typedef typename super_t::closure_type   closure_type;
+    typedef typename grid_type::size_type    size_type;
+
+  private:
+    // the on-chip scratch the closure's function reserves statically
+    static const std::size_t scratch_size = static_scratch_size<typename closure_type::function_type>::value;
+
+    // backs the blocks' heaps once they overflow on-chip memory
+    global_arena arena;
+
+  public:
+    __host__ __device__
+    cuda_task(grid_type g, closure_type c, global_arena a = make_global_arena())
+      : super_t(g,c),
+        arena(a)
+    {}
+
+    // the blocks of each cluster are consecutive, and each physical cluster strides through the logical clusters
+    __device__
+    void operator()()
+    {
+      // guard use of CUDA built-ins from foreign compilers
+#ifdef __CUDA_ARCH__
+      const size_type cluster_size = super_t::g.this_exec.size();
+      const size_type num_physical_clusters = gridDim.x / cluster_size;
+
+      for(size_type logical_cluster = blockIdx.x / cluster_size;
+          logical_cluster < super_t::g.size();
+          logical_cluster += num_physical_clusters)
+      {
+        // instantiate a view of this grid
+        grid_type this_grid(
+          super_t::g.size(),
+          cluster_type(
+            cluster_size,
+            make_block<block_type>(
+              blockDim.x,
+              super_t::g.this_exec.this_exec.heap_size(),
+              thread_type(threadIdx.x),
+              blockIdx.x % cluster_size
+            ),
+            logical_cluster
+          ),
+          0
+        );
+
+#if __CUDA_ARCH__ >= 200
+        // initialize shared storage
+        // the previous logical cluster waited for its accesses to finish before it returned
+        if(this_grid.this_exec.this_exec.this_exec.index() == 0)
+        {
+          bulk::detail::init_on_chip_malloc(this_grid.this_exec.this_exec.heap_size());
+          bulk::detail::init_global_arena_malloc(arena, blockIdx.x);
+          bulk::detail::init_static_scratch(static_scratch_storage<scratch_size>::get(), scratch_size);
+        }
+        this_grid.this_exec.this_exec.wait();
+#endif
+
+        substitute_placeholders_and_execute(this_grid, super_t::c);
+
+        // a block's heap must outlive the other blocks' accesses to it
+        this_grid.this_exec.wait();
+
+#if __CUDA_ARCH__ >= 200
+        if(this_grid.this_exec.this_exec.this_exec.index() == 0)
+        {
+          // return this block's slot of the arena
+          bulk::detail::finalize_global_arena_malloc();
+        }
+#endif
+      } // end for logical_cluster
 #endif
     } // end operator()
 }; // end cuda_task
@@ -283,10 +515,22 @@ class cuda_task<
     typedef typename super_t::closure_type  closure_type;
     typedef typename block_type::size_type  size_type;
 
+  private:
+    // the on-chip scratch the closure's function reserves statically
+    static const std::size_t scratch_size = static_scratch_size<typename closure_type::function_type>::value;
+
+    // backs the block's heap once it overflows on-chip memory
+    global_arena arena;
+
+    // if nonzero, the block records its heap footprint here
+    unsigned int *heap_mark;
+
   public:
     __host__ __device__
-    cuda_task(block_type b, closure_type c)
-      : super_t(b,c)
+    cuda_task(block_type b, closure_type c, global_arena a = make_global_arena(), unsigned int *mark = 0)
+      : super_t(b,c),
+        arena(a),
+        heap_mark(mark)
     {}
 
     __device__
@@ -308,23 +552,43 @@ class cuda_task<
       if(this_block.this_exec.index() == 0)
       {
         bulk::detail::init_on_chip_malloc(this_block.heap_size());
+        bulk::detail::init_global_arena_malloc(arena, 0);
+        bulk::detail::init_static_scratch(static_scratch_storage<scratch_size>::get(), scratch_size);
       }
       this_block.wait();
 #endif
 
       substitute_placeholders_and_execute(this_block, super_t::c);
+
+#if __CUDA_ARCH__ >= 200
+      if(arena.num_slots > 0 || heap_mark != 0)
+      {
+        this_block.wait();
+
+        if(this_block.this_exec.index() == 0)
+        {
+          // return the block's slot of the arena
+          bulk::detail::finalize_global_arena_malloc();
+
+          if(heap_mark != 0)
+          {
+            atomicMax(heap_mark, static_cast<unsigned int>(bulk::detail::on_chip_heap_high_water_mark()));
+          }
+        }
+      }
+#endif
 #endif
     } // end operator()
 }; // end cuda_task
 
 
 // specialize cuda_task for a single big parallel group
-template<std::size_t groupsize, std::size_t grainsize, typename Closure>
-class cuda_task<parallel_group<agent<grainsize>,groupsize>,Closure>
-  : public task_base<parallel_group<agent<grainsize>,groupsize>,Closure>
+template<std::size_t groupsize, std::size_t grainsize, typename Index, typename Closure>
+class cuda_task<parallel_group<agent<grainsize,Index>,groupsize>,Closure>
+  : public task_base<parallel_group<agent<grainsize,Index>,groupsize>,Closure>
 {
   private:
-    typedef task_base<parallel_group<agent<grainsize>,groupsize>,Closure> super_t;
+    typedef task_base<parallel_group<agent<grainsize,Index>,groupsize>,Closure> super_t;
 
   public:
     typedef typename super_t::closure_type closure_type;
@@ -340,18 +604,19 @@ class cuda_task<parallel_group<agent<grainsize>,groupsize>,Closure>
     {
       // guard use of CUDA built-ins from foreign compilers
 #ifdef __CUDA_ARCH__
-      typedef int size_type;
+      typedef Index size_type;
 
-      const size_type grid_size = gridDim.x * blockDim.x;
+      // the built-ins are widened before they're multiplied, so a wide Index may count past 2^31
+      const size_type grid_size = size_type(gridDim.x) * blockDim.x;
 
-      for(size_type tid = blockDim.x * blockIdx.x + threadIdx.x;
+      for(size_type tid = size_type(blockDim.x) * blockIdx.x + threadIdx.x;
           tid < super_t::g.size();
           tid += grid_size)
       {
         // instantiate a view of the exec group
-        parallel_group<agent<grainsize>,groupsize> this_group(
+        parallel_group<agent<grainsize,Index>,groupsize> this_group(
           1,
-          agent<grainsize>(tid),
+          agent<grainsize,Index>(tid),
           0
         );
 
@@ -0,0 +1,103 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/detail/guarded_cuda_runtime_api.hpp>
+#include <bulk/detail/resource_pool.hpp>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+namespace detail
+{
+
+
+struct event_traits
+{
+  typedef cudaEvent_t resource_type;
+
+  // XXX cudaEventBlockingSync makes creation expensive
+  static const unsigned int create_flags = cudaEventDisableTiming;
+
+  static cudaError_t create(cudaEvent_t *e)
+  {
+    return cudaEventCreateWithFlags(e, create_flags);
+  }
+
+  static cudaError_t destroy(cudaEvent_t e)
+  {
+    return cudaEventDestroy(e);
+  }
+
+  static bool is_idle(cudaEvent_t e)
+  {
+    return cudaEventQuery(e) == cudaSuccess;
+  }
+}; // end event_traits
+
+
+typedef device_resource_pool<event_traits> event_pool;
+
+
+// events which measure elapsed time, e.g. for launch telemetry
+struct timing_event_traits
+{
+  typedef cudaEvent_t resource_type;
+
+  static cudaError_t create(cudaEvent_t *e)
+  {
+    return cudaEventCreate(e);
+  }
+
+  static cudaError_t destroy(cudaEvent_t e)
+  {
+    return cudaEventDestroy(e);
+  }
+
+  static bool is_idle(cudaEvent_t e)
+  {
+    return cudaEventQuery(e) == cudaSuccess;
+  }
+}; // end timing_event_traits
+
+
+typedef device_resource_pool<timing_event_traits> timing_event_pool;
+
+
+// the pool of events which bulk::future records
+// XXX see the note on host singletons in bulk/detail/config.hpp
+inline event_pool &default_event_pool()
+{
+  static event_pool pool(256);
+  return pool;
+} // end default_event_pool()
+
+
+// XXX see the note on host singletons in bulk/detail/config.hpp
+inline timing_event_pool &default_timing_event_pool()
+{
+  static timing_event_pool pool;
+  return pool;
+} // end default_timing_event_pool()
+
+
+} // end detail
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
@@ -0,0 +1,169 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include <bulk/detail/config.hpp>
+#include <bulk/future.hpp>
+#include <bulk/async.hpp>
+#include <bulk/execution_policy.hpp>
+#include <bulk/detail/closure.hpp>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+namespace detail
+{
+namespace future_detail
+{
+
+
+// a continuation without a stream of its own goes into before's stream
+// stream order implies the dependency, so there's no need to wait on before's event
+template<typename ExecutionGroup, typename Closure>
+__host__ __device__
+future<void> then(future<void> &before, ExecutionGroup g, Closure c, cudaEvent_t before_event = 0, bool record_event = true, const launch_attributes &attr = launch_attributes())
+{
+  future<void> result = bulk::detail::async_in_stream(g, c, future_core_access::stream(before), before_event, record_event, attr);
+
+  future_core_access::transfer_stream(before, result);
+
+  return result;
+} // end then()
+
+
+// a continuation with a stream of its own waits on before's event, as well as on the launch's
+template<typename ExecutionGroup, typename Closure>
+__host__ __device__
+future<void> then(future<void> &before, async_launch<ExecutionGroup> launch, Closure c)
+{
+  if(!launch.is_stream_valid())
+  {
+    // the launch asked for a new stream, so just reuse before's stream
+    // so a priority applies to the launch rather than the stream
+    return then(before, launch.exec(), c, launch.before_event(), launch.records_event(), launch.attributes());
+  } // end if
+
+#if __BULK_HAS_CUDART__
+  // the launch waits on before's event here, and on its own before_event within async_in_stream
+  if(future_core_access::event(before) != 0)
+  {
+    cudaStream_t s = bulk::detail::capture_aware_stream(launch.stream());
+
+    bulk::detail::throw_on_error(cudaStreamWaitEvent(s, future_core_access::event(before), 0), "cudaStreamWaitEvent in future::then");
+  } // end if
+#else
+  bulk::detail::terminate_with_message("future::then(): cudaStreamWaitEvent requires CUDART");
+#endif
+
+  return bulk::detail::async_in_stream(launch.exec(), c, launch.stream(), launch.before_event(), launch.records_event(), launch.attributes());
+} // end then()
+
+
+} // end future_detail
+} // end detail
+
+
+template<typename ExecutionGroup, typename Function>
+__host__ __device__
+future<void> future<void>::then(ExecutionGroup g, Function f)
+{
+  return detail::future_detail::then(*this, g, detail::make_closure(f));
+} // end future::then()
+
+
+template<typename ExecutionGroup, typename Function, typename Arg1>
+__host__ __device__
+future<void> future<void>::then(ExecutionGroup g, Function f, Arg1 arg1)
+{
+  return detail::future_detail::then(*this, g, detail::make_closure(f,arg1));
+} // end future::then()
+
+
+template<typename ExecutionGroup, typename Function, typename Arg1, typename Arg2>
+__host__ __device__
+future<void> future<void>::then(ExecutionGroup g, Function f, Arg1 arg1, Arg2 arg2)
+{
+  return detail::future_detail::then(*this, g, detail::make_closure(f,arg1,arg2));
+} // end future::then()
+
+
+template<typename ExecutionGroup, typename Function, typename Arg1, typename Arg2, typename Arg3>
+__host__ __device__
+future<void> future<void>::then(ExecutionGroup g, Function f, Arg1 arg1, Arg2 arg2, Arg3 arg3)
+{
+  return detail::future_detail::then(*this, g, detail::make_closure(f,arg1,arg2,arg3));
+} // end future::then()
+
+
+template<typename ExecutionGroup, typename Function, typename Arg1, typename Arg2, typename Arg3, typename Arg4>
+__host__ __device__
+future<void> future<void>::then(ExecutionGroup g, Function f, Arg1 arg1, Arg2 arg2, Arg3 arg3, Arg4 arg4)
+{
+  return detail::future_detail::then(*this, g, detail::make_closure(f,arg1,arg2,arg3,arg4));
+} // end future::then()
+
+
+template<typename ExecutionGroup, typename Function, typename Arg1, typename Arg2, typename Arg3, typename Arg4, typename Arg5>
+__host__ __device__
+future<void> future<void>::then(ExecutionGroup g, Function f, Arg1 arg1, Arg2 arg2, Arg3 arg3, Arg4 arg4, Arg5 arg5)
+{
+  return detail::future_detail::then(*this, g, detail::make_closure(f,arg1,arg2,arg3,arg4,arg5));
+} // end future::then()
+
+
+template<typename ExecutionGroup, typename Function, typename Arg1, typename Arg2, typename Arg3, typename Arg4, typename Arg5, typename Arg6>
+__host__ __device__
+future<void> future<void>::then(ExecutionGroup g, Function f, Arg1 arg1, Arg2 arg2, Arg3 arg3, Arg4 arg4, Arg5 arg5, Arg6 arg6)
+{
+  return detail::future_detail::then(*this, g, detail::make_closure(f,arg1,arg2,arg3,arg4,arg5,arg6));
+} // end future::then()
+
+
+template<typename ExecutionGroup, typename Function, typename Arg1, typename Arg2, typename Arg3, typename Arg4, typename Arg5, typename Arg6, typename Arg7>
+__host__ __device__
+future<void> future<void>::then(ExecutionGroup g, Function f, Arg1 arg1, Arg2 arg2, Arg3 arg3, Arg4 arg4, Arg5 arg5, Arg6 arg6, Arg7 arg7)
+{
+  return detail::future_detail::then(*this, g, detail::make_closure(f,arg1,arg2,arg3,arg4,arg5,arg6,arg7));
+} // end future::then()
+
+
+template<typename ExecutionGroup, typename Function, typename Arg1, typename Arg2, typename Arg3, typename Arg4, typename Arg5, typename Arg6, typename Arg7, typename Arg8>
+__host__ __device__
+future<void> future<void>::then(ExecutionGroup g, Function f, Arg1 arg1, Arg2 arg2, Arg3 arg3, Arg4 arg4, Arg5 arg5, Arg6 arg6, Arg7 arg7, Arg8 arg8)
+{
+  return detail::future_detail::then(*this, g, detail::make_closure(f,arg1,arg2,arg3,arg4,arg5,arg6,arg7,arg8));
+} // end future::then()
+
+
+template<typename ExecutionGroup, typename Function, typename Arg1, typename Arg2, typename Arg3, typename Arg4, typename Arg5, typename Arg6, typename Arg7, typename Arg8, typename Arg9>
+__host__ __device__
+future<void> future<void>::then(ExecutionGroup g, Function f, Arg1 arg1, Arg2 arg2, Arg3 arg3, Arg4 arg4, Arg5 arg5, Arg6 arg6, Arg7 arg7, Arg8 arg8, Arg9 arg9)
+{
+  return detail::future_detail::then(*this, g, detail::make_closure(f,arg1,arg2,arg3,arg4,arg5,arg6,arg7,arg8,arg9));
+} // end future::then()
+
+
+template<typename ExecutionGroup, typename Function, typename Arg1, typename Arg2, typename Arg3, typename Arg4, typename Arg5, typename Arg6, typename Arg7, typename Arg8, typename Arg9, typename Arg10>
+__host__ __device__
+future<void> future<void>::then(ExecutionGroup g, Function f, Arg1 arg1, Arg2 arg2, Arg3 arg3, Arg4 arg4, Arg5 arg5, Arg6 arg6, Arg7 arg7, Arg8 arg8, Arg9 arg9, Arg10 arg10)
+{
+  return detail::future_detail::then(*this, g, detail::make_closure(f,arg1,arg2,arg3,arg4,arg5,arg6,arg7,arg8,arg9,arg10));
+} // end future::then()
+
+
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
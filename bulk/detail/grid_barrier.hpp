@@ -0,0 +1,97 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+namespace detail
+{
+
+
+// a barrier among the groups of a grid whose groups are all resident at once
+// its state is a pair of words of global memory which must be zero before the first wait:
+//   state[0] counts the groups which have arrived
+//   state[1] counts the completed generations of the barrier
+// XXX a grid which isn't entirely resident deadlocks at the barrier,
+//     which is why only cooperative launches get one
+struct grid_barrier
+{
+  static const unsigned int num_state_words = 2;
+
+  __host__ __device__
+  grid_barrier(unsigned int *s = 0)
+    : state(s)
+  {}
+
+  // every agent of every one of the num_groups groups must call wait
+  template<typename ConcurrentGroup>
+  __device__
+  void wait(ConcurrentGroup &g, unsigned int num_groups) const
+  {
+#if __CUDA_ARCH__ >= 200
+    g.wait();
+
+    if(g.this_exec.index() == 0)
+    {
+      volatile unsigned int *generation = state + 1;
+
+      // the generation can't advance until this group arrives, so it's safe to read it first
+      unsigned int my_generation = *generation;
+
+      // make this group's writes visible to the groups which leave the barrier
+      __threadfence();
+
+      if(atomicAdd(state, 1u) == num_groups - 1)
+      {
+        // the last group to arrive resets the count before it releases the others,
+        // so no group can arrive at the next generation early
+        atomicExch(state, 0u);
+
+        __threadfence();
+
+        atomicAdd(state + 1, 1u);
+      } // end if
+      else
+      {
+        while(*generation == my_generation)
+        {
+#if __CUDA_ARCH__ >= 700
+          __nanosleep(32);
+#endif
+        } // end while
+      } // end else
+
+      // order the loads after the barrier after the release
+      __threadfence();
+    } // end if
+
+    g.wait();
+#endif
+  } // end wait()
+
+  unsigned int *state;
+}; // end grid_barrier
+
+
+} // end detail
+} // end bulk
+BULK_NAMESPACE_SUFFIX
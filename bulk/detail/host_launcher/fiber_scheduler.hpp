@@ -0,0 +1,232 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <cstddef>
+#include <cstdlib>
+
+#if !defined(_WIN32)
+#  include <ucontext.h>
+#  define __BULK_HAS_HOST_FIBERS__ 1
+#else
+#  define __BULK_HAS_HOST_FIBERS__ 0
+#endif
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+namespace detail
+{
+
+
+// fiber_scheduler runs the agents of a concurrent_group on a single host thread
+// each agent is a fiber with a stack of its own; an agent which waits yields to the
+// scheduler, which resumes the agents in rounds, so every agent reaches a barrier
+// before any agent leaves it
+// it is only meant to be used from __host__ code
+// XXX without ucontext, e.g. on Windows, the agents run one after another and wait() does nothing
+class fiber_scheduler
+{
+  public:
+    typedef void (*agent_function)(void *context, int agent_index);
+
+    fiber_scheduler()
+      : m_stack_size(default_stack_size()),
+        m_capacity(0),
+        m_stacks(0),
+        m_size(0),
+        m_current(-1),
+        m_function(0),
+        m_context(0)
+#if __BULK_HAS_HOST_FIBERS__
+        ,m_fibers(0),
+        m_finished(0)
+#endif
+    {}
+
+    ~fiber_scheduler()
+    {
+      std::free(m_stacks);
+#if __BULK_HAS_HOST_FIBERS__
+      std::free(m_fibers);
+      std::free(m_finished);
+#endif
+    }
+
+    // invokes f(context, i) for each i in [0, size) and returns once every invocation has returned
+    void run(int size, agent_function f, void *context)
+    {
+      m_function = f;
+      m_context  = context;
+      m_size     = size;
+
+      // a lone agent has nothing to wait on
+      if(size <= 1 || !__BULK_HAS_HOST_FIBERS__)
+      {
+        for(int i = 0; i < size; ++i)
+        {
+          m_current = i;
+          f(context, i);
+        } // end for i
+
+        m_current = -1;
+        return;
+      } // end if
+
+#if __BULK_HAS_HOST_FIBERS__
+      reserve(size);
+
+      fiber_scheduler *enclosing = current();
+      current() = this;
+
+      for(int i = 0; i < size; ++i)
+      {
+        getcontext(&m_fibers[i]);
+        m_fibers[i].uc_stack.ss_sp   = m_stacks + i * m_stack_size;
+        m_fibers[i].uc_stack.ss_size = m_stack_size;
+        m_fibers[i].uc_link          = &m_scheduler;
+        makecontext(&m_fibers[i], &fiber_scheduler::entry, 0);
+
+        m_finished[i] = false;
+      } // end for i
+
+      for(int num_finished = 0; num_finished < size; )
+      {
+        num_finished = 0;
+
+        // resume each agent until it waits or returns
+        for(int i = 0; i < size; ++i)
+        {
+          if(!m_finished[i])
+          {
+            m_current = i;
+            swapcontext(&m_scheduler, &m_fibers[i]);
+          } // end if
+
+          if(m_finished[i]) ++num_finished;
+        } // end for i
+      } // end for
+
+      m_current = -1;
+      current() = enclosing;
+#endif
+    } // end run()
+
+    // suspends the calling agent until every other agent of the group has waited or returned
+    void wait()
+    {
+#if __BULK_HAS_HOST_FIBERS__
+      if(m_size > 1 && m_current >= 0)
+      {
+        swapcontext(&m_fibers[m_current], &m_scheduler);
+      } // end if
+#endif
+    } // end wait()
+
+    // the scheduler of the group whose agent is running on this thread, if any
+    static fiber_scheduler *&current()
+    {
+      static __BULK_THREAD_LOCAL__ fiber_scheduler *result = 0;
+      return result;
+    } // end current()
+
+  private:
+    // noncopyable
+    fiber_scheduler(const fiber_scheduler &);
+    fiber_scheduler &operator=(const fiber_scheduler &);
+
+    // the stack of each agent may be sized with the environment variable BULK_HOST_FIBER_STACK_SIZE
+    static std::size_t default_stack_size()
+    {
+      const char *env = std::getenv("BULK_HOST_FIBER_STACK_SIZE");
+
+      std::size_t result = env ? std::strtoul(env, 0, 10) : 0;
+
+      return result >= 4096 ? result : 64 * 1024;
+    } // end default_stack_size()
+
+#if __BULK_HAS_HOST_FIBERS__
+    // the stacks persist between runs, so that groups of the same size don't reallocate them
+    void reserve(int size)
+    {
+      if(size > m_capacity)
+      {
+        std::free(m_stacks);
+        std::free(m_fibers);
+        std::free(m_finished);
+
+        m_stacks   = static_cast<char*>(std::malloc(size * m_stack_size));
+        m_fibers   = static_cast<ucontext_t*>(std::malloc(size * sizeof(ucontext_t)));
+        m_finished = static_cast<bool*>(std::malloc(size * sizeof(bool)));
+
+        if(!m_stacks || !m_fibers || !m_finished)
+        {
+          std::abort();
+        } // end if
+
+        m_capacity = size;
+      } // end if
+    } // end reserve()
+
+    static void entry()
+    {
+      fiber_scheduler *self = current();
+
+      int i = self->m_current;
+
+      self->m_function(self->m_context, i);
+
+      // returning resumes the scheduler through uc_link
+      self->m_finished[i] = true;
+    } // end entry()
+#endif
+
+    std::size_t    m_stack_size;
+    int            m_capacity;
+    char          *m_stacks;
+    int            m_size;
+    int            m_current;
+    agent_function m_function;
+    void          *m_context;
+
+#if __BULK_HAS_HOST_FIBERS__
+    ucontext_t     m_scheduler;
+    ucontext_t    *m_fibers;
+    bool          *m_finished;
+#endif
+}; // end fiber_scheduler
+
+
+// the host's implementation of concurrent_group::wait()
+// outside of a group run by the host backend, there's nothing to wait for
+inline void host_group_wait()
+{
+  fiber_scheduler *scheduler = fiber_scheduler::current();
+
+  if(scheduler)
+  {
+    scheduler->wait();
+  } // end if
+} // end host_group_wait()
+
+
+} // end detail
+} // end bulk
+BULK_NAMESPACE_SUFFIX
@@ -0,0 +1,234 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/execution_policy.hpp>
+#include <bulk/detail/cuda_task.hpp>
+#include <bulk/detail/host_launcher/thread_pool.hpp>
+#include <bulk/detail/host_launcher/fiber_scheduler.hpp>
+#include <cstddef>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+namespace detail
+{
+
+
+// runs the agents of a concurrent group on the calling thread
+// the scheduler is reused by later groups on the same thread, unless an agent of one of them launches another group
+inline void run_host_group(int size, fiber_scheduler::agent_function f, void *context)
+{
+  if(fiber_scheduler::current())
+  {
+    fiber_scheduler nested;
+    nested.run(size, f, context);
+    return;
+  } // end if
+
+  // XXX each thread's scheduler lives as long as the program
+  static __BULK_THREAD_LOCAL__ fiber_scheduler *scheduler = 0;
+
+  if(!scheduler)
+  {
+    scheduler = new fiber_scheduler;
+  } // end if
+
+  scheduler->run(size, f, context);
+} // end run_host_group()
+
+
+// on the host, a concurrent group which requests the default size has a single agent
+template<typename Size>
+Size choose_host_group_size(Size static_size, Size requested_size)
+{
+  if(static_size > 0) return static_size;
+
+  return requested_size == use_default ? 1 : requested_size;
+} // end choose_host_group_size()
+
+
+template<typename ExecutionGroup, typename Closure> class host_launcher;
+
+
+// a parallel group of agents is a loop over the pool
+template<std::size_t groupsize, std::size_t grainsize, typename Index, typename Closure>
+class host_launcher<parallel_group<agent<grainsize,Index>,groupsize>,Closure>
+  : public task_base<parallel_group<agent<grainsize,Index>,groupsize>,Closure>
+{
+  private:
+    typedef task_base<parallel_group<agent<grainsize,Index>,groupsize>,Closure> super_t;
+
+  public:
+    typedef typename super_t::group_type   group_type;
+    typedef typename super_t::closure_type closure_type;
+    typedef typename group_type::size_type size_type;
+
+    host_launcher(group_type g, closure_type c)
+      : super_t(g,c)
+    {}
+
+    void launch()
+    {
+      // agents are cheap, so hand them out in chunks
+      default_host_thread_pool().parallel_for(super_t::g.size(), 1024, &host_launcher::run_agents, this);
+    } // end launch()
+
+  private:
+    static void run_agents(void *context, std::size_t first, std::size_t last)
+    {
+      host_launcher *self = static_cast<host_launcher*>(context);
+
+      for(std::size_t i = first; i < last; ++i)
+      {
+        // instantiate a view of the exec group as cuda_task does
+        group_type this_group(1, agent<grainsize,Index>(static_cast<size_type>(i)), 0);
+
+        // each agent gets a copy of the closure, as each CUDA thread does
+        closure_type c = self->c;
+
+        super_t::substitute_placeholders_and_execute(this_group, c);
+      } // end for i
+    } // end run_agents()
+}; // end host_launcher
+
+
+// a single concurrent group runs on the calling thread
+template<std::size_t blocksize, std::size_t grainsize, typename Closure>
+class host_launcher<concurrent_group<agent<grainsize>,blocksize>,Closure>
+  : public task_base<concurrent_group<agent<grainsize>,blocksize>,Closure>
+{
+  private:
+    typedef task_base<concurrent_group<agent<grainsize>,blocksize>,Closure> super_t;
+
+  public:
+    typedef typename super_t::group_type    block_type;
+    typedef typename block_type::agent_type thread_type;
+    typedef typename super_t::closure_type  closure_type;
+    typedef typename block_type::size_type  size_type;
+
+    host_launcher(block_type b, closure_type c)
+      : super_t(b,c),
+        m_block_size(choose_host_group_size<size_type>(blocksize, b.size()))
+    {}
+
+    void launch()
+    {
+      run_host_group(m_block_size, &host_launcher::run_agent, this);
+    } // end launch()
+
+  private:
+    static void run_agent(void *context, int i)
+    {
+      host_launcher *self = static_cast<host_launcher*>(context);
+
+      block_type this_block = make_block<block_type>(self->m_block_size, self->g.heap_size(), thread_type(i), 0);
+
+      closure_type c = self->c;
+
+      super_t::substitute_placeholders_and_execute(this_block, c);
+    } // end run_agent()
+
+    size_type m_block_size;
+}; // end host_launcher
+
+
+// the concurrent groups of a grid are a loop over the pool, one group at a time
+template<std::size_t gridsize, std::size_t blocksize, std::size_t grainsize, typename Closure>
+class host_launcher<
+  parallel_group<
+    concurrent_group<
+      agent<grainsize>,
+      blocksize
+    >,
+    gridsize
+  >,
+  Closure
+>
+  : public task_base<typename cuda_grid<gridsize,blocksize,grainsize>::type,Closure>
+{
+  private:
+    typedef task_base<typename cuda_grid<gridsize,blocksize,grainsize>::type,Closure> super_t;
+
+  public:
+    typedef typename super_t::group_type    grid_type;
+    typedef typename grid_type::agent_type  block_type;
+    typedef typename block_type::agent_type thread_type;
+    typedef typename super_t::closure_type  closure_type;
+    typedef typename grid_type::size_type   size_type;
+
+    host_launcher(grid_type g, closure_type c)
+      : super_t(g,c),
+        m_num_blocks(g.size() == use_default ? static_cast<size_type>(default_host_thread_pool().size()) : g.size()),
+        m_block_size(choose_host_group_size<size_type>(blocksize, g.this_exec.size()))
+    {}
+
+    void launch()
+    {
+      default_host_thread_pool().parallel_for(m_num_blocks, 1, &host_launcher::run_blocks, this);
+    } // end launch()
+
+  private:
+    struct block_context
+    {
+      host_launcher *self;
+      size_type      block_index;
+    };
+
+    static void run_blocks(void *context, std::size_t first, std::size_t last)
+    {
+      for(std::size_t b = first; b < last; ++b)
+      {
+        block_context ctx = {static_cast<host_launcher*>(context), static_cast<size_type>(b)};
+
+        run_host_group(ctx.self->m_block_size, &host_launcher::run_agent, &ctx);
+      } // end for b
+    } // end run_blocks()
+
+    static void run_agent(void *context, int i)
+    {
+      block_context *ctx = static_cast<block_context*>(context);
+      host_launcher *self = ctx->self;
+
+      grid_type this_grid =
+        make_grid<grid_type>(
+          self->m_num_blocks,
+          make_block<block_type>(
+            self->m_block_size,
+            self->g.this_exec.heap_size(),
+            thread_type(i),
+            ctx->block_index
+          ),
+          0
+      );
+
+      closure_type c = self->c;
+
+      super_t::substitute_placeholders_and_execute(this_grid, c);
+    } // end run_agent()
+
+    size_type m_num_blocks;
+    size_type m_block_size;
+}; // end host_launcher
+
+
+} // end detail
+} // end bulk
+BULK_NAMESPACE_SUFFIX
@@ -0,0 +1,457 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/detail/host_mutex.hpp>
+#include <deque>
+#include <vector>
+#include <cstddef>
+#include <cstdlib>
+
+#if __cplusplus >= 201103L
+#  include <thread>
+#  include <mutex>
+#  include <condition_variable>
+#  define __BULK_HOST_THREADS_STD__ 1
+#elif !defined(_WIN32)
+#  include <pthread.h>
+#  include <sched.h>
+#  include <unistd.h>
+#  define __BULK_HOST_THREADS_PTHREAD__ 1
+#endif
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+namespace detail
+{
+
+
+// a mutex & condition variable pair
+class host_monitor
+{
+  public:
+    host_monitor()
+    {
+#if __BULK_HOST_THREADS_PTHREAD__
+      pthread_mutex_init(&m_mutex, 0);
+      pthread_cond_init(&m_condition, 0);
+#endif
+    }
+
+    ~host_monitor()
+    {
+#if __BULK_HOST_THREADS_PTHREAD__
+      pthread_cond_destroy(&m_condition);
+      pthread_mutex_destroy(&m_mutex);
+#endif
+    }
+
+    void lock()
+    {
+#if __BULK_HOST_THREADS_STD__
+      m_mutex.lock();
+#elif __BULK_HOST_THREADS_PTHREAD__
+      pthread_mutex_lock(&m_mutex);
+#endif
+    }
+
+    void unlock()
+    {
+#if __BULK_HOST_THREADS_STD__
+      m_mutex.unlock();
+#elif __BULK_HOST_THREADS_PTHREAD__
+      pthread_mutex_unlock(&m_mutex);
+#endif
+    }
+
+    // the caller must hold the lock
+    void wait()
+    {
+#if __BULK_HOST_THREADS_STD__
+      std::unique_lock<std::mutex> guard(m_mutex, std::adopt_lock);
+      m_condition.wait(guard);
+      guard.release();
+#elif __BULK_HOST_THREADS_PTHREAD__
+      pthread_cond_wait(&m_condition, &m_mutex);
+#endif
+    }
+
+    void notify_all()
+    {
+#if __BULK_HOST_THREADS_STD__
+      m_condition.notify_all();
+#elif __BULK_HOST_THREADS_PTHREAD__
+      pthread_cond_broadcast(&m_condition);
+#endif
+    }
+
+  private:
+    // noncopyable
+    host_monitor(const host_monitor &);
+    host_monitor &operator=(const host_monitor &);
+
+#if __BULK_HOST_THREADS_STD__
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+#elif __BULK_HOST_THREADS_PTHREAD__
+    pthread_mutex_t m_mutex;
+    pthread_cond_t m_condition;
+#endif
+}; // end host_monitor
+
+
+// host_thread_pool executes loops over index ranges on a fixed set of threads, which steal work from each other
+// each participant splits the ranges it takes in half until they are no larger than the loop's grain,
+// keeping the halves in a deque of its own; a participant whose deque is empty steals the largest range from another's
+// it is only meant to be used from __host__ code
+// XXX without C++11 or pthreads, there are no threads and loops run on the calling thread
+class host_thread_pool
+{
+  public:
+    typedef void (*range_function)(void *context, std::size_t first, std::size_t last);
+
+    // the number of threads may be set with the environment variable BULK_HOST_THREADS
+    explicit host_thread_pool(std::size_t num_threads = default_num_threads())
+      : m_function(0),
+        m_context(0),
+        m_grain(1),
+        m_num_remaining(0),
+        m_generation(0),
+        m_stop(false)
+    {
+      num_threads = num_threads > 0 ? num_threads : 1;
+
+      // the thread which calls parallel_for participates too
+      for(std::size_t i = 0; i < num_threads; ++i)
+      {
+        m_queues.push_back(new work_queue);
+      } // end for i
+
+#if __BULK_HOST_THREADS_STD__ || __BULK_HOST_THREADS_PTHREAD__
+      for(std::size_t i = 1; i < num_threads; ++i)
+      {
+        m_workers.push_back(new worker(this, i));
+
+#if __BULK_HOST_THREADS_STD__
+        m_workers.back()->thread = std::thread(&host_thread_pool::worker_main, m_workers.back());
+#else
+        pthread_create(&m_workers.back()->thread, 0, &host_thread_pool::worker_main, m_workers.back());
+#endif
+      } // end for i
+#endif
+    }
+
+    ~host_thread_pool()
+    {
+      m_monitor.lock();
+      m_stop = true;
+      m_monitor.notify_all();
+      m_monitor.unlock();
+
+      for(std::size_t i = 0; i < m_workers.size(); ++i)
+      {
+#if __BULK_HOST_THREADS_STD__
+        m_workers[i]->thread.join();
+#elif __BULK_HOST_THREADS_PTHREAD__
+        pthread_join(m_workers[i]->thread, 0);
+#endif
+        delete m_workers[i];
+      } // end for i
+
+      for(std::size_t i = 0; i < m_queues.size(); ++i)
+      {
+        delete m_queues[i];
+      } // end for i
+    }
+
+    // the number of threads which participate in a loop, including the caller
+    std::size_t size() const
+    {
+      return m_queues.size();
+    }
+
+    // invokes f(context, first, last) on disjoint ranges which cover [0, n) and returns once each invocation has returned
+    // a loop begun on a thread which is already participating in one runs sequentially on that thread
+    void parallel_for(std::size_t n, std::size_t grain, range_function f, void *context)
+    {
+      if(n == 0) return;
+
+      if(m_queues.size() == 1 || is_participating())
+      {
+        f(context, 0, n);
+        return;
+      } // end if
+
+      // one loop at a time
+      host_lock_guard guard(m_launch_mutex);
+
+      m_function = f;
+      m_context  = context;
+      m_grain    = grain > 0 ? grain : 1;
+
+      {
+        host_lock_guard count_guard(m_count_mutex);
+        m_num_remaining = n;
+      }
+
+      // deal a share of the loop to each participant to begin with
+      std::size_t num_shares = m_queues.size();
+      for(std::size_t i = 0; i < num_shares; ++i)
+      {
+        range r;
+        r.first = (n * i) / num_shares;
+        r.last  = (n * (i + 1)) / num_shares;
+
+        if(r.first < r.last)
+        {
+          push(i, r);
+        } // end if
+      } // end for i
+
+      m_monitor.lock();
+      ++m_generation;
+      m_monitor.notify_all();
+      m_monitor.unlock();
+
+      is_participating() = true;
+      participate(0);
+      is_participating() = false;
+    } // end parallel_for()
+
+  private:
+    // noncopyable
+    host_thread_pool(const host_thread_pool &);
+    host_thread_pool &operator=(const host_thread_pool &);
+
+    struct range
+    {
+      std::size_t first, last;
+    };
+
+    struct work_queue
+    {
+      host_mutex        mutex;
+      std::deque<range> ranges;
+    };
+
+    struct worker
+    {
+      worker(host_thread_pool *p, std::size_t i)
+        : pool(p), index(i)
+      {}
+
+      host_thread_pool *pool;
+      std::size_t       index;
+
+#if __BULK_HOST_THREADS_STD__
+      std::thread       thread;
+#elif __BULK_HOST_THREADS_PTHREAD__
+      pthread_t         thread;
+#endif
+    };
+
+    static std::size_t default_num_threads()
+    {
+      const char *env = std::getenv("BULK_HOST_THREADS");
+
+      if(env && std::atoi(env) > 0)
+      {
+        return std::atoi(env);
+      } // end if
+
+#if __BULK_HOST_THREADS_STD__
+      return std::thread::hardware_concurrency();
+#elif __BULK_HOST_THREADS_PTHREAD__
+      long result = sysconf(_SC_NPROCESSORS_ONLN);
+      return result > 0 ? result : 1;
+#else
+      return 1;
+#endif
+    } // end default_num_threads()
+
+    static bool &is_participating()
+    {
+      static __BULK_THREAD_LOCAL__ bool result = false;
+      return result;
+    } // end is_participating()
+
+#if __BULK_HOST_THREADS_STD__
+    static void worker_main(worker *w)
+    {
+      w->pool->worker_loop(w->index);
+    } // end worker_main()
+#elif __BULK_HOST_THREADS_PTHREAD__
+    static void *worker_main(void *arg)
+    {
+      worker *w = static_cast<worker*>(arg);
+      w->pool->worker_loop(w->index);
+      return 0;
+    } // end worker_main()
+#endif
+
+    void worker_loop(std::size_t self)
+    {
+      is_participating() = true;
+
+      std::size_t generation = 0;
+
+      while(true)
+      {
+        m_monitor.lock();
+
+        while(!m_stop && m_generation == generation)
+        {
+          m_monitor.wait();
+        } // end while
+
+        bool stop = m_stop;
+        generation = m_generation;
+
+        m_monitor.unlock();
+
+        if(stop) break;
+
+        participate(self);
+      } // end while
+    } // end worker_loop()
+
+    void participate(std::size_t self)
+    {
+      while(num_remaining() > 0)
+      {
+        range r;
+
+        if(pop(self, r) || steal(self, r))
+        {
+          execute(self, r);
+        } // end if
+        else
+        {
+          yield();
+        } // end else
+      } // end while
+    } // end participate()
+
+    void execute(std::size_t self, range r)
+    {
+      // keep the upper halves for ourself or thieves, and run the lowest piece
+      while(r.last - r.first > m_grain)
+      {
+        range upper;
+        upper.first = r.first + (r.last - r.first) / 2;
+        upper.last  = r.last;
+
+        push(self, upper);
+
+        r.last = upper.first;
+      } // end while
+
+      m_function(m_context, r.first, r.last);
+
+      host_lock_guard guard(m_count_mutex);
+      m_num_remaining -= r.last - r.first;
+    } // end execute()
+
+    void push(std::size_t i, range r)
+    {
+      host_lock_guard guard(m_queues[i]->mutex);
+      m_queues[i]->ranges.push_back(r);
+    } // end push()
+
+    // the owner takes the smallest, most recently split range
+    bool pop(std::size_t i, range &r)
+    {
+      host_lock_guard guard(m_queues[i]->mutex);
+
+      if(m_queues[i]->ranges.empty()) return false;
+
+      r = m_queues[i]->ranges.back();
+      m_queues[i]->ranges.pop_back();
+
+      return true;
+    } // end pop()
+
+    // thieves take the largest range
+    bool steal(std::size_t self, range &r)
+    {
+      for(std::size_t offset = 1; offset < m_queues.size(); ++offset)
+      {
+        std::size_t victim = (self + offset) % m_queues.size();
+
+        host_lock_guard guard(m_queues[victim]->mutex);
+
+        if(!m_queues[victim]->ranges.empty())
+        {
+          r = m_queues[victim]->ranges.front();
+          m_queues[victim]->ranges.pop_front();
+
+          return true;
+        } // end if
+      } // end for offset
+
+      return false;
+    } // end steal()
+
+    std::size_t num_remaining()
+    {
+      host_lock_guard guard(m_count_mutex);
+      return m_num_remaining;
+    } // end num_remaining()
+
+    static void yield()
+    {
+#if __BULK_HOST_THREADS_STD__
+      std::this_thread::yield();
+#elif __BULK_HOST_THREADS_PTHREAD__
+      sched_yield();
+#endif
+    } // end yield()
+
+    std::vector<work_queue*> m_queues;
+    std::vector<worker*>     m_workers;
+
+    host_mutex               m_launch_mutex;
+
+    range_function           m_function;
+    void                    *m_context;
+    std::size_t              m_grain;
+
+    host_mutex               m_count_mutex;
+    std::size_t              m_num_remaining;
+
+    host_monitor             m_monitor;
+    std::size_t              m_generation;
+    bool                     m_stop;
+}; // end host_thread_pool
+
+
+// the pool which the host backend of bulk::async runs on
+// XXX see the note on host singletons in bulk/detail/config.hpp
+inline host_thread_pool &default_host_thread_pool()
+{
+  static host_thread_pool pool;
+  return pool;
+} // end default_host_thread_pool()
+
+
+} // end detail
+} // end bulk
+BULK_NAMESPACE_SUFFIX
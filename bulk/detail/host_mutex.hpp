@@ -0,0 +1,114 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+
+#if __cplusplus >= 201103L
+#  include <mutex>
+#  define __BULK_HOST_MUTEX_STD__ 1
+#elif !defined(_WIN32)
+#  include <pthread.h>
+#  define __BULK_HOST_MUTEX_PTHREAD__ 1
+#endif
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+namespace detail
+{
+
+
+// host_mutex protects Bulk's host-side caches and pools
+// it is only meant to be used from __host__ code
+class host_mutex
+{
+  public:
+    host_mutex()
+    {
+#if __BULK_HOST_MUTEX_PTHREAD__
+      pthread_mutex_init(&m_mutex, 0);
+#endif
+    }
+
+    ~host_mutex()
+    {
+#if __BULK_HOST_MUTEX_PTHREAD__
+      pthread_mutex_destroy(&m_mutex);
+#endif
+    }
+
+    void lock()
+    {
+#if __BULK_HOST_MUTEX_STD__
+      m_mutex.lock();
+#elif __BULK_HOST_MUTEX_PTHREAD__
+      pthread_mutex_lock(&m_mutex);
+#endif
+      // XXX without C++11 or pthreads, there's no locking at all
+    }
+
+    void unlock()
+    {
+#if __BULK_HOST_MUTEX_STD__
+      m_mutex.unlock();
+#elif __BULK_HOST_MUTEX_PTHREAD__
+      pthread_mutex_unlock(&m_mutex);
+#endif
+    }
+
+  private:
+    // noncopyable
+    host_mutex(const host_mutex &);
+    host_mutex &operator=(const host_mutex &);
+
+#if __BULK_HOST_MUTEX_STD__
+    std::mutex m_mutex;
+#elif __BULK_HOST_MUTEX_PTHREAD__
+    pthread_mutex_t m_mutex;
+#endif
+}; // end host_mutex
+
+
+class host_lock_guard
+{
+  public:
+    explicit host_lock_guard(host_mutex &mutex)
+      : m_mutex(mutex)
+    {
+      m_mutex.lock();
+    }
+
+    ~host_lock_guard()
+    {
+      m_mutex.unlock();
+    }
+
+  private:
+    // noncopyable
+    host_lock_guard(const host_lock_guard &);
+    host_lock_guard &operator=(const host_lock_guard &);
+
+    host_mutex &m_mutex;
+}; // end host_lock_guard
+
+
+} // end detail
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
@@ -0,0 +1,244 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/detail/guarded_cuda_runtime_api.hpp>
+#include <bulk/detail/throw_on_error.hpp>
+#include <bulk/detail/host_mutex.hpp>
+#include <bulk/detail/event_pool.hpp>
+#include <bulk/detail/stream_capture.hpp>
+#include <vector>
+#include <cstddef>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+
+
+// describes a single kernel launch made by bulk::async
+struct launch_record
+{
+  // the name of the launched function's type, as reported by typeid
+  // XXX this is mangled with some compilers
+  const char   *kernel_name;
+
+  int           device;
+  cudaStream_t  stream;
+
+  std::size_t   num_groups;
+  std::size_t   group_size;
+  std::size_t   heap_size;
+
+  // the number of the launch's groups which may be resident on a multiprocessor at once,
+  // and the fraction of the multiprocessor's threads they occupy
+  std::size_t   max_active_groups_per_multiprocessor;
+  float         occupancy;
+
+  // the launch's elapsed time on the GPU, or a negative number if it couldn't be measured
+  float         elapsed_milliseconds;
+}; // end launch_record
+
+
+namespace detail
+{
+
+
+struct pending_launch_record
+{
+  launch_record record;
+  cudaEvent_t   start;
+  cudaEvent_t   stop;
+}; // end pending_launch_record
+
+
+// the records of launches whose completion hasn't yet been observed, oldest first,
+// in a ring of fixed capacity: when it is full, the oldest record is dropped
+struct launch_telemetry_state
+{
+  static const std::size_t default_capacity = 4096;
+
+  launch_telemetry_state()
+    : enabled(false), first(0), size(0), num_dropped(0)
+  {}
+
+  host_mutex                         mutex;
+  bool                               enabled;
+  std::vector<pending_launch_record> ring;
+  std::size_t                        first;
+  std::size_t                        size;
+  std::size_t                        num_dropped;
+}; // end launch_telemetry_state
+
+
+// XXX see the note on host singletons in bulk/detail/config.hpp
+inline launch_telemetry_state &launch_telemetry_global_state()
+{
+  static launch_telemetry_state state;
+  return state;
+} // end launch_telemetry_global_state()
+
+
+inline void release_launch_events(pending_launch_record &r)
+{
+  bulk::detail::default_timing_event_pool().release(r.record.device, r.start);
+  bulk::detail::default_timing_event_pool().release(r.record.device, r.stop);
+} // end release_launch_events()
+
+
+// if telemetry is enabled, records the start of a launch into s and returns its event,
+// otherwise returns 0
+// launches captured into graphs aren't recorded
+inline cudaEvent_t begin_launch_telemetry(int device, cudaStream_t s)
+{
+  launch_telemetry_state &state = launch_telemetry_global_state();
+
+  {
+    host_lock_guard guard(state.mutex);
+
+    if(!state.enabled || state.ring.empty()) return 0;
+  } // end guard
+
+  if(bulk::detail::is_capturing()) return 0;
+
+  cudaEvent_t start = bulk::detail::default_timing_event_pool().acquire(device);
+
+  bulk::detail::throw_on_error(cudaEventRecord(start, s), "begin_launch_telemetry(): after cudaEventRecord");
+
+  return start;
+} // end begin_launch_telemetry()
+
+
+// returns the event begun at start to the pool when its launch fails
+inline void abandon_launch_telemetry(int device, cudaEvent_t start)
+{
+  if(start)
+  {
+    bulk::detail::default_timing_event_pool().release(device, start);
+  } // end if
+} // end abandon_launch_telemetry()
+
+
+// records the end of the launch begun at start into s, and appends its record to the ring
+inline void end_launch_telemetry(cudaEvent_t start, const launch_record &record, cudaStream_t s)
+{
+  cudaEvent_t stop = bulk::detail::default_timing_event_pool().acquire(record.device);
+
+  cudaError_t error = cudaEventRecord(stop, s);
+
+  if(error)
+  {
+    bulk::detail::default_timing_event_pool().release(record.device, stop);
+    bulk::detail::abandon_launch_telemetry(record.device, start);
+  } // end if
+
+  bulk::detail::throw_on_error(error, "end_launch_telemetry(): after cudaEventRecord");
+
+  pending_launch_record pending;
+  pending.record = record;
+  pending.start  = start;
+  pending.stop   = stop;
+
+  launch_telemetry_state &state = launch_telemetry_global_state();
+  host_lock_guard guard(state.mutex);
+
+  // the ring may have been resized since the launch began
+  if(state.ring.empty())
+  {
+    release_launch_events(pending);
+    return;
+  } // end if
+
+  if(state.size == state.ring.size())
+  {
+    release_launch_events(state.ring[state.first]);
+
+    state.first = (state.first + 1) % state.ring.size();
+    --state.size;
+    ++state.num_dropped;
+  } // end if
+
+  state.ring[(state.first + state.size) % state.ring.size()] = pending;
+  ++state.size;
+} // end end_launch_telemetry()
+
+
+// appends the records of the oldest launches which have completed to result, in launch order,
+// without waiting for the rest
+inline std::size_t drain_launch_telemetry(std::vector<launch_record> &result)
+{
+  launch_telemetry_state &state = launch_telemetry_global_state();
+  host_lock_guard guard(state.mutex);
+
+  std::size_t num_drained = 0;
+
+  while(state.size > 0)
+  {
+    pending_launch_record &r = state.ring[state.first];
+
+    cudaError_t error = cudaEventQuery(r.stop);
+
+    if(error == cudaErrorNotReady) break;
+
+    r.record.elapsed_milliseconds = -1;
+
+    if(error == cudaSuccess)
+    {
+      float msecs = 0;
+
+      if(cudaEventElapsedTime(&msecs, r.start, r.stop) == cudaSuccess)
+      {
+        r.record.elapsed_milliseconds = msecs;
+      } // end if
+    } // end if
+
+    result.push_back(r.record);
+    release_launch_events(r);
+
+    state.first = (state.first + 1) % state.ring.size();
+    --state.size;
+    ++num_drained;
+  } // end while
+
+  // clear any error left behind by the queries
+  cudaGetLastError();
+
+  return num_drained;
+} // end drain_launch_telemetry()
+
+
+// drops every pending record and reserves room for capacity of them
+inline void reset_launch_telemetry(launch_telemetry_state &state, std::size_t capacity)
+{
+  for(std::size_t i = 0; i < state.size; ++i)
+  {
+    release_launch_events(state.ring[(state.first + i) % state.ring.size()]);
+  } // end for i
+
+  state.num_dropped += state.size;
+
+  state.ring.assign(capacity, pending_launch_record());
+  state.first = 0;
+  state.size  = 0;
+} // end reset_launch_telemetry()
+
+
+} // end detail
+} // end bulk
+BULK_NAMESPACE_SUFFIX
@@ -0,0 +1,187 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/detail/guarded_cuda_runtime_api.hpp>
+#include <bulk/execution_policy.hpp>
+#include <cstddef>
+#include <typeinfo>
+
+
+// NVTX v3 is header-only and ships with CUDA 10.0 and newer
+// #define BULK_DISABLE_NVTX to compile the ranges away
+#if !defined(BULK_DISABLE_NVTX) && defined(CUDART_VERSION) && (CUDART_VERSION >= 10000)
+#  define __BULK_HAS_NVTX__ 1
+#  include <nvtx3/nvToolsExt.h>
+#else
+#  define __BULK_HAS_NVTX__ 0
+#endif
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+namespace detail
+{
+namespace nvtx_detail
+{
+
+
+// appends str to the n bytes at buffer, keeping them terminated, and returns the number of bytes which remain
+inline std::size_t append(char *&buffer, std::size_t n, const char *str)
+{
+  for(; n > 1 && *str; --n, ++buffer, ++str)
+  {
+    *buffer = *str;
+  } // end for
+
+  if(n > 0) *buffer = 0;
+
+  return n;
+} // end append()
+
+
+inline std::size_t append_size(char *&buffer, std::size_t n, std::size_t size)
+{
+  if(size == bulk::use_default)
+  {
+    return append(buffer, n, "default");
+  } // end if
+
+  // the digits are generated in reverse
+  char digits[32];
+  char *last = digits + sizeof(digits) - 1;
+  *last = 0;
+
+  char *first = last;
+  do
+  {
+    *--first = '0' + (size % 10);
+    size /= 10;
+  }
+  while(size > 0);
+
+  return append(buffer, n, first);
+} // end append_size()
+
+
+// describes the shape of an execution group, e.g. par(con(agent(5),128,default),120)
+template<std::size_t grainsize, typename Index>
+std::size_t describe(char *&buffer, std::size_t n, const bulk::agent<grainsize,Index> &a)
+{
+  if(a.grainsize() == 1) return append(buffer, n, "agent");
+
+  n = append(buffer, n, "agent(");
+  n = append_size(buffer, n, a.grainsize());
+  return append(buffer, n, ")");
+} // end describe()
+
+
+template<typename ExecutionAgent, std::size_t size>
+std::size_t describe(char *&buffer, std::size_t n, const bulk::concurrent_group<ExecutionAgent,size> &g)
+{
+  n = append(buffer, n, "con(");
+  n = describe(buffer, n, g.this_exec);
+  n = append(buffer, n, ",");
+  n = append_size(buffer, n, g.size());
+  n = append(buffer, n, ",");
+  n = append_size(buffer, n, g.heap_size());
+  return append(buffer, n, ")");
+} // end describe()
+
+
+template<typename ExecutionAgent>
+std::size_t describe(char *&buffer, std::size_t n, const bulk::cluster<ExecutionAgent> &c)
+{
+  n = append(buffer, n, "cluster(");
+  n = describe(buffer, n, c.this_exec);
+  n = append(buffer, n, ",");
+  n = append_size(buffer, n, c.size());
+  return append(buffer, n, ")");
+} // end describe()
+
+
+// the outermost level comes last, so that it sees the overloads for the levels within
+template<typename ExecutionAgent, std::size_t size>
+std::size_t describe(char *&buffer, std::size_t n, const bulk::parallel_group<ExecutionAgent,size> &g)
+{
+  n = append(buffer, n, "par(");
+  n = describe(buffer, n, g.this_exec);
+  n = append(buffer, n, ",");
+  n = append_size(buffer, n, g.size());
+  return append(buffer, n, ")");
+} // end describe()
+
+
+} // end nvtx_detail
+
+
+// nvtx_range marks the lifetime of a bulk::async call on the profiler's timeline
+// ranges only appear when NVTX is available, and then cost little unless a profiler is attached
+class nvtx_range
+{
+  public:
+    // the range's message is the launched function's type and the group's shape,
+    // e.g. saxpy_functor <<<par(con(agent,256,default),120)>>>
+    template<typename Closure, typename ExecutionGroup>
+    __host__ __device__
+    nvtx_range(const Closure &, const ExecutionGroup &g)
+    {
+#if __BULK_HAS_NVTX__ && !defined(__CUDA_ARCH__)
+      char message[max_message_size];
+      char *buffer = message;
+      std::size_t n = sizeof(message);
+
+      n = nvtx_detail::append(buffer, n, typeid(typename Closure::function_type).name());
+      n = nvtx_detail::append(buffer, n, " <<<");
+      n = nvtx_detail::describe(buffer, n, g);
+      n = nvtx_detail::append(buffer, n, ">>>");
+
+      nvtxRangePushA(message);
+#endif
+    } // end nvtx_range()
+
+    __host__ __device__
+    explicit nvtx_range(const char *label)
+    {
+#if __BULK_HAS_NVTX__ && !defined(__CUDA_ARCH__)
+      nvtxRangePushA(label);
+#endif
+    } // end nvtx_range()
+
+    __host__ __device__
+    ~nvtx_range()
+    {
+#if __BULK_HAS_NVTX__ && !defined(__CUDA_ARCH__)
+      nvtxRangePop();
+#endif
+    } // end ~nvtx_range()
+
+  private:
+    static const std::size_t max_message_size = 256;
+
+    // noncopyable
+    nvtx_range(const nvtx_range &);
+    nvtx_range &operator=(const nvtx_range &);
+}; // end nvtx_range
+
+
+} // end detail
+} // end bulk
+BULK_NAMESPACE_SUFFIX
@@ -0,0 +1,100 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/detail/guarded_cuda_runtime_api.hpp>
+#include <bulk/detail/resource_pool.hpp>
+#include <bulk/detail/throw_on_error.hpp>
+#include <cstddef>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+namespace detail
+{
+
+
+// fixed-size slots of page-locked host memory
+struct pinned_slot_traits
+{
+  typedef void* resource_type;
+
+  static const std::size_t slot_size = 256;
+
+  static cudaError_t create(void **ptr)
+  {
+    return cudaHostAlloc(ptr, slot_size, cudaHostAllocPortable);
+  }
+
+  static cudaError_t destroy(void *ptr)
+  {
+    return cudaFreeHost(ptr);
+  }
+
+  static bool is_idle(void *)
+  {
+    return true;
+  }
+}; // end pinned_slot_traits
+
+
+typedef device_resource_pool<pinned_slot_traits> pinned_slot_pool;
+
+
+// XXX see the note on host singletons in bulk/detail/config.hpp
+inline pinned_slot_pool &default_pinned_slot_pool()
+{
+  static pinned_slot_pool pool(256);
+  return pool;
+} // end default_pinned_slot_pool()
+
+
+// portable pinned memory isn't associated with any particular device,
+// so all slots live in the pool's first list
+inline void *allocate_pinned(std::size_t num_bytes)
+{
+  if(num_bytes <= pinned_slot_traits::slot_size)
+  {
+    return default_pinned_slot_pool().acquire(0);
+  } // end if
+
+  void *result = 0;
+  bulk::detail::throw_on_error(cudaHostAlloc(&result, num_bytes, cudaHostAllocPortable), "allocate_pinned(): after cudaHostAlloc");
+  return result;
+} // end allocate_pinned()
+
+
+inline void deallocate_pinned(void *ptr, std::size_t num_bytes)
+{
+  if(num_bytes <= pinned_slot_traits::slot_size)
+  {
+    default_pinned_slot_pool().release(0, ptr);
+  } // end if
+  else
+  {
+    // swallow errors
+    cudaFreeHost(ptr);
+  } // end else
+} // end deallocate_pinned()
+
+
+} // end detail
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
@@ -0,0 +1,256 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/detail/guarded_cuda_runtime_api.hpp>
+#include <bulk/detail/throw_on_error.hpp>
+#include <bulk/detail/host_mutex.hpp>
+#include <vector>
+#include <cstddef>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+namespace detail
+{
+
+
+// device_resource_pool recycles CUDA objects such as streams so that
+// they need not be created & destroyed on every launch
+// each device has its own list of idle resources
+//
+// ResourceTraits requirements:
+//
+//   typename ResourceTraits::resource_type;
+//   cudaError_t ResourceTraits::create(resource_type *r);  // creates r on the current device
+//   cudaError_t ResourceTraits::destroy(resource_type r);
+//   bool        ResourceTraits::is_idle(resource_type r);   // true if r has no pending work
+//
+// the pool calls these through its copy of the traits, so they may depend on its state,
+// e.g. the priority of the streams the pool creates
+//
+// device_resource_pool is only usable from __host__ code
+template<typename ResourceTraits>
+class device_resource_pool
+{
+  public:
+    typedef typename ResourceTraits::resource_type resource_type;
+
+    // only pool resources for the first few devices
+    static const int max_num_devices = 16;
+
+    static const std::size_t default_max_idle = 32;
+
+    explicit device_resource_pool(std::size_t max_idle = default_max_idle, ResourceTraits traits = ResourceTraits())
+      : m_traits(traits),
+        m_max_idle(max_idle)
+    {
+      for(int i = 0; i < max_num_devices; ++i)
+      {
+        m_num_in_use[i] = 0;
+      } // end for
+    } // end device_resource_pool()
+
+    ~device_resource_pool()
+    {
+      // swallow errors -- the runtime may already be shutting down
+      for(int i = 0; i < max_num_devices; ++i)
+      {
+        for(std::size_t j = 0; j < m_idle[i].size(); ++j)
+        {
+          m_traits.destroy(m_idle[i][j]);
+        } // end for
+      } // end for
+    } // end ~device_resource_pool()
+
+    const ResourceTraits &traits() const
+    {
+      return m_traits;
+    } // end traits()
+
+    // the traits may only change while the pool is empty
+    void set_traits(const ResourceTraits &traits)
+    {
+      m_traits = traits;
+    } // end set_traits()
+
+    // returns a resource which belongs to device, which must be the current device
+    resource_type acquire(int device)
+    {
+      if(device < 0 || device >= max_num_devices)
+      {
+        return create();
+      } // end if
+
+      {
+        host_lock_guard guard(m_mutex);
+
+        std::vector<resource_type> &idle = m_idle[device];
+
+        // prefer the most recently released resource whose work has drained
+        // a resource with pending work is never handed out, lest unrelated work serialize behind it
+        for(std::size_t j = idle.size(); j > 0; --j)
+        {
+          if(m_traits.is_idle(idle[j-1]))
+          {
+            resource_type result = idle[j-1];
+            idle[j-1] = idle.back();
+            idle.pop_back();
+
+            ++m_num_in_use[device];
+
+            return result;
+          } // end if
+        } // end for
+      } // end guard
+
+      // nothing has drained, so create a new resource outside of the lock
+      // the pool's growth is bounded by release(), which destroys resources beyond max_idle()
+      resource_type result = create();
+
+      host_lock_guard guard(m_mutex);
+      ++m_num_in_use[device];
+
+      return result;
+    } // end acquire()
+
+    // returns a resource previously acquired for device to the pool
+    // the resource may still have pending work
+    void release(int device, resource_type r)
+    {
+      if(device >= 0 && device < max_num_devices)
+      {
+        host_lock_guard guard(m_mutex);
+
+        if(m_num_in_use[device] > 0) --m_num_in_use[device];
+
+        if(m_idle[device].size() < m_max_idle)
+        {
+          m_idle[device].push_back(r);
+          return;
+        } // end if
+      } // end if
+
+      // the pool is full, so destroy r
+      // swallow errors
+      m_traits.destroy(r);
+    } // end release()
+
+    // ensures that at least n idle resources exist for device
+    void reserve(int device, std::size_t n)
+    {
+      if(device < 0 || device >= max_num_devices) return;
+
+      int old_device = -1;
+      bulk::detail::throw_on_error(cudaGetDevice(&old_device), "device_resource_pool::reserve(): after cudaGetDevice");
+
+      if(old_device != device)
+      {
+        bulk::detail::throw_on_error(cudaSetDevice(device), "device_resource_pool::reserve(): after cudaSetDevice");
+      } // end if
+
+      host_lock_guard guard(m_mutex);
+
+      if(m_max_idle < n) m_max_idle = n;
+
+      cudaError_t error = cudaSuccess;
+      while(m_idle[device].size() < n && error == cudaSuccess)
+      {
+        resource_type r;
+        error = m_traits.create(&r);
+
+        if(error == cudaSuccess) m_idle[device].push_back(r);
+      } // end while
+
+      if(old_device != device)
+      {
+        cudaSetDevice(old_device);
+      } // end if
+
+      bulk::detail::throw_on_error(error, "device_resource_pool::reserve(): after create");
+    } // end reserve()
+
+    // destroys all of device's idle resources
+    void clear(int device)
+    {
+      if(device < 0 || device >= max_num_devices) return;
+
+      host_lock_guard guard(m_mutex);
+
+      for(std::size_t j = 0; j < m_idle[device].size(); ++j)
+      {
+        m_traits.destroy(m_idle[device][j]);
+      } // end for
+
+      m_idle[device].clear();
+    } // end clear()
+
+    std::size_t num_idle(int device) const
+    {
+      if(device < 0 || device >= max_num_devices) return 0;
+
+      host_lock_guard guard(m_mutex);
+      return m_idle[device].size();
+    } // end num_idle()
+
+    std::size_t num_in_use(int device) const
+    {
+      if(device < 0 || device >= max_num_devices) return 0;
+
+      host_lock_guard guard(m_mutex);
+      return m_num_in_use[device];
+    } // end num_in_use()
+
+    std::size_t max_idle() const
+    {
+      host_lock_guard guard(m_mutex);
+      return m_max_idle;
+    } // end max_idle()
+
+    // resources released beyond this limit are destroyed rather than recycled
+    void set_max_idle(std::size_t n)
+    {
+      host_lock_guard guard(m_mutex);
+      m_max_idle = n;
+    } // end set_max_idle()
+
+  private:
+    // noncopyable
+    device_resource_pool(const device_resource_pool &);
+    device_resource_pool &operator=(const device_resource_pool &);
+
+    resource_type create()
+    {
+      resource_type result;
+      bulk::detail::throw_on_error(m_traits.create(&result), "device_resource_pool::acquire(): after create");
+      return result;
+    } // end create()
+
+    ResourceTraits             m_traits;
+    mutable host_mutex         m_mutex;
+    std::size_t                m_max_idle;
+    std::vector<resource_type> m_idle[max_num_devices];
+    std::size_t                m_num_in_use[max_num_devices];
+}; // end device_resource_pool
+
+
+} // end detail
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
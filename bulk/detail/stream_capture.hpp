@@ -0,0 +1,140 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/detail/guarded_cuda_runtime_api.hpp>
+#include <bulk/detail/throw_on_error.hpp>
+#include <bulk/detail/terminate.hpp>
+#include <vector>
+
+
+// CUDA graphs arrived in CUDA 10
+#if defined(CUDART_VERSION) && (CUDART_VERSION >= 10000)
+#  define __BULK_HAS_CUDA_GRAPHS__ 1
+#else
+#  define __BULK_HAS_CUDA_GRAPHS__ 0
+#endif
+
+
+// the per-thread default stream arrived in CUDA 7
+// define BULK_LEGACY_DEFAULT_STREAM to launch into the legacy default stream instead
+#if !defined(BULK_LEGACY_DEFAULT_STREAM) && defined(CUDART_VERSION) && (CUDART_VERSION >= 7000)
+#  define __BULK_HAS_PER_THREAD_DEFAULT_STREAM__ 1
+#else
+#  define __BULK_HAS_PER_THREAD_DEFAULT_STREAM__ 0
+#endif
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+namespace detail
+{
+
+
+// while bulk::capture() is recording on this thread, this is the stream being captured
+// otherwise, it is 0
+inline cudaStream_t &this_thread_capture_stream()
+{
+  static __BULK_THREAD_LOCAL__ cudaStream_t s = 0;
+  return s;
+} // end this_thread_capture_stream()
+
+
+// while bulk::capture() is recording on this thread, this collects the device memory
+// which the graph must keep alive, e.g. the parameters of large launches
+// otherwise, it is 0
+inline std::vector<void*> *&this_thread_capture_allocations()
+{
+  static __BULK_THREAD_LOCAL__ std::vector<void*> *allocations = 0;
+  return allocations;
+} // end this_thread_capture_allocations()
+
+
+// allocates device memory which belongs to the graph being captured on this thread
+// bulk::capture records in cudaStreamCaptureModeThreadLocal, which prohibits cudaMalloc in the capturing thread,
+// so the capture mode is relaxed for the duration of the allocation, as in capture_parameter
+inline void *capture_malloc(std::size_t size)
+{
+#if defined(CUDART_VERSION) && (CUDART_VERSION >= 10010)
+  cudaStreamCaptureMode mode = cudaStreamCaptureModeRelaxed;
+  bulk::detail::throw_on_error(cudaThreadExchangeStreamCaptureMode(&mode), "cudaThreadExchangeStreamCaptureMode in capture_malloc");
+
+  void *result = 0;
+  cudaError_t error = cudaMalloc(&result, size);
+
+  cudaThreadExchangeStreamCaptureMode(&mode);
+
+  bulk::detail::throw_on_error(error, "cudaMalloc in capture_malloc");
+
+  this_thread_capture_allocations()->push_back(result);
+
+  return result;
+#else
+  bulk::detail::terminate_with_message("capture_malloc(): allocating while capturing requires CUDA 10.1");
+  return 0;
+#endif
+} // end capture_malloc()
+
+
+// the stream of launches which name neither a stream nor an execution policy
+// on the host, this is the calling thread's default stream, so that launches from independent
+// host threads may run concurrently rather than serialize in the legacy default stream
+__host__ __device__
+inline cudaStream_t default_stream()
+{
+#if !defined(__CUDA_ARCH__) && __BULK_HAS_PER_THREAD_DEFAULT_STREAM__
+  return cudaStreamPerThread;
+#else
+  return 0;
+#endif
+} // end default_stream()
+
+
+// launches into either default stream are redirected into the capture stream while capturing
+__host__ __device__
+inline cudaStream_t capture_aware_stream(cudaStream_t s)
+{
+#ifndef __CUDA_ARCH__
+  if(s == 0 || s == default_stream())
+  {
+    cudaStream_t capture_stream = this_thread_capture_stream();
+
+    return (capture_stream != 0) ? capture_stream : s;
+  } // end if
+#endif
+
+  return s;
+} // end capture_aware_stream()
+
+
+__host__ __device__
+inline bool is_capturing()
+{
+#ifndef __CUDA_ARCH__
+  return this_thread_capture_stream() != 0;
+#else
+  return false;
+#endif
+} // end is_capturing()
+
+
+} // end detail
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
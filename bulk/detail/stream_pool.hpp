@@ -0,0 +1,203 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/detail/guarded_cuda_runtime_api.hpp>
+#include <bulk/detail/resource_pool.hpp>
+#include <bulk/detail/throw_on_error.hpp>
+#include <cstddef>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+namespace detail
+{
+
+
+// streams are created with a priority, where lower numbers are greater priorities
+// and 0 is the least priority, which is also that of cudaStreamCreate's streams
+struct stream_traits
+{
+  typedef cudaStream_t resource_type;
+
+  stream_traits(int priority = 0)
+    : priority(priority)
+  {}
+
+  cudaError_t create(cudaStream_t *s) const
+  {
+    return priority == 0 ? cudaStreamCreate(s) : cudaStreamCreateWithPriority(s, cudaStreamDefault, priority);
+  }
+
+  static cudaError_t destroy(cudaStream_t s)
+  {
+    return cudaStreamDestroy(s);
+  }
+
+  static bool is_idle(cudaStream_t s)
+  {
+    return cudaStreamQuery(s) == cudaSuccess;
+  }
+
+  int priority;
+}; // end stream_traits
+
+
+// stream_pool keeps a device_resource_pool of streams for each stream priority
+// a stream returns to the pool of its own priority, so the pools of greater priorities
+// only ever hold streams which bulk::async acquired at that priority
+//
+// stream_pool is only usable from __host__ code
+class stream_pool
+{
+  private:
+    typedef device_resource_pool<stream_traits> priority_pool;
+
+  public:
+    typedef cudaStream_t resource_type;
+
+    // CUDA devices distinguish at most a handful of priorities, [-5, 0] as of sm_80
+    static const int max_num_priorities = 8;
+
+    stream_pool()
+    {
+      for(int i = 0; i < max_num_priorities; ++i)
+      {
+        m_pools[i].set_traits(stream_traits(-i));
+      } // end for
+    } // end stream_pool()
+
+    // returns a stream of the least priority which belongs to device, which must be the current device
+    resource_type acquire(int device)
+    {
+      return m_pools[0].acquire(device);
+    } // end acquire()
+
+    // returns a stream of the given priority, clamped to the range of the current device
+    resource_type acquire(int device, int priority)
+    {
+      return m_pools[pool_index(clamp_priority(priority))].acquire(device);
+    } // end acquire()
+
+    // returns a stream previously acquired for device to the pool of its priority
+    void release(int device, resource_type s)
+    {
+      int priority = 0;
+
+      // swallow errors; the stream returns to the least priority's pool
+      cudaStreamGetPriority(s, &priority);
+
+      m_pools[pool_index(priority)].release(device, s);
+    } // end release()
+
+    // ensures that at least n idle streams of the least priority exist for device
+    void reserve(int device, std::size_t n)
+    {
+      m_pools[0].reserve(device, n);
+    } // end reserve()
+
+    void clear(int device)
+    {
+      for(int i = 0; i < max_num_priorities; ++i)
+      {
+        m_pools[i].clear(device);
+      } // end for
+    } // end clear()
+
+    std::size_t num_idle(int device) const
+    {
+      std::size_t result = 0;
+
+      for(int i = 0; i < max_num_priorities; ++i)
+      {
+        result += m_pools[i].num_idle(device);
+      } // end for
+
+      return result;
+    } // end num_idle()
+
+    std::size_t num_in_use(int device) const
+    {
+      std::size_t result = 0;
+
+      for(int i = 0; i < max_num_priorities; ++i)
+      {
+        result += m_pools[i].num_in_use(device);
+      } // end for
+
+      return result;
+    } // end num_in_use()
+
+    // the limit applies to each priority's pool
+    std::size_t max_idle() const
+    {
+      return m_pools[0].max_idle();
+    } // end max_idle()
+
+    void set_max_idle(std::size_t n)
+    {
+      for(int i = 0; i < max_num_priorities; ++i)
+      {
+        m_pools[i].set_max_idle(n);
+      } // end for
+    } // end set_max_idle()
+
+  private:
+    // noncopyable
+    stream_pool(const stream_pool &);
+    stream_pool &operator=(const stream_pool &);
+
+    static int clamp_priority(int priority)
+    {
+      int least = 0, greatest = 0;
+      bulk::detail::throw_on_error(cudaDeviceGetStreamPriorityRange(&least, &greatest), "stream_pool::acquire(): after cudaDeviceGetStreamPriorityRange");
+
+      if(priority > least)    return least;
+      if(priority < greatest) return greatest;
+
+      return priority;
+    } // end clamp_priority()
+
+    static int pool_index(int priority)
+    {
+      int result = -priority;
+
+      if(result < 0) return 0;
+      if(result >= max_num_priorities) return max_num_priorities - 1;
+
+      return result;
+    } // end pool_index()
+
+    priority_pool m_pools[max_num_priorities];
+}; // end stream_pool
+
+
+// the pool of streams which bulk::async uses when the user does not provide a stream
+// XXX see the note on host singletons in bulk/detail/config.hpp
+inline stream_pool &default_stream_pool()
+{
+  static stream_pool pool;
+  return pool;
+} // end default_stream_pool()
+
+
+} // end detail
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
@@ -0,0 +1,357 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/detail/alignment.hpp>
+#include <bulk/detail/guarded_cuda_runtime_api.hpp>
+#include <bulk/detail/throw_on_error.hpp>
+#include <bulk/detail/terminate.hpp>
+#include <bulk/detail/stream_capture.hpp>
+#include <bulk/algorithm/detail/warp_collectives.hpp>
+#include <bulk/algorithm/detail/decoupled_look_back.hpp>
+#include <vector>
+#include <cstddef>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+namespace detail
+{
+namespace device_queue_detail
+{
+
+
+// the counters are kept a cache line apart so that producers and consumers don't contend
+const std::size_t counter_stride = 128 / sizeof(unsigned int);
+
+const std::size_t num_counter_words = 3 * counter_stride;
+
+
+// true if ticket a comes before ticket b, accounting for wraparound
+inline __host__ __device__ bool precedes(unsigned int a, unsigned int b)
+{
+  return static_cast<int>(b - a) > 0;
+} // end precedes()
+
+
+inline __device__ void backoff(unsigned int &nanoseconds)
+{
+#if __CUDA_ARCH__ >= 700
+  __nanosleep(nanoseconds);
+
+  if(nanoseconds < 1024) nanoseconds *= 2;
+#endif
+} // end backoff()
+
+
+inline __host__ __device__ unsigned int round_up_to_power_of_two(unsigned int x)
+{
+  unsigned int result = 1;
+
+  while(result < x && result < (1u << 31)) result *= 2;
+
+  return result;
+} // end round_up_to_power_of_two()
+
+
+} // end device_queue_detail
+} // end detail
+
+
+// device_queue_view is the device's view of a bulk::device_queue
+// it is passed to bulk::async by value
+//
+// the queue is a ring of slots, each guarded by a sequence number:
+// the agent which claims ticket t of either end waits until slot t % capacity()
+// has reached the round of t, so producers never overwrite a value which hasn't been
+// dequeued and consumers never read a value which hasn't been enqueued
+//
+// tickets are claimed with one atomic per warp, so agents may call enqueue & dequeue
+// individually, from any branch
+//
+// XXX a producer blocks while the queue is full and a consumer blocks while it is empty & open,
+//     so the kernels on either side of a queue must run concurrently, in different streams
+// XXX values move word by word with volatile stores & loads, so T must be trivially copyable
+template<typename T>
+class device_queue_view
+{
+  public:
+    typedef T            value_type;
+    typedef unsigned int size_type;
+
+    __host__ __device__
+    device_queue_view()
+      : m_counters(0), m_sequence(0), m_values(0), m_capacity(0)
+    {}
+
+    __host__ __device__
+    device_queue_view(unsigned int *counters, unsigned int *sequence, value_type *values, size_type capacity)
+      : m_counters(counters), m_sequence(sequence), m_values(values), m_capacity(capacity)
+    {}
+
+    __host__ __device__
+    size_type capacity() const
+    {
+      return m_capacity;
+    } // end capacity()
+
+    // blocks until a slot is free, then publishes x
+    __device__
+    void enqueue(const value_type &x) const
+    {
+      unsigned int ticket = detail::warp_aggregated_increment(enqueue_counter(), 0);
+      unsigned int slot = ticket & (m_capacity - 1);
+
+      wait_for_sequence(slot, ticket);
+
+      detail::decoupled_look_back_detail::store_volatile(m_values + slot, x);
+
+      // the value must be visible before the sequence number which announces it
+      __threadfence();
+
+      atomicExch(m_sequence + slot, ticket + 1);
+    } // end enqueue()
+
+    // blocks until a value is available and returns true after moving it to x,
+    // or returns false once the queue has been closed and every value enqueued before has been dequeued
+    __device__
+    bool dequeue(value_type &x) const
+    {
+      unsigned int ticket = detail::warp_aggregated_increment(dequeue_counter(), 0);
+      unsigned int slot = ticket & (m_capacity - 1);
+
+      volatile unsigned int *sequence = m_sequence + slot;
+
+      unsigned int delay = 32;
+
+      while(*sequence != ticket + 1)
+      {
+        // once the queue is closed, no ticket past the producers' last will ever be filled
+        volatile unsigned int *closed = closed_flag();
+        volatile unsigned int *num_enqueued = enqueue_counter();
+
+        if(*closed && !detail::device_queue_detail::precedes(ticket, *num_enqueued))
+        {
+          return false;
+        } // end if
+
+        detail::device_queue_detail::backoff(delay);
+      } // end while
+
+      // order the load of the sequence number before the load of the value
+      __threadfence();
+
+      x = detail::decoupled_look_back_detail::load_volatile(m_values + slot);
+
+      // the value must be read before its slot is handed to the next round's producer
+      __threadfence();
+
+      atomicExch(m_sequence + slot, ticket + m_capacity);
+
+      return true;
+    } // end dequeue()
+
+    // tells the consumers that nothing more will be enqueued
+    // every producer must have returned from its last enqueue first,
+    // e.g. by closing from the host after the producer kernel, or from the last producer group to finish
+    __device__
+    void close() const
+    {
+      __threadfence();
+
+      atomicExch(closed_flag(), 1u);
+    } // end close()
+
+  private:
+    __host__ __device__
+    unsigned int *enqueue_counter() const
+    {
+      return m_counters;
+    } // end enqueue_counter()
+
+    __host__ __device__
+    unsigned int *dequeue_counter() const
+    {
+      return m_counters + detail::device_queue_detail::counter_stride;
+    } // end dequeue_counter()
+
+    __host__ __device__
+    unsigned int *closed_flag() const
+    {
+      return m_counters + 2 * detail::device_queue_detail::counter_stride;
+    } // end closed_flag()
+
+    __device__
+    void wait_for_sequence(unsigned int slot, unsigned int ticket) const
+    {
+      volatile unsigned int *sequence = m_sequence + slot;
+
+      unsigned int delay = 32;
+
+      while(*sequence != ticket)
+      {
+        detail::device_queue_detail::backoff(delay);
+      } // end while
+    } // end wait_for_sequence()
+
+    unsigned int *m_counters;
+    unsigned int *m_sequence;
+    value_type   *m_values;
+    size_type     m_capacity;
+}; // end device_queue_view
+
+
+// device_queue owns the storage of a bounded, multi-producer, multi-consumer queue
+// through which concurrently running kernels stream values to each other.
+// It is only available in __host__ code; kernels use the device_queue_view returned by view().
+//
+// For example, a stage which decodes what an ingest stage enqueues:
+//
+//   struct decode
+//   {
+//     __device__ void operator()(bulk::device_queue_view<record> in, bulk::device_queue_view<int> out)
+//     {
+//       record r;
+//       while(in.dequeue(r)) out.enqueue(decode_record(r));
+//     }
+//   };
+//
+//   bulk::device_queue<record> records(1 << 16);
+//   bulk::device_queue<int> values(1 << 16);
+//
+//   bulk::async(bulk::par(s1, n), ingest(), bulk::root.this_exec, records.view());
+//   records.close(s1);
+//   bulk::async(bulk::par(s2, m), decode(), records.view(), values.view());
+//
+// The capacity is rounded up to a power of two.
+template<typename T>
+class device_queue
+{
+  public:
+    typedef T                                        value_type;
+    typedef typename device_queue_view<T>::size_type size_type;
+
+    explicit device_queue(size_type capacity = 1024)
+      : m_storage(0),
+        m_capacity(detail::device_queue_detail::round_up_to_power_of_two(capacity))
+    {
+      if(bulk::detail::is_capturing())
+      {
+        bulk::detail::terminate_with_message("device_queue: queues may not be created during bulk::capture()");
+      } // end if
+
+      if(capacity < 1 || capacity > (1u << 31))
+      {
+        bulk::detail::terminate_with_message("device_queue: capacity must be positive and at most 2^31");
+      } // end if
+
+      bulk::detail::throw_on_error(cudaMalloc(&m_storage, storage_size()), "cudaMalloc in device_queue ctor");
+
+      try
+      {
+        reset();
+      } // end try
+      catch(...)
+      {
+        cudaFree(m_storage);
+        throw;
+      } // end catch
+    } // end device_queue()
+
+    ~device_queue()
+    {
+      if(m_storage) cudaFree(m_storage);
+    } // end ~device_queue()
+
+    device_queue_view<T> view() const
+    {
+      unsigned int *counters = reinterpret_cast<unsigned int*>(m_storage);
+
+      return device_queue_view<T>(counters, sequence(), values(), m_capacity);
+    } // end view()
+
+    size_type capacity() const
+    {
+      return m_capacity;
+    } // end capacity()
+
+    // closes the queue once the work enqueued in s before it completes
+    void close(cudaStream_t s = 0) const
+    {
+      // any nonzero word will do
+      bulk::detail::throw_on_error(cudaMemsetAsync(closed_flag(), 1, sizeof(unsigned int), s),
+                                   "device_queue::close(): after cudaMemsetAsync");
+    } // end close()
+
+    // empties and reopens the queue
+    // no kernel may be using the queue
+    void reset()
+    {
+      std::vector<unsigned int> initial(detail::device_queue_detail::num_counter_words + m_capacity, 0);
+
+      // slot i first admits the producer with ticket i
+      for(size_type i = 0; i < m_capacity; ++i)
+      {
+        initial[detail::device_queue_detail::num_counter_words + i] = i;
+      } // end for
+
+      bulk::detail::throw_on_error(cudaMemcpy(m_storage, &initial[0], initial.size() * sizeof(unsigned int), cudaMemcpyHostToDevice),
+                                   "cudaMemcpy in device_queue::reset");
+    } // end reset()
+
+  private:
+    // noncopyable
+    device_queue(const device_queue &);
+    device_queue &operator=(const device_queue &);
+
+    std::size_t values_offset() const
+    {
+      return detail::decoupled_look_back_detail::align_up((detail::device_queue_detail::num_counter_words + m_capacity) * sizeof(unsigned int),
+                                                          bulk::detail::alignment_of<T>::value);
+    } // end values_offset()
+
+    std::size_t storage_size() const
+    {
+      return values_offset() + m_capacity * sizeof(T);
+    } // end storage_size()
+
+    unsigned int *closed_flag() const
+    {
+      return reinterpret_cast<unsigned int*>(m_storage) + 2 * detail::device_queue_detail::counter_stride;
+    } // end closed_flag()
+
+    unsigned int *sequence() const
+    {
+      return reinterpret_cast<unsigned int*>(m_storage) + detail::device_queue_detail::num_counter_words;
+    } // end sequence()
+
+    T *values() const
+    {
+      return reinterpret_cast<T*>(reinterpret_cast<char*>(m_storage) + values_offset());
+    } // end values()
+
+    void *m_storage;
+    size_type m_capacity;
+}; // end device_queue
+
+
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
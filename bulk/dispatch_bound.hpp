@@ -0,0 +1,198 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <cstddef>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+
+
+// the compile-time bound dispatch_bound passes to its function, e.g. bulk::bound<b>(g)
+template<std::size_t bound_>
+struct bound_constant
+{
+  static const std::size_t value = bound_;
+};
+
+
+// a list of up to eight candidate bounds, in increasing order
+// a zero ends the list
+template<std::size_t Bound0,
+         std::size_t Bound1 = 0,
+         std::size_t Bound2 = 0,
+         std::size_t Bound3 = 0,
+         std::size_t Bound4 = 0,
+         std::size_t Bound5 = 0,
+         std::size_t Bound6 = 0,
+         std::size_t Bound7 = 0>
+struct bounds
+{
+  static const std::size_t head = Bound0;
+  typedef bounds<Bound1,Bound2,Bound3,Bound4,Bound5,Bound6,Bound7> tail;
+};
+
+
+namespace detail
+{
+namespace dispatch_bound_detail
+{
+
+
+template<typename Bounds, bool empty = (Bounds::head == 0)>
+struct bound_list
+{
+  typedef bound_list<typename Bounds::tail> tail;
+
+  // invokes f with the smallest bound which covers n
+  // returns false without invoking f if none does
+  __bulk_exec_check_disable__
+  template<typename Size, typename Function>
+  __host__ __device__
+  static bool dispatch(Size n, Function &f)
+  {
+    if(n <= Size(Bounds::head))
+    {
+      f(bulk::bound_constant<Bounds::head>());
+      return true;
+    } // end if
+
+    return tail::dispatch(n, f);
+  } // end dispatch()
+}; // end bound_list
+
+
+template<typename Bounds>
+struct bound_list<Bounds,true>
+{
+  template<typename Size, typename Function>
+  __host__ __device__
+  static bool dispatch(Size, Function &)
+  {
+    return false;
+  } // end dispatch()
+}; // end bound_list
+
+
+} // end dispatch_bound_detail
+} // end detail
+
+
+// dispatch_bound converts a runtime size into a compile-time bound: it invokes f with the smallest
+// of the candidate bounds which covers n, so that callers with runtime sizes reach the bounded
+// versions of algorithms without writing their own switch statements
+// it returns false without invoking f if n exceeds every candidate, so the caller may take an unbounded path
+//
+// f is a function object which accepts a bound_constant, e.g.
+//
+//   struct sort_tile
+//   {
+//     ...
+//
+//     template<std::size_t b>
+//     __device__ void operator()(bulk::bound_constant<b>)
+//     {
+//       bulk::stable_sort_by_key(bulk::bound<b>(g), keys_first, keys_last, values_first, comp);
+//     }
+//   };
+//
+//   bulk::dispatch_bound<256,512,1024>(keys_last - keys_first, f);
+//
+// each candidate is a separate instantiation of f, so the list should be short
+template<typename Bounds, typename Size, typename Function>
+__host__ __device__
+bool dispatch_bound(Size n, Function &f)
+{
+  return detail::dispatch_bound_detail::bound_list<Bounds>::dispatch(n, f);
+} // end dispatch_bound()
+
+
+template<std::size_t Bound0, typename Size, typename Function>
+__host__ __device__
+bool dispatch_bound(Size n, Function &f)
+{
+  return bulk::dispatch_bound<bulk::bounds<Bound0> >(n, f);
+} // end dispatch_bound()
+
+
+template<std::size_t Bound0, std::size_t Bound1, typename Size, typename Function>
+__host__ __device__
+bool dispatch_bound(Size n, Function &f)
+{
+  return bulk::dispatch_bound<bulk::bounds<Bound0,Bound1> >(n, f);
+} // end dispatch_bound()
+
+
+template<std::size_t Bound0, std::size_t Bound1, std::size_t Bound2, typename Size, typename Function>
+__host__ __device__
+bool dispatch_bound(Size n, Function &f)
+{
+  return bulk::dispatch_bound<bulk::bounds<Bound0,Bound1,Bound2> >(n, f);
+} // end dispatch_bound()
+
+
+template<std::size_t Bound0, std::size_t Bound1, std::size_t Bound2, std::size_t Bound3, typename Size, typename Function>
+__host__ __device__
+bool dispatch_bound(Size n, Function &f)
+{
+  return bulk::dispatch_bound<bulk::bounds<Bound0,Bound1,Bound2,Bound3> >(n, f);
+} // end dispatch_bound()
+
+
+template<std::size_t Bound0, std::size_t Bound1, std::size_t Bound2, std::size_t Bound3,
+         std::size_t Bound4, typename Size, typename Function>
+__host__ __device__
+bool dispatch_bound(Size n, Function &f)
+{
+  return bulk::dispatch_bound<bulk::bounds<Bound0,Bound1,Bound2,Bound3,Bound4> >(n, f);
+} // end dispatch_bound()
+
+
+template<std::size_t Bound0, std::size_t Bound1, std::size_t Bound2, std::size_t Bound3,
+         std::size_t Bound4, std::size_t Bound5, typename Size, typename Function>
+__host__ __device__
+bool dispatch_bound(Size n, Function &f)
+{
+  return bulk::dispatch_bound<bulk::bounds<Bound0,Bound1,Bound2,Bound3,Bound4,Bound5> >(n, f);
+} // end dispatch_bound()
+
+
+template<std::size_t Bound0, std::size_t Bound1, std::size_t Bound2, std::size_t Bound3,
+         std::size_t Bound4, std::size_t Bound5, std::size_t Bound6, typename Size, typename Function>
+__host__ __device__
+bool dispatch_bound(Size n, Function &f)
+{
+  return bulk::dispatch_bound<bulk::bounds<Bound0,Bound1,Bound2,Bound3,Bound4,Bound5,Bound6> >(n, f);
+} // end dispatch_bound()
+
+
+template<std::size_t Bound0, std::size_t Bound1, std::size_t Bound2, std::size_t Bound3,
+         std::size_t Bound4, std::size_t Bound5, std::size_t Bound6, std::size_t Bound7, typename Size, typename Function>
+__host__ __device__
+bool dispatch_bound(Size n, Function &f)
+{
+  return bulk::dispatch_bound<bulk::bounds<Bound0,Bound1,Bound2,Bound3,Bound4,Bound5,Bound6,Bound7> >(n, f);
+} // end dispatch_bound()
+
+
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
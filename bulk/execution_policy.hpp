@@ -19,6 +19,11 @@
 #include <bulk/future.hpp>
 #include <thrust/detail/type_traits.h>
 #include <bulk/detail/cuda_launcher/runtime_introspection.hpp>
+#include <bulk/detail/grid_barrier.hpp>
+#include <bulk/detail/throw_on_error.hpp>
+#include <bulk/detail/terminate.hpp>
+#include <bulk/detail/stream_capture.hpp>
+#include <bulk/detail/host_launcher/fiber_scheduler.hpp>
 #include <cstddef>
 
 
@@ -59,11 +64,14 @@ static const int invalid_index = INT_MAX;
 
 // sequential execution with a grainsize hint and index within a group
 // a light-weight (logical) thread
-template<std::size_t grainsize_ = 1>
+// Index is the type of the agent's index; 32 bits is the fast path, and a
+// flat launch of more than 2^31 agents may ask for a wider type by launching,
+// e.g., par(agent<1,std::ptrdiff_t>(), n)
+template<std::size_t grainsize_ = 1, typename Index = int>
 class agent
 {
   public:
-    typedef int size_type;
+    typedef Index size_type;
 
     static const size_type static_grainsize = grainsize_;
 
@@ -106,7 +114,8 @@ class group_base
   public:
     typedef ExecutionAgent agent_type;
 
-    typedef int size_type;
+    // a group indexes its agents as widely as they index themselves
+    typedef typename agent_type::size_type size_type;
 
     static const size_type static_size = size_;
 
@@ -128,10 +137,12 @@ class group_base
       return static_size;
     }
 
-    __device__
+    // XXX the product is formed in size_type, so a grid of groups of 32-bit agents
+    //     must not comprise more than 2^31 agents in total
+    __host__ __device__
     size_type global_index() const
     {
-      return index() * size() + this_exec.index();
+      return size_type(index()) * size() + this_exec.index();
     }
 
     agent_type this_exec;
@@ -147,7 +158,8 @@ class group_base<ExecutionAgent,dynamic_group_size>
   public:
     typedef ExecutionAgent agent_type;
 
-    typedef int size_type;
+    // a group indexes its agents as widely as they index themselves
+    typedef typename agent_type::size_type size_type;
 
     __host__ __device__
     group_base(size_type sz, agent_type exec = agent_type(), size_type i = invalid_index)
@@ -168,10 +180,12 @@ class group_base<ExecutionAgent,dynamic_group_size>
       return m_size;
     }
 
+    // XXX the product is formed in size_type, so a grid of groups of 32-bit agents
+    //     must not comprise more than 2^31 agents in total
     __host__ __device__
     size_type global_index() const
     {
-      return index() * size() + this_exec.index();
+      return size_type(index()) * size() + this_exec.index();
     }
 
     agent_type this_exec;
@@ -251,20 +265,125 @@ parallel_group<ExecutionAgent> par(ExecutionAgent exec, size_t size)
 }
 
 
+// hints which a launch passes to the hardware
+// they are only available to launches from __host__ code
+struct launch_attributes
+{
+  __host__ __device__
+  launch_attributes()
+    : has_priority(false),
+      priority(0),
+      persisting_base(0),
+      num_persisting_bytes(0),
+      hit_ratio(1.f),
+      smem_carveout(-1)
+  {}
+
+  __host__ __device__
+  bool empty() const
+  {
+    return !has_priority && num_persisting_bytes == 0 && smem_carveout < 0;
+  }
+
+  // a stream priority, where lower numbers are greater priorities and 0 is the default
+  // the priority of a launch into a stream of its own is that of the stream it gets from the pool;
+  // a launch into a given stream requires CUDA 12
+  bool has_priority;
+  int priority;
+
+  // an L2 access policy window: hit_ratio of the accesses to
+  // [persisting_base, persisting_base + num_persisting_bytes) persist in the L2 set-aside,
+  // and the rest stream through it
+  const void *persisting_base;
+  std::size_t num_persisting_bytes;
+  float hit_ratio;
+
+  // the preferred percentage of the unified L1 & shared memory to carve out for shared memory,
+  // or negative to leave the kernel's preference alone
+  // XXX the preference sticks to the kernel, not just this launch
+  int smem_carveout;
+};
+
+
+// sets aside num_bytes of the current device's L2 for the persisting accesses of launches
+// with_persisting_window(), clamped to the device's limit, and returns the size set aside
+// it is only available in __host__ code
+inline std::size_t reserve_persisting_l2(std::size_t num_bytes)
+{
+#if __BULK_HAS_CUDART__ && (CUDART_VERSION >= 11000)
+  int max_size = 0;
+  bulk::detail::throw_on_error(cudaDeviceGetAttribute(&max_size, cudaDevAttrMaxPersistingL2CacheSize, bulk::detail::current_device()),
+                               "bulk::reserve_persisting_l2(): after cudaDeviceGetAttribute");
+
+  if(num_bytes > std::size_t(max_size)) num_bytes = max_size;
+
+  bulk::detail::throw_on_error(cudaDeviceSetLimit(cudaLimitPersistingL2CacheSize, num_bytes),
+                               "bulk::reserve_persisting_l2(): after cudaDeviceSetLimit");
+
+  return num_bytes;
+#else
+  bulk::detail::terminate_with_message("bulk::reserve_persisting_l2(): requires CUDART 11.0 or better.");
+  return 0;
+#endif
+} // end reserve_persisting_l2()
+
+
 template<typename ExecutionAgent>
 class async_launch
 {
   public:
     __host__ __device__
-    async_launch(ExecutionAgent exec, cudaStream_t s, cudaEvent_t be = 0)
-      : stream_valid(true),e(exec),s(s),be(be)
+    async_launch(ExecutionAgent exec, cudaStream_t s, cudaEvent_t be = 0, bool record = true)
+      : stream_valid(true),record(record),e(exec),s(s),be(be)
     {}
 
-    __host__
-    async_launch(ExecutionAgent exec, cudaEvent_t be)
-      : stream_valid(false),e(exec),s(0),be(be)
+    __host__ __device__
+    async_launch(ExecutionAgent exec, cudaEvent_t be, bool record = true)
+      : stream_valid(false),record(record),e(exec),s(0),be(be)
     {}
 
+    __host__ __device__
+    async_launch with_attributes(const launch_attributes &a) const
+    {
+      async_launch result = *this;
+      result.attr = a;
+      return result;
+    }
+
+    // e.g. bulk::async(bulk::in_own_stream(bulk::par(n)).with_priority(-1), f, bulk::root.this_exec)
+    __host__ __device__
+    async_launch with_priority(int priority) const
+    {
+      async_launch result = *this;
+      result.attr.has_priority = true;
+      result.attr.priority = priority;
+      return result;
+    }
+
+    __host__ __device__
+    async_launch with_persisting_window(const void *base, std::size_t num_bytes, float hit_ratio = 1.f) const
+    {
+      async_launch result = *this;
+      result.attr.persisting_base = base;
+      result.attr.num_persisting_bytes = num_bytes;
+      result.attr.hit_ratio = hit_ratio;
+      return result;
+    }
+
+    __host__ __device__
+    async_launch with_smem_carveout(int percent) const
+    {
+      async_launch result = *this;
+      result.attr.smem_carveout = percent;
+      return result;
+    }
+
+    __host__ __device__
+    const launch_attributes &attributes() const
+    {
+      return attr;
+    }
+
     __host__ __device__
     ExecutionAgent exec() const
     {
@@ -289,11 +408,21 @@ class async_launch
       return stream_valid;
     }
 
+
+    // when false, the launch's future has no event and is not valid()
+    __host__ __device__
+    bool records_event() const
+    {
+      return record;
+    }
+
   private:
     bool stream_valid;
+    bool record;
     ExecutionAgent e;
     cudaStream_t s;
     cudaEvent_t be;
+    launch_attributes attr;
 };
 
 
@@ -320,6 +449,121 @@ inline async_launch<bulk::parallel_group<> > par(bulk::future<void> &before, siz
 }
 
 
+// launches through fire_and_forget() skip recording an event
+// so the future returned by bulk::async is not valid() and cannot be waited on
+__bulk_exec_check_disable__
+template<typename ExecutionGroup>
+__host__ __device__
+async_launch<ExecutionGroup> fire_and_forget(async_launch<ExecutionGroup> launch)
+{
+  return (launch.is_stream_valid() ?
+    async_launch<ExecutionGroup>(launch.exec(), launch.stream(), launch.before_event(), false) :
+    async_launch<ExecutionGroup>(launch.exec(), launch.before_event(), false)).with_attributes(launch.attributes());
+}
+
+
+// as with bulk::async(g, f), the launch goes into the calling thread's default stream
+template<typename ExecutionGroup>
+__host__ __device__
+async_launch<ExecutionGroup> fire_and_forget(ExecutionGroup g)
+{
+  return async_launch<ExecutionGroup>(g, bulk::detail::default_stream(), 0, false);
+}
+
+
+// the launch goes into a stream of its own rather than the default stream
+// in __host__ code, the stream comes from the pool; in __device__ code, it's a new
+// non-blocking stream, so the child grids a block launches this way may run concurrently
+template<typename ExecutionGroup>
+__host__ __device__
+async_launch<ExecutionGroup> in_own_stream(ExecutionGroup g)
+{
+  return async_launch<ExecutionGroup>(g, cudaEvent_t(0));
+}
+
+
+// a launch which executes on the host's threads rather than a device
+// if on_host() is false, the launch goes to the device as if it were just exec()
+template<typename ExecutionGroup>
+class host_launch
+{
+  public:
+    __host__ __device__
+    host_launch(ExecutionGroup exec, bool on_host = true)
+      : e(exec), h(on_host)
+    {}
+
+    __host__ __device__
+    ExecutionGroup exec() const
+    {
+      return e;
+    }
+
+    __host__ __device__
+    bool on_host() const
+    {
+      return h;
+    }
+
+  private:
+    ExecutionGroup e;
+    bool h;
+};
+
+
+// the groups are run by a pool of host threads, and the agents of each concurrent group
+// by fibers on one of those threads, so the function must be callable from __host__ code
+// the launch is complete by the time bulk::async returns, and its future is not valid()
+// when predicate is false, the launch goes to the device instead, e.g.
+//
+//   bulk::async(bulk::on_host(bulk::par(n), n < 10000), f, bulk::root);
+//
+template<typename ExecutionGroup>
+__host__ __device__
+host_launch<ExecutionGroup> on_host(ExecutionGroup g, bool predicate = true)
+{
+  return host_launch<ExecutionGroup>(g, predicate);
+}
+
+
+// a launch whose range on the profiler's timeline bears a label
+// Launch is an execution group or a launch such as async_launch
+template<typename Launch>
+class labeled_launch
+{
+  public:
+    __host__ __device__
+    labeled_launch(const char *label, Launch launch)
+      : l(label), launch_(launch)
+    {}
+
+    __host__ __device__
+    const char *label() const
+    {
+      return l;
+    }
+
+    __host__ __device__
+    Launch launch() const
+    {
+      return launch_;
+    }
+
+  private:
+    const char *l;
+    Launch launch_;
+};
+
+
+// the label must outlive the call to bulk::async
+template<typename Launch>
+__host__ __device__
+labeled_launch<Launch> label(const char *label, Launch launch)
+{
+  return labeled_launch<Launch>(label, launch);
+}
+
+
 // a group of concurrent ExecutionAgents which may synchronize
 template<typename ExecutionAgent      = agent<>,
          std::size_t size_      = dynamic_group_size>
@@ -345,12 +589,15 @@ class concurrent_group
         m_heap_size(heap_size)
     {}
 
-    __device__
+    // in __host__ code, a group run by bulk::on_host() waits for its other agents
+    __host__ __device__
     void wait() const
     {
       // guard use of __syncthreads from foreign compilers
 #ifdef __CUDA_ARCH__
       __syncthreads();
+#else
+      bulk::detail::host_group_wait();
 #endif
     }
 
@@ -401,12 +648,15 @@ class concurrent_group<ExecutionAgent,dynamic_group_size>
         m_heap_size(heap_size)
     {}
 
-    __device__
+    // in __host__ code, a group run by bulk::on_host() waits for its other agents
+    __host__ __device__
     void wait()
     {
       // guard use of __syncthreads from foreign compilers
 #ifdef __CUDA_ARCH__
       __syncthreads();
+#else
+      bulk::detail::host_group_wait();
 #endif
     }
 
@@ -668,6 +918,198 @@ async_launch<
 }
 
 
+// a grid of concurrent groups which may all synchronize
+// the groups of a concurrent_grid are launched cooperatively, so they are all resident at once
+// and the number of groups requested is clamped to the number which fit on the device
+template<typename ExecutionAgent = concurrent_group<> >
+class concurrent_grid
+  : public parallel_group<ExecutionAgent,dynamic_group_size>
+{
+  private:
+    typedef parallel_group<
+      ExecutionAgent,
+      dynamic_group_size
+    > super_t;
+
+  public:
+    typedef typename super_t::agent_type agent_type;
+
+    typedef typename super_t::size_type  size_type;
+
+    // XXX the constructor taking an index & barrier should be made private
+    __host__ __device__
+    concurrent_grid(size_type size,
+                    agent_type exec = agent_type(),
+                    size_type i = invalid_index,
+                    detail::grid_barrier barrier = detail::grid_barrier())
+      : super_t(size,exec,i),
+        m_barrier(barrier)
+    {}
+
+    // waits until every agent of every group of the grid has called wait()
+    __device__
+    void wait()
+    {
+      m_barrier.wait(super_t::this_exec, super_t::size());
+    }
+
+    __host__ __device__
+    detail::grid_barrier barrier() const
+    {
+      return m_barrier;
+    }
+
+  private:
+    detail::grid_barrier m_barrier;
+};
+
+
+// shorthand for creating a concurrent grid of concurrent groups of agents
+inline __host__ __device__
+concurrent_grid<> cogrid(size_t num_groups = use_default, size_t group_size = use_default, size_t heap_size = use_default)
+{
+  return concurrent_grid<>(num_groups, con(group_size,heap_size));
+}
+
+
+inline __host__ __device__
+async_launch<concurrent_grid<> >
+  cogrid(size_t num_groups, size_t group_size, size_t heap_size, cudaStream_t stream)
+{
+  return async_launch<concurrent_grid<> >(cogrid(num_groups, group_size, heap_size), stream);
+}
+
+
+template<std::size_t groupsize, std::size_t grainsize>
+__host__ __device__
+concurrent_grid<
+  concurrent_group<
+    bulk::agent<grainsize>,
+    groupsize
+  >
+>
+  cogrid(size_t num_groups = use_default, size_t heap_size = use_default)
+{
+  return concurrent_grid<concurrent_group<bulk::agent<grainsize>,groupsize> >(num_groups, con<groupsize,grainsize>(heap_size));
+}
+
+
+template<std::size_t groupsize, std::size_t grainsize>
+__host__ __device__
+async_launch<
+  concurrent_grid<
+    concurrent_group<
+      bulk::agent<grainsize>,
+      groupsize
+    >
+  >
+>
+  cogrid(size_t num_groups, size_t heap_size, cudaStream_t stream)
+{
+  typedef concurrent_grid<concurrent_group<bulk::agent<grainsize>,groupsize> > grid_type;
+
+  return async_launch<grid_type>(cogrid<groupsize,grainsize>(num_groups, heap_size), stream);
+}
+
+
+// a cluster of concurrent groups which are scheduled together on neighboring multiprocessors
+// the agents of a cluster may synchronize with each other, and its groups may address each other's
+// on-chip heaps, so that a working set larger than one multiprocessor's shared memory stays on chip
+// clusters of more than one group require CUDA 11.8 and a device of compute capability 9.0 or better;
+// elsewhere, each cluster is a single group
+template<typename ExecutionAgent = concurrent_group<> >
+class cluster
+  : public parallel_group<ExecutionAgent,dynamic_group_size>
+{
+  private:
+    typedef parallel_group<
+      ExecutionAgent,
+      dynamic_group_size
+    > super_t;
+
+  public:
+    typedef typename super_t::agent_type agent_type;
+
+    typedef typename super_t::size_type  size_type;
+
+    // XXX the constructor taking an index should be made private
+    __host__ __device__
+    cluster(size_type size,
+            agent_type exec = agent_type(),
+            size_type i = invalid_index)
+      : super_t(size,exec,i)
+    {}
+
+    // waits until every agent of every group of the cluster has called wait()
+    // writes to the groups' heaps before the wait are visible to the whole cluster after it
+    __device__
+    void wait()
+    {
+#if defined(__CUDA_ARCH__) && (__CUDA_ARCH__ >= 900)
+      asm volatile("barrier.cluster.arrive.aligned;\n"
+                   "barrier.cluster.wait.aligned;\n" ::: "memory");
+#else
+      // without cluster support, the cluster is its one group
+      super_t::this_exec.wait();
+#endif
+    }
+};
+
+
+// shorthand for creating a grid of clusters of concurrent groups of agents
+inline __host__ __device__
+parallel_group<cluster<> > cluster_grid(size_t num_clusters, size_t cluster_size, size_t group_size = use_default, size_t heap_size = use_default)
+{
+  return par(cluster<>(cluster_size, con(group_size,heap_size)), num_clusters);
+}
+
+
+inline __host__ __device__
+async_launch<parallel_group<cluster<> > >
+  cluster_grid(size_t num_clusters, size_t cluster_size, size_t group_size, size_t heap_size, cudaStream_t stream)
+{
+  return par(stream, cluster<>(cluster_size, con(group_size,heap_size)), num_clusters);
+}
+
+
+template<std::size_t groupsize, std::size_t grainsize>
+__host__ __device__
+parallel_group<
+  cluster<
+    concurrent_group<
+      bulk::agent<grainsize>,
+      groupsize
+    >
+  >
+>
+  cluster_grid(size_t num_clusters, size_t cluster_size, size_t heap_size = use_default)
+{
+  typedef concurrent_group<bulk::agent<grainsize>,groupsize> group_type;
+
+  return par(cluster<group_type>(cluster_size, con<groupsize,grainsize>(heap_size)), num_clusters);
+}
+
+
+template<std::size_t groupsize, std::size_t grainsize>
+__host__ __device__
+async_launch<
+  parallel_group<
+    cluster<
+      concurrent_group<
+        bulk::agent<grainsize>,
+        groupsize
+      >
+    >
+  >
+>
+  cluster_grid(size_t num_clusters, size_t cluster_size, size_t heap_size, cudaStream_t stream)
+{
+  typedef concurrent_group<bulk::agent<grainsize>,groupsize> group_type;
+
+  return par(stream, cluster<group_type>(cluster_size, con<groupsize,grainsize>(heap_size)), num_clusters);
+}
+
+
 } // end bulk
 BULK_NAMESPACE_SUFFIX
 
@@ -0,0 +1,220 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/execution_policy.hpp>
+#include <bulk/async.hpp>
+#include <bulk/malloc.hpp>
+#include <bulk/memory_pool.hpp>
+#include <bulk/algorithm/device/reduce.hpp>
+#include <bulk/detail/guarded_cuda_runtime_api.hpp>
+#include <bulk/detail/throw_on_error.hpp>
+#include <thrust/iterator/iterator_traits.h>
+#include <thrust/iterator/transform_iterator.h>
+#include <thrust/detail/type_traits/result_of_adaptable_function.h>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+namespace detail
+{
+namespace fused_detail
+{
+
+
+template<typename T>
+struct identity_stage
+{
+  typedef T result_type;
+
+  __host__ __device__
+  T operator()(const T &x) const
+  {
+    return x;
+  }
+}; // end identity_stage
+
+
+// applies First, then Second to its result
+template<typename First, typename Second>
+struct composed_stage
+{
+  typedef typename thrust::detail::result_of_adaptable_function<
+    Second(typename First::result_type)
+  >::type result_type;
+
+  First first;
+  Second second;
+
+  __host__ __device__
+  composed_stage(First f, Second s)
+    : first(f), second(s)
+  {}
+
+  template<typename T>
+  __host__ __device__
+  result_type operator()(const T &x) const
+  {
+    return second(first(x));
+  }
+}; // end composed_stage
+
+
+struct copy_kernel
+{
+  template<typename Iterator, typename Function, typename OutputIterator>
+  __device__
+  void operator()(bulk::agent<> &self, Iterator first, Function f, OutputIterator result)
+  {
+    int i = self.index();
+    result[i] = f(first[i]);
+  }
+}; // end copy_kernel
+
+
+struct for_each_kernel
+{
+  template<typename Iterator, typename Function, typename Sink>
+  __device__
+  void operator()(bulk::agent<> &self, Iterator first, Function f, Sink sink)
+  {
+    int i = self.index();
+    sink(f(first[i]));
+  }
+}; // end for_each_kernel
+
+
+} // end fused_detail
+} // end detail
+
+
+// a lazily evaluated sequence: the elements of [first, last) passed through a chain of stages
+// each call to then() appends a stage; nothing is launched until a terminal operation (copy,
+// for_each or reduce), which runs the whole chain within a single pass over the input,
+// so intermediate results stay in registers rather than round-tripping through memory
+// each stage is a function object whose result_type names what it returns
+template<typename Iterator,
+         typename Stages = detail::fused_detail::identity_stage<typename thrust::iterator_value<Iterator>::type> >
+class fused_range
+{
+  public:
+    typedef typename Stages::result_type                  value_type;
+    typedef thrust::transform_iterator<Stages, Iterator> iterator;
+    typedef typename thrust::iterator_difference<Iterator>::type size_type;
+
+    fused_range(cudaStream_t s, Iterator first, Iterator last, Stages stages = Stages())
+      : m_stream(s), m_first(first), m_last(last), m_stages(stages)
+    {}
+
+    template<typename Function>
+    fused_range<Iterator, detail::fused_detail::composed_stage<Stages,Function> >
+      then(Function f) const
+    {
+      typedef detail::fused_detail::composed_stage<Stages,Function> stages_type;
+
+      return fused_range<Iterator,stages_type>(m_stream, m_first, m_last, stages_type(m_stages, f));
+    } // end then()
+
+    // the chain as an iterator range, for use with any other algorithm
+    iterator begin() const
+    {
+      return iterator(m_first, m_stages);
+    } // end begin()
+
+    iterator end() const
+    {
+      return iterator(m_last, m_stages);
+    } // end end()
+
+    size_type size() const
+    {
+      return m_last - m_first;
+    } // end size()
+
+    // writes each result of the chain to result in a single launch
+    template<typename OutputIterator>
+    OutputIterator copy(OutputIterator result) const
+    {
+      size_type n = size();
+
+      if(n > 0)
+      {
+        bulk::async(bulk::par(m_stream, n), detail::fused_detail::copy_kernel(), bulk::root.this_exec, m_first, m_stages, result);
+      } // end if
+
+      return result + n;
+    } // end copy()
+
+    // passes each result of the chain to sink in a single launch
+    template<typename Function>
+    void for_each(Function sink) const
+    {
+      size_type n = size();
+
+      if(n > 0)
+      {
+        bulk::async(bulk::par(m_stream, n), detail::fused_detail::for_each_kernel(), bulk::root.this_exec, m_first, m_stages, sink);
+      } // end if
+    } // end for_each()
+
+    // reduces the results of the chain and returns the sum to the host
+    template<typename T, typename BinaryFunction>
+    T reduce(T init, BinaryFunction binary_op) const
+    {
+      size_type n = size();
+
+      if(n <= 0) return init;
+
+      bulk::temporary_buffer<T> d_result(1, m_stream);
+
+      detail::device_reduce_detail::reduce(m_stream, begin(), n, init, binary_op, d_result.data());
+
+      T result;
+      bulk::detail::throw_on_error(cudaMemcpyAsync(&result, d_result.data(), sizeof(T), cudaMemcpyDeviceToHost, m_stream), "bulk::fused_range::reduce(): after cudaMemcpyAsync");
+      bulk::detail::throw_on_error(cudaStreamSynchronize(m_stream), "bulk::fused_range::reduce(): after cudaStreamSynchronize");
+
+      return result;
+    } // end reduce()
+
+  private:
+    cudaStream_t m_stream;
+    Iterator     m_first, m_last;
+    Stages       m_stages;
+}; // end fused_range
+
+
+// begins a fused chain of stages over [first, last), whose launches go into stream s
+template<typename Iterator>
+fused_range<Iterator> fused(cudaStream_t s, Iterator first, Iterator last)
+{
+  return fused_range<Iterator>(s, first, last);
+} // end fused()
+
+
+// begins a fused chain of stages over [first, last), whose launches go into the default stream
+template<typename Iterator>
+fused_range<Iterator> fused(Iterator first, Iterator last)
+{
+  return fused_range<Iterator>(0, first, last);
+} // end fused()
+
+
+} // end bulk
+BULK_NAMESPACE_SUFFIX
@@ -20,7 +20,14 @@
 #include <bulk/detail/guarded_cuda_runtime_api.hpp>
 #include <bulk/detail/throw_on_error.hpp>
 #include <bulk/detail/terminate.hpp>
+#include <bulk/detail/stream_pool.hpp>
+#include <bulk/detail/event_pool.hpp>
+#include <bulk/detail/pinned_pool.hpp>
+#include <bulk/detail/stream_capture.hpp>
+#include <bulk/detail/cuda_launcher/runtime_introspection.hpp>
 #include <thrust/detail/swap.h>
+#include <thrust/iterator/iterator_traits.h>
+#include <thrust/memory.h>
 #include <utility>
 #include <stdexcept>
 #include <iostream>
@@ -48,9 +55,13 @@ class future<void>
     __host__ __device__
     ~future()
     {
+#if __BULK_HAS_CUDART__
       if(valid())
       {
-#if __BULK_HAS_CUDART__
+#ifndef __CUDA_ARCH__
+        // recycle the event rather than destroy it
+        bulk::detail::default_event_pool().release(m_device, m_event);
+#else
         // swallow errors
         cudaError_t e = cudaEventDestroy(m_event);
 
@@ -60,33 +71,48 @@ class future<void>
           printf("CUDA error after cudaEventDestroy in future dtor: %s", cudaGetErrorString(e));
         } // end if
 #endif // __BULK_HAS_PRINTF__
+#endif // __CUDA_ARCH__
+      } // end if
 
-        if(m_owns_stream)
-        {
-          e = cudaStreamDestroy(m_stream);
+      // note that a future without an event may still own its stream
+      if(m_owns_stream)
+      {
+#ifndef __CUDA_ARCH__
+        // recycle the stream rather than destroy it
+        bulk::detail::default_stream_pool().release(m_device, m_stream);
+#else
+        // swallow errors
+        cudaError_t e = cudaStreamDestroy(m_stream);
 
 #if __BULK_HAS_PRINTF__
-          if(e)
-          {
-            printf("CUDA error after cudaStreamDestroy in future dtor: %s", cudaGetErrorString(e));
-          } // end if
-#endif // __BULK_HAS_PRINTF__
+        if(e)
+        {
+          printf("CUDA error after cudaStreamDestroy in future dtor: %s", cudaGetErrorString(e));
         } // end if
-#endif
+#endif // __BULK_HAS_PRINTF__
+#endif // __CUDA_ARCH__
       } // end if
+#endif // __BULK_HAS_CUDART__
     } // end ~future()
 
     __host__ __device__
     void wait() const
     {
-      // XXX should probably check for valid() here
+      // there is nothing to wait on for invalid futures,
+      // e.g. those returned by fire_and_forget() launches
+      if(!valid()) return;
 
 #if __BULK_HAS_CUDART__
 
 #ifndef __CUDA_ARCH__
       // XXX need to capture the error as an exception and then throw it in .get()
       bulk::detail::throw_on_error(cudaEventSynchronize(m_event), "cudaEventSynchronize in future::wait");
+#elif defined(CUDART_VERSION) && (CUDART_VERSION >= 12000)
+      // XXX CUDA 12 removed cudaDeviceSynchronize from __device__ code, and events can't be waited on there
+      bulk::detail::terminate_with_message("future::wait(): waiting in __device__ code requires a CUDA runtime older than 12.0");
 #else
+      // there's no way to wait on a single event in __device__ code, so this waits
+      // for every child grid the calling block has launched so far
       // XXX need to capture the error as an exception and then throw it in .get()
       bulk::detail::throw_on_error(cudaDeviceSynchronize(), "cudaDeviceSynchronize in future::wait");
 #endif // __CUDA_ARCH__
@@ -103,20 +129,75 @@ class future<void>
       return m_event != 0;
     } // end valid()
 
+    // then() enqueues a launch of f which begins after this future's work completes
+    // without blocking the host. Unless g names a stream of its own, the continuation
+    // goes into this future's stream and inherits ownership of it.
+    // XXX then() is defined by #including <bulk/async.hpp>
+    template<typename ExecutionGroup, typename Function>
+    __host__ __device__
+    future then(ExecutionGroup g, Function f);
+
+    template<typename ExecutionGroup, typename Function, typename Arg1>
+    __host__ __device__
+    future then(ExecutionGroup g, Function f, Arg1 arg1);
+
+    template<typename ExecutionGroup, typename Function, typename Arg1, typename Arg2>
+    __host__ __device__
+    future then(ExecutionGroup g, Function f, Arg1 arg1, Arg2 arg2);
+
+    template<typename ExecutionGroup, typename Function, typename Arg1, typename Arg2, typename Arg3>
+    __host__ __device__
+    future then(ExecutionGroup g, Function f, Arg1 arg1, Arg2 arg2, Arg3 arg3);
+
+    template<typename ExecutionGroup, typename Function, typename Arg1, typename Arg2, typename Arg3, typename Arg4>
+    __host__ __device__
+    future then(ExecutionGroup g, Function f, Arg1 arg1, Arg2 arg2, Arg3 arg3, Arg4 arg4);
+
+    template<typename ExecutionGroup, typename Function, typename Arg1, typename Arg2, typename Arg3, typename Arg4, typename Arg5>
+    __host__ __device__
+    future then(ExecutionGroup g, Function f, Arg1 arg1, Arg2 arg2, Arg3 arg3, Arg4 arg4, Arg5 arg5);
+
+    template<typename ExecutionGroup, typename Function, typename Arg1, typename Arg2, typename Arg3, typename Arg4, typename Arg5, typename Arg6>
+    __host__ __device__
+    future then(ExecutionGroup g, Function f, Arg1 arg1, Arg2 arg2, Arg3 arg3, Arg4 arg4, Arg5 arg5, Arg6 arg6);
+
+    template<typename ExecutionGroup, typename Function, typename Arg1, typename Arg2, typename Arg3, typename Arg4, typename Arg5, typename Arg6, typename Arg7>
+    __host__ __device__
+    future then(ExecutionGroup g, Function f, Arg1 arg1, Arg2 arg2, Arg3 arg3, Arg4 arg4, Arg5 arg5, Arg6 arg6, Arg7 arg7);
+
+    template<typename ExecutionGroup, typename Function, typename Arg1, typename Arg2, typename Arg3, typename Arg4, typename Arg5, typename Arg6, typename Arg7, typename Arg8>
+    __host__ __device__
+    future then(ExecutionGroup g, Function f, Arg1 arg1, Arg2 arg2, Arg3 arg3, Arg4 arg4, Arg5 arg5, Arg6 arg6, Arg7 arg7, Arg8 arg8);
+
+    template<typename ExecutionGroup, typename Function, typename Arg1, typename Arg2, typename Arg3, typename Arg4, typename Arg5, typename Arg6, typename Arg7, typename Arg8, typename Arg9>
+    __host__ __device__
+    future then(ExecutionGroup g, Function f, Arg1 arg1, Arg2 arg2, Arg3 arg3, Arg4 arg4, Arg5 arg5, Arg6 arg6, Arg7 arg7, Arg8 arg8, Arg9 arg9);
+
+    template<typename ExecutionGroup, typename Function, typename Arg1, typename Arg2, typename Arg3, typename Arg4, typename Arg5, typename Arg6, typename Arg7, typename Arg8, typename Arg9, typename Arg10>
+    __host__ __device__
+    future then(ExecutionGroup g, Function f, Arg1 arg1, Arg2 arg2, Arg3 arg3, Arg4 arg4, Arg5 arg5, Arg6 arg6, Arg7 arg7, Arg8 arg8, Arg9 arg9, Arg10 arg10);
+
+    // then_get() copies the object at ptr to the host after this future's work completes.
+    // The copy goes into this future's stream, and the result inherits ownership of it.
+    template<typename Pointer>
+    __host__
+    future<typename thrust::iterator_value<Pointer>::type> then_get(Pointer ptr);
+
     __host__ __device__
     future()
-      : m_stream(0), m_event(0), m_owns_stream(false)
+      : m_stream(0), m_event(0), m_owns_stream(false), m_device(-1)
     {}
 
     // simulate a move
     // XXX need to add rval_ref or something
     __host__ __device__
     future(const future &other)
-      : m_stream(0), m_event(0), m_owns_stream(false)
+      : m_stream(0), m_event(0), m_owns_stream(false), m_device(-1)
     {
       thrust::swap(m_stream,      const_cast<future&>(other).m_stream);
       thrust::swap(m_event,       const_cast<future&>(other).m_event);
       thrust::swap(m_owns_stream, const_cast<future&>(other).m_owns_stream);
+      thrust::swap(m_device,      const_cast<future&>(other).m_device);
     } // end future()
 
     // simulate a move
@@ -127,6 +208,7 @@ class future<void>
       thrust::swap(m_stream,      const_cast<future&>(other).m_stream);
       thrust::swap(m_event,       const_cast<future&>(other).m_event);
       thrust::swap(m_owns_stream, const_cast<future&>(other).m_owns_stream);
+      thrust::swap(m_device,      const_cast<future&>(other).m_device);
       return *this;
     } // end operator=()
 
@@ -134,22 +216,39 @@ class future<void>
     friend struct detail::future_core_access;
 
     __host__ __device__
-    future(cudaStream_t s, bool owns_stream)
-      : m_stream(s),m_owns_stream(owns_stream)
+    future(cudaStream_t s, bool owns_stream, bool record_event)
+      : m_stream(s),m_event(0),m_owns_stream(owns_stream),m_device(-1)
     {
 #if __BULK_HAS_CUDART__
-      bulk::detail::throw_on_error(cudaEventCreateWithFlags(&m_event, create_flags), "cudaEventCreateWithFlags in future ctor");
-      bulk::detail::throw_on_error(cudaEventRecord(m_event, m_stream), "cudaEventRecord in future ctor");
-#endif
-    } // end future()
+#ifndef __CUDA_ARCH__
+      // remember which device's pools our stream & event return to
+      if(m_owns_stream || record_event)
+      {
+        m_device = bulk::detail::current_device();
+      } // end if
 
-    // XXX this combination makes the constructor expensive
-    //static const int create_flags = cudaEventDisableTiming | cudaEventBlockingSync;
-    static const int create_flags = cudaEventDisableTiming;
+      if(record_event)
+      {
+        m_event = bulk::detail::default_event_pool().acquire(m_device);
+      } // end if
+#else
+      if(record_event)
+      {
+        bulk::detail::throw_on_error(cudaEventCreateWithFlags(&m_event, bulk::detail::event_traits::create_flags), "cudaEventCreateWithFlags in future ctor");
+      } // end if
+#endif // __CUDA_ARCH__
+
+      if(record_event)
+      {
+        bulk::detail::throw_on_error(cudaEventRecord(m_event, m_stream), "cudaEventRecord in future ctor");
+      } // end if
+#endif // __BULK_HAS_CUDART__
+    } // end future()
 
     cudaStream_t m_stream;
     cudaEvent_t m_event;
     bool m_owns_stream;
+    int m_device;
 }; // end future<void>
 
 
@@ -159,10 +258,11 @@ namespace detail
 
 struct future_core_access
 {
+  // when record_event is false, the resulting future is not valid()
   __host__ __device__
-  inline static future<void> create(cudaStream_t s, bool owns_stream)
+  inline static future<void> create(cudaStream_t s, bool owns_stream, bool record_event = true)
   {
-    return future<void>(s, owns_stream);
+    return future<void>(s, owns_stream, record_event);
   } // end create_in_stream()
 
   __host__ __device__
@@ -170,12 +270,265 @@ struct future_core_access
   {
     return f.m_event;
   } // end event()
+
+  __host__ __device__
+  inline static cudaStream_t stream(const future<void> &f)
+  {
+    return f.m_stream;
+  } // end stream()
+
+  template<typename T>
+  inline static future<T> create(future<void> &before, const T *ptr)
+  {
+    return future<T>(before, ptr);
+  } // end create()
+
+  // transfers ownership of from's stream to to
+  __host__ __device__
+  inline static void transfer_stream(future<void> &from, future<void> &to)
+  {
+    if(from.m_owns_stream && from.m_stream == to.m_stream)
+    {
+      to.m_owns_stream   = true;
+      to.m_device        = from.m_device;
+      from.m_owns_stream = false;
+    } // end if
+  } // end transfer_stream()
 }; // end future_core_access
 
 
 } // end detail
 
 
+// future<T> holds a T which arrives asynchronously in page-locked host memory
+// future<T> is only available in __host__ code
+template<typename T>
+class future
+{
+  public:
+    typedef T value_type;
+
+    ~future()
+    {
+      if(m_value)
+      {
+        // the copy may still be in flight, so wait before recycling its destination
+        if(m_ready.valid())
+        {
+          // swallow errors
+          cudaEventSynchronize(detail::future_core_access::event(m_ready));
+        } // end if
+
+        bulk::detail::deallocate_pinned(m_value, sizeof(T));
+      } // end if
+    } // end ~future()
+
+    void wait() const
+    {
+      m_ready.wait();
+    } // end wait()
+
+    // blocks until the value is available and returns it
+    // throws if the future holds no value, e.g. when it is default-constructed or moved from
+    T get() const
+    {
+      if(!valid())
+      {
+        bulk::detail::throw_on_error(cudaErrorInvalidValue, "future::get(): the future holds no value");
+      } // end if
+
+      wait();
+      return *m_value;
+    } // end get()
+
+    bool valid() const
+    {
+      return m_value != 0;
+    } // end valid()
+
+    future()
+      : m_ready(), m_value(0)
+    {}
+
+    // simulate a move
+    // XXX need to add rval_ref or something
+    future(const future &other)
+      : m_ready(other.m_ready), m_value(0)
+    {
+      thrust::swap(m_value, const_cast<future&>(other).m_value);
+    } // end future()
+
+    // simulate a move
+    // XXX need to add rval_ref or something
+    future &operator=(const future &other)
+    {
+      m_ready = other.m_ready;
+      thrust::swap(m_value, const_cast<future&>(other).m_value);
+      return *this;
+    } // end operator=()
+
+    // returns the future<void> which becomes ready along with this future
+    future<void> &ready()
+    {
+      return m_ready;
+    } // end ready()
+
+  private:
+    friend struct detail::future_core_access;
+
+    future(future<void> &before, const T *ptr)
+      : m_ready(), m_value(0)
+    {
+      m_value = static_cast<T*>(bulk::detail::allocate_pinned(sizeof(T)));
+
+      cudaStream_t s = detail::future_core_access::stream(before);
+
+      bulk::detail::throw_on_error(cudaMemcpyAsync(m_value, ptr, sizeof(T), cudaMemcpyDeviceToHost, s), "cudaMemcpyAsync in future<T> ctor");
+
+      m_ready = detail::future_core_access::create(s, false);
+
+      detail::future_core_access::transfer_stream(before, m_ready);
+    } // end future()
+
+    future<void> m_ready;
+    T *m_value;
+}; // end future<T>
+
+
+template<typename Pointer>
+future<typename thrust::iterator_value<Pointer>::type> future<void>::then_get(Pointer ptr)
+{
+  typedef typename thrust::iterator_value<Pointer>::type value_type;
+
+  const value_type *raw_ptr = thrust::raw_pointer_cast(&*ptr);
+
+  return detail::future_core_access::create(*this, raw_ptr);
+} // end future<void>::then_get()
+
+
+namespace detail
+{
+namespace future_detail
+{
+
+
+inline void wait_in_stream(cudaStream_t s, const future<void> &f)
+{
+  if(f.valid())
+  {
+    bulk::detail::throw_on_error(cudaStreamWaitEvent(s, future_core_access::event(f), 0), "cudaStreamWaitEvent in when_all");
+  } // end if
+} // end wait_in_stream()
+
+
+// while bulk::capture() is recording, when_all joins in the capture stream
+inline cudaStream_t acquire_stream()
+{
+  if(bulk::detail::is_capturing())
+  {
+    return bulk::detail::this_thread_capture_stream();
+  } // end if
+
+  return bulk::detail::default_stream_pool().acquire(bulk::detail::current_device());
+} // end acquire_stream()
+
+
+inline future<void> make_when_all_future(cudaStream_t s)
+{
+  // the capture stream does not belong to the pool
+  bool owns_stream = !bulk::detail::is_capturing();
+
+  return future_core_access::create(s, owns_stream);
+} // end make_when_all_future()
+
+
+} // end future_detail
+} // end detail
+
+
+// when_all returns a future which becomes ready once all of its arguments are ready.
+// The arguments are unaffected, and the host never blocks: the result's event
+// is recorded into a pooled stream which waits on each argument's event.
+// when_all is only available in __host__ code.
+template<typename Iterator>
+inline future<void> when_all(Iterator first, Iterator last)
+{
+  cudaStream_t s = detail::future_detail::acquire_stream();
+
+  for(; first != last; ++first)
+  {
+    detail::future_detail::wait_in_stream(s, *first);
+  } // end for
+
+  return detail::future_detail::make_when_all_future(s);
+} // end when_all()
+
+
+inline future<void> when_all(const future<void> &f1, const future<void> &f2)
+{
+  cudaStream_t s = detail::future_detail::acquire_stream();
+
+  detail::future_detail::wait_in_stream(s, f1);
+  detail::future_detail::wait_in_stream(s, f2);
+
+  return detail::future_detail::make_when_all_future(s);
+} // end when_all()
+
+
+inline future<void> when_all(const future<void> &f1, const future<void> &f2, const future<void> &f3)
+{
+  cudaStream_t s = detail::future_detail::acquire_stream();
+
+  detail::future_detail::wait_in_stream(s, f1);
+  detail::future_detail::wait_in_stream(s, f2);
+  detail::future_detail::wait_in_stream(s, f3);
+
+  return detail::future_detail::make_when_all_future(s);
+} // end when_all()
+
+
+inline future<void> when_all(const future<void> &f1, const future<void> &f2, const future<void> &f3, const future<void> &f4)
+{
+  cudaStream_t s = detail::future_detail::acquire_stream();
+
+  detail::future_detail::wait_in_stream(s, f1);
+  detail::future_detail::wait_in_stream(s, f2);
+  detail::future_detail::wait_in_stream(s, f3);
+  detail::future_detail::wait_in_stream(s, f4);
+
+  return detail::future_detail::make_when_all_future(s);
+} // end when_all()
+
+
+inline future<void> when_all(const future<void> &f1, const future<void> &f2, const future<void> &f3, const future<void> &f4, const future<void> &f5)
+{
+  cudaStream_t s = detail::future_detail::acquire_stream();
+
+  detail::future_detail::wait_in_stream(s, f1);
+  detail::future_detail::wait_in_stream(s, f2);
+  detail::future_detail::wait_in_stream(s, f3);
+  detail::future_detail::wait_in_stream(s, f4);
+  detail::future_detail::wait_in_stream(s, f5);
+
+  return detail::future_detail::make_when_all_future(s);
+} // end when_all()
+
+
+inline future<void> when_all(const future<void> &f1, const future<void> &f2, const future<void> &f3, const future<void> &f4, const future<void> &f5, const future<void> &f6)
+{
+  cudaStream_t s = detail::future_detail::acquire_stream();
+
+  detail::future_detail::wait_in_stream(s, f1);
+  detail::future_detail::wait_in_stream(s, f2);
+  detail::future_detail::wait_in_stream(s, f3);
+  detail::future_detail::wait_in_stream(s, f4);
+  detail::future_detail::wait_in_stream(s, f5);
+  detail::future_detail::wait_in_stream(s, f6);
+
+  return detail::future_detail::make_when_all_future(s);
+} // end when_all()
+
+
 } // end namespace bulk
 BULK_NAMESPACE_SUFFIX
 
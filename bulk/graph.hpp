@@ -0,0 +1,279 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/detail/guarded_cuda_runtime_api.hpp>
+#include <bulk/detail/throw_on_error.hpp>
+#include <bulk/detail/terminate.hpp>
+#include <bulk/detail/stream_pool.hpp>
+#include <bulk/detail/stream_capture.hpp>
+#include <bulk/detail/cuda_launcher/runtime_introspection.hpp>
+#include <bulk/future.hpp>
+#include <thrust/detail/swap.h>
+#include <vector>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+namespace detail
+{
+namespace graph_detail
+{
+
+
+#if __BULK_HAS_CUDA_GRAPHS__
+inline void free_allocations(std::vector<void*> &allocations)
+{
+  // swallow errors
+  for(std::vector<void*>::iterator i = allocations.begin(); i != allocations.end(); ++i)
+  {
+    cudaFree(*i);
+  } // end for i
+
+  allocations.clear();
+} // end free_allocations()
+
+
+// records the launches which bulk::async makes on this thread into a captured stream
+// device memory which the recorded launches refer to is appended to allocations
+template<typename Function>
+inline cudaGraph_t capture(Function f, std::vector<void*> &allocations)
+{
+  if(bulk::detail::is_capturing())
+  {
+    bulk::detail::terminate_with_message("bulk::capture(): nested captures are unsupported");
+  } // end if
+
+  int device = bulk::detail::current_device();
+
+  cudaStream_t s = bulk::detail::default_stream_pool().acquire(device);
+
+  // thread-local mode confines the restrictions of capture to this thread
+  bulk::detail::throw_on_error(cudaStreamBeginCapture(s, cudaStreamCaptureModeThreadLocal), "cudaStreamBeginCapture in bulk::capture");
+
+  bulk::detail::this_thread_capture_stream() = s;
+  bulk::detail::this_thread_capture_allocations() = &allocations;
+
+  cudaGraph_t result = 0;
+
+  try
+  {
+    f();
+  } // end try
+  catch(...)
+  {
+    bulk::detail::this_thread_capture_stream() = 0;
+    bulk::detail::this_thread_capture_allocations() = 0;
+    cudaStreamEndCapture(s, &result);
+    if(result) cudaGraphDestroy(result);
+    bulk::detail::default_stream_pool().release(device, s);
+    throw;
+  } // end catch
+
+  bulk::detail::this_thread_capture_stream() = 0;
+  bulk::detail::this_thread_capture_allocations() = 0;
+
+  cudaError_t error = cudaStreamEndCapture(s, &result);
+
+  bulk::detail::default_stream_pool().release(device, s);
+
+  bulk::detail::throw_on_error(error, "cudaStreamEndCapture in bulk::capture");
+
+  return result;
+} // end capture()
+
+
+inline cudaGraphExec_t instantiate(cudaGraph_t g)
+{
+  cudaGraphExec_t result = 0;
+
+#if CUDART_VERSION >= 11040
+  bulk::detail::throw_on_error(cudaGraphInstantiateWithFlags(&result, g, 0), "cudaGraphInstantiateWithFlags in bulk::capture");
+#else
+  bulk::detail::throw_on_error(cudaGraphInstantiate(&result, g, 0, 0, 0), "cudaGraphInstantiate in bulk::capture");
+#endif
+
+  return result;
+} // end instantiate()
+
+
+// returns true if exec could be updated in place to match g
+inline bool update(cudaGraphExec_t exec, cudaGraph_t g)
+{
+#if CUDART_VERSION >= 12000
+  cudaGraphExecUpdateResultInfo info;
+  cudaError_t error = cudaGraphExecUpdate(exec, g, &info);
+#elif CUDART_VERSION >= 10020
+  cudaGraphNode_t error_node;
+  cudaGraphExecUpdateResult info;
+  cudaError_t error = cudaGraphExecUpdate(exec, g, &error_node, &info);
+#else
+  cudaError_t error = cudaErrorNotSupported;
+#endif
+
+  if(error != cudaSuccess)
+  {
+    // clear the error
+    cudaGetLastError();
+    return false;
+  } // end if
+
+  return true;
+} // end update()
+#endif // __BULK_HAS_CUDA_GRAPHS__
+
+
+} // end graph_detail
+} // end detail
+
+
+// graph is a recorded sequence of bulk::async launches which may be replayed
+// with a single launch. graph is only available in __host__ code
+//
+// While bulk::capture(f) runs f, launches which bulk::async would make into the default
+// stream or into a stream of its own are recorded instead of executed.
+//
+// XXX The usual restrictions of stream capture apply to f:
+//     launches may not wait on events recorded outside of the capture,
+//     and f may not synchronize, e.g. through cudaMemcpy or cudaFree
+class graph
+{
+  public:
+    graph()
+      : m_graph(0), m_exec(0)
+    {}
+
+    ~graph()
+    {
+#if __BULK_HAS_CUDA_GRAPHS__
+      // swallow errors
+      if(m_exec)  cudaGraphExecDestroy(m_exec);
+      if(m_graph) cudaGraphDestroy(m_graph);
+      detail::graph_detail::free_allocations(m_allocations);
+#endif
+    } // end ~graph()
+
+    // simulate a move
+    // XXX need to add rval_ref or something
+    graph(const graph &other)
+      : m_graph(0), m_exec(0)
+    {
+      thrust::swap(m_graph, const_cast<graph&>(other).m_graph);
+      thrust::swap(m_exec,  const_cast<graph&>(other).m_exec);
+      m_allocations.swap(const_cast<graph&>(other).m_allocations);
+    } // end graph()
+
+    // simulate a move
+    // XXX need to add rval_ref or something
+    graph &operator=(const graph &other)
+    {
+      thrust::swap(m_graph, const_cast<graph&>(other).m_graph);
+      thrust::swap(m_exec,  const_cast<graph&>(other).m_exec);
+      m_allocations.swap(const_cast<graph&>(other).m_allocations);
+      return *this;
+    } // end operator=()
+
+    bool valid() const
+    {
+      return m_exec != 0;
+    } // end valid()
+
+    // replays the recorded launches in stream s
+    future<void> launch(cudaStream_t s = 0)
+    {
+#if __BULK_HAS_CUDA_GRAPHS__
+      bulk::detail::throw_on_error(cudaGraphLaunch(m_exec, s), "cudaGraphLaunch in graph::launch");
+#else
+      bulk::detail::terminate_with_message("graph::launch(): CUDA graphs require CUDA 10");
+#endif
+
+      return detail::future_core_access::create(s, false);
+    } // end launch()
+
+    // re-records f, whose launches may differ from the original recording in their
+    // arguments (e.g. pointers) but not in their shape. The instantiated graph is
+    // updated in place, which is much cheaper than instantiating a new one.
+    // If the shape has changed, the graph is instantiated again.
+    template<typename Function>
+    void update(Function f)
+    {
+#if __BULK_HAS_CUDA_GRAPHS__
+      std::vector<void*> new_allocations;
+      cudaGraph_t new_graph = 0;
+
+      try
+      {
+        new_graph = detail::graph_detail::capture(f, new_allocations);
+      } // end try
+      catch(...)
+      {
+        detail::graph_detail::free_allocations(new_allocations);
+        throw;
+      } // end catch
+
+      if(m_exec == 0 || !detail::graph_detail::update(m_exec, new_graph))
+      {
+        cudaGraphExec_t new_exec = detail::graph_detail::instantiate(new_graph);
+
+        if(m_exec) cudaGraphExecDestroy(m_exec);
+        m_exec = new_exec;
+      } // end if
+
+      if(m_graph) cudaGraphDestroy(m_graph);
+      m_graph = new_graph;
+
+      // the old allocations may still be in use by a replay in flight, but
+      // cudaFree waits for it
+      detail::graph_detail::free_allocations(m_allocations);
+      m_allocations.swap(new_allocations);
+#else
+      bulk::detail::terminate_with_message("graph::update(): CUDA graphs require CUDA 10");
+#endif
+    } // end update()
+
+  private:
+#if __BULK_HAS_CUDA_GRAPHS__
+    cudaGraph_t     m_graph;
+    cudaGraphExec_t m_exec;
+#else
+    void *m_graph;
+    void *m_exec;
+#endif
+
+    // device memory the recorded launches refer to
+    std::vector<void*> m_allocations;
+}; // end graph
+
+
+// records the launches made by f() into a graph, e.g.
+//
+//   bulk::graph g = bulk::capture(my_sequence);
+//   for(...) g.launch();
+template<typename Function>
+inline graph capture(Function f)
+{
+  graph result;
+  result.update(f);
+  return result;
+} // end capture()
+
+
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
@@ -0,0 +1,84 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/launch_config_cache.hpp>
+#include <bulk/detail/cuda_launcher/heap_profile.hpp>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+
+
+// While heap profiling is enabled, the first launch of each kernel & requested group measures
+// the largest heap its groups allocate through bulk::malloc & bulk::shmalloc. Later launches of
+// that request get the smallest on-chip heap which would have accomodated it, rather than the
+// size the occupancy heuristic would choose, so they neither overflow nor sacrifice occupancy
+// to an oversized heap.
+// XXX the measurement is only a good guide for kernels whose footprint doesn't depend on their inputs
+// These functions are only available in __host__ code.
+
+
+inline void enable_heap_profiling()
+{
+  detail::heap_profile_state &state = detail::heap_profile_global_state();
+  detail::host_lock_guard guard(state.mutex);
+  state.enabled = true;
+} // end enable_heap_profiling()
+
+
+// launches whose profiles were already measured go on using them
+inline void disable_heap_profiling()
+{
+  detail::heap_profile_state &state = detail::heap_profile_global_state();
+  detail::host_lock_guard guard(state.mutex);
+  state.enabled = false;
+} // end disable_heap_profiling()
+
+
+inline bool heap_profiling_enabled()
+{
+  detail::heap_profile_state &state = detail::heap_profile_global_state();
+  detail::host_lock_guard guard(state.mutex);
+  return state.enabled;
+} // end heap_profiling_enabled()
+
+
+// forgets every measured profile, so that the next launch of each request is measured again
+// cached launch configurations chosen from the old profiles are forgotten too
+inline void clear_heap_profiles()
+{
+  {
+    detail::heap_profile_state &state = detail::heap_profile_global_state();
+    detail::host_lock_guard guard(state.mutex);
+
+    ++state.generation;
+
+    // zero-initialized entries belong to generation 0
+    if(state.generation == 0) ++state.generation;
+  } // end guard
+
+  bulk::clear_launch_config_cache();
+} // end clear_heap_profiles()
+
+
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
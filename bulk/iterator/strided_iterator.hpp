@@ -29,12 +29,12 @@ template<typename Iterator,
          typename Size = typename thrust::iterator_difference<Iterator>::type>
 class strided_iterator
   : public thrust::iterator_adaptor<
-      strided_iterator<Iterator>,
+      strided_iterator<Iterator,Size>,
       Iterator
     >
 {
   private:
-    typedef thrust::iterator_adaptor<strided_iterator<Iterator>,Iterator> super_t;
+    typedef thrust::iterator_adaptor<strided_iterator<Iterator,Size>,Iterator> super_t;
 
   public:
     typedef Size stride_type;
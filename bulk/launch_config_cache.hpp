@@ -0,0 +1,79 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/detail/cuda_launcher/launch_config_cache.hpp>
+#include <cstddef>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+
+
+// bulk::async memoizes the attributes of each kernel it launches and the launch
+// configurations it chooses for them, per device. These functions inspect & reset that cache.
+// They are only available in __host__ code.
+
+
+// returns the number of lookups which found a memoized attribute or configuration
+inline std::size_t launch_config_cache_hits()
+{
+  detail::launch_config_cache_state &state = detail::launch_config_cache_global_state();
+  detail::host_lock_guard guard(state.mutex);
+  return state.hits;
+} // end launch_config_cache_hits()
+
+
+// returns the number of lookups which had to query the runtime or the occupancy calculator
+inline std::size_t launch_config_cache_misses()
+{
+  detail::launch_config_cache_state &state = detail::launch_config_cache_global_state();
+  detail::host_lock_guard guard(state.mutex);
+  return state.misses;
+} // end launch_config_cache_misses()
+
+
+// zeroes the hit & miss counters
+inline void reset_launch_config_cache_statistics()
+{
+  detail::launch_config_cache_state &state = detail::launch_config_cache_global_state();
+  detail::host_lock_guard guard(state.mutex);
+  state.hits = 0;
+  state.misses = 0;
+} // end reset_launch_config_cache_statistics()
+
+
+// forgets every memoized attribute & configuration,
+// e.g. after cudaFuncSetCacheConfig or cudaDeviceSetLimit change the outcome
+inline void clear_launch_config_cache()
+{
+  detail::launch_config_cache_state &state = detail::launch_config_cache_global_state();
+  detail::host_lock_guard guard(state.mutex);
+
+  ++state.generation;
+
+  // zero-initialized entries belong to generation 0
+  if(state.generation == 0) ++state.generation;
+} // end clear_launch_config_cache()
+
+
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
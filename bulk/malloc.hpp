@@ -21,6 +21,7 @@
 #include <bulk/detail/alignment.hpp>
 #include <bulk/uninitialized.hpp>
 #include <thrust/detail/config.h>
+#include <thrust/detail/minmax.h>
 #include <cstdlib>
 
 
@@ -51,46 +52,105 @@ namespace detail
 extern __shared__ int s_data_segment_begin[];
 
 
+// os manages the data segment. The program break of the first-fit heap rises from the bottom of
+// the segment, while blocks for small allocations are carved down from the top. Both bounds are
+// packed into a single word in units of 8 bytes, so that they may be moved without a lock.
+// os also records the largest footprint the segment has had to accomodate, including requests which didn't fit.
 class os
 {
   public:
     __device__ inline os(size_t max_data_segment_size)
-      : m_program_break(s_data_segment_begin),
-        m_max_data_segment_size(max_data_segment_size)
+      // the ceiling begins 16-byte aligned, so blocks carved in multiples of 16 bytes stay aligned
+      : m_bounds(pack(0, thrust::min<size_t>(max_data_segment_size / 8, size_t(max_units)) & ~size_t(1))),
+        m_limit(ceiling_of(m_bounds)),
+        m_high_water(0)
     {
     }
 
 
     __device__ inline int brk(void *end_data_segment)
     {
-      if(end_data_segment <= m_program_break)
+      unsigned int new_break = units_from_begin(end_data_segment);
+
+      unsigned int old_bounds = bounds(), assumed;
+      do
       {
-        m_program_break = end_data_segment;
-        return 0;
-      }
+        if(new_break > break_of(old_bounds)) return -1;
 
-      return -1;
+        assumed = old_bounds;
+        old_bounds = atomic_cas(assumed, pack(new_break, ceiling_of(assumed)));
+      } while(old_bounds != assumed);
+
+      return 0;
     }
 
 
     __device__ inline void *sbrk(size_t increment)
     {
-      if(data_segment_size() + increment <= m_max_data_segment_size)
+      unsigned int num_units = increment / 8;
+
+      unsigned int old_bounds = bounds(), assumed;
+      do
       {
-        m_program_break = reinterpret_cast<char*>(m_program_break) + increment;
-      } // end if
-      else
+        // the heap may not grow into the blocks carved from the top
+        if(break_of(old_bounds) + num_units > ceiling_of(old_bounds))
+        {
+          note_footprint(break_of(old_bounds) + num_units + (m_limit - ceiling_of(old_bounds)));
+          return reinterpret_cast<void*>(-1);
+        } // end if
+
+        assumed = old_bounds;
+        old_bounds = atomic_cas(assumed, pack(break_of(assumed) + num_units, ceiling_of(assumed)));
+      } while(old_bounds != assumed);
+
+      note_footprint(break_of(assumed) + num_units + (m_limit - ceiling_of(assumed)));
+
+      return address_of(break_of(assumed) + num_units);
+    }
+
+
+    // lowers the ceiling by size bytes and returns the space below the old ceiling
+    // returns 0 if the space is exhausted
+    __device__ inline void *carve(size_t size)
+    {
+      unsigned int num_units = size / 8;
+
+      unsigned int old_bounds = bounds(), assumed;
+      do
       {
-        return reinterpret_cast<void*>(-1);
-      } // end else
+        if(ceiling_of(old_bounds) < break_of(old_bounds) + num_units)
+        {
+          note_footprint(break_of(old_bounds) + num_units + (m_limit - ceiling_of(old_bounds)));
+          return 0;
+        } // end if
+
+        assumed = old_bounds;
+        old_bounds = atomic_cas(assumed, pack(break_of(assumed), ceiling_of(assumed) - num_units));
+      } while(old_bounds != assumed);
 
-      return m_program_break;
+      note_footprint(break_of(assumed) + num_units + (m_limit - ceiling_of(assumed)));
+
+      return address_of(ceiling_of(assumed) - num_units);
     }
 
 
     __device__ inline void *program_break() const
     {
-      return m_program_break;
+      return address_of(break_of(bounds()));
+    }
+
+
+    // the largest number of bytes the heap & carved blocks have occupied, or would have, had they fit
+    __device__ inline size_t high_water_mark() const
+    {
+      return 8 * size_t(*const_cast<const volatile unsigned int*>(&m_high_water));
+    }
+
+
+    // the ceiling only ever falls, so every address at or above it belongs to a carved block
+    __device__ inline void *ceiling() const
+    {
+      return address_of(ceiling_of(bounds()));
     }
 
     
@@ -100,17 +160,71 @@ class os
     }
 
 
+    // converts between addresses in the data segment and offsets in units of 8 bytes
+    __device__ inline static unsigned int units_from_begin(const void *ptr)
+    {
+      return (reinterpret_cast<const char*>(ptr) - reinterpret_cast<const char*>(s_data_segment_begin)) / 8;
+    }
+
+
+    __device__ inline static void *address_of(unsigned int units)
+    {
+      return reinterpret_cast<char*>(s_data_segment_begin) + 8 * units;
+    }
+
+
   private:
-    __device__ inline size_t data_segment_size()
+    static const unsigned int max_units = 0xffff;
+
+    __device__ inline static unsigned int pack(unsigned int brk, unsigned int ceiling)
     {
-      return reinterpret_cast<char*>(m_program_break) - reinterpret_cast<char*>(s_data_segment_begin);
-    } // end data_segment_size()
+      return brk | (ceiling << 16);
+    }
 
+    __device__ inline static unsigned int break_of(unsigned int bounds)
+    {
+      return bounds & 0xffff;
+    }
 
-    void *m_program_break;
+    __device__ inline static unsigned int ceiling_of(unsigned int bounds)
+    {
+      return bounds >> 16;
+    }
+
+    __device__ inline unsigned int bounds() const
+    {
+      return *const_cast<const volatile unsigned int*>(&m_bounds);
+    }
+
+    __device__ inline unsigned int atomic_cas(unsigned int compare, unsigned int val)
+    {
+#if __CUDA_ARCH__ >= 120
+      return atomicCAS(&m_bounds, compare, val);
+#else
+      // XXX without shared memory atomics, the caller must serialize
+      unsigned int old = m_bounds;
+      if(old == compare) m_bounds = val;
+      return old;
+#endif
+    }
+
+    __device__ inline void note_footprint(unsigned int num_units)
+    {
+#if __CUDA_ARCH__ >= 120
+      atomicMax(&m_high_water, num_units);
+#else
+      // XXX without shared memory atomics, the caller must serialize
+      if(num_units > m_high_water) m_high_water = num_units;
+#endif
+    }
+
+
+    unsigned int m_bounds;
+
+    // the initial ceiling
+    unsigned int m_limit;
 
-    // XXX this can safely be uint32
-    size_t m_max_data_segment_size;
+    unsigned int m_high_water;
 };
 
 
@@ -121,6 +235,12 @@ class singleton_unsafe_on_chip_allocator
     __device__ inline singleton_unsafe_on_chip_allocator(size_t max_data_segment_size)
       : m_os(max_data_segment_size)
     {}
+
+
+    __device__ inline os &get_os()
+    {
+      return m_os;
+    }
   
     __device__ inline void *allocate(size_t size)
     {
@@ -351,6 +471,171 @@ class singleton_unsafe_on_chip_allocator
 }; // end singleton_unsafe_on_chip_allocator
 
 
+// size_class_on_chip_allocator serves small allocations from segregated free lists without a lock.
+// Each size class's blocks are carved from the top of the data segment on demand and
+// are recycled through a lock-free stack when freed.
+// Blocks are 16-byte aligned, like those of the first-fit heap, so they may hold e.g. int4 or float4.
+// XXX carved blocks return to their free list, never to the segment
+class size_class_on_chip_allocator
+{
+  public:
+    static const unsigned int num_size_classes = 5;
+
+    // the largest request served by a size class
+    static const size_t max_size = 16u << (num_size_classes - 1);
+
+
+    __device__ inline size_class_on_chip_allocator()
+    {
+      for(unsigned int i = 0; i < num_size_classes; ++i)
+      {
+        m_free_lists[i] = 0;
+      } // end for i
+    }
+
+
+    // returns 0 if the data segment is exhausted
+    __device__ inline void *allocate(os &o, size_t size)
+    {
+      unsigned int size_class = size_class_of(size);
+
+      header *h = pop(size_class);
+
+      if(h == 0)
+      {
+        void *ptr = o.carve(sizeof(header) + size_of(size_class));
+
+        if(ptr == 0) return 0;
+
+        h = reinterpret_cast<header*>(ptr);
+        on_chip_cast(h)->size_class = size_class;
+      } // end if
+
+      return h->data();
+    }
+
+
+    __device__ inline void deallocate(void *ptr)
+    {
+      header *h = get_header(ptr);
+
+      push(on_chip_cast(h)->size_class, h);
+    }
+
+
+  private:
+    // 16 bytes precede each block's data, so that its data is as aligned as the block
+    struct header
+    {
+      unsigned int size_class;
+
+      // while the block is free, the free list link lives in the first word of its data
+      unsigned int unused[3];
+
+      __device__ inline void *data()
+      {
+        return reinterpret_cast<char*>(this) + sizeof(header);
+      }
+
+      __device__ inline volatile unsigned int &next()
+      {
+        return *reinterpret_cast<volatile unsigned int*>(data());
+      }
+    };
+
+
+    __device__ inline static header *get_header(void *data)
+    {
+      return reinterpret_cast<header*>(reinterpret_cast<char*>(data) - sizeof(header));
+    }
+
+
+    __device__ inline static unsigned int size_class_of(size_t size)
+    {
+      // the smallest class whose size is at least size
+      unsigned int num_units_less_one = (size - 1) >> 4;
+      return size <= 16 ? 0 : 32 - __clz(num_units_less_one);
+    }
+
+
+    __device__ inline static size_t size_of(unsigned int size_class)
+    {
+      return 16u << size_class;
+    }
+
+
+    // a free list's head packs the position of the top block, plus one, with a tag
+    // which changes with every push & pop, so that a stale head never compares equal
+    __device__ inline static unsigned int next_tag(unsigned int head)
+    {
+      return (head + 0x10000) & 0xffff0000;
+    }
+
+
+    __device__ inline header *pop(unsigned int size_class)
+    {
+      unsigned int *head_ptr = &m_free_lists[size_class];
+
+      unsigned int old_head = *const_cast<volatile unsigned int*>(head_ptr), assumed;
+      header *h;
+      do
+      {
+        unsigned int top = old_head & 0xffff;
+
+        if(top == 0) return 0;
+
+        h = reinterpret_cast<header*>(os::address_of(top - 1));
+
+        // if another thread pops h first, next is garbage, but the tag causes the CAS to fail
+        unsigned int new_head = h->next() | next_tag(old_head);
+
+        assumed = old_head;
+        old_head = atomic_cas(head_ptr, assumed, new_head);
+      } while(old_head != assumed);
+
+      return h;
+    }
+
+
+    __device__ inline void push(unsigned int size_class, header *h)
+    {
+      unsigned int *head_ptr = &m_free_lists[size_class];
+
+      unsigned int position = os::units_from_begin(h) + 1;
+
+      unsigned int old_head = *const_cast<volatile unsigned int*>(head_ptr), assumed;
+      do
+      {
+        h->next() = old_head & 0xffff;
+
+        // publish the link before the head
+        __threadfence_block();
+
+        assumed = old_head;
+        old_head = atomic_cas(head_ptr, assumed, position | next_tag(assumed));
+      } while(old_head != assumed);
+    }
+
+
+    __device__ inline static unsigned int atomic_cas(unsigned int *address, unsigned int compare, unsigned int val)
+    {
+#if __CUDA_ARCH__ >= 120
+      return atomicCAS(address, compare, val);
+#else
+      // XXX without shared memory atomics, the caller must serialize
+      unsigned int old = *address;
+      if(old == compare) *address = val;
+      return old;
+#endif
+    }
+
+
+    unsigned int m_free_lists[num_size_classes];
+}; // end size_class_on_chip_allocator
+
+
+// singleton_on_chip_allocator serves small requests from size classes without a lock.
+// Only larger requests serialize on a mutex to use the first-fit heap.
 class singleton_on_chip_allocator
 {
   public:
@@ -363,13 +648,19 @@ class singleton_on_chip_allocator
 #endif
     singleton_on_chip_allocator(size_t max_data_segment_size)
       : m_mutex(),
-        m_alloc(max_data_segment_size)
+        m_alloc(max_data_segment_size),
+        m_small_alloc()
     {}
 
 
     inline __device__
     void *unsafe_allocate(size_t size)
     {
+      if(size <= size_class_on_chip_allocator::max_size)
+      {
+        return m_small_alloc.allocate(m_alloc.get_os(), size);
+      } // end if
+
       return m_alloc.allocate(size);
     }
 
@@ -377,11 +668,16 @@ class singleton_on_chip_allocator
     inline __device__
     void *allocate(size_t size)
     {
+      if(size <= size_class_on_chip_allocator::max_size)
+      {
+        return m_small_alloc.allocate(m_alloc.get_os(), size);
+      } // end if
+
       void *result;
 
       m_mutex.lock();
       {
-        result = unsafe_allocate(size);
+        result = m_alloc.allocate(size);
       } // end critical section
       m_mutex.unlock();
 
@@ -392,22 +688,51 @@ class singleton_on_chip_allocator
     inline __device__
     void unsafe_deallocate(void *ptr)
     {
-      m_alloc.deallocate(ptr);
+      if(is_small(ptr))
+      {
+        m_small_alloc.deallocate(ptr);
+      } // end if
+      else
+      {
+        m_alloc.deallocate(ptr);
+      } // end else
     } // end unsafe_deallocate()
 
 
     inline __device__
     void deallocate(void *ptr)
     {
+      if(ptr == 0) return;
+
+      if(is_small(ptr))
+      {
+        m_small_alloc.deallocate(ptr);
+        return;
+      } // end if
+
       m_mutex.lock();
       {
-        unsafe_deallocate(ptr);
+        m_alloc.deallocate(ptr);
       } // end critical section
       m_mutex.unlock();
     } // end deallocate()
 
 
+    inline __device__
+    size_t high_water_mark()
+    {
+      return m_alloc.get_os().high_water_mark();
+    } // end high_water_mark()
+
+
   private:
+    inline __device__
+    bool is_small(void *ptr)
+    {
+      return ptr != 0 && on_chip_cast(ptr) >= m_alloc.get_os().ceiling();
+    } // end is_small()
+
+
     class mutex
     {
       public:
@@ -453,6 +778,7 @@ class singleton_on_chip_allocator
 
     mutex m_mutex;
     singleton_unsafe_on_chip_allocator m_alloc;
+    size_class_on_chip_allocator m_small_alloc;
 }; // end singleton_on_chip_allocator
 
 
@@ -497,6 +823,272 @@ inline __device__ void unsafe_on_chip_free(void *ptr)
 } // end unsafe_on_chip_free()
 
 
+// the number of bytes of on-chip heap which this CTA's allocations so far would have required to avoid overflow
+inline __device__ size_t on_chip_heap_high_water_mark()
+{
+  return s_on_chip_allocator.get().high_water_mark();
+} // end on_chip_heap_high_water_mark()
+
+
+// global_arena describes global memory reserved by a launch for the groups whose
+// on-chip heaps overflow. The storage is partitioned into num_slots slots of slot_size bytes,
+// which is enough for every group which may be resident at once, and each group claims one
+// for its lifetime through the in_use flags.
+struct global_arena
+{
+  char         *storage;
+  unsigned int *in_use;
+  unsigned int num_slots;
+  unsigned int slot_size;
+}; // end global_arena
+
+
+inline __host__ __device__
+global_arena make_global_arena(void *storage, unsigned int num_slots, unsigned int slot_size)
+{
+  // the flags follow the slots
+  global_arena result = {reinterpret_cast<char*>(storage), 0, num_slots, slot_size};
+  result.in_use = reinterpret_cast<unsigned int*>(result.storage + num_slots * slot_size);
+
+  return result;
+} // end make_global_arena()
+
+
+inline __host__ __device__
+global_arena make_global_arena()
+{
+  return make_global_arena(0, 0, 0);
+} // end make_global_arena()
+
+
+// the number of bytes a global_arena of num_slots slots of slot_size bytes occupies
+inline __host__ __device__
+size_t global_arena_storage_size(unsigned int num_slots, unsigned int slot_size)
+{
+  return size_t(num_slots) * (slot_size + sizeof(unsigned int));
+} // end global_arena_storage_size()
+
+
+// singleton_global_arena_allocator bump allocates from a group's slot of a global_arena.
+// Only one instance of this class can logically exist per CTA.
+// XXX memory deallocated through the thread-safe interface is only reclaimed when the group exits
+//     and the unsafe interface mustn't be used concurrently with it
+class singleton_global_arena_allocator
+{
+  public:
+    // claims a slot of arena, beginning the search at slot hint
+    // this must be called by a single thread
+    __device__ inline singleton_global_arena_allocator(global_arena arena, unsigned int hint)
+      : m_begin(0),
+        m_in_use(0),
+        m_size(0),
+        m_break(0),
+        m_num_live(0)
+    {
+#if __CUDA_ARCH__ >= 200
+      if(arena.num_slots > 0)
+      {
+        // there are as many slots as resident groups, so this terminates
+        for(unsigned int i = hint % arena.num_slots; ; i = (i + 1) % arena.num_slots)
+        {
+          if(atomicCAS(&arena.in_use[i], 0u, 1u) == 0u)
+          {
+            m_begin  = arena.storage + i * arena.slot_size;
+            m_in_use = &arena.in_use[i];
+            m_size   = arena.slot_size;
+            break;
+          } // end if
+        } // end for i
+      } // end if
+#endif
+    }
+
+
+    // returns the slot to the arena
+    // this must be called by a single thread after the group's last use of the arena
+    __device__ inline void release()
+    {
+#if __CUDA_ARCH__ >= 200
+      if(m_in_use)
+      {
+        // the group's writes to the slot must be visible to its next owner
+        __threadfence();
+        atomicExch(m_in_use, 0u);
+      } // end if
+#endif
+    }
+
+
+    __device__ inline bool contains(void *ptr) const
+    {
+      return m_begin <= ptr && ptr < m_begin + m_size;
+    }
+
+
+    // returns 0 if the slot is exhausted
+    __device__ inline void *allocate(size_t size)
+    {
+#if __CUDA_ARCH__ >= 200
+      if(m_size == 0) return 0;
+
+      unsigned int aligned_size = align16(size);
+
+      atomicAdd(&m_num_live, 1u);
+
+      unsigned int offset = atomicAdd(&m_break, aligned_size);
+
+      if(aligned_size > m_size || offset > m_size - aligned_size)
+      {
+        // the failed bump isn't undone, so later requests overflow too, until the slot drains
+        atomicSub(&m_num_live, 1u);
+        return 0;
+      } // end if
+
+      return m_begin + offset;
+#else
+      return 0;
+#endif
+    }
+
+
+    __device__ inline void *unsafe_allocate(size_t size)
+    {
+      if(m_size == 0) return 0;
+
+      unsigned int aligned_size = align16(size);
+
+      if(aligned_size > m_size || m_break > m_size - aligned_size) return 0;
+
+      void *result = m_begin + m_break;
+
+      m_break += aligned_size;
+      ++m_num_live;
+
+      return result;
+    }
+
+
+    __device__ inline void deallocate(void *)
+    {
+#if __CUDA_ARCH__ >= 200
+      atomicSub(&m_num_live, 1u);
+#endif
+    }
+
+
+    __device__ inline void unsafe_deallocate(void *)
+    {
+      // once nothing is live, the slot may be reused from the beginning
+      if(--m_num_live == 0)
+      {
+        m_break = 0;
+      } // end if
+    }
+
+
+  private:
+    __device__ inline static unsigned int align16(size_t size)
+    {
+      return (size + 15) & ~size_t(15);
+    }
+
+    char         *m_begin;
+    unsigned int *m_in_use;
+    unsigned int m_size;
+    unsigned int m_break;
+    unsigned int m_num_live;
+}; // end singleton_global_arena_allocator
+
+
+namespace
+{
+
+__shared__ uninitialized<singleton_global_arena_allocator> s_global_arena_allocator;
+
+} // end anon namespace
+
+
+// called by a single thread of each group before the group's first shmalloc
+inline __device__ void init_global_arena_malloc(global_arena arena, unsigned int hint)
+{
+  s_global_arena_allocator.construct(arena, hint);
+} // end init_global_arena_malloc()
+
+
+// called by a single thread of each group after the group's last shfree
+inline __device__ void finalize_global_arena_malloc()
+{
+  s_global_arena_allocator.get().release();
+} // end finalize_global_arena_malloc()
+
+
+inline __device__ bool is_in_global_arena(void *ptr)
+{
+  return s_global_arena_allocator.get().contains(ptr);
+} // end is_in_global_arena()
+
+
+// shmalloc's overflow path: the group's slot of the launch's arena, then the device heap
+inline __device__ void *global_malloc(size_t num_bytes)
+{
+  void *result = s_global_arena_allocator.get().allocate(num_bytes);
+
+#if __CUDA_ARCH__ >= 200
+  if(!result)
+  {
+    result = std::malloc(num_bytes);
+  } // end if
+#endif
+
+  return result;
+} // end global_malloc()
+
+
+inline __device__ void *unsafe_global_malloc(size_t num_bytes)
+{
+  void *result = s_global_arena_allocator.get().unsafe_allocate(num_bytes);
+
+#if __CUDA_ARCH__ >= 200
+  if(!result)
+  {
+    result = std::malloc(num_bytes);
+  } // end if
+#endif
+
+  return result;
+} // end unsafe_global_malloc()
+
+
+inline __device__ void global_free(void *ptr)
+{
+  if(is_in_global_arena(ptr))
+  {
+    s_global_arena_allocator.get().deallocate(ptr);
+  } // end if
+#if __CUDA_ARCH__ >= 200
+  else
+  {
+    std::free(ptr);
+  } // end else
+#endif
+} // end global_free()
+
+
+inline __device__ void unsafe_global_free(void *ptr)
+{
+  if(is_in_global_arena(ptr))
+  {
+    s_global_arena_allocator.get().unsafe_deallocate(ptr);
+  } // end if
+#if __CUDA_ARCH__ >= 200
+  else
+  {
+    std::free(ptr);
+  } // end else
+#endif
+} // end unsafe_global_free()
+
+
 } // end detail
 
 
@@ -508,7 +1100,7 @@ inline __device__ void *shmalloc(size_t num_bytes)
 #if __CUDA_ARCH__ >= 200
   if(!result)
   {
-    result = std::malloc(num_bytes);
+    result = detail::global_malloc(num_bytes);
   } // end if
 #endif // __CUDA_ARCH__
 
@@ -524,7 +1116,7 @@ inline __device__ void *unsafe_shmalloc(size_t num_bytes)
 #if __CUDA_ARCH__ >= 200
   if(!result)
   {
-    result = std::malloc(num_bytes);
+    result = detail::unsafe_global_malloc(num_bytes);
   } // end if
 #endif // __CUDA_ARCH__
 
@@ -541,7 +1133,7 @@ inline __device__ void shfree(void *ptr)
   } // end if
   else
   {
-    std::free(ptr);
+    bulk::detail::global_free(ptr);
   } // end else
 #else
   bulk::detail::on_chip_free(bulk::on_chip_cast(ptr));
@@ -558,7 +1150,7 @@ inline __device__ void unsafe_shfree(void *ptr)
   } // end if
   else
   {
-    std::free(ptr);
+    bulk::detail::unsafe_global_free(ptr);
   } // end else
 #else
   bulk::detail::unsafe_on_chip_free(bulk::on_chip_cast(ptr));
@@ -600,6 +1192,35 @@ inline void free(ConcurrentGroup &g, void *ptr)
 } // end free()
 
 
+namespace detail
+{
+
+
+// like bulk::malloc, but without the overflow into global memory,
+// so the result is null when num_bytes doesn't fit in the group's on-chip heap
+// the result may be returned with bulk::free
+template<typename ConcurrentGroup>
+__device__
+inline void *group_on_chip_malloc(ConcurrentGroup &g, size_t num_bytes)
+{
+  __shared__ void *s_result;
+
+  g.wait();
+
+  if(g.this_exec.index() == 0)
+  {
+    s_result = (num_bytes > 0) ? bulk::detail::unsafe_on_chip_malloc(num_bytes) : 0;
+  } // end if
+
+  g.wait();
+
+  return s_result;
+} // end group_on_chip_malloc()
+
+
+} // end detail
+
+
 } // end namespace bulk
 BULK_NAMESPACE_SUFFIX
 
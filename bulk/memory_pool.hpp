@@ -0,0 +1,436 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/detail/guarded_cuda_runtime_api.hpp>
+#include <bulk/detail/throw_on_error.hpp>
+#include <bulk/detail/terminate.hpp>
+#include <bulk/detail/host_mutex.hpp>
+#include <bulk/detail/event_pool.hpp>
+#include <bulk/detail/stream_capture.hpp>
+#include <bulk/detail/cuda_launcher/runtime_introspection.hpp>
+#include <map>
+#include <vector>
+#include <utility>
+#include <cstddef>
+#include <cstring>
+
+
+// cudaMallocFromPoolAsync arrived with CUDA 11.2
+#if defined(CUDART_VERSION) && (CUDART_VERSION >= 11020)
+#  define __BULK_HAS_STREAM_ORDERED_ALLOCATOR__ 1
+#else
+#  define __BULK_HAS_STREAM_ORDERED_ALLOCATOR__ 0
+#endif
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+
+
+// memory_pool hands out device memory in stream order, so that the scratch of multi-pass
+// algorithms need not be cudaMalloc'd and cudaFree'd (which synchronizes the device) on every call
+//
+// memory deallocated in a stream may be used by work enqueued in that stream immediately,
+// and by other streams once the work enqueued before the deallocation completes
+//
+// where the runtime & device support it, allocations come from a cudaMemPool_t which never
+// trims itself; otherwise, blocks are rounded up to powers of two and cached here
+// either way, steady-state allocations don't reach the driver
+//
+// memory_pool is only usable from __host__ code
+class memory_pool
+{
+  public:
+    // only pool memory for the first few devices
+    static const int max_num_devices = 16;
+
+    // cached blocks are no smaller than this
+    static const std::size_t min_block_size = 512;
+
+    memory_pool()
+    {
+      for(int i = 0; i < max_num_devices; ++i)
+      {
+        m_checked_stream_ordered[i] = false;
+#if __BULK_HAS_STREAM_ORDERED_ALLOCATOR__
+        m_stream_ordered_pools[i] = 0;
+#endif
+      } // end for i
+    } // end memory_pool()
+
+    ~memory_pool()
+    {
+      // swallow errors -- the runtime may already be shutting down
+      for(block_map::iterator b = m_idle.begin(); b != m_idle.end(); ++b)
+      {
+        cudaEventSynchronize(b->second.ready);
+        cudaFree(b->second.ptr);
+        cudaEventDestroy(b->second.ready);
+      } // end for b
+
+#if __BULK_HAS_STREAM_ORDERED_ALLOCATOR__
+      for(int i = 0; i < max_num_devices; ++i)
+      {
+        if(m_stream_ordered_pools[i]) cudaMemPoolDestroy(m_stream_ordered_pools[i]);
+      } // end for i
+#endif
+    } // end ~memory_pool()
+
+    // returns num_bytes of memory on the current device which work enqueued in s after this call may use
+    void *allocate(std::size_t num_bytes, cudaStream_t s = 0)
+    {
+      if(num_bytes == 0) return 0;
+
+      int device = bulk::detail::current_device();
+
+#if __BULK_HAS_STREAM_ORDERED_ALLOCATOR__
+      if(cudaMemPool_t pool = stream_ordered_pool(device))
+      {
+        void *result = 0;
+        bulk::detail::throw_on_error(cudaMallocFromPoolAsync(&result, num_bytes, pool, s), "memory_pool::allocate(): after cudaMallocFromPoolAsync");
+
+        block b = {result, num_bytes, device, s, 0, true};
+
+        bulk::detail::host_lock_guard guard(m_mutex);
+        m_in_use[result] = b;
+
+        return result;
+      } // end if
+#endif
+
+      std::size_t size = block_size(num_bytes);
+
+      {
+        bulk::detail::host_lock_guard guard(m_mutex);
+
+        std::pair<block_map::iterator,block_map::iterator> candidates = m_idle.equal_range(std::make_pair(device, size));
+
+        for(block_map::iterator i = candidates.first; i != candidates.second; ++i)
+        {
+          // a block last used in s is ready in stream order, others must wait for their event
+          if(i->second.stream == s || cudaEventQuery(i->second.ready) == cudaSuccess)
+          {
+            block b = i->second;
+            m_idle.erase(i);
+
+            bulk::detail::default_event_pool().release(device, b.ready);
+            b.ready = 0;
+            b.stream = s;
+
+            m_in_use[b.ptr] = b;
+
+            return b.ptr;
+          } // end if
+        } // end for i
+      } // end guard
+
+      void *result = 0;
+      cudaError_t error = cudaMalloc(&result, size);
+
+      if(error == cudaErrorMemoryAllocation)
+      {
+        // clear the error, give back what's cached, and try again
+        cudaGetLastError();
+        trim();
+
+        error = cudaMalloc(&result, size);
+      } // end if
+
+      bulk::detail::throw_on_error(error, "memory_pool::allocate(): after cudaMalloc");
+
+      block b = {result, size, device, s, 0, false};
+
+      bulk::detail::host_lock_guard guard(m_mutex);
+      m_in_use[result] = b;
+
+      return result;
+    } // end allocate()
+
+    // returns ptr, previously allocated from this pool, to the pool
+    // work enqueued in s before this call may still use ptr
+    // ptr's device must be the current device
+    void deallocate(void *ptr, cudaStream_t s = 0)
+    {
+      if(ptr == 0) return;
+
+      bulk::detail::host_lock_guard guard(m_mutex);
+
+      std::map<void*,block>::iterator i = m_in_use.find(ptr);
+
+      if(i == m_in_use.end())
+      {
+        bulk::detail::terminate_with_message("memory_pool::deallocate(): ptr was not allocated from this pool");
+      } // end if
+
+      block b = i->second;
+      m_in_use.erase(i);
+
+#if __BULK_HAS_STREAM_ORDERED_ALLOCATOR__
+      if(b.stream_ordered)
+      {
+        bulk::detail::terminate_on_error(cudaFreeAsync(ptr, s), "memory_pool::deallocate(): after cudaFreeAsync");
+        return;
+      } // end if
+#endif
+
+      b.stream = s;
+      b.ready  = bulk::detail::default_event_pool().acquire(b.device);
+
+      bulk::detail::terminate_on_error(cudaEventRecord(b.ready, s), "memory_pool::deallocate(): after cudaEventRecord");
+
+      m_idle.insert(std::make_pair(std::make_pair(b.device, b.size), b));
+    } // end deallocate()
+
+    // frees the cached blocks which are no longer in use by any stream
+    void trim()
+    {
+      bulk::detail::host_lock_guard guard(m_mutex);
+
+      for(block_map::iterator i = m_idle.begin(); i != m_idle.end();)
+      {
+        if(cudaEventQuery(i->second.ready) == cudaSuccess)
+        {
+          // swallow errors
+          cudaFree(i->second.ptr);
+          bulk::detail::default_event_pool().release(i->second.device, i->second.ready);
+
+          m_idle.erase(i++);
+        } // end if
+        else
+        {
+          ++i;
+        } // end else
+      } // end for i
+
+#if __BULK_HAS_STREAM_ORDERED_ALLOCATOR__
+      for(int device = 0; device < max_num_devices; ++device)
+      {
+        if(m_stream_ordered_pools[device])
+        {
+          cudaMemPoolTrimTo(m_stream_ordered_pools[device], 0);
+        } // end if
+      } // end for device
+#endif
+    } // end trim()
+
+    // the number of bytes of cached blocks awaiting reuse
+    std::size_t num_bytes_idle() const
+    {
+      bulk::detail::host_lock_guard guard(m_mutex);
+
+      std::size_t result = 0;
+      for(block_map::const_iterator i = m_idle.begin(); i != m_idle.end(); ++i)
+      {
+        result += i->second.size;
+      } // end for i
+
+      return result;
+    } // end num_bytes_idle()
+
+    // the number of bytes currently allocated from this pool
+    std::size_t num_bytes_in_use() const
+    {
+      bulk::detail::host_lock_guard guard(m_mutex);
+
+      std::size_t result = 0;
+      for(std::map<void*,block>::const_iterator i = m_in_use.begin(); i != m_in_use.end(); ++i)
+      {
+        result += i->second.size;
+      } // end for i
+
+      return result;
+    } // end num_bytes_in_use()
+
+  private:
+    // noncopyable
+    memory_pool(const memory_pool &);
+    memory_pool &operator=(const memory_pool &);
+
+    struct block
+    {
+      void         *ptr;
+      std::size_t  size;
+      int          device;
+
+      // the stream in which the block was last used
+      cudaStream_t stream;
+
+      // recorded in stream when the block was deallocated
+      cudaEvent_t  ready;
+
+      bool         stream_ordered;
+    }; // end block
+
+    // idle blocks are keyed by device & size
+    typedef std::multimap<std::pair<int,std::size_t>, block> block_map;
+
+    static std::size_t block_size(std::size_t num_bytes)
+    {
+      std::size_t result = min_block_size;
+
+      while(result < num_bytes)
+      {
+        result += result;
+      } // end while
+
+      return result;
+    } // end block_size()
+
+#if __BULK_HAS_STREAM_ORDERED_ALLOCATOR__
+    // returns the device's cudaMemPool_t, or 0 if the device doesn't support one
+    cudaMemPool_t stream_ordered_pool(int device)
+    {
+      if(device < 0 || device >= max_num_devices) return 0;
+
+      bulk::detail::host_lock_guard guard(m_mutex);
+
+      if(!m_checked_stream_ordered[device])
+      {
+        m_checked_stream_ordered[device] = true;
+
+        int supported = 0;
+        if(cudaDeviceGetAttribute(&supported, cudaDevAttrMemoryPoolsSupported, device) != cudaSuccess)
+        {
+          // clear the error
+          cudaGetLastError();
+          supported = 0;
+        } // end if
+
+        if(supported)
+        {
+          cudaMemPoolProps props;
+          std::memset(&props, 0, sizeof(props));
+          props.allocType     = cudaMemAllocationTypePinned;
+          props.location.type = cudaMemLocationTypeDevice;
+          props.location.id   = device;
+
+          bulk::detail::throw_on_error(cudaMemPoolCreate(&m_stream_ordered_pools[device], &props), "memory_pool: after cudaMemPoolCreate");
+
+          // keep freed memory in the pool rather than returning it to the driver at each synchronization
+          cuuint64_t threshold = ~cuuint64_t(0);
+          bulk::detail::throw_on_error(cudaMemPoolSetAttribute(m_stream_ordered_pools[device], cudaMemPoolAttrReleaseThreshold, &threshold), "memory_pool: after cudaMemPoolSetAttribute");
+        } // end if
+      } // end if
+
+      return m_stream_ordered_pools[device];
+    } // end stream_ordered_pool()
+#endif
+
+    mutable bulk::detail::host_mutex m_mutex;
+    block_map                        m_idle;
+    std::map<void*,block>            m_in_use;
+    bool                             m_checked_stream_ordered[max_num_devices];
+#if __BULK_HAS_STREAM_ORDERED_ALLOCATOR__
+    cudaMemPool_t                    m_stream_ordered_pools[max_num_devices];
+#endif
+}; // end memory_pool
+
+
+// the pool from which bulk's device-wide algorithms draw their scratch
+// XXX see the note on host singletons in bulk/detail/config.hpp
+inline memory_pool &default_memory_pool()
+{
+  static memory_pool pool;
+  return pool;
+} // end default_memory_pool()
+
+
+// temporary_buffer is n elements of T drawn from a memory_pool for use in stream s
+// its memory is returned to the pool in s upon destruction, so work which s has yet
+// to execute may go on using it
+// while recording with bulk::capture, the memory is instead kept alive by the graph
+// the elements are uninitialized
+template<typename T>
+class temporary_buffer
+{
+  public:
+    typedef T           value_type;
+    typedef T*          pointer;
+    typedef std::size_t size_type;
+
+    explicit temporary_buffer(size_type n, cudaStream_t s = 0, memory_pool &pool = bulk::default_memory_pool())
+      : m_pool(&pool),
+        m_stream(bulk::detail::capture_aware_stream(s)),
+        m_data(0),
+        m_size(n)
+    {
+      std::vector<void*> *captured = bulk::detail::this_thread_capture_allocations();
+
+      if(captured && n > 0)
+      {
+        // while capturing, the memory must outlive every replay of the graph, so the graph owns it
+        m_pool = 0;
+        m_data = static_cast<pointer>(bulk::detail::capture_malloc(n * sizeof(T)));
+      } // end if
+      else
+      {
+        m_data = static_cast<pointer>(pool.allocate(n * sizeof(T), m_stream));
+      } // end else
+    } // end temporary_buffer()
+
+    ~temporary_buffer()
+    {
+      if(m_pool)
+      {
+        m_pool->deallocate(m_data, m_stream);
+      } // end if
+    } // end ~temporary_buffer()
+
+    pointer data() const
+    {
+      return m_data;
+    } // end data()
+
+    pointer begin() const
+    {
+      return m_data;
+    } // end begin()
+
+    pointer end() const
+    {
+      return m_data + m_size;
+    } // end end()
+
+    size_type size() const
+    {
+      return m_size;
+    } // end size()
+
+    cudaStream_t stream() const
+    {
+      return m_stream;
+    } // end stream()
+
+  private:
+    // noncopyable
+    temporary_buffer(const temporary_buffer &);
+    temporary_buffer &operator=(const temporary_buffer &);
+
+    memory_pool  *m_pool;
+    cudaStream_t m_stream;
+    pointer      m_data;
+    size_type    m_size;
+}; // end temporary_buffer
+
+
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
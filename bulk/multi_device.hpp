@@ -0,0 +1,226 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/execution_policy.hpp>
+#include <bulk/detail/guarded_cuda_runtime_api.hpp>
+#include <bulk/detail/throw_on_error.hpp>
+#include <bulk/detail/terminate.hpp>
+#include <bulk/detail/cuda_launcher/runtime_introspection.hpp>
+#include <thrust/pair.h>
+#include <thrust/detail/minmax.h>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+namespace detail
+{
+namespace multi_device_detail
+{
+
+
+static const int max_num_devices = 16;
+
+
+inline bool can_access_peer(int device, int peer)
+{
+  int result = 0;
+  bulk::detail::throw_on_error(cudaDeviceCanAccessPeer(&result, device, peer), "cudaDeviceCanAccessPeer in bulk::multi_device");
+  return result != 0;
+} // end can_access_peer()
+
+
+// orders devices so that neighbors in the order are peers where possible
+// this way, work on neighboring partitions, which tend to communicate, e.g. the carries of a scan,
+// may do so over peer-to-peer links
+inline void peer_order(int *first, int *last)
+{
+  for(; first != last && first + 1 != last; ++first)
+  {
+    // find the first remaining device which is a peer of *first
+    for(int *candidate = first + 1; candidate != last; ++candidate)
+    {
+      if(can_access_peer(*first, *candidate))
+      {
+        int temp = first[1];
+        first[1] = *candidate;
+        *candidate = temp;
+
+        break;
+      } // end if
+    } // end for candidate
+  } // end for first
+} // end peer_order()
+
+
+inline int num_devices()
+{
+  int result = 0;
+  bulk::detail::throw_on_error(cudaGetDeviceCount(&result), "cudaGetDeviceCount in bulk::multi_device");
+  return result;
+} // end num_devices()
+
+
+} // end multi_device_detail
+} // end detail
+
+
+// multi_device_launch describes a launch of a grid whose groups are shared among several devices.
+// Each device executes a contiguous range of the grid's groups in proportion to its number of
+// multiprocessors. Groups retain their indices within the entire grid.
+// multi_device_launch is only available in __host__ code.
+template<typename ExecutionGroup>
+class multi_device_launch
+{
+  public:
+    static const int max_num_devices = detail::multi_device_detail::max_num_devices;
+
+    template<typename Iterator>
+    multi_device_launch(ExecutionGroup exec, Iterator first_device, Iterator last_device)
+      : m_exec(exec), m_num_devices(0)
+    {
+      m_weights[0] = 0;
+
+      for(; first_device != last_device && m_num_devices < max_num_devices; ++first_device, ++m_num_devices)
+      {
+        m_devices[m_num_devices] = *first_device;
+
+        m_weights[m_num_devices + 1] = m_weights[m_num_devices] + bulk::detail::device_properties(*first_device).multiProcessorCount;
+      } // end for
+
+      if(m_num_devices == 0)
+      {
+        bulk::detail::terminate_with_message("multi_device_launch: no devices");
+      } // end if
+    } // end multi_device_launch()
+
+    ExecutionGroup exec() const
+    {
+      return m_exec;
+    } // end exec()
+
+    // returns the number of devices
+    int size() const
+    {
+      return m_num_devices;
+    } // end size()
+
+    // returns the ith device of the launch
+    int device(int i) const
+    {
+      return m_devices[i];
+    } // end device()
+
+    // returns the range of [0, n) which the ith device is responsible for
+    template<typename Size>
+    thrust::pair<Size,Size> partition(int i, Size n) const
+    {
+      // XXX use 64b math to avoid overflow
+      long long total = m_weights[m_num_devices];
+
+      Size first = static_cast<Size>(n * static_cast<long long>(m_weights[i])     / total);
+      Size last  = static_cast<Size>(n * static_cast<long long>(m_weights[i + 1]) / total);
+
+      return thrust::make_pair(first, last);
+    } // end partition()
+
+  private:
+    ExecutionGroup m_exec;
+    int m_num_devices;
+    int m_devices[max_num_devices];
+
+    // the prefix sum of each device's number of multiprocessors
+    int m_weights[max_num_devices + 1];
+}; // end multi_device_launch
+
+
+// shares the groups of g among the given devices, in order
+template<typename ExecutionGroup, typename Iterator>
+multi_device_launch<ExecutionGroup> multi_device(ExecutionGroup g, Iterator first_device, Iterator last_device)
+{
+  return multi_device_launch<ExecutionGroup>(g, first_device, last_device);
+} // end multi_device()
+
+
+// shares the groups of g among the first num_devices devices in the system,
+// ordered such that neighboring devices are peers where possible
+template<typename ExecutionGroup>
+multi_device_launch<ExecutionGroup> multi_device(ExecutionGroup g, int num_devices)
+{
+  int devices[detail::multi_device_detail::max_num_devices];
+
+  num_devices = thrust::min<int>(num_devices, detail::multi_device_detail::max_num_devices);
+
+  for(int i = 0; i < num_devices; ++i)
+  {
+    devices[i] = i;
+  } // end for i
+
+  detail::multi_device_detail::peer_order(devices, devices + num_devices);
+
+  return multi_device(g, devices, devices + num_devices);
+} // end multi_device()
+
+
+// shares the groups of g among all devices in the system
+template<typename ExecutionGroup>
+multi_device_launch<ExecutionGroup> multi_device(ExecutionGroup g)
+{
+  return multi_device(g, detail::multi_device_detail::num_devices());
+} // end multi_device()
+
+
+// enables peer access between each pair of the launch's devices which are capable of it
+// peer access lets the groups on one device dereference pointers to memory on another
+template<typename ExecutionGroup>
+void enable_peer_access(const multi_device_launch<ExecutionGroup> &launch)
+{
+  int original_device = bulk::detail::current_device();
+
+  for(int i = 0; i < launch.size(); ++i)
+  {
+    bulk::detail::throw_on_error(cudaSetDevice(launch.device(i)), "cudaSetDevice in bulk::enable_peer_access");
+
+    for(int j = 0; j < launch.size(); ++j)
+    {
+      if(i != j && detail::multi_device_detail::can_access_peer(launch.device(i), launch.device(j)))
+      {
+        cudaError_t error = cudaDeviceEnablePeerAccess(launch.device(j), 0);
+
+        if(error == cudaErrorPeerAccessAlreadyEnabled)
+        {
+          // clear the error
+          cudaGetLastError();
+        } // end if
+        else
+        {
+          bulk::detail::throw_on_error(error, "cudaDeviceEnablePeerAccess in bulk::enable_peer_access");
+        } // end else
+      } // end if
+    } // end for j
+  } // end for i
+
+  bulk::detail::throw_on_error(cudaSetDevice(original_device), "cudaSetDevice in bulk::enable_peer_access");
+} // end enable_peer_access()
+
+
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
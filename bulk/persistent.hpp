@@ -0,0 +1,432 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/execution_policy.hpp>
+#include <bulk/future.hpp>
+#include <bulk/async.hpp>
+#include <bulk/uninitialized.hpp>
+#include <bulk/detail/closure.hpp>
+#include <bulk/detail/alignment.hpp>
+#include <bulk/detail/guarded_cuda_runtime_api.hpp>
+#include <bulk/detail/throw_on_error.hpp>
+#include <bulk/detail/terminate.hpp>
+#include <bulk/detail/host_mutex.hpp>
+#include <bulk/detail/stream_capture.hpp>
+#include <bulk/detail/cuda_launcher/cuda_launcher.hpp>
+#include <thrust/detail/type_traits.h>
+#include <cstring>
+
+#if __cplusplus >= 201103L
+#  include <atomic>
+#elif defined(_MSC_VER)
+#  include <intrin.h>
+#endif
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+namespace detail
+{
+namespace persistent_detail
+{
+
+
+// the part of the queue's state which the host writes and the device polls
+// it lives in mapped, page-locked memory
+struct control_block
+{
+  // the number of tasks the host has published
+  unsigned int num_submitted;
+
+  // nonzero once the host has asked the grid to exit
+  unsigned int stop;
+}; // end control_block
+
+
+// the device's view of the queue
+template<typename Argument>
+struct queue
+{
+  // mapped
+  volatile control_block *control;
+
+  // mapped, one per slot
+  // a slot's entry is one past the ticket of the last task which completed in it
+  volatile unsigned int *completed;
+
+  // mapped, one per slot
+  const Argument *arguments;
+
+  // device memory, counts the tickets claimed by groups
+  unsigned int *num_claimed;
+
+  unsigned int capacity;
+}; // end queue
+
+
+// true if ticket a comes before ticket b, accounting for wraparound
+inline __host__ __device__ bool precedes(unsigned int a, unsigned int b)
+{
+  return static_cast<int>(b - a) > 0;
+} // end precedes()
+
+
+// orders the host's writes to the arguments before its write to the control block
+inline void host_release_fence()
+{
+#if __cplusplus >= 201103L
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+#elif defined(_MSC_VER)
+  _ReadWriteBarrier();
+#else
+  __sync_synchronize();
+#endif
+} // end host_release_fence()
+
+
+// copies the argument in a slot with volatile loads, so that a slot reused by a later
+// task is not read from a stale cache line
+template<typename ConcurrentGroup, typename Argument>
+__device__
+void load_argument(ConcurrentGroup &g, const Argument *src, Argument *dst)
+{
+  typedef typename thrust::detail::eval_if<
+    (sizeof(Argument) % sizeof(unsigned int) == 0) && (bulk::detail::alignment_of<Argument>::value % sizeof(unsigned int) == 0),
+    thrust::detail::identity_<unsigned int>,
+    thrust::detail::identity_<char>
+  >::type word_type;
+
+  const volatile word_type *src_words = reinterpret_cast<const volatile word_type*>(src);
+  word_type *dst_words = reinterpret_cast<word_type*>(dst);
+
+  const unsigned int num_words = sizeof(Argument) / sizeof(word_type);
+
+  for(unsigned int i = g.this_exec.index(); i < num_words; i += g.size())
+  {
+    dst_words[i] = src_words[i];
+  } // end for i
+} // end load_argument()
+
+
+// the closure run by each group of the resident grid
+// groups claim tickets in order and run f on each ticket's argument until the host
+// asks them to stop and no submitted task remains
+template<typename Function, typename Argument>
+struct worker
+{
+  template<typename ConcurrentGroup>
+  __device__
+  void operator()(ConcurrentGroup &self, queue<Argument> q, Function f)
+  {
+    __shared__ unsigned int s_ticket;
+    __shared__ bool s_stop;
+    __shared__ uninitialized<Argument> s_argument;
+
+    while(true)
+    {
+      if(self.this_exec.index() == 0)
+      {
+        unsigned int ticket = atomicAdd(q.num_claimed, 1u);
+
+        s_ticket = ticket;
+        s_stop = false;
+
+        // wait until the ticket has been published or the host has asked us to exit
+        // note that we check the ticket before stop, because the host publishes
+        // its last tasks before it asks us to exit
+        while(!precedes(ticket, q.control->num_submitted))
+        {
+          if(q.control->stop)
+          {
+            s_stop = true;
+            break;
+          } // end if
+
+#if __CUDA_ARCH__ >= 700
+          __nanosleep(256);
+#endif
+        } // end while
+
+        // order the load of num_submitted before the loads of the argument
+        __threadfence_system();
+      } // end if
+
+      self.wait();
+
+      if(s_stop) break;
+
+      unsigned int slot = s_ticket % q.capacity;
+
+      load_argument(self, q.arguments + slot, &s_argument.get());
+
+      self.wait();
+
+      f(self, s_argument.get());
+
+      self.wait();
+
+      if(self.this_exec.index() == 0)
+      {
+        // make the task's results visible before we tell the host it's complete
+        __threadfence_system();
+
+        q.completed[slot] = s_ticket + 1;
+      } // end if
+    } // end while
+  } // end operator()()
+}; // end worker
+
+
+} // end persistent_detail
+} // end detail
+
+
+// persistent_grid keeps a grid of concurrent groups resident on the device, where it
+// runs small tasks published by the host without launching a kernel for each.
+// It is only available in __host__ code.
+//
+// Each task is an Argument, which is copied bitwise to the device. A group runs a task by calling
+//
+//   f(group, arg);
+//
+// on all of its agents, where group is the bulk::concurrent_group<> the task runs on.
+// The number of groups is limited to the number which may be resident on the device at once.
+//
+// XXX the resident grid occupies its stream and the multiprocessors it runs on until
+//     shutdown(), so work which depends on its results must go in other non-blocking streams,
+//     not the legacy default stream
+// XXX requires a device which can map page-locked host memory
+template<typename Function, typename Argument>
+class persistent_grid
+{
+  public:
+    typedef unsigned int ticket_type;
+    typedef parallel_group<concurrent_group<> >::size_type size_type;
+
+    persistent_grid(Function f, parallel_group<concurrent_group<> > g = bulk::grid(), size_type capacity = 1024)
+      : m_control(0),
+        m_completed(0),
+        m_arguments(0),
+        m_num_claimed(0),
+        m_capacity(capacity),
+        m_num_submitted(0),
+        m_num_groups(0),
+        m_stream(0),
+        m_running(false)
+    {
+      if(bulk::detail::is_capturing())
+      {
+        bulk::detail::terminate_with_message("persistent_grid: persistent grids may not be created during bulk::capture()");
+      } // end if
+
+      if(m_capacity < 1)
+      {
+        bulk::detail::terminate_with_message("persistent_grid: capacity must be positive");
+      } // end if
+
+      bulk::detail::throw_on_error(cudaHostAlloc(reinterpret_cast<void**>(&m_control), sizeof(detail::persistent_detail::control_block), cudaHostAllocMapped | cudaHostAllocPortable), "cudaHostAlloc in persistent_grid ctor");
+      bulk::detail::throw_on_error(cudaHostAlloc(reinterpret_cast<void**>(&m_completed), m_capacity * sizeof(unsigned int), cudaHostAllocMapped | cudaHostAllocPortable), "cudaHostAlloc in persistent_grid ctor");
+      bulk::detail::throw_on_error(cudaHostAlloc(reinterpret_cast<void**>(&m_arguments), m_capacity * sizeof(Argument), cudaHostAllocMapped | cudaHostAllocPortable), "cudaHostAlloc in persistent_grid ctor");
+      bulk::detail::throw_on_error(cudaMalloc(reinterpret_cast<void**>(&m_num_claimed), sizeof(unsigned int)), "cudaMalloc in persistent_grid ctor");
+
+      m_control->num_submitted = 0;
+      m_control->stop = 0;
+      std::memset(const_cast<unsigned int*>(m_completed), 0, m_capacity * sizeof(unsigned int));
+
+      queue_type q;
+      q.capacity = m_capacity;
+      q.num_claimed = m_num_claimed;
+
+      void *ptr = 0;
+      bulk::detail::throw_on_error(cudaHostGetDevicePointer(&ptr, const_cast<detail::persistent_detail::control_block*>(m_control), 0), "cudaHostGetDevicePointer in persistent_grid ctor");
+      q.control = reinterpret_cast<volatile detail::persistent_detail::control_block*>(ptr);
+
+      bulk::detail::throw_on_error(cudaHostGetDevicePointer(&ptr, const_cast<unsigned int*>(m_completed), 0), "cudaHostGetDevicePointer in persistent_grid ctor");
+      q.completed = reinterpret_cast<volatile unsigned int*>(ptr);
+
+      bulk::detail::throw_on_error(cudaHostGetDevicePointer(&ptr, m_arguments, 0), "cudaHostGetDevicePointer in persistent_grid ctor");
+      q.arguments = reinterpret_cast<const Argument*>(ptr);
+
+      // the resident grid mustn't serialize with the legacy default stream
+      bulk::detail::throw_on_error(cudaStreamCreateWithFlags(&m_stream, cudaStreamNonBlocking), "cudaStreamCreateWithFlags in persistent_grid ctor");
+
+      bulk::detail::throw_on_error(cudaMemsetAsync(m_num_claimed, 0, sizeof(unsigned int), m_stream), "cudaMemsetAsync in persistent_grid ctor");
+
+      closure_type c = detail::make_closure(worker_type(), bulk::root.this_exec, q, f);
+
+      // every group must be resident, otherwise tickets claimed by
+      // groups which are never scheduled would never complete
+      detail::cuda_launcher<parallel_group<concurrent_group<> >, closure_type> launcher;
+      g = launcher.configure_resident(g);
+
+      m_num_groups = g.size();
+
+      if(m_num_groups < 1)
+      {
+        bulk::detail::terminate_with_message("persistent_grid: the requested group does not fit on the device");
+      } // end if
+
+      m_done = detail::async_in_stream(g, c, m_stream, 0);
+      m_running = true;
+    } // end persistent_grid()
+
+    ~persistent_grid()
+    {
+      // swallow errors
+      try
+      {
+        shutdown();
+      } // end try
+      catch(...) {}
+
+      if(m_stream)      cudaStreamDestroy(m_stream);
+      if(m_num_claimed) cudaFree(m_num_claimed);
+      if(m_arguments)   cudaFreeHost(m_arguments);
+      if(m_completed)   cudaFreeHost(const_cast<unsigned int*>(m_completed));
+      if(m_control)     cudaFreeHost(const_cast<detail::persistent_detail::control_block*>(m_control));
+    } // end ~persistent_grid()
+
+    // publishes a task and returns its ticket
+    // blocks while the queue is full
+    ticket_type submit(const Argument &arg)
+    {
+      bulk::detail::host_lock_guard guard(m_mutex);
+
+      if(!m_running)
+      {
+        bulk::detail::terminate_with_message("persistent_grid::submit(): the grid has been shut down");
+      } // end if
+
+      ticket_type ticket = m_num_submitted;
+      unsigned int slot = ticket % m_capacity;
+
+      // wait for the slot's previous task to complete
+      if(ticket >= m_capacity)
+      {
+        wait_for_slot(slot, ticket - m_capacity);
+      } // end if
+
+      std::memcpy(m_arguments + slot, &arg, sizeof(Argument));
+
+      detail::persistent_detail::host_release_fence();
+
+      m_num_submitted = ticket + 1;
+      m_control->num_submitted = m_num_submitted;
+
+      return ticket;
+    } // end submit()
+
+    // returns true if the task with the given ticket has completed
+    bool ready(ticket_type ticket) const
+    {
+      return !detail::persistent_detail::precedes(m_completed[ticket % m_capacity], ticket + 1);
+    } // end ready()
+
+    // blocks until the task with the given ticket has completed
+    void wait(ticket_type ticket) const
+    {
+      wait_for_slot(ticket % m_capacity, ticket);
+    } // end wait()
+
+    // blocks until every task submitted so far has completed
+    void wait_all() const
+    {
+      ticket_type end = m_num_submitted;
+      ticket_type begin = end < m_capacity ? 0 : end - m_capacity;
+
+      for(ticket_type ticket = begin; ticket != end; ++ticket)
+      {
+        wait(ticket);
+      } // end for
+    } // end wait_all()
+
+    // completes the submitted tasks and releases the device
+    void shutdown()
+    {
+      bulk::detail::host_lock_guard guard(m_mutex);
+
+      if(m_running)
+      {
+        m_control->stop = 1;
+        m_running = false;
+
+        m_done.wait();
+      } // end if
+    } // end shutdown()
+
+    size_type num_groups() const
+    {
+      return m_num_groups;
+    } // end num_groups()
+
+    size_type capacity() const
+    {
+      return m_capacity;
+    } // end capacity()
+
+  private:
+    typedef detail::persistent_detail::worker<Function,Argument> worker_type;
+    typedef detail::persistent_detail::queue<Argument>            queue_type;
+    typedef detail::closure<
+      worker_type,
+      thrust::tuple<detail::cursor<1>, queue_type, Function>
+    > closure_type;
+
+    // noncopyable
+    persistent_grid(const persistent_grid &);
+    persistent_grid &operator=(const persistent_grid &);
+
+    void wait_for_slot(unsigned int slot, ticket_type ticket) const
+    {
+      while(detail::persistent_detail::precedes(m_completed[slot], ticket + 1))
+      {
+        // if the grid has stopped, the task will never complete
+        cudaError_t error = cudaStreamQuery(m_stream);
+
+        if(error != cudaErrorNotReady)
+        {
+          bulk::detail::throw_on_error(error, "cudaStreamQuery in persistent_grid::wait");
+
+          // the grid exited normally, so check once more before giving up
+          if(!detail::persistent_detail::precedes(m_completed[slot], ticket + 1)) break;
+
+          bulk::detail::terminate_with_message("persistent_grid::wait(): the grid exited before the task completed");
+        } // end if
+      } // end while
+    } // end wait_for_slot()
+
+    volatile detail::persistent_detail::control_block *m_control;
+    volatile unsigned int *m_completed;
+    Argument *m_arguments;
+    unsigned int *m_num_claimed;
+    unsigned int m_capacity;
+    ticket_type m_num_submitted;
+    size_type m_num_groups;
+    cudaStream_t m_stream;
+    bool m_running;
+    future<void> m_done;
+    bulk::detail::host_mutex m_mutex;
+}; // end persistent_grid
+
+
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
@@ -0,0 +1,141 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <thrust/detail/type_traits.h>
+#include <thrust/detail/type_traits/has_nested_type.h>
+#include <cstddef>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+
+
+// A function launched by bulk::async may reserve Bytes of on-chip scratch for each of its groups
+// by deriving from static_scratch<Bytes>. Unlike the heap, the scratch is allocated statically,
+// so algorithms whose temporaries fit within it skip bulk::malloc and the barriers it entails.
+// e.g.
+//
+//   struct sum_tiles : bulk::static_scratch<bulk::accumulate_scratch_size<128,7,int*,int>::value>
+//   {
+//     ...
+//   };
+template<std::size_t Bytes>
+struct static_scratch
+{
+  typedef static_scratch<Bytes> static_scratch_type;
+
+  static const std::size_t size = Bytes;
+}; // end static_scratch
+
+
+namespace detail
+{
+
+
+__THRUST_DEFINE_HAS_NESTED_TYPE(has_static_scratch_type, static_scratch_type)
+
+
+// the number of bytes of scratch Function reserves
+template<typename Function, bool = has_static_scratch_type<Function>::value>
+struct static_scratch_size
+  : thrust::detail::integral_constant<std::size_t, 0>
+{};
+
+
+template<typename Function>
+struct static_scratch_size<Function,true>
+  : thrust::detail::integral_constant<std::size_t, Function::static_scratch_type::size>
+{};
+
+
+// the __shared__ storage of Bytes of scratch
+template<std::size_t Bytes>
+struct static_scratch_storage
+{
+  __device__
+  static void *get()
+  {
+    // 16-byte units keep the scratch suitably aligned for any type
+    __shared__ uint4 storage[(Bytes + sizeof(uint4) - 1) / sizeof(uint4)];
+    return storage;
+  }
+}; // end static_scratch_storage
+
+
+template<>
+struct static_scratch_storage<0>
+{
+  __device__
+  static void *get()
+  {
+    return 0;
+  }
+}; // end static_scratch_storage
+
+
+struct static_scratch_segment
+{
+  void        *ptr;
+  std::size_t size;
+}; // end static_scratch_segment
+
+
+// put the object in an anonymous namespace so that non-CUDA compilers don't complain about multiple definitions
+namespace
+{
+
+__shared__ static_scratch_segment s_static_scratch;
+
+} // end anon namespace
+
+
+// publishes the CTA's scratch to the algorithms its function calls
+// called by a single thread before the CTA's first use of the scratch
+inline __device__ void init_static_scratch(void *ptr, std::size_t size)
+{
+  s_static_scratch.ptr  = ptr;
+  s_static_scratch.size = size;
+} // end init_static_scratch()
+
+
+} // end detail
+
+
+// returns the group's static scratch as a T*, or 0 if the scratch can't hold a T
+// all agents of the group receive the same result without synchronizing
+// the scratch is shared by every algorithm the group invokes, so an algorithm which uses it
+// must wait for the group to finish with it before returning, and mustn't invoke another
+// algorithm which uses it in the meantime
+template<typename T, typename ConcurrentGroup>
+__device__
+inline T *static_scratch_ptr(ConcurrentGroup &)
+{
+#if __CUDA_ARCH__ >= 200
+  return (sizeof(T) <= detail::s_static_scratch.size) ? reinterpret_cast<T*>(detail::s_static_scratch.ptr) : 0;
+#else
+  return 0;
+#endif
+} // end static_scratch_ptr()
+
+
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
@@ -0,0 +1,79 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/detail/stream_pool.hpp>
+#include <bulk/detail/cuda_launcher/runtime_introspection.hpp>
+#include <cstddef>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+
+
+// bulk::async recycles the streams it creates for launches which do not
+// name a stream. These functions size & inspect that pool for the current device.
+// They are only available in __host__ code.
+
+
+// creates streams until at least n are idle in the current device's pool
+inline void reserve_streams(std::size_t n)
+{
+  bulk::detail::default_stream_pool().reserve(bulk::detail::current_device(), n);
+} // end reserve_streams()
+
+
+// returns the number of the current device's streams which are ready for reuse
+inline std::size_t num_idle_streams()
+{
+  return bulk::detail::default_stream_pool().num_idle(bulk::detail::current_device());
+} // end num_idle_streams()
+
+
+// returns the number of the current device's streams which are owned by a bulk::future
+inline std::size_t num_streams_in_use()
+{
+  return bulk::detail::default_stream_pool().num_in_use(bulk::detail::current_device());
+} // end num_streams_in_use()
+
+
+// returns the maximum number of idle streams kept per device
+inline std::size_t max_idle_streams()
+{
+  return bulk::detail::default_stream_pool().max_idle();
+} // end max_idle_streams()
+
+
+// streams released while n streams are already idle are destroyed
+inline void set_max_idle_streams(std::size_t n)
+{
+  bulk::detail::default_stream_pool().set_max_idle(n);
+} // end set_max_idle_streams()
+
+
+// destroys the current device's idle streams
+inline void release_idle_streams()
+{
+  bulk::detail::default_stream_pool().clear(bulk::detail::current_device());
+} // end release_idle_streams()
+
+
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
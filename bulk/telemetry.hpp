@@ -0,0 +1,118 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/detail/launch_telemetry.hpp>
+#include <vector>
+#include <ostream>
+#include <cstddef>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+
+
+// While launch telemetry is enabled, each kernel launched by bulk::async is timed on the GPU
+// with a pair of events, and its configuration is recorded along with the occupancy it may achieve.
+// The records wait in a ring buffer until their launches complete and they are drained;
+// if the ring fills before then, the oldest records are dropped.
+// These functions are only available in __host__ code.
+
+
+// enabling telemetry drops any records which haven't been drained
+inline void enable_launch_telemetry(std::size_t capacity = detail::launch_telemetry_state::default_capacity)
+{
+  detail::launch_telemetry_state &state = detail::launch_telemetry_global_state();
+  detail::host_lock_guard guard(state.mutex);
+
+  detail::reset_launch_telemetry(state, capacity);
+  state.enabled = capacity > 0;
+} // end enable_launch_telemetry()
+
+
+// records of launches made while telemetry was enabled may still be drained
+inline void disable_launch_telemetry()
+{
+  detail::launch_telemetry_state &state = detail::launch_telemetry_global_state();
+  detail::host_lock_guard guard(state.mutex);
+  state.enabled = false;
+} // end disable_launch_telemetry()
+
+
+inline bool launch_telemetry_enabled()
+{
+  detail::launch_telemetry_state &state = detail::launch_telemetry_global_state();
+  detail::host_lock_guard guard(state.mutex);
+  return state.enabled;
+} // end launch_telemetry_enabled()
+
+
+// appends the records of completed launches to result, oldest first, and returns their number
+// this does not wait for launches which haven't completed: their records remain for a later drain
+inline std::size_t drain_launch_records(std::vector<launch_record> &result)
+{
+  return detail::drain_launch_telemetry(result);
+} // end drain_launch_records()
+
+
+// returns the number of records dropped because the ring was full, or telemetry was re-enabled, before they were drained
+inline std::size_t num_dropped_launch_records()
+{
+  detail::launch_telemetry_state &state = detail::launch_telemetry_global_state();
+  detail::host_lock_guard guard(state.mutex);
+  return state.num_dropped;
+} // end num_dropped_launch_records()
+
+
+// writes each record to os as a line of JSON
+inline void write_launch_records(std::ostream &os, const std::vector<launch_record> &records)
+{
+  for(std::size_t i = 0; i < records.size(); ++i)
+  {
+    const launch_record &r = records[i];
+
+    os << "{\"kernel\":\"" << (r.kernel_name ? r.kernel_name : "") << "\""
+       << ",\"device\":" << r.device
+       << ",\"stream\":" << reinterpret_cast<std::size_t>(r.stream)
+       << ",\"num_groups\":" << r.num_groups
+       << ",\"group_size\":" << r.group_size
+       << ",\"heap_size\":" << r.heap_size
+       << ",\"max_active_groups_per_multiprocessor\":" << r.max_active_groups_per_multiprocessor
+       << ",\"occupancy\":" << r.occupancy
+       << ",\"elapsed_milliseconds\":" << r.elapsed_milliseconds
+       << "}\n";
+  } // end for i
+} // end write_launch_records()
+
+
+// drains the records of completed launches and writes them to os
+inline std::size_t export_launch_records(std::ostream &os)
+{
+  std::vector<launch_record> records;
+  std::size_t result = bulk::drain_launch_records(records);
+
+  bulk::write_launch_records(os, records);
+
+  return result;
+} // end export_launch_records()
+
+
+} // end bulk
+BULK_NAMESPACE_SUFFIX
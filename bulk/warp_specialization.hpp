@@ -0,0 +1,282 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/algorithm/detail/warp_collectives.hpp>
+#include <thrust/detail/static_assert.h>
+#include <cstddef>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+namespace detail
+{
+namespace warp_specialization_detail
+{
+
+
+// barrier 0 belongs to __syncthreads, i.e. concurrent_group::wait()
+static const unsigned int producer_barrier    = 1;
+static const unsigned int consumer_barrier    = 2;
+static const unsigned int first_stage_barrier = 3;
+
+// each stage takes a pair of the 16 named barriers
+static const std::size_t max_num_stages = (16 - first_stage_barrier) / 2;
+
+
+// all participants must arrive at or sync with barrier id before those which sync may continue
+// num_agents must be a multiple of the warp size
+inline __device__ void barrier_sync(unsigned int id, unsigned int num_agents)
+{
+  // guard use of inline PTX from foreign compilers
+#ifdef __CUDA_ARCH__
+  asm volatile("bar.sync %0, %1;\n" :: "r"(id), "r"(num_agents) : "memory");
+#endif
+} // end barrier_sync()
+
+
+inline __device__ void barrier_arrive(unsigned int id, unsigned int num_agents)
+{
+#ifdef __CUDA_ARCH__
+  asm volatile("bar.arrive %0, %1;\n" :: "r"(id), "r"(num_agents) : "memory");
+#endif
+} // end barrier_arrive()
+
+
+// a stage's buffer is full once its producers arrive at the first barrier of its pair,
+// and empty once its consumers arrive at the second
+inline __device__ unsigned int full_barrier(unsigned int stage)
+{
+  return first_stage_barrier + 2 * stage;
+} // end full_barrier()
+
+
+inline __device__ unsigned int empty_barrier(unsigned int stage)
+{
+  return first_stage_barrier + 2 * stage + 1;
+} // end empty_barrier()
+
+
+} // end warp_specialization_detail
+} // end detail
+
+
+// a role is the contiguous range of a concurrent group's agents which plays one part of a warp_specialized_group
+template<typename ConcurrentGroup>
+class role
+{
+  public:
+    typedef ConcurrentGroup                      group_type;
+    typedef typename ConcurrentGroup::size_type  size_type;
+
+    __device__
+    role(group_type &g, size_type first_agent, size_type size, unsigned int barrier)
+      : m_group(g), m_first_agent(first_agent), m_size(size), m_barrier(barrier)
+    {}
+
+    // the rank of the calling agent within the role
+    __device__
+    size_type index() const
+    {
+      return m_group.this_exec.index() - m_first_agent;
+    } // end index()
+
+    __device__
+    size_type size() const
+    {
+      return m_size;
+    } // end size()
+
+    // waits for the role's other agents, but not for the rest of the group
+    __device__
+    void wait() const
+    {
+      detail::warp_specialization_detail::barrier_sync(m_barrier, m_size);
+    } // end wait()
+
+    __device__
+    group_type &group() const
+    {
+      return m_group;
+    } // end group()
+
+  private:
+    group_type &m_group;
+    size_type m_first_agent;
+    size_type m_size;
+    unsigned int m_barrier;
+}; // end role
+
+
+// warp_specialized_group partitions a concurrent group into a role of num_producer_warps warps
+// which fills a ring of num_stages buffers and a role of the remaining warps which consumes them.
+// Rather than alternating load & compute phases with g.wait(), producers run up to num_stages
+// iterations ahead of consumers, handing off each buffer with a pair of named barriers:
+//
+//   producers:                                     consumers:
+//     acquire(i)    // wait for stage i's buffer     wait(i)       // wait for stage i's contents
+//     ... fill buffer stage(i) ...                   ... consume buffer stage(i) ...
+//     commit(i)     // announce its contents         release(i,n)  // hand it back
+//
+// The buffers themselves belong to the caller, e.g. num_stages tiles allocated with bulk::malloc.
+//
+// XXX the group's size must be a multiple of the warp size and exceed num_producer_warps warps
+// XXX the roles may not use g.wait() between the first and last handoff, only role::wait()
+template<std::size_t num_producer_warps, std::size_t num_stages, typename ConcurrentGroup>
+class warp_specialized_group
+{
+  public:
+    typedef ConcurrentGroup                      group_type;
+    typedef typename ConcurrentGroup::size_type  size_type;
+    typedef bulk::role<ConcurrentGroup>          role_type;
+
+    static const std::size_t stages = num_stages;
+
+    __device__
+    explicit warp_specialized_group(group_type &g)
+      : m_group(g)
+    {}
+
+    __device__
+    bool is_producer() const
+    {
+      return m_group.this_exec.index() < num_producer_agents();
+    } // end is_producer()
+
+    __device__
+    role_type producers() const
+    {
+      return role_type(m_group, 0, num_producer_agents(), detail::warp_specialization_detail::producer_barrier);
+    } // end producers()
+
+    __device__
+    role_type consumers() const
+    {
+      return role_type(m_group, num_producer_agents(), m_group.size() - num_producer_agents(), detail::warp_specialization_detail::consumer_barrier);
+    } // end consumers()
+
+    __device__
+    static unsigned int stage(size_type i)
+    {
+      return i % num_stages;
+    } // end stage()
+
+    // called by every producer before filling the buffer of iteration i
+    __device__
+    void acquire(size_type i) const
+    {
+      // the first round of buffers starts out empty
+      if(i >= size_type(num_stages))
+      {
+        detail::warp_specialization_detail::barrier_sync(detail::warp_specialization_detail::empty_barrier(stage(i)), m_group.size());
+      } // end if
+    } // end acquire()
+
+    // called by every producer after filling the buffer of iteration i
+    __device__
+    void commit(size_type i) const
+    {
+      detail::warp_specialization_detail::barrier_arrive(detail::warp_specialization_detail::full_barrier(stage(i)), m_group.size());
+    } // end commit()
+
+    // called by every consumer before consuming the buffer of iteration i
+    __device__
+    void wait(size_type i) const
+    {
+      detail::warp_specialization_detail::barrier_sync(detail::warp_specialization_detail::full_barrier(stage(i)), m_group.size());
+    } // end wait()
+
+    // called by every consumer after consuming the buffer of iteration i of num_iterations
+    __device__
+    void release(size_type i, size_type num_iterations) const
+    {
+      // only arrive where a producer will acquire, so no barrier is left half-arrived
+      if(i + size_type(num_stages) < num_iterations)
+      {
+        detail::warp_specialization_detail::barrier_arrive(detail::warp_specialization_detail::empty_barrier(stage(i)), m_group.size());
+      } // end if
+    } // end release()
+
+    __device__
+    group_type &group() const
+    {
+      return m_group;
+    } // end group()
+
+  private:
+    __device__
+    size_type num_producer_agents() const
+    {
+      return num_producer_warps * detail::warp_detail::warp_size;
+    } // end num_producer_agents()
+
+    group_type &m_group;
+}; // end warp_specialized_group
+
+
+// runs num_iterations rounds of producer/consumer handoff on a warp-specialized partition of g:
+//
+//   produce(producers, i, stage) fills the buffer of stage stage for iteration i
+//   consume(consumers, i, stage) consumes it
+//
+// where producers and consumers are the bulk::roles of the partition.
+// Every agent of g must call warp_specialize, which returns once every iteration has been consumed.
+// On sm_20 and later, the producers of a memory-bound loop keep up to num_stages loads in flight
+// while the consumers compute.
+template<std::size_t num_producer_warps, std::size_t num_stages, typename ConcurrentGroup, typename Size, typename Producer, typename Consumer>
+__device__
+void warp_specialize(ConcurrentGroup &g, Size num_iterations, Producer produce, Consumer consume)
+{
+  typedef warp_specialized_group<num_producer_warps, num_stages, ConcurrentGroup> partition_type;
+
+  THRUST_STATIC_ASSERT(num_producer_warps > 0 && num_stages > 0 && num_stages <= detail::warp_specialization_detail::max_num_stages);
+
+  partition_type partition(g);
+
+  if(partition.is_producer())
+  {
+    typename partition_type::role_type producers = partition.producers();
+
+    for(Size i = 0; i < num_iterations; ++i)
+    {
+      partition.acquire(i);
+      produce(producers, i, partition.stage(i));
+      partition.commit(i);
+    } // end for i
+  } // end if
+  else
+  {
+    typename partition_type::role_type consumers = partition.consumers();
+
+    for(Size i = 0; i < num_iterations; ++i)
+    {
+      partition.wait(i);
+      consume(consumers, i, partition.stage(i));
+      partition.release(i, num_iterations);
+    } // end for i
+  } // end else
+
+  g.wait();
+} // end warp_specialize()
+
+
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
@@ -0,0 +1,70 @@
+#include <iostream>
+#include <cassert>
+#include <bulk/bulk.hpp>
+#include <thrust/device_vector.h>
+#include <thrust/tabulate.h>
+#include <thrust/reduce.h>
+
+// sums tiles which are larger than one group's heap by spreading each
+// tile across the heaps of a cluster's groups
+
+typedef bulk::cluster<bulk::concurrent_group<bulk::agent<>,256> > cluster_type;
+
+struct sum_tiles
+{
+  __device__
+  void operator()(cluster_type &c, const int *data, int n, int share_size, int *result)
+  {
+    bulk::concurrent_group<bulk::agent<>,256> &g = c.this_exec;
+
+    int *share = static_cast<int*>(bulk::malloc(c, share_size * sizeof(int)));
+
+    if(share == 0) return;
+
+    bulk::distributed_array<int, bulk::concurrent_group<bulk::agent<>,256> > tile(c, share, share_size);
+
+    // each group loads its share of the cluster's tile
+    int tile_offset = c.index() * tile.size() + g.index() * share_size;
+
+    for(int i = g.this_exec.index(); i < share_size; i += g.size())
+    {
+      tile.local()[i] = (tile_offset + i < n) ? data[tile_offset + i] : 0;
+    }
+
+    c.wait();
+
+    // each group sums a strided subset of the whole tile, mostly from the other groups' shares
+    int sum = 0;
+    for(int i = g.index() * g.size() + g.this_exec.index(); i < tile.size(); i += c.size() * g.size())
+    {
+      sum += tile[i];
+    }
+
+    atomicAdd(result, sum);
+
+    bulk::free(c, share);
+  }
+};
+
+int main()
+{
+  const int cluster_size = 4;
+  const int share_size = 8 * 1024;
+  const int tile_size = cluster_size * share_size;
+  const int n = 1 << 22;
+
+  thrust::device_vector<int> data(n);
+  thrust::tabulate(data.begin(), data.end(), thrust::placeholders::_1 % 13);
+
+  thrust::device_vector<int> result(1, 0);
+
+  int num_clusters = (n + tile_size - 1) / tile_size;
+
+  bulk::async(bulk::cluster_grid<256,1>(num_clusters, cluster_size, share_size * sizeof(int)), sum_tiles(), bulk::root.this_exec, thrust::raw_pointer_cast(data.data()), n, share_size, thrust::raw_pointer_cast(result.data())).wait();
+
+  assert(result[0] == thrust::reduce(data.begin(), data.end()));
+
+  std::cout << "It worked!" << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,131 @@
+#include <iostream>
+#include <cassert>
+#include <cstdlib>
+#include <algorithm>
+#include <thrust/device_vector.h>
+#include <thrust/host_vector.h>
+#include <thrust/fill.h>
+#include <bulk/bulk.hpp>
+
+
+static const size_t groupsize = 128;
+static const size_t grainsize = 4;
+
+// the staging of one tile of values, destinations & ranks, plus room for the on-chip allocator's block headers
+static const size_t heap_size = groupsize * grainsize * 3 * sizeof(int) + 64;
+
+
+struct scatter_kernel
+{
+  template<typename ConcurrentGroup>
+  __device__
+  void operator()(ConcurrentGroup &g, const int *first, const int *last, const int *map, int *result)
+  {
+    bulk::coalesced_scatter(g, first, last, map, result);
+  }
+};
+
+
+struct scatter_if_kernel
+{
+  template<typename ConcurrentGroup>
+  __device__
+  void operator()(ConcurrentGroup &g, const int *first, const int *last, const int *map, const bool *stencil, int *result)
+  {
+    bulk::coalesced_scatter_if(g, first, last, map, stencil, result);
+  }
+};
+
+
+void validate(const thrust::host_vector<int> &h_map, const thrust::host_vector<bool> &h_stencil)
+{
+  size_t n = h_map.size();
+
+  thrust::host_vector<int> h_input(n);
+  for(size_t i = 0; i < n; ++i)
+  {
+    h_input[i] = std::rand();
+  }
+
+  thrust::host_vector<int> expected(n, -1);
+  for(size_t i = 0; i < n; ++i)
+  {
+    if(h_stencil[i])
+    {
+      expected[h_map[i]] = h_input[i];
+    }
+  }
+
+  thrust::device_vector<int>  input   = h_input;
+  thrust::device_vector<int>  map     = h_map;
+  thrust::device_vector<bool> stencil = h_stencil;
+  thrust::device_vector<int>  result(n, -1);
+
+  bulk::async(bulk::con<groupsize,grainsize>(heap_size), scatter_if_kernel(), bulk::root,
+              thrust::raw_pointer_cast(input.data()),
+              thrust::raw_pointer_cast(input.data()) + n,
+              thrust::raw_pointer_cast(map.data()),
+              thrust::raw_pointer_cast(stencil.data()),
+              thrust::raw_pointer_cast(result.data()));
+
+  assert(expected == thrust::host_vector<int>(result));
+
+  // without a stencil, every element is scattered
+  if(std::find(h_stencil.begin(), h_stencil.end(), false) == h_stencil.end())
+  {
+    thrust::fill(result.begin(), result.end(), -1);
+
+    bulk::async(bulk::con<groupsize,grainsize>(heap_size), scatter_kernel(), bulk::root,
+                thrust::raw_pointer_cast(input.data()),
+                thrust::raw_pointer_cast(input.data()) + n,
+                thrust::raw_pointer_cast(map.data()),
+                thrust::raw_pointer_cast(result.data()));
+
+    assert(expected == thrust::host_vector<int>(result));
+  }
+}
+
+
+int main()
+{
+  // several tiles, the last of them partial
+  size_t n = 10 * groupsize * grainsize + 123;
+
+  thrust::host_vector<int>  map(n);
+  thrust::host_vector<bool> stencil(n, true);
+
+  // an increasing, dense map stores each tile as a single run
+  for(size_t i = 0; i < n; ++i) map[i] = int(i);
+  validate(map, stencil);
+
+  // a reversed map scatters each element on its own
+  for(size_t i = 0; i < n; ++i) map[i] = int(n - i - 1);
+  validate(map, stencil);
+
+  // a random permutation
+  for(size_t i = 0; i < n; ++i) map[i] = int(i);
+  std::random_shuffle(map.begin(), map.end());
+  validate(map, stencil);
+
+  // select whole spans of elements, so that some tiles select none, then pack them densely,
+  // so that the other tiles are a single run
+  int num_selected = 0;
+  for(size_t i = 0; i < n; ++i)
+  {
+    stencil[i] = (i / 1000) % 2;
+    map[i] = stencil[i] ? num_selected++ : 0;
+  }
+  validate(map, stencil);
+
+  // select a sparse subset, leaving holes in the destinations
+  for(size_t i = 0; i < n; ++i)
+  {
+    stencil[i] = (i % 3) == 0;
+    map[i] = int(i);
+  }
+  validate(map, stencil);
+
+  std::cout << "OK" << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,265 @@
+#include <iostream>
+#include <cassert>
+#include <thrust/device_vector.h>
+#include <thrust/host_vector.h>
+#include <thrust/copy.h>
+#include <thrust/partition.h>
+#include <thrust/sort.h>
+#include <thrust/tabulate.h>
+#include <thrust/transform.h>
+#include <thrust/equal.h>
+#include <thrust/binary_search.h>
+#include <bulk/bulk.hpp>
+#include "time_invocation_cuda.hpp"
+
+
+template<typename T>
+struct is_odd
+{
+  __host__ __device__
+  bool operator()(const T &x) const
+  {
+    return x % 2;
+  }
+};
+
+
+// the bucket of x is its low two bits
+template<typename T>
+struct low_bits
+{
+  __host__ __device__
+  unsigned int operator()(const T &x) const
+  {
+    return x & 3;
+  }
+};
+
+
+struct hash
+{
+  __host__ __device__
+  int operator()(int x) const
+  {
+    x = (x+0x7ed55d16) + (x<<12);
+    x = (x^0xc761c23c) ^ (x>>19);
+    x = (x+0x165667b1) + (x<<5);
+    x = (x+0xd3a2646c) ^ (x<<9);
+    x = (x+0xfd7046c5) + (x<<3);
+    x = (x^0xb55a4f09) ^ (x>>16);
+    return x & 0x7fffffff;
+  }
+};
+
+
+// partitions each tile independently with the group algorithms
+struct partition_each_kernel
+{
+  template<std::size_t groupsize, std::size_t grainsize, typename RandomAccessIterator1, typename RandomAccessIterator2, typename RandomAccessIterator3>
+  __device__ void operator()(bulk::concurrent_group<bulk::agent<grainsize>, groupsize> &g, RandomAccessIterator1 partitioned, RandomAccessIterator2 multisplit, RandomAccessIterator3 bucket_begins, int n)
+  {
+    typedef typename bulk::concurrent_group<bulk::agent<grainsize>,groupsize>::size_type size_type;
+    typedef typename thrust::iterator_value<RandomAccessIterator1>::type value_type;
+    const size_type tilesize = groupsize * grainsize;
+
+    size_type gid = tilesize * g.index();
+    size_type count = thrust::min<size_type>(tilesize, n - gid);
+
+    bulk::stable_partition(bulk::bound<tilesize>(g), partitioned + gid, partitioned + gid + count, is_odd<value_type>());
+
+    bulk::multisplit<4>(bulk::bound<tilesize>(g), multisplit + gid, multisplit + gid + count, multisplit + gid, low_bits<value_type>(), bucket_begins + 4 * g.index());
+  }
+};
+
+
+// a single group compacts & partitions all of its elements, tile by tile
+struct group_copy_if_kernel
+{
+  template<typename ConcurrentGroup, typename RandomAccessIterator1, typename RandomAccessIterator2, typename RandomAccessIterator3, typename RandomAccessIterator4>
+  __device__ void operator()(ConcurrentGroup &g, RandomAccessIterator1 input, int n, RandomAccessIterator2 copied, RandomAccessIterator3 out_true, RandomAccessIterator4 out_false, int *sizes)
+  {
+    typedef typename thrust::iterator_value<RandomAccessIterator1>::type value_type;
+
+    RandomAccessIterator2 copied_end = bulk::copy_if(g, input, input + n, copied, is_odd<value_type>());
+
+    thrust::pair<RandomAccessIterator3,RandomAccessIterator4> ends = bulk::partition_copy(g, input, input + n, out_true, out_false, is_odd<value_type>());
+
+    if(g.this_exec.index() == 0)
+    {
+      sizes[0] = copied_end - copied;
+      sizes[1] = ends.first - out_true;
+      sizes[2] = ends.second - out_false;
+    }
+  }
+};
+
+
+template<std::size_t groupsize, std::size_t grainsize>
+void validate_group_copy_if(int n)
+{
+  thrust::device_vector<int> input(n);
+  thrust::tabulate(input.begin(), input.end(), hash());
+
+  thrust::device_vector<int> copied(n), out_true(n), out_false(n), sizes(3);
+
+  // the group allocates a tile of scratch from its heap
+  int heap_size = groupsize * grainsize * sizeof(unsigned int) + 32;
+  bulk::async(bulk::con<groupsize,grainsize>(heap_size), group_copy_if_kernel(), bulk::root, input.begin(), n, copied.begin(), out_true.begin(), out_false.begin(), thrust::raw_pointer_cast(sizes.data()));
+
+  cudaError_t error = cudaDeviceSynchronize();
+  if(error)
+  {
+    std::cout << "CUDA error: " << cudaGetErrorString(error) << std::endl;
+  }
+
+  thrust::host_vector<int> h_input = input;
+  thrust::host_vector<int> ref_true(n), ref_false(n);
+
+  int num_true  = thrust::partition_copy(h_input.begin(), h_input.end(), ref_true.begin(), ref_false.begin(), is_odd<int>()).first - ref_true.begin();
+  int num_false = n - num_true;
+
+  thrust::host_vector<int> h_sizes = sizes;
+  assert(h_sizes[0] == num_true);
+  assert(h_sizes[1] == num_true);
+  assert(h_sizes[2] == num_false);
+
+  thrust::host_vector<int> h_copied = copied, h_out_true = out_true, h_out_false = out_false;
+  assert(thrust::equal(ref_true.begin(), ref_true.begin() + num_true, h_copied.begin()));
+  assert(thrust::equal(ref_true.begin(), ref_true.begin() + num_true, h_out_true.begin()));
+  assert(thrust::equal(ref_false.begin(), ref_false.begin() + num_false, h_out_false.begin()));
+}
+
+
+template<std::size_t groupsize, std::size_t grainsize>
+void validate_partition(int n)
+{
+  const int tilesize = groupsize * grainsize;
+  int num_groups = (n + tilesize - 1) / tilesize;
+
+  thrust::device_vector<int> input(n);
+  thrust::tabulate(input.begin(), input.end(), hash());
+
+  thrust::device_vector<int> partitioned = input, multisplit = input;
+  thrust::device_vector<int> bucket_begins(4 * num_groups);
+
+  // the group allocates its scratch from its heap
+  int heap_size = (4 + 1) * groupsize * sizeof(unsigned int) + tilesize * sizeof(unsigned int) + 32;
+  bulk::async(bulk::grid<groupsize,grainsize>(num_groups, heap_size), partition_each_kernel(), bulk::root.this_exec, partitioned.begin(), multisplit.begin(), bucket_begins.begin(), n);
+
+  cudaError_t error = cudaDeviceSynchronize();
+  if(error)
+  {
+    std::cout << "CUDA error: " << cudaGetErrorString(error) << std::endl;
+  }
+
+  thrust::host_vector<int> h_input = input;
+  thrust::host_vector<int> h_partitioned = partitioned, h_multisplit = multisplit;
+  thrust::host_vector<int> h_bucket_begins = bucket_begins;
+
+  for(int tile = 0; tile < num_groups; ++tile)
+  {
+    int begin = tile * tilesize;
+    int end = thrust::min(begin + tilesize, n);
+
+    thrust::host_vector<int> ref(h_input.begin() + begin, h_input.begin() + end);
+    thrust::stable_partition(ref.begin(), ref.end(), is_odd<int>());
+    assert(thrust::equal(ref.begin(), ref.end(), h_partitioned.begin() + begin));
+
+    // stably sorting by bucket is a multisplit
+    thrust::host_vector<int> ref_buckets(end - begin);
+    thrust::transform(h_input.begin() + begin, h_input.begin() + end, ref_buckets.begin(), low_bits<int>());
+    ref.assign(h_input.begin() + begin, h_input.begin() + end);
+    thrust::stable_sort_by_key(ref_buckets.begin(), ref_buckets.end(), ref.begin());
+    assert(thrust::equal(ref.begin(), ref.end(), h_multisplit.begin() + begin));
+
+    for(unsigned int b = 0; b < 4; ++b)
+    {
+      int expected = thrust::lower_bound(ref_buckets.begin(), ref_buckets.end(), b) - ref_buckets.begin();
+      assert(h_bucket_begins[4 * tile + b] == expected);
+    }
+  }
+}
+
+
+template<typename T>
+void validate(size_t n)
+{
+  thrust::device_vector<T> input(n);
+  thrust::tabulate(input.begin(), input.end(), hash());
+
+  thrust::device_vector<T> ref(n), result(n);
+
+  ref.resize(thrust::copy_if(input.begin(), input.end(), ref.begin(), is_odd<T>()) - ref.begin());
+  result.resize(bulk::copy_if(input.begin(), input.end(), result.begin(), is_odd<T>()) - result.begin());
+
+  cudaError_t error = cudaDeviceSynchronize();
+  if(error)
+  {
+    std::cout << "CUDA error: " << cudaGetErrorString(error) << std::endl;
+  }
+
+  assert(ref == result);
+}
+
+
+template<typename T>
+void my_copy_if(const thrust::device_vector<T> *input, thrust::device_vector<T> *result)
+{
+  bulk::copy_if(input->begin(), input->end(), result->begin(), is_odd<T>());
+}
+
+
+template<typename T>
+void thrust_copy_if(const thrust::device_vector<T> *input, thrust::device_vector<T> *result)
+{
+  thrust::copy_if(input->begin(), input->end(), result->begin(), is_odd<T>());
+}
+
+
+template<typename T>
+void compare(size_t n)
+{
+  thrust::device_vector<T> input(n), result(n);
+  thrust::tabulate(input.begin(), input.end(), hash());
+
+  my_copy_if(&input, &result);
+  double my_msecs = time_invocation_cuda(20, my_copy_if<T>, &input, &result);
+
+  thrust_copy_if(&input, &result);
+  double thrust_msecs = time_invocation_cuda(20, thrust_copy_if<T>, &input, &result);
+
+  std::cout << "N: " << n << std::endl;
+  std::cout << "  Thrust's time: " << thrust_msecs << " ms" << std::endl;
+  std::cout << "  My time: " << my_msecs << " ms" << std::endl;
+  std::cout << "  Performance relative to Thrust: " << thrust_msecs / my_msecs << std::endl;
+}
+
+
+int main()
+{
+  size_t n = 1 << 20;
+
+  for(size_t size = 0; size <= n; size = 2 * size + 1)
+  {
+    std::cout << "Testing " << size << std::endl;
+    validate<int>(size);
+  }
+
+  // a whole number of warps takes the ballot path, and a partial warp does not
+  validate_partition<128,7>(1 << 16);
+  validate_partition<96,5>(1 << 16);
+  validate_partition<100,5>(1 << 16);
+
+  // an empty range, a partial tile & several tiles, the last of them partial
+  int sizes[] = {0, 1, 300, 10000};
+  for(size_t i = 0; i < sizeof(sizes) / sizeof(int); ++i)
+  {
+    validate_group_copy_if<128,7>(sizes[i]);
+    validate_group_copy_if<100,5>(sizes[i]);
+  }
+
+  compare<int>(1 << 24);
+  compare<long long>(1 << 24);
+
+  return 0;
+}
@@ -1,6 +1,11 @@
 #pragma once
 
 #include <thrust/pair.h>
+#include <thrust/tuple.h>
+#include <thrust/detail/minmax.h>
+#include <bulk/execution_policy.hpp>
+#include <bulk/async.hpp>
+#include <bulk/algorithm/merge.hpp>
 
 template<typename Size>
 class trivial_decomposition
@@ -74,7 +79,8 @@ class blocked_decomposition
         m_num_partitions((n + block_size - 1) / block_size)
     {}
 
-    __host__ __device__
+    // the split points live in device memory, so only the device may read them
+    __device__
     range operator[](size_type i) const
     {
       size_type first = i * m_block_size;
@@ -217,3 +223,201 @@ aligned_decomposition<Size> make_aligned_decomposition(Size n, Size num_partitio
   return aligned_decomposition<Size>(n,num_partitions,aligned_size);
 }
 
+
+
+// partitions n elements among the devices of a bulk::multi_device launch in proportion
+// to the share of the grid each device executes. Partitions are aligned to tiles and
+// follow the launch's device order, so neighboring partitions lie on peer devices where possible.
+template<typename Size>
+class multi_device_decomposition
+{
+  public:
+    typedef Size size_type;
+
+    typedef thrust::pair<size_type,size_type> range;
+
+    static const int max_num_devices = 16;
+
+    template<typename MultiDeviceLaunch>
+    multi_device_decomposition(Size n, const MultiDeviceLaunch &launch, Size tile_size = 1)
+      : m_n(n),
+        m_num_partitions(thrust::min<int>(launch.size(), max_num_devices)),
+        m_tile_size(tile_size)
+    {
+      size_type num_tiles = (n + m_tile_size - 1) / m_tile_size;
+
+      for(int i = 0; i < m_num_partitions; ++i)
+      {
+        m_devices[i] = launch.device(i);
+        m_first_tile[i] = launch.partition(i, num_tiles).first;
+      }
+
+      m_first_tile[m_num_partitions] = num_tiles;
+    }
+
+    // the split points live in device memory, so only the device may read them
+    __device__
+    range operator[](size_type i) const
+    {
+      size_type first = thrust::min<size_type>(m_n, m_first_tile[i] * m_tile_size);
+      size_type last  = thrust::min<size_type>(m_n, m_first_tile[i+1] * m_tile_size);
+
+      return range(first, last);
+    }
+
+    // returns the device which the ith partition belongs to
+    __host__ __device__
+    int device(size_type i) const
+    {
+      return m_devices[i];
+    }
+
+    __host__ __device__
+    size_type size() const
+    {
+      return m_num_partitions;
+    }
+
+    // XXX think of a better name for this
+    __host__ __device__
+    size_type n() const
+    {
+      return m_n;
+    }
+
+  private:
+    size_type m_n;
+    size_type m_num_partitions;
+    size_type m_tile_size;
+    int       m_devices[max_num_devices];
+    size_type m_first_tile[max_num_devices + 1];
+};
+
+
+template<typename Size, typename MultiDeviceLaunch>
+multi_device_decomposition<Size> make_multi_device_decomposition(Size n, const MultiDeviceLaunch &launch, Size tile_size = 1)
+{
+  return multi_device_decomposition<Size>(n, launch, tile_size);
+}
+
+
+// partitions the merge of two sorted inputs of n1 and n2 elements into partitions of tile_size merged elements,
+// so that each group does the same work however the inputs interleave
+// partition i merges [first1, last1) of the first input with [first2, last2) of the second and
+// its result begins i * tile_size elements into the merged output
+// the split points live in device memory and are located by make_merge_path_decomposition below
+template<typename Size>
+class merge_path_decomposition
+{
+  public:
+    typedef Size size_type;
+
+    // (first1, last1, first2, last2)
+    typedef thrust::tuple<size_type,size_type,size_type,size_type> range;
+
+    __host__ __device__
+    merge_path_decomposition()
+      : m_n(0),
+        m_tile_size(0),
+        m_num_partitions(0),
+        m_merge_paths(0)
+    {}
+
+    // merge_paths must point to num_merge_paths(n1 + n2, tile_size) elements of device memory
+    __host__ __device__
+    merge_path_decomposition(size_type n1, size_type n2, size_type tile_size, size_type *merge_paths)
+      : m_n(n1 + n2),
+        m_tile_size(tile_size),
+        m_num_partitions((n1 + n2 + tile_size - 1) / tile_size),
+        m_merge_paths(merge_paths)
+    {}
+
+    // the split points live in device memory, so only the device may read them
+    __device__
+    range operator[](size_type i) const
+    {
+      size_type diag0 = thrust::min<size_type>(m_n, i * m_tile_size);
+      size_type diag1 = thrust::min<size_type>(m_n, diag0 + m_tile_size);
+
+      size_type mp0 = m_merge_paths[i];
+      size_type mp1 = m_merge_paths[i+1];
+
+      return range(mp0, mp1, diag0 - mp0, diag1 - mp1);
+    }
+
+    __host__ __device__
+    size_type size() const
+    {
+      return m_num_partitions;
+    }
+
+    // XXX think of a better name for this
+    __host__ __device__
+    size_type n() const
+    {
+      return m_n;
+    }
+
+    // the number of split points of the decomposition of n elements, one more than the number of partitions
+    __host__ __device__
+    static size_type num_merge_paths(size_type n, size_type tile_size)
+    {
+      return (n + tile_size - 1) / tile_size + 1;
+    }
+
+    __host__ __device__
+    size_type *merge_paths() const
+    {
+      return m_merge_paths;
+    }
+
+  private:
+    size_type m_n;
+    size_type m_tile_size;
+    size_type m_num_partitions;
+    size_type *m_merge_paths;
+};
+
+
+// each agent locates one split point of a merge_path_decomposition
+struct locate_merge_paths_kernel
+{
+  template<typename RandomAccessIterator1, typename RandomAccessIterator2, typename Size, typename Compare>
+  __device__
+  void operator()(bulk::agent<> &self,
+                  RandomAccessIterator1 first1, Size n1,
+                  RandomAccessIterator2 first2, Size n2,
+                  Size tile_size,
+                  Size *merge_paths,
+                  Compare comp)
+  {
+    Size i = self.index();
+    Size diag = thrust::min<Size>(i * tile_size, n1 + n2);
+
+    merge_paths[i] = bulk::merge_path(first1, n1, first2, n2, diag, comp);
+  }
+};
+
+
+// locates the split points of the merge of [first1, last1) and [first2, last2) with a single launch into stream s,
+// so that a kernel launched afterward into the same stream may partition its work with the result
+// because this does not allocate, it may be recorded with bulk::capture
+template<typename RandomAccessIterator1, typename RandomAccessIterator2, typename Size, typename Compare>
+merge_path_decomposition<Size> make_merge_path_decomposition(RandomAccessIterator1 first1, RandomAccessIterator1 last1,
+                                                             RandomAccessIterator2 first2, RandomAccessIterator2 last2,
+                                                             Size tile_size,
+                                                             Size *merge_paths,
+                                                             Compare comp,
+                                                             cudaStream_t s = 0)
+{
+  Size n1 = last1 - first1;
+  Size n2 = last2 - first2;
+
+  merge_path_decomposition<Size> result(n1, n2, tile_size, merge_paths);
+
+  Size num_merge_paths = merge_path_decomposition<Size>::num_merge_paths(n1 + n2, tile_size);
+
+  bulk::async(bulk::par(s, num_merge_paths), locate_merge_paths_kernel(), bulk::root.this_exec, first1, n1, first2, n2, tile_size, merge_paths, comp);
+
+  return result;
+}
@@ -0,0 +1,332 @@
+#include <iostream>
+#include <algorithm>
+#include <vector>
+#include <utility>
+#include <cassert>
+#include <cstdlib>
+#include <thrust/detail/minmax.h>
+#include <bulk/bulk.hpp>
+#include "decomposition.hpp"
+#include "merge_sort_by_key.hpp"
+#include "time_invocation_cuda.hpp"
+
+
+// an out-of-core stable sort by key of an input in mapped host memory which may be several times the size of the device's
+// 1. sorts runs which fit on the device with stable_merge_sort_by_key, each copied in, sorted and copied back
+// 2. merges pairs of sorted runs, doubling their length each pass until a single run remains
+//    each merge is divided into blocks of run_size results by binary searches of the runs in host memory,
+//    so that each block's inputs are copied to the device and merged there on their own
+// two slots alternate between streams, so that one block's copies overlap its neighbor's sort or merge
+
+
+// stages each group's merge through the heap, as merge_by_key_kernel does
+struct merge_by_key_decomposed_kernel
+{
+  template<std::size_t groupsize,
+           std::size_t grainsize,
+           typename RandomAccessIterator1,
+           typename RandomAccessIterator2,
+           typename Decomposition,
+           typename RandomAccessIterator3,
+           typename RandomAccessIterator4,
+           typename Compare>
+  __device__ void operator()(bulk::concurrent_group<bulk::agent<grainsize>, groupsize> &g,
+                             RandomAccessIterator1 keys_first1, RandomAccessIterator1 keys_first2,
+                             RandomAccessIterator2 values_first1, RandomAccessIterator2 values_first2,
+                             Decomposition decomp,
+                             RandomAccessIterator3 keys_result, RandomAccessIterator4 values_result,
+                             Compare comp)
+  {
+    typedef typename Decomposition::size_type size_type;
+
+    size_type a0, a1, b0, b1;
+    thrust::tie(a0, a1, b0, b1) = decomp[g.index()];
+
+    bulk::merge_by_key(bulk::bound<groupsize*grainsize>(g),
+                       keys_first1 + a0, keys_first1 + a1,
+                       keys_first2 + b0, keys_first2 + b1,
+                       values_first1 + a0,
+                       values_first2 + b0,
+                       keys_result   + a0 + b0,
+                       values_result + a0 + b0,
+                       comp);
+  }
+};
+
+
+// outlives the buffers which return to the pool in its order
+struct owned_stream
+{
+  cudaStream_t s;
+
+  owned_stream()
+  {
+    cudaStreamCreateWithFlags(&s, cudaStreamNonBlocking);
+  }
+
+  ~owned_stream()
+  {
+    cudaStreamSynchronize(s);
+    cudaStreamDestroy(s);
+  }
+};
+
+
+// device memory for one block in flight
+template<typename Key, typename Value>
+struct sort_slot
+{
+  owned_stream                  owner;
+  cudaStream_t                  stream;
+  bulk::temporary_buffer<Key>   keys, keys_result;
+  bulk::temporary_buffer<Value> values, values_result;
+  bulk::temporary_buffer<int>   merge_paths;
+
+  sort_slot(size_t run_size, int num_merge_paths)
+    : stream(owner.s),
+      keys(run_size, stream), keys_result(run_size, stream),
+      values(run_size, stream), values_result(run_size, stream),
+      merge_paths(num_merge_paths, stream)
+  {}
+};
+
+
+// the largest run which fits twice on the device along with the buffers its sort & merges ping-pong with
+template<typename Key, typename Value>
+size_t default_run_size()
+{
+  size_t free_bytes = 0, total_bytes = 0;
+  cudaMemGetInfo(&free_bytes, &total_bytes);
+
+  // two slots, each with an input & result, leaving a tenth for everything else
+  return (free_bytes / 10 * 9) / (4 * (sizeof(Key) + sizeof(Value)));
+}
+
+
+template<typename Key, typename Value, typename Compare>
+void external_merge_sort_by_key(Key *keys, Value *values, size_t n, Compare comp, size_t run_size = default_run_size<Key,Value>())
+{
+  if(n == 0) return;
+
+  // the device's sort indexes with int
+  run_size = thrust::min<size_t>(thrust::min<size_t>(run_size, n), 1 << 30);
+
+  const int groupsize = 128;
+  const int grainsize = 7;
+  const int tile_size = groupsize * grainsize;
+
+  const int num_merge_paths = merge_path_decomposition<int>::num_merge_paths(run_size, tile_size);
+
+  bulk::detail::throw_on_error(cudaDeviceSynchronize(), "external_merge_sort_by_key(): before sorting");
+
+  {
+    sort_slot<Key,Value> slot0(run_size, num_merge_paths), slot1(run_size, num_merge_paths);
+    sort_slot<Key,Value> *slots[2] = {&slot0, &slot1};
+
+    // 1. sort each run in place
+    size_t num_runs = (n + run_size - 1) / run_size;
+
+    for(size_t r = 0; r < num_runs; ++r)
+    {
+      sort_slot<Key,Value> &slot = *slots[r % 2];
+
+      size_t first = r * run_size;
+      size_t m = thrust::min<size_t>(run_size, n - first);
+
+      cudaMemcpyAsync(slot.keys.data(),   keys + first,   m * sizeof(Key),   cudaMemcpyHostToDevice, slot.stream);
+      cudaMemcpyAsync(slot.values.data(), values + first, m * sizeof(Value), cudaMemcpyHostToDevice, slot.stream);
+
+      stable_merge_sort_by_key(slot.keys.data(), slot.keys.data() + m, slot.values.data(), comp, slot.stream);
+
+      cudaMemcpyAsync(keys + first,   slot.keys.data(),   m * sizeof(Key),   cudaMemcpyDeviceToHost, slot.stream);
+      cudaMemcpyAsync(values + first, slot.values.data(), m * sizeof(Value), cudaMemcpyDeviceToHost, slot.stream);
+    }
+
+    cudaStreamSynchronize(slot0.stream);
+    cudaStreamSynchronize(slot1.stream);
+
+    if(num_runs == 1) return;
+
+    // 2. merge pairs of runs, ping-ponging between the input and a scratch copy in host memory
+    Key *keys_scratch = 0;
+    Value *values_scratch = 0;
+    bulk::detail::throw_on_error(cudaHostAlloc(&keys_scratch,   n * sizeof(Key),   cudaHostAllocMapped), "external_merge_sort_by_key(): after cudaHostAlloc");
+    bulk::detail::throw_on_error(cudaHostAlloc(&values_scratch, n * sizeof(Value), cudaHostAllocMapped), "external_merge_sort_by_key(): after cudaHostAlloc");
+
+    Key *keys_src = keys, *keys_dst = keys_scratch;
+    Value *values_src = values, *values_dst = values_scratch;
+
+    // the split points of each merge's blocks
+    bulk::temporary_buffer<long long> block_paths_storage(n / run_size + 2);
+    std::vector<long long> block_paths(block_paths_storage.size());
+
+    size_t block = 0;
+
+    for(size_t width = run_size; width < n; width *= 2)
+    {
+      for(size_t lo = 0; lo < n; lo += 2 * width)
+      {
+        long long n1 = thrust::min<size_t>(width, n - lo);
+        long long n2 = thrust::min<size_t>(width, n - lo - n1);
+
+        Key *d_keys_src = 0;
+        bulk::detail::throw_on_error(cudaHostGetDevicePointer((void**)&d_keys_src, keys_src, 0), "external_merge_sort_by_key(): after cudaHostGetDevicePointer");
+
+        // the binary searches read only a few keys of each run over the bus
+        merge_path_decomposition<long long> blocks =
+          make_merge_path_decomposition(d_keys_src + lo, d_keys_src + lo + n1,
+                                        d_keys_src + lo + n1, d_keys_src + lo + n1 + n2,
+                                        (long long)run_size,
+                                        block_paths_storage.data(),
+                                        comp);
+
+        cudaMemcpy(block_paths.data(), block_paths_storage.data(), (blocks.size() + 1) * sizeof(long long), cudaMemcpyDeviceToHost);
+
+        for(long long i = 0; i < blocks.size(); ++i, ++block)
+        {
+          sort_slot<Key,Value> &slot = *slots[block % 2];
+
+          long long diag0 = i * run_size;
+          long long diag1 = thrust::min<long long>(n1 + n2, diag0 + run_size);
+
+          long long a0 = block_paths[i], a1 = block_paths[i+1];
+          long long b0 = diag0 - a0,     b1 = diag1 - a1;
+
+          int m1 = a1 - a0, m2 = b1 - b0;
+
+          cudaMemcpyAsync(slot.keys.data(),        keys_src + lo + a0,        m1 * sizeof(Key),   cudaMemcpyHostToDevice, slot.stream);
+          cudaMemcpyAsync(slot.keys.data() + m1,   keys_src + lo + n1 + b0,   m2 * sizeof(Key),   cudaMemcpyHostToDevice, slot.stream);
+          cudaMemcpyAsync(slot.values.data(),      values_src + lo + a0,      m1 * sizeof(Value), cudaMemcpyHostToDevice, slot.stream);
+          cudaMemcpyAsync(slot.values.data() + m1, values_src + lo + n1 + b0, m2 * sizeof(Value), cudaMemcpyHostToDevice, slot.stream);
+
+          merge_path_decomposition<int> decomp =
+            make_merge_path_decomposition(slot.keys.data(), slot.keys.data() + m1,
+                                          slot.keys.data() + m1, slot.keys.data() + m1 + m2,
+                                          tile_size,
+                                          slot.merge_paths.data(),
+                                          comp,
+                                          slot.stream);
+
+          int heap_size = tile_size * thrust::max(sizeof(Key), sizeof(int));
+
+          bulk::async(bulk::grid<groupsize,grainsize>(decomp.size(), heap_size, slot.stream),
+                      merge_by_key_decomposed_kernel(),
+                      bulk::root.this_exec,
+                      slot.keys.data(), slot.keys.data() + m1,
+                      slot.values.data(), slot.values.data() + m1,
+                      decomp,
+                      slot.keys_result.data(), slot.values_result.data(),
+                      comp);
+
+          cudaMemcpyAsync(keys_dst + lo + diag0,   slot.keys_result.data(),   (m1 + m2) * sizeof(Key),   cudaMemcpyDeviceToHost, slot.stream);
+          cudaMemcpyAsync(values_dst + lo + diag0, slot.values_result.data(), (m1 + m2) * sizeof(Value), cudaMemcpyDeviceToHost, slot.stream);
+        }
+      }
+
+      // the next pass's binary searches read this pass's results
+      cudaStreamSynchronize(slot0.stream);
+      cudaStreamSynchronize(slot1.stream);
+
+      std::swap(keys_src, keys_dst);
+      std::swap(values_src, values_dst);
+    }
+
+    if(keys_src != keys)
+    {
+      std::copy(keys_src, keys_src + n, keys);
+      std::copy(values_src, values_src + n, values);
+    }
+
+    cudaFreeHost(keys_scratch);
+    cudaFreeHost(values_scratch);
+  }
+
+  bulk::detail::throw_on_error(cudaGetLastError(), "external_merge_sort_by_key(): after sorting");
+}
+
+
+struct my_less
+{
+  template<typename T>
+  __host__ __device__
+  bool operator()(const T &x, const T& y)
+  {
+    return x < y;
+  }
+};
+
+
+// orders by key alone, so that stability is observable
+struct less_key
+{
+  bool operator()(const std::pair<int,int> &x, const std::pair<int,int> &y) const
+  {
+    return x.first < y.first;
+  }
+};
+
+
+void validate(size_t n, size_t run_size)
+{
+  int *keys = 0, *values = 0;
+  cudaHostAlloc(&keys,   n * sizeof(int), cudaHostAllocMapped);
+  cudaHostAlloc(&values, n * sizeof(int), cudaHostAllocMapped);
+
+  std::vector<std::pair<int,int> > ref(n);
+
+  for(size_t i = 0; i < n; ++i)
+  {
+    keys[i] = std::rand() % 1000;
+    values[i] = int(i);
+    ref[i] = std::make_pair(keys[i], values[i]);
+  }
+
+  std::stable_sort(ref.begin(), ref.end(), less_key());
+
+  external_merge_sort_by_key(keys, values, n, my_less(), run_size);
+
+  for(size_t i = 0; i < n; ++i)
+  {
+    assert(keys[i] == ref[i].first);
+    assert(values[i] == ref[i].second);
+  }
+
+  cudaFreeHost(keys);
+  cudaFreeHost(values);
+}
+
+
+int main()
+{
+  cudaSetDeviceFlags(cudaDeviceMapHost);
+
+  // runs much smaller than the input exercise several passes of merges
+  for(size_t n = 1; n <= 1 << 22; n <<= 2)
+  {
+    std::cout << "Testing n = " << n << std::endl;
+    validate(n, 1 << 16);
+    validate(n + 12345, 100000);
+  }
+
+  size_t n = 1 << 26;
+  size_t run_size = 1 << 24;
+
+  int *keys = 0, *values = 0;
+  cudaHostAlloc(&keys,   n * sizeof(int), cudaHostAllocMapped);
+  cudaHostAlloc(&values, n * sizeof(int), cudaHostAllocMapped);
+
+  for(size_t i = 0; i < n; ++i)
+  {
+    keys[i] = std::rand();
+    values[i] = int(i);
+  }
+
+  double msecs = time_invocation_cuda(1, external_merge_sort_by_key<int,int,my_less>, keys, values, n, my_less(), run_size);
+
+  std::cout << "External sort of " << n << " pairs in runs of " << run_size << ": " << msecs << " ms" << std::endl;
+
+  cudaFreeHost(keys);
+  cudaFreeHost(values);
+
+  return 0;
+}
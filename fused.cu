@@ -0,0 +1,104 @@
+#include <bulk/bulk.hpp>
+#include <thrust/device_vector.h>
+#include <thrust/sequence.h>
+#include <thrust/transform.h>
+#include <thrust/reduce.h>
+#include <thrust/functional.h>
+#include <cassert>
+#include <cmath>
+#include <iostream>
+#include "time_invocation_cuda.hpp"
+
+
+// stages of a preprocessing chain
+struct scale
+{
+  typedef float result_type;
+
+  float a;
+
+  __host__ __device__
+  float operator()(float x) const
+  {
+    return a * x;
+  }
+};
+
+
+struct offset
+{
+  typedef float result_type;
+
+  float b;
+
+  __host__ __device__
+  float operator()(float x) const
+  {
+    return x + b;
+  }
+};
+
+
+struct square
+{
+  typedef float result_type;
+
+  __host__ __device__
+  float operator()(float x) const
+  {
+    return x * x;
+  }
+};
+
+
+// each stage a separate pass over memory
+float unfused(const thrust::device_vector<float> *x, thrust::device_vector<float> *tmp)
+{
+  scale s = {2.f};
+  offset o = {-1.f};
+
+  thrust::transform(x->begin(), x->end(), tmp->begin(), s);
+  thrust::transform(tmp->begin(), tmp->end(), tmp->begin(), o);
+  thrust::transform(tmp->begin(), tmp->end(), tmp->begin(), square());
+
+  return thrust::reduce(tmp->begin(), tmp->end(), 0.f);
+}
+
+
+// one pass: the intermediates stay in registers
+float fused(const thrust::device_vector<float> *x)
+{
+  scale s = {2.f};
+  offset o = {-1.f};
+
+  return bulk::fused(x->begin(), x->end()).then(s).then(o).then(square()).reduce(0.f, thrust::plus<float>());
+}
+
+
+int main()
+{
+  size_t n = 1 << 24;
+
+  thrust::device_vector<float> x(n), tmp(n);
+  thrust::sequence(x.begin(), x.end(), 0.f, 1.f / n);
+
+  float expected = unfused(&x, &tmp);
+  float result = fused(&x);
+
+  std::cout << "unfused: " << expected << std::endl;
+  std::cout << "fused:   " << result << std::endl;
+
+  assert(std::abs(result - expected) <= 1e-3f * std::abs(expected));
+
+  // the chain may also be materialized in a single launch
+  scale s = {2.f};
+  bulk::fused(x.begin(), x.end()).then(s).then(square()).copy(tmp.begin());
+
+  double unfused_msecs = time_invocation_cuda(20, unfused, &x, &tmp);
+  double fused_msecs   = time_invocation_cuda(20, fused, &x);
+
+  std::cout << "Unfused time: " << unfused_msecs << " ms" << std::endl;
+  std::cout << "Fused time:   " << fused_msecs << " ms" << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,102 @@
+#include <iostream>
+#include <cassert>
+#include <thrust/device_vector.h>
+#include <thrust/host_vector.h>
+#include <thrust/sort.h>
+#include <thrust/binary_search.h>
+#include <thrust/adjacent_difference.h>
+#include <thrust/iterator/counting_iterator.h>
+#include <thrust/tabulate.h>
+#include <bulk/bulk.hpp>
+#include "time_invocation_cuda.hpp"
+
+
+// makes values which cluster about the low bins, as telemetry tends to
+struct skewed_value
+{
+  int range;
+
+  __host__ __device__
+  skewed_value(int range) : range(range) {}
+
+  __host__ __device__
+  int operator()(int x) const
+  {
+    x = (x+0x7ed55d16) + (x<<12);
+    x = (x^0xc761c23c) ^ (x>>19);
+    x = (x+0x165667b1) + (x<<5);
+    x = (x+0xd3a2646c) ^ (x<<9);
+    x = (x+0xfd7046c5) + (x<<3);
+    x = (x^0xb55a4f09) ^ (x>>16);
+
+    unsigned int u = x;
+    return (u % range) & (u >> 16) % range;
+  }
+};
+
+
+void validate(int n, int num_bins)
+{
+  thrust::device_vector<int> values(n);
+  thrust::tabulate(values.begin(), values.end(), skewed_value(num_bins));
+
+  thrust::device_vector<unsigned int> bins(num_bins);
+  bulk::histogram(values.begin(), values.end(), thrust::raw_pointer_cast(bins.data()), num_bins);
+
+  cudaError_t error = cudaDeviceSynchronize();
+  if(error)
+  {
+    std::cout << "CUDA error: " << cudaGetErrorString(error) << std::endl;
+  }
+
+  // the thrust histogram: sort, then difference the upper bounds of each bin
+  thrust::device_vector<int> sorted = values;
+  thrust::sort(sorted.begin(), sorted.end());
+
+  thrust::device_vector<unsigned int> ref(num_bins);
+  thrust::upper_bound(sorted.begin(), sorted.end(), thrust::counting_iterator<int>(0), thrust::counting_iterator<int>(num_bins), ref.begin());
+  thrust::adjacent_difference(ref.begin(), ref.end(), ref.begin());
+
+  assert(ref == bins);
+}
+
+
+void my_histogram(const thrust::device_vector<int> *values, thrust::device_vector<unsigned int> *bins)
+{
+  bulk::histogram(values->begin(), values->end(), thrust::raw_pointer_cast(bins->data()), int(bins->size()));
+}
+
+
+void compare(int n, int num_bins)
+{
+  thrust::device_vector<int> values(n);
+  thrust::tabulate(values.begin(), values.end(), skewed_value(num_bins));
+
+  thrust::device_vector<unsigned int> bins(num_bins);
+
+  my_histogram(&values, &bins);
+  double msecs = time_invocation_cuda(20, my_histogram, &values, &bins);
+
+  std::cout << "N: " << n << " into " << num_bins << " bins" << std::endl;
+  std::cout << "  My time: " << msecs << " ms" << std::endl;
+  std::cout << "  My bandwidth: " << double(sizeof(int) * n) / (msecs / 1000) / 1e9 << " GB/s" << std::endl;
+}
+
+
+int main()
+{
+  // the largest counts of bins don't fit on chip, so they exercise the fallback to global atomics
+  for(int num_bins = 1; num_bins <= 1 << 16; num_bins *= 4)
+  {
+    std::cout << "Testing " << num_bins << " bins" << std::endl;
+
+    validate(0, num_bins);
+    validate(1, num_bins);
+    validate(1 << 20, num_bins);
+  }
+
+  compare(1 << 26, 256);
+  compare(1 << 26, 1 << 16);
+
+  return 0;
+}
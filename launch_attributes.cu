@@ -0,0 +1,67 @@
+#include <iostream>
+#include <cassert>
+#include <bulk/bulk.hpp>
+#include <thrust/device_vector.h>
+#include <thrust/sequence.h>
+#include <thrust/tabulate.h>
+#include <thrust/logical.h>
+
+// a latency-critical lookup sharing the device with a batch job:
+// the lookup runs at a greater priority and asks for its table to persist in L2
+
+struct lookup
+{
+  __device__
+  void operator()(bulk::agent<> &self, const int *table, int table_size, const int *keys, int *result)
+  {
+    result[self.index()] = table[keys[self.index()] % table_size];
+  }
+};
+
+struct batch_job
+{
+  __device__
+  void operator()(bulk::agent<> &self, float *x)
+  {
+    for(int i = 0; i < 64; ++i)
+    {
+      x[self.index()] = x[self.index()] * 0.5f + 1.f;
+    }
+  }
+};
+
+int main()
+{
+  const int table_size = 1 << 20;
+  const int n = 1 << 22;
+
+  thrust::device_vector<int> table(table_size);
+  thrust::sequence(table.begin(), table.end());
+
+  thrust::device_vector<int> keys(n);
+  thrust::tabulate(keys.begin(), keys.end(), thrust::placeholders::_1 * 7);
+
+  thrust::device_vector<int> result(n);
+  thrust::device_vector<float> x(n, 1);
+
+  // hold the table's lines in L2 for the launches which ask for it
+  bulk::reserve_persisting_l2(table_size * sizeof(int));
+
+  const int *raw_table = thrust::raw_pointer_cast(table.data());
+
+  // the batch job takes the least priority
+  bulk::future<void> batch = bulk::async(bulk::in_own_stream(bulk::par(n)), batch_job(), bulk::root.this_exec, thrust::raw_pointer_cast(x.data()));
+
+  // the lookup gets a stream of greater priority from the pool and a window over its table
+  bulk::future<void> critical = bulk::async(bulk::in_own_stream(bulk::par(n)).with_priority(-1).with_persisting_window(raw_table, table_size * sizeof(int), 1.f),
+                                            lookup(), bulk::root.this_exec, raw_table, table_size, thrust::raw_pointer_cast(keys.data()), thrust::raw_pointer_cast(result.data()));
+
+  critical.wait();
+  batch.wait();
+
+  assert(result[3] == (3 * 7) % table_size);
+
+  std::cout << "It worked!" << std::endl;
+
+  return 0;
+}
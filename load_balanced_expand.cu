@@ -0,0 +1,146 @@
+#include <iostream>
+#include <cassert>
+#include <thrust/device_vector.h>
+#include <thrust/host_vector.h>
+#include <thrust/random.h>
+#include <thrust/fill.h>
+#include <bulk/bulk.hpp>
+#include "time_invocation_cuda.hpp"
+
+
+// makes num_rows row offsets whose sizes range from empty to most of the work, as a power-law graph's would
+thrust::host_vector<int> skewed_offsets(int num_rows, thrust::default_random_engine &rng)
+{
+  thrust::host_vector<int> offsets(num_rows + 1);
+
+  offsets[0] = 0;
+  for(int r = 0; r < num_rows; ++r)
+  {
+    int size = 0;
+
+    switch(rng() % 4)
+    {
+      case 0: size = 0;                   break;
+      case 1: size = 1;                   break;
+      case 2: size = rng() % 1000;        break;
+      case 3: size = rng() % (1 << 20);   break;
+    }
+
+    offsets[r + 1] = offsets[r] + size;
+  }
+
+  return offsets;
+}
+
+
+// expands a CSR work list into a (row, rank) pair per item, e.g. the row index of each nonzero of a sparse matrix
+struct expand
+{
+  const int *offsets;
+  int *rows;
+  int *ranks;
+
+  __device__
+  void operator()(int row, int rank)
+  {
+    int i = offsets[row] + rank;
+
+    rows[i]  = row;
+    ranks[i] = rank;
+  }
+};
+
+
+struct expand_kernel
+{
+  template<typename ConcurrentGroup>
+  __device__
+  void operator()(ConcurrentGroup &g, const int *offsets_first, const int *offsets_last, expand f)
+  {
+    bulk::load_balanced_for_each(g, offsets_first, offsets_last, f);
+  }
+};
+
+
+void validate(int num_rows)
+{
+  thrust::default_random_engine rng(num_rows);
+
+  thrust::host_vector<int> h_offsets = skewed_offsets(num_rows, rng);
+  int n = h_offsets.back();
+
+  thrust::host_vector<int> h_rows(n), h_ranks(n);
+  for(int r = 0; r < num_rows; ++r)
+  {
+    for(int i = h_offsets[r]; i < h_offsets[r+1]; ++i)
+    {
+      h_rows[i]  = r;
+      h_ranks[i] = i - h_offsets[r];
+    }
+  }
+
+  thrust::device_vector<int> d_offsets = h_offsets;
+  thrust::device_vector<int> d_rows(n, -1), d_ranks(n, -1);
+
+  expand f = {thrust::raw_pointer_cast(d_offsets.data()), thrust::raw_pointer_cast(d_rows.data()), thrust::raw_pointer_cast(d_ranks.data())};
+
+  // device-wide
+  bulk::load_balanced_for_each(d_offsets.begin(), d_offsets.end(), f);
+
+  cudaError_t error = cudaDeviceSynchronize();
+
+  if(error)
+  {
+    std::cerr << "CUDA error: " << cudaGetErrorString(error) << std::endl;
+  }
+
+  assert(h_rows == d_rows);
+  assert(h_ranks == d_ranks);
+
+  // within a single group
+  thrust::fill(d_rows.begin(), d_rows.end(), -1);
+  thrust::fill(d_ranks.begin(), d_ranks.end(), -1);
+
+  bulk::async(bulk::con<256,3>(0), expand_kernel(), bulk::root, f.offsets, f.offsets + num_rows + 1, f).wait();
+
+  assert(h_rows == d_rows);
+  assert(h_ranks == d_ranks);
+}
+
+
+void my_expand(thrust::device_vector<int> *offsets, expand f)
+{
+  bulk::load_balanced_for_each(offsets->begin(), offsets->end(), f);
+}
+
+
+void compare(int num_rows)
+{
+  thrust::default_random_engine rng;
+
+  thrust::device_vector<int> offsets = skewed_offsets(num_rows, rng);
+  thrust::device_vector<int> rows(offsets.back()), ranks(offsets.back());
+
+  expand f = {thrust::raw_pointer_cast(offsets.data()), thrust::raw_pointer_cast(rows.data()), thrust::raw_pointer_cast(ranks.data())};
+
+  my_expand(&offsets, f);
+  double msecs = time_invocation_cuda(20, my_expand, &offsets, f);
+
+  std::cout << "N: " << rows.size() << " in " << num_rows << " rows" << std::endl;
+  std::cout << "  My time: " << msecs << " ms" << std::endl;
+  std::cout << "  My bandwidth: " << double(2 * sizeof(int) * rows.size()) / (msecs / 1000) / 1e9 << " GB/s" << std::endl;
+}
+
+
+int main()
+{
+  for(int num_rows = 1; num_rows <= 1 << 12; num_rows <<= 1)
+  {
+    std::cout << "Testing " << num_rows << " rows" << std::endl;
+    validate(num_rows);
+  }
+
+  compare(1 << 12);
+
+  return 0;
+}
@@ -1,12 +1,13 @@
 #include <iostream>
+#include <climits>
 #include <moderngpu.cuh>
 #include <thrust/device_vector.h>
 #include <thrust/merge.h>
 #include <thrust/sort.h>
-#include <thrust/detail/temporary_array.h>
 #include <bulk/bulk.hpp>
 #include "join_iterator.hpp"
 #include "time_invocation_cuda.hpp"
+#include "decomposition.hpp"
 
 
 template<std::size_t groupsize, std::size_t grainsize, typename RandomAccessIterator1, typename Size,typename RandomAccessIterator2, typename RandomAccessIterator3, typename RandomAccessIterator4, typename Compare>
@@ -31,43 +32,41 @@ RandomAccessIterator4
                       comp);
   
   // copy to the result
-  // XXX this might be slightly faster with a bounded copy_n
-  return bulk::copy_n(exec, stage, n1 + n2, result);
+  return bulk::copy_n(bulk::bound<groupsize * grainsize>(exec), stage, n1 + n2, result);
 } // end staged_merge()
 
 
 struct merge_kernel
 {
-  template<std::size_t groupsize, std::size_t grainsize, typename RandomAccessIterator1, typename Size, typename RandomAccessIterator2, typename RandomAccessIterator3, typename RandomAccessIterator4, typename Compare>
+  template<std::size_t groupsize, std::size_t grainsize, typename RandomAccessIterator1, typename RandomAccessIterator2, typename Decomposition, typename RandomAccessIterator3, typename Compare>
   __device__
   void operator()(bulk::concurrent_group<bulk::agent<grainsize>,groupsize> &g,
-                  RandomAccessIterator1 first1, Size n1,
-                  RandomAccessIterator2 first2, Size n2,
-                  RandomAccessIterator3 merge_paths_first,
-                  RandomAccessIterator4 result,
+                  RandomAccessIterator1 first1,
+                  RandomAccessIterator2 first2,
+                  Decomposition decomp,
+                  RandomAccessIterator3 result,
                   Compare comp)
   {
-    typedef int size_type;
-
-    size_type elements_per_group = g.size() * g.this_exec.grainsize();
+    typedef typename Decomposition::size_type size_type;
 
     // determine the ranges to merge
-    size_type mp0  = merge_paths_first[g.index()];
-    size_type mp1  = merge_paths_first[g.index()+1];
-    size_type diag = elements_per_group * g.index();
+    typename Decomposition::range range = decomp[g.index()];
+
+    // a partition is only a tile wide, so only its offsets need size_type
+    int local_size1 = thrust::get<1>(range) - thrust::get<0>(range);
+    int local_size2 = thrust::get<3>(range) - thrust::get<2>(range);
 
-    size_type local_size1 = mp1 - mp0;
-    size_type local_size2 = thrust::min<size_type>(n1 + n2, diag + elements_per_group) - mp1 - diag + mp0;
+    // the partition's result begins where its inputs do in the merged order
+    result += thrust::get<0>(range) + thrust::get<2>(range);
 
-    first1 += mp0;
-    first2 += diag - mp0;
-    result += elements_per_group * g.index();
+    first1 += thrust::get<0>(range);
+    first2 += thrust::get<2>(range);
 
-    typedef typename thrust::iterator_value<RandomAccessIterator4>::type value_type;
+    typedef typename thrust::iterator_value<RandomAccessIterator3>::type value_type;
 
 #if __CUDA_ARCH__ >= 200
     // merge through a stage
-    value_type *stage = reinterpret_cast<value_type*>(bulk::malloc(g, elements_per_group * sizeof(value_type)));
+    value_type *stage = reinterpret_cast<value_type*>(bulk::malloc(g, g.size() * g.this_exec.grainsize() * sizeof(value_type)));
 
     if(bulk::is_on_chip(stage))
     {
@@ -97,31 +96,43 @@ struct merge_kernel
 }; // end merge_kernel
 
 
-template<typename Size, typename RandomAccessIterator1,typename RandomAccessIterator2, typename Compare>
-struct locate_merge_path
+// Size is the type of the merge's path math: int when the merged result fits, wider when it does not
+template<typename Size,
+         typename RandomAccessIterator1,
+         typename RandomAccessIterator2,
+         typename RandomAccessIterator3,
+         typename Compare>
+RandomAccessIterator3 my_merge_n(RandomAccessIterator1 first1,
+                                 RandomAccessIterator1 last1,
+                                 RandomAccessIterator2 first2,
+                                 RandomAccessIterator2 last2,
+                                 RandomAccessIterator3 result,
+                                 Compare comp)
 {
-  Size partition_size;
-  RandomAccessIterator1 first1, last1;
-  RandomAccessIterator2 first2, last2;
-  Compare comp;
-
-  locate_merge_path(Size partition_size, RandomAccessIterator1 first1, RandomAccessIterator1 last1, RandomAccessIterator2 first2, RandomAccessIterator2 last2, Compare comp)
-    : partition_size(partition_size),
-      first1(first1), last1(last1),
-      first2(first2), last2(last2),
-      comp(comp)
-  {}
-
-  template<typename Index>
-  __device__
-  Size operator()(Index i)
-  {
-    Size n1 = last1 - first1;
-    Size n2 = last2 - first2;
-    Size diag = thrust::min<Size>(partition_size * i, n1 + n2);
-    return bulk::merge_path(first1, n1, first2, n2, diag, comp);
-  }
-};
+  typedef typename thrust::iterator_value<RandomAccessIterator1>::type value_type;
+  typedef Size size_type;
+
+  // 90/86/97
+  const int groupsize = (sizeof(value_type) == sizeof(int)) ? 256 : 256 + 32;
+  const int grainsize = (sizeof(value_type) == sizeof(int)) ? 9   : 5;
+  
+  const size_type tile_size = groupsize * grainsize;
+
+  size_type n = (last1 - first1) + (last2 - first2);
+  size_type num_groups = (n + tile_size - 1) / tile_size;
+
+  bulk::temporary_buffer<size_type> merge_paths(merge_path_decomposition<size_type>::num_merge_paths(n, tile_size));
+
+  merge_path_decomposition<size_type> decomp =
+    make_merge_path_decomposition(first1, last1, first2, last2, tile_size, merge_paths.data(), comp);
+
+  // merge partitions
+  int heap_size = tile_size * sizeof(value_type);
+  bulk::concurrent_group<bulk::agent<grainsize>,groupsize> g(heap_size);
+  bulk::async(bulk::par(g, num_groups), merge_kernel(), bulk::root.this_exec, first1, first2, decomp, result, comp);
+
+  return result + n;
+} // end my_merge_n()
 
 
 template<typename RandomAccessIterator1,
@@ -135,30 +146,17 @@ RandomAccessIterator3 my_merge(RandomAccessIterator1 first1,
                                RandomAccessIterator3 result,
                                Compare comp)
 {
-  typedef typename thrust::iterator_value<RandomAccessIterator1>::type value_type;
   typedef typename thrust::iterator_difference<RandomAccessIterator1>::type difference_type;
-  typedef int size_type;
-
-  // 90/86/97
-  const size_type groupsize = (sizeof(value_type) == sizeof(int)) ? 256 : 256 + 32;
-  const size_type grainsize = (sizeof(value_type) == sizeof(int)) ? 9   : 5;
-  
-  const size_type tile_size = groupsize * grainsize;
 
   difference_type n = (last1 - first1) + (last2 - first2);
-  difference_type num_groups = (n + tile_size - 1) / tile_size;
-
-  thrust::cuda::tag t;
-  thrust::detail::temporary_array<size_type,thrust::cuda::tag> merge_paths(t, num_groups + 1);
-
-  thrust::tabulate(merge_paths.begin(), merge_paths.end(), locate_merge_path<size_type,RandomAccessIterator1,RandomAccessIterator2,Compare>(tile_size,first1,last1,first2,last2,comp));
 
-  // merge partitions
-  size_type heap_size = tile_size * sizeof(value_type);
-  bulk::concurrent_group<bulk::agent<grainsize>,groupsize> g(heap_size);
-  bulk::async(bulk::par(g, num_groups), merge_kernel(), bulk::root.this_exec, first1, last1 - first1, first2, last2 - first2, merge_paths.begin(), result, comp);
+  // 32-bit path math is the fast path, so only pay for 64 bits when the result doesn't fit
+  if(n <= INT_MAX)
+  {
+    return my_merge_n<int>(first1, last1, first2, last2, result, comp);
+  } // end if
 
-  return result + n;
+  return my_merge_n<long long>(first1, last1, first2, last2, result, comp);
 } // end merge()
 
 
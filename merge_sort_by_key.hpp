@@ -0,0 +1,269 @@
+#pragma once
+
+#include <thrust/tuple.h>
+#include <thrust/iterator/iterator_traits.h>
+#include <thrust/detail/minmax.h>
+#include <thrust/detail/function.h>
+#include <thrust/detail/integer_math.h>
+#include <bulk/bulk.hpp>
+
+
+// a stable merge sort by key of groupsize * grainsize tiles, each sorted by a single group
+// and then merged pairwise, ping-ponging between the input and a temporary buffer
+
+
+template<typename ConcurrentGroup, typename RandomAccessIterator1, typename RandomAccessIterator2, typename Compare>
+struct sort_tile
+{
+  ConcurrentGroup &g;
+  RandomAccessIterator1 keys_first;
+  RandomAccessIterator1 keys_last;
+  RandomAccessIterator2 values_first;
+  Compare comp;
+
+  __device__
+  sort_tile(ConcurrentGroup &g, RandomAccessIterator1 keys_first, RandomAccessIterator1 keys_last, RandomAccessIterator2 values_first, Compare comp)
+    : g(g), keys_first(keys_first), keys_last(keys_last), values_first(values_first), comp(comp)
+  {}
+
+  template<std::size_t bound>
+  __device__
+  void operator()(bulk::bound_constant<bound>)
+  {
+    bulk::stable_sort_by_key(bulk::bound<bound>(g), keys_first, keys_last, values_first, comp);
+  }
+};
+
+
+struct stable_sort_each_kernel
+{
+  template<std::size_t groupsize, std::size_t grainsize, typename RandomAccessIterator1, typename RandomAccessIterator2, typename Compare>
+  __device__ void operator()(bulk::concurrent_group<bulk::agent<grainsize>, groupsize> &g, RandomAccessIterator1 keys_first, RandomAccessIterator2 values_first, int count, Compare comp)
+  {
+    typedef typename bulk::concurrent_group<bulk::agent<grainsize>,groupsize>::size_type size_type;
+    const size_type tilesize = groupsize * grainsize;
+  
+    size_type gid = tilesize * g.index();
+    size_type count2 = thrust::min<size_type>(tilesize, count - gid);
+  
+    // the last tile may be partial, so give it the smallest bound which covers it
+    sort_tile<
+      bulk::concurrent_group<bulk::agent<grainsize>, groupsize>,
+      RandomAccessIterator1,
+      RandomAccessIterator2,
+      Compare
+    > f(g, keys_first + gid, keys_first + gid + count2, values_first + gid, comp);
+
+    bulk::dispatch_bound<tilesize / 8, tilesize / 4, tilesize / 2, tilesize>(count2, f);
+  }
+};
+
+
+template<typename Size>
+__device__
+thrust::tuple<Size,Size,Size,Size>
+  locate_merge_partitions(Size n, Size group_idx, Size num_groups_per_merge, Size num_elements_per_group, Size mp, Size right_mp)
+{
+  Size first_group_in_partition = ~(num_groups_per_merge - 1) & group_idx;
+  Size partition_size = num_elements_per_group * (num_groups_per_merge >> 1);
+
+  Size partition_first1 = num_elements_per_group * first_group_in_partition;
+  Size partition_first2 = partition_first1 + partition_size;
+
+  // Locate diag from the start of the A sublist.
+  Size diag = num_elements_per_group * group_idx - partition_first1;
+  Size start1 = partition_first1 + mp;
+  Size end1 = thrust::min<Size>(n, partition_first1 + right_mp);
+  Size start2 = thrust::min<Size>(n, partition_first2 + diag - mp);
+  Size end2 = thrust::min<Size>(n, partition_first2 + diag + num_elements_per_group - right_mp);
+  
+  // The end partition of the last group for each merge operation is computed
+  // and stored as the begin partition for the subsequent merge. i.e. it is
+  // the same partition but in the wrong coordinate system, so its 0 when it
+  // should be listSize. Correct that by checking if this is the last group
+  // in this merge operation.
+  if(num_groups_per_merge - 1 == ((num_groups_per_merge - 1) & group_idx))
+  {
+    end1 = thrust::min<Size>(n, partition_first1 + partition_size);
+    end2 = thrust::min<Size>(n, partition_first2 + partition_size);
+  }
+
+  return thrust::make_tuple(start1, end1, start2, end2);
+}
+
+
+struct merge_by_key_kernel
+{
+  template<std::size_t groupsize,
+           std::size_t grainsize,
+           typename RandomAccessIterator1, 
+	   typename RandomAccessIterator2,
+           typename RandomAccessIterator3,
+	   typename RandomAccessIterator4,
+	   typename RandomAccessIterator5,
+           typename Compare>
+  __device__ void operator()(bulk::concurrent_group<bulk::agent<grainsize>, groupsize> &g, RandomAccessIterator1 keys_first, RandomAccessIterator2 values_first, unsigned int n, RandomAccessIterator3 merge_paths, int num_groups_per_merge, RandomAccessIterator4 keys_result, RandomAccessIterator5 values_result, Compare comp)
+  {
+    typedef typename bulk::concurrent_group<bulk::agent<grainsize>, groupsize>::size_type size_type;
+
+    size_type a0, a1, b0, b1;
+    thrust::tie(a0, a1, b0, b1) = locate_merge_partitions<size_type>(n, g.index(), num_groups_per_merge, groupsize * grainsize, merge_paths[g.index()], merge_paths[g.index()+1]);
+    
+    bulk::merge_by_key(bulk::bound<groupsize*grainsize>(g),
+                       keys_first + a0, keys_first + a1,
+                       keys_first + b0, keys_first + b1,
+                       values_first + a0,
+                       values_first + b0,
+                       keys_result   + groupsize * grainsize * g.index(),
+                       values_result + groupsize * grainsize * g.index(),
+                       comp);
+  }
+};
+
+
+template<typename Iterator, typename Size, typename Compare>
+struct locate_merge_path
+{
+  Iterator haystack_first;
+  Size haystack_size;
+  Size num_elements_per_group;
+  Size num_groups_per_merge;
+  thrust::detail::wrapped_function<Compare,bool> comp;
+
+  locate_merge_path(Iterator haystack_first, Size haystack_size, Size num_elements_per_group, Size num_groups_per_merge, Compare comp)
+    : haystack_first(haystack_first),
+      haystack_size(haystack_size),
+      num_elements_per_group(num_elements_per_group),
+      num_groups_per_merge(num_groups_per_merge),
+      comp(comp)
+  {}
+
+  template<typename Index>
+  __host__ __device__
+  Index operator()(Index merge_path_idx)
+  {
+    // find the index of the first group that will participate in the eventual merge
+    Size first_group_in_partition = ~(num_groups_per_merge - 1) & merge_path_idx;
+
+    // the size of each group's input
+    Size size = num_elements_per_group * (num_groups_per_merge / 2);
+
+    // find pointers to the two input arrays
+    Size start1 = num_elements_per_group * first_group_in_partition;
+    Size start2 = thrust::min<Size>(haystack_size, start1 + size);
+
+    // the size of each input array
+    // note we clamp to the end of the total input to handle the last partial list
+    Size n1 = thrust::min<Size>(size, haystack_size - start1);
+    Size n2 = thrust::min<Size>(size, haystack_size - start2);
+    
+    // note that diag is computed as an offset from the beginning of the first list
+    Size diag = thrust::min<Size>(n1 + n2, num_elements_per_group * merge_path_idx - start1);
+
+    return bulk::merge_path(haystack_first + start1, n1, haystack_first + start2, n2, diag, comp);
+  }
+};
+
+
+struct tabulate_kernel
+{
+  template<typename Iterator, typename Function>
+  __device__
+  void operator()(bulk::agent<> &self, Iterator result, Function f)
+  {
+    int i = self.index();
+    result[i] = f(i);
+  }
+};
+
+
+template<typename Iterator1, typename Size1, typename Iterator2, typename Size2, typename Size3, typename Compare>
+void locate_merge_paths_(cudaStream_t s,
+                         Iterator1 result,
+                         Size1 n,
+                         Iterator2 haystack_first,
+                         Size2 haystack_size,
+                         Size3 num_elements_per_group,
+                         Size3 num_groups_per_merge,
+                         Compare comp)
+{
+  locate_merge_path<Iterator2,Size2,Compare> f(haystack_first, haystack_size, num_elements_per_group, num_groups_per_merge, comp);
+
+  bulk::async(bulk::par(s, n), tabulate_kernel(), bulk::root.this_exec, result, f);
+}
+
+
+struct copy_n_kernel
+{
+  template<typename Iterator1, typename Iterator2>
+  __device__
+  void operator()(bulk::agent<> &self, Iterator1 first, Iterator2 result)
+  {
+    int i = self.index();
+    result[i] = first[i];
+  }
+};
+
+
+// sorts in stream s, without waiting for the sort to complete
+template<typename RandomAccessIterator1, typename RandomAccessIterator2, typename Compare>
+void stable_merge_sort_by_key(RandomAccessIterator1 keys_first, RandomAccessIterator1 keys_last, RandomAccessIterator2 values_first, Compare comp, cudaStream_t s = 0)
+{
+  typename thrust::iterator_difference<RandomAccessIterator1>::type n = keys_last - keys_first;
+
+  if(n <= 0) return;
+
+  typedef typename thrust::iterator_value<RandomAccessIterator1>::type key_type;
+  typedef typename thrust::iterator_value<RandomAccessIterator2>::type value_type;
+
+  typedef int size_type;
+
+  // 78/77/92
+  const size_type groupsize = 128;
+  const size_type grainsize = 7;
+  
+  const size_type tilesize = groupsize * grainsize;
+  size_type num_groups = (n + tilesize - 1) / tilesize;
+  size_type num_passes = thrust::detail::log2_ri(num_groups);
+
+  size_type heap_size = tilesize * thrust::max(sizeof(key_type), sizeof(value_type));
+  bulk::async(bulk::grid<groupsize,grainsize>(num_groups, heap_size, s), stable_sort_each_kernel(), bulk::root.this_exec, keys_first, values_first, n, comp);
+
+  // ping being true means the latest data is in the source array
+  bool ping = true;
+  bulk::temporary_buffer<key_type>   keys_pong_storage(n, s);
+  bulk::temporary_buffer<value_type> values_pong_storage(n, s);
+
+  thrust::device_ptr<key_type>   keys_pong   = thrust::device_pointer_cast(keys_pong_storage.data());
+  thrust::device_ptr<value_type> values_pong = thrust::device_pointer_cast(values_pong_storage.data());
+
+  bulk::temporary_buffer<size_type> merge_paths_storage(num_groups + 1, s);
+  thrust::device_ptr<size_type> merge_paths = thrust::device_pointer_cast(merge_paths_storage.data());
+  
+  // merge_by_key_kernel's heap requirements differ
+  heap_size = tilesize * thrust::max(sizeof(key_type), sizeof(size_type));
+
+  for(size_type pass = 0; pass < num_passes; ++pass, ping = !ping) 
+  {
+    size_type num_groups_per_merge = 2 << pass;
+
+    if(ping)
+    {
+      locate_merge_paths_(s, merge_paths, merge_paths_storage.size(), keys_first, n, tilesize, num_groups_per_merge, comp);
+      
+      bulk::async(bulk::grid<groupsize,grainsize>(num_groups, heap_size, s), merge_by_key_kernel(), bulk::root.this_exec, keys_first, values_first, n, merge_paths, num_groups_per_merge, keys_pong, values_pong, comp);
+    }
+    else
+    {
+      locate_merge_paths_(s, merge_paths, merge_paths_storage.size(), keys_pong, n, tilesize, num_groups_per_merge, comp);
+      
+      bulk::async(bulk::grid<groupsize,grainsize>(num_groups, heap_size, s), merge_by_key_kernel(), bulk::root.this_exec, keys_pong, values_pong, n, merge_paths, num_groups_per_merge, keys_first, values_first, comp);
+    }
+  }
+
+  if(!ping)
+  {
+    bulk::async(bulk::par(s, n), copy_n_kernel(), bulk::root.this_exec, keys_pong, keys_first);
+    bulk::async(bulk::par(s, n), copy_n_kernel(), bulk::root.this_exec, values_pong, values_first);
+  }
+}
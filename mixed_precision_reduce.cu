@@ -0,0 +1,99 @@
+#include <cstdio>
+#include <bulk/bulk.hpp>
+#include <thrust/device_vector.h>
+#include <thrust/functional.h>
+#include <cassert>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+
+// small integers are exact in half & bfloat16, and so are their sums in float, so the results compare exactly
+float to_float(__half x) { return __half2float(x); }
+__half to_half(float x) { return __float2half(x); }
+
+#if __BULK_HAS_BFLOAT16__
+float to_float(__nv_bfloat16 x) { return __bfloat162float(x); }
+__nv_bfloat16 to_bfloat16(float x) { return __float2bfloat16(x); }
+#endif
+
+
+struct group_reduce
+{
+  template<typename ConcurrentGroup, typename Half>
+  __device__
+  void operator()(ConcurrentGroup &g, Half *first, Half *last, float *result)
+  {
+    float sum = bulk::reduce(g, first, last, 13.f, thrust::plus<float>());
+
+    if(g.this_exec.index() == 0)
+    {
+      *result = sum;
+    }
+  }
+};
+
+
+template<typename Half>
+void validate(const std::vector<Half> &h_input, size_t offset, size_t n)
+{
+  float expected = 13;
+  for(size_t i = offset; i < offset + n; ++i)
+  {
+    expected += to_float(h_input[i]);
+  }
+
+  thrust::device_vector<Half> input(h_input.begin(), h_input.end());
+
+  // an odd offset misaligns the first pair, and an odd n leaves a tail
+  Half *first = thrust::raw_pointer_cast(input.data()) + offset;
+  Half *last  = first + n;
+
+  // the device-wide reduction's tiles take the packed path
+  float result = bulk::reduce(first, last, 13.f, thrust::plus<float>());
+  assert(result == expected);
+
+  thrust::device_vector<float> d_result(1);
+
+  // as does a single group of static size
+  bulk::async(bulk::con<128,4>(0), group_reduce(), bulk::root, first, last, thrust::raw_pointer_cast(d_result.data()));
+  assert(float(d_result[0]) == expected);
+
+  // while a group of dynamic size takes the generic path
+  bulk::async(bulk::con(128), group_reduce(), bulk::root, first, last, thrust::raw_pointer_cast(d_result.data()));
+  assert(float(d_result[0]) == expected);
+}
+
+
+template<typename Half, typename Convert>
+void validate_sizes(Convert convert)
+{
+  std::vector<Half> h_input((1 << 16) + 1);
+
+  for(size_t i = 0; i < h_input.size(); ++i)
+  {
+    h_input[i] = convert(float(std::rand() % 8));
+  }
+
+  size_t sizes[] = {0, 1, 2, 3, 255, 256, 1000, 1 << 16};
+
+  for(size_t i = 0; i < sizeof(sizes) / sizeof(size_t); ++i)
+  {
+    validate(h_input, 0, sizes[i]);
+    validate(h_input, 1, sizes[i]);
+  }
+}
+
+
+int main()
+{
+  validate_sizes<__half>(to_half);
+
+#if __BULK_HAS_BFLOAT16__
+  validate_sizes<__nv_bfloat16>(to_bfloat16);
+#endif
+
+  std::cout << "OK" << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,59 @@
+#include <iostream>
+#include <cassert>
+#include <bulk/bulk.hpp>
+#include <thrust/device_vector.h>
+#include <thrust/reduce.h>
+#include "decomposition.hpp"
+
+struct partial_sums
+{
+  template<typename ConcurrentGroup, typename Decomposition>
+  __device__
+  void operator()(ConcurrentGroup &this_group, const int *data, Decomposition decomp, int *sums)
+  {
+    typename Decomposition::range r = decomp[this_group.index()];
+
+    int sum = bulk::reduce(this_group, data + r.first, data + r.second, 0);
+
+    if(this_group.this_exec.index() == 0)
+    {
+      sums[this_group.index()] = sum;
+    }
+  }
+};
+
+int main()
+{
+  int n = 1 << 26;
+
+  // the input lives on device 0, and its peers read it directly
+  thrust::device_vector<int> data(n, 1);
+
+  const int num_groups = 1024;
+  const int group_size = 256;
+
+  bulk::multi_device_launch<bulk::parallel_group<bulk::concurrent_group<> > > launch = bulk::multi_device(bulk::grid(num_groups, group_size));
+
+  bulk::enable_peer_access(launch);
+
+  thrust::device_vector<int> sums(num_groups);
+
+  bulk::future<void> f = bulk::async(launch,
+                                     partial_sums(),
+                                     bulk::root.this_exec,
+                                     thrust::raw_pointer_cast(data.data()),
+                                     make_blocked_decomposition<int>(n, (n + num_groups - 1) / num_groups),
+                                     thrust::raw_pointer_cast(sums.data()));
+
+  f.wait();
+
+  int result = thrust::reduce(sums.begin(), sums.end());
+
+  std::cout << "summed across " << launch.size() << " devices" << std::endl;
+
+  assert(result == n);
+
+  std::cout << "It worked!" << std::endl;
+
+  return 0;
+}
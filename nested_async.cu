@@ -0,0 +1,55 @@
+#include <bulk/bulk.hpp>
+#include <thrust/device_vector.h>
+#include <thrust/count.h>
+#include <cassert>
+#include <cstdio>
+
+// nested launches require dynamic parallelism, e.g.
+// nvcc -arch=sm_35 -rdc=true nested_async.cu -lcudadevrt
+
+
+struct fill_segment
+{
+  __device__
+  void operator()(bulk::parallel_group<> &g, int *segment, int value)
+  {
+    segment[g.this_exec.index()] = value;
+  }
+};
+
+
+struct launch_children
+{
+  __device__
+  void operator()(bulk::parallel_group<> &g, int *data, int segment_size)
+  {
+#if __BULK_HAS_CUDART__
+    int i = g.this_exec.index();
+
+    // each child goes into a non-blocking stream of its own,
+    // so the children needn't serialize in their parent block's NULL stream
+    bulk::async(bulk::in_own_stream(bulk::par(segment_size)), fill_segment(), bulk::root, data + i * segment_size, i);
+#endif
+  }
+};
+
+
+int main()
+{
+  int num_segments = 64;
+  int segment_size = 1 << 16;
+
+  thrust::device_vector<int> data(num_segments * segment_size, -1);
+
+  // the parent grid is complete only once all of its children are
+  bulk::async(bulk::par(num_segments), launch_children(), bulk::root, thrust::raw_pointer_cast(data.data()), segment_size).wait();
+
+  for(int i = 0; i < num_segments; ++i)
+  {
+    assert(thrust::count(data.begin() + i * segment_size, data.begin() + (i + 1) * segment_size, i) == segment_size);
+  }
+
+  std::printf("OK\n");
+
+  return 0;
+}
@@ -0,0 +1,91 @@
+#include <bulk/bulk.hpp>
+#include <vector>
+#include <cassert>
+#include <cstddef>
+#include <cstdio>
+
+
+struct saxpy
+{
+  __host__ __device__
+  void operator()(bulk::agent<> &self, float a, float *x, float *y)
+  {
+    int i = self.index();
+    y[i] = a * x[i] + y[i];
+  }
+};
+
+
+// the same, indexed by a 64-bit type
+struct wide_saxpy
+{
+  __host__ __device__
+  void operator()(bulk::agent<1,std::ptrdiff_t> &self, float a, float *x, float *y)
+  {
+    std::ptrdiff_t i = self.index();
+    y[i] = a * x[i] + y[i];
+  }
+};
+
+
+// rotates each group's slice of data by one position
+// the closure must be callable from __host__ code for bulk::on_host()
+struct rotate_slices
+{
+  __host__ __device__
+  void operator()(bulk::concurrent_group<> &g, int *data)
+  {
+    int *slice = data + g.index() * g.size();
+    int i = g.this_exec.index();
+
+    int x = slice[(i + 1) % g.size()];
+
+    g.wait();
+
+    slice[i] = x;
+  }
+};
+
+
+int main()
+{
+  int n = 1 << 20;
+
+  std::vector<float> x(n, 1), y(n, 2);
+
+  // a small problem may run on the host's threads without copying it to the device
+  bulk::async(bulk::on_host(bulk::par(n)), saxpy(), bulk::root.this_exec, 3.f, &x[0], &y[0]);
+
+  for(int i = 0; i < n; ++i)
+  {
+    assert(y[i] == 5);
+  }
+
+  // the host launcher accepts agents with a wide index, too
+  bulk::async(bulk::on_host(bulk::par(bulk::agent<1,std::ptrdiff_t>(), n)), wide_saxpy(), bulk::root.this_exec, 3.f, &x[0], &y[0]);
+
+  for(int i = 0; i < n; ++i)
+  {
+    assert(y[i] == 8);
+  }
+
+  int num_groups = 64, group_size = 32;
+
+  std::vector<int> data(num_groups * group_size);
+  for(int i = 0; i < num_groups * group_size; ++i)
+  {
+    data[i] = i % group_size;
+  }
+
+  // concurrent groups wait on each other's agents on the host too
+  bulk::async(bulk::on_host(bulk::grid(num_groups, group_size)), rotate_slices(), bulk::root.this_exec, &data[0]);
+
+  for(int i = 0; i < num_groups * group_size; ++i)
+  {
+    assert(data[i] == (i + 1) % group_size);
+  }
+
+  std::printf("OK\n");
+
+  return 0;
+}
@@ -0,0 +1,67 @@
+#include <iostream>
+#include <cassert>
+#include <vector>
+#include <bulk/bulk.hpp>
+#include <thrust/device_vector.h>
+#include <thrust/logical.h>
+
+// a small batch of work, e.g. a few thousand elements ingested from a stream
+struct batch
+{
+  const float *x;
+  float *y;
+  int n;
+  float a;
+};
+
+struct saxpy_batch
+{
+  __device__
+  void operator()(bulk::concurrent_group<> &self, const batch &b)
+  {
+    for(int i = self.this_exec.index(); i < b.n; i += self.size())
+    {
+      b.y[i] = b.a * b.x[i] + b.y[i];
+    }
+  }
+};
+
+int main()
+{
+  const int batch_size = 4096;
+  const int num_batches = 1000;
+
+  thrust::device_vector<float> x(batch_size * num_batches, 1);
+  thrust::device_vector<float> y(batch_size * num_batches, 1);
+
+  // XXX the resident grid occupies the device, so do any other work before we create it
+  //     or after we shut it down
+  bulk::persistent_grid<saxpy_batch, batch> executor(saxpy_batch(), bulk::grid(bulk::use_default, 256));
+
+  std::cout << "persistent grid has " << executor.num_groups() << " groups" << std::endl;
+
+  std::vector<bulk::persistent_grid<saxpy_batch, batch>::ticket_type> tickets;
+
+  for(int i = 0; i < num_batches; ++i)
+  {
+    batch b;
+    b.x = thrust::raw_pointer_cast(x.data()) + i * batch_size;
+    b.y = thrust::raw_pointer_cast(y.data()) + i * batch_size;
+    b.n = batch_size;
+    b.a = 13;
+
+    tickets.push_back(executor.submit(b));
+  }
+
+  // wait for the last batch, then the rest
+  executor.wait(tickets.back());
+  executor.wait_all();
+
+  executor.shutdown();
+
+  assert(thrust::all_of(y.begin(), y.end(), thrust::placeholders::_1 == 14));
+
+  std::cout << "It worked!" << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,86 @@
+#include <iostream>
+#include <cassert>
+#include <bulk/bulk.hpp>
+#include <thrust/device_vector.h>
+
+// a three-stage pipeline whose kernels run concurrently and stream values to each other
+// through bulk::device_queues instead of round-tripping through the host
+
+struct ingest
+{
+  __device__
+  void operator()(bulk::agent<> &self, bulk::device_queue_view<int> out)
+  {
+    out.enqueue(self.index());
+  }
+};
+
+struct decode
+{
+  __device__
+  void operator()(bulk::device_queue_view<int> in, bulk::device_queue_view<int> out)
+  {
+    int x;
+    while(in.dequeue(x))
+    {
+      out.enqueue(2 * x);
+    }
+  }
+};
+
+struct aggregate
+{
+  __device__
+  void operator()(bulk::device_queue_view<int> in, unsigned long long *sum)
+  {
+    int x;
+    while(in.dequeue(x))
+    {
+      atomicAdd(sum, (unsigned long long)x);
+    }
+  }
+};
+
+int main()
+{
+  const int n = 1 << 20;
+
+  // XXX the consumers wait for values while their queue is open, so keep their grids small enough
+  //     that the producers always find room on the device
+  const int num_consumers = 4096;
+
+  cudaStream_t s1, s2, s3;
+  cudaStreamCreateWithFlags(&s1, cudaStreamNonBlocking);
+  cudaStreamCreateWithFlags(&s2, cudaStreamNonBlocking);
+  cudaStreamCreateWithFlags(&s3, cudaStreamNonBlocking);
+
+  bulk::device_queue<int> records(1 << 16);
+  bulk::device_queue<int> values(1 << 16);
+
+  thrust::device_vector<unsigned long long> sum(1, 0);
+
+  bulk::future<void> t3 = bulk::async(bulk::par(s3, num_consumers), aggregate(), values.view(), thrust::raw_pointer_cast(sum.data()));
+  bulk::future<void> t2 = bulk::async(bulk::par(s2, num_consumers), decode(), records.view(), values.view());
+
+  // each stage closes its output queue once it has finished enqueueing
+  values.close(s2);
+
+  bulk::future<void> t1 = bulk::async(bulk::par(s1, n), ingest(), bulk::root.this_exec, records.view());
+  records.close(s1);
+
+  t1.wait();
+  t2.wait();
+  t3.wait();
+
+  unsigned long long expected = (unsigned long long)n * (n - 1);
+
+  assert(sum[0] == expected);
+
+  cudaStreamDestroy(s1);
+  cudaStreamDestroy(s2);
+  cudaStreamDestroy(s3);
+
+  std::cout << "It worked!" << std::endl;
+
+  return 0;
+}
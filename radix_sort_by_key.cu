@@ -0,0 +1,379 @@
+#include <iostream>
+#include <cassert>
+#include <thrust/device_vector.h>
+#include <thrust/sort.h>
+#include <thrust/tabulate.h>
+#include <thrust/functional.h>
+#include <thrust/detail/minmax.h>
+#include <thrust/random.h>
+#include <bulk/bulk.hpp>
+#include "time_invocation_cuda.hpp"
+
+
+const unsigned int radix_bits = bulk::detail::radix_sort_detail::radix_bits;
+const unsigned int radix      = bulk::detail::radix_sort_detail::radix;
+
+
+// each group counts the digits of its tile
+// counts is laid out digit-major so that a scan of counts yields each tile's offset for each digit
+struct count_digits_kernel
+{
+  template<std::size_t groupsize, std::size_t grainsize, typename RandomAccessIterator1, typename RandomAccessIterator2>
+  __device__ void operator()(bulk::concurrent_group<bulk::agent<grainsize>, groupsize> &g, RandomAccessIterator1 keys_first, int n, int shift, RandomAccessIterator2 counts)
+  {
+    typedef typename bulk::concurrent_group<bulk::agent<grainsize>,groupsize>::size_type size_type;
+    const size_type tilesize = groupsize * grainsize;
+
+    __shared__ unsigned int histogram[radix];
+
+    size_type tid = g.this_exec.index();
+
+    if(tid < radix)
+    {
+      histogram[tid] = 0;
+    }
+
+    g.wait();
+
+    size_type gid = tilesize * g.index();
+    size_type count = thrust::min<size_type>(tilesize, n - gid);
+    
+    for(size_type i = tid; i < count; i += groupsize)
+    {
+      unsigned int d = bulk::detail::radix_sort_detail::digit(keys_first[gid + i], shift, radix_bits);
+      atomicAdd(histogram + d, 1u);
+    }
+
+    g.wait();
+
+    if(tid < radix)
+    {
+      size_type num_tiles = (n + tilesize - 1) / tilesize;
+      counts[tid * num_tiles + g.index()] = histogram[tid];
+    }
+  }
+};
+
+
+// each group ranks its tile by digit on chip and then scatters each digit's run
+// to where the scanned counts say it begins
+struct scatter_digits_kernel
+{
+  template<std::size_t groupsize,
+           std::size_t grainsize,
+           typename RandomAccessIterator1, 
+           typename RandomAccessIterator2,
+           typename RandomAccessIterator3,
+           typename RandomAccessIterator4,
+           typename RandomAccessIterator5>
+  __device__ void operator()(bulk::concurrent_group<bulk::agent<grainsize>, groupsize> &g, RandomAccessIterator1 keys_first, RandomAccessIterator2 values_first, int n, int shift, RandomAccessIterator3 offsets, RandomAccessIterator4 keys_result, RandomAccessIterator5 values_result)
+  {
+    typedef typename bulk::concurrent_group<bulk::agent<grainsize>,groupsize>::size_type size_type;
+    typedef typename thrust::iterator_value<RandomAccessIterator1>::type key_type;
+    typedef typename thrust::iterator_value<RandomAccessIterator2>::type value_type;
+    const size_type tilesize = groupsize * grainsize;
+
+    typedef bulk::detail::radix_sort_detail::stage<tilesize,groupsize,key_type,value_type> stage_type;
+    stage_type *stage = static_cast<stage_type*>(bulk::malloc(g, sizeof(stage_type)));
+
+    size_type gid = tilesize * g.index();
+    size_type count = thrust::min<size_type>(tilesize, n - gid);
+    size_type num_tiles = (n + tilesize - 1) / tilesize;
+
+    size_type local_offset = grainsize * g.this_exec.index();
+    size_type local_size = thrust::max<size_type>(0, thrust::min<size_type>(grainsize, count - local_offset));
+
+    bulk::copy_n(bulk::bound<tilesize>(g), keys_first + gid, count, stage->keys);
+
+    key_type local_keys[grainsize];
+    bulk::copy_n(bulk::bound<grainsize>(g.this_exec), stage->keys + local_offset, local_size, local_keys);
+
+    g.wait();
+
+    bulk::copy_n(bulk::bound<tilesize>(g), values_first + gid, count, stage->values);
+
+    value_type local_values[grainsize];
+    bulk::copy_n(bulk::bound<grainsize>(g.this_exec), stage->values + local_offset, local_size, local_values);
+
+    unsigned int buckets[grainsize];
+    for(size_type j = 0; j < grainsize; ++j)
+    {
+      if(j < local_size)
+      {
+        buckets[j] = bulk::detail::radix_sort_detail::digit(local_keys[j], shift, radix_bits);
+      }
+    }
+
+    size_type ranks[grainsize];
+    bulk::detail::bucket_rank<radix>(g, buckets, local_size, ranks, stage->counters);
+
+    for(size_type j = 0; j < grainsize; ++j)
+    {
+      if(j < local_size)
+      {
+        stage->keys[ranks[j]] = local_keys[j];
+      }
+    }
+
+    g.wait();
+
+    // consecutive agents store consecutive keys of each digit's run
+    size_type destinations[grainsize];
+    for(size_type j = 0; j < grainsize; ++j)
+    {
+      size_type i = g.this_exec.index() + j * groupsize;
+      if(i < count)
+      {
+        unsigned int d = bulk::detail::radix_sort_detail::digit(stage->keys[i], shift, radix_bits);
+        destinations[j] = offsets[d * num_tiles + g.index()] + i - bulk::detail::bucket_begin<groupsize>(stage->counters, d);
+        keys_result[destinations[j]] = stage->keys[i];
+      }
+    }
+
+    g.wait();
+
+    for(size_type j = 0; j < grainsize; ++j)
+    {
+      if(j < local_size)
+      {
+        stage->values[ranks[j]] = local_values[j];
+      }
+    }
+
+    g.wait();
+
+    for(size_type j = 0; j < grainsize; ++j)
+    {
+      size_type i = g.this_exec.index() + j * groupsize;
+      if(i < count)
+      {
+        values_result[destinations[j]] = stage->values[i];
+      }
+    }
+
+    bulk::free(g, stage);
+  }
+};
+
+
+template<typename RandomAccessIterator1, typename RandomAccessIterator2>
+void radix_sort_by_key(RandomAccessIterator1 keys_first, RandomAccessIterator1 keys_last, RandomAccessIterator2 values_first)
+{
+  typename thrust::iterator_difference<RandomAccessIterator1>::type n = keys_last - keys_first;
+
+  if(n <= 0) return;
+
+  typedef typename thrust::iterator_value<RandomAccessIterator1>::type key_type;
+  typedef typename thrust::iterator_value<RandomAccessIterator2>::type value_type;
+
+  typedef int size_type;
+
+  const size_type groupsize = 128;
+  const size_type grainsize = 9;
+  
+  const size_type tilesize = groupsize * grainsize;
+  size_type num_groups = (n + tilesize - 1) / tilesize;
+
+  size_type heap_size = sizeof(bulk::detail::radix_sort_detail::stage<tilesize,groupsize,key_type,value_type>);
+
+  thrust::cuda::tag exec;
+
+  // ping being true means the latest data is in the source array
+  bool ping = true;
+  bulk::temporary_buffer<key_type>   keys_pong(n);
+  bulk::temporary_buffer<value_type> values_pong(n);
+
+  bulk::temporary_buffer<unsigned int> counts(radix * num_groups);
+
+  for(int shift = 0; shift < 8 * sizeof(key_type); shift += radix_bits, ping = !ping)
+  {
+    if(ping)
+    {
+      bulk::async(bulk::grid<groupsize,grainsize>(num_groups), count_digits_kernel(), bulk::root.this_exec, keys_first, n, shift, counts.begin());
+
+      bulk::exclusive_scan(counts.begin(), counts.end(), counts.begin(), 0u, thrust::plus<unsigned int>());
+
+      bulk::async(bulk::grid<groupsize,grainsize>(num_groups, heap_size), scatter_digits_kernel(), bulk::root.this_exec, keys_first, values_first, n, shift, counts.begin(), keys_pong.begin(), values_pong.begin());
+    }
+    else
+    {
+      bulk::async(bulk::grid<groupsize,grainsize>(num_groups), count_digits_kernel(), bulk::root.this_exec, keys_pong.begin(), n, shift, counts.begin());
+
+      bulk::exclusive_scan(counts.begin(), counts.end(), counts.begin(), 0u, thrust::plus<unsigned int>());
+
+      bulk::async(bulk::grid<groupsize,grainsize>(num_groups, heap_size), scatter_digits_kernel(), bulk::root.this_exec, keys_pong.begin(), values_pong.begin(), n, shift, counts.begin(), keys_first, values_first);
+    }
+  }
+
+  if(!ping)
+  {
+    thrust::copy_n(exec, keys_pong.begin(), n,   keys_first);
+    thrust::copy_n(exec, values_pong.begin(), n, values_first);
+  }
+}
+
+
+// sorts each tile independently with the group radix sort
+struct radix_sort_each_kernel
+{
+  template<std::size_t groupsize, std::size_t grainsize, typename RandomAccessIterator1, typename RandomAccessIterator2>
+  __device__ void operator()(bulk::concurrent_group<bulk::agent<grainsize>, groupsize> &g, RandomAccessIterator1 keys_first, RandomAccessIterator2 values_first, int count)
+  {
+    typedef typename bulk::concurrent_group<bulk::agent<grainsize>,groupsize>::size_type size_type;
+    const size_type tilesize = groupsize * grainsize;
+  
+    size_type gid = tilesize * g.index();
+    size_type count2 = thrust::min<size_type>(tilesize, count - gid);
+  
+    bulk::radix_sort_by_key(bulk::bound<tilesize>(g), keys_first + gid, keys_first + gid + count2, values_first + gid);
+  }
+};
+
+
+template<typename T>
+void my_sort_by_key(const thrust::device_vector<T> *unsorted_keys,
+                    const thrust::device_vector<T> *unsorted_values,
+                    thrust::device_vector<T> *sorted_keys,
+                    thrust::device_vector<T> *sorted_values)
+{
+  *sorted_keys = *unsorted_keys;
+  *sorted_values = *unsorted_values;
+  radix_sort_by_key(sorted_keys->begin(), sorted_keys->end(), sorted_values->begin());
+}
+
+
+template<typename T>
+void thrust_sort_by_key(const thrust::device_vector<T> *unsorted_keys,
+                        const thrust::device_vector<T> *unsorted_values,
+                        thrust::device_vector<T> *sorted_keys,
+                        thrust::device_vector<T> *sorted_values)
+{
+  *sorted_keys = *unsorted_keys;
+  *sorted_values = *unsorted_values;
+  thrust::sort_by_key(sorted_keys->begin(), sorted_keys->end(), sorted_values->begin());
+}
+
+
+template<typename T>
+struct hash
+{
+  template<typename Integer>
+  __device__ __device__
+  T operator()(Integer x)
+  {
+    x = (x+0x7ed55d16) + (x<<12);
+    x = (x^0xc761c23c) ^ (x>>19);
+    x = (x+0x165667b1) + (x<<5);
+    x = (x+0xd3a2646c) ^ (x<<9);
+    x = (x+0xfd7046c5) + (x<<3);
+    x = (x^0xb55a4f09) ^ (x>>16);
+    return x;
+  }
+};
+
+
+template<typename Vector>
+void random_fill(Vector &vec)
+{
+  thrust::tabulate(vec.begin(), vec.end(), hash<typename Vector::value_type>());
+}
+
+
+template<typename T>
+void compare(size_t n)
+{
+  thrust::device_vector<T> unsorted_keys(n), unsorted_values(n), sorted_keys(n), sorted_values(n);
+
+  random_fill(unsorted_keys);
+  random_fill(unsorted_values);
+
+  my_sort_by_key(&unsorted_keys, &unsorted_values, &sorted_keys, &sorted_values);
+  double my_msecs = time_invocation_cuda(20, my_sort_by_key<T>, &unsorted_keys, &unsorted_values, &sorted_keys, &sorted_values);
+
+  thrust_sort_by_key(&unsorted_keys, &unsorted_values, &sorted_keys, &sorted_values);
+  double thrust_msecs = time_invocation_cuda(20, thrust_sort_by_key<T>, &unsorted_keys, &unsorted_values, &sorted_keys, &sorted_values);
+
+  std::cout << "Thrust's time: " << thrust_msecs << " ms" << std::endl;
+  std::cout << "My time:       " << my_msecs << " ms" << std::endl;
+
+  std::cout << "Performance relative to Thrust: " << thrust_msecs / my_msecs << std::endl;
+}
+
+
+template<typename T>
+void validate(size_t n)
+{
+  thrust::device_vector<T> unsorted_keys(n), unsorted_values(n);
+
+  random_fill(unsorted_keys);
+  random_fill(unsorted_values);
+
+  thrust::device_vector<T> ref_keys = unsorted_keys;
+  thrust::device_vector<T> ref_values = unsorted_values;
+  thrust::stable_sort_by_key(ref_keys.begin(), ref_keys.end(), ref_values.begin());
+
+  thrust::device_vector<T> sorted_keys = unsorted_keys;
+  thrust::device_vector<T> sorted_values = unsorted_values;
+
+  radix_sort_by_key(sorted_keys.begin(), sorted_keys.end(), sorted_values.begin());
+
+  cudaError_t error = cudaDeviceSynchronize();
+  if(error)
+  {
+    std::cout << "CUDA error: " << cudaGetErrorString(error) << std::endl;
+  }
+
+  assert(sorted_keys == ref_keys);
+  assert(sorted_values == ref_values);
+
+  // each tile sorted by the group radix sort should match each tile sorted by thrust
+  sorted_keys = unsorted_keys;
+  sorted_values = unsorted_values;
+
+  const int groupsize = 128, grainsize = 9, tilesize = groupsize * grainsize;
+  int num_groups = (n + tilesize - 1) / tilesize;
+  int heap_size = sizeof(bulk::detail::radix_sort_detail::stage<tilesize,groupsize,T,T>);
+  bulk::async(bulk::grid<groupsize,grainsize>(num_groups, heap_size), radix_sort_each_kernel(), bulk::root.this_exec, sorted_keys.begin(), sorted_values.begin(), n);
+
+  ref_keys = unsorted_keys;
+  ref_values = unsorted_values;
+  for(size_t i = 0; i < n; i += tilesize)
+  {
+    size_t last = thrust::min<size_t>(n, i + tilesize);
+    thrust::stable_sort_by_key(ref_keys.begin() + i, ref_keys.begin() + last, ref_values.begin() + i);
+  }
+
+  assert(sorted_keys == ref_keys);
+  assert(sorted_values == ref_values);
+}
+
+
+int main()
+{
+  for(size_t n = 1; n <= 1 << 20; n <<= 1)
+  {
+    std::cout << "Testing n = " << n << std::endl;
+    validate<int>(n);
+  }
+
+  thrust::default_random_engine rng;
+  for(int i = 0; i < 20; ++i)
+  {
+    size_t n = rng() % (1 << 20);
+   
+    std::cout << "Testing n = " << n << std::endl;
+    validate<int>(n);
+  }
+
+  size_t n = 12345678;
+
+  std::cout << "Large input: " << std::endl;
+  std::cout << "int: " << std::endl;
+  compare<int>(n);
+
+  std::cout << "float: " << std::endl;
+  compare<float>(n);
+  std::cout << std::endl;
+
+  return 0;
+}
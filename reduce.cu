@@ -4,6 +4,7 @@
 #include <thrust/sequence.h>
 #include <thrust/reduce.h>
 #include <thrust/extrema.h>
+#include <thrust/functional.h>
 #include <cassert>
 #include <iostream>
 #include "time_invocation_cuda.hpp"
@@ -55,48 +56,134 @@ struct reduce_partitions
 };
 
 
+const int reduce_groupsize = 128;
+const int reduce_grainsize = 7;
+const int reduce_subscription = 10;
+
+
+// the number of partial sums my_async_reduce needs room for
+template<typename Size>
+Size reduce_num_partial_sums(Size n)
+{
+  const Size tile_size = reduce_groupsize * reduce_grainsize;
+  const Size num_tiles = (n + tile_size - 1) / tile_size;
+
+  return thrust::max<Size>(1, thrust::min<Size>(reduce_subscription * bulk::concurrent_group<>::hardware_concurrency(), num_tiles));
+} // end reduce_num_partial_sums()
+
+
+// partial_sums must hold reduce_num_partial_sums(last - first) elements
+// and persist until the result is ready
 template<typename RandomAccessIterator,
          typename T,
          typename BinaryOperation>
-T my_reduce(RandomAccessIterator first, RandomAccessIterator last, T init, BinaryOperation binary_op)
+bulk::future<T> my_async_reduce(RandomAccessIterator first, RandomAccessIterator last, T init, BinaryOperation binary_op, T *partial_sums)
 {
   typedef typename thrust::iterator_difference<RandomAccessIterator>::type size_type;
 
   const size_type n = last - first;
 
-  if(n <= 0) return init;
+  if(n <= 0)
+  {
+    bulk::detail::throw_on_error(cudaMemcpy(partial_sums, &init, sizeof(T), cudaMemcpyHostToDevice), "my_async_reduce(): after cudaMemcpy");
+    return bulk::future<void>().then_get(partial_sums);
+  } // end if
 
-  const size_type groupsize = 128;
-  const size_type grainsize = 7;
-  const size_type tile_size = groupsize * grainsize;
-  const size_type num_tiles = (n + tile_size - 1) / tile_size;
-  const size_type subscription = 10;
+  const size_type tile_size = reduce_groupsize * reduce_grainsize;
 
   bulk::concurrent_group<
-    bulk::agent<grainsize>,
-    groupsize
+    bulk::agent<reduce_grainsize>,
+    reduce_groupsize
   > g;
 
-  const size_type num_groups = thrust::min<size_type>(subscription * g.hardware_concurrency(), num_tiles);
-
-  aligned_decomposition<size_type> decomp(n, num_groups, tile_size);
-
-  thrust::cuda::tag t;
-  thrust::detail::temporary_array<T,thrust::cuda::tag> partial_sums(t, decomp.size());
+  aligned_decomposition<size_type> decomp(n, reduce_num_partial_sums(n), tile_size);
 
   // reduce into partial sums
-  bulk::async(bulk::par(g, decomp.size()), reduce_partitions(), bulk::root.this_exec, first, decomp, partial_sums.begin(), init, binary_op);
+  bulk::future<void> f = bulk::async(bulk::par(g, decomp.size()), reduce_partitions(), bulk::root.this_exec, first, decomp, partial_sums, init, binary_op);
 
-  if(partial_sums.size() > 1)
+  if(decomp.size() > 1)
   {
     // reduce the partial sums
-    bulk::async(g, reduce_partitions(), bulk::root, partial_sums.begin(), partial_sums.end(), partial_sums.begin(), binary_op);
+    f = f.then(g, reduce_partitions(), bulk::root, partial_sums, partial_sums + decomp.size(), partial_sums, binary_op);
   } // end while
 
-  return partial_sums[0];
+  // copy the result to the host without blocking
+  return f.then_get(partial_sums);
+} // end my_async_reduce()
+
+
+template<typename RandomAccessIterator,
+         typename T,
+         typename BinaryOperation>
+T my_reduce(RandomAccessIterator first, RandomAccessIterator last, T init, BinaryOperation binary_op)
+{
+  // after the first call, the partial sums come from the pool without reaching the driver
+  bulk::temporary_buffer<T> partial_sums(reduce_num_partial_sums(last - first));
+
+  return my_async_reduce(first, last, init, binary_op, partial_sums.data()).get();
 } // end my_reduce()
 
 
+// reduces in a single launch: each group reduces its partition into a partial sum,
+// then, after the grid-wide barrier, the first group reduces the partial sums
+struct cooperative_reduce
+{
+  template<typename ConcurrentGrid, typename Iterator, typename T, typename BinaryOperation>
+  __device__
+  void operator()(ConcurrentGrid &grid, Iterator first, Iterator last, T *partial_sums, T init, BinaryOperation binary_op)
+  {
+    typedef typename thrust::iterator_difference<Iterator>::type size_type;
+
+    // the launcher may have clamped the grid to the groups which fit on the device
+    aligned_decomposition<size_type> decomp(last - first, grid.size(), reduce_groupsize * reduce_grainsize);
+
+    if(grid.this_exec.index() < decomp.size())
+    {
+      reduce_partitions()(grid.this_exec, first, decomp, partial_sums, init, binary_op);
+    }
+
+    grid.wait();
+
+    if(grid.this_exec.index() == 0 && decomp.size() > 1)
+    {
+      reduce_partitions()(grid.this_exec, partial_sums, partial_sums + decomp.size(), partial_sums, binary_op);
+    }
+  }
+};
+
+
+// requires a device which supports cooperative launch
+template<typename RandomAccessIterator,
+         typename T,
+         typename BinaryOperation>
+T my_cooperative_reduce(RandomAccessIterator first, RandomAccessIterator last, T init, BinaryOperation binary_op)
+{
+  typedef typename thrust::iterator_difference<RandomAccessIterator>::type size_type;
+
+  const size_type n = last - first;
+
+  if(n <= 0) return init;
+
+  size_type num_groups = reduce_num_partial_sums(n);
+
+  bulk::temporary_buffer<T> partial_sums(num_groups);
+
+  bulk::async(bulk::cogrid<reduce_groupsize,reduce_grainsize>(num_groups), cooperative_reduce(), bulk::root, first, last, partial_sums.data(), init, binary_op);
+
+  T result;
+  bulk::detail::throw_on_error(cudaMemcpy(&result, partial_sums.data(), sizeof(T), cudaMemcpyDeviceToHost), "my_cooperative_reduce(): after cudaMemcpy");
+
+  return result;
+} // end my_cooperative_reduce()
+
+
+template<typename T>
+T my_cooperative_reduce(const thrust::device_vector<T> *vec)
+{
+  return my_cooperative_reduce(vec->begin(), vec->end(), T(0), thrust::plus<T>());
+}
+
+
 template<typename T>
 T my_reduce(const thrust::device_vector<T> *vec)
 {
@@ -104,6 +191,14 @@ T my_reduce(const thrust::device_vector<T> *vec)
 }
 
 
+// the device-wide reduction folds the partial sums within its single launch
+template<typename T>
+T bulk_reduce(const thrust::device_vector<T> *vec)
+{
+  return bulk::reduce(vec->begin(), vec->end(), T(0), thrust::plus<T>());
+}
+
+
 template<typename T>
 T thrust_reduce(const thrust::device_vector<T> *vec)
 {
@@ -122,8 +217,16 @@ void compare()
   my_reduce(&vec);
   double my_msecs = time_invocation_cuda(50, my_reduce<T>, &vec);
 
+  my_cooperative_reduce(&vec);
+  double cooperative_msecs = time_invocation_cuda(50, my_cooperative_reduce<T>, &vec);
+
+  bulk_reduce(&vec);
+  double bulk_msecs = time_invocation_cuda(50, bulk_reduce<T>, &vec);
+
   std::cout << "Thrust's time: " << thrust_msecs << " ms" << std::endl;
   std::cout << "My time:       " << my_msecs << " ms" << std::endl;
+  std::cout << "Single launch: " << cooperative_msecs << " ms" << std::endl;
+  std::cout << "bulk::reduce:  " << bulk_msecs << " ms" << std::endl;
 
   std::cout << "Performance relative to Thrust: " << thrust_msecs / my_msecs << std::endl;
 }
@@ -147,6 +250,29 @@ int main()
 
   assert(thrust_result == my_result);
 
+  int cooperative_result = my_cooperative_reduce(vec.begin(), vec.end(), 13, thrust::plus<int>());
+
+  std::cout << "cooperative_result: " << cooperative_result << std::endl;
+
+  assert(thrust_result == cooperative_result);
+
+  int bulk_result = bulk::reduce(vec.begin(), vec.end(), 13, thrust::plus<int>());
+
+  std::cout << "bulk_result: " << bulk_result << std::endl;
+
+  assert(thrust_result == bulk_result);
+
+  // maximum has no atomic path, so it folds its partial sums through the last group's ticket
+  assert(bulk::reduce(vec.begin(), vec.end(), 13, thrust::maximum<int>()) == int(n - 1));
+
+  // overlap the copy of one reduction's result with the next reduction
+  bulk::temporary_buffer<int> partial_sums1(reduce_num_partial_sums(vec.size())), partial_sums2(reduce_num_partial_sums(vec.size()));
+  bulk::future<int> result1 = my_async_reduce(vec.begin(), vec.end(), 13, thrust::plus<int>(), partial_sums1.data());
+  bulk::future<int> result2 = my_async_reduce(vec.begin(), vec.end(), 7,  thrust::plus<int>(), partial_sums2.data());
+
+  assert(result1.get() == thrust_result);
+  assert(result2.get() == thrust_result - 6);
+
   std::cout << "int: " << std::endl;
   compare<int>();
 
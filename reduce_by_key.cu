@@ -4,13 +4,12 @@
 #include <thrust/iterator/zip_iterator.h>
 #include <thrust/iterator/transform_iterator.h>
 #include <thrust/iterator/constant_iterator.h>
-#include <thrust/detail/temporary_array.h>
 #include <thrust/random.h>
 #include <bulk/bulk.hpp>
 #include "head_flags.hpp"
 #include "tail_flags.hpp"
 #include "time_invocation_cuda.hpp"
-#include "reduce_intervals.hpp"
+#include "decomposition.hpp"
 
 
 struct reduce_by_key_kernel
@@ -130,49 +129,6 @@ struct reduce_by_key_kernel
 };
 
 
-struct tuple_and
-{
-  typedef bool result_type;
-
-  template<typename Tuple>
-  __host__ __device__
-  bool operator()(Tuple t)
-  {
-    return thrust::get<0>(t) && thrust::get<1>(t);
-  }
-};
-
-
-template<typename Iterator1,
-         typename Iterator2,
-         typename Iterator3,
-         typename Iterator4,
-         typename BinaryFunction>
-void sum_tail_carries(Iterator1 interval_values_first,
-                      Iterator1 interval_values_last,
-                      Iterator2 interval_output_offsets_first,
-                      Iterator2 interval_output_offsets_last,
-                      Iterator3 is_carry,
-                      Iterator4 values_result,
-                      BinaryFunction binary_op)
-{
-  typedef thrust::zip_iterator<thrust::tuple<Iterator2,Iterator3> > zip_iterator;
-
-  tail_flags<zip_iterator> tail_flags(thrust::make_zip_iterator(thrust::make_tuple(interval_output_offsets_first, is_carry)),
-                                      thrust::make_zip_iterator(thrust::make_tuple(interval_output_offsets_last,  is_carry)));
-
-  // for each value in the array of interval values
-  //   if it is a carry and it is the tail value in its segment
-  //     scatter it to its location in the output array, but sum it together with the value there previously
-  thrust::transform_if(interval_values_first, interval_values_last,
-                       thrust::make_permutation_iterator(values_result, interval_output_offsets_first),
-                       thrust::make_transform_iterator(thrust::make_zip_iterator(thrust::make_tuple(tail_flags.begin(), is_carry)), tuple_and()),
-                       thrust::make_permutation_iterator(values_result, interval_output_offsets_first),
-                       binary_op,
-                       thrust::identity<bool>());
-}
-
-
 template<typename RandomAccessIterator1,
          typename RandomAccessIterator2,
          typename RandomAccessIterator3,
@@ -196,8 +152,7 @@ thrust::pair<RandomAccessIterator3,RandomAccessIterator4>
 
   if(n <= threshold_of_parallelism)
   {
-    thrust::cuda::tag t;
-    thrust::detail::temporary_array<size_type,thrust::cuda::tag> result_size_storage(t, 1);
+    bulk::temporary_buffer<size_type> result_size_storage(1);
 
     // XXX these sizes aren't actually optimal, but anything larger
     //     will cause sm_1x to run out of smem at compile time
@@ -205,70 +160,16 @@ thrust::pair<RandomAccessIterator3,RandomAccessIterator4>
     const int grainsize = (sizeof(value_type) == sizeof(int)) ?   3 :   5;
 
     size_type heap_size = groupsize * grainsize * (sizeof(size_type) + sizeof(value_type));
-    bulk::async(bulk::grid<groupsize,grainsize>(1,heap_size), reduce_by_key_kernel(), bulk::root.this_exec, keys_first, keys_last, values_first, keys_result, values_result, pred, binary_op, result_size_storage.begin());
+    bulk::async(bulk::grid<groupsize,grainsize>(1,heap_size), reduce_by_key_kernel(), bulk::root.this_exec, keys_first, keys_last, values_first, keys_result, values_result, pred, binary_op, result_size_storage.data());
 
-    size_type result_size = result_size_storage[0];
+    size_type result_size = thrust::device_pointer_cast(result_size_storage.data())[0];
 
     return thrust::make_pair(keys_result + result_size, values_result + result_size);
   } // end if
 
-  typedef typename thrust::iterator_value<RandomAccessIterator1>::type  key_type;
-
-  // XXX this should be the result of BinaryFunction
-  typedef typename thrust::iterator_value<RandomAccessIterator4>::type intermediate_type;
-
-  const size_type groupsize = 128;
-  const size_type grainsize = 5;
-  size_type tile_size = groupsize * grainsize;
-
-  const size_type interval_size = threshold_of_parallelism; 
-
-  size_type subscription = 100;
-  size_type num_groups = thrust::min<size_type>(subscription * bulk::concurrent_group<>::hardware_concurrency(), (n + interval_size - 1) / interval_size);
-  aligned_decomposition<size_type> decomp(n, num_groups, tile_size);
-
-  // count the number of tail flags in each interval
-  tail_flags<
-    RandomAccessIterator1,
-    thrust::equal_to<typename thrust::iterator_value<RandomAccessIterator1>::type>,
-    size_type
-  > tail_flags(keys_first, keys_last, pred);
-
-  thrust::cuda::tag t;
-  thrust::detail::temporary_array<size_type,thrust::cuda::tag> interval_output_offsets(t, decomp.size());
-
-  reduce_intervals(tail_flags.begin(), decomp, interval_output_offsets.begin(), thrust::plus<size_type>());
-
-  // scan the interval counts
-  thrust::inclusive_scan(interval_output_offsets.begin(), interval_output_offsets.end(), interval_output_offsets.begin());
-
-  // reduce each interval
-  thrust::detail::temporary_array<bool,thrust::cuda::tag> is_carry(t, decomp.size());
-  thrust::detail::temporary_array<intermediate_type,thrust::cuda::tag> interval_values(t, decomp.size());
-
-  size_type heap_size = tile_size * (sizeof(size_type) + sizeof(value_type));
-  bulk::async(bulk::grid<groupsize,grainsize>(decomp.size(),heap_size), reduce_by_key_kernel(),
-    bulk::root.this_exec, keys_first, decomp, values_first, keys_result, values_result, interval_output_offsets.begin(), interval_values.begin(), is_carry.begin(), thrust::make_tuple(pred, binary_op)
-  );
-
-  // scan by key the carries
-  thrust::inclusive_scan_by_key(thrust::make_zip_iterator(thrust::make_tuple(interval_output_offsets.begin(), is_carry.begin())),
-                                thrust::make_zip_iterator(thrust::make_tuple(interval_output_offsets.end(),   is_carry.end())),
-                                interval_values.begin(),
-                                interval_values.begin(),
-                                thrust::equal_to<thrust::tuple<size_type,bool> >(),
-                                binary_op);
-
-  // sum each tail carry value into the result 
-  sum_tail_carries(interval_values.begin(), interval_values.end(),
-                   interval_output_offsets.begin(), interval_output_offsets.end(),
-                   is_carry.begin(),
-                   values_result,
-                   binary_op);
-
-  difference_type result_size = interval_output_offsets[interval_output_offsets.size() - 1];
-
-  return thrust::make_pair(keys_result + result_size, values_result + result_size);
+  // large inputs are reduced by the fused device-wide driver, which finds, counts & reduces
+  // the segments in one pass over the keys rather than first counting them with reduce_intervals
+  return bulk::reduce_by_key(keys_first, keys_last, values_first, keys_result, values_result, pred, binary_op);
 }
 
 
@@ -402,6 +303,48 @@ void validate(size_t n)
 }
 
 
+// an equivalence which isn't equality, so each run's first key differs from its others
+struct equal_modulo_3
+{
+  template<typename T>
+  __host__ __device__
+  bool operator()(T x, T y) const
+  {
+    return int(x) % 3 == int(y) % 3;
+  }
+};
+
+
+template<typename T>
+void validate_predicate(size_t n)
+{
+  thrust::device_vector<T> keys(n), values(n);
+  thrust::device_vector<T> keys_result(n), values_result(n);
+
+  random_fill(keys);
+  random_fill(values);
+
+  thrust::device_vector<T> keys_ref(n), values_ref(n);
+  size_t thrust_size = thrust::reduce_by_key(keys.begin(), keys.end(), values.begin(), keys_ref.begin(), values_ref.begin(), equal_modulo_3(), thrust::plus<T>()).first - keys_ref.begin();
+  keys_ref.resize(thrust_size);
+  values_ref.resize(thrust_size);
+
+  size_t my_size = bulk::reduce_by_key(keys.begin(), keys.end(), values.begin(), keys_result.begin(), values_result.begin(), equal_modulo_3(), thrust::plus<T>()).first - keys_result.begin();
+  keys_result.resize(my_size);
+  values_result.resize(my_size);
+
+  cudaError_t error = cudaDeviceSynchronize();
+  if(error)
+  {
+    std::cerr << "CUDA error: " << cudaGetErrorString(error) << std::endl;
+  }
+
+  // each run stores its first key
+  assert(keys_result == keys_ref);
+  assert(values_result == values_ref);
+}
+
+
 int main()
 {
   for(size_t n = 1; n <= 1 << 20; n <<= 1)
@@ -410,6 +353,12 @@ int main()
     validate<int>(n);
   }
 
+  for(size_t n = 1; n <= 1 << 20; n <<= 1)
+  {
+    std::cout << "Testing n = " << n << " with an equivalence other than equality" << std::endl;
+    validate_predicate<int>(n);
+  }
+
   thrust::default_random_engine rng;
   for(int i = 0; i < 20; ++i)
   {
@@ -1,6 +1,7 @@
 #include <iostream>
 #include <cstdio>
 #include <cassert>
+#include <cstddef>
 #include <bulk/bulk.hpp>
 #include <thrust/device_vector.h>
 #include <thrust/logical.h>
@@ -15,6 +16,17 @@ struct saxpy
   }
 };
 
+// the same, indexed by a 64-bit type, as a launch of more than 2^31 agents requires
+struct wide_saxpy
+{
+  __host__ __device__
+  void operator()(bulk::agent<1,std::ptrdiff_t> &self, float a, float *x, float *y)
+  {
+    std::ptrdiff_t i = self.index();
+    y[i] = a * x[i] + y[i];
+  }
+};
+
 int main()
 {
   size_t n = 1 << 24;
@@ -27,6 +39,11 @@ int main()
 
   assert(thrust::all_of(y.begin(), y.end(), thrust::placeholders::_1 == 14));
 
+  // a small n exercises the wide index without the memory 2^31 agents would need
+  bulk::async(bulk::par(bulk::agent<1,std::ptrdiff_t>(), n), wide_saxpy(), bulk::root.this_exec, a, thrust::raw_pointer_cast(x.data()), thrust::raw_pointer_cast(y.data()));
+
+  assert(thrust::all_of(y.begin(), y.end(), thrust::placeholders::_1 == 27));
+
   std::cout << "It worked!" << std::endl;
 
   return 0;
@@ -6,7 +6,6 @@
 #include <cassert>
 #include <iostream>
 #include "time_invocation_cuda.hpp"
-#include <thrust/detail/temporary_array.h>
 #include <thrust/detail/type_traits/function_traits.h>
 #include <bulk/bulk.hpp>
 #include "decomposition.hpp"
@@ -54,7 +53,9 @@ struct inclusive_downsweep
 };
 
 
-struct accumulate_tiles
+// the tiles' temporaries live in static scratch rather than the heap
+template<std::size_t scratch_size>
+struct accumulate_tiles : bulk::static_scratch<scratch_size>
 {
   template<typename ConcurrentGroup, typename RandomAccessIterator1, typename Decomposition, typename RandomAccessIterator2, typename BinaryFunction>
   __device__ void operator()(ConcurrentGroup &this_group,
@@ -84,8 +85,8 @@ struct accumulate_tiles
 }; // end accumulate_tiles
 
 
-template<typename RandomAccessIterator1, typename RandomAccessIterator2, typename T, typename BinaryFunction>
-RandomAccessIterator2 inclusive_scan(RandomAccessIterator1 first, RandomAccessIterator1 last, RandomAccessIterator2 result, T init, BinaryFunction binary_op)
+template<typename RandomAccessIterator1, typename RandomAccessIterator2, typename BinaryFunction>
+struct scan_config
 {
   typedef typename bulk::detail::scan_detail::scan_intermediate<
     RandomAccessIterator1,
@@ -95,11 +96,40 @@ RandomAccessIterator2 inclusive_scan(RandomAccessIterator1 first, RandomAccessIt
 
   typedef typename thrust::iterator_difference<RandomAccessIterator1>::type Size;
 
+  static const Size threshold_of_parallelism = 20000;
+
+  // determined from empirical testing on k20c
+  static const int groupsize = sizeof(intermediate_type) <= sizeof(int) ? 128 : 256;
+  static const int grainsize = sizeof(intermediate_type) <= sizeof(int) ?   9 :   5;
+
+  static const Size tile_size = groupsize * grainsize;
+
+  // the number of carries required to scan n elements
+  static Size num_groups(Size n)
+  {
+    if(n < threshold_of_parallelism) return 0;
+
+    int num_tiles = (n + tile_size - 1) / tile_size;
+
+    // 20 determined from empirical testing on k20c & GTX 480
+    int subscription = 20;
+    return thrust::min<Size>(subscription * bulk::concurrent_group<>::hardware_concurrency(), num_tiles);
+  }
+};
+
+
+// carries must point to scan_config<...>::num_groups(last - first) elements
+// because this does not allocate, it may be recorded with bulk::capture
+template<typename RandomAccessIterator1, typename RandomAccessIterator2, typename T, typename BinaryFunction, typename RandomAccessIterator3>
+RandomAccessIterator2 inclusive_scan(RandomAccessIterator1 first, RandomAccessIterator1 last, RandomAccessIterator2 result, T init, BinaryFunction binary_op, RandomAccessIterator3 carries)
+{
+  typedef scan_config<RandomAccessIterator1,RandomAccessIterator2,BinaryFunction> config;
+  typedef typename config::intermediate_type intermediate_type;
+  typedef typename config::Size Size;
+
   Size n = last - first;
   
-  const Size threshold_of_parallelism = 20000;
-
-  if(n < threshold_of_parallelism)
+  if(n < config::threshold_of_parallelism)
   {
     typedef bulk::detail::scan_detail::scan_buffer<512,3,RandomAccessIterator1,RandomAccessIterator2,BinaryFunction> heap_type;
     Size heap_size = sizeof(heap_type);
@@ -107,32 +137,27 @@ RandomAccessIterator2 inclusive_scan(RandomAccessIterator1 first, RandomAccessIt
   } // end if
   else
   {
-    // determined from empirical testing on k20c
-    const int groupsize = sizeof(intermediate_type) <= sizeof(int) ? 128 : 256;
-    const int grainsize = sizeof(intermediate_type) <= sizeof(int) ?   9 :   5;
+    const int groupsize = config::groupsize;
+    const int grainsize = config::grainsize;
 
-    const Size tile_size = groupsize * grainsize;
-    int num_tiles = (n + tile_size - 1) / tile_size;
+    const Size tile_size = config::tile_size;
 
-    // 20 determined from empirical testing on k20c & GTX 480
-    int subscription = 20;
-    Size num_groups = thrust::min<Size>(subscription * bulk::concurrent_group<>::hardware_concurrency(), num_tiles);
+    Size num_groups = config::num_groups(n);
 
     aligned_decomposition<Size> decomp(n, num_groups, tile_size);
 
-    thrust::cuda::tag t;
-    thrust::detail::temporary_array<intermediate_type,thrust::cuda::tag> carries(t, num_groups);
-    	
     // Run the parallel raking reduce as an upsweep.
     // n loads + num_groups stores
-    Size heap_size = groupsize * sizeof(intermediate_type);
-    bulk::async(bulk::grid<groupsize,grainsize>(num_groups,heap_size), accumulate_tiles(), bulk::root.this_exec, first, decomp, carries.begin(), binary_op);
+    // its temporaries live in static scratch, so it needs no heap
+    typedef accumulate_tiles<
+      bulk::accumulate_scratch_size<groupsize,grainsize,RandomAccessIterator1,typename thrust::iterator_value<RandomAccessIterator1>::type>::value
+    > upsweep_type;
+    Size heap_size1 = 0;
     
     // scan the sums to get the carries
     // num_groups loads + num_groups stores
     typedef bulk::detail::scan_detail::scan_buffer<256,3,RandomAccessIterator1,RandomAccessIterator2,BinaryFunction> heap_type2;
-    heap_size = sizeof(heap_type2);
-    bulk::async(bulk::con<256,3>(heap_size), exclusive_scan_n(), bulk::root, carries.begin(), num_groups, carries.begin(), init, binary_op);
+    Size heap_size2 = sizeof(heap_type2);
 
     // do the downsweep - n loads, n stores
     typedef bulk::detail::scan_detail::scan_buffer<
@@ -140,14 +165,29 @@ RandomAccessIterator2 inclusive_scan(RandomAccessIterator1 first, RandomAccessIt
       grainsize,
       RandomAccessIterator1,RandomAccessIterator2,BinaryFunction
     > heap_type3;
-    heap_size = sizeof(heap_type3);
-    bulk::async(bulk::grid<groupsize,grainsize>(num_groups,heap_size), inclusive_downsweep(), bulk::root.this_exec, first, decomp, carries.begin(), result, binary_op);
+    Size heap_size3 = sizeof(heap_type3);
+
+    // chain the three launches so that each is enqueued behind its predecessor without a host round-trip
+    bulk::async(bulk::grid<groupsize,grainsize>(num_groups,heap_size1), upsweep_type(), bulk::root.this_exec, first, decomp, carries, binary_op)
+      .then(bulk::con<256,3>(heap_size2), exclusive_scan_n(), bulk::root, carries, num_groups, carries, init, binary_op)
+      .then(bulk::grid<groupsize,grainsize>(num_groups,heap_size3), inclusive_downsweep(), bulk::root.this_exec, first, decomp, carries, result, binary_op);
   } // end else
 
   return result + n;
 } // end inclusive_scan()
 
 
+template<typename RandomAccessIterator1, typename RandomAccessIterator2, typename T, typename BinaryFunction>
+RandomAccessIterator2 inclusive_scan(RandomAccessIterator1 first, RandomAccessIterator1 last, RandomAccessIterator2 result, T init, BinaryFunction binary_op)
+{
+  typedef scan_config<RandomAccessIterator1,RandomAccessIterator2,BinaryFunction> config;
+
+  bulk::temporary_buffer<typename config::intermediate_type> carries(config::num_groups(last - first));
+
+  return ::inclusive_scan(first, last, result, init, binary_op, carries.data());
+} // end inclusive_scan()
+
+
 template<typename T>
 void my_scan(thrust::device_vector<T> *data, T init)
 {
@@ -155,6 +195,29 @@ void my_scan(thrust::device_vector<T> *data, T init)
 }
 
 
+// a single pass with decoupled look-back: 2n memory traffic rather than 3n
+template<typename T>
+void single_pass_scan(thrust::device_vector<T> *data, T init)
+{
+  bulk::inclusive_scan(data->begin(), data->end(), data->begin(), init, thrust::plus<T>());
+}
+
+
+// the single-pass scan draws its tile status from a temporary_buffer, which the graph must own while capturing
+template<typename T>
+struct single_pass_scan_sequence
+{
+  const thrust::device_vector<T> *input;
+  thrust::device_vector<T> *result;
+  T init;
+
+  void operator()() const
+  {
+    bulk::inclusive_scan(input->begin(), input->end(), result->begin(), init, thrust::plus<T>());
+  }
+};
+
+
 template<typename T>
 void validate(size_t n)
 {
@@ -181,6 +244,59 @@ void validate(size_t n)
   }
 
   assert(h_result == d_result);
+
+  thrust::fill(d_result.begin(), d_result.end(), 0);
+
+  bulk::inclusive_scan(d_input.begin(), d_input.end(), d_result.begin(), init, thrust::plus<T>());
+
+  error = cudaDeviceSynchronize();
+
+  if(error)
+  {
+    std::cerr << "CUDA error: " << cudaGetErrorString(error) << std::endl;
+  }
+
+  assert(h_result == d_result);
+
+  // record the single-pass scan and replay it twice, so the captured scratch must outlive the first replay
+  single_pass_scan_sequence<T> sequence = {&d_input, &d_result, init};
+  bulk::graph g = bulk::capture(sequence);
+
+  for(int i = 0; i < 2; ++i)
+  {
+    thrust::fill(d_result.begin(), d_result.end(), 0);
+
+    g.launch();
+
+    error = cudaDeviceSynchronize();
+
+    if(error)
+    {
+      std::cerr << "CUDA error: " << cudaGetErrorString(error) << std::endl;
+    }
+
+    assert(h_result == d_result);
+  }
+}
+
+
+template<typename T>
+struct scan_sequence
+{
+  thrust::device_vector<T> *data;
+  thrust::device_vector<T> *carries;
+
+  void operator()() const
+  {
+    ::inclusive_scan(data->begin(), data->end(), data->begin(), T(13), thrust::plus<T>(), carries->begin());
+  }
+};
+
+
+// replays the upsweep/spine/downsweep sequence with a single launch
+void replay(bulk::graph *g)
+{
+  g->launch();
 }
 
 
@@ -202,9 +318,22 @@ void compare(size_t n = 1 << 28)
   my_scan(&vec, T(13));
   double my_msecs = time_invocation_cuda(50, my_scan<T>, &vec, 13);
 
+  single_pass_scan(&vec, T(13));
+  double single_pass_msecs = time_invocation_cuda(50, single_pass_scan<T>, &vec, 13);
+
+  typedef scan_config<typename thrust::device_vector<T>::iterator, typename thrust::device_vector<T>::iterator, thrust::plus<T> > config;
+  thrust::device_vector<T> carries(config::num_groups(n));
+  scan_sequence<T> sequence = {&vec, &carries};
+  bulk::graph g = bulk::capture(sequence);
+
+  replay(&g);
+  double graph_msecs = time_invocation_cuda(50, replay, &g);
+
   std::cout << "N: " << n << std::endl;
   std::cout << "  Thrust's time:                  " << thrust_msecs << " ms" << std::endl;
   std::cout << "  My time:                        " << my_msecs << " ms" << std::endl;
+  std::cout << "  My time (graph replay):         " << graph_msecs << " ms" << std::endl;
+  std::cout << "  My time (single pass):          " << single_pass_msecs << " ms" << std::endl;
   std::cout << "  Performance relative to Thrust: " << thrust_msecs / my_msecs << std::endl;
   std::cout << std::endl;
 }
@@ -0,0 +1,125 @@
+#include <iostream>
+#include <cassert>
+#include <thrust/device_vector.h>
+#include <thrust/host_vector.h>
+#include <thrust/functional.h>
+#include <thrust/random.h>
+#include <bulk/bulk.hpp>
+#include "time_invocation_cuda.hpp"
+
+
+// makes num_segments segment offsets whose sizes range from empty to most of the input
+thrust::host_vector<int> skewed_offsets(int num_segments, thrust::default_random_engine &rng)
+{
+  thrust::host_vector<int> offsets(num_segments + 1);
+
+  offsets[0] = 0;
+  for(int s = 0; s < num_segments; ++s)
+  {
+    int size = 0;
+
+    switch(rng() % 4)
+    {
+      case 0: size = 0;                   break;
+      case 1: size = 1;                   break;
+      case 2: size = rng() % 1000;        break;
+      case 3: size = rng() % (1 << 20);   break;
+    }
+
+    offsets[s + 1] = offsets[s] + size;
+  }
+
+  return offsets;
+}
+
+
+template<typename T>
+void validate(int num_segments)
+{
+  thrust::default_random_engine rng(num_segments);
+
+  thrust::host_vector<int> h_offsets = skewed_offsets(num_segments, rng);
+  int n = h_offsets.back();
+
+  thrust::host_vector<T> h_input(n);
+  for(int i = 0; i < n; ++i)
+  {
+    h_input[i] = rng() % 10;
+  }
+
+  T init = 13;
+
+  // the offsets include empty segments, which contribute a sum but no scan results
+  thrust::host_vector<T> h_sums(num_segments), h_scan(n), h_exclusive_scan(n);
+  for(int s = 0; s < num_segments; ++s)
+  {
+    T sum = init;
+    for(int i = h_offsets[s]; i < h_offsets[s+1]; ++i)
+    {
+      h_exclusive_scan[i] = sum;
+      sum += h_input[i];
+      h_scan[i] = sum;
+    }
+
+    h_sums[s] = sum;
+  }
+
+  thrust::device_vector<T> d_input = h_input;
+  thrust::device_vector<int> d_offsets = h_offsets;
+  thrust::device_vector<T> d_sums(num_segments), d_scan(n), d_exclusive_scan(n);
+
+  bulk::segmented_reduce(d_input.begin(), d_input.end(), d_offsets.begin(), d_offsets.end(), d_sums.begin(), init, thrust::plus<T>());
+  bulk::inclusive_segmented_scan(d_input.begin(), d_input.end(), d_offsets.begin(), d_offsets.end(), d_scan.begin(), init, thrust::plus<T>());
+  bulk::exclusive_segmented_scan(d_input.begin(), d_input.end(), d_offsets.begin(), d_offsets.end(), d_exclusive_scan.begin(), init, thrust::plus<T>());
+
+  cudaError_t error = cudaDeviceSynchronize();
+
+  if(error)
+  {
+    std::cerr << "CUDA error: " << cudaGetErrorString(error) << std::endl;
+  }
+
+  assert(h_sums == d_sums);
+  assert(h_scan == d_scan);
+  assert(h_exclusive_scan == d_exclusive_scan);
+}
+
+
+template<typename T>
+void my_segmented_reduce(thrust::device_vector<T> *input, thrust::device_vector<int> *offsets, thrust::device_vector<T> *sums)
+{
+  bulk::segmented_reduce(input->begin(), input->end(), offsets->begin(), offsets->end(), sums->begin(), T(0), thrust::plus<T>());
+}
+
+
+template<typename T>
+void compare(int num_segments)
+{
+  thrust::default_random_engine rng;
+
+  thrust::device_vector<int> offsets = skewed_offsets(num_segments, rng);
+  thrust::device_vector<T> input(offsets.back(), 1);
+  thrust::device_vector<T> sums(num_segments);
+
+  my_segmented_reduce(&input, &offsets, &sums);
+  double msecs = time_invocation_cuda(20, my_segmented_reduce<T>, &input, &offsets, &sums);
+
+  std::cout << "N: " << input.size() << " in " << num_segments << " segments" << std::endl;
+  std::cout << "  My time: " << msecs << " ms" << std::endl;
+  std::cout << "  My bandwidth: " << double(sizeof(T) * input.size()) / (msecs / 1000) / 1e9 << " GB/s" << std::endl;
+}
+
+
+int main()
+{
+  for(int num_segments = 1; num_segments <= 1 << 12; num_segments <<= 1)
+  {
+    std::cout << "Testing " << num_segments << " segments" << std::endl;
+    validate<int>(num_segments);
+  }
+
+  compare<int>(1 << 12);
+  compare<float>(1 << 12);
+
+  return 0;
+}
@@ -0,0 +1,160 @@
+#include <iostream>
+#include <cassert>
+#include <thrust/device_vector.h>
+#include <thrust/host_vector.h>
+#include <thrust/functional.h>
+#include <thrust/random.h>
+#include <thrust/sort.h>
+#include <thrust/sequence.h>
+#include <thrust/set_operations.h>
+#include <thrust/equal.h>
+#include <bulk/bulk.hpp>
+#include "time_invocation_cuda.hpp"
+
+
+// makes n sorted keys drawn from [0, range), so small ranges make long runs of duplicates
+template<typename T>
+thrust::device_vector<T> sorted_keys(int n, int range, thrust::default_random_engine &rng)
+{
+  thrust::host_vector<T> h_keys(n);
+  for(int i = 0; i < n; ++i)
+  {
+    h_keys[i] = rng() % range;
+  }
+
+  thrust::device_vector<T> keys = h_keys;
+  thrust::sort(keys.begin(), keys.end());
+
+  return keys;
+}
+
+
+template<typename T>
+void validate(int n1, int n2, int range)
+{
+  thrust::default_random_engine rng(n1 + n2 + range);
+
+  thrust::device_vector<T> a = sorted_keys<T>(n1, range, rng);
+  thrust::device_vector<T> b = sorted_keys<T>(n2, range, rng);
+
+  thrust::device_vector<int> a_values(n1), b_values(n2);
+  thrust::sequence(a_values.begin(), a_values.end());
+  thrust::sequence(b_values.begin(), b_values.end(), n1);
+
+  thrust::device_vector<T> reference(n1 + n2), result(n1 + n2);
+  thrust::device_vector<int> reference_values(n1 + n2), result_values(n1 + n2);
+
+  thrust::less<T> comp;
+
+  // intersection
+  reference.resize(thrust::set_intersection(a.begin(), a.end(), b.begin(), b.end(), reference.begin(), comp) - reference.begin());
+  result.resize(bulk::set_intersection(a.begin(), a.end(), b.begin(), b.end(), result.begin(), comp) - result.begin());
+  assert(reference == result);
+
+  // union
+  reference.resize(n1 + n2);
+  result.resize(n1 + n2);
+  reference.resize(thrust::set_union(a.begin(), a.end(), b.begin(), b.end(), reference.begin(), comp) - reference.begin());
+  result.resize(bulk::set_union(a.begin(), a.end(), b.begin(), b.end(), result.begin(), comp) - result.begin());
+  assert(reference == result);
+
+  // difference
+  reference.resize(n1 + n2);
+  result.resize(n1 + n2);
+  reference.resize(thrust::set_difference(a.begin(), a.end(), b.begin(), b.end(), reference.begin(), comp) - reference.begin());
+  result.resize(bulk::set_difference(a.begin(), a.end(), b.begin(), b.end(), result.begin(), comp) - result.begin());
+  assert(reference == result);
+
+  // symmetric difference
+  reference.resize(n1 + n2);
+  result.resize(n1 + n2);
+  reference.resize(thrust::set_symmetric_difference(a.begin(), a.end(), b.begin(), b.end(), reference.begin(), comp) - reference.begin());
+  result.resize(bulk::set_symmetric_difference(a.begin(), a.end(), b.begin(), b.end(), result.begin(), comp) - result.begin());
+  assert(reference == result);
+
+  // intersection by key
+  reference.resize(n1 + n2);
+  result.resize(n1 + n2);
+  int reference_size = thrust::set_intersection_by_key(a.begin(), a.end(), b.begin(), b.end(), a_values.begin(), reference.begin(), reference_values.begin(), comp).first - reference.begin();
+  int result_size = bulk::set_intersection_by_key(a.begin(), a.end(), b.begin(), b.end(), a_values.begin(), result.begin(), result_values.begin(), comp).first - result.begin();
+  assert(reference_size == result_size);
+  assert(thrust::equal(reference_values.begin(), reference_values.begin() + reference_size, result_values.begin()));
+
+  // symmetric difference by key takes values from both inputs
+  reference_size = thrust::set_symmetric_difference_by_key(a.begin(), a.end(), b.begin(), b.end(), a_values.begin(), b_values.begin(), reference.begin(), reference_values.begin(), comp).first - reference.begin();
+  result_size = bulk::set_symmetric_difference_by_key(a.begin(), a.end(), b.begin(), b.end(), a_values.begin(), b_values.begin(), result.begin(), result_values.begin(), comp).first - result.begin();
+  assert(reference_size == result_size);
+  assert(thrust::equal(reference.begin(), reference.begin() + reference_size, result.begin()));
+  assert(thrust::equal(reference_values.begin(), reference_values.begin() + reference_size, result_values.begin()));
+
+  cudaError_t error = cudaDeviceSynchronize();
+
+  if(error)
+  {
+    std::cerr << "CUDA error: " << cudaGetErrorString(error) << std::endl;
+  }
+}
+
+
+template<typename T>
+void my_set_intersection(const thrust::device_vector<T> *a,
+                         const thrust::device_vector<T> *b,
+                         thrust::device_vector<T> *c)
+{
+  bulk::set_intersection(a->begin(), a->end(), b->begin(), b->end(), c->begin(), thrust::less<T>());
+}
+
+
+template<typename T>
+void thrust_set_intersection(const thrust::device_vector<T> *a,
+                             const thrust::device_vector<T> *b,
+                             thrust::device_vector<T> *c)
+{
+  thrust::set_intersection(a->begin(), a->end(), b->begin(), b->end(), c->begin(), thrust::less<T>());
+}
+
+
+template<typename T>
+void compare(int n)
+{
+  thrust::default_random_engine rng;
+
+  // sorted ids of two relations which share about half their keys
+  thrust::device_vector<T> a = sorted_keys<T>(n, 2 * n, rng);
+  thrust::device_vector<T> b = sorted_keys<T>(n, 2 * n, rng);
+  thrust::device_vector<T> c(2 * n);
+
+  my_set_intersection(&a, &b, &c);
+  double my_msecs = time_invocation_cuda(20, my_set_intersection<T>, &a, &b, &c);
+
+  thrust_set_intersection(&a, &b, &c);
+  double thrust_msecs = time_invocation_cuda(20, thrust_set_intersection<T>, &a, &b, &c);
+
+  std::cout << "N: " << 2 * n << std::endl;
+  std::cout << "  Thrust's time: " << thrust_msecs << " ms" << std::endl;
+  std::cout << "  My time: " << my_msecs << " ms" << std::endl;
+  std::cout << "  Performance relative to Thrust: " << thrust_msecs / my_msecs << std::endl;
+}
+
+
+int main()
+{
+  int sizes[] = {0, 1, 100, 10000, 1000000};
+
+  for(int i = 0; i < 5; ++i)
+  {
+    for(int j = 0; j < 5; ++j)
+    {
+      std::cout << "Testing " << sizes[i] << " x " << sizes[j] << std::endl;
+
+      // few distinct keys make runs of duplicates which cross tiles
+      validate<int>(sizes[i], sizes[j], 10);
+      validate<int>(sizes[i], sizes[j], 1 << 20);
+    }
+  }
+
+  compare<int>(1 << 23);
+  compare<double>(1 << 23);
+
+  return 0;
+}
@@ -0,0 +1,253 @@
+#include <iostream>
+#include <cassert>
+#include <cstdlib>
+#include <algorithm>
+#include <vector>
+#include <thrust/device_vector.h>
+#include <thrust/host_vector.h>
+#include <thrust/tuple.h>
+#include <thrust/iterator/zip_iterator.h>
+#include <bulk/bulk.hpp>
+
+
+// the group algorithms stage tuples of 8-byte & 4-byte components as a structure of arrays
+typedef thrust::tuple<long long,int> pair_type;
+
+static const std::size_t groupsize = 128;
+static const std::size_t grainsize = 4;
+static const std::size_t tile_size = groupsize * grainsize;
+static const std::size_t heap_size = 32 * 1024;
+
+
+struct compare_first
+{
+  template<typename Tuple>
+  __host__ __device__
+  bool operator()(const Tuple &x, const Tuple &y) const
+  {
+    return thrust::get<0>(x) < thrust::get<0>(y);
+  }
+};
+
+
+struct pair_plus
+{
+  __host__ __device__
+  pair_type operator()(const pair_type &x, const pair_type &y) const
+  {
+    return pair_type(thrust::get<0>(x) + thrust::get<0>(y), thrust::get<1>(x) + thrust::get<1>(y));
+  }
+};
+
+
+struct merge_kernel
+{
+  template<typename ConcurrentGroup, typename Iterator1, typename Size, typename Iterator2>
+  __device__
+  void operator()(ConcurrentGroup &g, Iterator1 first, Size n1, Size n2, Iterator2 result)
+  {
+    bulk::merge(g, first, first + n1, first + n1, first + n1 + n2, result, compare_first());
+  }
+};
+
+
+struct merge_by_key_kernel
+{
+  template<std::size_t groupsize, std::size_t grainsize, typename Iterator1, typename Size, typename Iterator2, typename Iterator3, typename Iterator4>
+  __device__
+  void operator()(bulk::concurrent_group<bulk::agent<grainsize>,groupsize> &g, Iterator1 keys_first, Size n1, Size n2, Iterator2 values_first, Iterator3 keys_result, Iterator4 values_result)
+  {
+    bulk::merge_by_key(bulk::bound<groupsize * grainsize>(g),
+                       keys_first, keys_first + n1,
+                       keys_first + n1, keys_first + n1 + n2,
+                       values_first, values_first + n1,
+                       keys_result, values_result,
+                       compare_first());
+  }
+};
+
+
+struct reduce_by_key_kernel
+{
+  template<typename ConcurrentGroup, typename Iterator1, typename Size, typename Iterator2, typename Iterator3, typename Iterator4>
+  __device__
+  void operator()(ConcurrentGroup &g, Iterator1 keys_first, Size n, Iterator2 values_first, Iterator3 keys_result, Iterator4 values_result, Size *result_size)
+  {
+    Iterator3 old_keys_result = keys_result;
+
+    int       init_key   = keys_first[0];
+    pair_type init_value = values_first[0];
+
+    // the inits become the carry, i.e. the last run
+    thrust::tie(keys_result, values_result, init_key, init_value) =
+      bulk::reduce_by_key(g,
+                          keys_first + 1, keys_first + n,
+                          values_first + 1,
+                          keys_result, values_result,
+                          init_key, init_value,
+                          thrust::equal_to<int>(),
+                          pair_plus());
+
+    if(g.this_exec.index() == 0)
+    {
+      *keys_result   = init_key;
+      *values_result = init_value;
+
+      *result_size = (keys_result - old_keys_result) + 1;
+    }
+  }
+};
+
+
+template<typename T>
+T *raw(thrust::device_vector<T> &vec)
+{
+  return thrust::raw_pointer_cast(vec.data());
+}
+
+
+// the first range has the even keys & the second the odd keys, so the ranges share no key and the merged order is unique
+void validate_merge(int n1, int n2)
+{
+  std::vector<std::pair<long long,int> > h_input(n1 + n2);
+
+  for(int i = 0; i < n1 + n2; ++i)
+  {
+    long long key = (static_cast<long long>(std::rand()) << 20) | (i < n1 ? 0 : 1);
+    h_input[i] = std::make_pair(key, std::rand());
+  }
+
+  std::sort(h_input.begin(), h_input.begin() + n1);
+  std::sort(h_input.begin() + n1, h_input.end());
+
+  std::vector<std::pair<long long,int> > expected(n1 + n2);
+  std::merge(h_input.begin(), h_input.begin() + n1, h_input.begin() + n1, h_input.end(), expected.begin());
+
+  thrust::host_vector<long long> h_keys(n1 + n2);
+  thrust::host_vector<int>       h_values(n1 + n2);
+  for(int i = 0; i < n1 + n2; ++i)
+  {
+    h_keys[i]   = h_input[i].first;
+    h_values[i] = h_input[i].second;
+  }
+
+  thrust::device_vector<long long> keys = h_keys, keys_result(n1 + n2);
+  thrust::device_vector<int>       values = h_values, values_result(n1 + n2);
+
+  // merge the keys & values as tuples
+  bulk::async(bulk::con<groupsize,grainsize>(heap_size), merge_kernel(), bulk::root,
+              thrust::make_zip_iterator(thrust::make_tuple(raw(keys), raw(values))), n1, n2,
+              thrust::make_zip_iterator(thrust::make_tuple(raw(keys_result), raw(values_result))));
+
+  thrust::host_vector<long long> h_keys_result   = keys_result;
+  thrust::host_vector<int>       h_values_result = values_result;
+
+  for(int i = 0; i < n1 + n2; ++i)
+  {
+    assert(h_keys_result[i]   == expected[i].first);
+    assert(h_values_result[i] == expected[i].second);
+  }
+
+  // merge tuples of keys by key, carrying the indices of the inputs as values
+  if(n1 + n2 <= int(tile_size))
+  {
+    thrust::device_vector<int> indices(n1 + n2), indices_result(n1 + n2);
+    for(int i = 0; i < n1 + n2; ++i) indices[i] = i;
+
+    bulk::async(bulk::con<groupsize,grainsize>(heap_size), merge_by_key_kernel(), bulk::root,
+                thrust::make_zip_iterator(thrust::make_tuple(raw(keys), raw(values))), n1, n2,
+                raw(indices),
+                thrust::make_zip_iterator(thrust::make_tuple(raw(keys_result), raw(values_result))),
+                raw(indices_result));
+
+    h_keys_result   = keys_result;
+    h_values_result = values_result;
+    thrust::host_vector<int> h_indices_result = indices_result;
+
+    for(int i = 0; i < n1 + n2; ++i)
+    {
+      assert(h_keys_result[i]   == expected[i].first);
+      assert(h_values_result[i] == expected[i].second);
+      assert(h_keys[h_indices_result[i]] == expected[i].first);
+    }
+  }
+}
+
+
+void validate_reduce_by_key(int n)
+{
+  thrust::host_vector<int>       h_keys(n);
+  thrust::host_vector<long long> h_wide(n);
+  thrust::host_vector<int>       h_narrow(n);
+
+  for(int i = 0, key = 0; i < n; ++i)
+  {
+    // runs of random length
+    if(std::rand() % 7 == 0) ++key;
+
+    h_keys[i]   = key;
+    // wider than 32 bits, but not so wide that the sums overflow
+    h_wide[i]   = static_cast<long long>(std::rand() % 1000) << 20;
+    h_narrow[i] = std::rand() % 1000;
+  }
+
+  std::vector<int>       expected_keys;
+  std::vector<long long> expected_wide;
+  std::vector<int>       expected_narrow;
+
+  for(int i = 0; i < n; ++i)
+  {
+    if(i == 0 || h_keys[i] != h_keys[i-1])
+    {
+      expected_keys.push_back(h_keys[i]);
+      expected_wide.push_back(0);
+      expected_narrow.push_back(0);
+    }
+
+    expected_wide.back()   += h_wide[i];
+    expected_narrow.back() += h_narrow[i];
+  }
+
+  thrust::device_vector<int>       keys = h_keys, keys_result(n);
+  thrust::device_vector<long long> wide = h_wide, wide_result(n);
+  thrust::device_vector<int>       narrow = h_narrow, narrow_result(n);
+  thrust::device_vector<int>       result_size(1);
+
+  bulk::async(bulk::con<groupsize,grainsize>(heap_size), reduce_by_key_kernel(), bulk::root,
+              raw(keys), n,
+              thrust::make_zip_iterator(thrust::make_tuple(raw(wide), raw(narrow))),
+              raw(keys_result),
+              thrust::make_zip_iterator(thrust::make_tuple(raw(wide_result), raw(narrow_result))),
+              raw(result_size));
+
+  size_t num_runs = result_size[0];
+  assert(num_runs == expected_keys.size());
+
+  thrust::host_vector<int>       h_keys_result   = keys_result;
+  thrust::host_vector<long long> h_wide_result   = wide_result;
+  thrust::host_vector<int>       h_narrow_result = narrow_result;
+
+  for(size_t i = 0; i < num_runs; ++i)
+  {
+    assert(h_keys_result[i]   == expected_keys[i]);
+    assert(h_wide_result[i]   == expected_wide[i]);
+    assert(h_narrow_result[i] == expected_narrow[i]);
+  }
+}
+
+
+int main()
+{
+  // a partial tile, a single tile & several tiles
+  validate_merge(100, 157);
+  validate_merge(256, 256);
+  validate_merge(3000, 1234);
+
+  validate_reduce_by_key(300);
+  validate_reduce_by_key(int(tile_size) + 1);
+  validate_reduce_by_key(10000);
+
+  std::cout << "OK" << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,72 @@
+#include <bulk/bulk.hpp>
+#include <thrust/functional.h>
+#include <cassert>
+#include <cstdlib>
+#include <iostream>
+#include "time_invocation_cuda.hpp"
+
+
+void bulk_streaming_reduce(int *first, int *last, size_t chunk_size)
+{
+  bulk::streaming_reduce(first, last, 0, thrust::plus<int>(), chunk_size);
+}
+
+
+// reduces and scans an input in pinned host memory chunk by chunk,
+// overlapping each chunk's transfers with the computation of its neighbors
+int main()
+{
+  size_t n = size_t(1) << 26;
+  size_t chunk_size = size_t(1) << 22;
+
+  int *input = 0, *result = 0, *keys = 0, *keys_result = 0, *values_result = 0;
+  cudaHostAlloc(&input,         n * sizeof(int), cudaHostAllocDefault);
+  cudaHostAlloc(&result,        n * sizeof(int), cudaHostAllocDefault);
+  cudaHostAlloc(&keys,          n * sizeof(int), cudaHostAllocDefault);
+  cudaHostAlloc(&keys_result,   n * sizeof(int), cudaHostAllocDefault);
+  cudaHostAlloc(&values_result, n * sizeof(int), cudaHostAllocDefault);
+
+  for(size_t i = 0; i < n; ++i)
+  {
+    input[i] = std::rand() % 10;
+
+    // runs of 1000 keys straddle the chunks' boundaries
+    keys[i] = int(i / 1000);
+  }
+
+  long long expected = 0;
+  for(size_t i = 0; i < n; ++i) expected += input[i];
+
+  int sum = bulk::streaming_reduce(input, input + n, 0, thrust::plus<int>(), chunk_size);
+  assert(sum == int(expected));
+
+  bulk::streaming_inclusive_scan(input, input + n, result, thrust::plus<int>(), chunk_size);
+  assert(result[n-1] == int(expected));
+
+  bulk::streaming_exclusive_scan(input, input + n, result, 13, thrust::plus<int>(), chunk_size);
+  assert(result[n-1] == int(expected) + 13 - input[n-1]);
+
+  size_t num_runs = bulk::streaming_reduce_by_key(keys, keys + n, input, keys_result, values_result, thrust::equal_to<int>(), thrust::plus<int>(), chunk_size).first - keys_result;
+  assert(num_runs == (n + 999) / 1000);
+
+  for(size_t i = 0; i < num_runs; ++i)
+  {
+    int run_sum = 0;
+    for(size_t j = i * 1000; j < n && j < (i + 1) * 1000; ++j) run_sum += input[j];
+
+    assert(keys_result[i] == int(i));
+    assert(values_result[i] == run_sum);
+  }
+
+  double msecs = time_invocation_cuda(10, bulk_streaming_reduce, input, input + n, chunk_size);
+
+  std::cout << "streaming_reduce: " << msecs << " ms, " << (double(n) * sizeof(int) / (1 << 30)) / (msecs / 1000) << " GB/s" << std::endl;
+
+  cudaFreeHost(input);
+  cudaFreeHost(result);
+  cudaFreeHost(keys);
+  cudaFreeHost(keys_result);
+  cudaFreeHost(values_result);
+
+  return 0;
+}
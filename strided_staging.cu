@@ -0,0 +1,105 @@
+#include <iostream>
+#include <cassert>
+#include <cstdlib>
+#include <thrust/device_vector.h>
+#include <thrust/host_vector.h>
+#include <bulk/bulk.hpp>
+
+
+struct atomic_accumulate
+{
+  int *sum;
+
+  __host__ __device__
+  atomic_accumulate(int *sum) : sum(sum) {}
+
+  __device__
+  void operator()(const int &x)
+  {
+    atomicAdd(sum, x);
+  }
+};
+
+
+// reads a column of an array of structures with copy_n, gather & for_each_n:
+// with a heap large enough for the stage, they read the column through a tile transpose,
+// and without one, they read it directly
+struct read_column
+{
+  template<typename ConcurrentGroup>
+  __device__
+  void operator()(ConcurrentGroup &g, const int *aos, int stride, int n, const int *input, int *copy_result, int *gather_result, int *sum)
+  {
+    bulk::strided_iterator<const int*,int> column = bulk::make_strided_iterator(aos, stride);
+
+    bulk::copy_n(g, column, n, copy_result);
+
+    bulk::gather(g, column, column + n, input, gather_result);
+
+    bulk::for_each_n(g, column, n, atomic_accumulate(sum));
+  }
+};
+
+
+void validate(int stride, int n, size_t heap_size)
+{
+  thrust::host_vector<int> h_aos(stride * n);
+  for(size_t i = 0; i < h_aos.size(); ++i)
+  {
+    h_aos[i] = std::rand() % n;
+  }
+
+  thrust::host_vector<int> h_input(n);
+  for(int i = 0; i < n; ++i)
+  {
+    h_input[i] = std::rand();
+  }
+
+  thrust::host_vector<int> expected_copy(n), expected_gather(n);
+  int expected_sum = 0;
+  for(int i = 0; i < n; ++i)
+  {
+    expected_copy[i]   = h_aos[i * stride];
+    expected_gather[i] = h_input[h_aos[i * stride]];
+    expected_sum      += h_aos[i * stride];
+  }
+
+  thrust::device_vector<int> aos = h_aos;
+  thrust::device_vector<int> input = h_input;
+  thrust::device_vector<int> copy_result(n), gather_result(n), sum(1, 0);
+
+  bulk::async(bulk::con<128,4>(heap_size), read_column(), bulk::root,
+              thrust::raw_pointer_cast(aos.data()),
+              stride,
+              n,
+              thrust::raw_pointer_cast(input.data()),
+              thrust::raw_pointer_cast(copy_result.data()),
+              thrust::raw_pointer_cast(gather_result.data()),
+              thrust::raw_pointer_cast(sum.data()));
+
+  assert(expected_copy == thrust::host_vector<int>(copy_result));
+  assert(expected_gather == thrust::host_vector<int>(gather_result));
+  assert(expected_sum == int(sum[0]));
+}
+
+
+int main()
+{
+  // a tile of ints, plus room for the on-chip allocator's block header
+  size_t staged_heap_size = 128 * 4 * sizeof(int) + 64;
+
+  int strides[] = {2, 3, 8, 9};
+
+  for(size_t i = 0; i < sizeof(strides) / sizeof(int); ++i)
+  {
+    // a column spanning several tiles, the last of them partial
+    validate(strides[i], 5000, staged_heap_size);
+
+    // without on-chip heap for the stage, the column is read directly
+    validate(strides[i], 5000, 0);
+  }
+
+  std::cout << "OK" << std::endl;
+
+  return 0;
+}
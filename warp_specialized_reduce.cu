@@ -0,0 +1,103 @@
+#include <iostream>
+#include <cassert>
+#include <bulk/bulk.hpp>
+#include <thrust/device_vector.h>
+#include <thrust/tabulate.h>
+#include <thrust/reduce.h>
+
+// a reduction whose loader warp streams tiles into a ring of on-chip buffers
+// while the compute warps sum the tiles loaded before
+
+const std::size_t num_producer_warps = 1;
+const std::size_t num_consumer_warps = 4;
+const std::size_t num_stages = 4;
+
+const std::size_t groupsize = 32 * (num_producer_warps + num_consumer_warps);
+const int tile_size = 32 * 32;
+
+struct load_tile
+{
+  const int *data;
+  int n;
+  int first_tile;
+  int num_groups;
+  int *stages;
+
+  template<typename Role>
+  __device__
+  void operator()(Role &producers, int i, unsigned int stage)
+  {
+    int offset = (first_tile + i * num_groups) * tile_size;
+    int *buffer = stages + stage * tile_size;
+
+    for(int j = producers.index(); j < tile_size; j += producers.size())
+    {
+      buffer[j] = (offset + j < n) ? data[offset + j] : 0;
+    }
+  }
+};
+
+struct sum_tile
+{
+  int *stages;
+  int *sum;
+
+  template<typename Role>
+  __device__
+  void operator()(Role &consumers, int, unsigned int stage)
+  {
+    const int *buffer = stages + stage * tile_size;
+
+    for(int j = consumers.index(); j < tile_size; j += consumers.size())
+    {
+      *sum += buffer[j];
+    }
+  }
+};
+
+struct reduce_kernel
+{
+  __device__
+  void operator()(bulk::concurrent_group<bulk::agent<>,groupsize> &g, const int *data, int n, int num_groups, int *result)
+  {
+    int num_tiles = (n + tile_size - 1) / tile_size;
+
+    // each group takes every num_groups-th tile, beginning with its own index
+    int num_iterations = (g.index() < num_tiles) ? (num_tiles - g.index() + num_groups - 1) / num_groups : 0;
+
+    int *stages = static_cast<int*>(bulk::malloc(g, num_stages * tile_size * sizeof(int)));
+
+    int sum = 0;
+
+    load_tile load = {data, n, g.index(), num_groups, stages};
+    sum_tile compute = {stages, &sum};
+
+    bulk::warp_specialize<num_producer_warps, num_stages>(g, num_iterations, load, compute);
+
+    // the producers' sums are zero
+    atomicAdd(result, sum);
+
+    bulk::free(g, stages);
+  }
+};
+
+int main()
+{
+  const int n = 1 << 24;
+
+  thrust::device_vector<int> data(n);
+  thrust::tabulate(data.begin(), data.end(), thrust::placeholders::_1 % 7);
+
+  thrust::device_vector<int> result(1, 0);
+
+  int num_groups = 4 * bulk::concurrent_group<>::hardware_concurrency();
+  int heap_size = num_stages * tile_size * sizeof(int);
+
+  bulk::async(bulk::grid<groupsize,1>(num_groups, heap_size), reduce_kernel(), bulk::root.this_exec, thrust::raw_pointer_cast(data.data()), n, num_groups, thrust::raw_pointer_cast(result.data()));
+
+  assert(result[0] == thrust::reduce(data.begin(), data.end()));
+
+  std::cout << "It worked!" << std::endl;
+
+  return 0;
+}